@@ -134,6 +134,34 @@ typedef struct _CFDATA
 } CFDATA, *PCFDATA;
 
 
+/* Asynchronous extraction */
+
+/* Most uncompressed data waiting for the writer thread */
+#define CAB_WRITER_MAX_PENDING (8 * 1024 * 1024)
+
+typedef struct _CAB_WRITE_JOB
+{
+    LIST_ENTRY ListEntry;
+    PCFFILE File;           // File in the cabinet, which stays mapped
+    PUCHAR Buffer;          // Uncompressed file data
+    WCHAR DestName[MAX_PATH];
+} CAB_WRITE_JOB, *PCAB_WRITE_JOB;
+
+typedef struct _CAB_WRITER
+{
+    HANDLE Thread;
+    HANDLE WorkEvent;       // Set when a job was queued or the writer has to stop
+    HANDLE DoneEvent;       // Set when a job was written
+    RTL_CRITICAL_SECTION Lock;
+    LIST_ENTRY JobList;     // PCAB_WRITE_JOB entries
+    ULONG PendingJobs;
+    ULONG PendingBytes;
+    PCAB_WRITE_JOB FailedJob; // File that could not be written, the writer waits until it is resolved
+    ULONG Status;           // Status of the failed write
+    BOOLEAN Stop;
+} CAB_WRITER;
+
+
 /* FUNCTIONS ****************************************************************/
 
 /* Needed by zlib, but we don't want the dependency on the CRT */
@@ -474,6 +502,58 @@ SetAttributesOnFile(PCFFILE File,
     return NT_SUCCESS(NtStatus);
 }
 
+/*
+ * FUNCTION: Sets time stamp and attributes on an extracted file
+ * ARGUMENTS:
+ *      File = Pointer to CFFILE node for file
+ * RETURNS:
+ *     Status of operation
+ */
+static ULONG
+SetFileInfo(PCFFILE File,
+            HANDLE hFile)
+{
+    FILE_BASIC_INFORMATION FileBasic;
+    IO_STATUS_BLOCK IoStatusBlock;
+    FILETIME FileTime;
+    NTSTATUS NtStatus;
+
+    if (!ConvertDosDateTimeToFileTime(File->FileDate,
+                                      File->FileTime,
+                                      &FileTime))
+    {
+        DPRINT1("DosDateTimeToFileTime() failed\n");
+        return CAB_STATUS_CANNOT_WRITE;
+    }
+
+    NtStatus = NtQueryInformationFile(hFile,
+                                      &IoStatusBlock,
+                                      &FileBasic,
+                                      sizeof(FILE_BASIC_INFORMATION),
+                                      FileBasicInformation);
+    if (!NT_SUCCESS(NtStatus))
+    {
+        DPRINT("NtQueryInformationFile() failed (%x)\n", NtStatus);
+    }
+    else
+    {
+        memcpy(&FileBasic.LastAccessTime, &FileTime, sizeof(FILETIME));
+
+        NtStatus = NtSetInformationFile(hFile,
+                                        &IoStatusBlock,
+                                        &FileBasic,
+                                        sizeof(FILE_BASIC_INFORMATION),
+                                        FileBasicInformation);
+        if (!NT_SUCCESS(NtStatus))
+        {
+            DPRINT("NtSetInformationFile() failed (%x)\n", NtStatus);
+        }
+    }
+
+    SetAttributesOnFile(File, hFile);
+    return CAB_STATUS_SUCCESS;
+}
+
 /*
  * FUNCTION: Closes the current cabinet
  * RETURNS:
@@ -797,8 +877,18 @@ CabinetClose(
     if (!CabinetContext->FileOpen)
         return;
 
+    /* The writer still uses the file nodes in the mapped cabinet */
+    CabinetEndAsyncExtract(CabinetContext);
+
     CloseCabinet(CabinetContext);
     CabinetContext->FileOpen = FALSE;
+
+    CabinetContext->BlockCFData = NULL;
+    if (CabinetContext->BlockBuffer)
+    {
+        RtlFreeHeap(ProcessHeap, 0, CabinetContext->BlockBuffer);
+        CabinetContext->BlockBuffer = NULL;
+    }
 }
 
 /*
@@ -871,12 +961,6 @@ CabinetFindNext(
             // FIXME: check for match against search criteria
             if (Search->File != Prev)
             {
-                if (Prev == NULL || Search->File->FolderIndex != Prev->FolderIndex)
-                {
-                    Search->CFData = NULL;
-                    Search->Offset = 0;
-                }
-
                 /* don't match the file we started with */
                 if (wcscmp(Search->Search, L"*") == 0)
                 {
@@ -941,6 +1025,550 @@ Validate(VOID)
 }
 #endif
 
+/*
+ * FUNCTION: Makes sure that a data block lies within the cabinet file
+ * RETURNS:
+ *     TRUE if the block is valid, or FALSE
+ */
+static BOOL
+CabinetCheckBlock(
+    IN PCABINET_CONTEXT CabinetContext)
+{
+    PCFDATA CFData = CabinetContext->BlockCFData;
+    PUCHAR End = CabinetContext->FileBuffer + CabinetContext->FileSize;
+
+    if ((PUCHAR)(CFData + 1) + CabinetContext->DataReserved > End ||
+        (PUCHAR)(CFData + 1) + CabinetContext->DataReserved + CFData->CompSize > End ||
+        CFData->UncompSize > CAB_BLOCKSIZE)
+    {
+        DPRINT1("Invalid data block %lu\n", CabinetContext->BlockIndex);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * FUNCTION: Uncompresses the current data block into the block buffer
+ * RETURNS:
+ *     Status of operation
+ */
+static ULONG
+CabinetDecodeBlock(
+    IN PCABINET_CONTEXT CabinetContext)
+{
+    PCFDATA CFData = CabinetContext->BlockCFData;
+    LONG InputLength, OutputLength;
+    ULONG Status;
+
+    if (!CabinetContext->BlockBuffer)
+    {
+        CabinetContext->BlockBuffer = RtlAllocateHeap(ProcessHeap, 0, CAB_BLOCKSIZE);
+        if (!CabinetContext->BlockBuffer)
+            return CAB_STATUS_NOMEMORY;
+    }
+
+    /* Always uncompress the whole block, so it is done only once */
+    InputLength = CFData->CompSize;
+    OutputLength = CFData->UncompSize;
+
+    DPRINT("Decompressing block %lu at uncompressed offset (0x%X)\n",
+           CabinetContext->BlockIndex, CabinetContext->BlockOffset);
+
+    Status = CabinetContext->Codec->Uncompress(CabinetContext->Codec,
+                                               CabinetContext->BlockBuffer,
+                                               (PUCHAR)(CFData + 1) + CabinetContext->DataReserved,
+                                               &InputLength,
+                                               &OutputLength);
+    if (Status != CS_SUCCESS)
+    {
+        DPRINT("Cannot uncompress block\n");
+        if (Status == CS_NOMEMORY)
+            return CAB_STATUS_NOMEMORY;
+        return CAB_STATUS_INVALID_CAB;
+    }
+
+    if (OutputLength != CFData->UncompSize)
+    {
+        DPRINT1("Block %lu uncompressed to %ld bytes instead of %u\n",
+                CabinetContext->BlockIndex, OutputLength, CFData->UncompSize);
+        return CAB_STATUS_INVALID_CAB;
+    }
+
+    CabinetContext->BlockDecoded = TRUE;
+    return CAB_STATUS_SUCCESS;
+}
+
+/*
+ * FUNCTION: Reads uncompressed data from a folder
+ * ARGUMENTS:
+ *     Folder = Pointer to the folder to read from
+ *     Buffer = Pointer to buffer to place the uncompressed data
+ *     Offset = Uncompressed offset of the data in the folder
+ *     Size   = Number of bytes to read
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     The last block used stays in the block buffer, so that extracting
+ *     the files of a folder in order uncompresses every block only once.
+ */
+static ULONG
+CabinetReadFolder(
+    IN PCABINET_CONTEXT CabinetContext,
+    IN PCFFOLDER Folder,
+    OUT PUCHAR Buffer,
+    IN ULONG Offset,
+    IN ULONG Size)
+{
+    ULONG Length;
+    ULONG Status;
+
+    if (Size == 0)
+        return CAB_STATUS_SUCCESS;
+
+    /* The data can only be found going forward, restart at the first block if needed */
+    if (CabinetContext->BlockCFData == NULL ||
+        CabinetContext->BlockFolder != Folder ||
+        Offset < CabinetContext->BlockOffset)
+    {
+        if (Folder->DataBlockCount == 0)
+            return CAB_STATUS_INVALID_CAB;
+
+        CabinetContext->BlockFolder = Folder;
+        CabinetContext->BlockCFData = (PCFDATA)(CabinetContext->FileBuffer + Folder->DataOffset);
+        CabinetContext->BlockIndex = 0;
+        CabinetContext->BlockOffset = 0;
+        CabinetContext->BlockDecoded = FALSE;
+
+        if (!CabinetCheckBlock(CabinetContext))
+        {
+            CabinetContext->BlockCFData = NULL;
+            return CAB_STATUS_INVALID_CAB;
+        }
+    }
+
+    while (Size > 0)
+    {
+        /* Skip the blocks before the data without uncompressing them */
+        while (Offset >= CabinetContext->BlockOffset + CabinetContext->BlockCFData->UncompSize)
+        {
+            if (CabinetContext->BlockIndex + 1 >= Folder->DataBlockCount)
+            {
+                DPRINT1("Data at offset (0x%X) is past the end of the folder\n", Offset);
+                return CAB_STATUS_INVALID_CAB;
+            }
+
+            CabinetContext->BlockOffset += CabinetContext->BlockCFData->UncompSize;
+            CabinetContext->BlockCFData = (PCFDATA)((PUCHAR)(CabinetContext->BlockCFData + 1) +
+                                                    CabinetContext->DataReserved +
+                                                    CabinetContext->BlockCFData->CompSize);
+            CabinetContext->BlockIndex++;
+            CabinetContext->BlockDecoded = FALSE;
+
+            if (!CabinetCheckBlock(CabinetContext))
+            {
+                CabinetContext->BlockCFData = NULL;
+                return CAB_STATUS_INVALID_CAB;
+            }
+        }
+
+        if (!CabinetContext->BlockDecoded)
+        {
+            Status = CabinetDecodeBlock(CabinetContext);
+            if (Status != CAB_STATUS_SUCCESS)
+                return Status;
+        }
+
+        /* Copy what the block has of the data */
+        Length = CabinetContext->BlockOffset + CabinetContext->BlockCFData->UncompSize - Offset;
+        Length = min(Length, Size);
+        RtlCopyMemory(Buffer,
+                      CabinetContext->BlockBuffer + (Offset - CabinetContext->BlockOffset),
+                      Length);
+
+        Buffer += Length;
+        Offset += Length;
+        Size -= Length;
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
+/*
+ * FUNCTION: Writes an extracted file to disk
+ * ARGUMENTS:
+ *     Job = Pointer to the write job of the file
+ * RETURNS:
+ *     Status of operation
+ */
+static ULONG
+CabinetWriteFile(
+    IN PCAB_WRITE_JOB Job)
+{
+    HANDLE DestFile;
+    NTSTATUS NtStatus;
+    ULONG Status;
+    UNICODE_STRING UnicodeString;
+    IO_STATUS_BLOCK IoStatusBlock;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    LARGE_INTEGER AllocationSize;
+
+    RtlInitUnicodeString(&UnicodeString, Job->DestName);
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &UnicodeString,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL, NULL);
+
+    /* Create destination file, overwrite if it already exists */
+    AllocationSize.QuadPart = Job->File->FileSize;
+    NtStatus = NtCreateFile(&DestFile,
+                            GENERIC_READ | GENERIC_WRITE | SYNCHRONIZE,
+                            &ObjectAttributes,
+                            &IoStatusBlock,
+                            &AllocationSize,
+                            FILE_ATTRIBUTE_NORMAL,
+                            0,
+                            FILE_OVERWRITE_IF,
+                            FILE_SYNCHRONOUS_IO_NONALERT | FILE_SEQUENTIAL_ONLY,
+                            NULL, 0);
+    if (!NT_SUCCESS(NtStatus))
+    {
+        DPRINT1("NtCreateFile() failed (%S) (%x)\n", Job->DestName, NtStatus);
+        return CAB_STATUS_CANNOT_CREATE;
+    }
+
+    if (Job->File->FileSize > 0)
+    {
+        NtStatus = NtWriteFile(DestFile,
+                               NULL,
+                               NULL,
+                               NULL,
+                               &IoStatusBlock,
+                               Job->Buffer,
+                               Job->File->FileSize,
+                               NULL,
+                               NULL);
+        if (!NT_SUCCESS(NtStatus))
+        {
+            DPRINT1("NtWriteFile() failed (%S) (%x)\n", Job->DestName, NtStatus);
+            Status = CAB_STATUS_CANNOT_WRITE;
+            goto Quit;
+        }
+    }
+
+    Status = SetFileInfo(Job->File, DestFile);
+
+Quit:
+    NtClose(DestFile);
+    return Status;
+}
+
+/* Writes the queued files, in the order they were extracted */
+static ULONG NTAPI
+CabinetWriterThread(IN PVOID Parameter)
+{
+    PCAB_WRITER Writer = (PCAB_WRITER)Parameter;
+    PLIST_ENTRY ListEntry;
+    PCAB_WRITE_JOB Job;
+    ULONG Status;
+    BOOLEAN Stop;
+
+    for (;;)
+    {
+        RtlEnterCriticalSection(&Writer->Lock);
+        if (IsListEmpty(&Writer->JobList) || (Writer->FailedJob && !Writer->Stop))
+        {
+            Stop = Writer->Stop;
+            RtlLeaveCriticalSection(&Writer->Lock);
+
+            /* Only stop once everything has been written */
+            if (Stop)
+                break;
+
+            NtWaitForSingleObject(Writer->WorkEvent, FALSE, NULL);
+            continue;
+        }
+        ListEntry = RemoveHeadList(&Writer->JobList);
+        RtlLeaveCriticalSection(&Writer->Lock);
+
+        Job = CONTAINING_RECORD(ListEntry, CAB_WRITE_JOB, ListEntry);
+        Status = CabinetWriteFile(Job);
+
+        RtlEnterCriticalSection(&Writer->Lock);
+        if (Status != CAB_STATUS_SUCCESS && !Writer->FailedJob)
+        {
+            /* Keep the file so that it can be reported and written again */
+            Writer->FailedJob = Job;
+            Writer->Status = Status;
+            Job = NULL;
+        }
+        else
+        {
+            Writer->PendingJobs--;
+            Writer->PendingBytes -= Job->File->FileSize;
+        }
+        RtlLeaveCriticalSection(&Writer->Lock);
+
+        if (Job)
+        {
+            RtlFreeHeap(ProcessHeap, 0, Job->Buffer);
+            RtlFreeHeap(ProcessHeap, 0, Job);
+        }
+
+        NtSetEvent(Writer->DoneEvent, NULL);
+    }
+
+    NtTerminateThread(NtCurrentThread(), STATUS_SUCCESS);
+    return 0;
+}
+
+/*
+ * FUNCTION: Queues an extracted file for the writer thread
+ * ARGUMENTS:
+ *     Job = Pointer to the write job of the file
+ */
+static VOID
+CabinetQueueWrite(
+    IN PCAB_WRITER Writer,
+    IN PCAB_WRITE_JOB Job)
+{
+    RtlEnterCriticalSection(&Writer->Lock);
+
+    /*
+     * Don't let the uncompressed data pile up when the disk is slow. The
+     * writer stops at a failed file, which the caller resolves afterwards.
+     */
+    while (Writer->PendingJobs > 0 && !Writer->FailedJob &&
+           Writer->PendingBytes + Job->File->FileSize > CAB_WRITER_MAX_PENDING)
+    {
+        RtlLeaveCriticalSection(&Writer->Lock);
+        NtWaitForSingleObject(Writer->DoneEvent, FALSE, NULL);
+        RtlEnterCriticalSection(&Writer->Lock);
+    }
+
+    InsertTailList(&Writer->JobList, &Job->ListEntry);
+    Writer->PendingJobs++;
+    Writer->PendingBytes += Job->File->FileSize;
+
+    RtlLeaveCriticalSection(&Writer->Lock);
+
+    NtSetEvent(Writer->WorkEvent, NULL);
+}
+
+/*
+ * FUNCTION: Starts a writer thread for the extracted files
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     Until CabinetEndAsyncExtract is called, CabinetExtractFile only
+ *     uncompresses the files and leaves writing them to the writer thread.
+ *     Existing files are overwritten without calling the overwrite handler.
+ *     A file that cannot be written is returned by CabinetGetWriteError.
+ */
+ULONG
+CabinetBeginAsyncExtract(
+    IN PCABINET_CONTEXT CabinetContext)
+{
+    PCAB_WRITER Writer;
+    NTSTATUS NtStatus;
+
+    if (CabinetContext->Writer)
+        return CAB_STATUS_SUCCESS;
+
+    Writer = RtlAllocateHeap(ProcessHeap, HEAP_ZERO_MEMORY, sizeof(CAB_WRITER));
+    if (!Writer)
+        return CAB_STATUS_NOMEMORY;
+
+    InitializeListHead(&Writer->JobList);
+    Writer->Status = CAB_STATUS_SUCCESS;
+
+    NtStatus = RtlInitializeCriticalSection(&Writer->Lock);
+    if (!NT_SUCCESS(NtStatus))
+    {
+        RtlFreeHeap(ProcessHeap, 0, Writer);
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    NtStatus = NtCreateEvent(&Writer->WorkEvent,
+                             EVENT_ALL_ACCESS,
+                             NULL,
+                             SynchronizationEvent,
+                             FALSE);
+    if (!NT_SUCCESS(NtStatus))
+        goto Failure;
+
+    NtStatus = NtCreateEvent(&Writer->DoneEvent,
+                             EVENT_ALL_ACCESS,
+                             NULL,
+                             SynchronizationEvent,
+                             FALSE);
+    if (!NT_SUCCESS(NtStatus))
+        goto Failure;
+
+    NtStatus = RtlCreateUserThread(NtCurrentProcess(),
+                                   NULL,
+                                   FALSE,
+                                   0,
+                                   0,
+                                   0,
+                                   CabinetWriterThread,
+                                   Writer,
+                                   &Writer->Thread,
+                                   NULL);
+    if (!NT_SUCCESS(NtStatus))
+        goto Failure;
+
+    CabinetContext->Writer = Writer;
+    return CAB_STATUS_SUCCESS;
+
+Failure:
+    DPRINT1("Cannot start the writer thread (%x)\n", NtStatus);
+    if (Writer->DoneEvent)
+        NtClose(Writer->DoneEvent);
+    if (Writer->WorkEvent)
+        NtClose(Writer->WorkEvent);
+    RtlDeleteCriticalSection(&Writer->Lock);
+    RtlFreeHeap(ProcessHeap, 0, Writer);
+    return CAB_STATUS_FAILURE;
+}
+
+/*
+ * FUNCTION: Returns the file the writer thread could not write
+ * ARGUMENTS:
+ *     Wait     = Whether to wait until all queued files are written or one failed
+ *     DestName = Receives the path of the file that could not be written
+ * RETURNS:
+ *     Status of the failed write, CAB_STATUS_SUCCESS if no write failed
+ * NOTES:
+ *     The writer thread waits until CabinetResolveWriteError is called
+ *     before it writes the next files.
+ */
+ULONG
+CabinetGetWriteError(
+    IN PCABINET_CONTEXT CabinetContext,
+    IN BOOLEAN Wait,
+    OUT PCWSTR *DestName)
+{
+    PCAB_WRITER Writer = CabinetContext->Writer;
+    ULONG Status = CAB_STATUS_SUCCESS;
+
+    if (!Writer)
+        return CAB_STATUS_SUCCESS;
+
+    RtlEnterCriticalSection(&Writer->Lock);
+    for (;;)
+    {
+        if (Writer->FailedJob)
+        {
+            *DestName = Writer->FailedJob->DestName;
+            Status = Writer->Status;
+            break;
+        }
+
+        if (!Wait || Writer->PendingJobs == 0)
+            break;
+
+        RtlLeaveCriticalSection(&Writer->Lock);
+        NtWaitForSingleObject(Writer->DoneEvent, FALSE, NULL);
+        RtlEnterCriticalSection(&Writer->Lock);
+    }
+    RtlLeaveCriticalSection(&Writer->Lock);
+
+    return Status;
+}
+
+/*
+ * FUNCTION: Writes the file returned by CabinetGetWriteError again, or drops it
+ * ARGUMENTS:
+ *     Retry = Whether to write the file again
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     The writer thread goes on with the next files unless the file
+ *     could not be written again.
+ */
+ULONG
+CabinetResolveWriteError(
+    IN PCABINET_CONTEXT CabinetContext,
+    IN BOOLEAN Retry)
+{
+    PCAB_WRITER Writer = CabinetContext->Writer;
+    PCAB_WRITE_JOB Job;
+    ULONG Status;
+
+    if (!Writer || !Writer->FailedJob)
+        return CAB_STATUS_SUCCESS;
+
+    /* The writer thread does not touch the failed file */
+    Job = Writer->FailedJob;
+    if (Retry)
+    {
+        Status = CabinetWriteFile(Job);
+        if (Status != CAB_STATUS_SUCCESS)
+        {
+            RtlEnterCriticalSection(&Writer->Lock);
+            Writer->Status = Status;
+            RtlLeaveCriticalSection(&Writer->Lock);
+            return Status;
+        }
+    }
+
+    RtlEnterCriticalSection(&Writer->Lock);
+    Writer->FailedJob = NULL;
+    Writer->Status = CAB_STATUS_SUCCESS;
+    Writer->PendingJobs--;
+    Writer->PendingBytes -= Job->File->FileSize;
+    RtlLeaveCriticalSection(&Writer->Lock);
+
+    RtlFreeHeap(ProcessHeap, 0, Job->Buffer);
+    RtlFreeHeap(ProcessHeap, 0, Job);
+
+    NtSetEvent(Writer->WorkEvent, NULL);
+    return CAB_STATUS_SUCCESS;
+}
+
+/*
+ * FUNCTION: Waits until the extracted files are written and stops the writer thread
+ * RETURNS:
+ *     Status of operation
+ * NOTES:
+ *     A file that could not be written and was not resolved is dropped.
+ */
+ULONG
+CabinetEndAsyncExtract(
+    IN PCABINET_CONTEXT CabinetContext)
+{
+    PCAB_WRITER Writer = CabinetContext->Writer;
+    ULONG Status;
+
+    if (!Writer)
+        return CAB_STATUS_SUCCESS;
+
+    RtlEnterCriticalSection(&Writer->Lock);
+    Writer->Stop = TRUE;
+    RtlLeaveCriticalSection(&Writer->Lock);
+
+    NtSetEvent(Writer->WorkEvent, NULL);
+    NtWaitForSingleObject(Writer->Thread, FALSE, NULL);
+
+    Status = Writer->Status;
+    if (Writer->FailedJob)
+    {
+        RtlFreeHeap(ProcessHeap, 0, Writer->FailedJob->Buffer);
+        RtlFreeHeap(ProcessHeap, 0, Writer->FailedJob);
+    }
+
+    NtClose(Writer->Thread);
+    NtClose(Writer->DoneEvent);
+    NtClose(Writer->WorkEvent);
+    RtlDeleteCriticalSection(&Writer->Lock);
+    RtlFreeHeap(ProcessHeap, 0, Writer);
+
+    CabinetContext->Writer = NULL;
+    return Status;
+}
+
 /*
  * FUNCTION: Extracts a file from the cabinet
  * ARGUMENTS:
@@ -953,28 +1581,20 @@ CabinetExtractFile(
     IN PCABINET_CONTEXT CabinetContext,
     IN PCAB_SEARCH Search)
 {
-    ULONG Size;                 // remaining file bytes to decompress
-    ULONG CurrentOffset;        // current uncompressed offset within the folder
-    PUCHAR CurrentBuffer;       // current pointer to compressed data in the block
-    LONG RemainingBlock;        // remaining comp data in the block
-    HANDLE DestFile;
-    HANDLE DestFileSection;
-    PVOID DestFileBuffer;       // mapped view of dest file
-    PVOID CurrentDestBuffer;    // pointer to the current position in the dest view
-    PCFDATA CFData;             // current data block
+    HANDLE DestFile = NULL;
+    HANDLE DestFileSection = NULL;
+    PVOID DestFileBuffer = NULL; // mapped view of dest file
+    PVOID CurrentDestBuffer;    // buffer receiving the uncompressed file
+    PCAB_WRITE_JOB Job = NULL;
     ULONG Status;
-    FILETIME FileTime;
     WCHAR DestName[MAX_PATH];
     NTSTATUS NtStatus;
     UNICODE_STRING UnicodeString;
     ANSI_STRING AnsiString;
     IO_STATUS_BLOCK IoStatusBlock;
     OBJECT_ATTRIBUTES ObjectAttributes;
-    FILE_BASIC_INFORMATION FileBasic;
     PCFFOLDER CurrentFolder;
     LARGE_INTEGER MaxDestFileSize;
-    LONG InputLength, OutputLength;
-    char Chunk[512];
 
     if (wcscmp(Search->Cabinet, CabinetContext->CabinetName) != 0)
     {
@@ -1036,7 +1656,28 @@ CabinetExtractFile(
         UnicodeString.Buffer = DestName + wcslen(DestName);
         UnicodeString.Length = 0;
         RtlAnsiStringToUnicodeString(&UnicodeString, &AnsiString, FALSE);
+    }
+
+    if (!CabinetContext->CreateFileHandler && CabinetContext->Writer)
+    {
+        /* Uncompress into memory, the writer thread creates the file */
+        Job = RtlAllocateHeap(ProcessHeap, 0, sizeof(CAB_WRITE_JOB));
+        if (!Job)
+            return CAB_STATUS_NOMEMORY;
+
+        Job->File = Search->File;
+        wcscpy(Job->DestName, DestName);
+        Job->Buffer = RtlAllocateHeap(ProcessHeap, 0, max(Search->File->FileSize, 1));
+        if (!Job->Buffer)
+        {
+            RtlFreeHeap(ProcessHeap, 0, Job);
+            return CAB_STATUS_NOMEMORY;
+        }
 
+        CurrentDestBuffer = Job->Buffer;
+    }
+    else if (!CabinetContext->CreateFileHandler)
+    {
         /* Create destination file, fail if it already exists */
         RtlInitUnicodeString(&UnicodeString, DestName);
 
@@ -1101,11 +1742,11 @@ CabinetExtractFile(
         if (!NT_SUCCESS(NtStatus))
         {
             DPRINT1("NtCreateSection failed for %ls: %x\n", DestName, NtStatus);
+            DestFileSection = NULL;
             Status = CAB_STATUS_NOMEMORY;
-            goto CloseDestFile;
+            goto Quit;
         }
 
-        DestFileBuffer = 0;
         CabinetContext->DestFileSize = 0;
         NtStatus = NtMapViewOfSection(DestFileSection,
                                       NtCurrentProcess(),
@@ -1119,159 +1760,48 @@ CabinetExtractFile(
         if (!NT_SUCCESS(NtStatus))
         {
             DPRINT1("NtMapViewOfSection failed: %x\n", NtStatus);
+            DestFileBuffer = NULL;
             Status = CAB_STATUS_NOMEMORY;
-            goto CloseDestFileSection;
+            goto Quit;
         }
 
         CurrentDestBuffer = DestFileBuffer;
-        if (!ConvertDosDateTimeToFileTime(Search->File->FileDate,
-                                          Search->File->FileTime,
-                                          &FileTime))
-        {
-            DPRINT1("DosDateTimeToFileTime() failed\n");
-            Status = CAB_STATUS_CANNOT_WRITE;
-            goto UnmapDestFile;
-        }
-
-        NtStatus = NtQueryInformationFile(DestFile,
-                                          &IoStatusBlock,
-                                          &FileBasic,
-                                          sizeof(FILE_BASIC_INFORMATION),
-                                          FileBasicInformation);
-        if (!NT_SUCCESS(NtStatus))
-        {
-            DPRINT("NtQueryInformationFile() failed (%x)\n", NtStatus);
-        }
-        else
-        {
-            memcpy(&FileBasic.LastAccessTime, &FileTime, sizeof(FILETIME));
-
-            NtStatus = NtSetInformationFile(DestFile,
-                                            &IoStatusBlock,
-                                            &FileBasic,
-                                            sizeof(FILE_BASIC_INFORMATION),
-                                            FileBasicInformation);
-            if (!NT_SUCCESS(NtStatus))
-            {
-                DPRINT("NtSetInformationFile() failed (%x)\n", NtStatus);
-            }
-        }
 
-        SetAttributesOnFile(Search->File, DestFile);
+        Status = SetFileInfo(Search->File, DestFile);
+        if (Status != CAB_STATUS_SUCCESS)
+            goto Quit;
     }
 
     /* Call extract event handler */
     if (CabinetContext->ExtractHandler != NULL)
         CabinetContext->ExtractHandler(CabinetContext, Search->File, DestName);
 
-    if (Search->CFData)
-        CFData = Search->CFData;
-    else
-        CFData = (PCFDATA)(CabinetContext->CabinetFolders[Search->File->FolderIndex].DataOffset + CabinetContext->FileBuffer);
-
-    CurrentOffset = Search->Offset;
-    while (CurrentOffset + CFData->UncompSize <= Search->File->FileOffset)
-    {
-        /* walk the data blocks until we reach
-           the one containing the start of the file */
-        CurrentOffset += CFData->UncompSize;
-        CFData = (PCFDATA)((char *)(CFData + 1) + CabinetContext->DataReserved + CFData->CompSize);
-    }
-
-    Search->CFData = CFData;
-    Search->Offset = CurrentOffset;
-
-    /* now decompress and discard any data in
-       the block before the start of the file */
-
-    /* start of comp data */
-    CurrentBuffer = ((unsigned char *)(CFData + 1)) + CabinetContext->DataReserved;
-    RemainingBlock = CFData->CompSize;
-    InputLength = RemainingBlock;
+    Status = CabinetReadFolder(CabinetContext,
+                               CurrentFolder,
+                               CurrentDestBuffer,
+                               Search->File->FileOffset,
+                               Search->File->FileSize);
 
-    while (CurrentOffset < Search->File->FileOffset)
+    if (Job)
     {
-        /* compute remaining uncomp bytes to start
-           of file, bounded by size of chunk */
-        OutputLength = Search->File->FileOffset - CurrentOffset;
-        if (OutputLength > (LONG)sizeof(Chunk))
-            OutputLength = sizeof(Chunk);
-
-        /* negate to signal NOT end of block */
-        OutputLength = -OutputLength;
-
-        CabinetContext->Codec->Uncompress(CabinetContext->Codec,
-                                          Chunk,
-                                          CurrentBuffer,
-                                          &InputLength,
-                                          &OutputLength);
-
-        /* add the uncomp bytes extracted to current folder offset */
-        CurrentOffset += OutputLength;
-        /* add comp bytes consumed to CurrentBuffer */
-        CurrentBuffer += InputLength;
-        /* subtract bytes consumed from bytes remaining in block */
-        RemainingBlock -= InputLength;
-        /* neg for resume decompression of the same block */
-        InputLength = -RemainingBlock;
-    }
-
-    /* now CurrentBuffer points to the first comp byte
-       of the file, so we can begin decompressing */
-
-    /* Size = remaining uncomp bytes of the file to decompress */
-    Size = Search->File->FileSize;
-    while (Size > 0)
-    {
-        OutputLength = Size;
-        DPRINT("Decompressing block at %x with RemainingBlock = %d, Size = %d\n",
-               CurrentBuffer, RemainingBlock, Size);
-
-        Status = CabinetContext->Codec->Uncompress(CabinetContext->Codec,
-                                                   CurrentDestBuffer,
-                                                   CurrentBuffer,
-                                                   &InputLength,
-                                                   &OutputLength);
-        if (Status != CS_SUCCESS)
-        {
-            DPRINT("Cannot uncompress block\n");
-            if (Status == CS_NOMEMORY)
-                Status = CAB_STATUS_NOMEMORY;
-            Status = CAB_STATUS_INVALID_CAB;
-            goto UnmapDestFile;
-        }
-
-        /* advance dest buffer by bytes produced */
-        CurrentDestBuffer = (PVOID)((ULONG_PTR)CurrentDestBuffer + OutputLength);
-        /* advance src buffer by bytes consumed */
-        CurrentBuffer += InputLength;
-        /* reduce remaining file bytes by bytes produced */
-        Size -= OutputLength;
-        /* reduce remaining block size by bytes consumed */
-        RemainingBlock -= InputLength;
-        if (Size > 0 && RemainingBlock == 0)
+        /* Hand the file over to the writer, it frees the job */
+        if (Status == CAB_STATUS_SUCCESS)
+            CabinetQueueWrite(CabinetContext->Writer, Job);
+        else
         {
-            /* used up this block, move on to the next */
-            DPRINT("Out of block data\n");
-            CFData = (PCFDATA)CurrentBuffer;
-            RemainingBlock = CFData->CompSize;
-            CurrentBuffer = (unsigned char *)(CFData + 1) + CabinetContext->DataReserved;
-            InputLength = RemainingBlock;
+            RtlFreeHeap(ProcessHeap, 0, Job->Buffer);
+            RtlFreeHeap(ProcessHeap, 0, Job);
         }
     }
 
-    Status = CAB_STATUS_SUCCESS;
-
-UnmapDestFile:
-    if (!CabinetContext->CreateFileHandler)
+Quit:
+    if (DestFileBuffer)
         NtUnmapViewOfSection(NtCurrentProcess(), DestFileBuffer);
 
-CloseDestFileSection:
-    if (!CabinetContext->CreateFileHandler)
+    if (DestFileSection)
         NtClose(DestFileSection);
 
-CloseDestFile:
-    if (!CabinetContext->CreateFileHandler)
+    if (DestFile)
         NtClose(DestFile);
 
     return Status;
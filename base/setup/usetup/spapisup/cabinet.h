@@ -15,6 +15,7 @@ typedef struct _CFFILE *PCFFILE;
 typedef struct _CFDATA *PCFDATA;
 
 struct _CABINET_CONTEXT;
+typedef struct _CAB_WRITER *PCAB_WRITER;
 
 
 /* Constants */
@@ -77,8 +78,6 @@ typedef struct _CAB_SEARCH
     WCHAR        Cabinet[MAX_PATH];
     USHORT       Index;
     PCFFILE      File;              // Pointer to current CFFILE
-    PCFDATA      CFData;
-    ULONG        Offset;
 } CAB_SEARCH, *PCAB_SEARCH;
 
 typedef struct _CABINET_CONTEXT
@@ -111,6 +110,13 @@ typedef struct _CABINET_CONTEXT
     PCABINET_DISK_CHANGE DiskChangeHandler;
     PCABINET_CREATE_FILE CreateFileHandler;
     PVOID CabinetReservedArea;
+    PUCHAR BlockBuffer;             // Uncompressed data of the current block
+    PCFFOLDER BlockFolder;          // Folder of the current block
+    PCFDATA BlockCFData;            // Current data block, NULL if none
+    ULONG BlockIndex;               // Index of the current block in its folder
+    ULONG BlockOffset;              // Uncompressed offset of the current block in its folder
+    BOOL BlockDecoded;              // The current block is in BlockBuffer
+    PCAB_WRITER Writer;             // Writer thread, NULL if files are written right away
 } CABINET_CONTEXT, *PCABINET_CONTEXT;
 
 
@@ -196,6 +202,29 @@ CabinetExtractFile(
     IN PCABINET_CONTEXT CabinetContext,
     IN PCAB_SEARCH Search);
 
+/* Hands the extracted files over to a writer thread */
+ULONG
+CabinetBeginAsyncExtract(
+    IN PCABINET_CONTEXT CabinetContext);
+
+/* Returns the file the writer thread could not write */
+ULONG
+CabinetGetWriteError(
+    IN PCABINET_CONTEXT CabinetContext,
+    IN BOOLEAN Wait,
+    OUT PCWSTR *DestName);
+
+/* Writes the file that could not be written again, or drops it */
+ULONG
+CabinetResolveWriteError(
+    IN PCABINET_CONTEXT CabinetContext,
+    IN BOOLEAN Retry);
+
+/* Waits until all extracted files are written and stops the writer thread */
+ULONG
+CabinetEndAsyncExtract(
+    IN PCABINET_CONTEXT CabinetContext);
+
 /* Select codec engine to use */
 VOID
 CabinetSelectCodec(
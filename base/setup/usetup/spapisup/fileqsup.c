@@ -65,6 +65,78 @@ typedef struct _FILEQUEUEHEADER
 
 /* SETUP* API COMPATIBILITY FUNCTIONS ****************************************/
 
+static NTSTATUS
+SetupCloseCabinet(
+    IN OUT PFILEQUEUEHEADER QueueHeader)
+{
+    ULONG CabStatus;
+
+    if (!QueueHeader->HasCurrentCabinet)
+        return STATUS_SUCCESS;
+
+    /* Wait for the files still being written */
+    CabStatus = CabinetEndAsyncExtract(&QueueHeader->CabinetContext);
+    if (CabStatus != CAB_STATUS_SUCCESS)
+        DPRINT1("Cannot write the files from cabinet %S (%d)\n", QueueHeader->CurrentCabinetName, CabStatus);
+
+    QueueHeader->HasCurrentCabinet = FALSE;
+    CabinetCleanup(&QueueHeader->CabinetContext);
+
+    return (CabStatus == CAB_STATUS_SUCCESS) ? STATUS_SUCCESS : STATUS_UNSUCCESSFUL;
+}
+
+/*
+ * Reports the files of the current cabinet that the writer thread could not
+ * write. They show up only after later files were extracted, so they are
+ * reported against the file that failed, not the one being copied.
+ */
+static BOOLEAN
+SetupReportWriteErrors(
+    IN OUT PFILEQUEUEHEADER QueueHeader,
+    IN BOOLEAN Wait,
+    IN PSP_FILE_CALLBACK_W MsgHandler,
+    IN PVOID Context OPTIONAL)
+{
+    FILEPATHS_W FilePathInfo;
+    PCWSTR DestName;
+    ULONG CabStatus;
+    UINT Result;
+
+    if (!QueueHeader->HasCurrentCabinet)
+        return TRUE;
+
+    for (;;)
+    {
+        CabStatus = CabinetGetWriteError(&QueueHeader->CabinetContext, Wait, &DestName);
+        if (CabStatus == CAB_STATUS_SUCCESS)
+            return TRUE;
+
+        DPRINT1("Cannot write file %S (%d)\n", DestName, CabStatus);
+
+        FilePathInfo.Target = DestName;
+        FilePathInfo.Source = QueueHeader->CurrentCabinetName;
+        FilePathInfo.Win32Error = (UINT)STATUS_UNSUCCESSFUL;
+        FilePathInfo.Flags = 0; // FIXME: Unused yet...
+
+        Result = MsgHandler(Context,
+                            SPFILENOTIFY_COPYERROR,
+                            (UINT_PTR)&FilePathInfo,
+                            (UINT_PTR)NULL); // FIXME: Unused yet...
+        if (Result == FILEOP_RETRY || Result == FILEOP_NEWPATH)
+        {
+            /* Write it again, a new failure is reported in the next round */
+            CabinetResolveWriteError(&QueueHeader->CabinetContext, TRUE);
+        }
+        else
+        {
+            /* Drop the file, and stop unless it is skipped */
+            CabinetResolveWriteError(&QueueHeader->CabinetContext, FALSE);
+            if (Result != FILEOP_SKIP)
+                return FALSE;
+        }
+    }
+}
+
 static NTSTATUS
 SetupExtractFile(
     IN OUT PFILEQUEUEHEADER QueueHeader,
@@ -105,11 +177,8 @@ SetupExtractFile(
     {
         DPRINT("Using new cabinet\n");
 
-        if (QueueHeader->HasCurrentCabinet)
-        {
-            QueueHeader->HasCurrentCabinet = FALSE;
-            CabinetCleanup(&QueueHeader->CabinetContext);
-        }
+        if (!NT_SUCCESS(SetupCloseCabinet(QueueHeader)))
+            return STATUS_UNSUCCESSFUL;
 
         RtlStringCchCopyW(QueueHeader->CurrentCabinetName,
                           ARRAYSIZE(QueueHeader->CurrentCabinetName),
@@ -125,6 +194,11 @@ SetupExtractFile(
         {
             DPRINT("Opened cabinet %S\n", CabinetFileName /*CabinetGetCabinetName(&QueueHeader->CabinetContext)*/);
             QueueHeader->HasCurrentCabinet = TRUE;
+
+            /* Let a writer thread write the files while we uncompress the next ones */
+            CabStatus = CabinetBeginAsyncExtract(&QueueHeader->CabinetContext);
+            if (CabStatus != CAB_STATUS_SUCCESS)
+                DPRINT1("Extracting synchronously (%d)\n", CabStatus);
         }
         else
         {
@@ -226,6 +300,9 @@ SetupCloseFileQueue(
 
     QueueHeader = (PFILEQUEUEHEADER)QueueHandle;
 
+    /* Close the last cabinet used */
+    SetupCloseCabinet(QueueHeader);
+
     /* Delete the delete queue */
     while (!IsListEmpty(&QueueHeader->DeleteQueue))
     {
@@ -629,6 +706,7 @@ SetupCommitFileQueueW(
     FILEPATHS_W FilePathInfo;
     WCHAR FileSrcPath[MAX_PATH];
     WCHAR FileDstPath[MAX_PATH];
+    LARGE_INTEGER StartTime, EndTime;
 
     if (QueueHandle == NULL)
         return FALSE;
@@ -849,6 +927,8 @@ EndRename:
         }
     }
 
+    NtQuerySystemTime(&StartTime);
+
     for (ListEntry = QueueHeader->CopyQueue.Flink;
          ListEntry != &QueueHeader->CopyQueue;
          ListEntry = ListEntry->Flink)
@@ -897,6 +977,18 @@ EndRename:
 
         DPRINT(" -----> " "Copy: '%S' ==> '%S'\n", FileSrcPath, FileDstPath);
 
+        /* Report the files of the previous cabinet that could not be written */
+        if (QueueHeader->HasCurrentCabinet &&
+            (Entry->SourceCabinet == NULL ||
+             wcscmp(FileSrcPath, QueueHeader->CurrentCabinetName) != 0))
+        {
+            if (!SetupReportWriteErrors(QueueHeader, TRUE, MsgHandler, Context))
+            {
+                Success = FALSE;
+                goto Quit;
+            }
+        }
+
         //
         // Technically, here we should create the target directory,
         // if it does not already exist... before calling the handler!
@@ -932,6 +1024,13 @@ RetryCopy:
                                       FileSrcPath, // Specifies the cabinet path
                                       Entry->SourceFileName,
                                       Entry->TargetDirectory);
+
+            /* Report the earlier files that could not be written meanwhile */
+            if (!SetupReportWriteErrors(QueueHeader, FALSE, MsgHandler, Context))
+            {
+                Success = FALSE;
+                goto EndCopy;
+            }
         }
         else
         {
@@ -973,6 +1072,18 @@ EndCopy:
             goto Quit;
     }
 
+    /* The copy is only done once the extracted files are all written */
+    if (!SetupReportWriteErrors(QueueHeader, TRUE, MsgHandler, Context) ||
+        !NT_SUCCESS(SetupCloseCabinet(QueueHeader)))
+    {
+        Success = FALSE;
+        goto Quit;
+    }
+
+    NtQuerySystemTime(&EndTime);
+    DPRINT1("Copied %lu files in %lu ms\n", QueueHeader->CopyCount,
+            (ULONG)((EndTime.QuadPart - StartTime.QuadPart) / 10000));
+
     if (!IsListEmpty(&QueueHeader->CopyQueue))
     {
         MsgHandler(Context,
@@ -983,6 +1094,8 @@ EndCopy:
 
 
 Quit:
+    SetupCloseCabinet(QueueHeader);
+
     /* All the queues have been committed */
     MsgHandler(Context,
                SPFILENOTIFY_ENDQUEUE,
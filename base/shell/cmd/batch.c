@@ -75,6 +75,12 @@ BOOL bEcho = TRUE;  /* The echo flag */
 /* Buffer for reading Batch file lines */
 TCHAR textline[BATCH_BUFFSIZE];
 
+/* Expanded lines read while parsing a batch command, for the command cache */
+static BOOL   bRecordLines = FALSE;
+static LPTSTR RecordText = NULL;
+static SIZE_T RecordLength = 0;
+static SIZE_T RecordSize = 0;
+
 
 /*
  * Returns a pointer to the n'th parameter of the current batch file.
@@ -193,6 +199,81 @@ BatchParams(
     return TRUE;
 }
 
+/*
+ * Release a command of the batch command cache, freeing it
+ * when it is neither in the cache nor executed anymore.
+ */
+static VOID ReleaseBatchCommand(PBATCH_CACHE_ENTRY entry)
+{
+    if (--entry->refcount == 0)
+    {
+        FreeCommand(entry->cmd);
+        cmd_free(entry);
+    }
+}
+
+/*
+ * Remove a command from the batch command cache, before it gets changed.
+ */
+static VOID UncacheBatchCommand(PARSED_COMMAND *Cmd)
+{
+    PBATCH_CACHE_ENTRY entry, *link;
+    UINT i;
+
+    if (!bc->cache)
+        return;
+
+    for (i = 0; i < BATCH_CACHE_BUCKETS; i++)
+    {
+        for (link = &bc->cache[i]; (entry = *link) != NULL; link = &entry->next)
+        {
+            if (entry->cmd == Cmd)
+            {
+                *link = entry->next;
+                ReleaseBatchCommand(entry);
+                return;
+            }
+        }
+    }
+}
+
+static VOID FreeBatchCache(VOID)
+{
+    PBATCH_CACHE_ENTRY entry;
+    UINT i;
+
+    if (!bc->cache)
+        return;
+
+    /* The commands being executed are freed once they complete */
+    for (i = 0; i < BATCH_CACHE_BUCKETS; i++)
+    {
+        while ((entry = bc->cache[i]) != NULL)
+        {
+            bc->cache[i] = entry->next;
+            ReleaseBatchCommand(entry);
+        }
+    }
+
+    cmd_free(bc->cache);
+    bc->cache = NULL;
+}
+
+static VOID FreeBatchLabels(VOID)
+{
+    DWORD i;
+
+    for (i = 0; i < bc->labelcount; i++)
+        cmd_free(bc->labels[i].name);
+
+    if (bc->labels)
+        cmd_free(bc->labels);
+
+    bc->labels = NULL;
+    bc->labelcount = 0;
+    bc->labelcp = 0;
+}
+
 /*
  * Free the allocated memory of a batch file.
  */
@@ -203,6 +284,13 @@ static VOID ClearBatch(VOID)
     if (bc->mem && bc->memfree)
         cmd_free(bc->mem);
 
+    /* The label index and the command cache go with the file contents */
+    if (bc->memfree)
+    {
+        FreeBatchLabels();
+        FreeBatchCache();
+    }
+
     if (bc->raw_params)
         cmd_free(bc->raw_params);
 
@@ -250,6 +338,11 @@ VOID ExitBatch(VOID)
         CheckCtrlBreak(BREAK_OUTOFBATCH);
         BatType = NONE;
 
+        if (RecordText)
+            cmd_free(RecordText);
+        RecordText = NULL;
+        RecordSize = 0;
+
 #ifdef MSCMD_BATCH_ECHO
         bEcho = bBcEcho;
 #endif
@@ -265,6 +358,96 @@ VOID ExitAllBatches(VOID)
         ExitBatch();
 }
 
+/*
+ * Build the index of the labels of the batch file, reading it
+ * the same way GOTO does, so that it finds the same labels.
+ * Without an index, GOTO scans the file instead.
+ */
+static VOID BuildLabelIndex(VOID)
+{
+    PBATCH_LABEL labels = NULL, newlabels;
+    DWORD count = 0, size = 0;
+    DWORD start;
+    LPTSTR label;
+    BOOL bSuccess = TRUE;
+
+    bc->mempos = 0;
+    for (start = 0; BatchGetString(textline, ARRAYSIZE(textline)); start = bc->mempos)
+    {
+        label = GetBatchLabel(textline);
+        if (!label)
+            continue;
+
+        if (count == size)
+        {
+            size = (size ? size * 2 : 16);
+            newlabels = cmd_realloc(labels, size * sizeof(BATCH_LABEL));
+            if (!newlabels)
+            {
+                bSuccess = FALSE;
+                break;
+            }
+            labels = newlabels;
+        }
+
+        labels[count].name = cmd_dup(label);
+        if (!labels[count].name)
+        {
+            bSuccess = FALSE;
+            break;
+        }
+        labels[count].start = start;
+        labels[count].end = bc->mempos;
+        ++count;
+    }
+
+    bc->labels = labels;
+    bc->labelcount = count;
+
+    /* The index is only usable if the whole file could be read */
+    if (!bSuccess || (bc->mempos < bc->memsize))
+    {
+        WARN("Cannot build the label index!\n");
+        FreeBatchLabels();
+    }
+    else
+    {
+        /* The names depend on the code page the file was read with */
+        bc->labelcp = OutputCodePage;
+    }
+}
+
+/*
+ * Find a label like GOTO does when scanning the batch file: first from
+ * the given position up to the end of the file, then from the beginning
+ * of the file up to that position. Return the position following it.
+ */
+BOOL FindBatchLabel(LPCTSTR label, DWORD pos, LPDWORD newpos)
+{
+    DWORD i;
+
+    for (i = 0; i < bc->labelcount; i++)
+    {
+        if (bc->labels[i].start >= pos &&
+            _tcsicmp(bc->labels[i].name, label) == 0)
+        {
+            *newpos = bc->labels[i].end;
+            return TRUE;
+        }
+    }
+
+    for (i = 0; i < bc->labelcount && bc->labels[i].end < pos; i++)
+    {
+        if (_tcsicmp(bc->labels[i].name, label) == 0)
+        {
+            *newpos = bc->labels[i].end;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 /*
  * Load batch file into memory.
  */
@@ -283,15 +466,134 @@ static void BatchFile2Mem(HANDLE hBatchFile)
         ReadFile(hBatchFile, (LPVOID)bc->mem, bc->memsize,  &bc->memsize, NULL);
         bc->mem[bc->memsize]='\0';  /* end this, so you can dump it as a string */
         bc->memfree=TRUE;           /* this one needs to be freed */
+
+        /* The command cache is optional, commands are parsed anyway */
+        bc->cache = cmd_alloc(BATCH_CACHE_BUCKETS * sizeof(PBATCH_CACHE_ENTRY));
+        if (bc->cache)
+            ZeroMemory(bc->cache, BATCH_CACHE_BUCKETS * sizeof(PBATCH_CACHE_ENTRY));
+
+        bc->labels = NULL;
+        bc->labelcount = 0;
+        bc->labelcp = 0;
+        BuildLabelIndex();
     }
     else
     {
         bc->memsize=0;              /* this will prevent mem being accessed */
         bc->memfree=FALSE;
+        bc->labels = NULL;
+        bc->labelcount = 0;
+        bc->labelcp = 0;
+        bc->cache = NULL;
     }
     bc->mempos = 0;                 /* set position to the start */
 }
 
+/*
+ * Parse the next command of the current batch file. The command parsed
+ * the last time from the same position is reused, if its lines expand
+ * to the same text again. Otherwise the new command replaces it.
+ *
+ * A cached command is returned with its cache entry, and must be
+ * released with ReleaseBatchCommand() instead of being freed.
+ */
+static PARSED_COMMAND*
+ParseBatchCommand(
+    OUT PBATCH_CACHE_ENTRY* CacheEntry)
+{
+    PBATCH_CONTEXT Context = bc;
+    PBATCH_CACHE_ENTRY Entry, NewEntry, *Link;
+    PARSED_COMMAND *Cmd;
+    DWORD Start = bc->mempos;
+    LPCTSTR Text;
+    BOOL bMore;
+
+    *CacheEntry = NULL;
+
+    if (!bc->cache)
+        return ParseCommand(NULL);
+
+    for (Link = &bc->cache[Start % BATCH_CACHE_BUCKETS]; *Link; Link = &(*Link)->next)
+    {
+        if ((*Link)->start == Start)
+            break;
+    }
+    Entry = *Link;
+
+    /*
+     * Executing a command stores state in its tree, so it cannot be
+     * reused while it is still executed, e.g. by a recursive CALL.
+     */
+    if (Entry && (Entry->refcount == 1) && (Entry->extensions == bEnableExtensions))
+    {
+        /* Read and expand its lines as the parser does, and compare them */
+        Text = Entry->text;
+        for (bMore = FALSE; Text < Entry->text + Entry->textlen; bMore = TRUE)
+        {
+            if (!ReadLine(ParseLine, bMore))
+            {
+                /* The parser fails this way when reading more lines */
+                if (bMore)
+                    bParseError = TRUE;
+                return NULL;
+            }
+
+            if (_tcscmp(ParseLine, Text) != 0)
+                break;
+            Text += _tcslen(Text) + 1;
+        }
+
+        if (Text == Entry->text + Entry->textlen)
+        {
+            ASSERT(bc->mempos == Entry->end);
+
+            bParseError = FALSE;
+            bIgnoreEcho = FALSE;
+
+            ++Entry->refcount;
+            *CacheEntry = Entry;
+            return Entry->cmd;
+        }
+
+        /* Go back to the first line and parse it again */
+        bc->mempos = Start;
+    }
+
+    RecordLength = 0;
+    bRecordLines = TRUE;
+    Cmd = ParseCommand(NULL);
+
+    /* Do not cache anything if the batch file has been left, or if the
+     * lines could not be recorded */
+    if (!Cmd || !bRecordLines || (bc != Context))
+    {
+        bRecordLines = FALSE;
+        return Cmd;
+    }
+    bRecordLines = FALSE;
+
+    NewEntry = cmd_alloc(FIELD_OFFSET(BATCH_CACHE_ENTRY, text[RecordLength]));
+    if (!NewEntry)
+        return Cmd;
+
+    NewEntry->start = Start;
+    NewEntry->end = bc->mempos;
+    NewEntry->refcount = 2;
+    NewEntry->extensions = bEnableExtensions;
+    NewEntry->cmd = Cmd;
+    NewEntry->textlen = RecordLength;
+    memcpy(NewEntry->text, RecordText, RecordLength * sizeof(TCHAR));
+
+    /* Replace the command previously parsed from this position */
+    NewEntry->next = (Entry ? Entry->next : NULL);
+    *Link = NewEntry;
+    if (Entry)
+        ReleaseBatchCommand(Entry);
+
+    *CacheEntry = NewEntry;
+    return Cmd;
+}
+
 /*
  * Start batch file execution.
  *
@@ -306,6 +608,7 @@ INT Batch(LPTSTR fullname, LPTSTR firstword, LPTSTR param, PARSED_COMMAND *Cmd)
     BOOLEAN bTopLevel;
     BATCH_CONTEXT new;
     PFOR_CONTEXT saved_fc;
+    PBATCH_CACHE_ENTRY CacheEntry;
 
     SetLastError(0);
     if (bc && bc->mem)
@@ -340,7 +643,9 @@ INT Batch(LPTSTR fullname, LPTSTR firstword, LPTSTR param, PARSED_COMMAND *Cmd)
 
     if (bc != NULL && Cmd == bc->current)
     {
-        /* Then we are transferring to another batch */
+        /* Then we are transferring to another batch. The command loses
+         * its redirections, so it must not be reused from the cache. */
+        UncacheBatchCommand(Cmd);
         ClearBatch();
         AddBatchRedirection(&Cmd->Redirections);
     }
@@ -376,6 +681,10 @@ INT Batch(LPTSTR fullname, LPTSTR firstword, LPTSTR param, PARSED_COMMAND *Cmd)
             new.memsize = bc->memsize;
             new.mempos  = 0;
             new.memfree = FALSE;    /* don't free this, being used before this */
+            new.labels     = bc->labels;
+            new.labelcount = bc->labelcount;
+            new.labelcp    = bc->labelcp;
+            new.cache      = bc->cache;
         }
         bc = &new;
         bc->RedirList = NULL;
@@ -453,7 +762,7 @@ INT Batch(LPTSTR fullname, LPTSTR firstword, LPTSTR param, PARSED_COMMAND *Cmd)
      * until this batch file has completed. */
     while (bc == &new && !bExit)
     {
-        Cmd = ParseCommand(NULL);
+        Cmd = ParseBatchCommand(&CacheEntry);
         if (!Cmd)
         {
             if (!bParseError)
@@ -478,7 +787,10 @@ INT Batch(LPTSTR fullname, LPTSTR firstword, LPTSTR param, PARSED_COMMAND *Cmd)
         /* Echo the command and execute it */
         bc->current = Cmd;
         ret = ExecuteCommandWithEcho(Cmd);
-        FreeCommand(Cmd);
+        if (CacheEntry)
+            ReleaseBatchCommand(CacheEntry);
+        else
+            FreeCommand(Cmd);
     }
     if (bExit)
     {
@@ -570,6 +882,35 @@ BOOL BatchGetString(LPTSTR lpBuffer, INT nBufferLength)
     return TRUE;
 }
 
+/*
+ * Record an expanded batch file line read by the parser,
+ * for caching the command it is part of.
+ */
+VOID RecordBatchLine(LPCTSTR line)
+{
+    SIZE_T len = _tcslen(line) + 1;
+    LPTSTR newtext;
+
+    if (!bRecordLines)
+        return;
+
+    if (RecordLength + len > RecordSize)
+    {
+        newtext = cmd_realloc(RecordText, (RecordLength + len + CMDLINE_LENGTH) * sizeof(TCHAR));
+        if (!newtext)
+        {
+            /* Just do not cache the command */
+            bRecordLines = FALSE;
+            return;
+        }
+        RecordText = newtext;
+        RecordSize = RecordLength + len + CMDLINE_LENGTH;
+    }
+
+    memcpy(RecordText + RecordLength, line, len * sizeof(TCHAR));
+    RecordLength += len;
+}
+
 /*
  * Read and return the next executable line form the current batch file
  *
@@ -23,6 +23,33 @@ typedef enum _BATCH_TYPE
 /* Enable this define for Windows' CMD batch-echo behaviour compatibility */
 #define MSCMD_BATCH_ECHO
 
+/* A label of a batch file, as found by GOTO when scanning the file */
+typedef struct _BATCH_LABEL
+{
+    DWORD   start;      /* position of the line holding the label */
+    DWORD   end;        /* position of the line following it */
+    LPTSTR  name;
+} BATCH_LABEL, *PBATCH_LABEL;
+
+/*
+ * A command parsed from a batch file, kept for when execution comes back
+ * to the same position. It is only reused if its lines expand to the same
+ * text again, and if it is not being executed already.
+ */
+typedef struct _BATCH_CACHE_ENTRY
+{
+    struct _BATCH_CACHE_ENTRY *next;
+    DWORD   start;      /* position of the first line of the command */
+    DWORD   end;        /* position following its last line */
+    LONG    refcount;   /* one for the cache, one for each execution */
+    BOOL    extensions; /* bEnableExtensions when it was parsed */
+    PARSED_COMMAND *cmd;
+    SIZE_T  textlen;
+    TCHAR   text[];     /* the expanded lines, NUL-separated */
+} BATCH_CACHE_ENTRY, *PBATCH_CACHE_ENTRY;
+
+#define BATCH_CACHE_BUCKETS 64
+
 typedef struct _BATCH_CONTEXT
 {
     struct _BATCH_CONTEXT *prev;
@@ -30,6 +57,10 @@ typedef struct _BATCH_CONTEXT
     DWORD   memsize;    /* size of batchfile */
     DWORD   mempos;     /* current position to read from */
     BOOL    memfree;    /* true if it need to be freed when exitbatch is called */	
+    PBATCH_LABEL labels; /* index of the labels of the batchfile, freed with mem */
+    DWORD   labelcount;
+    UINT    labelcp;    /* code page of the label names, 0 if there is no index */
+    PBATCH_CACHE_ENTRY *cache; /* parsed commands by position, freed with mem */
     TCHAR BatchFilePath[MAX_PATH];
     LPTSTR params;
     LPTSTR raw_params;  /* Holds the raw params given by the input */
@@ -81,4 +112,6 @@ VOID   ExitAllBatches(VOID);
 INT    Batch(LPTSTR, LPTSTR, LPTSTR, PARSED_COMMAND *);
 BOOL   BatchGetString(LPTSTR lpBuffer, INT nBufferLength);
 LPTSTR ReadBatchLine(VOID);
+VOID   RecordBatchLine(LPCTSTR);
+BOOL   FindBatchLabel(LPCTSTR, DWORD, LPDWORD);
 VOID   AddBatchRedirection(REDIRECTION **);
@@ -1761,6 +1761,13 @@ ReadLine(TCHAR *commandline, BOOL bMore)
         ip = ReadBatchLine();
         if (!ip)
             return FALSE;
+
+        if (!SubstituteVars(ip, commandline, _T('%')))
+            return FALSE;
+
+        /* Remember the expanded line for the batch command cache */
+        RecordBatchLine(commandline);
+        return TRUE;
     }
 
     return SubstituteVars(ip, commandline, _T('%'));
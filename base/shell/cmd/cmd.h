@@ -243,6 +243,7 @@ INT ExecuteFor(struct _PARSED_COMMAND *Cmd);
 INT CommandFree (LPTSTR);
 
 /* Prototypes for GOTO.C */
+LPTSTR GetBatchLabel(LPTSTR);
 INT cmd_goto (LPTSTR);
 
 /* Prototypes for HISTORY.C */
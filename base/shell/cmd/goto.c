@@ -28,6 +28,59 @@
 
 #include "precomp.h"
 
+/*
+ * Check whether a line read from a batch file holds a label.
+ * If so, return the label, terminated in place in the line.
+ */
+LPTSTR GetBatchLabel(LPTSTR line)
+{
+    LPTSTR label, tmp;
+
+    label = line;
+
+    /* A bug in Windows' CMD makes it always ignore the
+     * first character of the line, unless it's a colon. */
+    if (*label != _T(':'))
+        ++label;
+
+    /* Strip any leading whitespace */
+    while (_istspace(*label))
+        ++label;
+
+    /* If this is not a label, there is nothing to return */
+    if (*label != _T(':'))
+        return NULL;
+
+    /* Skip the first colon or plus sign */
+#if 0
+    if (*label == _T(':') || *label == _T('+'))
+        ++label;
+#endif
+    ++label;
+    /* Strip any whitespace between the colon and the label */
+    while (_istspace(*label))
+        ++label;
+    /* Terminate the label at the first delimiter character */
+    tmp = label;
+    while (!_istcntrl(*tmp) && !_istspace(*tmp) &&
+           !_tcschr(_T(":+"), *tmp) && !_tcschr(STANDARD_SEPS, *tmp) &&
+           !_tcschr(_T("&|<>"), *tmp))
+    {
+        /* Support the escape caret */
+        if (*tmp == _T('^'))
+        {
+            /* Move the buffer back one character */
+            memmove(tmp, tmp + 1, (_tcslen(tmp + 1) + 1) * sizeof(TCHAR));
+            /* We will ignore the new character */
+        }
+
+        ++tmp;
+    }
+    *tmp = _T('\0');
+
+    return label;
+}
+
 /*
  * Perform GOTO command.
  *
@@ -110,6 +163,17 @@ INT cmd_goto(LPTSTR param)
     if (!*param)
         goto NotFound;
 
+    /* Look the label up in the index of the batch file, when we have one */
+    if (bc->labelcp != 0 && bc->labelcp == OutputCodePage)
+    {
+        if (!FindBatchLabel(param, bc->mempos, &bc->mempos))
+            goto NotFound;
+
+        /* Do not process any more parts of a compound command */
+        bc->current = NULL;
+        return 0;
+    }
+
     /*
      * Search the next label starting our position, until the end of the file.
      * If none has been found, restart at the beginning of the file, and continue
@@ -130,48 +194,10 @@ retry:
             continue;
 #endif
 
-        label = textline;
-
-        /* A bug in Windows' CMD makes it always ignore the
-         * first character of the line, unless it's a colon. */
-        if (*label != _T(':'))
-            ++label;
-
-        /* Strip any leading whitespace */
-        while (_istspace(*label))
-            ++label;
-
-        /* If this is not a label, continue searching */
-        if (*label != _T(':'))
+        label = GetBatchLabel(textline);
+        if (!label)
             continue;
 
-        /* Skip the first colon or plus sign */
-#if 0
-        if (*label == _T(':') || *label == _T('+'))
-            ++label;
-#endif
-        ++label;
-        /* Strip any whitespace between the colon and the label */
-        while (_istspace(*label))
-            ++label;
-        /* Terminate the label at the first delimiter character */
-        tmp = label;
-        while (!_istcntrl(*tmp) && !_istspace(*tmp) &&
-               !_tcschr(_T(":+"), *tmp) && !_tcschr(STANDARD_SEPS, *tmp) &&
-               !_tcschr(_T("&|<>"), *tmp))
-        {
-            /* Support the escape caret */
-            if (*tmp == _T('^'))
-            {
-                /* Move the buffer back one character */
-                memmove(tmp, tmp + 1, (_tcslen(tmp + 1) + 1) * sizeof(TCHAR));
-                /* We will ignore the new character */
-            }
-
-            ++tmp;
-        }
-        *tmp = _T('\0');
-
         /* Jump if the labels are identical */
         if (_tcsicmp(label, param) == 0)
         {
@@ -23,6 +23,8 @@
 #define TAG_CACHE_DATA 'DcaC'
 #define TAG_CACHE_BLOCK 'BcaC'
 
+#define CACHE_HASH_SIZE 64        // Number of block hash buckets, must be a power of 2
+
 ///////////////////////////////////////////////////////////////////////////////////////
 //
 // This structure describes a cached block element. The disk is divided up into
@@ -35,6 +37,7 @@
 typedef struct
 {
     LIST_ENTRY    ListEntry;                    // Doubly linked list synchronization member
+    LIST_ENTRY    HashListEntry;                // Link in the drive's block hash bucket
 
     ULONG            BlockNumber;                // Track index for CHS, 64k block index for LBA
     BOOLEAN        LockedInCache;                // Indicates that this block is locked in cache memory
@@ -57,7 +60,8 @@ typedef struct
     ULONG            BytesPerSector;
 
     ULONG            BlockSize;            // Block size (in sectors)
-    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures
+    LIST_ENTRY        CacheBlockHead;            // Contains CACHE_BLOCK structures, most recently used first
+    LIST_ENTRY        CacheBlockHash[CACHE_HASH_SIZE];    // Same blocks, hashed by block number
 
 } CACHE_DRIVE, *PCACHE_DRIVE;
 
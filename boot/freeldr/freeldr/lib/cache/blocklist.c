@@ -36,13 +36,17 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     if (CacheBlock != NULL)
     {
         TRACE("Cache hit! BlockNumber: %d CacheBlock->BlockNumber: %d\n", BlockNumber, CacheBlock->BlockNumber);
-
-        return CacheBlock;
     }
+    else
+    {
+        TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
 
-    TRACE("Cache miss! BlockNumber: %d\n", BlockNumber);
-
-    CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
+        CacheBlock = CacheInternalAddBlockToCache(CacheDrive, BlockNumber);
+        if (CacheBlock == NULL)
+        {
+            return NULL;
+        }
+    }
 
     // Optimize the block list so it has a LRU structure
     CacheInternalOptimizeBlockList(CacheDrive, CacheBlock);
@@ -50,38 +54,38 @@ PCACHE_BLOCK CacheInternalGetBlockPointer(PCACHE_DRIVE CacheDrive, ULONG BlockNu
     return CacheBlock;
 }
 
+static PLIST_ENTRY CacheInternalGetHashBucket(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
+{
+    return &CacheDrive->CacheBlockHash[BlockNumber & (CACHE_HASH_SIZE - 1)];
+}
+
 PCACHE_BLOCK CacheInternalFindBlock(PCACHE_DRIVE CacheDrive, ULONG BlockNumber)
 {
-    PCACHE_BLOCK    CacheBlock = NULL;
+    PCACHE_BLOCK    CacheBlock;
+    PLIST_ENTRY     HashBucket;
+    PLIST_ENTRY     Entry;
 
     TRACE("CacheInternalFindBlock() BlockNumber = %d\n", BlockNumber);
 
     //
-    // Make sure the block list has entries before I start searching it.
+    // Only search the blocks hashed to the same bucket
     //
-    if (!IsListEmpty(&CacheDrive->CacheBlockHead))
+    HashBucket = CacheInternalGetHashBucket(CacheDrive, BlockNumber);
+    for (Entry = HashBucket->Flink; Entry != HashBucket; Entry = Entry->Flink)
     {
+        CacheBlock = CONTAINING_RECORD(Entry, CACHE_BLOCK, HashListEntry);
+
         //
-        // Search the list and find the BIOS drive number
+        // We found the block, so return it
         //
-        CacheBlock = CONTAINING_RECORD(CacheDrive->CacheBlockHead.Flink, CACHE_BLOCK, ListEntry);
-
-        while (&CacheBlock->ListEntry != &CacheDrive->CacheBlockHead)
+        if (CacheBlock->BlockNumber == BlockNumber)
         {
             //
-            // We found the block, so return it
+            // Increment the blocks access count
             //
-            if (CacheBlock->BlockNumber == BlockNumber)
-            {
-                //
-                // Increment the blocks access count
-                //
-                CacheBlock->AccessCount++;
-
-                return CacheBlock;
-            }
+            CacheBlock->AccessCount++;
 
-            CacheBlock = CONTAINING_RECORD(CacheBlock->ListEntry.Flink, CACHE_BLOCK, ListEntry);
+            return CacheBlock;
         }
     }
 
@@ -129,12 +133,15 @@ PCACHE_BLOCK CacheInternalAddBlockToCache(PCACHE_DRIVE CacheDrive, ULONG BlockNu
 
     // Add it to our list of blocks managed by the cache
     InsertTailList(&CacheDrive->CacheBlockHead, &CacheBlock->ListEntry);
+    InsertHeadList(CacheInternalGetHashBucket(CacheDrive, BlockNumber), &CacheBlock->HashListEntry);
 
     // Update the cache data
     CacheBlockCount++;
     CacheSizeCurrent = CacheBlockCount * (CacheDrive->BlockSize * CacheDrive->BytesPerSector);
 
+#if DBG
     CacheInternalDumpBlockList(CacheDrive);
+#endif
 
     return CacheBlock;
 }
@@ -156,12 +163,13 @@ BOOLEAN CacheInternalFreeBlock(PCACHE_DRIVE CacheDrive)
 
     // No blocks left in cache that can be freed
     // so just return
-    if (IsListEmpty(&CacheDrive->CacheBlockHead))
+    if (&CacheBlockToFree->ListEntry == &CacheDrive->CacheBlockHead)
     {
         return FALSE;
     }
 
     RemoveEntryList(&CacheBlockToFree->ListEntry);
+    RemoveEntryList(&CacheBlockToFree->HashListEntry);
 
     // Free the block memory and the block structure
     FrLdrTempFree(CacheBlockToFree->BlockData, TAG_CACHE_DATA);
@@ -187,7 +195,9 @@ VOID CacheInternalCheckCacheSizeLimits(PCACHE_DRIVE CacheDrive)
     if (NewCacheSize > CacheSizeLimit)
     {
         CacheInternalFreeBlock(CacheDrive);
+#if DBG
         CacheInternalDumpBlockList(CacheDrive);
+#endif
     }
 }
 
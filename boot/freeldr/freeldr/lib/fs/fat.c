@@ -35,6 +35,8 @@ BOOLEAN    FatReadVolumeSectors(PFAT_VOLUME_INFO Volume, ULONG SectorNumber, ULO
 #define TAG_FAT_CACHE 'HtaF'
 
 #define FAT_MAX_CACHE_SIZE (256 * 1024) // 256 KiB, note: it should fit maximum FAT12 FAT size (6144 bytes)
+#define FAT_CACHE_READ_AHEAD 32 // Sectors read into the FAT cache on a miss
+#define FAT_MAX_DIRECTORY_CACHE_SIZE (512 * 1024) // 512 KiB of buffered directory contents, for all volumes
 
 typedef struct _FAT_VOLUME_INFO
 {
@@ -49,6 +51,9 @@ typedef struct _FAT_VOLUME_INFO
     ULONG RootDirStartCluster; /* Starting cluster number of the root directory (fat32 only) */
     ULONG DataSectorStart; /* Starting sector of the data area */
     ULONG DeviceId;
+    ULONG LastDirectoryCluster; /* Start cluster of LastDirectoryPath */
+    SIZE_T LastDirectoryPathLength;
+    CHAR LastDirectoryPath[261]; /* Last directory resolved by FatLookupFile(), upper case */
     UINT16 BytesPerSector; /* Number of bytes per sector */
     UINT8 FatType; /* FAT12, FAT16, FAT32, FATX16 or FATX32 */
     UINT8 NumberOfFats; /* Number of FAT tables */
@@ -414,7 +419,24 @@ typedef struct _DIRECTORY_BUFFER
     UCHAR Data[];
 } DIRECTORY_BUFFER, *PDIRECTORY_BUFFER;
 
+/* Most recently used first */
 LIST_ENTRY DirectoryBufferListHead = {&DirectoryBufferListHead, &DirectoryBufferListHead};
+ULONG DirectoryBufferCacheSize = 0;
+
+static VOID FatTrimDirectoryBufferCache(ULONG SizeNeeded)
+{
+    PDIRECTORY_BUFFER DirectoryBuffer;
+
+    /* Drop the least recently used directories until the new one fits */
+    while (!IsListEmpty(&DirectoryBufferListHead) &&
+           DirectoryBufferCacheSize + SizeNeeded > FAT_MAX_DIRECTORY_CACHE_SIZE)
+    {
+        DirectoryBuffer = CONTAINING_RECORD(RemoveTailList(&DirectoryBufferListHead), DIRECTORY_BUFFER, Link);
+        TRACE("Freeing cached directory, cluster %d\n", DirectoryBuffer->DirectoryStartCluster);
+        DirectoryBufferCacheSize -= DirectoryBuffer->DirectorySize;
+        FrLdrTempFree(DirectoryBuffer, TAG_FAT_BUFFER);
+    }
+}
 
 PVOID FatBufferDirectory(PFAT_VOLUME_INFO Volume, ULONG DirectoryStartCluster, ULONG *DirectorySize, BOOLEAN RootDirectory)
 {
@@ -445,6 +467,8 @@ PVOID FatBufferDirectory(PFAT_VOLUME_INFO Volume, ULONG DirectoryStartCluster, U
             (DirectoryBuffer->DirectoryStartCluster == DirectoryStartCluster))
         {
             TRACE("Found cached buffer\n");
+            RemoveEntryList(&DirectoryBuffer->Link);
+            InsertHeadList(&DirectoryBufferListHead, &DirectoryBuffer->Link);
             *DirectorySize = DirectoryBuffer->DirectorySize;
             return DirectoryBuffer->Data;
         }
@@ -462,6 +486,12 @@ PVOID FatBufferDirectory(PFAT_VOLUME_INFO Volume, ULONG DirectoryStartCluster, U
         *DirectorySize = FatCountClustersInChain(Volume, DirectoryStartCluster) * Volume->SectorsPerCluster * Volume->BytesPerSector;
     }
 
+    //
+    // Make room for it in the cache. The buffer returned by the previous call
+    // may be freed here, callers only use it until they call us again.
+    //
+    FatTrimDirectoryBufferCache(*DirectorySize);
+
     //
     // Attempt to allocate memory for directory buffer
     //
@@ -498,7 +528,8 @@ PVOID FatBufferDirectory(PFAT_VOLUME_INFO Volume, ULONG DirectoryStartCluster, U
     DirectoryBuffer->Volume = Volume;
     DirectoryBuffer->DirectoryStartCluster = DirectoryStartCluster;
     DirectoryBuffer->DirectorySize = *DirectorySize;
-    InsertTailList(&DirectoryBufferListHead, &DirectoryBuffer->Link);
+    InsertHeadList(&DirectoryBufferListHead, &DirectoryBuffer->Link);
+    DirectoryBufferCacheSize += *DirectorySize;
 
     return DirectoryBuffer->Data;
 }
@@ -765,6 +796,61 @@ static BOOLEAN FatXSearchDirectoryBufferForFile(PFAT_VOLUME_INFO Volume, PVOID D
     return FALSE;
 }
 
+/*
+ * FatGetDirectoryPathLength()
+ * Returns the length of the directory part of a path,
+ * or 0 if the file is in the root directory
+ */
+static SIZE_T FatGetDirectoryPathLength(PCSTR FileName)
+{
+    SIZE_T i, Length = 0;
+
+    for (i = 0; FileName[i] != '\0'; i++)
+    {
+        if (FileName[i] == '\\' || FileName[i] == '/')
+            Length = i;
+    }
+
+    return Length;
+}
+
+static CHAR FatNormalizePathChar(CHAR Char)
+{
+    return (Char == '/') ? '\\' : toupper(Char);
+}
+
+static BOOLEAN FatIsLastDirectoryPath(PFAT_VOLUME_INFO Volume, PCSTR FileName, SIZE_T Length)
+{
+    SIZE_T i;
+
+    if (Length != Volume->LastDirectoryPathLength)
+        return FALSE;
+
+    for (i = 0; i < Length; i++)
+    {
+        if (FatNormalizePathChar(FileName[i]) != Volume->LastDirectoryPath[i])
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static VOID FatSetLastDirectoryPath(PFAT_VOLUME_INFO Volume, PCSTR FileName, SIZE_T Length, ULONG DirectoryStartCluster)
+{
+    SIZE_T i;
+
+    if (Length >= sizeof(Volume->LastDirectoryPath))
+    {
+        Volume->LastDirectoryPathLength = 0;
+        return;
+    }
+
+    for (i = 0; i < Length; i++)
+        Volume->LastDirectoryPath[i] = FatNormalizePathChar(FileName[i]);
+    Volume->LastDirectoryPathLength = Length;
+    Volume->LastDirectoryCluster = DirectoryStartCluster;
+}
+
 /*
  * FatLookupFile()
  * This function searches the file system for the
@@ -780,6 +866,8 @@ ARC_STATUS FatLookupFile(PFAT_VOLUME_INFO Volume, PCSTR FileName, PFAT_FILE_INFO
     ULONG        DirectoryStartCluster = 0;
     ULONG        DirectorySize;
     FAT_FILE_INFO    FatFileInfo;
+    PCSTR        FullName = FileName;
+    SIZE_T        DirectoryPathLength;
 
     TRACE("FatLookupFile() FileName = %s\n", FileName);
 
@@ -790,10 +878,26 @@ ARC_STATUS FatLookupFile(PFAT_VOLUME_INFO Volume, PCSTR FileName, PFAT_FILE_INFO
     //
     NumberOfPathParts = FsGetNumPathParts(FileName);
 
+    //
+    // Files are usually opened in batches from the same directory (boot drivers,
+    // NLS files...), so skip straight to the last directory we resolved if the
+    // path is in it
+    //
+    DirectoryPathLength = FatGetDirectoryPathLength(FileName);
+    i = 0;
+    if (DirectoryPathLength != 0 &&
+        FatIsLastDirectoryPath(Volume, FileName, DirectoryPathLength))
+    {
+        TRACE("Found cached directory, cluster %d\n", Volume->LastDirectoryCluster);
+        DirectoryStartCluster = Volume->LastDirectoryCluster;
+        FileName += DirectoryPathLength + 1;
+        i = NumberOfPathParts - 1;
+    }
+
     //
     // Loop once for each part
     //
-    for (i=0; i<NumberOfPathParts; i++)
+    for (; i<NumberOfPathParts; i++)
     {
         //
         // Get first path part
@@ -852,6 +956,9 @@ ARC_STATUS FatLookupFile(PFAT_VOLUME_INFO Volume, PCSTR FileName, PFAT_FILE_INFO
         }
     }
 
+    if (DirectoryPathLength != 0)
+        FatSetLastDirectoryPath(Volume, FullName, DirectoryPathLength, DirectoryStartCluster);
+
     RtlCopyMemory(FatFileInfoPointer, &FatFileInfo, sizeof(FAT_FILE_INFO));
 
     return ESUCCESS;
@@ -907,7 +1014,8 @@ void FatParseShortFileName(PCHAR Buffer, PDIRENTRY DirEntry)
 }
 
 /**
- * @brief Reads 1-4 sectors from FAT using the cache
+ * @brief Returns a FAT sector using the cache, reading up to
+ * FAT_CACHE_READ_AHEAD sectors on a miss
  */
 static
 PUCHAR FatGetFatSector(PFAT_VOLUME_INFO Volume, UINT32 FatSectorNumber)
@@ -920,8 +1028,8 @@ PUCHAR FatGetFatSector(PFAT_VOLUME_INFO Volume, UINT32 FatSectorNumber)
     // cache miss
     if (Volume->FatCacheIndex[CacheIndex] != SectorNumAbsolute)
     {
-        UINT32 SectorsToRead = min(Volume->FatCacheSize - CacheIndex, min(Volume->SectorsPerFat - SectorNumAbsolute, 4));
-        UINT8 i;
+        UINT32 SectorsToRead = min(Volume->FatCacheSize - CacheIndex, min(Volume->SectorsPerFat - FatSectorNumber, FAT_CACHE_READ_AHEAD));
+        UINT32 i;
 
         if (!FatReadVolumeSectors(Volume, SectorNumAbsolute, SectorsToRead, &Volume->FatCache[CacheIndex * Volume->BytesPerSector]))
         {
@@ -968,7 +1076,7 @@ BOOLEAN FatGetFatEntry(PFAT_VOLUME_INFO Volume, UINT32 Cluster, PUINT32 ClusterP
         TRACE("ThisFatEntOffset: %d\n", ThisFatEntOffset);
 
         // The cluster pointer can span within two sectors, but the FatGetFatSector function
-        // reads 4 sectors most times, except when we are at the edge of FAT cache
+        // reads several sectors most times, except when we are at the edge of FAT cache
         // and/or FAT region on the disk. For FAT12 the whole FAT would be cached so
         // there will be no situation when the first sector is at the end of the cache
         // and the next one is in the beginning
@@ -13,20 +13,20 @@
 @ stdcall -stub -version=0x600+ A_SHAFinal(ptr ptr)
 @ stdcall -stub -version=0x600+ A_SHAInit(ptr)
 @ stdcall -stub -version=0x600+ A_SHAUpdate(ptr ptr long)
-@ stdcall -stub -version=0x600+ AlpcAdjustCompletionListConcurrencyCount(ptr long)
-@ stdcall -stub -version=0x600+ AlpcFreeCompletionListMessage(ptr ptr)
-@ stdcall -stub -version=0x600+ AlpcGetCompletionListLastMessageInformation(ptr ptr ptr)
-@ stdcall -stub -version=0x600+ AlpcGetCompletionListMessageAttributes(ptr ptr)
-@ stdcall -stub -version=0x600+ AlpcGetHeaderSize(long)
-@ stdcall -stub -version=0x600+ AlpcGetMessageAttribute(ptr long)
-@ stdcall -stub -version=0x600+ AlpcGetMessageFromCompletionList(ptr ptr)
-@ stdcall -stub -version=0x600+ AlpcGetOutstandingCompletionListMessageCount(ptr)
-@ stdcall -stub -version=0x600+ AlpcInitializeMessageAttribute(long ptr long ptr)
-@ stdcall -stub -version=0x600+ AlpcMaxAllowedMessageLength()
-@ stdcall -stub -version=0x600+ AlpcRegisterCompletionList(ptr ptr long long long)
-@ stdcall -stub -version=0x600+ AlpcRegisterCompletionListWorkerThread(ptr)
-@ stdcall -stub -version=0x600+ AlpcUnregisterCompletionList(ptr)
-@ stdcall -stub -version=0x600+ AlpcUnregisterCompletionListWorkerThread(ptr)
+@ stdcall -version=0x600+ AlpcAdjustCompletionListConcurrencyCount(ptr long)
+@ stdcall -version=0x600+ AlpcFreeCompletionListMessage(ptr ptr)
+@ stdcall -version=0x600+ AlpcGetCompletionListLastMessageInformation(ptr ptr ptr)
+@ stdcall -version=0x600+ AlpcGetCompletionListMessageAttributes(ptr ptr)
+@ stdcall -version=0x600+ AlpcGetHeaderSize(long)
+@ stdcall -version=0x600+ AlpcGetMessageAttribute(ptr long)
+@ stdcall -version=0x600+ AlpcGetMessageFromCompletionList(ptr ptr)
+@ stdcall -version=0x600+ AlpcGetOutstandingCompletionListMessageCount(ptr)
+@ stdcall -version=0x600+ AlpcInitializeMessageAttribute(long ptr long ptr)
+@ stdcall -version=0x600+ AlpcMaxAllowedMessageLength()
+@ stdcall -version=0x600+ AlpcRegisterCompletionList(ptr ptr long long long)
+@ stdcall -version=0x600+ AlpcRegisterCompletionListWorkerThread(ptr)
+@ stdcall -version=0x600+ AlpcUnregisterCompletionList(ptr)
+@ stdcall -version=0x600+ AlpcUnregisterCompletionListWorkerThread(ptr)
 @ stdcall CsrAllocateCaptureBuffer(long long)
 @ stdcall CsrAllocateMessagePointer(ptr long ptr)
 @ stdcall CsrCaptureMessageBuffer(ptr ptr long ptr)
@@ -220,27 +220,27 @@
 @ stdcall NtAllocateUserPhysicalPages(ptr ptr ptr)
 @ stdcall NtAllocateUuids(ptr ptr ptr ptr)
 @ stdcall NtAllocateVirtualMemory(long ptr ptr ptr long long)
-@ stub -version=0x600+ NtAlpcAcceptConnectPort
+@ stdcall -version=0x600+ NtAlpcAcceptConnectPort(ptr ptr long ptr ptr ptr ptr ptr long)
 @ stub -version=0x600+ NtAlpcCancelMessage
-@ stub -version=0x600+ NtAlpcConnectPort
-@ stub -version=0x600+ NtAlpcCreatePort
-@ stub -version=0x600+ NtAlpcCreatePortSection
+@ stdcall -version=0x600+ NtAlpcConnectPort(ptr ptr ptr ptr long ptr ptr ptr ptr ptr ptr)
+@ stdcall -version=0x600+ NtAlpcCreatePort(ptr ptr ptr)
+@ stdcall -version=0x600+ NtAlpcCreatePortSection(ptr long ptr long ptr ptr)
 @ stub -version=0x600+ NtAlpcCreateResourceReserve
-@ stub -version=0x600+ NtAlpcCreateSectionView
+@ stdcall -version=0x600+ NtAlpcCreateSectionView(ptr long ptr)
 @ stub -version=0x600+ NtAlpcCreateSecurityContext
-@ stub -version=0x600+ NtAlpcDeletePortSection
+@ stdcall -version=0x600+ NtAlpcDeletePortSection(ptr long ptr)
 @ stub -version=0x600+ NtAlpcDeleteResourceReserve
-@ stub -version=0x600+ NtAlpcDeleteSectionView
+@ stdcall -version=0x600+ NtAlpcDeleteSectionView(ptr long ptr)
 @ stub -version=0x600+ NtAlpcDeleteSecurityContext
 @ stub -version=0x600+ NtAlpcDisconnectPort
-@ stub -version=0x600+ NtAlpcImpersonateClientOfPort
+@ stdcall -version=0x600+ NtAlpcImpersonateClientOfPort(ptr ptr ptr)
 @ stub -version=0x600+ NtAlpcOpenSenderProcess
 @ stub -version=0x600+ NtAlpcOpenSenderThread
 @ stub -version=0x600+ NtAlpcQueryInformation
 @ stub -version=0x600+ NtAlpcQueryInformationMessage
 @ stub -version=0x600+ NtAlpcRevokeSecurityContext
-@ stub -version=0x600+ NtAlpcSendWaitReceivePort
-@ stub -version=0x600+ NtAlpcSetInformation
+@ stdcall -version=0x600+ NtAlpcSendWaitReceivePort(ptr long ptr ptr ptr ptr ptr ptr)
+@ stdcall -version=0x600+ NtAlpcSetInformation(ptr long ptr long)
 @ stdcall NtApphelpCacheControl(long ptr)
 @ stdcall NtAreMappedFilesTheSame(ptr ptr)
 @ stdcall NtAssignProcessToJobObject(long long)
@@ -1080,6 +1080,8 @@
 @ stdcall RtlQueryInformationActiveActivationContext(long ptr long ptr)
 @ stdcall RtlQueryInterfaceMemoryStream(ptr ptr ptr)
 @ stub -version=0x600+ RtlQueryModuleInformation
+@ stdcall RtlQueryPerformanceCounter(ptr)
+@ stdcall RtlQueryPerformanceFrequency(ptr)
 @ stdcall -stub RtlQueryProcessBackTraceInformation(ptr)
 @ stdcall RtlQueryProcessDebugInformation(long long ptr)
 @ stdcall RtlQueryProcessHeapInformation(ptr)
@@ -1381,27 +1383,27 @@
 @ stdcall ZwAllocateUserPhysicalPages(ptr ptr ptr)
 @ stdcall ZwAllocateUuids(ptr ptr ptr ptr)
 @ stdcall ZwAllocateVirtualMemory(long ptr ptr ptr long long)
-@ stub -version=0x600+ ZwAlpcAcceptConnectPort
+@ stdcall -version=0x600+ ZwAlpcAcceptConnectPort(ptr ptr long ptr ptr ptr ptr ptr long)
 @ stub -version=0x600+ ZwAlpcCancelMessage
-@ stub -version=0x600+ ZwAlpcConnectPort
-@ stub -version=0x600+ ZwAlpcCreatePort
-@ stub -version=0x600+ ZwAlpcCreatePortSection
+@ stdcall -version=0x600+ ZwAlpcConnectPort(ptr ptr ptr ptr long ptr ptr ptr ptr ptr ptr)
+@ stdcall -version=0x600+ ZwAlpcCreatePort(ptr ptr ptr)
+@ stdcall -version=0x600+ ZwAlpcCreatePortSection(ptr long ptr long ptr ptr)
 @ stub -version=0x600+ ZwAlpcCreateResourceReserve
-@ stub -version=0x600+ ZwAlpcCreateSectionView
+@ stdcall -version=0x600+ ZwAlpcCreateSectionView(ptr long ptr)
 @ stub -version=0x600+ ZwAlpcCreateSecurityContext
-@ stub -version=0x600+ ZwAlpcDeletePortSection
+@ stdcall -version=0x600+ ZwAlpcDeletePortSection(ptr long ptr)
 @ stub -version=0x600+ ZwAlpcDeleteResourceReserve
-@ stub -version=0x600+ ZwAlpcDeleteSectionView
+@ stdcall -version=0x600+ ZwAlpcDeleteSectionView(ptr long ptr)
 @ stub -version=0x600+ ZwAlpcDeleteSecurityContext
 @ stub -version=0x600+ ZwAlpcDisconnectPort
-@ stub -version=0x600+ ZwAlpcImpersonateClientOfPort
+@ stdcall -version=0x600+ ZwAlpcImpersonateClientOfPort(ptr ptr ptr)
 @ stub -version=0x600+ ZwAlpcOpenSenderProcess
 @ stub -version=0x600+ ZwAlpcOpenSenderThread
 @ stub -version=0x600+ ZwAlpcQueryInformation
 @ stub -version=0x600+ ZwAlpcQueryInformationMessage
 @ stub -version=0x600+ ZwAlpcRevokeSecurityContext
-@ stub -version=0x600+ ZwAlpcSendWaitReceivePort
-@ stub -version=0x600+ ZwAlpcSetInformation
+@ stdcall -version=0x600+ ZwAlpcSendWaitReceivePort(ptr long ptr ptr ptr ptr ptr ptr)
+@ stdcall -version=0x600+ ZwAlpcSetInformation(ptr long ptr long)
 @ stdcall ZwApphelpCacheControl(long ptr)
 @ stdcall ZwAreMappedFilesTheSame(ptr ptr)
 @ stdcall ZwAssignProcessToJobObject(long long)
@@ -0,0 +1,358 @@
+/*
+ * PROJECT:     ReactOS NT User-Mode DLL
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     ALPC message attribute helpers and completion lists
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntdll.h>
+#include <ndk/lpcfuncs.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS *******************************************************************/
+
+/* The attributes follow the header in this order, highest flag first */
+static const struct
+{
+    ULONG Attribute;
+    ULONG Size;
+} AlpcpAttributes[] =
+{
+    { ALPC_MESSAGE_SECURITY_ATTRIBUTE, sizeof(ALPC_SECURITY_ATTR) },
+    { ALPC_MESSAGE_VIEW_ATTRIBUTE, sizeof(ALPC_DATA_VIEW_ATTR) },
+    { ALPC_MESSAGE_CONTEXT_ATTRIBUTE, sizeof(ALPC_CONTEXT_ATTR) },
+    { ALPC_MESSAGE_HANDLE_ATTRIBUTE, sizeof(ALPC_HANDLE_ATTR) },
+    { ALPC_MESSAGE_TOKEN_ATTRIBUTE, sizeof(ALPC_TOKEN_ATTR) },
+    { ALPC_MESSAGE_DIRECT_ATTRIBUTE, sizeof(ALPC_DIRECT_ATTR) },
+};
+
+/* FUNCTIONS ***************************************************************/
+
+/*
+ * @implemented
+ */
+ULONG
+NTAPI
+AlpcGetHeaderSize(
+    _In_ ULONG Flags)
+{
+    ULONG Size = sizeof(ALPC_MESSAGE_ATTRIBUTES);
+    ULONG i;
+
+    for (i = 0; i < RTL_NUMBER_OF(AlpcpAttributes); i++)
+    {
+        if (Flags & AlpcpAttributes[i].Attribute)
+            Size += AlpcpAttributes[i].Size;
+    }
+
+    return Size;
+}
+
+/*
+ * @implemented
+ */
+PVOID
+NTAPI
+AlpcGetMessageAttribute(
+    _In_ PALPC_MESSAGE_ATTRIBUTES Buffer,
+    _In_ ULONG AttributeFlag)
+{
+    ULONG Offset = sizeof(ALPC_MESSAGE_ATTRIBUTES);
+    ULONG i;
+
+    /* Only one attribute can be looked up, and it must have room */
+    if (!(Buffer->AllocatedAttributes & AttributeFlag) ||
+        (AttributeFlag & (AttributeFlag - 1)))
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < RTL_NUMBER_OF(AlpcpAttributes); i++)
+    {
+        if (AlpcpAttributes[i].Attribute == AttributeFlag)
+            return (PUCHAR)Buffer + Offset;
+
+        if (Buffer->AllocatedAttributes & AlpcpAttributes[i].Attribute)
+            Offset += AlpcpAttributes[i].Size;
+    }
+
+    return NULL;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+AlpcInitializeMessageAttribute(
+    _In_ ULONG AttributeFlags,
+    _Out_opt_ PALPC_MESSAGE_ATTRIBUTES Buffer,
+    _In_ ULONG BufferSize,
+    _Out_ PULONG RequiredBufferSize)
+{
+    *RequiredBufferSize = AlpcGetHeaderSize(AttributeFlags);
+
+    if (Buffer == NULL || BufferSize < *RequiredBufferSize)
+        return STATUS_BUFFER_TOO_SMALL;
+
+    Buffer->AllocatedAttributes = AttributeFlags;
+    Buffer->ValidAttributes = 0;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+ULONG
+NTAPI
+AlpcMaxAllowedMessageLength(VOID)
+{
+    return LPC_MAX_MESSAGE_LENGTH;
+}
+
+/*
+ * Completion lists are filled by the kernel, see AlpcpPostCompletionList.
+ * Messages are taken from the queue in order by any number of workers, and
+ * an entry only goes back to the kernel once its message has been freed.
+ */
+
+static
+PLONG
+AlpcpGetCompletionListState(
+    _In_ PALPC_COMPLETION_LIST_HEADER Header)
+{
+    return (PLONG)((PUCHAR)Header + Header->StateOffset);
+}
+
+static
+PLONG
+AlpcpGetCompletionListQueue(
+    _In_ PALPC_COMPLETION_LIST_HEADER Header)
+{
+    return (PLONG)((PUCHAR)Header + Header->QueueOffset);
+}
+
+static
+ULONG
+AlpcpGetCompletionListEntry(
+    _In_ PALPC_COMPLETION_LIST_HEADER Header,
+    _In_ PPORT_MESSAGE Message)
+{
+    return (ULONG)(((PUCHAR)Message - Header->AttributeSize -
+                    ((PUCHAR)Header + Header->DataOffset)) / Header->EntrySize);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+AlpcRegisterCompletionList(
+    _In_ HANDLE PortHandle,
+    _Out_ PALPC_COMPLETION_LIST_HEADER Buffer,
+    _In_ ULONG Size,
+    _In_ ULONG ConcurrencyCount,
+    _In_ ULONG AttributeFlags)
+{
+    ALPC_PORT_COMPLETION_LIST_INFORMATION Information;
+    NTSTATUS Status;
+
+    Information.Buffer = Buffer;
+    Information.Size = Size;
+    Information.ConcurrencyCount = ConcurrencyCount;
+    Information.AttributeFlags = AttributeFlags;
+
+    Status = NtAlpcSetInformation(PortHandle,
+                                  AlpcRegisterCompletionListInformation,
+                                  &Information,
+                                  sizeof(Information));
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Freeing a message may have to ask the kernel for the backlog */
+    Buffer->PortHandle = PortHandle;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+AlpcUnregisterCompletionList(
+    _In_ HANDLE PortHandle)
+{
+    return NtAlpcSetInformation(PortHandle,
+                                AlpcUnregisterCompletionListInformation,
+                                NULL,
+                                0);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+AlpcAdjustCompletionListConcurrencyCount(
+    _In_ HANDLE PortHandle,
+    _In_ ULONG ConcurrencyCount)
+{
+    return NtAlpcSetInformation(PortHandle,
+                                AlpcAdjustCompletionListConcurrencyCountInformation,
+                                &ConcurrencyCount,
+                                sizeof(ConcurrencyCount));
+}
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+AlpcRegisterCompletionListWorkerThread(
+    _Inout_ PVOID CompletionList)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+    LONG Workers;
+
+    /* A concurrency count of zero doesn't limit the workers */
+    do
+    {
+        Workers = Header->WorkerCount;
+        if (Header->ConcurrencyCount &&
+            ((ULONG)Workers >= Header->ConcurrencyCount))
+        {
+            return FALSE;
+        }
+    } while (InterlockedCompareExchange(&Header->WorkerCount,
+                                        Workers + 1,
+                                        Workers) != Workers);
+
+    return TRUE;
+}
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+AlpcUnregisterCompletionListWorkerThread(
+    _Inout_ PVOID CompletionList)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+    LONG Workers;
+
+    do
+    {
+        Workers = Header->WorkerCount;
+        if (Workers <= 0) return FALSE;
+    } while (InterlockedCompareExchange(&Header->WorkerCount,
+                                        Workers - 1,
+                                        Workers) != Workers);
+
+    return TRUE;
+}
+
+/*
+ * @implemented
+ */
+PPORT_MESSAGE
+NTAPI
+AlpcGetMessageFromCompletionList(
+    _In_ PVOID CompletionList,
+    _Out_opt_ PALPC_MESSAGE_ATTRIBUTES *MessageAttributes)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+    PLONG Queue = AlpcpGetCompletionListQueue(Header);
+    PUCHAR Entry;
+    LONG Return, Slot;
+
+    /* The kernel publishes in order, an empty slot means nothing is left */
+    do
+    {
+        Return = Header->ReturnCount;
+        Slot = Queue[(ULONG)Return % Header->EntryCount];
+        if (!Slot) return NULL;
+    } while (InterlockedCompareExchange(&Header->ReturnCount,
+                                        Return + 1,
+                                        Return) != Return);
+
+    /* The slot can't be reused before its entry is freed */
+    Queue[(ULONG)Return % Header->EntryCount] = 0;
+
+    Entry = (PUCHAR)Header + Header->DataOffset + (Slot - 1) * Header->EntrySize;
+    if (MessageAttributes) *MessageAttributes = (PALPC_MESSAGE_ATTRIBUTES)Entry;
+    return (PPORT_MESSAGE)(Entry + Header->AttributeSize);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+AlpcFreeCompletionListMessage(
+    _Inout_ PVOID CompletionList,
+    _In_ PPORT_MESSAGE Message)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+    PLONG State = AlpcpGetCompletionListState(Header);
+
+    InterlockedExchange(&State[AlpcpGetCompletionListEntry(Header, Message)],
+                        ALPC_COMPLETION_LIST_ENTRY_FREE);
+    InterlockedDecrement(&Header->OutstandingCount);
+
+    /* Have the kernel hand out what didn't fit while the list was full */
+    if (Header->Backlog && InterlockedExchange(&Header->Backlog, FALSE))
+    {
+        NtAlpcSetInformation(Header->PortHandle,
+                             AlpcCompletionListRundownInformation,
+                             NULL,
+                             0);
+    }
+}
+
+/*
+ * @implemented
+ */
+PALPC_MESSAGE_ATTRIBUTES
+NTAPI
+AlpcGetCompletionListMessageAttributes(
+    _In_ PVOID CompletionList,
+    _In_ PPORT_MESSAGE Message)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+
+    return (PALPC_MESSAGE_ATTRIBUTES)((PUCHAR)Message - Header->AttributeSize);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+AlpcGetCompletionListLastMessageInformation(
+    _In_ PVOID CompletionList,
+    _Out_ PULONG LastMessageId,
+    _Out_ PULONG LastCallbackId)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+
+    *LastMessageId = Header->LastMessageId;
+    *LastCallbackId = Header->LastCallbackId;
+}
+
+/*
+ * @implemented
+ */
+ULONG
+NTAPI
+AlpcGetOutstandingCompletionListMessageCount(
+    _In_ PVOID CompletionList)
+{
+    PALPC_COMPLETION_LIST_HEADER Header = CompletionList;
+
+    return Header->OutstandingCount;
+}
+
+/* EOF */
@@ -0,0 +1,63 @@
+/*
+ * PROJECT:     ReactOS NT User-Mode DLL
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Performance counter queries without a system call
+ */
+
+/* INCLUDES *****************************************************************/
+
+#include <ntdll.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* FUNCTIONS ***************************************************************/
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+RtlQueryPerformanceCounter(
+    _Out_ PLARGE_INTEGER PerformanceCounter)
+{
+    LARGE_INTEGER Frequency;
+    NTSTATUS Status;
+
+#if defined(_M_IX86) || defined(_M_AMD64)
+    /* The HAL only sets this when its counter is an invariant TSC */
+    if (SharedUserData->TscQpcEnabled)
+    {
+        PerformanceCounter->QuadPart =
+            (LONGLONG)((__rdtsc() + SharedUserData->QpcBias) >> SharedUserData->TscQpcShift);
+        return TRUE;
+    }
+#endif
+
+    Status = NtQueryPerformanceCounter(PerformanceCounter, &Frequency);
+    return NT_SUCCESS(Status) && (Frequency.QuadPart != 0);
+}
+
+/*
+ * @implemented
+ */
+BOOLEAN
+NTAPI
+RtlQueryPerformanceFrequency(
+    _Out_ PLARGE_INTEGER PerformanceFrequency)
+{
+    LARGE_INTEGER Counter;
+    NTSTATUS Status;
+
+    /* The frequency never changes, so use it when the HAL published it */
+    if (SharedUserData->QpcFrequency != 0)
+    {
+        PerformanceFrequency->QuadPart = SharedUserData->QpcFrequency;
+        return TRUE;
+    }
+
+    Status = NtQueryPerformanceCounter(&Counter, PerformanceFrequency);
+    return NT_SUCCESS(Status) && (PerformanceFrequency->QuadPart != 0);
+}
+
+/* EOF */
@@ -37,6 +37,7 @@
 
 #include "gdiplus.h"
 #include "gdiplus_private.h"
+#include "resample.h"
 #include "wine/debug.h"
 #include "wine/list.h"
 
@@ -388,13 +389,49 @@ static GpStatus get_clip_hrgn(GpGraphics *graphics, HRGN *hrgn)
     return stat;
 }
 
+static BOOL get_blend_format(PixelFormat format, enum resample_blend *blend)
+{
+    switch (format)
+    {
+    case PixelFormat32bppARGB:
+        *blend = RESAMPLE_BLEND_ARGB;
+        return TRUE;
+    case PixelFormat32bppPARGB:
+        *blend = RESAMPLE_BLEND_PARGB;
+        return TRUE;
+    case PixelFormat32bppRGB:
+        *blend = RESAMPLE_BLEND_RGB;
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
 /* Draw ARGB data to the given graphics object */
 static GpStatus alpha_blend_bmp_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     const BYTE *src, INT src_width, INT src_height, INT src_stride, const PixelFormat fmt)
 {
     GpBitmap *dst_bitmap = (GpBitmap*)graphics->image;
+    enum resample_blend blend;
     INT x, y;
 
+    if (get_blend_format(dst_bitmap->format, &blend))
+    {
+        /* Blend whole rows straight into the bits, clipped to the bitmap
+         * like GdipBitmapSetPixel does */
+        INT left = max(dst_x, 0), right = min(dst_x + src_width, dst_bitmap->width);
+        INT top = max(dst_y, 0), bottom = min(dst_y + src_height, dst_bitmap->height);
+
+        for (y=top; y<bottom; y++)
+        {
+            resample_blend_row((UINT *)(dst_bitmap->bits + dst_bitmap->stride * y) + left,
+                (const UINT *)(src + src_stride * (y - dst_y)) + (left - dst_x),
+                right - left, (fmt & PixelFormatPAlpha) != 0, blend);
+        }
+
+        return Ok;
+    }
+
     for (y=0; y<src_height; y++)
     {
         for (x=0; x<src_width; x++)
@@ -557,17 +594,6 @@ static GpStatus alpha_blend_pixels(GpGraphics *graphics, INT dst_x, INT dst_y,
     return alpha_blend_pixels_hrgn(graphics, dst_x, dst_y, src, src_width, src_height, src_stride, NULL, fmt);
 }
 
-/* NOTE: start and end pixels must be in pre-multiplied ARGB format */
-static inline ARGB blend_colors_premult(ARGB start, ARGB end, REAL position)
-{
-    UINT pos = position * 255.0f + 0.5f;
-    return
-        (((((start >> 24)       ) << 8) + (((end >> 24)       ) - ((start >> 24)       )) * pos) >> 8) << 24 |
-        (((((start >> 16) & 0xff) << 8) + (((end >> 16) & 0xff) - ((start >> 16) & 0xff)) * pos) >> 8) << 16 |
-        (((((start >>  8) & 0xff) << 8) + (((end >>  8) & 0xff) - ((start >>  8) & 0xff)) * pos) >> 8) <<  8 |
-        (((((start      ) & 0xff) << 8) + (((end      ) & 0xff) - ((start      ) & 0xff)) * pos) >> 8);
-}
-
 static ARGB blend_colors(ARGB start, ARGB end, REAL position)
 {
     INT start_a, end_a, final_a;
@@ -875,10 +901,16 @@ static void get_bitmap_sample_size(InterpolationMode interpolation, WrapMode wra
 
     switch (interpolation)
     {
-    case InterpolationModeHighQualityBilinear:
     case InterpolationModeHighQualityBicubic:
-    /* FIXME: Include a greater range for the prefilter? */
     case InterpolationModeBicubic:
+        /* The spline also uses the pixels around the source rectangle */
+        left = (INT)(floorf(srcx)) - 1;
+        top = (INT)(floorf(srcy)) - 1;
+        right = (INT)(ceilf(srcx+srcwidth)) + 1;
+        bottom = (INT)(ceilf(srcy+srcheight)) + 1;
+        break;
+    case InterpolationModeHighQualityBilinear:
+    /* FIXME: Include a greater range for the prefilter? */
     case InterpolationModeBilinear:
         left = (INT)(floorf(srcx));
         top = (INT)(floorf(srcy));
@@ -1053,72 +1085,38 @@ static ARGB resample_bitmap_pixel(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT
     }
 }
 
-static ARGB resample_bitmap_pixel_premult(GDIPCONST GpRect *src_rect, LPBYTE bits, UINT width,
-    UINT height, GpPointF *point, GDIPCONST GpImageAttributes *attributes,
-    InterpolationMode interpolation, PixelOffsetMode offset_mode)
+static enum resample_mode get_resample_mode(InterpolationMode interpolation)
 {
     static int fixme;
 
     switch (interpolation)
     {
+    case InterpolationModeNearestNeighbor:
+        return RESAMPLE_NEAREST;
+    case InterpolationModeBicubic:
+    case InterpolationModeHighQualityBicubic:
+        return RESAMPLE_BICUBIC;
     default:
         if (!fixme++)
             FIXME("Unimplemented interpolation %i\n", interpolation);
         /* fall-through */
     case InterpolationModeBilinear:
-    {
-        REAL leftxf, topyf;
-        INT leftx, rightx, topy, bottomy;
-        ARGB topleft, topright, bottomleft, bottomright;
-        ARGB top, bottom;
-        float x_offset;
-
-        leftx = (INT)point->X;
-        leftxf = (REAL)leftx;
-        rightx = positive_ceilf(point->X);
-        topy = (INT)point->Y;
-        topyf = (REAL)topy;
-        bottomy = positive_ceilf(point->Y);
-
-        if (leftx == rightx && topy == bottomy)
-            return sample_bitmap_pixel(src_rect, bits, width, height,
-                leftx, topy, attributes);
-
-        topleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, topy, attributes);
-        topright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, topy, attributes);
-        bottomleft = sample_bitmap_pixel(src_rect, bits, width, height,
-            leftx, bottomy, attributes);
-        bottomright = sample_bitmap_pixel(src_rect, bits, width, height,
-            rightx, bottomy, attributes);
-
-        x_offset = point->X - leftxf;
-        top = blend_colors_premult(topleft, topright, x_offset);
-        bottom = blend_colors_premult(bottomleft, bottomright, x_offset);
-
-        return blend_colors_premult(top, bottom, point->Y - topyf);
+        return RESAMPLE_BILINEAR;
     }
-    case InterpolationModeNearestNeighbor:
-    {
-        FLOAT pixel_offset;
-        switch (offset_mode)
-        {
-        default:
-        case PixelOffsetModeNone:
-        case PixelOffsetModeHighSpeed:
-            pixel_offset = 0.5;
-            break;
+}
 
-        case PixelOffsetModeHalf:
-        case PixelOffsetModeHighQuality:
-            pixel_offset = 0.0;
-            break;
-        }
-        return sample_bitmap_pixel(src_rect, bits, width, height,
-            floorf(point->X + pixel_offset), point->Y + pixel_offset, attributes);
-    }
+static REAL get_nearest_offset(PixelOffsetMode offset_mode)
+{
+    switch (offset_mode)
+    {
+    default:
+    case PixelOffsetModeNone:
+    case PixelOffsetModeHighSpeed:
+        return 0.5;
 
+    case PixelOffsetModeHalf:
+    case PixelOffsetModeHighQuality:
+        return 0.0;
     }
 }
 
@@ -3165,7 +3163,7 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             RECT dst_area;
             GpRectF graphics_bounds;
             GpRect src_area;
-            int i, x, y, src_stride, dst_stride;
+            int i, src_stride, dst_stride;
             GpMatrix dst_to_src;
             REAL m11, m12, m21, m22, mdx, mdy;
             LPBYTE src_data, dst_data, dst_dyn_data=NULL;
@@ -3173,7 +3171,6 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
             InterpolationMode interpolation = graphics->interpolation;
             PixelOffsetMode offset_mode = graphics->pixeloffset;
             GpPointF dst_to_src_points[3] = {{0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}};
-            REAL x_dx, x_dy, y_dx, y_dy;
             static const GpImageAttributes defaultImageAttributes = {WrapModeClamp, 0, FALSE};
 
             if (!imageAttributes)
@@ -3264,61 +3261,63 @@ GpStatus WINGDIPAPI GdipDrawImagePointsRect(GpGraphics *graphics, GpImage *image
 
             if (do_resampling)
             {
-                REAL delta_xx, delta_xy, delta_yx, delta_yy;
+                enum resample_mode mode = get_resample_mode(interpolation);
+                struct resample_image sample_image;
+                struct resample_transform transform;
+                ARGB outside_color = imageAttributes->outside_color;
+                INT dst_width = dst_area.right - dst_area.left;
+                INT dst_height = dst_area.bottom - dst_area.top;
 
                 /* Transform the bits as needed to the destination. */
-                dst_data = dst_dyn_data = heap_alloc_zero(sizeof(ARGB) * (dst_area.right - dst_area.left) * (dst_area.bottom - dst_area.top));
+                dst_data = dst_dyn_data = heap_alloc(sizeof(ARGB) * dst_width * dst_height);
                 if (!dst_data)
                 {
                     heap_free(src_data);
                     return OutOfMemory;
                 }
 
-                dst_stride = sizeof(ARGB) * (dst_area.right - dst_area.left);
+                dst_stride = sizeof(ARGB) * dst_width;
 
-                GdipTransformMatrixPoints(&dst_to_src, dst_to_src_points, 3);
-
-                x_dx = dst_to_src_points[1].X - dst_to_src_points[0].X;
-                x_dy = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
-                y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
-                y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
-
-                delta_yy = dst_area.top * y_dy;
-                delta_yx = dst_area.top * y_dx;
-
-                for (y=dst_area.top; y<dst_area.bottom; y++)
+                if (mode != RESAMPLE_NEAREST && lockeddata.PixelFormat != PixelFormat32bppPARGB)
                 {
-                    delta_xx = dst_area.left * x_dx;
-                    delta_xy = dst_area.left * x_dy;
-
-                    for (x=dst_area.left; x<dst_area.right; x++)
-                    {
-                        GpPointF src_pointf;
-                        ARGB *dst_color;
-
-                        src_pointf.X = dst_to_src_points[0].X + delta_xx + delta_yx;
-                        src_pointf.Y = dst_to_src_points[0].Y + delta_xy + delta_yy;
-
-                        dst_color = (ARGB*)(dst_data + dst_stride * (y - dst_area.top) + sizeof(ARGB) * (x - dst_area.left));
-
-                        if (src_pointf.X >= srcx && src_pointf.X < srcx + srcwidth && src_pointf.Y >= srcy && src_pointf.Y < srcy+srcheight)
-                        {
-                            if (lockeddata.PixelFormat != PixelFormat32bppPARGB)
-                                *dst_color = resample_bitmap_pixel(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                                   imageAttributes, interpolation, offset_mode);
-                            else
-                                *dst_color = resample_bitmap_pixel_premult(&src_area, src_data, bitmap->width, bitmap->height, &src_pointf,
-                                                                           imageAttributes, interpolation, offset_mode);
-                        }
-                        else
-                            *dst_color = 0;
+                    /* The filters work on premultiplied colors */
+                    convert_32bppARGB_to_32bppPARGB(src_area.Width, src_area.Height,
+                        src_data, src_stride, src_data, src_stride);
+                    convert_32bppARGB_to_32bppPARGB(1, 1, (BYTE *)&outside_color, sizeof(ARGB),
+                        (const BYTE *)&outside_color, sizeof(ARGB));
+                    lockeddata.PixelFormat = PixelFormat32bppPARGB;
+                }
 
-                        delta_xx += x_dx;
-                        delta_yx += y_dx;
-                    }
+                GdipTransformMatrixPoints(&dst_to_src, dst_to_src_points, 3);
 
-                    delta_xy += x_dy;
-                    delta_yy += y_dy;
+                sample_image.bits = (const UINT *)src_data;
+                sample_image.x = src_area.X;
+                sample_image.y = src_area.Y;
+                sample_image.width = src_area.Width;
+                sample_image.height = src_area.Height;
+                sample_image.image_width = bitmap->width;
+                sample_image.image_height = bitmap->height;
+                sample_image.wrap = imageAttributes->wrap;
+                sample_image.outside_color = outside_color;
+
+                transform.x0 = dst_to_src_points[0].X;
+                transform.y0 = dst_to_src_points[0].Y;
+                transform.x_dx = dst_to_src_points[1].X - dst_to_src_points[0].X;
+                transform.x_dy = dst_to_src_points[1].Y - dst_to_src_points[0].Y;
+                transform.y_dx = dst_to_src_points[2].X - dst_to_src_points[0].X;
+                transform.y_dy = dst_to_src_points[2].Y - dst_to_src_points[0].Y;
+                transform.left = srcx;
+                transform.top = srcy;
+                transform.right = srcx + srcwidth;
+                transform.bottom = srcy + srcheight;
+                transform.nearest_offset = get_nearest_offset(offset_mode);
+
+                if (!resample_draw(&sample_image, &transform, mode, dst_area.left, dst_area.top,
+                        dst_width, dst_height, (UINT *)dst_data, dst_width))
+                {
+                    heap_free(src_data);
+                    heap_free(dst_dyn_data);
+                    return OutOfMemory;
                 }
             }
             else
@@ -0,0 +1,718 @@
+/*
+ * Image resampling for GdipDrawImage*
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "resample.h"
+
+/* Source positions are stepped in 16.16 fixed point. They are kept in
+ * 64 bits so large images don't overflow. */
+#define FIXED_SHIFT 16
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+/* Filter positions are rounded to 1/256 of a pixel. Bilinear weights are
+ * 0 to 256, bicubic weights have CUBIC_BITS fractional bits. */
+#define PHASES 256
+#define CUBIC_BITS 14
+#define CUBIC_ONE (1 << CUBIC_BITS)
+#define CUBIC_ROUND (1 << (CUBIC_BITS - 1))
+
+#define MAX_TAPS 4
+
+/* Horizontally filtered rows kept while walking down the destination */
+#define ROW_CACHE_SIZE (2 * MAX_TAPS)
+
+typedef long long fixed;
+
+/* Samples of one destination column or row. index is the offset of the
+ * sample in the area, or -1 for the outside color. */
+struct taps
+{
+    int index[MAX_TAPS];
+    int weight[MAX_TAPS];
+};
+
+struct row_cache
+{
+    unsigned int *rows;
+    int index[ROW_CACHE_SIZE];
+    unsigned int next;
+};
+
+static inline int floor_int(double x)
+{
+    int i = (int)x;
+    return i > x ? i - 1 : i;
+}
+
+static inline fixed to_fixed(double x)
+{
+    return (fixed)floor(x * FIXED_ONE + 0.5);
+}
+
+static inline int fixed_int(fixed x)
+{
+    return (int)(x >> FIXED_SHIFT);
+}
+
+/* Rounds a fraction to PHASES steps, a fraction that rounds up to a whole
+ * pixel moves the position to the next one */
+static inline int get_phase(double pos, int *i)
+{
+    int phase;
+
+    *i = floor_int(pos);
+    phase = (int)((pos - *i) * PHASES + 0.5);
+    if (phase == PHASES)
+    {
+        (*i)++;
+        phase = 0;
+    }
+    return phase;
+}
+
+static inline int get_fixed_phase(fixed pos, int *i)
+{
+    int phase = (int)(((pos & (FIXED_ONE - 1)) + (FIXED_ONE / PHASES / 2)) >> (FIXED_SHIFT - 8));
+
+    *i = fixed_int(pos);
+    if (phase == PHASES)
+    {
+        (*i)++;
+        phase = 0;
+    }
+    return phase;
+}
+
+/* Catmull-Rom spline, weights of the samples at -1, 0, 1 and 2 */
+static void init_cubic_weights(int (*weights)[MAX_TAPS])
+{
+    int phase, t, sum, best;
+
+    for (phase = 0; phase < PHASES; phase++)
+    {
+        double x = (double)phase / PHASES;
+        double w[MAX_TAPS];
+
+        w[0] = ((-0.5 * x + 1.0) * x - 0.5) * x;
+        w[1] = (1.5 * x - 2.5) * x * x + 1.0;
+        w[2] = ((-1.5 * x + 2.0) * x + 0.5) * x;
+        w[3] = (0.5 * x - 0.5) * x * x;
+
+        sum = best = 0;
+        for (t = 0; t < MAX_TAPS; t++)
+        {
+            weights[phase][t] = (int)floor(w[t] * CUBIC_ONE + 0.5);
+            sum += weights[phase][t];
+            if (weights[phase][t] > weights[phase][best]) best = t;
+        }
+
+        /* Make sure flat areas stay flat */
+        weights[phase][best] += CUBIC_ONE - sum;
+    }
+}
+
+/* Applies the wrap mode like sample_bitmap_pixel does and returns the
+ * offset of the coordinate in the area, or -1 for the outside color */
+static int wrap_coord(int i, int size, int area_pos, int area_size, unsigned int wrap, unsigned int flip)
+{
+    if (wrap & RESAMPLE_WRAP_CLAMP)
+    {
+        if (i < 0 || i >= size)
+            return -1;
+    }
+    else if (i < 0 || i >= size)
+    {
+        /* Tiling. Make sure the coordinate is positive as it simplifies the math. */
+        if (i < 0)
+            i = size * 2 + i % (size * 2);
+
+        if ((wrap & flip) && (i / size) % 2)
+            i = size - 1 - i % size;
+        else
+            i = i % size;
+    }
+
+    /* The area holds every pixel that can be sampled, this only guards
+     * against rounding in the caller */
+    i -= area_pos;
+    if (i < 0) return 0;
+    if (i >= area_size) return area_size - 1;
+    return i;
+}
+
+static inline int wrap_x(const struct resample_image *image, int x)
+{
+    return wrap_coord(x, image->image_width, image->x, image->width, image->wrap, RESAMPLE_WRAP_FLIP_X);
+}
+
+static inline int wrap_y(const struct resample_image *image, int y)
+{
+    return wrap_coord(y, image->image_height, image->y, image->height, image->wrap, RESAMPLE_WRAP_FLIP_Y);
+}
+
+static unsigned int fetch_wrapped(const struct resample_image *image, int x, int y)
+{
+    x = wrap_x(image, x);
+    y = wrap_y(image, y);
+
+    if (x < 0 || y < 0)
+        return image->outside_color;
+
+    return image->bits[y * image->width + x];
+}
+
+static inline unsigned int fetch(const struct resample_image *image, int x, int y)
+{
+    unsigned int ax = x - image->x, ay = y - image->y;
+
+    /* The area lies inside the image, where wrapping changes nothing */
+    if (ax < (unsigned int)image->width && ay < (unsigned int)image->height)
+        return image->bits[ay * image->width + ax];
+
+    return fetch_wrapped(image, x, y);
+}
+
+/* (a * (256 - w) + b * w) / 256 for each channel, two channels at a time */
+static inline unsigned int lerp(unsigned int a, unsigned int b, unsigned int w)
+{
+    unsigned int rb, ag;
+
+    rb = ((a & 0x00ff00ff) * (256 - w) + (b & 0x00ff00ff) * w) >> 8;
+    ag = ((a >> 8) & 0x00ff00ff) * (256 - w) + ((b >> 8) & 0x00ff00ff) * w;
+
+    return (rb & 0x00ff00ff) | (ag & 0xff00ff00);
+}
+
+static inline void cubic_add(int *sum, unsigned int p, int w)
+{
+    sum[0] += w * (int)(p & 0xff);
+    sum[1] += w * (int)((p >> 8) & 0xff);
+    sum[2] += w * (int)((p >> 16) & 0xff);
+    sum[3] += w * (int)(p >> 24);
+}
+
+static inline unsigned int clamp_channel(int value, int max)
+{
+    if (value < 0) return 0;
+    return value > max ? max : value;
+}
+
+/* Rounds the sums, the spline overshoots so the colors are clamped to the
+ * alpha to keep the result premultiplied */
+static inline unsigned int cubic_pack(const int *sum)
+{
+    unsigned int a = clamp_channel((sum[3] + CUBIC_ROUND) >> CUBIC_BITS, 255);
+
+    return (a << 24) |
+        (clamp_channel((sum[2] + CUBIC_ROUND) >> CUBIC_BITS, a) << 16) |
+        (clamp_channel((sum[1] + CUBIC_ROUND) >> CUBIC_BITS, a) << 8) |
+        clamp_channel((sum[0] + CUBIC_ROUND) >> CUBIC_BITS, a);
+}
+
+static void get_taps(struct taps *taps, double pos, enum resample_mode mode,
+    double nearest_offset, const int (*cubic)[MAX_TAPS],
+    int (*wrap)(const struct resample_image *, int), const struct resample_image *image)
+{
+    int i, t, phase;
+
+    switch (mode)
+    {
+    case RESAMPLE_NEAREST:
+        taps->index[0] = wrap(image, floor_int(pos + nearest_offset));
+        break;
+    case RESAMPLE_BILINEAR:
+        phase = get_phase(pos, &i);
+        taps->index[0] = wrap(image, i);
+        taps->index[1] = phase ? wrap(image, i + 1) : taps->index[0];
+        taps->weight[1] = phase;
+        break;
+    case RESAMPLE_BICUBIC:
+        phase = get_phase(pos, &i);
+        for (t = 0; t < MAX_TAPS; t++)
+        {
+            taps->index[t] = wrap(image, i - 1 + t);
+            taps->weight[t] = cubic[phase][t];
+        }
+        break;
+    }
+}
+
+/* Destination pixels [*start, *end) map inside of [low, high) */
+static void get_inside_range(double pos, double step, double low, double high,
+    unsigned int count, unsigned int *start, unsigned int *end)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        if (pos + i * step >= low && pos + i * step < high) break;
+    *start = i;
+
+    for (; i < count; i++)
+        if (!(pos + i * step >= low && pos + i * step < high)) break;
+    *end = i;
+}
+
+static inline unsigned int sample_column(const unsigned int *row, int index, unsigned int outside)
+{
+    return (row && index >= 0) ? row[index] : outside;
+}
+
+/* Filters source row y (-1 for the outside color) horizontally */
+static void filter_row(const struct resample_image *image, enum resample_mode mode, int y,
+    const struct taps *columns, unsigned int start, unsigned int end, unsigned int *dst)
+{
+    const unsigned int *row = y >= 0 ? image->bits + y * image->width : NULL;
+    unsigned int outside = image->outside_color, x;
+
+    if (mode == RESAMPLE_BILINEAR)
+    {
+        for (x = start; x < end; x++)
+        {
+            const struct taps *c = &columns[x];
+            unsigned int p0 = sample_column(row, c->index[0], outside);
+
+            dst[x] = c->weight[1] ? lerp(p0, sample_column(row, c->index[1], outside), c->weight[1]) : p0;
+        }
+    }
+    else
+    {
+        for (x = start; x < end; x++)
+        {
+            const struct taps *c = &columns[x];
+            int sum[4] = {0, 0, 0, 0};
+
+            if (c->weight[1] == CUBIC_ONE)
+            {
+                dst[x] = sample_column(row, c->index[1], outside);
+                continue;
+            }
+
+            cubic_add(sum, sample_column(row, c->index[0], outside), c->weight[0]);
+            cubic_add(sum, sample_column(row, c->index[1], outside), c->weight[1]);
+            cubic_add(sum, sample_column(row, c->index[2], outside), c->weight[2]);
+            cubic_add(sum, sample_column(row, c->index[3], outside), c->weight[3]);
+
+            dst[x] = cubic_pack(sum);
+        }
+    }
+}
+
+static const unsigned int *get_filtered_row(struct row_cache *cache, const struct resample_image *image,
+    enum resample_mode mode, int y, const struct taps *columns, unsigned int start, unsigned int end,
+    unsigned int width, unsigned int in_use)
+{
+    unsigned int slot;
+
+    for (slot = 0; slot < ROW_CACHE_SIZE; slot++)
+        if (cache->index[slot] == y)
+            return cache->rows + slot * width;
+
+    /* Don't evict rows used by the current destination row */
+    do
+    {
+        slot = cache->next;
+        cache->next = (cache->next + 1) % ROW_CACHE_SIZE;
+    } while (in_use & (1 << slot));
+
+    filter_row(image, mode, y, columns, start, end, cache->rows + slot * width);
+    cache->index[slot] = y;
+
+    return cache->rows + slot * width;
+}
+
+static unsigned int get_row_slot(const struct row_cache *cache, const unsigned int *row, unsigned int width)
+{
+    return (row - cache->rows) / width;
+}
+
+/* Pure scales and translations. Every destination column samples the
+ * same source columns on every row, so the taps are computed once and
+ * the filters are separable. */
+static int resample_axis_aligned(const struct resample_image *image, const struct resample_transform *transform,
+    enum resample_mode mode, int dst_x, int dst_y, unsigned int width, unsigned int height,
+    unsigned int *dst, unsigned int dst_stride)
+{
+    int (*cubic)[MAX_TAPS] = NULL;
+    struct taps *columns, row_taps;
+    struct row_cache cache;
+    unsigned int x, y, start, end, row_start, row_end, in_use;
+    double x0 = transform->x0 + dst_x * transform->x_dx;
+    double y0 = transform->y0 + dst_y * transform->y_dy;
+    int t;
+
+    get_inside_range(x0, transform->x_dx, transform->left, transform->right, width, &start, &end);
+    get_inside_range(y0, transform->y_dy, transform->top, transform->bottom, height, &row_start, &row_end);
+
+    if (start == end || row_start == row_end)
+    {
+        for (y = 0; y < height; y++)
+            memset(dst + y * dst_stride, 0, width * sizeof(*dst));
+        return 1;
+    }
+
+    columns = malloc(width * sizeof(*columns));
+    if (mode == RESAMPLE_BICUBIC)
+        cubic = malloc(PHASES * sizeof(*cubic));
+    cache.rows = mode != RESAMPLE_NEAREST ? malloc(ROW_CACHE_SIZE * width * sizeof(*cache.rows)) : NULL;
+
+    if (!columns || (mode == RESAMPLE_BICUBIC && !cubic) || (mode != RESAMPLE_NEAREST && !cache.rows))
+    {
+        free(cache.rows);
+        free(cubic);
+        free(columns);
+        return 0;
+    }
+
+    if (cubic)
+        init_cubic_weights(cubic);
+
+    for (x = start; x < end; x++)
+        get_taps(&columns[x], x0 + x * transform->x_dx, mode, transform->nearest_offset,
+            (const int (*)[MAX_TAPS])cubic, wrap_x, image);
+
+    for (t = 0; t < ROW_CACHE_SIZE; t++)
+        cache.index[t] = -2;
+    cache.next = 0;
+
+    for (y = 0; y < height; y++)
+    {
+        unsigned int *out = dst + y * dst_stride;
+
+        if (y < row_start || y >= row_end)
+        {
+            memset(out, 0, width * sizeof(*out));
+            continue;
+        }
+
+        memset(out, 0, start * sizeof(*out));
+        memset(out + end, 0, (width - end) * sizeof(*out));
+
+        get_taps(&row_taps, y0 + y * transform->y_dy, mode, transform->nearest_offset,
+            (const int (*)[MAX_TAPS])cubic, wrap_y, image);
+
+        if (mode == RESAMPLE_NEAREST)
+        {
+            const unsigned int *row = row_taps.index[0] >= 0 ? image->bits + row_taps.index[0] * image->width : NULL;
+            unsigned int outside = image->outside_color;
+
+            if (row)
+            {
+                for (x = start; x < end; x++)
+                {
+                    int index = columns[x].index[0];
+                    out[x] = index >= 0 ? row[index] : outside;
+                }
+            }
+            else
+            {
+                for (x = start; x < end; x++)
+                    out[x] = outside;
+            }
+        }
+        else if (mode == RESAMPLE_BILINEAR)
+        {
+            const unsigned int *top, *bottom;
+            unsigned int w = row_taps.weight[1];
+
+            top = get_filtered_row(&cache, image, mode, row_taps.index[0], columns, start, end, width, 0);
+            if (!w)
+            {
+                memcpy(out + start, top + start, (end - start) * sizeof(*out));
+                continue;
+            }
+
+            in_use = 1 << get_row_slot(&cache, top, width);
+            bottom = get_filtered_row(&cache, image, mode, row_taps.index[1], columns, start, end, width, in_use);
+
+            for (x = start; x < end; x++)
+                out[x] = lerp(top[x], bottom[x], w);
+        }
+        else
+        {
+            const unsigned int *rows[MAX_TAPS];
+            const int *w = row_taps.weight;
+
+            if (w[1] == CUBIC_ONE)
+            {
+                /* Whole pixel position */
+                rows[1] = get_filtered_row(&cache, image, mode, row_taps.index[1], columns, start, end, width, 0);
+                memcpy(out + start, rows[1] + start, (end - start) * sizeof(*out));
+                continue;
+            }
+
+            in_use = 0;
+            for (t = 0; t < MAX_TAPS; t++)
+            {
+                rows[t] = get_filtered_row(&cache, image, mode, row_taps.index[t], columns, start, end, width, in_use);
+                in_use |= 1 << get_row_slot(&cache, rows[t], width);
+            }
+
+            for (x = start; x < end; x++)
+            {
+                int sum[4] = {0, 0, 0, 0};
+
+                cubic_add(sum, rows[0][x], w[0]);
+                cubic_add(sum, rows[1][x], w[1]);
+                cubic_add(sum, rows[2][x], w[2]);
+                cubic_add(sum, rows[3][x], w[3]);
+
+                out[x] = cubic_pack(sum);
+            }
+        }
+    }
+
+    free(cache.rows);
+    free(cubic);
+    free(columns);
+
+    return 1;
+}
+
+static unsigned int sample_bilinear(const struct resample_image *image, fixed sx, fixed sy)
+{
+    unsigned int wx, wy, p00, p01, p10, p11;
+    int x, y;
+
+    wx = get_fixed_phase(sx, &x);
+    wy = get_fixed_phase(sy, &y);
+
+    p00 = fetch(image, x, y);
+    p01 = wx ? fetch(image, x + 1, y) : p00;
+    if (wy)
+    {
+        p10 = fetch(image, x, y + 1);
+        p11 = wx ? fetch(image, x + 1, y + 1) : p10;
+        return lerp(lerp(p00, p01, wx), lerp(p10, p11, wx), wy);
+    }
+
+    return lerp(p00, p01, wx);
+}
+
+/* Filters four pixels of a row, then weights the rounded result for the
+ * vertical pass. Rounding between the passes keeps the sums in 32 bits. */
+static inline void cubic_add_row(int *sum, const unsigned int *p, const int *wx, int wy)
+{
+    int row[4] = {0, 0, 0, 0};
+
+    cubic_add(row, p[0], wx[0]);
+    cubic_add(row, p[1], wx[1]);
+    cubic_add(row, p[2], wx[2]);
+    cubic_add(row, p[3], wx[3]);
+
+    sum[0] += wy * ((row[0] + CUBIC_ROUND) >> CUBIC_BITS);
+    sum[1] += wy * ((row[1] + CUBIC_ROUND) >> CUBIC_BITS);
+    sum[2] += wy * ((row[2] + CUBIC_ROUND) >> CUBIC_BITS);
+    sum[3] += wy * ((row[3] + CUBIC_ROUND) >> CUBIC_BITS);
+}
+
+static unsigned int sample_bicubic(const struct resample_image *image, const int (*cubic)[MAX_TAPS],
+    fixed sx, fixed sy)
+{
+    const unsigned int *p;
+    const int *wx, *wy;
+    int x, y, i, j, sum[4] = {0, 0, 0, 0};
+
+    wx = cubic[get_fixed_phase(sx, &x)];
+    wy = cubic[get_fixed_phase(sy, &y)];
+
+    /* Most samples don't need any wrapping, their rows are read in place */
+    if ((unsigned int)(x - 1 - image->x) <= (unsigned int)(image->width - MAX_TAPS) &&
+        (unsigned int)(y - 1 - image->y) <= (unsigned int)(image->height - MAX_TAPS))
+    {
+        p = image->bits + (y - 1 - image->y) * image->width + (x - 1 - image->x);
+
+        cubic_add_row(sum, p, wx, wy[0]);
+        cubic_add_row(sum, p + image->width, wx, wy[1]);
+        cubic_add_row(sum, p + image->width * 2, wx, wy[2]);
+        cubic_add_row(sum, p + image->width * 3, wx, wy[3]);
+
+        return cubic_pack(sum);
+    }
+
+    for (j = 0; j < MAX_TAPS; j++)
+    {
+        unsigned int row[MAX_TAPS];
+
+        for (i = 0; i < MAX_TAPS; i++)
+            row[i] = fetch(image, x - 1 + i, y - 1 + j);
+
+        cubic_add_row(sum, row, wx, wy[j]);
+    }
+
+    return cubic_pack(sum);
+}
+
+/* Rotations and shears, the source position is stepped in fixed point
+ * along each destination row */
+static int resample_affine(const struct resample_image *image, const struct resample_transform *transform,
+    enum resample_mode mode, int dst_x, int dst_y, unsigned int width, unsigned int height,
+    unsigned int *dst, unsigned int dst_stride)
+{
+    int (*cubic)[MAX_TAPS] = NULL;
+    fixed step_x = to_fixed(transform->x_dx), step_y = to_fixed(transform->x_dy);
+    fixed left = (fixed)ceil(transform->left * FIXED_ONE), right = (fixed)ceil(transform->right * FIXED_ONE);
+    fixed top = (fixed)ceil(transform->top * FIXED_ONE), bottom = (fixed)ceil(transform->bottom * FIXED_ONE);
+    fixed offset = to_fixed(transform->nearest_offset);
+    unsigned int x, y;
+
+    if (mode == RESAMPLE_BICUBIC)
+    {
+        cubic = malloc(PHASES * sizeof(*cubic));
+        if (!cubic) return 0;
+        init_cubic_weights(cubic);
+    }
+
+    for (y = 0; y < height; y++)
+    {
+        unsigned int *out = dst + y * dst_stride;
+        fixed sx = to_fixed(transform->x0 + dst_x * transform->x_dx + (dst_y + (int)y) * transform->y_dx);
+        fixed sy = to_fixed(transform->y0 + dst_x * transform->x_dy + (dst_y + (int)y) * transform->y_dy);
+
+        for (x = 0; x < width; x++, sx += step_x, sy += step_y)
+        {
+            if (sx < left || sx >= right || sy < top || sy >= bottom)
+            {
+                out[x] = 0;
+                continue;
+            }
+
+            switch (mode)
+            {
+            case RESAMPLE_NEAREST:
+                out[x] = fetch(image, fixed_int(sx + offset), fixed_int(sy + offset));
+                break;
+            case RESAMPLE_BILINEAR:
+                out[x] = sample_bilinear(image, sx, sy);
+                break;
+            case RESAMPLE_BICUBIC:
+                out[x] = sample_bicubic(image, (const int (*)[MAX_TAPS])cubic, sx, sy);
+                break;
+            }
+        }
+    }
+
+    free(cubic);
+
+    return 1;
+}
+
+int resample_draw(const struct resample_image *image, const struct resample_transform *transform,
+    enum resample_mode mode, int dst_x, int dst_y, unsigned int dst_width, unsigned int dst_height,
+    unsigned int *dst, unsigned int dst_stride)
+{
+    if (!dst_width || !dst_height)
+        return 1;
+
+    if (transform->x_dy == 0.0 && transform->y_dx == 0.0)
+        return resample_axis_aligned(image, transform, mode, dst_x, dst_y, dst_width, dst_height, dst, dst_stride);
+
+    return resample_affine(image, transform, mode, dst_x, dst_y, dst_width, dst_height, dst, dst_stride);
+}
+
+/* Same as color_over in gdiplus_private.h */
+static inline unsigned int argb_over(unsigned int bg, unsigned int fg)
+{
+    unsigned int b, g, r, a, bg_alpha, fg_alpha = fg >> 24;
+
+    if (fg_alpha == 0xff) return fg;
+
+    bg_alpha = ((bg >> 24) * (0xff - fg_alpha)) / 0xff;
+
+    if (bg_alpha == 0) return fg;
+
+    a = bg_alpha + fg_alpha;
+    b = ((bg & 0xff) * bg_alpha + (fg & 0xff) * fg_alpha) / a;
+    g = (((bg >> 8) & 0xff) * bg_alpha + ((fg >> 8) & 0xff) * fg_alpha) / a;
+    r = (((bg >> 16) & 0xff) * bg_alpha + ((fg >> 16) & 0xff) * fg_alpha) / a;
+
+    return (a << 24) | ((r & 0xff) << 16) | ((g & 0xff) << 8) | (b & 0xff);
+}
+
+/* Same as color_over_fgpremult in gdiplus_private.h */
+static inline unsigned int argb_over_fgpremult(unsigned int bg, unsigned int fg)
+{
+    unsigned int b, g, r, a, bg_alpha, fg_alpha = fg >> 24;
+
+    if (fg_alpha == 0xff) return fg;
+
+    bg_alpha = ((bg >> 24) * (0xff - fg_alpha)) / 0xff;
+
+    a = bg_alpha + fg_alpha;
+    b = ((bg & 0xff) * bg_alpha + (fg & 0xff) * 0xff) / a;
+    g = (((bg >> 8) & 0xff) * bg_alpha + ((fg >> 8) & 0xff) * 0xff) / a;
+    r = (((bg >> 16) & 0xff) * bg_alpha + ((fg >> 16) & 0xff) * 0xff) / a;
+
+    return (a << 24) | ((r & 0xff) << 16) | ((g & 0xff) << 8) | (b & 0xff);
+}
+
+/* (bg * bg_k + fg * fg_k) / 255 for each channel, rounded down. The
+ * sums of two channels fit in one word without carrying into the next
+ * as long as the result fits in a byte. */
+static inline unsigned int blend_channels(unsigned int bg, unsigned int bg_k, unsigned int fg, unsigned int fg_k)
+{
+    unsigned int rb, ag;
+
+    rb = (bg & 0x00ff00ff) * bg_k + (fg & 0x00ff00ff) * fg_k;
+    ag = ((bg >> 8) & 0x00ff00ff) * bg_k + ((fg >> 8) & 0x00ff00ff) * fg_k;
+
+    rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    ag = (ag + 0x00010001 + ((ag >> 8) & 0x00ff00ff)) & 0xff00ff00;
+
+    return rb | ag;
+}
+
+void resample_blend_row(unsigned int *dst, const unsigned int *src, unsigned int count,
+    int src_premultiplied, enum resample_blend dst_format)
+{
+    const unsigned int *end = src + count;
+    unsigned int alpha_mask = dst_format == RESAMPLE_BLEND_RGB ? 0x00ffffff : 0xffffffff;
+    unsigned int fg, fg_alpha;
+
+    for (; src < end; src++, dst++)
+    {
+        fg = *src;
+        fg_alpha = fg >> 24;
+
+        if (!fg_alpha) continue;
+
+        if (fg_alpha == 0xff)
+        {
+            *dst = fg & alpha_mask;
+            continue;
+        }
+
+        switch (dst_format)
+        {
+        case RESAMPLE_BLEND_ARGB:
+            *dst = src_premultiplied ? argb_over_fgpremult(*dst, fg) : argb_over(*dst, fg);
+            break;
+        case RESAMPLE_BLEND_PARGB:
+        case RESAMPLE_BLEND_RGB:
+            /* Over an opaque background this gives the same result as
+             * color_over, the alpha of fg is used as a color of 0xff */
+            if (src_premultiplied)
+                *dst = blend_channels(*dst | ~alpha_mask, 0xff - fg_alpha, fg, 0xff) & alpha_mask;
+            else
+                *dst = blend_channels(*dst | ~alpha_mask, 0xff - fg_alpha, fg | 0xff000000, fg_alpha) & alpha_mask;
+            break;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ * Image resampling for GdipDrawImage*
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef GDIPLUS_RESAMPLE_H
+#define GDIPLUS_RESAMPLE_H
+
+/* This file and resample.c don't depend on any Windows header, so the
+ * drawing pipeline can be built and tested on the host. Pixels are
+ * 32-bit 0xAARRGGBB values. */
+
+enum resample_mode
+{
+    RESAMPLE_NEAREST,
+    RESAMPLE_BILINEAR,
+    RESAMPLE_BICUBIC
+};
+
+/* Same values as WrapMode */
+#define RESAMPLE_WRAP_FLIP_X 1
+#define RESAMPLE_WRAP_FLIP_Y 2
+#define RESAMPLE_WRAP_CLAMP  4
+
+/* The part of a source image that was read into memory. Pixels must be
+ * premultiplied for the bilinear and bicubic modes. */
+struct resample_image
+{
+    const unsigned int *bits;
+    int x, y, width, height;        /* area of the image held in bits */
+    int image_width, image_height;
+    unsigned int wrap;
+    unsigned int outside_color;     /* returned outside the image with RESAMPLE_WRAP_CLAMP */
+};
+
+/* Maps destination pixel (x, y) to the source position
+ * (x0 + x * x_dx + y * y_dx, y0 + x * x_dy + y * y_dy). Destination
+ * pixels that map outside of left, top, right, bottom are transparent. */
+struct resample_transform
+{
+    double x0, y0;
+    double x_dx, x_dy, y_dx, y_dy;
+    double left, top, right, bottom;
+    double nearest_offset;          /* added before rounding down in RESAMPLE_NEAREST */
+};
+
+/* Resamples the destination rectangle at dst_x, dst_y into dst, which
+ * has a stride of dst_stride pixels. Returns 0 when out of memory. */
+int resample_draw(const struct resample_image *image, const struct resample_transform *transform,
+    enum resample_mode mode, int dst_x, int dst_y, unsigned int dst_width, unsigned int dst_height,
+    unsigned int *dst, unsigned int dst_stride);
+
+/* Destination layouts for resample_blend_row */
+enum resample_blend
+{
+    RESAMPLE_BLEND_ARGB,
+    RESAMPLE_BLEND_PARGB,
+    RESAMPLE_BLEND_RGB              /* opaque, the alpha byte is written as 0 */
+};
+
+/* Draws count source pixels over dst */
+void resample_blend_row(unsigned int *dst, const unsigned int *src, unsigned int count,
+    int src_premultiplied, enum resample_blend dst_format);
+
+#endif /* GDIPLUS_RESAMPLE_H */
@@ -34,6 +34,14 @@ typedef struct {
     jsdisp_t dispex;
 
     DWORD length;
+
+    /* Elements below elems_cnt are kept in elems until the array gets a hole
+     * or a non-default index property. From then on the array is sparse and
+     * all elements are ordinary properties. */
+    jsval_t *elems;
+    DWORD elems_cnt;
+    DWORD elems_size;
+    BOOL sparse;
 } ArrayInstance;
 
 static const WCHAR lengthW[] = {'l','e','n','g','t','h',0};
@@ -130,6 +138,91 @@ static WCHAR *idx_to_str(DWORD idx, WCHAR *ptr)
     return ptr+1;
 }
 
+static BOOL ensure_elems(ArrayInstance *array, DWORD size)
+{
+    jsval_t *new_elems;
+    DWORD new_size;
+
+    if(size <= array->elems_size)
+        return TRUE;
+
+    new_size = max(size, max(array->elems_size*2, 4));
+    if(new_size > UINT_MAX / sizeof(*new_elems))
+        return FALSE;
+
+    new_elems = heap_realloc(array->elems, new_size * sizeof(*new_elems));
+    if(!new_elems)
+        return FALSE;
+
+    array->elems = new_elems;
+    array->elems_size = new_size;
+    return TRUE;
+}
+
+/* Returns the array if all its elements are in dense storage */
+static ArrayInstance *get_dense_array(jsdisp_t *jsthis)
+{
+    ArrayInstance *array;
+
+    if(!is_class(jsthis, JSCLASS_ARRAY))
+        return NULL;
+
+    array = array_from_jsdisp(jsthis);
+    return !array->sparse && array->elems_cnt == array->length ? array : NULL;
+}
+
+static HRESULT put_prop_idx(ArrayInstance *array, DWORD idx, jsval_t val)
+{
+    WCHAR buf[14], *buf_end;
+
+    buf_end = buf + ARRAY_SIZE(buf)-1;
+    *buf_end-- = 0;
+    return jsdisp_propput_name(&array->dispex, idx_to_str(idx, buf_end), val);
+}
+
+static HRESULT Array_idx_to_props(jsdisp_t *jsdisp)
+{
+    ArrayInstance *array = array_from_jsdisp(jsdisp);
+    jsval_t *elems = array->elems;
+    DWORD i, cnt = array->elems_cnt;
+    HRESULT hres = S_OK;
+
+    if(array->sparse)
+        return S_OK;
+
+    TRACE("%p %u elements\n", array, cnt);
+
+    array->sparse = TRUE;
+    array->elems = NULL;
+    array->elems_cnt = array->elems_size = 0;
+
+    for(i = 0; i < cnt; i++) {
+        if(SUCCEEDED(hres))
+            hres = put_prop_idx(array, i, elems[i]);
+        jsval_release(elems[i]);
+    }
+
+    heap_free(elems);
+    return hres;
+}
+
+/* Like jsdisp_delete_idx, but removing the last element keeps the array dense */
+static HRESULT delete_idx(jsdisp_t *jsthis, DWORD idx)
+{
+    if(is_class(jsthis, JSCLASS_ARRAY)) {
+        ArrayInstance *array = array_from_jsdisp(jsthis);
+
+        if(!array->sparse && idx >= array->elems_cnt)
+            return S_OK;
+        if(!array->sparse && idx == array->elems_cnt-1) {
+            jsval_release(array->elems[--array->elems_cnt]);
+            return S_OK;
+        }
+    }
+
+    return jsdisp_delete_idx(jsthis, idx);
+}
+
 static HRESULT Array_get_length(script_ctx_t *ctx, jsdisp_t *jsthis, jsval_t *r)
 {
     TRACE("%p\n", jsthis);
@@ -155,10 +248,15 @@ static HRESULT Array_set_length(script_ctx_t *ctx, jsdisp_t *jsthis, jsval_t val
     if(len!=(DWORD)len)
         return throw_range_error(ctx, JS_E_INVALID_LENGTH, NULL);
 
-    for(i=len; i < This->length; i++) {
-        hres = jsdisp_delete_idx(&This->dispex, i);
-        if(FAILED(hres))
-            return hres;
+    if(!This->sparse) {
+        while(This->elems_cnt > (DWORD)len)
+            jsval_release(This->elems[--This->elems_cnt]);
+    }else {
+        for(i=len; i < This->length; i++) {
+            hres = jsdisp_delete_idx(&This->dispex, i);
+            if(FAILED(hres))
+                return hres;
+        }
     }
 
     This->length = len;
@@ -391,7 +489,7 @@ static HRESULT Array_pop(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned
     length--;
     hres = jsdisp_get_idx(jsthis, length, &val);
     if(SUCCEEDED(hres))
-        hres = jsdisp_delete_idx(jsthis, length);
+        hres = delete_idx(jsthis, length);
     else if(hres == DISP_E_UNKNOWNNAME) {
         val = jsval_undefined();
         hres = S_OK;
@@ -471,7 +569,7 @@ static HRESULT Array_reverse(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
         }
 
         if(hres1 == DISP_E_UNKNOWNNAME)
-            hres1 = jsdisp_delete_idx(jsthis, l);
+            hres1 = delete_idx(jsthis, l);
         else
             hres1 = jsdisp_propput_idx(jsthis, l, v1);
 
@@ -482,7 +580,7 @@ static HRESULT Array_reverse(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
         }
 
         if(hres2 == DISP_E_UNKNOWNNAME)
-            hres2 = jsdisp_delete_idx(jsthis, k);
+            hres2 = delete_idx(jsthis, k);
         else
             hres2 = jsdisp_propput_idx(jsthis, k, v2);
 
@@ -501,6 +599,7 @@ static HRESULT Array_reverse(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
 static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
     DWORD length = 0, i;
     jsval_t v, ret;
@@ -522,6 +621,18 @@ static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsign
         return S_OK;
     }
 
+    if((array = get_dense_array(jsthis))) {
+        ret = array->elems[0];
+        memmove(array->elems, array->elems+1, (length-1)*sizeof(*array->elems));
+        array->elems_cnt = array->length = length-1;
+
+        if(r)
+            *r = ret;
+        else
+            jsval_release(ret);
+        return S_OK;
+    }
+
     hres = jsdisp_get_idx(jsthis, 0, &ret);
     if(hres == DISP_E_UNKNOWNNAME) {
         ret = jsval_undefined();
@@ -531,13 +642,13 @@ static HRESULT Array_shift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsign
     for(i=1; SUCCEEDED(hres) && i<length; i++) {
         hres = jsdisp_get_idx(jsthis, i, &v);
         if(hres == DISP_E_UNKNOWNNAME)
-            hres = jsdisp_delete_idx(jsthis, i-1);
+            hres = delete_idx(jsthis, i-1);
         else if(SUCCEEDED(hres))
             hres = jsdisp_propput_idx(jsthis, i-1, v);
     }
 
     if(SUCCEEDED(hres)) {
-        hres = jsdisp_delete_idx(jsthis, length-1);
+        hres = delete_idx(jsthis, length-1);
         if(SUCCEEDED(hres))
             hres = set_length(jsthis, length-1);
     }
@@ -823,12 +934,40 @@ static HRESULT Array_sort(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigne
     return S_OK;
 }
 
+/* Replaces delete_cnt elements at start with add_cnt new ones */
+static HRESULT splice_dense(ArrayInstance *array, DWORD start, DWORD delete_cnt, unsigned add_cnt, jsval_t *add)
+{
+    DWORD i, length = array->elems_cnt;
+    HRESULT hres = S_OK;
+
+    if(add_cnt > delete_cnt && !ensure_elems(array, length - delete_cnt + add_cnt))
+        return E_OUTOFMEMORY;
+
+    for(i = start; i < start+delete_cnt; i++)
+        jsval_release(array->elems[i]);
+
+    memmove(array->elems+start+add_cnt, array->elems+start+delete_cnt,
+            (length-start-delete_cnt)*sizeof(*array->elems));
+
+    for(i = 0; i < add_cnt; i++) {
+        HRESULT copy_hres = jsval_copy(add[i], array->elems+start+i);
+        if(FAILED(copy_hres)) {
+            array->elems[start+i] = jsval_undefined();
+            hres = copy_hres;
+        }
+    }
+
+    array->elems_cnt = array->length = length - delete_cnt + add_cnt;
+    return hres;
+}
+
 /* ECMA-262 3rd Edition    15.4.4.12 */
 static HRESULT Array_splice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
     DWORD length, start=0, delete_cnt=0, i, add_args = 0;
     jsdisp_t *ret_array = NULL, *jsthis;
+    ArrayInstance *array;
     jsval_t val;
     double d;
     int n;
@@ -889,11 +1028,24 @@ static HRESULT Array_splice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsig
             hres = jsdisp_propput_name(ret_array, lengthW, jsval_number(delete_cnt));
     }
 
+    if(SUCCEEDED(hres) && (array = get_dense_array(jsthis))) {
+        hres = splice_dense(array, start, delete_cnt, add_args, argv+2);
+        if(FAILED(hres)) {
+            if(ret_array)
+                jsdisp_release(ret_array);
+            return hres;
+        }
+
+        if(r)
+            *r = jsval_obj(ret_array);
+        return S_OK;
+    }
+
     if(add_args < delete_cnt) {
         for(i = start; SUCCEEDED(hres) && i < length-delete_cnt; i++) {
             hres = jsdisp_get_idx(jsthis, i+delete_cnt, &val);
             if(hres == DISP_E_UNKNOWNNAME) {
-                hres = jsdisp_delete_idx(jsthis, i+add_args);
+                hres = delete_idx(jsthis, i+add_args);
             }else if(SUCCEEDED(hres)) {
                 hres = jsdisp_propput_idx(jsthis, i+add_args, val);
                 jsval_release(val);
@@ -901,12 +1053,12 @@ static HRESULT Array_splice(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsig
         }
 
         for(i=length; SUCCEEDED(hres) && i != length-delete_cnt+add_args; i--)
-            hres = jsdisp_delete_idx(jsthis, i-1);
+            hres = delete_idx(jsthis, i-1);
     }else if(add_args > delete_cnt) {
         for(i=length-delete_cnt; SUCCEEDED(hres) && i != start; i--) {
             hres = jsdisp_get_idx(jsthis, i+delete_cnt-1, &val);
             if(hres == DISP_E_UNKNOWNNAME) {
-                hres = jsdisp_delete_idx(jsthis, i+add_args-1);
+                hres = delete_idx(jsthis, i+add_args-1);
             }else if(SUCCEEDED(hres)) {
                 hres = jsdisp_propput_idx(jsthis, i+add_args-1, val);
                 jsval_release(val);
@@ -1121,6 +1273,7 @@ static HRESULT Array_map(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned
 static HRESULT Array_unshift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsigned argc, jsval_t *argv,
         jsval_t *r)
 {
+    ArrayInstance *array;
     jsdisp_t *jsthis;
     WCHAR buf[14], *buf_end, *str;
     DWORD i, length;
@@ -1134,6 +1287,16 @@ static HRESULT Array_unshift(script_ctx_t *ctx, vdisp_t *vthis, WORD flags, unsi
     if(FAILED(hres))
         return hres;
 
+    if(argc && (array = get_dense_array(jsthis))) {
+        hres = splice_dense(array, 0, 0, argc, argv);
+        if(FAILED(hres))
+            return hres;
+
+        if(r)
+            *r = ctx->version < 2 ? jsval_undefined() : jsval_number(array->length);
+        return S_OK;
+    }
+
     if(argc) {
         buf_end = buf + ARRAY_SIZE(buf)-1;
         *buf_end-- = 0;
@@ -1189,30 +1352,88 @@ static HRESULT Array_get_value(script_ctx_t *ctx, jsdisp_t *jsthis, jsval_t *r)
 
 static void Array_destructor(jsdisp_t *dispex)
 {
-    heap_free(dispex);
+    ArrayInstance *array = array_from_jsdisp(dispex);
+    DWORD i;
+
+    for(i = 0; i < array->elems_cnt; i++)
+        jsval_release(array->elems[i]);
+    heap_free(array->elems);
+    heap_free(array);
 }
 
 static void Array_on_put(jsdisp_t *dispex, const WCHAR *name)
 {
     ArrayInstance *array = array_from_jsdisp(dispex);
-    const WCHAR *ptr = name;
-    DWORD id = 0;
+    unsigned id;
 
-    if(!iswdigit(*ptr))
+    if(!idx_from_name(name, &id))
         return;
 
-    while(*ptr && iswdigit(*ptr)) {
-        id = id*10 + (*ptr-'0');
-        ptr++;
-    }
-
-    if(*ptr)
-        return;
+    /* An element was stored in the property table */
+    if(!array->sparse && FAILED(Array_idx_to_props(dispex)))
+        WARN("Could not move elements to property table\n");
 
     if(id >= array->length)
         array->length = id+1;
 }
 
+static unsigned Array_idx_length(jsdisp_t *dispex)
+{
+    return array_from_jsdisp(dispex)->elems_cnt;
+}
+
+static HRESULT Array_idx_get(jsdisp_t *dispex, unsigned idx, jsval_t *r)
+{
+    ArrayInstance *array = array_from_jsdisp(dispex);
+
+    if(idx >= array->elems_cnt) {
+        *r = jsval_undefined();
+        return S_OK;
+    }
+
+    return jsval_copy(array->elems[idx], r);
+}
+
+static HRESULT Array_idx_put(jsdisp_t *dispex, unsigned idx, jsval_t val)
+{
+    ArrayInstance *array = array_from_jsdisp(dispex);
+    jsval_t copy;
+    HRESULT hres;
+
+    if(!array->sparse) {
+        if(idx < array->elems_cnt) {
+            hres = jsval_copy(val, &copy);
+            if(FAILED(hres))
+                return hres;
+
+            jsval_release(array->elems[idx]);
+            array->elems[idx] = copy;
+            return S_OK;
+        }
+
+        if(idx == array->elems_cnt) {
+            if(!ensure_elems(array, idx+1))
+                return E_OUTOFMEMORY;
+
+            hres = jsval_copy(val, array->elems+idx);
+            if(FAILED(hres))
+                return hres;
+
+            array->elems_cnt++;
+            if(idx >= array->length)
+                array->length = idx+1;
+            return S_OK;
+        }
+
+        /* The new element would leave a hole */
+        hres = Array_idx_to_props(dispex);
+        if(FAILED(hres))
+            return hres;
+    }
+
+    return put_prop_idx(array, idx, val);
+}
+
 static const builtin_prop_t Array_props[] = {
     {concatW,                Array_concat,               PROPF_METHOD|1},
     {forEachW,               Array_forEach,              PROPF_METHOD|PROPF_ES5|1},
@@ -1238,7 +1459,11 @@ static const builtin_info_t Array_info = {
     ARRAY_SIZE(Array_props),
     Array_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_idx_to_props
 };
 
 static const builtin_prop_t ArrayInst_props[] = {
@@ -1251,7 +1476,11 @@ static const builtin_info_t ArrayInst_info = {
     ARRAY_SIZE(ArrayInst_props),
     ArrayInst_props,
     Array_destructor,
-    Array_on_put
+    Array_on_put,
+    Array_idx_length,
+    Array_idx_get,
+    Array_idx_put,
+    Array_idx_to_props
 };
 
 /* ECMA-262 5.1 Edition    15.4.3.2 */
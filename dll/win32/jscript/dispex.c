@@ -125,6 +125,49 @@ static inline unsigned string_hash(const WCHAR *name)
     return h;
 }
 
+BOOL idx_from_name(const WCHAR *name, unsigned *ret)
+{
+    const WCHAR *ptr = name;
+    unsigned idx = 0;
+
+    /* Only canonical array indexes, so "01" and "4294967295" are plain names */
+    if(*ptr < '0' || *ptr > '9' || (*ptr == '0' && ptr[1]))
+        return FALSE;
+
+    for(; *ptr; ptr++) {
+        if(*ptr < '0' || *ptr > '9' || idx > (0xfffffffe - (*ptr-'0')) / 10)
+            return FALSE;
+        idx = idx*10 + (*ptr-'0');
+    }
+
+    *ret = idx;
+    return TRUE;
+}
+
+static inline DWORD get_idx_flags(jsdisp_t *This)
+{
+    if(This->builtin_info->idx_to_props)
+        return PROPF_ENUMERABLE | PROPF_WRITABLE | PROPF_CONFIGURABLE;
+    return This->builtin_info->idx_put ? PROPF_WRITABLE : 0;
+}
+
+/* Indexed properties may come and go without the property table being
+ * updated, so fix up the entry when it's looked up. */
+static void check_idx_prop(jsdisp_t *This, dispex_prop_t *prop)
+{
+    unsigned idx;
+
+    if(prop->type == PROP_IDX) {
+        if(prop->u.idx >= This->builtin_info->idx_length(This))
+            prop->type = PROP_DELETED;
+    }else if((prop->type == PROP_DELETED || prop->type == PROP_PROTREF)
+             && idx_from_name(prop->name, &idx) && idx < This->builtin_info->idx_length(This)) {
+        prop->type = PROP_IDX;
+        prop->flags = get_idx_flags(This);
+        prop->u.idx = idx;
+    }
+}
+
 static inline unsigned get_props_idx(jsdisp_t *This, unsigned hash)
 {
     return (hash*GOLDEN_RATIO) & (This->buf_size-1);
@@ -211,6 +254,8 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
             }
 
             *ret = &This->props[pos];
+            if(This->builtin_info->idx_length)
+                check_idx_prop(This, *ret);
             return S_OK;
         }
 
@@ -236,13 +281,10 @@ static HRESULT find_prop_name(jsdisp_t *This, unsigned hash, const WCHAR *name,
     }
 
     if(This->builtin_info->idx_length) {
-        const WCHAR *ptr;
-        unsigned idx = 0;
+        unsigned idx;
 
-        for(ptr = name; iswdigit(*ptr) && idx < 0x10000; ptr++)
-            idx = idx*10 + (*ptr-'0');
-        if(!*ptr && idx < This->builtin_info->idx_length(This)) {
-            prop = alloc_prop(This, name, PROP_IDX, This->builtin_info->idx_put ? PROPF_WRITABLE : 0);
+        if(idx_from_name(name, &idx) && idx < This->builtin_info->idx_length(This)) {
+            prop = alloc_prop(This, name, PROP_IDX, get_idx_flags(This));
             if(!prop)
                 return E_OUTOFMEMORY;
 
@@ -298,8 +340,17 @@ static HRESULT find_prop_name_prot(jsdisp_t *This, unsigned hash, const WCHAR *n
 static HRESULT ensure_prop_name(jsdisp_t *This, const WCHAR *name, DWORD create_flags, dispex_prop_t **ret)
 {
     dispex_prop_t *prop;
+    unsigned idx;
     HRESULT hres;
 
+    /* New indexed properties that don't fit in indexed storage go to the property table */
+    if(This->builtin_info->idx_to_props && idx_from_name(name, &idx)
+       && idx >= This->builtin_info->idx_length(This)) {
+        hres = This->builtin_info->idx_to_props(This);
+        if(FAILED(hres))
+            return hres;
+    }
+
     hres = find_prop_name_prot(This, string_hash(name), name, &prop);
     if(SUCCEEDED(hres) && (!prop || prop->type == PROP_DELETED)) {
         TRACE("creating prop %s flags %x\n", debugstr_w(name), create_flags);
@@ -784,8 +835,20 @@ static HRESULT WINAPI DispatchEx_InvokeEx(IDispatchEx *iface, DISPID id, LCID lc
     return hres;
 }
 
-static HRESULT delete_prop(dispex_prop_t *prop, BOOL *ret)
+static HRESULT delete_prop(jsdisp_t *This, dispex_prop_t *prop, BOOL *ret)
 {
+    if(prop->type == PROP_IDX && This->builtin_info->idx_to_props) {
+        DISPID id = prop_to_id(This, prop);
+        HRESULT hres;
+
+        hres = This->builtin_info->idx_to_props(This);
+        if(FAILED(hres))
+            return hres;
+
+        /* The property table may have been reallocated */
+        prop = This->props + id;
+    }
+
     if(!(prop->flags & PROPF_CONFIGURABLE)) {
         *ret = FALSE;
         return S_OK;
@@ -822,7 +885,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByName(IDispatchEx *iface, BSTR bst
         return S_OK;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID id)
@@ -839,7 +902,7 @@ static HRESULT WINAPI DispatchEx_DeleteMemberByDispID(IDispatchEx *iface, DISPID
         return DISP_E_MEMBERNOTFOUND;
     }
 
-    return delete_prop(prop, &b);
+    return delete_prop(This, prop, &b);
 }
 
 static HRESULT WINAPI DispatchEx_GetMemberProperties(IDispatchEx *iface, DISPID id, DWORD grfdexFetch, DWORD *pgrfdex)
@@ -1086,6 +1149,30 @@ HRESULT jsdisp_get_id(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, DISPID *
     return DISP_E_UNKNOWNNAME;
 }
 
+/* Like jsdisp_get_id, but *cache holds the DISPID found by a previous lookup of the same name.
+ * Properties never move in the property table and objects built the same way share their
+ * layout, so checking that entry is usually enough and spares hashing the name. */
+HRESULT jsdisp_get_id_cached(jsdisp_t *jsdisp, const WCHAR *name, DWORD flags, unsigned *cache, DISPID *id)
+{
+    dispex_prop_t *prop;
+    HRESULT hres;
+
+    if(*cache < jsdisp->prop_cnt) {
+        prop = jsdisp->props + *cache;
+        if(prop->name && jsdisp->builtin_info->idx_length)
+            check_idx_prop(jsdisp, prop);
+        if(prop->name && prop->type != PROP_DELETED && !wcscmp(prop->name, name)) {
+            *id = *cache;
+            return S_OK;
+        }
+    }
+
+    hres = jsdisp_get_id(jsdisp, name, flags, id);
+    if(SUCCEEDED(hres))
+        *cache = *id;
+    return hres;
+}
+
 HRESULT jsdisp_call_value(jsdisp_t *jsfunc, IDispatch *jsthis, WORD flags, unsigned argc, jsval_t *argv, jsval_t *r)
 {
     HRESULT hres;
@@ -1350,7 +1437,11 @@ HRESULT jsdisp_propput_idx(jsdisp_t *obj, DWORD idx, jsval_t val)
 {
     WCHAR buf[12];
 
-    static const WCHAR formatW[] = {'%','d',0};
+    static const WCHAR formatW[] = {'%','u',0};
+
+    /* Indexed storage may also be appended to */
+    if(obj->builtin_info->idx_to_props && idx <= obj->builtin_info->idx_length(obj))
+        return obj->builtin_info->idx_put(obj, idx, val);
 
     swprintf(buf, formatW, idx);
     return jsdisp_propput_name(obj, buf, val);
@@ -1428,7 +1519,10 @@ HRESULT jsdisp_get_idx(jsdisp_t *obj, DWORD idx, jsval_t *r)
     dispex_prop_t *prop;
     HRESULT hres;
 
-    static const WCHAR formatW[] = {'%','d',0};
+    static const WCHAR formatW[] = {'%','u',0};
+
+    if(obj->builtin_info->idx_to_props && idx < obj->builtin_info->idx_length(obj))
+        return obj->builtin_info->idx_get(obj, idx, r);
 
     swprintf(name, formatW, idx);
 
@@ -1493,7 +1587,7 @@ HRESULT disp_propget(script_ctx_t *ctx, IDispatch *disp, DISPID id, jsval_t *val
 
 HRESULT jsdisp_delete_idx(jsdisp_t *obj, DWORD idx)
 {
-    static const WCHAR formatW[] = {'%','d',0};
+    static const WCHAR formatW[] = {'%','u',0};
     WCHAR buf[12];
     dispex_prop_t *prop;
     BOOL b;
@@ -1505,7 +1599,7 @@ HRESULT jsdisp_delete_idx(jsdisp_t *obj, DWORD idx)
     if(FAILED(hres) || !prop)
         return hres;
 
-    return delete_prop(prop, &b);
+    return delete_prop(obj, prop, &b);
 }
 
 HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
@@ -1520,7 +1614,7 @@ HRESULT disp_delete(IDispatch *disp, DISPID id, BOOL *ret)
 
         prop = get_prop(jsdisp, id);
         if(prop)
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         else
             hres = DISP_E_MEMBERNOTFOUND;
 
@@ -1554,12 +1648,47 @@ HRESULT jsdisp_next_prop(jsdisp_t *obj, DISPID id, BOOL own_only, DISPID *ret)
             return hres;
     }
 
+    /* Indexed elements are enumerated first, in index order, followed by the rest of the property table. */
+    if(obj->builtin_info->idx_to_props) {
+        unsigned idx;
+
+        if(id == DISPID_STARTENUM) {
+            idx = 0;
+        }else if(id >= 0 && id < obj->prop_cnt) {
+            iter = obj->props + id;
+            if(iter->name)
+                check_idx_prop(obj, iter);
+            idx = iter->type == PROP_IDX ? iter->u.idx + 1 : UINT_MAX;
+        }else {
+            return S_FALSE;
+        }
+
+        if(idx != UINT_MAX) {
+            if(idx < obj->builtin_info->idx_length(obj)) {
+                static const WCHAR formatW[] = {'%','u',0};
+                WCHAR name[12];
+
+                swprintf(name, formatW, idx);
+                hres = find_prop_name(obj, string_hash(name), name, &iter);
+                if(FAILED(hres))
+                    return hres;
+                *ret = prop_to_id(obj, iter);
+                return S_OK;
+            }
+            id = DISPID_STARTENUM;
+        }
+    }
+
     if(id + 1 < 0 || id+1 >= obj->prop_cnt)
         return S_FALSE;
 
     for(iter = &obj->props[id + 1]; iter < obj->props + obj->prop_cnt; iter++) {
+        if(iter->name && obj->builtin_info->idx_length)
+            check_idx_prop(obj, iter);
         if(!iter->name || iter->type == PROP_DELETED)
             continue;
+        if(iter->type == PROP_IDX && obj->builtin_info->idx_to_props)
+            continue;
         if(own_only && iter->type == PROP_PROTREF)
             continue;
         if(!(get_flags(obj, iter) & PROPF_ENUMERABLE))
@@ -1591,7 +1720,7 @@ HRESULT disp_delete_name(script_ctx_t *ctx, IDispatch *disp, jsstr_t *name, BOOL
 
         hres = find_prop_name(jsdisp, string_hash(ptr), ptr, &prop);
         if(prop) {
-            hres = delete_prop(prop, ret);
+            hres = delete_prop(jsdisp, prop, ret);
         }else {
             *ret = TRUE;
             hres = S_OK;
@@ -1648,6 +1777,7 @@ HRESULT jsdisp_get_own_property(jsdisp_t *obj, const WCHAR *name, BOOL flags_onl
     switch(prop->type) {
     case PROP_BUILTIN:
     case PROP_JSVAL:
+    case PROP_IDX:
         desc->mask |= PROPF_WRITABLE;
         desc->explicit_value = TRUE;
         if(!flags_only) {
@@ -1677,8 +1807,16 @@ HRESULT jsdisp_get_own_property(jsdisp_t *obj, const WCHAR *name, BOOL flags_onl
 HRESULT jsdisp_define_property(jsdisp_t *obj, const WCHAR *name, property_desc_t *desc)
 {
     dispex_prop_t *prop;
+    unsigned idx;
     HRESULT hres;
 
+    /* Indexed storage holds only plain data properties */
+    if(obj->builtin_info->idx_to_props && idx_from_name(name, &idx)) {
+        hres = obj->builtin_info->idx_to_props(obj);
+        if(FAILED(hres))
+            return hres;
+    }
+
     hres = find_prop_name(obj, string_hash(name), name, &prop);
     if(FAILED(hres))
         return hres;
@@ -53,6 +53,7 @@ typedef struct {
         EXPRVAL_JSVAL,
         EXPRVAL_IDREF,
         EXPRVAL_STACK_REF,
+        EXPRVAL_IDX,
         EXPRVAL_INVALID
     } type;
     union {
@@ -62,6 +63,10 @@ typedef struct {
             DISPID id;
         } idref;
         unsigned off;
+        struct {
+            jsdisp_t *array;
+            unsigned idx;
+        } idx;
         HRESULT hres;
     } u;
 } exprval_t;
@@ -209,6 +214,13 @@ static HRESULT stack_push_exprval(script_ctx_t *ctx, exprval_t *val)
         if(SUCCEEDED(hres))
             hres = stack_push(ctx, jsval_undefined());
         return hres;
+    case EXPRVAL_IDX:
+        hres = stack_push(ctx, jsval_number(val->u.idx.idx));
+        if(SUCCEEDED(hres))
+            hres = stack_push(ctx, jsval_obj(val->u.idx.array));
+        else
+            jsdisp_release(val->u.idx.array);
+        return hres;
     case EXPRVAL_INVALID:
         hres = stack_push(ctx, jsval_undefined());
         if(SUCCEEDED(hres))
@@ -229,6 +241,14 @@ static BOOL stack_topn_exprval(script_ctx_t *ctx, unsigned n, exprval_t *r)
         call_frame_t *frame = ctx->call_ctx;
         unsigned off = get_number(v);
 
+        /* Array element references are stored as (index, array object). */
+        if(is_object_instance(stack_topn(ctx, n))) {
+            r->type = EXPRVAL_IDX;
+            r->u.idx.array = as_jsdisp(get_object(stack_topn(ctx, n)));
+            r->u.idx.idx = off;
+            return TRUE;
+        }
+
         if(!frame->base_scope->frame && off >= frame->arguments_off) {
             DISPID id;
             BSTR name;
@@ -293,6 +313,8 @@ static HRESULT exprval_propput(script_ctx_t *ctx, exprval_t *ref, jsval_t v)
     }
     case EXPRVAL_IDREF:
         return disp_propput(ctx, ref->u.idref.disp, ref->u.idref.id, v);
+    case EXPRVAL_IDX:
+        return jsdisp_propput_idx(ref->u.idx.array, ref->u.idx.idx, v);
     default:
         assert(0);
         return E_FAIL;
@@ -306,6 +328,12 @@ static HRESULT exprval_propget(script_ctx_t *ctx, exprval_t *ref, jsval_t *r)
         return jsval_copy(ctx->stack[ref->u.off], r);
     case EXPRVAL_IDREF:
         return disp_propget(ctx, ref->u.idref.disp, ref->u.idref.id, r);
+    case EXPRVAL_IDX: {
+        HRESULT hres;
+
+        hres = jsdisp_get_idx(ref->u.idx.array, ref->u.idx.idx, r);
+        return hres == DISP_E_UNKNOWNNAME ? S_OK : hres;
+    }
     default:
         assert(0);
         return E_FAIL;
@@ -327,6 +355,24 @@ static HRESULT exprval_call(script_ctx_t *ctx, exprval_t *ref, WORD flags, unsig
     }
     case EXPRVAL_IDREF:
         return disp_call(ctx, ref->u.idref.disp, ref->u.idref.id, flags, argc, argv, r);
+    case EXPRVAL_IDX: {
+        jsval_t v;
+        HRESULT hres;
+
+        hres = jsdisp_get_idx(ref->u.idx.array, ref->u.idx.idx, &v);
+        if(FAILED(hres) && hres != DISP_E_UNKNOWNNAME)
+            return hres;
+
+        if(!is_object_instance(v)) {
+            FIXME("invoke %s\n", debugstr_jsval(v));
+            jsval_release(v);
+            return E_FAIL;
+        }
+
+        hres = disp_call_value(ctx, get_object(v), to_disp(ref->u.idx.array), flags, argc, argv, r);
+        jsval_release(v);
+        return hres;
+    }
     default:
         assert(0);
         return E_FAIL;
@@ -348,6 +394,8 @@ static HRESULT exprval_to_value(script_ctx_t *ctx, exprval_t *ref, jsval_t *r)
 
     if(ref->type == EXPRVAL_IDREF)
         IDispatch_Release(ref->u.idref.disp);
+    else if(ref->type == EXPRVAL_IDX)
+        jsdisp_release(ref->u.idx.array);
     return hres;
 }
 
@@ -361,6 +409,9 @@ static void exprval_release(exprval_t *val)
         if(val->u.idref.disp)
             IDispatch_Release(val->u.idref.disp);
         return;
+    case EXPRVAL_IDX:
+        jsdisp_release(val->u.idx.array);
+        return;
     case EXPRVAL_STACK_REF:
     case EXPRVAL_INVALID:
         return;
@@ -483,6 +534,19 @@ static HRESULT disp_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name
     return hres;
 }
 
+/* Member access instructions cache the DISPID of the last lookup in their second argument */
+static HRESULT member_get_id(script_ctx_t *ctx, IDispatch *disp, const WCHAR *name, BSTR name_bstr, DWORD flags, DISPID *id)
+{
+    call_frame_t *frame = ctx->call_ctx;
+    jsdisp_t *jsdisp;
+
+    jsdisp = to_jsdisp(disp);
+    if(!jsdisp)
+        return disp_get_id(ctx, disp, name, name_bstr, flags, id);
+
+    return jsdisp_get_id_cached(jsdisp, name, flags, &frame->bytecode->instrs[frame->ip].u.arg[1].uint, id);
+}
+
 static HRESULT disp_cmp(IDispatch *disp1, IDispatch *disp2, BOOL *ret)
 {
     IObjectIdentity *identity;
@@ -1021,6 +1085,33 @@ static HRESULT interp_func(script_ctx_t *ctx)
     return stack_push(ctx, jsval_obj(dispex));
 }
 
+/* Returns the array object if disp is a jsdisp Array and name is an array index. */
+static jsdisp_t *get_array_idx(IDispatch *disp, jsval_t name, unsigned *idx)
+{
+    jsdisp_t *jsdisp;
+
+    if(!disp || !(jsdisp = to_jsdisp(disp)) || !is_class(jsdisp, JSCLASS_ARRAY))
+        return NULL;
+
+    if(is_number(name)) {
+        double n = get_number(name);
+
+        if(n < 0 || n >= 0xffffffff || n != (unsigned)n)
+            return NULL;
+        *idx = n;
+        return jsdisp;
+    }
+
+    if(is_string(name)) {
+        const WCHAR *str = jsstr_flatten(get_string(name));
+
+        if(str && idx_from_name(str, idx))
+            return jsdisp;
+    }
+
+    return NULL;
+}
+
 /* ECMA-262 3rd Edition    11.2.1 */
 static HRESULT interp_array(script_ctx_t *ctx)
 {
@@ -1028,6 +1119,8 @@ static HRESULT interp_array(script_ctx_t *ctx)
     const WCHAR *name;
     jsval_t v, namev;
     IDispatch *obj;
+    jsdisp_t *array;
+    unsigned idx;
     DISPID id;
     HRESULT hres;
 
@@ -1041,6 +1134,15 @@ static HRESULT interp_array(script_ctx_t *ctx)
         return hres;
     }
 
+    if((array = get_array_idx(obj, namev, &idx))) {
+        jsval_release(namev);
+        hres = jsdisp_get_idx(array, idx, &v);
+        IDispatch_Release(obj);
+        if(FAILED(hres) && hres != DISP_E_UNKNOWNNAME)
+            return hres;
+        return stack_push(ctx, v);
+    }
+
     hres = to_flat_string(ctx, namev, &name_str, &name);
     jsval_release(namev);
     if(FAILED(hres)) {
@@ -1078,7 +1180,7 @@ static HRESULT interp_member(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, arg, arg, 0, &id);
+    hres = member_get_id(ctx, obj, arg, arg, 0, &id);
     if(SUCCEEDED(hres)) {
         hres = disp_propget(ctx, obj, id, &v);
     }else if(hres == DISP_E_UNKNOWNNAME) {
@@ -1109,6 +1211,14 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
     namev = stack_pop(ctx);
     objv = stack_pop(ctx);
 
+    if((arg & fdexNameEnsure) && is_object_instance(objv)
+       && (ref.u.idx.array = get_array_idx(get_object(objv), namev, &ref.u.idx.idx))) {
+        /* The reference takes over objv's reference to the array. */
+        jsval_release(namev);
+        ref.type = EXPRVAL_IDX;
+        return stack_push_exprval(ctx, &ref);
+    }
+
     hres = to_object(ctx, objv, &obj);
     jsval_release(objv);
     if(SUCCEEDED(hres)) {
@@ -1120,7 +1230,7 @@ static HRESULT interp_memberid(script_ctx_t *ctx)
     if(FAILED(hres))
         return hres;
 
-    hres = disp_get_id(ctx, obj, name, NULL, arg, &id);
+    hres = member_get_id(ctx, obj, name, NULL, arg, &id);
     jsstr_release(name_str);
     if(SUCCEEDED(hres)) {
         ref.type = EXPRVAL_IDREF;
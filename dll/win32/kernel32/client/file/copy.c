@@ -21,147 +21,421 @@ DEBUG_CHANNEL(kernel32file);
 
 /* FUNCTIONS ****************************************************************/
 
+/* Smallest and largest amount of data moved by a single read or write */
+#define COPY_CHUNK_MIN  0x10000
+#define COPY_CHUNK_MAX  0x100000
+
+/* Number of buffers, so that reads and writes are in flight together */
+#define COPY_BUFFERS    4
+
+typedef struct _COPY_BUFFER
+{
+    PUCHAR Buffer;
+    HANDLE Event;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER Offset;
+    ULONG Length;       /* Bytes of file data in the buffer */
+    BOOLEAN Pending;    /* An I/O on the buffer has not been waited for */
+    BOOLEAN Writing;    /* That I/O is a write */
+} COPY_BUFFER, *PCOPY_BUFFER;
+
+static VOID
+CopyStartIo(
+    HANDLE			FileHandle,
+    PCOPY_BUFFER		CopyBuffer,
+    ULONG			Length,
+    BOOLEAN			Write
+)
+{
+    NTSTATUS errCode;
+
+    if (Write)
+    {
+        errCode = NtWriteFile(FileHandle,
+                              CopyBuffer->Event,
+                              NULL,
+                              NULL,
+                              &CopyBuffer->IoStatusBlock,
+                              CopyBuffer->Buffer,
+                              Length,
+                              &CopyBuffer->Offset,
+                              NULL);
+    }
+    else
+    {
+        errCode = NtReadFile(FileHandle,
+                             CopyBuffer->Event,
+                             NULL,
+                             NULL,
+                             &CopyBuffer->IoStatusBlock,
+                             CopyBuffer->Buffer,
+                             Length,
+                             &CopyBuffer->Offset,
+                             NULL);
+    }
+
+    CopyBuffer->Writing = Write;
+
+    /* A request failed right away neither signals the event nor fills in the I/O status */
+    if (NT_ERROR(errCode))
+    {
+        CopyBuffer->IoStatusBlock.Status = errCode;
+        CopyBuffer->IoStatusBlock.Information = 0;
+        CopyBuffer->Pending = FALSE;
+    }
+    else
+    {
+        CopyBuffer->Pending = TRUE;
+    }
+}
+
+static NTSTATUS
+CopyWaitIo(
+    PCOPY_BUFFER		CopyBuffer
+)
+{
+    if (CopyBuffer->Pending)
+    {
+        NtWaitForSingleObject(CopyBuffer->Event, FALSE, NULL);
+        CopyBuffer->Pending = FALSE;
+    }
+
+    return CopyBuffer->IoStatusBlock.Status;
+}
+
+static NTSTATUS
+CopyFinishWrite(
+    PCOPY_BUFFER		CopyBuffer,
+    PLARGE_INTEGER		BytesCopied
+)
+{
+    NTSTATUS errCode;
+
+    errCode = CopyWaitIo(CopyBuffer);
+    if (!CopyBuffer->Writing)
+        return STATUS_SUCCESS;
+
+    CopyBuffer->Writing = FALSE;
+    if (!NT_SUCCESS(errCode))
+    {
+        WARN("Error 0x%08x writing to dest\n", errCode);
+        return errCode;
+    }
+
+    BytesCopied->QuadPart += CopyBuffer->Length;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS
+CopyProgress (
+    LPPROGRESS_ROUTINE	*lpProgressRoutine,
+    LARGE_INTEGER		SourceFileSize,
+    LARGE_INTEGER		BytesCopied,
+    DWORD			CallbackReason,
+    HANDLE			FileHandleSource,
+    HANDLE			FileHandleDest,
+    LPVOID			lpData,
+    BOOL                 *KeepDest
+)
+{
+    DWORD ProgressResult;
+
+    if (NULL == *lpProgressRoutine)
+        return STATUS_SUCCESS;
+
+    ProgressResult = (**lpProgressRoutine)(SourceFileSize,
+                                           BytesCopied,
+                                           SourceFileSize,
+                                           BytesCopied,
+                                           0,
+                                           CallbackReason,
+                                           FileHandleSource,
+                                           FileHandleDest,
+                                           lpData);
+    switch (ProgressResult)
+    {
+    case PROGRESS_CANCEL:
+        TRACE("Progress callback requested cancel\n");
+        return STATUS_REQUEST_ABORTED;
+    case PROGRESS_STOP:
+        TRACE("Progress callback requested stop\n");
+        *KeepDest = TRUE;
+        return STATUS_REQUEST_ABORTED;
+    case PROGRESS_QUIET:
+        *lpProgressRoutine = NULL;
+        break;
+    case PROGRESS_CONTINUE:
+    default:
+        break;
+    }
+
+    return STATUS_SUCCESS;
+}
 
 static NTSTATUS
 CopyLoop (
     HANDLE			FileHandleSource,
     HANDLE			FileHandleDest,
     LARGE_INTEGER		SourceFileSize,
+    BOOL			NoBuffering,
     LPPROGRESS_ROUTINE	lpProgressRoutine,
     LPVOID			lpData,
     BOOL			*pbCancel,
     BOOL                 *KeepDest
 )
 {
-    NTSTATUS errCode;
+    NTSTATUS errCode, WriteStatus;
     IO_STATUS_BLOCK IoStatusBlock;
+    COPY_BUFFER Buffers[COPY_BUFFERS];
+    PCOPY_BUFFER CopyBuffer, PrevBuffer;
+    FILE_FS_SIZE_INFORMATION FileFsSize;
+    FILE_END_OF_FILE_INFORMATION FileEndOfFile;
     UCHAR *lpBuffer = NULL;
-    SIZE_T RegionSize = 0x10000;
-    LARGE_INTEGER BytesCopied;
+    SIZE_T RegionSize;
+    ULONG ChunkSize, BufferCount, SectorSize, Length, i;
+    ULONGLONG Chunk;
+    LARGE_INTEGER BytesCopied, ReadOffset;
     DWORD CallbackReason;
-    DWORD ProgressResult;
     BOOL EndOfFileFound;
 
     *KeepDest = FALSE;
+
+    /* Unbuffered writes must be made of whole sectors */
+    SectorSize = 0;
+    if (NoBuffering)
+    {
+        errCode = NtQueryVolumeInformationFile(FileHandleDest,
+                                               &IoStatusBlock,
+                                               &FileFsSize,
+                                               sizeof(FILE_FS_SIZE_INFORMATION),
+                                               FileFsSizeInformation);
+        if (NT_SUCCESS(errCode) && FileFsSize.BytesPerSector != 0)
+        {
+            SectorSize = FileFsSize.BytesPerSector;
+        }
+        else
+        {
+            WARN("Error 0x%08x obtaining the sector size of dest\n", errCode);
+            SectorSize = PAGE_SIZE;
+        }
+    }
+
+    /* Move larger files in larger chunks, and don't allocate
+       more buffers than the file needs */
+    ChunkSize = (ULONG)min(SourceFileSize.QuadPart / 16, COPY_CHUNK_MAX);
+    ChunkSize = ROUND_UP(max(ChunkSize, COPY_CHUNK_MIN), COPY_CHUNK_MIN);
+    BufferCount = (ULONG)min(SourceFileSize.QuadPart / ChunkSize + 1, COPY_BUFFERS);
+
+    RegionSize = (SIZE_T)ChunkSize * BufferCount;
     errCode = NtAllocateVirtualMemory(NtCurrentProcess(),
                                       (PVOID *)&lpBuffer,
                                       0,
                                       &RegionSize,
                                       MEM_RESERVE | MEM_COMMIT,
                                       PAGE_READWRITE);
+    if (!NT_SUCCESS(errCode))
+    {
+        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
+        return errCode;
+    }
 
-    if (NT_SUCCESS(errCode))
+    BytesCopied.QuadPart = 0;
+    RtlZeroMemory(Buffers, sizeof(Buffers));
+    for (i = 0; i < BufferCount; i++)
+    {
+        Buffers[i].Buffer = lpBuffer + i * ChunkSize;
+        errCode = NtCreateEvent(&Buffers[i].Event,
+                                EVENT_ALL_ACCESS,
+                                NULL,
+                                NotificationEvent,
+                                FALSE);
+        if (!NT_SUCCESS(errCode))
+        {
+            WARN("Error 0x%08x creating event\n", errCode);
+            goto Cleanup;
+        }
+    }
+
+    /* Read ahead into all the buffers. Every chunk then goes through the
+     * buffer of its number, and that buffer is read into again once the
+     * chunk has been written.
+     */
+    ReadOffset.QuadPart = 0;
+    for (i = 0; i < BufferCount; i++)
+    {
+        Buffers[i].Offset = ReadOffset;
+        CopyStartIo(FileHandleSource, &Buffers[i], ChunkSize, FALSE);
+        ReadOffset.QuadPart += ChunkSize;
+    }
+
+    EndOfFileFound = FALSE;
+    CallbackReason = CALLBACK_STREAM_SWITCH;
+    PrevBuffer = NULL;
+    for (Chunk = 0; ; Chunk++)
     {
-        BytesCopied.QuadPart = 0;
-        EndOfFileFound = FALSE;
-        CallbackReason = CALLBACK_STREAM_SWITCH;
-        while (! EndOfFileFound &&
-                NT_SUCCESS(errCode) &&
-                (NULL == pbCancel || ! *pbCancel))
+        errCode = CopyProgress(&lpProgressRoutine,
+                               SourceFileSize,
+                               BytesCopied,
+                               CallbackReason,
+                               FileHandleSource,
+                               FileHandleDest,
+                               lpData,
+                               KeepDest);
+        CallbackReason = CALLBACK_CHUNK_FINISHED;
+        if (!NT_SUCCESS(errCode))
+            break;
+
+        if (NULL != pbCancel && *pbCancel)
+        {
+            TRACE("User requested cancel\n");
+            errCode = STATUS_REQUEST_ABORTED;
+            break;
+        }
+
+        /* Wait for the data of this chunk, and write it out */
+        CopyBuffer = &Buffers[Chunk % BufferCount];
+        errCode = CopyWaitIo(CopyBuffer);
+        Length = (ULONG)CopyBuffer->IoStatusBlock.Information;
+
+        /* With sync read, 0 length + status success mean EOF:
+         * https://msdn.microsoft.com/en-us/library/windows/desktop/aa365467(v=vs.85).aspx
+         */
+        if (STATUS_END_OF_FILE == errCode ||
+            (NT_SUCCESS(errCode) && Length == 0))
+        {
+            EndOfFileFound = TRUE;
+            errCode = STATUS_SUCCESS;
+        }
+        else if (!NT_SUCCESS(errCode))
         {
-            if (NULL != lpProgressRoutine)
+            WARN("Error 0x%08x reading from source\n", errCode);
+        }
+        else
+        {
+            /* Only the last chunk of the file is short */
+            if (Length < ChunkSize)
+                EndOfFileFound = TRUE;
+
+            CopyBuffer->Length = Length;
+            if (SectorSize != 0 && Length % SectorSize != 0)
             {
-                ProgressResult = (*lpProgressRoutine)(SourceFileSize,
-                                                      BytesCopied,
-                                                      SourceFileSize,
-                                                      BytesCopied,
-                                                      0,
-                                                      CallbackReason,
-                                                      FileHandleSource,
-                                                      FileHandleDest,
-                                                      lpData);
-                switch (ProgressResult)
-                {
-                case PROGRESS_CANCEL:
-                    TRACE("Progress callback requested cancel\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    break;
-                case PROGRESS_STOP:
-                    TRACE("Progress callback requested stop\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    *KeepDest = TRUE;
-                    break;
-                case PROGRESS_QUIET:
-                    lpProgressRoutine = NULL;
-                    break;
-                case PROGRESS_CONTINUE:
-                default:
-                    break;
-                }
-                CallbackReason = CALLBACK_CHUNK_FINISHED;
+                /* Pad to a whole sector, the size is set right at the end */
+                RtlZeroMemory(CopyBuffer->Buffer + Length, ROUND_UP(Length, SectorSize) - Length);
+                Length = ROUND_UP(Length, SectorSize);
             }
+
+            CopyStartIo(FileHandleDest, CopyBuffer, Length, TRUE);
+        }
+
+        /* Once the previous chunk is written, read further ahead into its buffer */
+        if (NULL != PrevBuffer)
+        {
+            WriteStatus = CopyFinishWrite(PrevBuffer, &BytesCopied);
             if (NT_SUCCESS(errCode))
+                errCode = WriteStatus;
+
+            if (NT_SUCCESS(errCode) && !EndOfFileFound)
             {
-                errCode = NtReadFile(FileHandleSource,
-                                     NULL,
-                                     NULL,
-                                     NULL,
-                                     (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                     lpBuffer,
-                                     RegionSize,
-                                     NULL,
-                                     NULL);
-                /* With sync read, 0 length + status success mean EOF:
-                 * https://msdn.microsoft.com/en-us/library/windows/desktop/aa365467(v=vs.85).aspx
-                 */
-                if (NT_SUCCESS(errCode) && IoStatusBlock.Information == 0)
-                {
-                    errCode = STATUS_END_OF_FILE;
-                }
-                if (NT_SUCCESS(errCode) && (NULL == pbCancel || ! *pbCancel))
-                {
-                    errCode = NtWriteFile(FileHandleDest,
-                                          NULL,
-                                          NULL,
-                                          NULL,
-                                          (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                          lpBuffer,
-                                          IoStatusBlock.Information,
-                                          NULL,
-                                          NULL);
-                    if (NT_SUCCESS(errCode))
-                    {
-                        BytesCopied.QuadPart += IoStatusBlock.Information;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading writing to dest\n", errCode);
-                    }
-                }
-                else if (!NT_SUCCESS(errCode))
-                {
-                    if (STATUS_END_OF_FILE == errCode)
-                    {
-                        EndOfFileFound = TRUE;
-                        errCode = STATUS_SUCCESS;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading from source\n", errCode);
-                    }
-                }
+                PrevBuffer->Offset = ReadOffset;
+                CopyStartIo(FileHandleSource, PrevBuffer, ChunkSize, FALSE);
+                ReadOffset.QuadPart += ChunkSize;
             }
         }
 
-        if (! EndOfFileFound && (NULL != pbCancel && *pbCancel))
-        {
-            TRACE("User requested cancel\n");
-            errCode = STATUS_REQUEST_ABORTED;
-        }
+        if (!NT_SUCCESS(errCode) || EndOfFileFound)
+            break;
 
-        NtFreeVirtualMemory(NtCurrentProcess(),
-                            (PVOID *)&lpBuffer,
-                            &RegionSize,
-                            MEM_RELEASE);
+        PrevBuffer = CopyBuffer;
     }
-    else
+
+Cleanup:
+    /* Wait for everything still in flight before freeing the buffers */
+    for (i = 0; i < BufferCount && NULL != Buffers[i].Event; i++)
     {
-        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
+        WriteStatus = CopyFinishWrite(&Buffers[i], &BytesCopied);
+        if (NT_SUCCESS(errCode))
+            errCode = WriteStatus;
+
+        NtClose(Buffers[i].Event);
+    }
+
+    if (NT_SUCCESS(errCode))
+    {
+        /* Report the last chunk */
+        errCode = CopyProgress(&lpProgressRoutine,
+                               SourceFileSize,
+                               BytesCopied,
+                               CALLBACK_CHUNK_FINISHED,
+                               FileHandleSource,
+                               FileHandleDest,
+                               lpData,
+                               KeepDest);
     }
 
+    /* Drop the sector padding and any preallocated space the file didn't need */
+    if (NT_SUCCESS(errCode) &&
+        (SectorSize != 0 || BytesCopied.QuadPart != SourceFileSize.QuadPart))
+    {
+        FileEndOfFile.EndOfFile = BytesCopied;
+        errCode = NtSetInformationFile(FileHandleDest,
+                                       &IoStatusBlock,
+                                       &FileEndOfFile,
+                                       sizeof(FILE_END_OF_FILE_INFORMATION),
+                                       FileEndOfFileInformation);
+        if (!NT_SUCCESS(errCode))
+        {
+            WARN("Error 0x%08x setting the size of dest\n", errCode);
+        }
+    }
+
+    RegionSize = 0;
+    NtFreeVirtualMemory(NtCurrentProcess(),
+                        (PVOID *)&lpBuffer,
+                        &RegionSize,
+                        MEM_RELEASE);
+
     return errCode;
 }
 
+static VOID
+PreallocateFile(
+    HANDLE FileHandle,
+    LARGE_INTEGER FileSize
+)
+{
+    NTSTATUS errCode;
+    IO_STATUS_BLOCK IoStatusBlock;
+    FILE_ALLOCATION_INFORMATION FileAllocation;
+    FILE_END_OF_FILE_INFORMATION FileEndOfFile;
+
+    if (FileSize.QuadPart == 0)
+        return;
+
+    /* Reserve the space at once so the file isn't fragmented, and set its
+       size so that the writes don't extend it and really run asynchronously */
+    FileAllocation.AllocationSize = FileSize;
+    errCode = NtSetInformationFile(FileHandle,
+                                   &IoStatusBlock,
+                                   &FileAllocation,
+                                   sizeof(FILE_ALLOCATION_INFORMATION),
+                                   FileAllocationInformation);
+    if (!NT_SUCCESS(errCode))
+    {
+        WARN("Error 0x%08x preallocating dest\n", errCode);
+    }
+
+    FileEndOfFile.EndOfFile = FileSize;
+    errCode = NtSetInformationFile(FileHandle,
+                                   &IoStatusBlock,
+                                   &FileEndOfFile,
+                                   sizeof(FILE_END_OF_FILE_INFORMATION),
+                                   FileEndOfFileInformation);
+    if (!NT_SUCCESS(errCode))
+    {
+        WARN("Error 0x%08x setting the size of dest\n", errCode);
+    }
+}
+
 static NTSTATUS
 SetLastWriteTime(
     HANDLE FileHandle,
@@ -216,14 +490,19 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
     FILE_BASIC_INFORMATION FileBasic;
     BOOL RC = FALSE;
     BOOL KeepDestOnError = FALSE;
+    BOOL NoBuffering;
     DWORD SystemError;
 
+    /* Both files are read and written asynchronously, and bypass the cache if asked to */
+    NoBuffering = !!(dwCopyFlags & COPY_FILE_NO_BUFFERING);
+
     FileHandleSource = CreateFileW(lpExistingFileName,
                                    GENERIC_READ,
                                    FILE_SHARE_READ | FILE_SHARE_WRITE,
                                    NULL,
                                    OPEN_EXISTING,
-                                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_NO_BUFFERING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED |
+                                   (NoBuffering ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN),
                                    NULL);
     if (INVALID_HANDLE_VALUE != FileHandleSource)
     {
@@ -254,14 +533,18 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                              GENERIC_WRITE,
                                              FILE_SHARE_WRITE,
                                              NULL,
-                                             dwCopyFlags ? CREATE_NEW : CREATE_ALWAYS,
-                                             FileBasic.FileAttributes,
+                                             (dwCopyFlags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                                             FileBasic.FileAttributes | FILE_FLAG_OVERLAPPED |
+                                             (NoBuffering ? FILE_FLAG_NO_BUFFERING : 0),
                                              NULL);
                 if (INVALID_HANDLE_VALUE != FileHandleDest)
                 {
+                    PreallocateFile(FileHandleDest, FileStandard.EndOfFile);
+
                     errCode = CopyLoop(FileHandleSource,
                                        FileHandleDest,
                                        FileStandard.EndOfFile,
+                                       NoBuffering,
                                        lpProgressRoutine,
                                        lpData,
                                        pbCancel,
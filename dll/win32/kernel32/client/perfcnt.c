@@ -25,9 +25,14 @@ QueryPerformanceCounter(OUT PLARGE_INTEGER lpPerformanceCount)
     LARGE_INTEGER Frequency;
     NTSTATUS Status;
 
+    /* Reads the TSC directly when the HAL allows it */
+    if (RtlQueryPerformanceCounter(lpPerformanceCount))
+        return TRUE;
+
+    /* Ask the kernel again for the reason of the failure */
     Status = NtQueryPerformanceCounter(lpPerformanceCount, &Frequency);
     if (Frequency.QuadPart == 0) Status = STATUS_NOT_IMPLEMENTED;
-    
+
     if (!NT_SUCCESS(Status))
     {
         BaseSetLastNTError(Status);
@@ -47,9 +52,13 @@ QueryPerformanceFrequency(OUT PLARGE_INTEGER lpFrequency)
     LARGE_INTEGER Count;
     NTSTATUS Status;
 
+    if (RtlQueryPerformanceFrequency(lpFrequency))
+        return TRUE;
+
+    /* Ask the kernel again for the reason of the failure */
     Status = NtQueryPerformanceCounter(&Count, lpFrequency);
     if (lpFrequency->QuadPart == 0) Status = STATUS_NOT_IMPLEMENTED;
-    
+
     if (!NT_SUCCESS(Status))
     {
         BaseSetLastNTError(Status);
@@ -126,8 +126,13 @@ extern WaitForInputIdleType UserWaitForInputIdleRoutine;
 #define BASEP_COPY_BACKUP_SEMANTICS 0x100
 #define BASEP_COPY_REPLACE          0x200
 #define BASEP_COPY_SKIP_DACL        0x400
-#define BASEP_COPY_PUBLIC_MASK      0xF
-#define BASEP_COPY_BASEP_MASK       0xFFFFFFF0
+#define BASEP_COPY_PUBLIC_MASK      0x100F
+#define BASEP_COPY_BASEP_MASK       0xFFFFEFF0
+
+/* Vista flag, kernel32 is built for an older version */
+#ifndef COPY_FILE_NO_BUFFERING
+#define COPY_FILE_NO_BUFFERING      0x1000
+#endif
 
 /* Flags for PrivMoveFileIdentityW */
 #define PRIV_DELETE_ON_SUCCESS      0x1
@@ -0,0 +1,637 @@
+/*
+ * PROJECT:     ReactOS Win32 Base API
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Vista thread pool functions
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include "k32_vista.h"
+
+#define NDEBUG
+#include <debug.h>
+
+/* TYPES **********************************************************************/
+
+/* What ntdll gets as the context of an I/O object */
+typedef struct _BASEP_TP_IO
+{
+    PTP_WIN32_IO_CALLBACK Callback;
+    PVOID Context;
+    PTP_CLEANUP_GROUP_CANCEL_CALLBACK CleanupGroupCancelCallback;
+    PTP_SIMPLE_CALLBACK FinalizationCallback;
+} BASEP_TP_IO, *PBASEP_TP_IO;
+
+/* The Windows 7 callback environment, we are built against the Vista one */
+typedef struct _BASEP_TP_CALLBACK_ENVIRON_V3
+{
+    TP_VERSION Version;
+    PTP_POOL Pool;
+    PTP_CLEANUP_GROUP CleanupGroup;
+    PTP_CLEANUP_GROUP_CANCEL_CALLBACK CleanupGroupCancelCallback;
+    PVOID RaceDll;
+    struct _ACTIVATION_CONTEXT *ActivationContext;
+    PTP_SIMPLE_CALLBACK FinalizationCallback;
+    DWORD Flags;
+    TP_CALLBACK_PRIORITY CallbackPriority;
+    DWORD Size;
+} BASEP_TP_CALLBACK_ENVIRON_V3;
+
+/* PRIVATE FUNCTIONS **********************************************************/
+
+static
+VOID
+NTAPI
+BasepTpIoCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context,
+    _In_ PVOID ApcContext,
+    _In_ PIO_STATUS_BLOCK IoStatusBlock,
+    _In_ PTP_IO Io)
+{
+    PBASEP_TP_IO IoContext = Context;
+
+    IoContext->Callback(Instance,
+                        IoContext->Context,
+                        ApcContext,
+                        RtlNtStatusToDosError(IoStatusBlock->Status),
+                        IoStatusBlock->Information,
+                        Io);
+}
+
+static
+VOID
+NTAPI
+BasepTpIoCleanupCallback(
+    _Inout_opt_ PVOID ObjectContext,
+    _Inout_opt_ PVOID CleanupContext)
+{
+    PBASEP_TP_IO IoContext = ObjectContext;
+
+    IoContext->CleanupGroupCancelCallback(IoContext->Context, CleanupContext);
+}
+
+static
+VOID
+NTAPI
+BasepTpIoFinalizationCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context)
+{
+    PBASEP_TP_IO IoContext = Context;
+
+    IoContext->FinalizationCallback(Instance, IoContext->Context);
+}
+
+static
+VOID
+NTAPI
+BasepTpIoDestroyCallback(
+    _In_opt_ PVOID Context)
+{
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Context);
+}
+
+static
+PLARGE_INTEGER
+BasepFileTimeToTimeout(
+    _Out_ PLARGE_INTEGER Timeout,
+    _In_opt_ PFILETIME FileTime)
+{
+    if (FileTime == NULL)
+        return NULL;
+
+    Timeout->LowPart = FileTime->dwLowDateTime;
+    Timeout->HighPart = FileTime->dwHighDateTime;
+    return Timeout;
+}
+
+/* PUBLIC FUNCTIONS ***********************************************************/
+
+/*
+ * @implemented
+ */
+PTP_POOL
+WINAPI
+CreateThreadpool(
+    _Reserved_ PVOID Reserved)
+{
+    PTP_POOL Pool;
+    NTSTATUS Status;
+
+    Status = TpAllocPool(&Pool, Reserved);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Pool;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpool(
+    _Inout_ PTP_POOL Pool)
+{
+    TpReleasePool(Pool);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+SetThreadpoolThreadMaximum(
+    _Inout_ PTP_POOL Pool,
+    _In_ DWORD MaxThreads)
+{
+    TpSetPoolMaxThreads(Pool, MaxThreads);
+}
+
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+SetThreadpoolThreadMinimum(
+    _Inout_ PTP_POOL Pool,
+    _In_ DWORD MinThreads)
+{
+    NTSTATUS Status;
+
+    Status = TpSetPoolMinThreads(Pool, MinThreads);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * @implemented
+ */
+PTP_CLEANUP_GROUP
+WINAPI
+CreateThreadpoolCleanupGroup(VOID)
+{
+    PTP_CLEANUP_GROUP Group;
+    NTSTATUS Status;
+
+    Status = TpAllocCleanupGroup(&Group);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Group;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolCleanupGroup(
+    _Inout_ PTP_CLEANUP_GROUP CleanupGroup)
+{
+    TpReleaseCleanupGroup(CleanupGroup);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolCleanupGroupMembers(
+    _Inout_ PTP_CLEANUP_GROUP CleanupGroup,
+    _In_ BOOL CancelPendingCallbacks,
+    _Inout_opt_ PVOID CleanupContext)
+{
+    TpReleaseCleanupGroupMembers(CleanupGroup, CancelPendingCallbacks, CleanupContext);
+}
+
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+TrySubmitThreadpoolCallback(
+    _In_ PTP_SIMPLE_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    NTSTATUS Status;
+
+    Status = TpSimpleTryPost(Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * @implemented
+ */
+PTP_WORK
+WINAPI
+CreateThreadpoolWork(
+    _In_ PTP_WORK_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_WORK Work;
+    NTSTATUS Status;
+
+    Status = TpAllocWork(&Work, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Work;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+SubmitThreadpoolWork(
+    _Inout_ PTP_WORK Work)
+{
+    TpPostWork(Work);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+WaitForThreadpoolWorkCallbacks(
+    _Inout_ PTP_WORK Work,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    TpWaitForWork(Work, CancelPendingCallbacks);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolWork(
+    _Inout_ PTP_WORK Work)
+{
+    TpReleaseWork(Work);
+}
+
+/*
+ * @implemented
+ */
+PTP_TIMER
+WINAPI
+CreateThreadpoolTimer(
+    _In_ PTP_TIMER_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_TIMER Timer;
+    NTSTATUS Status;
+
+    Status = TpAllocTimer(&Timer, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Timer;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+SetThreadpoolTimer(
+    _Inout_ PTP_TIMER Timer,
+    _In_opt_ PFILETIME DueTime,
+    _In_ DWORD Period,
+    _In_opt_ DWORD WindowLength)
+{
+    LARGE_INTEGER Timeout;
+
+    TpSetTimer(Timer, BasepFileTimeToTimeout(&Timeout, DueTime), Period, WindowLength);
+}
+
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+IsThreadpoolTimerSet(
+    _Inout_ PTP_TIMER Timer)
+{
+    return TpIsTimerSet(Timer);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+WaitForThreadpoolTimerCallbacks(
+    _Inout_ PTP_TIMER Timer,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    TpWaitForTimer(Timer, CancelPendingCallbacks);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolTimer(
+    _Inout_ PTP_TIMER Timer)
+{
+    TpReleaseTimer(Timer);
+}
+
+/*
+ * @implemented
+ */
+PTP_WAIT
+WINAPI
+CreateThreadpoolWait(
+    _In_ PTP_WAIT_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_WAIT Wait;
+    NTSTATUS Status;
+
+    Status = TpAllocWait(&Wait, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Wait;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+SetThreadpoolWait(
+    _Inout_ PTP_WAIT Wait,
+    _In_opt_ HANDLE Handle,
+    _In_opt_ PFILETIME Timeout)
+{
+    LARGE_INTEGER WaitTimeout;
+
+    TpSetWait(Wait, Handle, BasepFileTimeToTimeout(&WaitTimeout, Timeout));
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+WaitForThreadpoolWaitCallbacks(
+    _Inout_ PTP_WAIT Wait,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    TpWaitForWait(Wait, CancelPendingCallbacks);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolWait(
+    _Inout_ PTP_WAIT Wait)
+{
+    TpReleaseWait(Wait);
+}
+
+/*
+ * @implemented
+ */
+PTP_IO
+WINAPI
+CreateThreadpoolIo(
+    _In_ HANDLE File,
+    _In_ PTP_WIN32_IO_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    BASEP_TP_CALLBACK_ENVIRON_V3 Environ;
+    PBASEP_TP_IO IoContext;
+    PTP_IO Io;
+    NTSTATUS Status;
+
+    /* Set up before the file is bound, a completion may come in right away */
+    IoContext = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(BASEP_TP_IO));
+    if (IoContext == NULL)
+    {
+        BaseSetLastNTError(STATUS_NO_MEMORY);
+        return NULL;
+    }
+
+    IoContext->Callback = Callback;
+    IoContext->Context = Context;
+    IoContext->CleanupGroupCancelCallback = NULL;
+    IoContext->FinalizationCallback = NULL;
+
+    /* The environment callbacks would see our context, route them through us */
+    if (CallbackEnviron)
+    {
+        RtlCopyMemory(&Environ,
+                      CallbackEnviron,
+                      CallbackEnviron->Version == 3 ? sizeof(Environ) : sizeof(TP_CALLBACK_ENVIRON));
+
+        if (Environ.CleanupGroupCancelCallback)
+        {
+            IoContext->CleanupGroupCancelCallback = Environ.CleanupGroupCancelCallback;
+            Environ.CleanupGroupCancelCallback = BasepTpIoCleanupCallback;
+        }
+
+        if (Environ.FinalizationCallback)
+        {
+            IoContext->FinalizationCallback = Environ.FinalizationCallback;
+            Environ.FinalizationCallback = BasepTpIoFinalizationCallback;
+        }
+
+        CallbackEnviron = (PTP_CALLBACK_ENVIRON)&Environ;
+    }
+
+    Status = RtlpTpAllocIoCompletion(&Io,
+                                     File,
+                                     BasepTpIoCallback,
+                                     IoContext,
+                                     CallbackEnviron,
+                                     BasepTpIoDestroyCallback);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, IoContext);
+        BaseSetLastNTError(Status);
+        return NULL;
+    }
+
+    return Io;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+StartThreadpoolIo(
+    _Inout_ PTP_IO Io)
+{
+    TpStartAsyncIoOperation(Io);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CancelThreadpoolIo(
+    _Inout_ PTP_IO Io)
+{
+    TpCancelAsyncIoOperation(Io);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+WaitForThreadpoolIoCallbacks(
+    _Inout_ PTP_IO Io,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    TpWaitForIoCompletion(Io, CancelPendingCallbacks);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+CloseThreadpoolIo(
+    _Inout_ PTP_IO Io)
+{
+    TpReleaseIoCompletion(Io);
+}
+
+/*
+ * @implemented
+ */
+BOOL
+WINAPI
+CallbackMayRunLong(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance)
+{
+    NTSTATUS Status;
+
+    Status = TpCallbackMayRunLong(Instance);
+    if (!NT_SUCCESS(Status))
+    {
+        BaseSetLastNTError(Status);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+DisassociateCurrentThreadFromCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance)
+{
+    TpDisassociateCallback(Instance);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+FreeLibraryWhenCallbackReturns(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HMODULE Module)
+{
+    TpCallbackUnloadDllOnCompletion(Instance, Module);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+LeaveCriticalSectionWhenCallbackReturns(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_ PCRITICAL_SECTION CriticalSection)
+{
+    TpCallbackLeaveCriticalSectionOnCompletion(Instance, (PRTL_CRITICAL_SECTION)CriticalSection);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+ReleaseMutexWhenCallbackReturns(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Mutex)
+{
+    TpCallbackReleaseMutexOnCompletion(Instance, Mutex);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+ReleaseSemaphoreWhenCallbackReturns(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Semaphore,
+    _In_ DWORD ReleaseCount)
+{
+    TpCallbackReleaseSemaphoreOnCompletion(Instance, Semaphore, ReleaseCount);
+}
+
+/*
+ * @implemented
+ */
+VOID
+WINAPI
+SetEventWhenCallbackReturns(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Event)
+{
+    TpCallbackSetEventOnCompletion(Instance, Event);
+}
+
+/* EOF */
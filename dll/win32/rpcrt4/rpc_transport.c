@@ -975,6 +975,1016 @@ static RPC_STATUS rpcrt4_ncalrpc_inquire_auth_client(
     return RPC_S_OK;
 }
 
+#ifdef __REACTOS__
+/**** ncalrpc over ALPC ports ****/
+
+/* The NT port message header, wine/winternl.h only knows the old LPC one */
+typedef struct _RpcPortMessage
+{
+    USHORT DataLength;
+    USHORT TotalLength;
+    USHORT Type;
+    USHORT DataInfoOffset;
+    union
+    {
+        CLIENT_ID ClientId;
+        double DoNotUseThisField;
+    } u1;
+    ULONG MessageId;
+    union
+    {
+        SIZE_T ClientViewSize;
+        ULONG CallbackId;
+    } u2;
+} RpcPortMessage;
+
+typedef struct _RpcPortAttributes
+{
+    ULONG Flags;
+    SECURITY_QUALITY_OF_SERVICE SecurityQos;
+    SIZE_T MaxMessageLength;
+    SIZE_T MemoryBandwidth;
+    SIZE_T MaxPoolUsage;
+    SIZE_T MaxSectionSize;
+    SIZE_T MaxViewSize;
+    SIZE_T MaxTotalSectionSize;
+    ULONG DupObjectTypes;
+#ifdef _WIN64
+    ULONG Reserved;
+#endif
+} RpcPortAttributes;
+
+/* ALPC_MESSAGE_ATTRIBUTES followed by the only attribute we ask for */
+typedef struct _RpcPortContextAttributes
+{
+    ULONG AllocatedAttributes;
+    ULONG ValidAttributes;
+    void *PortContext;
+    void *MessageContext;
+    ULONG Sequence;
+    ULONG MessageId;
+    ULONG CallbackId;
+} RpcPortContextAttributes;
+
+#define ALPC_MESSAGE_CONTEXT_ATTRIBUTE 0x20000000
+
+#define LPC_REQUEST             1
+#define LPC_DATAGRAM            3
+#define LPC_PORT_CLOSED         5
+#define LPC_CLIENT_DIED         6
+#define LPC_CONNECTION_REQUEST  10
+
+#ifdef _WIN64
+#define ALPC_MAX_MESSAGE_LENGTH 512
+#else
+#define ALPC_MAX_MESSAGE_LENGTH 256
+#endif
+#define ALPC_MAX_DATA_LENGTH (ALPC_MAX_MESSAGE_LENGTH - sizeof(RpcPortMessage))
+
+typedef union _RpcPortBuffer
+{
+    RpcPortMessage header;
+    char buffer[ALPC_MAX_MESSAGE_LENGTH];
+} RpcPortBuffer;
+
+/* connection information sent along with a connection request */
+enum ncalrpc_connect_type
+{
+    NCALRPC_CONNECT_BIND = 1,
+    NCALRPC_CONNECT_PROBE,
+    NCALRPC_CONNECT_STOP
+};
+
+static NTSTATUS (WINAPI *pNtAlpcCreatePort)(HANDLE *, OBJECT_ATTRIBUTES *, RpcPortAttributes *);
+static NTSTATUS (WINAPI *pNtAlpcConnectPort)(HANDLE *, UNICODE_STRING *, OBJECT_ATTRIBUTES *,
+                                             RpcPortAttributes *, ULONG, PSID, RpcPortMessage *,
+                                             SIZE_T *, void *, void *, LARGE_INTEGER *);
+static NTSTATUS (WINAPI *pNtAlpcAcceptConnectPort)(HANDLE *, HANDLE, ULONG, OBJECT_ATTRIBUTES *,
+                                                   RpcPortAttributes *, void *, RpcPortMessage *,
+                                                   void *, BOOLEAN);
+static NTSTATUS (WINAPI *pNtAlpcSendWaitReceivePort)(HANDLE, ULONG, RpcPortMessage *, void *,
+                                                     RpcPortMessage *, SIZE_T *,
+                                                     RpcPortContextAttributes *, LARGE_INTEGER *);
+static NTSTATUS (WINAPI *pNtAlpcImpersonateClientOfPort)(HANDLE, RpcPortMessage *, void *);
+static LONG ncalrpc_alpc_state;
+
+/* ncalrpc runs over ALPC ports when ntdll exports them, named pipes otherwise */
+static BOOL rpcrt4_ncalrpc_use_alpc(void)
+{
+    HMODULE ntdll;
+    BOOL available;
+
+    if (!ncalrpc_alpc_state)
+    {
+        ntdll = GetModuleHandleA("ntdll.dll");
+        pNtAlpcCreatePort = (void *)GetProcAddress(ntdll, "NtAlpcCreatePort");
+        pNtAlpcConnectPort = (void *)GetProcAddress(ntdll, "NtAlpcConnectPort");
+        pNtAlpcAcceptConnectPort = (void *)GetProcAddress(ntdll, "NtAlpcAcceptConnectPort");
+        pNtAlpcSendWaitReceivePort = (void *)GetProcAddress(ntdll, "NtAlpcSendWaitReceivePort");
+        pNtAlpcImpersonateClientOfPort = (void *)GetProcAddress(ntdll, "NtAlpcImpersonateClientOfPort");
+        available = pNtAlpcCreatePort && pNtAlpcConnectPort && pNtAlpcAcceptConnectPort &&
+                    pNtAlpcSendWaitReceivePort && pNtAlpcImpersonateClientOfPort;
+        TRACE("ncalrpc uses %s\n", available ? "ALPC ports" : "named pipes");
+        InterlockedExchange(&ncalrpc_alpc_state, available ? 1 : -1);
+    }
+    return ncalrpc_alpc_state > 0;
+}
+
+struct alpc_packet
+{
+    struct list entry;
+    unsigned int offset;
+    unsigned int size;
+    char data[1];
+};
+
+/* The connection port of an endpoint. All the server ports accepted from it
+ * receive through it, so its thread hands connection requests to the server
+ * thread and sorts the other messages by port context. */
+struct alpc_listener
+{
+    LONG refs;
+    HANDLE port;
+    HANDLE thread;
+    HANDLE accept_event;
+    WCHAR *port_name;
+    CRITICAL_SECTION cs; /* protects the lists and the packets of the connections */
+    CRITICAL_SECTION send_cs;
+    struct list requests;
+    struct list connections;
+};
+
+typedef struct _RpcConnection_alpc
+{
+    RpcConnection common;
+    HANDLE port;
+    BOOL listening;
+    struct alpc_listener *listener;
+    struct alpc_packet *accept_request;
+    /* server side */
+    struct list listener_entry;
+    struct list packets;
+    HANDLE event;
+    RpcPortMessage last_message;
+    BOOL peer_closed;
+    BOOL read_closed;
+    /* client side */
+    RpcPortBuffer *message;
+    unsigned int message_offset;
+    BOOL cancelled;
+} RpcConnection_alpc;
+
+static RpcConnection *rpcrt4_conn_alpc_alloc(void)
+{
+    RpcConnection_alpc *alpc = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(RpcConnection_alpc));
+    if (!alpc)
+        return NULL;
+    list_init(&alpc->listener_entry);
+    list_init(&alpc->packets);
+    return &alpc->common;
+}
+
+static WCHAR *ncalrpc_port_name(const char *endpoint)
+{
+    static const WCHAR prefix[] = {'\\','R','P','C',' ','C','o','n','t','r','o','l','\\',0};
+    WCHAR *port_name;
+    int len;
+
+    len = MultiByteToWideChar(CP_ACP, 0, endpoint, -1, NULL, 0);
+    port_name = HeapAlloc(GetProcessHeap(), 0, sizeof(prefix) + len * sizeof(WCHAR));
+    if (!port_name)
+        return NULL;
+    memcpy(port_name, prefix, sizeof(prefix));
+    MultiByteToWideChar(CP_ACP, 0, endpoint, -1, port_name + ARRAY_SIZE(prefix) - 1, len);
+    return port_name;
+}
+
+static struct alpc_packet *rpcrt4_alpc_alloc_packet(const void *data, unsigned int size)
+{
+    struct alpc_packet *packet;
+
+    packet = HeapAlloc(GetProcessHeap(), 0, FIELD_OFFSET(struct alpc_packet, data[size]));
+    if (!packet)
+        return NULL;
+    packet->offset = 0;
+    packet->size = size;
+    memcpy(packet->data, data, size);
+    return packet;
+}
+
+static NTSTATUS rpcrt4_alpc_connect(HANDLE *port, const WCHAR *port_name,
+                                    enum ncalrpc_connect_type type,
+                                    const RpcQualityOfService *qos)
+{
+    struct
+    {
+        RpcPortMessage header;
+        DWORD type;
+    } msg;
+    RpcPortAttributes attributes;
+    UNICODE_STRING name;
+    SIZE_T length;
+
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.SecurityQos.Length = sizeof(attributes.SecurityQos);
+    attributes.SecurityQos.ImpersonationLevel = SecurityImpersonation;
+    attributes.SecurityQos.ContextTrackingMode = SECURITY_DYNAMIC_TRACKING;
+    if (qos)
+    {
+        switch (qos->qos->ImpersonationType)
+        {
+            case RPC_C_IMP_LEVEL_ANONYMOUS:
+                attributes.SecurityQos.ImpersonationLevel = SecurityAnonymous;
+                break;
+            case RPC_C_IMP_LEVEL_IDENTIFY:
+                attributes.SecurityQos.ImpersonationLevel = SecurityIdentification;
+                break;
+            case RPC_C_IMP_LEVEL_DELEGATE:
+                attributes.SecurityQos.ImpersonationLevel = SecurityDelegation;
+                break;
+        }
+        if (qos->qos->IdentityTracking != RPC_C_QOS_IDENTITY_DYNAMIC)
+            attributes.SecurityQos.ContextTrackingMode = SECURITY_STATIC_TRACKING;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.header.DataLength = sizeof(msg.type);
+    msg.header.TotalLength = sizeof(msg.header) + sizeof(msg.type);
+    msg.type = type;
+    length = sizeof(msg.header) + sizeof(msg.type);
+
+    RtlInitUnicodeString(&name, port_name);
+    return pNtAlpcConnectPort(port, &name, NULL, &attributes, 0, NULL, &msg.header, &length,
+                              NULL, NULL, NULL);
+}
+
+static void rpcrt4_alpc_reject(struct alpc_listener *listener, RpcPortMessage *request)
+{
+    HANDLE port;
+    pNtAlpcAcceptConnectPort(&port, listener->port, 0, NULL, NULL, NULL, request, NULL, FALSE);
+}
+
+static RpcConnection_alpc *rpcrt4_alpc_find_connection(struct alpc_listener *listener, void *context)
+{
+    RpcConnection_alpc *connection;
+
+    LIST_FOR_EACH_ENTRY(connection, &listener->connections, RpcConnection_alpc, listener_entry)
+    {
+        if (connection == context)
+            return connection;
+    }
+    return NULL;
+}
+
+static DWORD CALLBACK rpcrt4_alpc_listen_thread(void *arg)
+{
+    struct alpc_listener *listener = arg;
+    RpcPortContextAttributes attributes;
+    RpcConnection_alpc *connection;
+    struct alpc_packet *packet;
+    RpcPortBuffer msg;
+    SIZE_T length;
+    NTSTATUS status;
+    DWORD type;
+
+    for (;;)
+    {
+        length = sizeof(msg);
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.AllocatedAttributes = ALPC_MESSAGE_CONTEXT_ATTRIBUTE;
+        status = pNtAlpcSendWaitReceivePort(listener->port, 0, NULL, NULL, &msg.header, &length,
+                                            &attributes, NULL);
+        if (status)
+        {
+            ERR("receive failed with status %08x\n", status);
+            return 1;
+        }
+
+        switch (msg.header.Type & 0xff)
+        {
+        case LPC_CONNECTION_REQUEST:
+            type = 0;
+            if (msg.header.DataLength >= sizeof(type))
+                memcpy(&type, &msg.header + 1, sizeof(type));
+
+            if (type == NCALRPC_CONNECT_BIND)
+            {
+                /* the server thread accepts it, like a pipe connection */
+                packet = rpcrt4_alpc_alloc_packet(&msg.header, sizeof(msg.header) + msg.header.DataLength);
+                if (!packet)
+                {
+                    rpcrt4_alpc_reject(listener, &msg.header);
+                    break;
+                }
+                EnterCriticalSection(&listener->cs);
+                list_add_tail(&listener->requests, &packet->entry);
+                LeaveCriticalSection(&listener->cs);
+                SetEvent(listener->accept_event);
+                break;
+            }
+
+            /* a probe only wants to know somebody is listening */
+            rpcrt4_alpc_reject(listener, &msg.header);
+            if ((type == NCALRPC_CONNECT_STOP) &&
+                (HandleToUlong(msg.header.u1.ClientId.UniqueProcess) == GetCurrentProcessId()))
+            {
+                TRACE("stopped listening on %s\n", debugstr_w(listener->port_name));
+                return 0;
+            }
+            break;
+
+        case LPC_REQUEST:
+        case LPC_DATAGRAM:
+        case LPC_PORT_CLOSED:
+        case LPC_CLIENT_DIED:
+            EnterCriticalSection(&listener->cs);
+            connection = rpcrt4_alpc_find_connection(listener, attributes.PortContext);
+            if (connection)
+            {
+                if ((msg.header.Type & 0xff) == LPC_PORT_CLOSED ||
+                    (msg.header.Type & 0xff) == LPC_CLIENT_DIED)
+                {
+                    connection->peer_closed = TRUE;
+                }
+                else if (msg.header.DataLength)
+                {
+                    /* losing data would desync the stream, so drop the connection instead */
+                    packet = rpcrt4_alpc_alloc_packet(&msg.header + 1, msg.header.DataLength);
+                    if (packet)
+                        list_add_tail(&connection->packets, &packet->entry);
+                    else
+                        connection->peer_closed = TRUE;
+                    connection->last_message = msg.header;
+                }
+                SetEvent(connection->event);
+            }
+            LeaveCriticalSection(&listener->cs);
+            break;
+        }
+    }
+}
+
+static void rpcrt4_alpc_listener_release(struct alpc_listener *listener)
+{
+    if (InterlockedDecrement(&listener->refs))
+        return;
+
+    DeleteCriticalSection(&listener->cs);
+    DeleteCriticalSection(&listener->send_cs);
+    if (listener->accept_event)
+        CloseHandle(listener->accept_event);
+    HeapFree(GetProcessHeap(), 0, listener->port_name);
+    HeapFree(GetProcessHeap(), 0, listener);
+}
+
+static RPC_STATUS rpcrt4_conn_alpc_listen(RpcConnection_alpc *connection)
+{
+    struct alpc_listener *listener;
+    RpcPortAttributes attributes;
+    SECURITY_DESCRIPTOR sd;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name;
+    NTSTATUS status;
+
+    listener = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*listener));
+    if (!listener)
+        return RPC_S_OUT_OF_RESOURCES;
+    listener->refs = 1;
+    InitializeCriticalSection(&listener->cs);
+    InitializeCriticalSection(&listener->send_cs);
+    list_init(&listener->requests);
+    list_init(&listener->connections);
+    listener->accept_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    listener->port_name = ncalrpc_port_name(connection->common.Endpoint);
+    if (!listener->accept_event || !listener->port_name)
+    {
+        rpcrt4_alpc_listener_release(listener);
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    TRACE("listening on %s\n", debugstr_w(listener->port_name));
+
+    /* ncalrpc endpoints are open to every local caller */
+    InitializeSecurityDescriptor(&sd, SECURITY_DESCRIPTOR_REVISION);
+    SetSecurityDescriptorDacl(&sd, TRUE, NULL, FALSE);
+
+    RtlInitUnicodeString(&name, listener->port_name);
+    InitializeObjectAttributes(&attr, &name, 0, NULL, &sd);
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.MaxMessageLength = ALPC_MAX_MESSAGE_LENGTH;
+    status = pNtAlpcCreatePort(&listener->port, &attr, &attributes);
+    if (status)
+    {
+        WARN("NtAlpcCreatePort failed with status %08x\n", status);
+        rpcrt4_alpc_listener_release(listener);
+        if (status == STATUS_OBJECT_NAME_COLLISION)
+            return RPC_S_DUPLICATE_ENDPOINT;
+        else
+            return RPC_S_CANT_CREATE_ENDPOINT;
+    }
+
+    listener->thread = CreateThread(NULL, 0, rpcrt4_alpc_listen_thread, listener, 0, NULL);
+    if (!listener->thread)
+    {
+        ERR("failed to create thread, error=%08x\n", GetLastError());
+        NtClose(listener->port);
+        rpcrt4_alpc_listener_release(listener);
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    connection->listener = listener;
+    return RPC_S_OK;
+}
+
+static void rpcrt4_alpc_listener_stop(struct alpc_listener *listener)
+{
+    struct alpc_packet *packet, *next;
+    HANDLE port;
+
+    /* ports can't be waited on, so wake the thread with a connection request
+     * it turns down */
+    if (WaitForSingleObject(listener->thread, 0) == WAIT_TIMEOUT)
+    {
+        if (rpcrt4_alpc_connect(&port, listener->port_name, NCALRPC_CONNECT_STOP, NULL) == STATUS_SUCCESS)
+            NtClose(port);
+        WaitForSingleObject(listener->thread, INFINITE);
+    }
+    CloseHandle(listener->thread);
+    listener->thread = NULL;
+
+    /* and turn down the clients the server thread didn't get to */
+    EnterCriticalSection(&listener->cs);
+    LIST_FOR_EACH_ENTRY_SAFE(packet, next, &listener->requests, struct alpc_packet, entry)
+    {
+        list_remove(&packet->entry);
+        rpcrt4_alpc_reject(listener, (RpcPortMessage *)packet->data);
+        HeapFree(GetProcessHeap(), 0, packet);
+    }
+    LeaveCriticalSection(&listener->cs);
+
+    NtClose(listener->port);
+    listener->port = NULL;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_alpc_open(RpcConnection* Connection)
+{
+    RpcConnection_alpc *alpc = (RpcConnection_alpc *) Connection;
+    WCHAR *port_name;
+    NTSTATUS status;
+
+    /* already connected? */
+    if (alpc->port)
+        return RPC_S_OK;
+
+    if (!alpc->message)
+    {
+        alpc->message = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*alpc->message));
+        if (!alpc->message)
+            return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    port_name = ncalrpc_port_name(Connection->Endpoint);
+    if (!port_name)
+        return RPC_S_OUT_OF_RESOURCES;
+
+    TRACE("connecting to %s\n", debugstr_w(port_name));
+
+    status = rpcrt4_alpc_connect(&alpc->port, port_name, NCALRPC_CONNECT_BIND, Connection->QOS);
+    HeapFree(GetProcessHeap(), 0, port_name);
+    if (status)
+    {
+        WARN("connection failed, status %08x\n", status);
+        alpc->port = NULL;
+        return RPC_S_SERVER_UNAVAILABLE;
+    }
+
+    alpc->message->header.DataLength = 0;
+    alpc->message_offset = 0;
+    return RPC_S_OK;
+}
+
+static RPC_STATUS rpcrt4_protseq_ncalrpc_alpc_open_endpoint(RpcServerProtseq* protseq, const char *endpoint)
+{
+    RPC_STATUS r;
+    RpcConnection *Connection;
+    char generated_endpoint[22];
+
+    if (!endpoint)
+    {
+        static LONG lrpc_nameless_id;
+        DWORD process_id = GetCurrentProcessId();
+        ULONG id = InterlockedIncrement(&lrpc_nameless_id);
+        snprintf(generated_endpoint, sizeof(generated_endpoint),
+                 "LRPC%08x.%08x", process_id, id);
+        endpoint = generated_endpoint;
+    }
+
+    r = RPCRT4_CreateConnection(&Connection, TRUE, protseq->Protseq, NULL,
+                                endpoint, NULL, NULL, NULL, NULL);
+    if (r != RPC_S_OK)
+        return r;
+
+    ((RpcConnection_alpc *)Connection)->listening = TRUE;
+    r = rpcrt4_conn_alpc_listen((RpcConnection_alpc *)Connection);
+    if (r != RPC_S_OK)
+    {
+        RPCRT4_ReleaseConnection(Connection);
+        return r;
+    }
+
+    EnterCriticalSection(&protseq->cs);
+    list_add_head(&protseq->listeners, &Connection->protseq_entry);
+    Connection->protseq = protseq;
+    LeaveCriticalSection(&protseq->cs);
+
+    return RPC_S_OK;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_alpc_handoff(RpcConnection *old_conn, RpcConnection *new_conn)
+{
+    RpcConnection_alpc *old_alpc = (RpcConnection_alpc *)old_conn;
+    RpcConnection_alpc *new_alpc = (RpcConnection_alpc *)new_conn;
+    struct alpc_listener *listener = old_alpc->listener;
+    struct alpc_packet *request = old_alpc->accept_request;
+    DWORD len = MAX_COMPUTERNAME_LENGTH + 1;
+    NTSTATUS status;
+
+    TRACE("%s\n", old_conn->Endpoint);
+
+    old_alpc->accept_request = NULL;
+    new_alpc->event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    InterlockedIncrement(&listener->refs);
+    new_alpc->listener = listener;
+
+    /* the port context is how the listener thread finds us */
+    EnterCriticalSection(&listener->cs);
+    list_add_tail(&listener->connections, &new_alpc->listener_entry);
+    LeaveCriticalSection(&listener->cs);
+
+    status = pNtAlpcAcceptConnectPort(&new_alpc->port, listener->port, 0, NULL, NULL, new_alpc,
+                                      (RpcPortMessage *)request->data, NULL, new_alpc->event != NULL);
+    HeapFree(GetProcessHeap(), 0, request);
+    if (status || !new_alpc->event)
+    {
+        WARN("accepting the connection failed, status %08x\n", status);
+        new_alpc->port = NULL;
+        new_alpc->peer_closed = TRUE;
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    /* Store the local computer name as the NetworkAddr for ncalrpc. */
+    new_conn->NetworkAddr = HeapAlloc(GetProcessHeap(), 0, len);
+    if (!GetComputerNameA(new_conn->NetworkAddr, &len))
+    {
+        ERR("Failed to retrieve the computer name, error %u\n", GetLastError());
+        return RPC_S_OUT_OF_RESOURCES;
+    }
+
+    return RPC_S_OK;
+}
+
+static RPC_STATUS rpcrt4_ncalrpc_alpc_is_server_listening(const char *endpoint)
+{
+    WCHAR *port_name;
+    NTSTATUS status;
+    HANDLE port;
+
+    port_name = ncalrpc_port_name(endpoint);
+    if (!port_name)
+        return RPC_S_OUT_OF_RESOURCES;
+
+    status = rpcrt4_alpc_connect(&port, port_name, NCALRPC_CONNECT_PROBE, NULL);
+    HeapFree(GetProcessHeap(), 0, port_name);
+    if (status == STATUS_SUCCESS)
+        NtClose(port);
+
+    /* a listening server turns the probe down */
+    if (status == STATUS_SUCCESS || status == STATUS_PORT_CONNECTION_REFUSED)
+        return RPC_S_OK;
+    return RPC_S_NOT_LISTENING;
+}
+
+static NTSTATUS rpcrt4_conn_alpc_send(RpcConnection_alpc *connection, const void *data, unsigned int size)
+{
+    RpcPortBuffer msg;
+
+    memset(&msg.header, 0, sizeof(msg.header));
+    msg.header.DataLength = size;
+    msg.header.TotalLength = sizeof(msg.header) + size;
+    if (size)
+        memcpy(&msg.header + 1, data, size);
+
+    return pNtAlpcSendWaitReceivePort(connection->port, 0, &msg.header, NULL, NULL, NULL, NULL, NULL);
+}
+
+/* LPC doesn't tell a client that its server port went away, so come up now
+ * and then to look for that and for cancellation */
+static NTSTATUS rpcrt4_conn_alpc_receive(RpcConnection_alpc *connection)
+{
+    LARGE_INTEGER timeout;
+    SIZE_T length;
+    NTSTATUS status;
+
+    timeout.QuadPart = -500 * 10000;
+    for (;;)
+    {
+        if (connection->read_closed || connection->cancelled)
+        {
+            status = STATUS_CANCELLED;
+            break;
+        }
+
+        length = sizeof(*connection->message);
+        status = pNtAlpcSendWaitReceivePort(connection->port, 0, NULL, NULL, &connection->message->header,
+                                            &length, NULL, &timeout);
+        if (status != STATUS_TIMEOUT)
+            break;
+
+        /* the server ignores empty messages, sending one fails once it is gone */
+        status = rpcrt4_conn_alpc_send(connection, NULL, 0);
+        if (status)
+            break;
+    }
+
+    connection->message_offset = 0;
+    if (status)
+    {
+        connection->message->header.DataLength = 0;
+        return status;
+    }
+
+    /* the server sends an empty message when it closes the connection */
+    if (!connection->message->header.DataLength)
+        return STATUS_PORT_DISCONNECTED;
+    return STATUS_SUCCESS;
+}
+
+static int rpcrt4_conn_alpc_read_packets(RpcConnection_alpc *connection, char *buffer, unsigned int count)
+{
+    struct alpc_listener *listener = connection->listener;
+    struct alpc_packet *packet;
+    unsigned int bytes_read = 0, len;
+
+    EnterCriticalSection(&listener->cs);
+    while (bytes_read < count)
+    {
+        if (!list_empty(&connection->packets))
+        {
+            packet = LIST_ENTRY(list_head(&connection->packets), struct alpc_packet, entry);
+            len = min(count - bytes_read, packet->size - packet->offset);
+            memcpy(buffer + bytes_read, packet->data + packet->offset, len);
+            bytes_read += len;
+            packet->offset += len;
+            if (packet->offset == packet->size)
+            {
+                list_remove(&packet->entry);
+                HeapFree(GetProcessHeap(), 0, packet);
+            }
+            continue;
+        }
+
+        if (connection->read_closed || connection->peer_closed)
+            break;
+
+        LeaveCriticalSection(&listener->cs);
+        WaitForSingleObject(connection->event, INFINITE);
+        EnterCriticalSection(&listener->cs);
+    }
+    LeaveCriticalSection(&listener->cs);
+
+    return bytes_read == count ? count : -1;
+}
+
+static int rpcrt4_conn_alpc_read(RpcConnection *conn, void *buffer, unsigned int count)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    RpcPortMessage *header;
+    unsigned int bytes_read = 0, len;
+
+    if (connection->listener)
+        return rpcrt4_conn_alpc_read_packets(connection, buffer, count);
+
+    if (!connection->message)
+        return -1;
+
+    header = &connection->message->header;
+    while (bytes_read < count)
+    {
+        if (connection->message_offset == header->DataLength)
+        {
+            if (rpcrt4_conn_alpc_receive(connection) != STATUS_SUCCESS)
+                return -1;
+            continue;
+        }
+
+        len = min(count - bytes_read, header->DataLength - connection->message_offset);
+        memcpy((char *)buffer + bytes_read, (char *)(header + 1) + connection->message_offset, len);
+        bytes_read += len;
+        connection->message_offset += len;
+    }
+
+    return count;
+}
+
+static int rpcrt4_conn_alpc_write(RpcConnection *conn, const void *buffer, unsigned int count)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    struct alpc_listener *listener = connection->listener;
+    const char *data = buffer;
+    unsigned int bytes_left = count, len;
+    NTSTATUS status = STATUS_SUCCESS;
+
+    /* a fragment takes several messages, so replies of concurrent calls on a
+     * server connection must not interleave */
+    if (listener)
+        EnterCriticalSection(&listener->send_cs);
+    else
+        connection->cancelled = FALSE;
+
+    while (bytes_left && status == STATUS_SUCCESS)
+    {
+        len = min(bytes_left, ALPC_MAX_DATA_LENGTH);
+        status = rpcrt4_conn_alpc_send(connection, data, len);
+        data += len;
+        bytes_left -= len;
+    }
+
+    if (listener)
+        LeaveCriticalSection(&listener->send_cs);
+
+    if (status)
+    {
+        WARN("send failed with status %08x\n", status);
+        return -1;
+    }
+    return count;
+}
+
+static int rpcrt4_conn_alpc_close(RpcConnection *conn)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    struct alpc_listener *listener = connection->listener;
+    struct alpc_packet *packet, *next;
+
+    if (listener && connection->listening)
+    {
+        rpcrt4_alpc_listener_stop(listener);
+    }
+    else if (listener)
+    {
+        EnterCriticalSection(&listener->cs);
+        list_remove(&connection->listener_entry);
+        list_init(&connection->listener_entry);
+        LIST_FOR_EACH_ENTRY_SAFE(packet, next, &connection->packets, struct alpc_packet, entry)
+        {
+            list_remove(&packet->entry);
+            HeapFree(GetProcessHeap(), 0, packet);
+        }
+        LeaveCriticalSection(&listener->cs);
+
+        /* the client port doesn't notice the server port closing */
+        if (connection->port && !connection->peer_closed)
+            rpcrt4_conn_alpc_send(connection, NULL, 0);
+    }
+
+    if (connection->port)
+    {
+        NtClose(connection->port);
+        connection->port = NULL;
+    }
+    if (connection->event)
+    {
+        CloseHandle(connection->event);
+        connection->event = NULL;
+    }
+    HeapFree(GetProcessHeap(), 0, connection->message);
+    connection->message = NULL;
+
+    if (listener)
+    {
+        connection->listener = NULL;
+        rpcrt4_alpc_listener_release(listener);
+    }
+    return 0;
+}
+
+static void rpcrt4_conn_alpc_close_read(RpcConnection *conn)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+
+    connection->read_closed = TRUE;
+    if (connection->event)
+        SetEvent(connection->event);
+}
+
+static void rpcrt4_conn_alpc_cancel_call(RpcConnection *conn)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    connection->cancelled = TRUE;
+}
+
+static int rpcrt4_conn_alpc_wait_for_incoming_data(RpcConnection *conn)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    struct alpc_listener *listener = connection->listener;
+    BOOL ready;
+
+    if (!listener)
+    {
+        if (!connection->message)
+            return -1;
+        if (connection->message_offset < connection->message->header.DataLength)
+            return 0;
+        return rpcrt4_conn_alpc_receive(connection) == STATUS_SUCCESS ? 0 : -1;
+    }
+
+    EnterCriticalSection(&listener->cs);
+    while (list_empty(&connection->packets) && !connection->read_closed && !connection->peer_closed)
+    {
+        LeaveCriticalSection(&listener->cs);
+        WaitForSingleObject(connection->event, INFINITE);
+        EnterCriticalSection(&listener->cs);
+    }
+    ready = !list_empty(&connection->packets);
+    LeaveCriticalSection(&listener->cs);
+
+    return ready ? 0 : -1;
+}
+
+static RPC_STATUS rpcrt4_conn_alpc_impersonate_client(RpcConnection *conn)
+{
+    RpcConnection_alpc *connection = (RpcConnection_alpc *)conn;
+    RpcPortMessage message;
+    NTSTATUS status;
+
+    TRACE("(%p)\n", conn);
+
+    if (conn->AuthInfo && SecIsValidHandle(&conn->ctx))
+        return RPCRT4_default_impersonate_client(conn);
+
+    if (!connection->listener)
+        return RPC_S_NO_CONTEXT_AVAILABLE;
+
+    /* the client thread of the last request is the one to impersonate */
+    EnterCriticalSection(&connection->listener->cs);
+    message = connection->last_message;
+    LeaveCriticalSection(&connection->listener->cs);
+
+    status = pNtAlpcImpersonateClientOfPort(connection->port, &message, NULL);
+    if (status)
+    {
+        WARN("NtAlpcImpersonateClientOfPort failed with status %08x\n", status);
+        return RPC_S_NO_CONTEXT_AVAILABLE;
+    }
+    return RPC_S_OK;
+}
+
+static void *rpcrt4_protseq_alpc_get_wait_array(RpcServerProtseq *protseq, void *prev_array, unsigned int *count)
+{
+    HANDLE *objs = prev_array;
+    RpcConnection_alpc *conn;
+    RpcServerProtseq_np *npps = CONTAINING_RECORD(protseq, RpcServerProtseq_np, common);
+
+    EnterCriticalSection(&protseq->cs);
+
+    /* start listening and count endpoints */
+    *count = 1;
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_alpc, common.protseq_entry)
+    {
+        if (!conn->listener && rpcrt4_conn_alpc_listen(conn) != RPC_S_OK)
+            continue;
+        (*count)++;
+    }
+
+    /* make array of accept events */
+    if (objs)
+        objs = HeapReAlloc(GetProcessHeap(), 0, objs, *count*sizeof(HANDLE));
+    else
+        objs = HeapAlloc(GetProcessHeap(), 0, *count*sizeof(HANDLE));
+    if (!objs)
+    {
+        ERR("couldn't allocate objs\n");
+        LeaveCriticalSection(&protseq->cs);
+        return NULL;
+    }
+
+    objs[0] = npps->mgr_event;
+    *count = 1;
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_alpc, common.protseq_entry)
+    {
+        if (conn->listener)
+            objs[(*count)++] = conn->listener->accept_event;
+    }
+    LeaveCriticalSection(&protseq->cs);
+    return objs;
+}
+
+static int rpcrt4_protseq_alpc_wait_for_new_connection(RpcServerProtseq *protseq, unsigned int count, void *wait_array)
+{
+    HANDLE b_handle;
+    HANDLE *objs = wait_array;
+    DWORD res;
+    RpcConnection *cconn = NULL;
+    RpcConnection_alpc *conn;
+    struct alpc_listener *listener;
+    BOOL found = FALSE;
+
+    if (!objs)
+        return -1;
+
+    do
+    {
+        res = WaitForMultipleObjectsEx(count, objs, FALSE, INFINITE, TRUE);
+    } while (res == WAIT_IO_COMPLETION);
+
+    if (res == WAIT_OBJECT_0)
+        return 0;
+    else if (res == WAIT_FAILED)
+    {
+        ERR("wait failed with error %d\n", GetLastError());
+        return -1;
+    }
+
+    b_handle = objs[res - WAIT_OBJECT_0];
+    /* find which endpoint got a connection request */
+    EnterCriticalSection(&protseq->cs);
+    LIST_FOR_EACH_ENTRY(conn, &protseq->listeners, RpcConnection_alpc, common.protseq_entry)
+    {
+        listener = conn->listener;
+        if (!listener || b_handle != listener->accept_event)
+            continue;
+
+        found = TRUE;
+        EnterCriticalSection(&listener->cs);
+        if (!list_empty(&listener->requests))
+        {
+            conn->accept_request = LIST_ENTRY(list_head(&listener->requests), struct alpc_packet, entry);
+            list_remove(&conn->accept_request->entry);
+        }
+        /* one wakeup per request */
+        if (!list_empty(&listener->requests))
+            SetEvent(listener->accept_event);
+        LeaveCriticalSection(&listener->cs);
+
+        if (conn->accept_request)
+            cconn = rpcrt4_spawn_connection(&conn->common);
+        if (conn->accept_request)
+        {
+            rpcrt4_alpc_reject(listener, (RpcPortMessage *)conn->accept_request->data);
+            HeapFree(GetProcessHeap(), 0, conn->accept_request);
+            conn->accept_request = NULL;
+        }
+        break;
+    }
+    LeaveCriticalSection(&protseq->cs);
+
+    if (!found)
+    {
+        ERR("failed to locate connection for handle %p\n", b_handle);
+        return -1;
+    }
+    if (cconn)
+        RPCRT4_new_client(cconn);
+    return 1;
+}
+
+static const struct connection_ops ncalrpc_alpc_conn_ops =
+{
+    "ncalrpc",
+    { EPM_PROTOCOL_NCALRPC, EPM_PROTOCOL_PIPE },
+    rpcrt4_conn_alpc_alloc,
+    rpcrt4_ncalrpc_alpc_open,
+    rpcrt4_ncalrpc_alpc_handoff,
+    rpcrt4_conn_alpc_read,
+    rpcrt4_conn_alpc_write,
+    rpcrt4_conn_alpc_close,
+    rpcrt4_conn_alpc_close_read,
+    rpcrt4_conn_alpc_cancel_call,
+    rpcrt4_ncalrpc_alpc_is_server_listening,
+    rpcrt4_conn_alpc_wait_for_incoming_data,
+    rpcrt4_ncalrpc_get_top_of_tower,
+    rpcrt4_ncalrpc_parse_top_of_tower,
+    NULL,
+    rpcrt4_ncalrpc_is_authorized,
+    rpcrt4_ncalrpc_authorize,
+    rpcrt4_ncalrpc_secure_packet,
+    rpcrt4_conn_alpc_impersonate_client,
+    rpcrt4_conn_np_revert_to_self,
+    rpcrt4_ncalrpc_inquire_auth_client,
+};
+
+static const struct protseq_ops ncalrpc_alpc_protseq_ops =
+{
+    "ncalrpc",
+    rpcrt4_protseq_np_alloc,
+    rpcrt4_protseq_np_signal_state_changed,
+    rpcrt4_protseq_alpc_get_wait_array,
+    rpcrt4_protseq_np_free_wait_array,
+    rpcrt4_protseq_alpc_wait_for_new_connection,
+    rpcrt4_protseq_ncalrpc_alpc_open_endpoint,
+};
+#endif /* __REACTOS__ */
+
 /**** ncacn_ip_tcp support ****/
 
 static size_t rpcrt4_ip_tcp_get_top_of_tower(unsigned char *tower_data,
@@ -3338,6 +4348,10 @@ static const struct protseq_ops protseq_list[] =
 const struct protseq_ops *rpcrt4_get_protseq_ops(const char *protseq)
 {
   unsigned int i;
+#ifdef __REACTOS__
+  if (!strcmp(protseq, "ncalrpc") && rpcrt4_ncalrpc_use_alpc())
+    return &ncalrpc_alpc_protseq_ops;
+#endif
   for(i = 0; i < ARRAY_SIZE(protseq_list); i++)
     if (!strcmp(protseq_list[i].name, protseq))
       return &protseq_list[i];
@@ -3347,6 +4361,10 @@ const struct protseq_ops *rpcrt4_get_protseq_ops(const char *protseq)
 static const struct connection_ops *rpcrt4_get_conn_protseq_ops(const char *protseq)
 {
     unsigned int i;
+#ifdef __REACTOS__
+    if (!strcmp(protseq, "ncalrpc") && rpcrt4_ncalrpc_use_alpc())
+        return &ncalrpc_alpc_conn_ops;
+#endif
     for(i = 0; i < ARRAY_SIZE(conn_protseq_list); i++)
         if (!strcmp(conn_protseq_list[i].name, protseq))
             return &conn_protseq_list[i];
@@ -1352,6 +1352,77 @@ static HRESULT fill_array_desc(compile_ctx_t *ctx, dim_decl_t *dim_decl, array_d
     return S_OK;
 }
 
+static BOOL lookup_local(function_t *func, const WCHAR *name, int *ret)
+{
+    unsigned i;
+
+    /* Assigning to the function name sets its return value */
+    if(!wcsicmp(func->name, name))
+        return FALSE;
+
+    for(i = 0; i < func->var_cnt; i++) {
+        if(!wcsicmp(func->vars[i].name, name)) {
+            *ret = i;
+            return TRUE;
+        }
+    }
+
+    for(i = 0; i < func->arg_cnt; i++) {
+        if(!wcsicmp(func->args[i].name, name)) {
+            *ret = -(int)i-1;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Local variables and arguments are known once the whole function is compiled (Dim may follow
+ * the first use), so identifier instructions referring to them are rewritten afterwards to
+ * use slot indices instead of looking up the name on every execution. */
+static void resolve_locals(compile_ctx_t *ctx, function_t *func)
+{
+    instr_t *instr;
+    int slot;
+
+    for(instr = ctx->code->instrs+func->code_off; instr < ctx->code->instrs+ctx->instr_cnt; instr++) {
+        switch(instr->op) {
+        case OP_icall:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_icall_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_assign_ident:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_assign_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_set_ident:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_set_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_incc:
+            if(lookup_local(func, instr->arg1.bstr, &slot)) {
+                instr->op = OP_incc_local;
+                instr->arg1.lng = slot;
+            }
+            break;
+        case OP_step:
+            if(lookup_local(func, instr->arg2.bstr, &slot)) {
+                instr->op = OP_step_local;
+                instr->arg2.lng = slot;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *func)
 {
     HRESULT hres;
@@ -1464,6 +1535,9 @@ static HRESULT compile_func(compile_ctx_t *ctx, statement_t *stat, function_t *f
         assert(array_id == func->array_cnt);
     }
 
+    if(func->type != FUNC_GLOBAL)
+        resolve_locals(ctx, func);
+
     return S_OK;
 }
 
@@ -1714,18 +1788,9 @@ static HRESULT compile_class(compile_ctx_t *ctx, class_decl_t *class_decl)
 static BOOL lookup_script_identifier(script_ctx_t *script, const WCHAR *identifier)
 {
     class_desc_t *class;
-    dynamic_var_t *var;
-    function_t *func;
 
-    for(var = script->global_vars; var; var = var->next) {
-        if(!wcsicmp(var->name, identifier))
-            return TRUE;
-    }
-
-    for(func = script->global_funcs; func; func = func->next) {
-        if(!wcsicmp(func->name, identifier))
-            return TRUE;
-    }
+    if(lookup_global_var(script, identifier) || lookup_global_func(script, identifier))
+        return TRUE;
 
     for(class = script->classes; class; class = class->next) {
         if(!wcsicmp(class->name, identifier))
@@ -1889,14 +1954,18 @@ HRESULT compile_script(script_ctx_t *script, const WCHAR *src, const WCHAR *deli
     if(ctx.global_vars) {
         dynamic_var_t *var;
 
-        for(var = ctx.global_vars; var->next; var = var->next);
+        for(var = ctx.global_vars; var->next; var = var->next)
+            hash_global_var(script, var);
+        hash_global_var(script, var);
 
         var->next = script->global_vars;
         script->global_vars = ctx.global_vars;
     }
 
     if(ctx.funcs) {
-        for(new_func = ctx.funcs; new_func->next; new_func = new_func->next);
+        for(new_func = ctx.funcs; new_func->next; new_func = new_func->next)
+            hash_global_func(script, new_func);
+        hash_global_func(script, new_func);
 
         new_func->next = script->global_funcs;
         script->global_funcs = ctx.funcs;
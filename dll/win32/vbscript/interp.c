@@ -95,6 +95,32 @@ static BOOL lookup_dynamic_vars(dynamic_var_t *var, const WCHAR *name, ref_t *re
     return FALSE;
 }
 
+static BOOL lookup_global_vars(script_ctx_t *script, const WCHAR *name, ref_t *ref)
+{
+    dynamic_var_t *var;
+
+    var = lookup_global_var(script, name);
+    if(!var)
+        return FALSE;
+
+    ref->type = var->is_const ? REF_CONST : REF_VAR;
+    ref->u.v = &var->v;
+    return TRUE;
+}
+
+/* Local variables and arguments resolved by the compiler are referenced by slot.
+ * Non-negative slots index variables, negative ones arguments. */
+static void local_ref(exec_ctx_t *ctx, int slot, ref_t *ref)
+{
+    ref->type = REF_VAR;
+    ref->u.v = slot < 0 ? ctx->args + (-slot-1) : ctx->vars + slot;
+}
+
+static inline const WCHAR *local_name(function_t *func, int slot)
+{
+    return slot < 0 ? func->args[-slot-1].name : func->vars[slot].name;
+}
+
 static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_t invoke_type, ref_t *ref)
 {
     named_item_t *item;
@@ -128,7 +154,9 @@ static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_
         }
     }
 
-    if(lookup_dynamic_vars(ctx->func->type == FUNC_GLOBAL ? ctx->script->global_vars : ctx->dynamic_vars, name, ref))
+    if(ctx->func->type == FUNC_GLOBAL
+            ? lookup_global_vars(ctx->script, name, ref)
+            : lookup_dynamic_vars(ctx->dynamic_vars, name, ref))
         return S_OK;
 
     if(ctx->func->type != FUNC_GLOBAL) {
@@ -162,15 +190,14 @@ static HRESULT lookup_identifier(exec_ctx_t *ctx, BSTR name, vbdisp_invoke_type_
         }
     }
 
-    if(ctx->func->type != FUNC_GLOBAL && lookup_dynamic_vars(ctx->script->global_vars, name, ref))
+    if(ctx->func->type != FUNC_GLOBAL && lookup_global_vars(ctx->script, name, ref))
         return S_OK;
 
-    for(func = ctx->script->global_funcs; func; func = func->next) {
-        if(!wcsicmp(func->name, name)) {
-            ref->type = REF_FUNC;
-            ref->u.f = func;
-            return S_OK;
-        }
+    func = lookup_global_func(ctx->script, name);
+    if(func) {
+        ref->type = REF_FUNC;
+        ref->u.f = func;
+        return S_OK;
     }
 
     hres = get_builtin_id(ctx->script->global_obj, name, &id);
@@ -230,6 +257,7 @@ static HRESULT add_dynamic_var(exec_ctx_t *ctx, const WCHAR *name,
     if(ctx->func->type == FUNC_GLOBAL) {
         new_var->next = ctx->script->global_vars;
         ctx->script->global_vars = new_var;
+        hash_global_var(ctx->script, new_var);
     }else {
         new_var->next = ctx->dynamic_vars;
         ctx->dynamic_vars = new_var;
@@ -515,19 +543,12 @@ static HRESULT array_access(exec_ctx_t *ctx, SAFEARRAY *array, DISPPARAMS *dp, V
     return hres;
 }
 
-static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
+static HRESULT call_ref(exec_ctx_t *ctx, ref_t *ref, const WCHAR *identifier, unsigned arg_cnt, VARIANT *res)
 {
-    BSTR identifier = ctx->instr->arg1.bstr;
-    const unsigned arg_cnt = ctx->instr->arg2.uint;
     DISPPARAMS dp;
-    ref_t ref;
     HRESULT hres;
 
-    hres = lookup_identifier(ctx, identifier, VBDISP_CALLGET, &ref);
-    if(FAILED(hres))
-        return hres;
-
-    switch(ref.type) {
+    switch(ref->type) {
     case REF_VAR:
     case REF_CONST: {
         VARIANT *v;
@@ -537,17 +558,17 @@ static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
             return E_NOTIMPL;
         }
 
-        v = V_VT(ref.u.v) == (VT_VARIANT|VT_BYREF) ? V_VARIANTREF(ref.u.v) : ref.u.v;
+        v = V_VT(ref->u.v) == (VT_VARIANT|VT_BYREF) ? V_VARIANTREF(ref->u.v) : ref->u.v;
 
         if(arg_cnt) {
             SAFEARRAY *array = NULL;
 
             switch(V_VT(v)) {
             case VT_ARRAY|VT_BYREF|VT_VARIANT:
-                array = *V_ARRAYREF(ref.u.v);
+                array = *V_ARRAYREF(ref->u.v);
                 break;
             case VT_ARRAY|VT_VARIANT:
-                array = V_ARRAY(ref.u.v);
+                array = V_ARRAY(ref->u.v);
                 break;
             case VT_DISPATCH:
                 vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
@@ -575,13 +596,13 @@ static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
     }
     case REF_DISP:
         vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
-        hres = disp_call(ctx->script, ref.u.d.disp, ref.u.d.id, &dp, res);
+        hres = disp_call(ctx->script, ref->u.d.disp, ref->u.d.id, &dp, res);
         if(FAILED(hres))
             return hres;
         break;
     case REF_FUNC:
         vbstack_to_dp(ctx, arg_cnt, FALSE, &dp);
-        hres = exec_script(ctx->script, FALSE, ref.u.f, NULL, &dp, res);
+        hres = exec_script(ctx->script, FALSE, ref->u.f, NULL, &dp, res);
         if(FAILED(hres))
             return hres;
         break;
@@ -592,9 +613,9 @@ static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
         }
 
         if(res) {
-            IDispatch_AddRef(ref.u.obj);
+            IDispatch_AddRef(ref->u.obj);
             V_VT(res) = VT_DISPATCH;
-            V_DISPATCH(res) = ref.u.obj;
+            V_DISPATCH(res) = ref->u.obj;
         }
         break;
     case REF_NONE:
@@ -615,6 +636,19 @@ static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
     return S_OK;
 }
 
+static HRESULT do_icall(exec_ctx_t *ctx, VARIANT *res)
+{
+    BSTR identifier = ctx->instr->arg1.bstr;
+    ref_t ref;
+    HRESULT hres;
+
+    hres = lookup_identifier(ctx, identifier, VBDISP_CALLGET, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    return call_ref(ctx, &ref, identifier, ctx->instr->arg2.uint, res);
+}
+
 static HRESULT interp_icall(exec_ctx_t *ctx)
 {
     VARIANT v;
@@ -635,6 +669,23 @@ static HRESULT interp_icallv(exec_ctx_t *ctx)
     return do_icall(ctx, NULL);
 }
 
+static HRESULT interp_icall_local(exec_ctx_t *ctx)
+{
+    const int slot = ctx->instr->arg1.lng;
+    VARIANT v;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(local_name(ctx->func, slot)));
+
+    local_ref(ctx, slot, &ref);
+    hres = call_ref(ctx, &ref, local_name(ctx->func, slot), ctx->instr->arg2.uint, &v);
+    if(FAILED(hres))
+        return hres;
+
+    return stack_push(ctx, &v);
+}
+
 static HRESULT do_mcall(exec_ctx_t *ctx, VARIANT *res)
 {
     const BSTR identifier = ctx->instr->arg1.bstr;
@@ -713,18 +764,13 @@ static HRESULT assign_value(exec_ctx_t *ctx, VARIANT *dst, VARIANT *src, WORD fl
     return S_OK;
 }
 
-static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *dp)
+static HRESULT assign_ref(exec_ctx_t *ctx, ref_t *ref, const WCHAR *name, WORD flags, DISPPARAMS *dp)
 {
-    ref_t ref;
     HRESULT hres;
 
-    hres = lookup_identifier(ctx, name, VBDISP_LET, &ref);
-    if(FAILED(hres))
-        return hres;
-
-    switch(ref.type) {
+    switch(ref->type) {
     case REF_VAR: {
-        VARIANT *v = ref.u.v;
+        VARIANT *v = ref->u.v;
 
         if(V_VT(v) == (VT_VARIANT|VT_BYREF))
             v = V_VARIANTREF(v);
@@ -766,7 +812,7 @@ static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *
         break;
     }
     case REF_DISP:
-        hres = disp_propput(ctx->script, ref.u.d.disp, ref.u.d.id, flags, dp);
+        hres = disp_propput(ctx->script, ref->u.d.disp, ref->u.d.id, flags, dp);
         break;
     case REF_FUNC:
         FIXME("functions not implemented\n");
@@ -799,6 +845,18 @@ static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *
     return hres;
 }
 
+static HRESULT assign_ident(exec_ctx_t *ctx, BSTR name, WORD flags, DISPPARAMS *dp)
+{
+    ref_t ref;
+    HRESULT hres;
+
+    hres = lookup_identifier(ctx, name, VBDISP_LET, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    return assign_ref(ctx, &ref, name, flags, dp);
+}
+
 static HRESULT interp_assign_ident(exec_ctx_t *ctx)
 {
     const BSTR arg = ctx->instr->arg1.bstr;
@@ -844,6 +902,55 @@ static HRESULT interp_set_ident(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_assign_local(exec_ctx_t *ctx)
+{
+    const int slot = ctx->instr->arg1.lng;
+    const unsigned arg_cnt = ctx->instr->arg2.uint;
+    DISPPARAMS dp;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(local_name(ctx->func, slot)));
+
+    local_ref(ctx, slot, &ref);
+    vbstack_to_dp(ctx, arg_cnt, TRUE, &dp);
+    hres = assign_ref(ctx, &ref, local_name(ctx->func, slot), DISPATCH_PROPERTYPUT, &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, arg_cnt+1);
+    return S_OK;
+}
+
+static HRESULT interp_set_local(exec_ctx_t *ctx)
+{
+    const int slot = ctx->instr->arg1.lng;
+    const unsigned arg_cnt = ctx->instr->arg2.uint;
+    DISPPARAMS dp;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(local_name(ctx->func, slot)));
+
+    if(arg_cnt) {
+        FIXME("arguments not supported\n");
+        return E_NOTIMPL;
+    }
+
+    hres = stack_assume_disp(ctx, 0, NULL);
+    if(FAILED(hres))
+        return hres;
+
+    local_ref(ctx, slot, &ref);
+    vbstack_to_dp(ctx, 0, TRUE, &dp);
+    hres = assign_ref(ctx, &ref, local_name(ctx->func, slot), DISPATCH_PROPERTYPUTREF, &dp);
+    if(FAILED(hres))
+        return hres;
+
+    stack_popn(ctx, 1);
+    return S_OK;
+}
+
 static HRESULT interp_assign_member(exec_ctx_t *ctx)
 {
     BSTR identifier = ctx->instr->arg1.bstr;
@@ -1065,16 +1172,12 @@ static HRESULT interp_dim(exec_ctx_t *ctx)
     return S_OK;
 }
 
-static HRESULT interp_step(exec_ctx_t *ctx)
+static HRESULT do_step(exec_ctx_t *ctx, VARIANT *var)
 {
-    const BSTR ident = ctx->instr->arg2.bstr;
     BOOL gteq_zero;
     VARIANT zero;
-    ref_t ref;
     HRESULT hres;
 
-    TRACE("%s\n", debugstr_w(ident));
-
     V_VT(&zero) = VT_I2;
     V_I2(&zero) = 0;
     hres = VarCmp(stack_top(ctx, 0), &zero, ctx->script->lcid, 0);
@@ -1083,16 +1186,7 @@ static HRESULT interp_step(exec_ctx_t *ctx)
 
     gteq_zero = hres == VARCMP_GT || hres == VARCMP_EQ;
 
-    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
-    if(FAILED(hres))
-        return hres;
-
-    if(ref.type != REF_VAR) {
-        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
-        return E_FAIL;
-    }
-
-    hres = VarCmp(ref.u.v, stack_top(ctx, 1), ctx->script->lcid, 0);
+    hres = VarCmp(var, stack_top(ctx, 1), ctx->script->lcid, 0);
     if(FAILED(hres))
         return hres;
 
@@ -1105,6 +1199,37 @@ static HRESULT interp_step(exec_ctx_t *ctx)
     return S_OK;
 }
 
+static HRESULT interp_step(exec_ctx_t *ctx)
+{
+    const BSTR ident = ctx->instr->arg2.bstr;
+    ref_t ref;
+    HRESULT hres;
+
+    TRACE("%s\n", debugstr_w(ident));
+
+    hres = lookup_identifier(ctx, ident, VBDISP_ANY, &ref);
+    if(FAILED(hres))
+        return hres;
+
+    if(ref.type != REF_VAR) {
+        FIXME("%s is not REF_VAR\n", debugstr_w(ident));
+        return E_FAIL;
+    }
+
+    return do_step(ctx, ref.u.v);
+}
+
+static HRESULT interp_step_local(exec_ctx_t *ctx)
+{
+    const int slot = ctx->instr->arg2.lng;
+    ref_t ref;
+
+    TRACE("%s\n", debugstr_w(local_name(ctx->func, slot)));
+
+    local_ref(ctx, slot, &ref);
+    return do_step(ctx, ref.u.v);
+}
+
 static HRESULT interp_newenum(exec_ctx_t *ctx)
 {
     variant_val_t v;
@@ -1996,10 +2121,23 @@ static HRESULT interp_neg(exec_ctx_t *ctx)
     return stack_push(ctx, &v);
 }
 
+static HRESULT do_incc(exec_ctx_t *ctx, VARIANT *var)
+{
+    VARIANT v;
+    HRESULT hres;
+
+    hres = VarAdd(stack_top(ctx, 0), var, &v);
+    if(FAILED(hres))
+        return hres;
+
+    VariantClear(var);
+    *var = v;
+    return S_OK;
+}
+
 static HRESULT interp_incc(exec_ctx_t *ctx)
 {
     const BSTR ident = ctx->instr->arg1.bstr;
-    VARIANT v;
     ref_t ref;
     HRESULT hres;
 
@@ -2014,13 +2152,17 @@ static HRESULT interp_incc(exec_ctx_t *ctx)
         return E_FAIL;
     }
 
-    hres = VarAdd(stack_top(ctx, 0), ref.u.v, &v);
-    if(FAILED(hres))
-        return hres;
+    return do_incc(ctx, ref.u.v);
+}
 
-    VariantClear(ref.u.v);
-    *ref.u.v = v;
-    return S_OK;
+static HRESULT interp_incc_local(exec_ctx_t *ctx)
+{
+    ref_t ref;
+
+    TRACE("\n");
+
+    local_ref(ctx, ctx->instr->arg1.lng, &ref);
+    return do_incc(ctx, ref.u.v);
 }
 
 static HRESULT interp_catch(exec_ctx_t *ctx)
@@ -691,30 +691,28 @@ static HRESULT WINAPI ScriptDisp_GetDispID(IDispatchEx *iface, BSTR bstrName, DW
         }
     }
 
-    for(var = This->ctx->global_vars; var; var = var->next) {
-        if(!wcsicmp(var->name, bstrName)) {
-            ident = add_ident(This, var->name);
-            if(!ident)
-                return E_OUTOFMEMORY;
-
-            ident->is_var = TRUE;
-            ident->u.var = var;
-            *pid = ident_to_id(This, ident);
-            return S_OK;
-        }
+    var = lookup_global_var(This->ctx, bstrName);
+    if(var) {
+        ident = add_ident(This, var->name);
+        if(!ident)
+            return E_OUTOFMEMORY;
+
+        ident->is_var = TRUE;
+        ident->u.var = var;
+        *pid = ident_to_id(This, ident);
+        return S_OK;
     }
 
-    for(func = This->ctx->global_funcs; func; func = func->next) {
-        if(!wcsicmp(func->name, bstrName)) {
-            ident = add_ident(This, func->name);
-            if(!ident)
-                return E_OUTOFMEMORY;
+    func = lookup_global_func(This->ctx, bstrName);
+    if(func) {
+        ident = add_ident(This, func->name);
+        if(!ident)
+            return E_OUTOFMEMORY;
 
-            ident->is_var = FALSE;
-            ident->u.func = func;
-            *pid =  ident_to_id(This, ident);
-            return S_OK;
-        }
+        ident->is_var = FALSE;
+        ident->u.func = func;
+        *pid =  ident_to_id(This, ident);
+        return S_OK;
     }
 
     *pid = -1;
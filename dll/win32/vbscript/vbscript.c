@@ -96,6 +96,55 @@ static void exec_queued_code(script_ctx_t *ctx)
     }
 }
 
+static unsigned global_name_hash(const WCHAR *name)
+{
+    unsigned h = 0;
+
+    for(; *name; name++)
+        h = (h>>(sizeof(unsigned)*8-4)) ^ (h<<4) ^ towlower(*name);
+    return h & (GLOBAL_HASH_SIZE-1);
+}
+
+void hash_global_var(script_ctx_t *ctx, dynamic_var_t *var)
+{
+    unsigned h = global_name_hash(var->name);
+
+    var->hash_next = ctx->global_vars_hash[h];
+    ctx->global_vars_hash[h] = var;
+}
+
+void hash_global_func(script_ctx_t *ctx, function_t *func)
+{
+    unsigned h = global_name_hash(func->name);
+
+    func->hash_next = ctx->global_funcs_hash[h];
+    ctx->global_funcs_hash[h] = func;
+}
+
+dynamic_var_t *lookup_global_var(script_ctx_t *ctx, const WCHAR *name)
+{
+    dynamic_var_t *var;
+
+    for(var = ctx->global_vars_hash[global_name_hash(name)]; var; var = var->hash_next) {
+        if(!wcsicmp(var->name, name))
+            return var;
+    }
+
+    return NULL;
+}
+
+function_t *lookup_global_func(script_ctx_t *ctx, const WCHAR *name)
+{
+    function_t *func;
+
+    for(func = ctx->global_funcs_hash[global_name_hash(name)]; func; func = func->hash_next) {
+        if(!wcsicmp(func->name, name))
+            return func;
+    }
+
+    return NULL;
+}
+
 IDispatch *lookup_named_item(script_ctx_t *ctx, const WCHAR *name, unsigned flags)
 {
     named_item_t *item;
@@ -137,6 +186,7 @@ static void release_script(script_ctx_t *ctx)
 
     release_dynamic_vars(ctx->global_vars);
     ctx->global_vars = NULL;
+    memset(ctx->global_vars_hash, 0, sizeof(ctx->global_vars_hash));
 
     while(!list_empty(&ctx->named_items)) {
         named_item_t *iter = LIST_ENTRY(list_head(&ctx->named_items), named_item_t, entry);
@@ -171,11 +171,14 @@ static inline VARIANT *get_arg(DISPPARAMS *dp, DWORD i)
 
 typedef struct _dynamic_var_t {
     struct _dynamic_var_t *next;
+    struct _dynamic_var_t *hash_next;
     VARIANT v;
     const WCHAR *name;
     BOOL is_const;
 } dynamic_var_t;
 
+#define GLOBAL_HASH_SIZE 64
+
 struct _script_ctx_t {
     IActiveScriptSite *site;
     LCID lcid;
@@ -195,6 +198,11 @@ struct _script_ctx_t {
     dynamic_var_t *global_vars;
     function_t *global_funcs;
     class_desc_t *classes;
+
+    /* Global variables and functions are also linked by hash_next in these
+     * buckets, indexed by a case-insensitive hash of their names */
+    dynamic_var_t *global_vars_hash[GLOBAL_HASH_SIZE];
+    function_t *global_funcs_hash[GLOBAL_HASH_SIZE];
     class_desc_t *procs;
 
     heap_pool_t heap;
@@ -223,6 +231,7 @@ typedef enum {
     X(add,            1, 0,           0)          \
     X(and,            1, 0,           0)          \
     X(assign_ident,   1, ARG_BSTR,    ARG_UINT)   \
+    X(assign_local,   1, ARG_INT,     ARG_UINT)   \
     X(assign_member,  1, ARG_BSTR,    ARG_UINT)   \
     X(bool,           1, ARG_INT,     0)          \
     X(catch,          1, ARG_ADDR,    ARG_UINT)    \
@@ -243,9 +252,11 @@ typedef enum {
     X(gteq,           1, 0,           0)          \
     X(icall,          1, ARG_BSTR,    ARG_UINT)   \
     X(icallv,         1, ARG_BSTR,    ARG_UINT)   \
+    X(icall_local,    1, ARG_INT,     ARG_UINT)   \
     X(idiv,           1, 0,           0)          \
     X(imp,            1, 0,           0)          \
     X(incc,           1, ARG_BSTR,    0)          \
+    X(incc_local,     1, ARG_INT,     0)          \
     X(int,            1, ARG_INT,     0)          \
     X(is,             1, 0,           0)          \
     X(jmp,            0, ARG_ADDR,    0)          \
@@ -270,8 +281,10 @@ typedef enum {
     X(ret,            0, 0,           0)          \
     X(retval,         1, 0,           0)          \
     X(set_ident,      1, ARG_BSTR,    ARG_UINT)   \
+    X(set_local,      1, ARG_INT,     ARG_UINT)   \
     X(set_member,     1, ARG_BSTR,    ARG_UINT)   \
     X(step,           0, ARG_ADDR,    ARG_BSTR)   \
+    X(step_local,     0, ARG_ADDR,    ARG_INT)    \
     X(stop,           1, 0,           0)          \
     X(string,         1, ARG_STR,     0)          \
     X(sub,            1, 0,           0)          \
@@ -331,6 +344,7 @@ struct _function_t {
     unsigned code_off;
     vbscode_t *code_ctx;
     function_t *next;
+    function_t *hash_next;
 };
 
 struct _vbscode_t {
@@ -356,6 +370,10 @@ HRESULT compile_script(script_ctx_t*,const WCHAR*,const WCHAR*,DWORD,vbscode_t**
 HRESULT compile_procedure(script_ctx_t*,const WCHAR*,const WCHAR*,DWORD,class_desc_t**) DECLSPEC_HIDDEN;
 HRESULT exec_script(script_ctx_t*,BOOL,function_t*,vbdisp_t*,DISPPARAMS*,VARIANT*) DECLSPEC_HIDDEN;
 void release_dynamic_vars(dynamic_var_t*) DECLSPEC_HIDDEN;
+void hash_global_var(script_ctx_t*,dynamic_var_t*) DECLSPEC_HIDDEN;
+void hash_global_func(script_ctx_t*,function_t*) DECLSPEC_HIDDEN;
+dynamic_var_t *lookup_global_var(script_ctx_t*,const WCHAR*) DECLSPEC_HIDDEN;
+function_t *lookup_global_func(script_ctx_t*,const WCHAR*) DECLSPEC_HIDDEN;
 IDispatch *lookup_named_item(script_ctx_t*,const WCHAR*,unsigned) DECLSPEC_HIDDEN;
 void clear_ei(EXCEPINFO*) DECLSPEC_HIDDEN;
 HRESULT report_script_error(script_ctx_t*) DECLSPEC_HIDDEN;
@@ -29,6 +29,7 @@
 #include "objbase.h"
 
 #include "wincodecs_private.h"
+#include "convrows.h"
 
 #include "wine/heap.h"
 #include "wine/debug.h"
@@ -81,1340 +82,536 @@ typedef struct FormatConverter {
     WICBitmapDitherType dither;
     double alpha_threshold;
     IWICPalette *palette;
-    CRITICAL_SECTION lock; /* must be held when initialized */
+    BYTE *scratch[2];
+    UINT scratch_size[2];
+    CRITICAL_SECTION lock; /* must be held when initialized or copying pixels */
 } FormatConverter;
 
-/* https://www.w3.org/Graphics/Color/srgb */
-static inline float to_sRGB_component(float f)
-{
-    if (f <= 0.0031308f) return 12.92f * f;
-    return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
-}
+enum scratch_buffer {
+    SCRATCH_SOURCE,       /* source pixels read by convert_rows */
+    SCRATCH_INTERMEDIATE, /* 24bppBGR rows converted to 8bpp formats */
+};
 
-#if 0 /* FIXME: enable once needed */
-static inline float from_sRGB_component(float f)
-{
-    if (f <= 0.04045f) return f / 12.92f;
-    return powf((f + 0.055f) / 1.055f, 2.4f);
-}
+/* Source pixels are read in strips of about this many bytes, which bounds
+ * the size of the scratch buffers */
+#define CONVERT_STRIP_SIZE (256 * 1024)
 
-static void from_sRGB(BYTE *bgr)
-{
-    float r, g, b;
+#define PALETTE_NONE -1
+#define PALETTE_SOURCE WICBitmapPaletteTypeCustom
 
-    r = bgr[2] / 255.0f;
-    g = bgr[1] / 255.0f;
-    b = bgr[0] / 255.0f;
+struct row_kernel {
+    enum pixelformat format;
+    UINT bpp;
+    convrow_func convert; /* NULL if the pixels are copied as they are */
+    int palette; /* PALETTE_NONE, PALETTE_SOURCE or a predefined palette type */
+};
 
-    r = from_sRGB_component(r);
-    g = from_sRGB_component(g);
-    b = from_sRGB_component(b);
+static const struct row_kernel kernels_to_32bppBGRA[] = {
+    {format_1bppIndexed, 1, convrow_1bpp_to_bgra, PALETTE_SOURCE},
+    {format_2bppIndexed, 2, convrow_2bpp_to_bgra, PALETTE_SOURCE},
+    {format_4bppIndexed, 4, convrow_4bpp_to_bgra, PALETTE_SOURCE},
+    {format_8bppIndexed, 8, convrow_8bpp_to_bgra, PALETTE_SOURCE},
+    {format_BlackWhite, 1, convrow_1bpp_to_bgra, WICBitmapPaletteTypeFixedBW},
+    {format_2bppGray, 2, convrow_2bpp_to_bgra, WICBitmapPaletteTypeFixedGray4},
+    {format_4bppGray, 4, convrow_4bpp_to_bgra, WICBitmapPaletteTypeFixedGray16},
+    {format_8bppGray, 8, convrow_gray8_to_bgra, PALETTE_NONE},
+    {format_16bppGray, 16, convrow_gray16_to_bgra, PALETTE_NONE},
+    {format_16bppBGR555, 16, convrow_bgr555_to_bgra, PALETTE_NONE},
+    {format_16bppBGR565, 16, convrow_bgr565_to_bgra, PALETTE_NONE},
+    {format_16bppBGRA5551, 16, convrow_bgra5551_to_bgra, PALETTE_NONE},
+    {format_24bppBGR, 24, convrow_bgr_to_bgra, PALETTE_NONE},
+    {format_24bppRGB, 24, convrow_rgb_to_bgra, PALETTE_NONE},
+    {format_32bppBGR, 32, convrow_set_alpha, PALETTE_NONE},
+    {format_32bppBGRA, 32, NULL, PALETTE_NONE},
+    {format_32bppPBGRA, 32, convrow_unpremultiply, PALETTE_NONE},
+    {format_48bppRGB, 48, convrow_rgb48_to_bgra, PALETTE_NONE},
+    {format_64bppRGBA, 64, convrow_rgba64_to_bgra, PALETTE_NONE},
+    {format_32bppCMYK, 32, convrow_cmyk_to_bgra, PALETTE_NONE},
+    {0}
+};
 
-    bgr[2] = (BYTE)(r * 255.0f);
-    bgr[1] = (BYTE)(g * 255.0f);
-    bgr[0] = (BYTE)(b * 255.0f);
-}
+/* Sources already in RGBA order, everything else goes through
+ * kernels_to_32bppBGRA and has red and blue swapped */
+static const struct row_kernel kernels_to_32bppRGBA[] = {
+    {format_32bppRGB, 32, convrow_set_alpha, PALETTE_NONE},
+    {format_32bppRGBA, 32, NULL, PALETTE_NONE},
+    {format_32bppPRGBA, 32, convrow_unpremultiply, PALETTE_NONE},
+    {0}
+};
 
-static void to_sRGB(BYTE *bgr)
-{
-    float r, g, b;
+static const struct row_kernel kernels_to_32bppBGR[] = {
+    {format_32bppBGR, 32, NULL, PALETTE_NONE},
+    {format_32bppBGRA, 32, NULL, PALETTE_NONE},
+    {format_32bppPBGRA, 32, NULL, PALETTE_NONE},
+    {0}
+};
 
-    r = bgr[2] / 255.0f;
-    g = bgr[1] / 255.0f;
-    b = bgr[0] / 255.0f;
+static const struct row_kernel kernels_to_32bppRGB[] = {
+    {format_32bppRGB, 32, NULL, PALETTE_NONE},
+    {format_32bppRGBA, 32, NULL, PALETTE_NONE},
+    {format_32bppPRGBA, 32, NULL, PALETTE_NONE},
+    {0}
+};
+
+static const struct row_kernel kernels_to_24bppBGR[] = {
+    {format_24bppBGR, 24, NULL, PALETTE_NONE},
+    {format_24bppRGB, 24, convrow_swap_rb24, PALETTE_NONE},
+    {format_32bppBGR, 32, convrow_bgra_to_bgr, PALETTE_NONE},
+    {format_32bppBGRA, 32, convrow_bgra_to_bgr, PALETTE_NONE},
+    {format_32bppPBGRA, 32, convrow_bgra_to_bgr, PALETTE_NONE},
+    {format_32bppGrayFloat, 32, convrow_grayfloat_to_bgr, PALETTE_NONE},
+    {format_32bppCMYK, 32, convrow_cmyk_to_bgr, PALETTE_NONE},
+    {0}
+};
 
-    r = to_sRGB_component(r);
-    g = to_sRGB_component(g);
-    b = to_sRGB_component(b);
+static const struct row_kernel kernels_to_24bppRGB[] = {
+    {format_24bppBGR, 24, convrow_swap_rb24, PALETTE_NONE},
+    {format_24bppRGB, 24, NULL, PALETTE_NONE},
+    {format_32bppBGR, 32, convrow_bgra_to_rgb, PALETTE_NONE},
+    {format_32bppBGRA, 32, convrow_bgra_to_rgb, PALETTE_NONE},
+    {format_32bppPBGRA, 32, convrow_bgra_to_rgb, PALETTE_NONE},
+    {0}
+};
 
-    bgr[2] = (BYTE)(r * 255.0f);
-    bgr[1] = (BYTE)(g * 255.0f);
-    bgr[0] = (BYTE)(b * 255.0f);
-}
-#endif
+static const struct row_kernel grayfloat_to_8bppGray =
+    {format_32bppGrayFloat, 32, convrow_grayfloat_to_gray8, PALETTE_NONE};
 
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
-static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
-    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+static const struct row_kernel *find_kernel(const struct row_kernel *table, enum pixelformat format)
 {
-    switch (source_format)
-    {
-    case format_1bppIndexed:
-    case format_BlackWhite:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[2];
-            IWICPalette *palette;
-            UINT actualcolors;
-
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
-
-            if (source_format == format_1bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedBW, FALSE);
-
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 2, colors, &actualcolors);
-
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
-
-            srcstride = (prc->Width+7)/8;
-            srcdatasize = srcstride * prc->Height;
+    for (; table->bpp; table++)
+        if (table->format == format) return table;
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=8) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>7&1];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>6&1];
-                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>5&1];
-                        if (x+3 < prc->Width) *dstpixel++ = colors[srcval>>4&1];
-                        if (x+4 < prc->Width) *dstpixel++ = colors[srcval>>3&1];
-                        if (x+5 < prc->Width) *dstpixel++ = colors[srcval>>2&1];
-                        if (x+6 < prc->Width) *dstpixel++ = colors[srcval>>1&1];
-                        if (x+7 < prc->Width) *dstpixel++ = colors[srcval&1];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    return NULL;
+}
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+/* The scratch buffers are kept until the converter is released, so callers
+ * reading one scanline at a time don't allocate on every call */
+static BYTE *get_scratch(FormatConverter *This, UINT index, UINT size)
+{
+    if (!This->scratch[index] || size > This->scratch_size[index])
+    {
+        heap_free(This->scratch[index]);
+        This->scratch[index] = heap_alloc(max(size, 1));
+        This->scratch_size[index] = This->scratch[index] ? size : 0;
+    }
 
-            return res;
-        }
-        return S_OK;
-    case format_2bppIndexed:
-    case format_2bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[4];
-            IWICPalette *palette;
-            UINT actualcolors;
-
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
-
-            if (source_format == format_2bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray4, FALSE);
-
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 4, colors, &actualcolors);
+    return This->scratch[index];
+}
 
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
+static UINT get_strip_rows(UINT stride, UINT height)
+{
+    UINT rows = stride ? CONVERT_STRIP_SIZE / stride : height;
 
-            srcstride = (prc->Width+3)/4;
-            srcdatasize = srcstride * prc->Height;
+    return max(1, min(rows, height));
+}
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+static HRESULT get_kernel_palette(FormatConverter *This, const struct row_kernel *kernel,
+    WICColor *colors)
+{
+    IWICPalette *palette;
+    UINT actualcolors;
+    HRESULT hr;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+    if (kernel->palette == PALETTE_NONE) return S_OK;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=4) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>6];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval>>4&0x3];
-                        if (x+2 < prc->Width) *dstpixel++ = colors[srcval>>2&0x3];
-                        if (x+3 < prc->Width) *dstpixel++ = colors[srcval&0x3];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    /* Entries missing from a short palette read as transparent black */
+    memset(colors, 0, sizeof(WICColor) << kernel->bpp);
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    hr = PaletteImpl_Create(&palette);
+    if (FAILED(hr)) return hr;
 
-            return res;
-        }
-        return S_OK;
-    case format_4bppIndexed:
-    case format_4bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[16];
-            IWICPalette *palette;
-            UINT actualcolors;
-
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
-
-            if (source_format == format_4bppIndexed)
-                res = IWICBitmapSource_CopyPalette(This->source, palette);
-            else
-                res = IWICPalette_InitializePredefined(palette, WICBitmapPaletteTypeFixedGray16, FALSE);
-
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 16, colors, &actualcolors);
+    if (kernel->palette == PALETTE_SOURCE)
+        hr = IWICBitmapSource_CopyPalette(This->source, palette);
+    else
+        hr = IWICPalette_InitializePredefined(palette, kernel->palette, FALSE);
 
-            IWICPalette_Release(palette);
-            if (FAILED(res)) return res;
+    if (SUCCEEDED(hr))
+        hr = IWICPalette_GetColors(palette, 1 << kernel->bpp, colors, &actualcolors);
 
-            srcstride = (prc->Width+1)/2;
-            srcdatasize = srcstride * prc->Height;
+    IWICPalette_Release(palette);
+    return hr;
+}
 
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+/* Reads the source pixels and converts them row by row with kernel, then
+ * with post if it's set. post works in place on dst_bpp pixels. */
+static HRESULT convert_rows(FormatConverter *This, const WICRect *prc, UINT cbStride,
+    UINT cbBufferSize, BYTE *pbBuffer, const struct row_kernel *kernel, UINT dst_bpp,
+    convrow_func post)
+{
+    WICColor colors[256];
+    UINT srcstride, rows;
+    BYTE *srcdata;
+    WICRect rc;
+    HRESULT hr;
+    INT y, i;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+    hr = get_kernel_palette(This, kernel, colors);
+    if (FAILED(hr)) return hr;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x+=2) {
-                        BYTE srcval;
-                        srcval=*srcbyte++;
-                        *dstpixel++ = colors[srcval>>4];
-                        if (x+1 < prc->Width) *dstpixel++ = colors[srcval&0xf];
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    if (post && kernel->palette != PALETTE_NONE)
+    {
+        /* post only depends on the pixel value, so it can be applied to
+         * the palette instead of every pixel */
+        post((const BYTE *)colors, (BYTE *)colors, 1 << kernel->bpp, NULL);
+        post = NULL;
+    }
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    if (kernel->bpp == dst_bpp)
+    {
+        /* Same pixel size, convert in the caller's buffer */
+        hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+        if (FAILED(hr)) return hr;
 
-            return res;
-        }
-        return S_OK;
-    case format_8bppGray:
-        if (prc)
+        if (kernel->convert || post)
         {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
+            for (y = 0; y < prc->Height; y++)
             {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_8bppIndexed:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-            WICColor colors[256];
-            IWICPalette *palette;
-            UINT actualcolors;
-
-            res = PaletteImpl_Create(&palette);
-            if (FAILED(res)) return res;
-
-            res = IWICBitmapSource_CopyPalette(This->source, palette);
-            if (SUCCEEDED(res))
-                res = IWICPalette_GetColors(palette, 256, colors, &actualcolors);
-
-            IWICPalette_Release(palette);
+                BYTE *row = pbBuffer + cbStride * y;
 
-            if (FAILED(res)) return res;
-
-            srcstride = prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                        *dstpixel++ = colors[*srcbyte++];
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
+                if (kernel->convert) kernel->convert(row, row, prc->Width, colors);
+                if (post) post(row, row, prc->Width, NULL);
             }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
         }
         return S_OK;
-    case format_16bppGray:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcbyte;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = prc->Width * 2;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcbyte = srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++)
-                    {
-                        srcbyte++;
-                        *dstpixel++ = 0xff000000|(*srcbyte<<16)|(*srcbyte<<8)|*srcbyte;
-                        srcbyte++;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    }
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    if (prc->Width < 0 || prc->Height < 0) return E_INVALIDARG;
 
-            return res;
-        }
-        return S_OK;
-    case format_16bppBGR555:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const WORD *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
+    srcstride = (prc->Width * kernel->bpp + 7) / 8;
+    rows = get_strip_rows(srcstride, prc->Height);
 
-            srcstride = 2 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
+    srcdata = get_scratch(This, SCRATCH_SOURCE, srcstride * rows);
+    if (!srcdata) return E_OUTOFMEMORY;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+    rc.X = prc->X;
+    rc.Width = prc->Width;
+    y = 0;
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
+    do
+    {
+        rc.Y = prc->Y + y;
+        rc.Height = min(rows, (UINT)(prc->Height - y));
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, srcstride, srcstride * rc.Height, srcdata);
+        if (FAILED(hr)) return hr;
 
-            return res;
-        }
-        return S_OK;
-    case format_16bppBGR565:
-        if (prc)
+        for (i = 0; i < rc.Height; i++)
         {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const WORD *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 2 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=0xff000000 | /* constant 255 alpha */
-                                    ((srcval << 8) & 0xf80000) | /* r */
-                                    ((srcval << 3) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 5) & 0x00fc00) | /* g */
-                                    ((srcval >> 1) & 0x000300) | /* g - 2 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
+            BYTE *row = pbBuffer + cbStride * (y + i);
 
-            return res;
+            kernel->convert(srcdata + srcstride * i, row, prc->Width, colors);
+            if (post) post(row, row, prc->Width, NULL);
         }
-        return S_OK;
-    case format_16bppBGRA5551:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const WORD *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 2 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
 
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
+        y += rc.Height;
+    } while (y < prc->Height);
 
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=(const WORD*)srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        WORD srcval;
-                        srcval=*srcpixel++;
-                        *dstpixel++=((srcval & 0x8000) ? 0xff000000 : 0) | /* alpha */
-                                    ((srcval << 9) & 0xf80000) | /* r */
-                                    ((srcval << 4) & 0x070000) | /* r - 3 bits */
-                                    ((srcval << 6) & 0x00f800) | /* g */
-                                    ((srcval << 1) & 0x000700) | /* g - 3 bits */
-                                    ((srcval << 3) & 0x0000f8) | /* b */
-                                    ((srcval >> 2) & 0x000007);  /* b - 3 bits */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
+    return S_OK;
+}
 
-            return res;
-        }
-        return S_OK;
+/* Formats that are always opaque once converted, premultiplying them
+ * changes nothing */
+static BOOL is_opaque_format(enum pixelformat format)
+{
+    switch (format)
+    {
+    case format_8bppGray:
+    case format_16bppGray:
+    case format_16bppBGR555:
+    case format_16bppBGR565:
     case format_24bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_24bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
-
-            srcstride = 3 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_32bppBGR:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
-        }
-        return S_OK;
-    case format_32bppBGRA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
-        }
-        return S_OK;
+    case format_32bppRGB:
     case format_48bppRGB:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 6 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        *dstpixel++=0xff000000|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    case format_64bppRGBA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            DWORD *dstpixel;
-
-            srcstride = 8 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=(DWORD*)dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        BYTE red, green, blue, alpha;
-                        srcpixel++; red = *srcpixel++;
-                        srcpixel++; green = *srcpixel++;
-                        srcpixel++; blue = *srcpixel++;
-                        srcpixel++; alpha = *srcpixel++;
-                        *dstpixel++=alpha<<24|red<<16|green<<8|blue;
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
     case format_32bppCMYK:
-        if (prc)
-        {
-            HRESULT res;
-            UINT x, y;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(res)) return res;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE *pixel = pbBuffer+cbStride*y+4*x;
-                    BYTE c=pixel[0], m=pixel[1], y=pixel[2], k=pixel[3];
-                    pixel[0] = (255-y)*(255-k)/255; /* blue */
-                    pixel[1] = (255-m)*(255-k)/255; /* green */
-                    pixel[2] = (255-c)*(255-k)/255; /* red */
-                    pixel[3] = 255; /* alpha */
-                }
-        }
-        return S_OK;
+        return TRUE;
     default:
-        return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+        return FALSE;
     }
 }
 
-static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRect *prc,
+static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
-
-    switch (source_format)
-    {
-    case format_32bppRGB:
-        if (prc)
-        {
-            INT x, y;
+    const struct row_kernel *kernel = find_kernel(kernels_to_32bppBGRA, source_format);
 
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(hr)) return hr;
+    if (!kernel) return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    if (!prc) return S_OK;
 
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
-        }
-        return S_OK;
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, NULL);
+}
 
-    case format_32bppRGBA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
+static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+{
+    const struct row_kernel *kernel;
+    convrow_func post = NULL;
 
-    case format_32bppPRGBA:
-        if (prc)
-        {
-            INT x, y;
+    if (!(kernel = find_kernel(kernels_to_32bppRGBA, source_format)))
+    {
+        kernel = find_kernel(kernels_to_32bppBGRA, source_format);
+        post = convrow_swap_rb32;
+    }
 
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (FAILED(hr)) return hr;
+    if (!kernel) return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    if (!prc) return S_OK;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
-        }
-        return S_OK;
-
-    default:
-        hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-              reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
-        return hr;
-    }
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, post);
 }
 
 static HRESULT copypixels_to_32bppBGR(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    switch (source_format)
-    {
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
-    default:
+    const struct row_kernel *kernel = find_kernel(kernels_to_32bppBGR, source_format);
+
+    if (!kernel)
         return copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-    }
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, NULL);
 }
 
 static HRESULT copypixels_to_32bppRGB(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    switch (source_format)
-    {
-    case format_32bppRGB:
-    case format_32bppRGBA:
-    case format_32bppPRGBA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
-    default:
+    const struct row_kernel *kernel = find_kernel(kernels_to_32bppRGB, source_format);
+
+    if (!kernel)
         return copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-    }
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, NULL);
 }
 
 static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    static const struct row_kernel copy = {format_32bppPBGRA, 32, NULL, PALETTE_NONE};
+    const struct row_kernel *kernel;
+    convrow_func post = NULL;
 
-    switch (source_format)
+    if (source_format == format_32bppPBGRA)
+        kernel = &copy;
+    else
     {
-    case format_32bppPBGRA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
-    default:
-        hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
-        return hr;
+        kernel = find_kernel(kernels_to_32bppBGRA, source_format);
+        if (!is_opaque_format(source_format))
+            post = convrow_premultiply;
     }
+
+    if (!kernel) return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, post);
 }
 
 static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    static const struct row_kernel copy = {format_32bppPRGBA, 32, NULL, PALETTE_NONE};
+    const struct row_kernel *kernel;
+    convrow_func post;
 
-    switch (source_format)
+    if (source_format == format_32bppPRGBA)
     {
-    case format_32bppPRGBA:
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-        return S_OK;
-    default:
-        hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
-        }
-        return hr;
+        kernel = &copy;
+        post = NULL;
+    }
+    else if ((kernel = find_kernel(kernels_to_32bppRGBA, source_format)))
+        post = is_opaque_format(source_format) ? NULL : convrow_premultiply;
+    else
+    {
+        kernel = find_kernel(kernels_to_32bppBGRA, source_format);
+        post = is_opaque_format(source_format) ? convrow_swap_rb32 : convrow_premultiply_swap_rb;
     }
+
+    if (!kernel) return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, post);
 }
 
 static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    const struct row_kernel *kernel = find_kernel(kernels_to_24bppBGR, source_format);
 
-    switch (source_format)
+    if (!kernel)
     {
-    case format_24bppBGR:
-    case format_24bppRGB:
-        if (prc)
-        {
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (SUCCEEDED(hr) && source_format == format_24bppRGB)
-              reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            return hr;
-        }
-        return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-
-    case format_32bppGrayFloat:
-        if (prc)
-        {
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(hr))
-            {
-                INT x, y;
-                BYTE *src = srcdata, *dst = pbBuffer;
-
-                for (y = 0; y < prc->Height; y++)
-                {
-                    float *gray_float = (float *)src;
-                    BYTE *bgr = dst;
-
-                    for (x = 0; x < prc->Width; x++)
-                    {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
-                        *bgr++ = gray;
-                        *bgr++ = gray;
-                        *bgr++ = gray;
-                    }
-                    src += srcstride;
-                    dst += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return hr;
-        }
-        return S_OK;
-
-    case format_32bppCMYK:
-        if (prc)
-        {
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = heap_alloc(srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-            if (SUCCEEDED(hr))
-            {
-                INT x, y;
-                BYTE *src = srcdata, *dst = pbBuffer;
-
-                for (y = 0; y < prc->Height; y++)
-                {
-                    BYTE *cmyk = src;
-                    BYTE *bgr = dst;
-
-                    for (x = 0; x < prc->Width; x++)
-                    {
-                        BYTE c = cmyk[0], m = cmyk[1], y = cmyk[2], k = cmyk[3];
-                        bgr[0] = (255 - y) * (255 - k) / 255; /* B */
-                        bgr[1] = (255 - m) * (255 - k) / 255; /* G */
-                        bgr[2] = (255 - c) * (255 - k) / 255; /* R */
-                        cmyk += 4;
-                        bgr += 3;
-                    }
-                    src += srcstride;
-                    dst += cbStride;
-                }
-            }
-
-            heap_free(srcdata);
-            return hr;
-        }
-        return S_OK;
-
-    default:
         FIXME("Unimplemented conversion path!\n");
         return WINCODEC_ERR_UNSUPPORTEDOPERATION;
     }
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 24, NULL);
 }
 
 static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    const struct row_kernel *kernel = find_kernel(kernels_to_24bppRGB, source_format);
 
-    switch (source_format)
+    if (!kernel)
     {
-    case format_24bppBGR:
-    case format_24bppRGB:
-        if (prc)
-        {
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            if (SUCCEEDED(hr) && source_format == format_24bppBGR)
-              reverse_bgr8(3, pbBuffer, prc->Width, prc->Height, cbStride);
-            return hr;
-        }
-        return S_OK;
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-        if (prc)
-        {
-            HRESULT res;
-            INT x, y;
-            BYTE *srcdata;
-            UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
-            BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
-
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            res = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-
-            if (SUCCEEDED(res))
-            {
-                srcrow = srcdata;
-                dstrow = pbBuffer;
-                for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
-                    srcrow += srcstride;
-                    dstrow += cbStride;
-                }
-            }
-
-            HeapFree(GetProcessHeap(), 0, srcdata);
-
-            return res;
-        }
-        return S_OK;
-    default:
         FIXME("Unimplemented conversion path!\n");
         return WINCODEC_ERR_UNSUPPORTEDOPERATION;
     }
+    if (!prc) return S_OK;
+
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 24, NULL);
 }
 
 static HRESULT copypixels_to_32bppGrayFloat(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    HRESULT hr;
+    static const struct row_kernel copy = {format_32bppGrayFloat, 32, NULL, PALETTE_NONE};
+    const struct row_kernel *kernel;
+    convrow_func post = convrow_bgra_to_grayfloat;
 
-    switch (source_format)
+    if (source_format == format_32bppGrayFloat)
     {
-    case format_32bppBGR:
-    case format_32bppBGRA:
-    case format_32bppPBGRA:
-    case format_32bppGrayFloat:
-        if (prc)
-        {
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
-            break;
-        }
-        return S_OK;
-
-    default:
-        hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
-        break;
+        kernel = &copy;
+        post = NULL;
     }
+    else if (!(kernel = find_kernel(kernels_to_32bppBGR, source_format)))
+        kernel = find_kernel(kernels_to_32bppBGRA, source_format);
 
-    if (SUCCEEDED(hr) && prc && source_format != format_32bppGrayFloat)
-    {
-        INT x, y;
-        BYTE *p = pbBuffer;
+    if (!kernel) return WINCODEC_ERR_UNSUPPORTEDOPERATION;
+    if (!prc) return S_OK;
 
-        for (y = 0; y < prc->Height; y++)
-        {
-            BYTE *bgr = p;
-            for (x = 0; x < prc->Width; x++)
-            {
-                float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
-                *(float *)bgr = gray;
-                bgr += 4;
-            }
-            p += cbStride;
-        }
-    }
-    return hr;
+    return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, kernel, 32, post);
 }
 
-static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRect *prc,
-    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
+static UINT rgb_to_palette_index(const BYTE *bgr, const WICColor *colors, UINT count)
 {
-    HRESULT hr;
-    BYTE *srcdata;
-    UINT srcstride, srcdatasize;
-
-    if (source_format == format_8bppGray)
-    {
-        if (prc)
-            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
+    UINT best_diff, best_index, i;
 
-        return S_OK;
-    }
+    best_diff = ~0;
+    best_index = 0;
 
-    if (source_format == format_32bppGrayFloat)
+    for (i = 0; i < count; i++)
     {
-        hr = S_OK;
-
-        if (prc)
-        {
-            srcstride = 4 * prc->Width;
-            srcdatasize = srcstride * prc->Height;
-
-            srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-            if (!srcdata) return E_OUTOFMEMORY;
-
-            hr = IWICBitmapSource_CopyPixels(This->source, prc, srcstride, srcdatasize, srcdata);
-            if (SUCCEEDED(hr))
-            {
-                INT x, y;
-                BYTE *src = srcdata, *dst = pbBuffer;
+        BYTE pal_r, pal_g, pal_b;
+        UINT diff_r, diff_g, diff_b, diff;
 
-                for (y=0; y < prc->Height; y++)
-                {
-                    float *srcpixel = (float*)src;
-                    BYTE *dstpixel = dst;
+        pal_r = colors[i] >> 16;
+        pal_g = colors[i] >> 8;
+        pal_b = colors[i];
 
-                    for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+        diff_r = bgr[2] - pal_r;
+        diff_g = bgr[1] - pal_g;
+        diff_b = bgr[0] - pal_b;
 
-                    src += srcstride;
-                    dst += cbStride;
-                }
-            }
+        diff = diff_r * diff_r + diff_g * diff_g + diff_b * diff_b;
+        if (diff == 0) return i;
 
-            HeapFree(GetProcessHeap(), 0, srcdata);
+        if (diff < best_diff)
+        {
+            best_diff = diff;
+            best_index = i;
         }
-
-        return hr;
     }
 
-    if (!prc)
-        return copypixels_to_24bppBGR(This, NULL, cbStride, cbBufferSize, pbBuffer, source_format);
+    return best_index;
+}
+
+/* Converts to 24bppBGR in strips, then each row to 8bpp with convert, or
+ * to the closest entry of colors if convert is NULL */
+static HRESULT copypixels_via_24bppBGR(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, BYTE *pbBuffer, enum pixelformat source_format, convrow_func convert,
+    const WICColor *colors, UINT count)
+{
+    UINT srcstride, rows;
+    BYTE *srcdata;
+    WICRect rc;
+    HRESULT hr;
+    INT x, y, i;
+
+    if (prc->Width < 0 || prc->Height < 0) return E_INVALIDARG;
 
     srcstride = 3 * prc->Width;
-    srcdatasize = srcstride * prc->Height;
+    rows = get_strip_rows(srcstride, prc->Height);
 
-    srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
+    srcdata = get_scratch(This, SCRATCH_INTERMEDIATE, srcstride * rows);
     if (!srcdata) return E_OUTOFMEMORY;
 
-    hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
-    if (SUCCEEDED(hr))
+    rc.X = prc->X;
+    rc.Width = prc->Width;
+    y = 0;
+
+    do
     {
-        INT x, y;
-        BYTE *src = srcdata, *dst = pbBuffer;
+        rc.Y = prc->Y + y;
+        rc.Height = min(rows, (UINT)(prc->Height - y));
 
-        for (y = 0; y < prc->Height; y++)
+        hr = copypixels_to_24bppBGR(This, &rc, srcstride, srcstride * rc.Height, srcdata, source_format);
+        if (FAILED(hr)) return hr;
+
+        for (i = 0; i < rc.Height; i++)
         {
-            BYTE *bgr = src;
+            const BYTE *bgr = srcdata + srcstride * i;
+            BYTE *dst = pbBuffer + cbStride * (y + i);
 
-            for (x = 0; x < prc->Width; x++)
+            if (convert)
             {
-                float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
+                convert(bgr, dst, prc->Width, NULL);
+                continue;
+            }
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
-                bgr += 3;
+            /* Runs of the same color are common, don't search the palette again */
+            for (x = 0; x < prc->Width; x++, bgr += 3)
+            {
+                if (x && bgr[0] == bgr[-3] && bgr[1] == bgr[-2] && bgr[2] == bgr[-1])
+                    dst[x] = dst[x - 1];
+                else
+                    dst[x] = rgb_to_palette_index(bgr, colors, count);
             }
-            src += srcstride;
-            dst += cbStride;
         }
-    }
 
-    HeapFree(GetProcessHeap(), 0, srcdata);
-    return hr;
+        y += rc.Height;
+    } while (y < prc->Height);
+
+    return S_OK;
 }
 
-static UINT rgb_to_palette_index(BYTE bgr[3], WICColor *colors, UINT count)
+static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRect *prc,
+    UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
-    UINT best_diff, best_index, i;
-
-    best_diff = ~0;
-    best_index = 0;
-
-    for (i = 0; i < count; i++)
+    if (source_format == format_8bppGray)
     {
-        BYTE pal_r, pal_g, pal_b;
-        UINT diff_r, diff_g, diff_b, diff;
-
-        pal_r = colors[i] >> 16;
-        pal_g = colors[i] >> 8;
-        pal_b = colors[i];
+        if (prc)
+            return IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
 
-        diff_r = bgr[2] - pal_r;
-        diff_g = bgr[1] - pal_g;
-        diff_b = bgr[0] - pal_b;
+        return S_OK;
+    }
 
-        diff = diff_r * diff_r + diff_g * diff_g + diff_b * diff_b;
-        if (diff == 0) return i;
+    if (source_format == format_32bppGrayFloat)
+    {
+        if (prc)
+            return convert_rows(This, prc, cbStride, cbBufferSize, pbBuffer, &grayfloat_to_8bppGray, 8, NULL);
 
-        if (diff < best_diff)
-        {
-            best_diff = diff;
-            best_index = i;
-        }
+        return S_OK;
     }
 
-    return best_index;
+    if (!prc)
+        return copypixels_to_24bppBGR(This, NULL, cbStride, cbBufferSize, pbBuffer, source_format);
+
+    return copypixels_via_24bppBGR(This, prc, cbStride, pbBuffer, source_format,
+        convrow_bgr_to_gray8, NULL, 0);
 }
 
 static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
     HRESULT hr;
-    BYTE *srcdata;
     WICColor colors[256];
-    UINT srcstride, srcdatasize, count;
+    UINT count;
 
     if (source_format == format_8bppIndexed)
     {
@@ -1432,34 +629,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     hr = IWICPalette_GetColors(This->palette, 256, colors, &count);
     if (hr != S_OK) return hr;
 
-    srcstride = 3 * prc->Width;
-    srcdatasize = srcstride * prc->Height;
-
-    srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-    if (!srcdata) return E_OUTOFMEMORY;
-
-    hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
-    if (SUCCEEDED(hr))
-    {
-        INT x, y;
-        BYTE *src = srcdata, *dst = pbBuffer;
-
-        for (y = 0; y < prc->Height; y++)
-        {
-            BYTE *bgr = src;
-
-            for (x = 0; x < prc->Width; x++)
-            {
-                dst[x] = rgb_to_palette_index(bgr, colors, count);
-                bgr += 3;
-            }
-            src += srcstride;
-            dst += cbStride;
-        }
-    }
-
-    HeapFree(GetProcessHeap(), 0, srcdata);
-    return hr;
+    return copypixels_via_24bppBGR(This, prc, cbStride, pbBuffer, source_format, NULL, colors, count);
 }
 
 static const struct pixelformatinfo supported_formats[] = {
@@ -1547,6 +717,8 @@ static ULONG WINAPI FormatConverter_Release(IWICFormatConverter *iface)
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
         if (This->palette) IWICPalette_Release(This->palette);
+        heap_free(This->scratch[SCRATCH_SOURCE]);
+        heap_free(This->scratch[SCRATCH_INTERMEDIATE]);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -1640,8 +812,13 @@ static HRESULT WINAPI FormatConverter_CopyPixels(IWICFormatConverter *iface,
             prc = &rc;
         }
 
-        return This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
+        /* The scratch buffers are shared by all calls */
+        EnterCriticalSection(&This->lock);
+        hr = This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
             pbBuffer, This->src_format->format);
+        LeaveCriticalSection(&This->lock);
+
+        return hr;
     }
     else
         return WINCODEC_ERR_WRONGSTATE;
@@ -1816,6 +993,8 @@ HRESULT FormatConverter_CreateInstance(REFIID iid, void** ppv)
     This->ref = 1;
     This->source = NULL;
     This->palette = NULL;
+    This->scratch[SCRATCH_SOURCE] = This->scratch[SCRATCH_INTERMEDIATE] = NULL;
+    This->scratch_size[SCRATCH_SOURCE] = This->scratch_size[SCRATCH_INTERMEDIATE] = 0;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": FormatConverter.lock");
 
@@ -0,0 +1,547 @@
+/*
+ * Pixel format conversion row kernels
+ *
+ * Copyright 2009 Vincent Povirk
+ * Copyright 2016 Dmitry Timoshkov
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "convrows.h"
+
+/* The kernels work on whole pixels in 32-bit words where they can, which
+ * doesn't rely on the compiler vectorizing the loops. Pixels are stored
+ * little-endian, a 32bpp BGRA pixel reads as 0xAARRGGBB. */
+
+/* ceil(255 * 2^16 / a), (c * recip) >> 16 is c * 255 / a rounded down for
+ * any byte c. The entries for 0 and 255 leave the color unchanged. */
+static const unsigned int unpremultiply_recip[256] = {
+    0x010000, 0xff0000, 0x7f8000, 0x550000, 0x3fc000, 0x330000, 0x2a8000, 0x246db7,
+    0x1fe000, 0x1c5556, 0x198000, 0x172e8c, 0x154000, 0x139d8a, 0x1236dc, 0x110000,
+    0x0ff000, 0x0f0000, 0x0e2aab, 0x0d6bcb, 0x0cc000, 0x0c2493, 0x0b9746, 0x0b1643,
+    0x0aa000, 0x0a3334, 0x09cec5, 0x0971c8, 0x091b6e, 0x08cb09, 0x088000, 0x0839cf,
+    0x07f800, 0x07ba2f, 0x078000, 0x074925, 0x071556, 0x06e454, 0x06b5e6, 0x0689d9,
+    0x066000, 0x063832, 0x06124a, 0x05ee24, 0x05cba3, 0x05aaab, 0x058b22, 0x056cf0,
+    0x055000, 0x05343f, 0x05199a, 0x050000, 0x04e763, 0x04cfb3, 0x04b8e4, 0x04a2e9,
+    0x048db7, 0x047944, 0x046585, 0x045271, 0x044000, 0x042e2a, 0x041ce8, 0x040c31,
+    0x03fc00, 0x03ec4f, 0x03dd18, 0x03ce55, 0x03c000, 0x03b217, 0x03a493, 0x039770,
+    0x038aab, 0x037e40, 0x03722a, 0x036667, 0x035af3, 0x034fcb, 0x0344ed, 0x033a55,
+    0x033000, 0x0325ee, 0x031c19, 0x031282, 0x030925, 0x030000, 0x02f712, 0x02ee59,
+    0x02e5d2, 0x02dd7c, 0x02d556, 0x02cd5d, 0x02c591, 0x02bdf0, 0x02b678, 0x02af29,
+    0x02a800, 0x02a0fe, 0x029a20, 0x029365, 0x028ccd, 0x028657, 0x028000, 0x0279ca,
+    0x0273b2, 0x026db7, 0x0267da, 0x026218, 0x025c72, 0x0256e7, 0x025175, 0x024c1c,
+    0x0246dc, 0x0241b3, 0x023ca2, 0x0237a7, 0x0232c3, 0x022df3, 0x022939, 0x022493,
+    0x022000, 0x021b82, 0x021715, 0x0212bc, 0x020e74, 0x020a3e, 0x020619, 0x020205,
+    0x01fe00, 0x01fa0c, 0x01f628, 0x01f253, 0x01ee8c, 0x01ead4, 0x01e72b, 0x01e38f,
+    0x01e000, 0x01dc80, 0x01d90c, 0x01d5a4, 0x01d24a, 0x01cefb, 0x01cbb8, 0x01c881,
+    0x01c556, 0x01c235, 0x01bf20, 0x01bc15, 0x01b915, 0x01b61f, 0x01b334, 0x01b052,
+    0x01ad7a, 0x01aaab, 0x01a7e6, 0x01a52a, 0x01a277, 0x019fcc, 0x019d2b, 0x019a91,
+    0x019800, 0x019578, 0x0192f7, 0x01907e, 0x018e0d, 0x018ba3, 0x018941, 0x0186e6,
+    0x018493, 0x018246, 0x018000, 0x017dc2, 0x017b89, 0x017958, 0x01772d, 0x017508,
+    0x0172e9, 0x0170d1, 0x016ebe, 0x016cb2, 0x016aab, 0x0168aa, 0x0166af, 0x0164b9,
+    0x0162c9, 0x0160de, 0x015ef8, 0x015d18, 0x015b3c, 0x015966, 0x015795, 0x0155c8,
+    0x015400, 0x01523e, 0x01507f, 0x014ec5, 0x014d10, 0x014b5f, 0x0149b3, 0x01480b,
+    0x014667, 0x0144c7, 0x01432c, 0x014194, 0x014000, 0x013e71, 0x013ce5, 0x013b5d,
+    0x0139d9, 0x013859, 0x0136dc, 0x013563, 0x0133ed, 0x01327b, 0x01310c, 0x012fa1,
+    0x012e39, 0x012cd5, 0x012b74, 0x012a16, 0x0128bb, 0x012763, 0x01260e, 0x0124bd,
+    0x01236e, 0x012223, 0x0120da, 0x011f94, 0x011e51, 0x011d11, 0x011bd4, 0x011a99,
+    0x011962, 0x01182c, 0x0116fa, 0x0115ca, 0x01149d, 0x011372, 0x01124a, 0x011124,
+    0x011000, 0x010ee0, 0x010dc1, 0x010ca5, 0x010b8b, 0x010a73, 0x01095e, 0x01084b,
+    0x01073a, 0x01062c, 0x01051f, 0x010415, 0x01030d, 0x010207, 0x010103, 0x010000,
+};
+
+/* https://www.w3.org/Graphics/Color/srgb */
+static inline float to_sRGB_component(float f)
+{
+    if (f <= 0.0031308f) return 12.92f * f;
+    return 1.055f * powf(f, 1.0f/2.4f) - 0.055f;
+}
+
+#if 0 /* FIXME: enable once needed */
+static inline float from_sRGB_component(float f)
+{
+    if (f <= 0.04045f) return f / 12.92f;
+    return powf((f + 0.055f) / 1.055f, 2.4f);
+}
+
+static void from_sRGB(unsigned char *bgr)
+{
+    float r, g, b;
+
+    r = bgr[2] / 255.0f;
+    g = bgr[1] / 255.0f;
+    b = bgr[0] / 255.0f;
+
+    r = from_sRGB_component(r);
+    g = from_sRGB_component(g);
+    b = from_sRGB_component(b);
+
+    bgr[2] = (unsigned char)(r * 255.0f);
+    bgr[1] = (unsigned char)(g * 255.0f);
+    bgr[0] = (unsigned char)(b * 255.0f);
+}
+
+static void to_sRGB(unsigned char *bgr)
+{
+    float r, g, b;
+
+    r = bgr[2] / 255.0f;
+    g = bgr[1] / 255.0f;
+    b = bgr[0] / 255.0f;
+
+    r = to_sRGB_component(r);
+    g = to_sRGB_component(g);
+    b = to_sRGB_component(b);
+
+    bgr[2] = (unsigned char)(r * 255.0f);
+    bgr[1] = (unsigned char)(g * 255.0f);
+    bgr[0] = (unsigned char)(b * 255.0f);
+}
+#endif
+
+static inline unsigned int load32(const unsigned char *p)
+{
+    unsigned int value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline void store32(unsigned char *p, unsigned int value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+static inline unsigned int load16(const unsigned char *p)
+{
+    unsigned short value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* Multiplies the colors by the alpha and divides by 255, rounding down.
+ * Red and blue are done together in 16-bit lanes, opaque pixels are
+ * unchanged since c * 255 / 255 == c. */
+static inline unsigned int premultiply(unsigned int pixel)
+{
+    unsigned int a = pixel >> 24;
+    unsigned int rb = (pixel & 0x00ff00ff) * a;
+    unsigned int g = ((pixel >> 8) & 0xff) * a;
+
+    rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+    g = ((g + 1 + (g >> 8)) >> 8) & 0xff;
+
+    return (pixel & 0xff000000) | rb | (g << 8);
+}
+
+static inline unsigned int swap_rb(unsigned int pixel)
+{
+    return (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+}
+
+static inline unsigned int expand_gray(unsigned int gray)
+{
+    return 0xff000000 | (gray << 16) | (gray << 8) | gray;
+}
+
+/* 5-bit channels are expanded by repeating their top bits */
+static inline unsigned int bgr555_to_bgra(unsigned int s)
+{
+    return ((s << 9) & 0xf80000) | ((s << 4) & 0x070000) |
+           ((s << 6) & 0x00f800) | ((s << 1) & 0x000700) |
+           ((s << 3) & 0x0000f8) | ((s >> 2) & 0x000007);
+}
+
+static inline unsigned char gray_to_sRGB_byte(float gray)
+{
+    return (unsigned char)floorf(to_sRGB_component(gray) * 255.0f + 0.51f);
+}
+
+static inline float bgr_to_gray(const unsigned char *bgr)
+{
+    return (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
+}
+
+/* bpp is a constant in each caller, so the loop over the pixels of a
+ * byte is unrolled and the partial byte at the end is handled once */
+static inline void indexed_to_bgra(const unsigned char *src, unsigned char *dst,
+    unsigned int width, const unsigned int *palette, const unsigned int bpp)
+{
+    const unsigned int per_byte = 8 / bpp, mask = (1 << bpp) - 1;
+    unsigned int x, i, byte;
+
+    for (x = per_byte; x <= width; x += per_byte)
+    {
+        byte = *src++;
+        for (i = 0; i < per_byte; i++)
+        {
+            store32(dst, palette[(byte >> (8 - bpp * (i + 1))) & mask]);
+            dst += 4;
+        }
+    }
+
+    x -= per_byte;
+    if (x < width)
+    {
+        byte = *src;
+        for (i = 0; x + i < width; i++)
+        {
+            store32(dst, palette[(byte >> (8 - bpp * (i + 1))) & mask]);
+            dst += 4;
+        }
+    }
+}
+
+void convrow_1bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    indexed_to_bgra(src, dst, width, palette, 1);
+}
+
+void convrow_2bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    indexed_to_bgra(src, dst, width, palette, 2);
+}
+
+void convrow_4bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    indexed_to_bgra(src, dst, width, palette, 4);
+}
+
+void convrow_8bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + width;
+
+    while (src < end)
+    {
+        store32(dst, palette[*src++]);
+        dst += 4;
+    }
+}
+
+void convrow_gray8_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + width;
+
+    while (src < end)
+    {
+        store32(dst, expand_gray(*src++));
+        dst += 4;
+    }
+}
+
+/* The 16-bit channels are reduced to their second byte */
+void convrow_gray16_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 2 * width;
+
+    for (; src < end; src += 2)
+    {
+        store32(dst, expand_gray(src[1]));
+        dst += 4;
+    }
+}
+
+void convrow_bgr555_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 2 * width;
+
+    for (; src < end; src += 2)
+    {
+        store32(dst, 0xff000000 | bgr555_to_bgra(load16(src)));
+        dst += 4;
+    }
+}
+
+void convrow_bgr565_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 2 * width;
+
+    for (; src < end; src += 2)
+    {
+        unsigned int s = load16(src);
+
+        store32(dst, 0xff000000 |
+            ((s << 8) & 0xf80000) | ((s << 3) & 0x070000) |
+            ((s << 5) & 0x00fc00) | ((s >> 1) & 0x000300) |
+            ((s << 3) & 0x0000f8) | ((s >> 2) & 0x000007));
+        dst += 4;
+    }
+}
+
+void convrow_bgra5551_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 2 * width;
+
+    for (; src < end; src += 2)
+    {
+        unsigned int s = load16(src);
+
+        store32(dst, ((0 - (s >> 15)) << 24) | bgr555_to_bgra(s));
+        dst += 4;
+    }
+}
+
+/* Four pixels are three words */
+void convrow_bgr_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 3 * width;
+
+    for (; src + 12 <= end; src += 12)
+    {
+        unsigned int a = load32(src), b = load32(src + 4), c = load32(src + 8);
+
+        store32(dst, 0xff000000 | a);
+        store32(dst + 4, 0xff000000 | (a >> 24) | (b << 8));
+        store32(dst + 8, 0xff000000 | (b >> 16) | (c << 16));
+        store32(dst + 12, 0xff000000 | (c >> 8));
+        dst += 16;
+    }
+
+    for (; src < end; src += 3)
+    {
+        store32(dst, 0xff000000 | src[0] | (src[1] << 8) | (src[2] << 16));
+        dst += 4;
+    }
+}
+
+void convrow_rgb_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 3 * width;
+
+    for (; src < end; src += 3)
+    {
+        store32(dst, 0xff000000 | src[2] | (src[1] << 8) | (src[0] << 16));
+        dst += 4;
+    }
+}
+
+void convrow_rgb48_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 6 * width;
+
+    for (; src < end; src += 6)
+    {
+        store32(dst, 0xff000000 | (src[1] << 16) | (src[3] << 8) | src[5]);
+        dst += 4;
+    }
+}
+
+void convrow_rgba64_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 8 * width;
+
+    for (; src < end; src += 8)
+    {
+        store32(dst, ((unsigned int)src[7] << 24) | (src[1] << 16) | (src[3] << 8) | src[5]);
+        dst += 4;
+    }
+}
+
+void convrow_cmyk_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        unsigned int c = src[0], m = src[1], y = src[2], k = 255 - src[3];
+
+        dst[0] = (255 - y) * k / 255;
+        dst[1] = (255 - m) * k / 255;
+        dst[2] = (255 - c) * k / 255;
+        dst[3] = 0xff;
+        dst += 4;
+    }
+}
+
+void convrow_set_alpha(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        store32(dst, load32(src) | 0xff000000);
+        dst += 4;
+    }
+}
+
+/* Only red and blue are touched when working in place */
+void convrow_swap_rb32(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    unsigned char *end = dst + 4 * width, b;
+
+    if (src != dst)
+        memcpy(dst, src, width * 4);
+
+    for (; dst < end; dst += 4)
+    {
+        b = dst[0];
+        dst[0] = dst[2];
+        dst[2] = b;
+    }
+}
+
+void convrow_premultiply(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        store32(dst, premultiply(load32(src)));
+        dst += 4;
+    }
+}
+
+void convrow_premultiply_swap_rb(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        store32(dst, swap_rb(premultiply(load32(src))));
+        dst += 4;
+    }
+}
+
+void convrow_unpremultiply(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        unsigned int pixel = load32(src), recip = unpremultiply_recip[pixel >> 24];
+
+        /* Colors larger than the alpha wrap around like the division did */
+        store32(dst, (pixel & 0xff000000) |
+            (((pixel & 0xff) * recip >> 16) & 0xff) |
+            ((((pixel >> 8) & 0xff) * recip >> 8) & 0xff00) |
+            ((((pixel >> 16) & 0xff) * recip) & 0xff0000));
+        dst += 4;
+    }
+}
+
+void convrow_bgra_to_grayfloat(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+    float gray;
+
+    for (; src < end; src += 4)
+    {
+        gray = bgr_to_gray(src);
+        memcpy(dst, &gray, sizeof(gray));
+        dst += 4;
+    }
+}
+
+void convrow_swap_rb24(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    unsigned char *end = dst + 3 * width, b;
+
+    if (src != dst)
+        memcpy(dst, src, width * 3);
+
+    for (; dst < end; dst += 3)
+    {
+        b = dst[0];
+        dst[0] = dst[2];
+        dst[2] = b;
+    }
+}
+
+/* Four pixels are three words */
+void convrow_bgra_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src + 16 <= end; src += 16)
+    {
+        unsigned int p0 = load32(src), p1 = load32(src + 4), p2 = load32(src + 8), p3 = load32(src + 12);
+
+        store32(dst, (p0 & 0xffffff) | (p1 << 24));
+        store32(dst + 4, ((p1 >> 8) & 0xffff) | (p2 << 16));
+        store32(dst + 8, ((p2 >> 16) & 0xff) | (p3 << 8));
+        dst += 12;
+    }
+
+    for (; src < end; src += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst += 3;
+    }
+}
+
+void convrow_bgra_to_rgb(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst += 3;
+    }
+}
+
+void convrow_grayfloat_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+    float f;
+
+    for (; src < end; src += 4)
+    {
+        memcpy(&f, src, sizeof(f));
+        dst[0] = dst[1] = dst[2] = gray_to_sRGB_byte(f);
+        dst += 3;
+    }
+}
+
+void convrow_cmyk_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+
+    for (; src < end; src += 4)
+    {
+        unsigned int c = src[0], m = src[1], y = src[2], k = 255 - src[3];
+
+        dst[0] = (255 - y) * k / 255;
+        dst[1] = (255 - m) * k / 255;
+        dst[2] = (255 - c) * k / 255;
+        dst += 3;
+    }
+}
+
+void convrow_grayfloat_to_gray8(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 4 * width;
+    float f;
+
+    for (; src < end; src += 4)
+    {
+        memcpy(&f, src, sizeof(f));
+        *dst++ = gray_to_sRGB_byte(f);
+    }
+}
+
+void convrow_bgr_to_gray8(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette)
+{
+    const unsigned char *end = src + 3 * width;
+
+    for (; src < end; src += 3)
+        *dst++ = gray_to_sRGB_byte(bgr_to_gray(src));
+}
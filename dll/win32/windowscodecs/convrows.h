@@ -0,0 +1,66 @@
+/*
+ * Pixel format conversion row kernels
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef WINCODECS_CONVROWS_H
+#define WINCODECS_CONVROWS_H
+
+/* This file and convrows.c don't depend on any Windows header, so the
+ * kernels can be built and tested on the host. */
+
+/* Converts one row of width pixels. Kernels that don't change the pixel
+ * size also work in place (src == dst). palette holds 0xAARRGGBB colors
+ * and is only used by the indexed kernels. */
+typedef void (*convrow_func)(const unsigned char *src, unsigned char *dst,
+    unsigned int width, const unsigned int *palette);
+
+/* To 32bpp BGRA */
+void convrow_1bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_2bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_4bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_8bpp_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_gray8_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_gray16_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgr555_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgr565_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgra5551_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgr_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_rgb_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_rgb48_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_rgba64_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_cmyk_to_bgra(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+
+/* 32bpp to 32bpp, in place */
+void convrow_set_alpha(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_swap_rb32(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_premultiply(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_premultiply_swap_rb(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_unpremultiply(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgra_to_grayfloat(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+
+/* To 24bpp */
+void convrow_swap_rb24(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgra_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgra_to_rgb(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_grayfloat_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_cmyk_to_bgr(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+
+/* To 8bpp gray */
+void convrow_grayfloat_to_gray8(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+void convrow_bgr_to_gray8(const unsigned char *src, unsigned char *dst, unsigned int width, const unsigned int *palette);
+
+#endif /* WINCODECS_CONVROWS_H */
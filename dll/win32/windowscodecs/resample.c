@@ -0,0 +1,280 @@
+/*
+ * Separable image resampling filters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "resample.h"
+
+#define WEIGHT_ONE (1 << RESAMPLE_WEIGHT_BITS)
+#define WEIGHT_ROUND (1 << (RESAMPLE_WEIGHT_BITS - 1))
+
+static double linear_kernel(double x)
+{
+    x = fabs(x);
+    return x < 1.0 ? 1.0 - x : 0.0;
+}
+
+/* Catmull-Rom spline (a = -0.5), which keeps the samples at integer positions */
+static double cubic_kernel(double x)
+{
+    x = fabs(x);
+    if (x < 1.0)
+        return (1.5 * x - 2.5) * x * x + 1.0;
+    if (x < 2.0)
+        return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+    return 0.0;
+}
+
+static inline int clamp_index(int i, unsigned int size)
+{
+    if (i < 0) return 0;
+    if (i >= (int)size) return size - 1;
+    return i;
+}
+
+static inline unsigned char clamp_byte(int value)
+{
+    if (value < 0) return 0;
+    value >>= RESAMPLE_WEIGHT_BITS;
+    return value > 255 ? 255 : value;
+}
+
+int resample_filter_init(struct resample_filter *filter, enum resample_kernel kernel,
+    unsigned int src_size, unsigned int dst_size)
+{
+    double scale = (double)src_size / dst_size;
+    double support, filter_scale;
+    double *sums;
+    unsigned int i, t;
+
+    filter->dst_size = dst_size;
+    filter->start = NULL;
+    filter->weights = NULL;
+
+    /* When shrinking, stretch the kernel so it covers all the source pixels
+     * that fall in a destination pixel. The box filter integrates over the
+     * destination pixel instead. */
+    filter_scale = scale > 1.0 ? scale : 1.0;
+    switch (kernel)
+    {
+    case RESAMPLE_LINEAR:
+        support = filter_scale;
+        break;
+    case RESAMPLE_CUBIC:
+        support = 2.0 * filter_scale;
+        break;
+    case RESAMPLE_BOX:
+    default:
+        support = scale / 2.0;
+        break;
+    }
+
+    filter->taps = (unsigned int)ceil(support * 2.0) + 1;
+    if (filter->taps > src_size)
+        filter->taps = src_size;
+
+    filter->start = malloc(dst_size * sizeof(*filter->start));
+    filter->weights = calloc(dst_size * filter->taps, sizeof(*filter->weights));
+    sums = malloc(filter->taps * sizeof(*sums));
+    if (!filter->start || !filter->weights || !sums)
+    {
+        free(sums);
+        resample_filter_free(filter);
+        return 0;
+    }
+
+    for (i = 0; i < dst_size; i++)
+    {
+        short *weights = filter->weights + i * filter->taps;
+        double center, total = 0.0;
+        int left, right, j, start, best = 0, sum = 0;
+
+        if (kernel == RESAMPLE_BOX)
+        {
+            /* Source interval covered by destination pixel i */
+            center = (i + 0.5) * scale;
+            left = (int)floor(i * scale);
+            right = (int)ceil((i + 1) * scale) - 1;
+        }
+        else
+        {
+            center = (i + 0.5) * scale - 0.5;
+            left = (int)ceil(center - support);
+            right = (int)floor(center + support);
+        }
+
+        start = left;
+        if (start > (int)(src_size - filter->taps)) start = src_size - filter->taps;
+        if (start < 0) start = 0;
+        filter->start[i] = start;
+
+        memset(sums, 0, filter->taps * sizeof(*sums));
+
+        /* Samples outside the image are replaced by the nearest edge pixel */
+        for (j = left; j <= right; j++)
+        {
+            double w;
+
+            if (kernel == RESAMPLE_BOX)
+            {
+                double a = j > i * scale ? j : i * scale;
+                double b = j + 1 < (i + 1) * scale ? j + 1 : (i + 1) * scale;
+                w = b > a ? b - a : 0.0;
+            }
+            else if (kernel == RESAMPLE_LINEAR)
+                w = linear_kernel((j - center) / filter_scale);
+            else
+                w = cubic_kernel((j - center) / filter_scale);
+
+            sums[clamp_index(j, src_size) - start] += w;
+            total += w;
+        }
+
+        if (total == 0.0)
+        {
+            /* Can only happen through rounding, use the nearest pixel */
+            sums[clamp_index((int)center, src_size) - start] = total = 1.0;
+        }
+
+        /* Normalize so the weights add up to exactly one */
+        for (t = 0; t < filter->taps; t++)
+        {
+            weights[t] = (short)floor(sums[t] / total * WEIGHT_ONE + 0.5);
+            sum += weights[t];
+            if (weights[t] > weights[best]) best = t;
+        }
+        weights[best] += WEIGHT_ONE - sum;
+    }
+
+    free(sums);
+    return 1;
+}
+
+void resample_filter_free(struct resample_filter *filter)
+{
+    free(filter->start);
+    free(filter->weights);
+    filter->start = NULL;
+    filter->weights = NULL;
+}
+
+/* The channel count is a constant in each caller, so the compiler can
+ * keep the sums in registers and unroll the channel loops */
+static inline void resample_row_channels(const struct resample_filter *filter,
+    const unsigned int channels, const unsigned char *src, unsigned char *dst)
+{
+    const short *weights = filter->weights;
+    unsigned int taps = filter->taps;
+    unsigned int i, t, c;
+
+    for (i = 0; i < filter->dst_size; i++)
+    {
+        const unsigned char *p = src + filter->start[i] * channels;
+        int sum[4] = { WEIGHT_ROUND, WEIGHT_ROUND, WEIGHT_ROUND, WEIGHT_ROUND };
+
+        for (t = 0; t < taps; t++)
+        {
+            int w = weights[t];
+
+            for (c = 0; c < channels; c++)
+                sum[c] += w * p[c];
+            p += channels;
+        }
+
+        for (c = 0; c < channels; c++)
+            dst[c] = clamp_byte(sum[c]);
+
+        dst += channels;
+        weights += taps;
+    }
+}
+
+void resample_row(const struct resample_filter *filter, unsigned int channels,
+    const unsigned char *src, unsigned char *dst)
+{
+    switch (channels)
+    {
+    case 1: resample_row_channels(filter, 1, src, dst); break;
+    case 2: resample_row_channels(filter, 2, src, dst); break;
+    case 3: resample_row_channels(filter, 3, src, dst); break;
+    default: resample_row_channels(filter, 4, src, dst); break;
+    }
+}
+
+void resample_column(const short *weights, unsigned int taps,
+    const unsigned char * const *rows, unsigned int offset, unsigned int count,
+    int *acc, unsigned char *dst)
+{
+    unsigned int i, t;
+
+    /* Channels don't mix vertically, so this works on bytes in simple
+     * loops the compiler can vectorize */
+    for (i = 0; i < count; i++)
+        acc[i] = WEIGHT_ROUND;
+
+    for (t = 0; t < taps; t++)
+    {
+        const unsigned char *row = rows[t] + offset;
+        int w = weights[t];
+
+        if (!w) continue;
+
+        for (i = 0; i < count; i++)
+            acc[i] += w * row[i];
+    }
+
+    for (i = 0; i < count; i++)
+        dst[i] = clamp_byte(acc[i]);
+}
+
+void resample_premultiply(unsigned char *pixels, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++, pixels += 4)
+    {
+        unsigned int alpha = pixels[3];
+
+        if (alpha == 255) continue;
+
+        pixels[0] = (pixels[0] * alpha + 127) / 255;
+        pixels[1] = (pixels[1] * alpha + 127) / 255;
+        pixels[2] = (pixels[2] * alpha + 127) / 255;
+    }
+}
+
+void resample_unpremultiply(unsigned char *pixels, unsigned int count)
+{
+    unsigned int i, c;
+
+    for (i = 0; i < count; i++, pixels += 4)
+    {
+        unsigned int alpha = pixels[3];
+
+        if (alpha == 255) continue;
+
+        /* Cubic filtering can overshoot, so a channel may exceed alpha */
+        for (c = 0; c < 3; c++)
+        {
+            unsigned int value = alpha ? (pixels[c] * 255 + alpha / 2) / alpha : 0;
+            pixels[c] = value > 255 ? 255 : value;
+        }
+    }
+}
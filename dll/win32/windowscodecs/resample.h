@@ -0,0 +1,64 @@
+/*
+ * Separable image resampling filters
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef WINCODECS_RESAMPLE_H
+#define WINCODECS_RESAMPLE_H
+
+/* This file and resample.c don't depend on any Windows header, so the
+ * filters can be built and tested on the host. */
+
+enum resample_kernel
+{
+    RESAMPLE_LINEAR,
+    RESAMPLE_CUBIC,
+    RESAMPLE_BOX
+};
+
+/* Weights are fixed point numbers with RESAMPLE_WEIGHT_BITS fractional bits */
+#define RESAMPLE_WEIGHT_BITS 14
+
+/* Weight table for one axis. Destination pixel i is the sum of source pixels
+ * start[i] .. start[i]+taps-1 multiplied by weights[i*taps] .. weights[i*taps+taps-1]. */
+struct resample_filter
+{
+    unsigned int dst_size;
+    unsigned int taps;
+    int *start;
+    short *weights;
+};
+
+int resample_filter_init(struct resample_filter *filter, enum resample_kernel kernel,
+    unsigned int src_size, unsigned int dst_size);
+void resample_filter_free(struct resample_filter *filter);
+
+/* Scales one row of pixels with 1 to 4 byte sized channels */
+void resample_row(const struct resample_filter *filter, unsigned int channels,
+    const unsigned char *src, unsigned char *dst);
+
+/* Blends taps rows byte by byte, acc must hold count ints */
+void resample_column(const short *weights, unsigned int taps,
+    const unsigned char * const *rows, unsigned int offset, unsigned int count,
+    int *acc, unsigned char *dst);
+
+/* Converts count 4 channel pixels with straight alpha in the last channel
+ * to premultiplied alpha and back. Filtering straight alpha would blend the
+ * colour of transparent pixels into the visible ones next to them. */
+void resample_premultiply(unsigned char *pixels, unsigned int count);
+void resample_unpremultiply(unsigned char *pixels, unsigned int count);
+
+#endif /* WINCODECS_RESAMPLE_H */
@@ -28,6 +28,7 @@
 #include "objbase.h"
 
 #include "wincodecs_private.h"
+#include "resample.h"
 
 #include "wine/debug.h"
 
@@ -44,6 +45,19 @@ typedef struct BitmapScaler {
     UINT bpp;
     void (*fn_get_required_source_rect)(struct BitmapScaler*,UINT,UINT,WICRect*);
     void (*fn_copy_scanline)(struct BitmapScaler*,UINT,UINT,UINT,BYTE**,UINT,UINT,BYTE*);
+    /* Linear, cubic and Fant modes scale each axis separately. Source rows
+     * are scaled horizontally when they are first needed and kept in a ring
+     * of filter_y.taps rows, so scanlines requested one after the other
+     * don't read any source row twice. */
+    BOOL filtered;
+    BOOL premultiply; /* straight alpha, filtered premultiplied */
+    struct resample_filter filter_x, filter_y;
+    UINT channels;
+    BYTE *row_cache;
+    INT *row_cache_y; /* source row held by each ring entry, -1 if none */
+    BYTE *src_rows; /* buffer for up to src_rows_count source rows */
+    UINT src_rows_count;
+    INT *acc;
     CRITICAL_SECTION lock; /* must be held when initialized */
 } BitmapScaler;
 
@@ -96,6 +110,20 @@ static ULONG WINAPI BitmapScaler_AddRef(IWICBitmapScaler *iface)
     return ref;
 }
 
+static void Filter_Free(BitmapScaler *This)
+{
+    resample_filter_free(&This->filter_x);
+    resample_filter_free(&This->filter_y);
+    HeapFree(GetProcessHeap(), 0, This->row_cache);
+    HeapFree(GetProcessHeap(), 0, This->row_cache_y);
+    HeapFree(GetProcessHeap(), 0, This->src_rows);
+    HeapFree(GetProcessHeap(), 0, This->acc);
+    This->row_cache = NULL;
+    This->row_cache_y = NULL;
+    This->src_rows = NULL;
+    This->acc = NULL;
+}
+
 static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
 {
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
@@ -108,6 +136,7 @@ static ULONG WINAPI BitmapScaler_Release(IWICBitmapScaler *iface)
         This->lock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&This->lock);
         if (This->source) IWICBitmapSource_Release(This->source);
+        Filter_Free(This);
         HeapFree(GetProcessHeap(), 0, This);
     }
 
@@ -205,6 +234,189 @@ static void NearestNeighbor_CopyScanline(BitmapScaler *This,
     }
 }
 
+/* Sources can only copy 1, 2 and 4 bpp pixels from a byte boundary */
+static void NearestNeighbor_GetRequiredSourceRectBits(BitmapScaler *This,
+    UINT x, UINT y, WICRect *src_rect)
+{
+    UINT misalign;
+
+    NearestNeighbor_GetRequiredSourceRect(This, x, y, src_rect);
+
+    misalign = src_rect->X % (8 / This->bpp);
+    src_rect->X -= misalign;
+    src_rect->Width += misalign;
+}
+
+static void NearestNeighbor_CopyScanlineBits(BitmapScaler *This,
+    UINT dst_x, UINT dst_y, UINT dst_width,
+    BYTE **src_data, UINT src_data_x, UINT src_data_y, BYTE *pbBuffer)
+{
+    UINT i, bit, value;
+    UINT mask = (1 << This->bpp) - 1;
+    UINT src_x, src_y;
+
+    src_y = dst_y * This->src_height / This->height - src_data_y;
+
+    memset(pbBuffer, 0, (dst_width * This->bpp + 7) / 8);
+
+    for (i=0; i<dst_width; i++)
+    {
+        src_x = (dst_x + i) * This->src_width / This->width - src_data_x;
+
+        /* The first pixel is in the most significant bits */
+        bit = src_x * This->bpp;
+        value = (src_data[src_y][bit / 8] >> (8 - This->bpp - bit % 8)) & mask;
+
+        bit = i * This->bpp;
+        pbBuffer[bit / 8] |= value << (8 - This->bpp - bit % 8);
+    }
+}
+
+static HRESULT Filter_Initialize(BitmapScaler *This, enum resample_kernel kernel)
+{
+    UINT i, row_size;
+
+    This->channels = This->bpp / 8;
+
+    if (!resample_filter_init(&This->filter_x, kernel, This->src_width, This->width) ||
+        !resample_filter_init(&This->filter_y, kernel, This->src_height, This->height))
+    {
+        Filter_Free(This);
+        return E_OUTOFMEMORY;
+    }
+
+    /* Fetch a few source rows per call, but don't hold a whole image when
+     * shrinking a lot */
+    This->src_rows_count = min(This->filter_y.taps, 16);
+
+    row_size = This->width * This->channels;
+    This->row_cache = HeapAlloc(GetProcessHeap(), 0, row_size * This->filter_y.taps);
+    This->row_cache_y = HeapAlloc(GetProcessHeap(), 0, sizeof(INT) * This->filter_y.taps);
+    This->src_rows = HeapAlloc(GetProcessHeap(), 0, This->src_width * This->channels * This->src_rows_count);
+    This->acc = HeapAlloc(GetProcessHeap(), 0, sizeof(INT) * row_size);
+
+    if (!This->row_cache || !This->row_cache_y || !This->src_rows || !This->acc)
+    {
+        Filter_Free(This);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < This->filter_y.taps; i++)
+        This->row_cache_y[i] = -1;
+
+    return S_OK;
+}
+
+static HRESULT Filter_FillRowCache(BitmapScaler *This, INT first, UINT count)
+{
+    UINT src_stride = This->src_width * This->channels;
+    UINT row_size = This->width * This->channels;
+    INT y = first;
+    HRESULT hr;
+
+    while (y < first + (INT)count)
+    {
+        WICRect rc;
+        UINT i;
+
+        if (This->row_cache_y[y % This->filter_y.taps] == y)
+        {
+            y++;
+            continue;
+        }
+
+        /* Read the run of missing rows in one call */
+        rc.X = 0;
+        rc.Y = y;
+        rc.Width = This->src_width;
+        rc.Height = 1;
+        while (rc.Height < This->src_rows_count && y + rc.Height < first + (INT)count &&
+               This->row_cache_y[(y + rc.Height) % This->filter_y.taps] != y + rc.Height)
+            rc.Height++;
+
+        hr = IWICBitmapSource_CopyPixels(This->source, &rc, src_stride,
+            src_stride * rc.Height, This->src_rows);
+        if (FAILED(hr)) return hr;
+
+        for (i = 0; i < rc.Height; i++, y++)
+        {
+            UINT slot = y % This->filter_y.taps;
+
+            if (This->premultiply)
+                resample_premultiply(This->src_rows + src_stride * i, This->src_width);
+
+            resample_row(&This->filter_x, This->channels, This->src_rows + src_stride * i,
+                This->row_cache + row_size * slot);
+            This->row_cache_y[slot] = y;
+        }
+    }
+
+    return S_OK;
+}
+
+static HRESULT Filter_CopyPixels(BitmapScaler *This, const WICRect *dest_rect,
+    UINT cbStride, BYTE *pbBuffer)
+{
+    const BYTE *rows[256];
+    const BYTE **row_ptrs = rows;
+    UINT row_size = This->width * This->channels;
+    UINT taps = This->filter_y.taps;
+    HRESULT hr = S_OK;
+    INT y;
+
+    if (taps > ARRAY_SIZE(rows))
+    {
+        row_ptrs = HeapAlloc(GetProcessHeap(), 0, sizeof(*row_ptrs) * taps);
+        if (!row_ptrs) return E_OUTOFMEMORY;
+    }
+
+    for (y = dest_rect->Y; y < dest_rect->Y + dest_rect->Height; y++)
+    {
+        INT start = This->filter_y.start[y];
+        UINT t;
+
+        hr = Filter_FillRowCache(This, start, taps);
+        if (FAILED(hr)) break;
+
+        for (t = 0; t < taps; t++)
+            row_ptrs[t] = This->row_cache + row_size * ((start + t) % taps);
+
+        resample_column(This->filter_y.weights + y * taps, taps, row_ptrs,
+            dest_rect->X * This->channels, dest_rect->Width * This->channels,
+            This->acc, pbBuffer + cbStride * (y - dest_rect->Y));
+
+        if (This->premultiply)
+            resample_unpremultiply(pbBuffer + cbStride * (y - dest_rect->Y), dest_rect->Width);
+    }
+
+    if (row_ptrs != rows)
+        HeapFree(GetProcessHeap(), 0, row_ptrs);
+
+    return hr;
+}
+
+static BOOL Filter_IsSupportedFormat(const WICPixelFormatGUID *format)
+{
+    /* Formats made of independent byte sized channels */
+    static const WICPixelFormatGUID * const formats[] =
+    {
+        &GUID_WICPixelFormat8bppGray,
+        &GUID_WICPixelFormat24bppBGR,
+        &GUID_WICPixelFormat24bppRGB,
+        &GUID_WICPixelFormat32bppBGR,
+        &GUID_WICPixelFormat32bppBGRA,
+        &GUID_WICPixelFormat32bppPBGRA,
+        &GUID_WICPixelFormat32bppRGBA,
+        &GUID_WICPixelFormat32bppPRGBA,
+    };
+    UINT i;
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++)
+        if (IsEqualGUID(format, formats[i])) return TRUE;
+
+    return FALSE;
+}
+
 static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
     const WICRect *prc, UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer)
 {
@@ -259,6 +471,12 @@ static HRESULT WINAPI BitmapScaler_CopyPixels(IWICBitmapScaler *iface,
         goto end;
     }
 
+    if (This->filtered)
+    {
+        hr = Filter_CopyPixels(This, &dest_rect, cbStride, pbBuffer);
+        goto end;
+    }
+
     /* MSDN recommends calling CopyPixels once for each scanline from top to
      * bottom, and claims codecs optimize for this. Ideally, when called in this
      * way, we should avoid requesting a scanline from the source more than
@@ -321,6 +539,8 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     BitmapScaler *This = impl_from_IWICBitmapScaler(iface);
     HRESULT hr;
     GUID src_pixelformat;
+    enum resample_kernel kernel = RESAMPLE_BOX;
+    BOOL filter = TRUE;
 
     TRACE("(%p,%p,%u,%u,%u)\n", iface, pISource, uiWidth, uiHeight, mode);
 
@@ -353,24 +573,73 @@ static HRESULT WINAPI BitmapScaler_Initialize(IWICBitmapScaler *iface,
     {
         switch (mode)
         {
+        case WICBitmapInterpolationModeLinear:
+            kernel = RESAMPLE_LINEAR;
+            break;
+        /* The cubic filter is already widened when shrinking, which is what
+         * sets the high quality mode apart, so both use it */
+        case WICBitmapInterpolationModeCubic:
+        case WICBitmapInterpolationModeHighQualityCubic:
+            kernel = RESAMPLE_CUBIC;
+            break;
+        case WICBitmapInterpolationModeFant:
+            kernel = RESAMPLE_BOX;
+            break;
         default:
             FIXME("unsupported mode %i\n", mode);
             /* fall-through */
         case WICBitmapInterpolationModeNearestNeighbor:
+            filter = FALSE;
+            break;
+        }
+
+        /* The filters only handle byte sized channels. Point sample other
+         * formats rather than hand out a different pixel format */
+        if (filter && !Filter_IsSupportedFormat(&src_pixelformat))
+        {
+            FIXME("can't filter %s, using nearest neighbor\n", debugstr_guid(&src_pixelformat));
+            filter = FALSE;
+        }
+
+        if (filter)
+        {
+            IWICBitmapSource_AddRef(pISource);
+            This->source = pISource;
+            This->premultiply = IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppBGRA) ||
+                                IsEqualGUID(&src_pixelformat, &GUID_WICPixelFormat32bppRGBA);
+
+            hr = Filter_Initialize(This, kernel);
+            if (SUCCEEDED(hr))
+                This->filtered = TRUE;
+            else
+            {
+                IWICBitmapSource_Release(This->source);
+                This->source = NULL;
+            }
+        }
+        else
+        {
+            This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
+            This->fn_copy_scanline = NearestNeighbor_CopyScanline;
+
             if ((This->bpp % 8) == 0)
             {
                 IWICBitmapSource_AddRef(pISource);
                 This->source = pISource;
             }
+            else if (This->bpp < 8 && (8 % This->bpp) == 0)
+            {
+                IWICBitmapSource_AddRef(pISource);
+                This->source = pISource;
+                This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRectBits;
+                This->fn_copy_scanline = NearestNeighbor_CopyScanlineBits;
+            }
             else
             {
                 hr = WICConvertBitmapSource(&GUID_WICPixelFormat32bppBGRA,
                     pISource, &This->source);
                 This->bpp = 32;
             }
-            This->fn_get_required_source_rect = NearestNeighbor_GetRequiredSourceRect;
-            This->fn_copy_scanline = NearestNeighbor_CopyScanline;
-            break;
         }
     }
 
@@ -529,6 +798,13 @@ HRESULT BitmapScaler_Create(IWICBitmapScaler **scaler)
     This->src_height = 0;
     This->mode = 0;
     This->bpp = 0;
+    This->filtered = FALSE;
+    memset(&This->filter_x, 0, sizeof(This->filter_x));
+    memset(&This->filter_y, 0, sizeof(This->filter_y));
+    This->row_cache = NULL;
+    This->row_cache_y = NULL;
+    This->src_rows = NULL;
+    This->acc = NULL;
     InitializeCriticalSection(&This->lock);
     This->lock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": BitmapScaler.lock");
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 
 #include "blake2-impl.h"
+#include "csum.h"
 
 static const uint64_t blake2b_IV[8] =
 {
@@ -138,7 +139,8 @@ static void blake2b_init( blake2b_state *S, size_t outlen )
     G(r,7,v[ 3],v[ 4],v[ 9],v[14]); \
   } while(0)
 
-static void blake2b_compress( blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES] )
+/* The SSSE3 version is in blake2b-amd64.S */
+void __stdcall blake2b_compress_sw( blake2b_state *S, const uint8_t *block )
 {
   uint64_t m[16];
   uint64_t v[16];
@@ -182,6 +184,8 @@ static void blake2b_compress( blake2b_state *S, const uint8_t block[BLAKE2B_BLOC
 #undef G
 #undef ROUND
 
+blake2b_compress_func blake2b_compress = blake2b_compress_sw;
+
 static int blake2b_update( blake2b_state *S, const void *pin, size_t inlen )
 {
   const unsigned char * in = (const unsigned char *)pin;
@@ -22,6 +22,7 @@
 #include "btrfs_drv.h"
 #include "xxhash.h"
 #include "crc32c.h"
+#include "csum.h"
 #ifndef __REACTOS__
 #ifndef _MSC_VER
 #include <cpuid.h>
@@ -2020,6 +2021,8 @@ void uninit(_In_ device_extension* Vcb) {
 
     ExFreePool(Vcb->calcthreads.threads);
 
+    free_comp_context_pool(Vcb);
+
     time.QuadPart = 0;
     KeSetTimer(&Vcb->flush_thread_timer, time, NULL); // trigger the timer early
     KeWaitForSingleObject(&Vcb->flush_thread_finished, Executive, KernelMode, false, NULL);
@@ -5900,6 +5903,34 @@ static void check_cpu() {
     else
         TRACE("SSE2 is not supported\n");
 }
+#elif defined(__REACTOS__) && defined(_AMD64_)
+// the SSE registers are free to use in amd64 kernel code, so no state needs saving
+static void check_cpu() {
+    int cpuInfo[4];
+    bool have_ssse3, have_sse41, have_sha = false;
+
+    __cpuid(cpuInfo, 1);
+    have_ssse3 = cpuInfo[2] & (1 << 9);
+    have_sse41 = cpuInfo[2] & (1 << 19);
+
+    __cpuid(cpuInfo, 0);
+    if (cpuInfo[0] >= 7) {
+        __cpuidex(cpuInfo, 7, 0);
+        have_sha = cpuInfo[1] & (1 << 29);
+    }
+
+    if (have_sha && have_sse41) {
+        TRACE("SHA extensions are supported\n");
+        calc_sha256_blocks = calc_sha256_blocks_shani;
+    } else
+        TRACE("SHA extensions not supported\n");
+
+    if (have_ssse3) {
+        TRACE("SSSE3 is supported\n");
+        blake2b_compress = blake2b_compress_ssse3;
+    } else
+        TRACE("SSSE3 not supported\n");
+}
 #endif
 
 #ifdef _DEBUG
@@ -6196,7 +6227,7 @@ NTSTATUS __stdcall DriverEntry(_In_ PDRIVER_OBJECT DriverObject, _In_ PUNICODE_S
 
     TRACE("DriverEntry\n");
 
-#if !defined(__REACTOS__) && (defined(_X86_) || defined(_AMD64_))
+#if (!defined(__REACTOS__) && defined(_X86_)) || defined(_AMD64_)
     check_cpu();
 #endif
 
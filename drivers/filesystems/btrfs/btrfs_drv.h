@@ -114,6 +114,7 @@ C_ASSERT(sizeof(bool) == 1);
 
 #define MAX_EXTENT_SIZE 0x8000000 // 128 MB
 #define COMPRESSED_EXTENT_SIZE 0x20000 // 128 KB
+#define COMP_CONTEXT_POOL_SIZE 4 // spare compressor contexts kept per volume for write_compressed
 
 #define READ_AHEAD_GRANULARITY COMPRESSED_EXTENT_SIZE // really ought to be a multiple of COMPRESSED_EXTENT_SIZE
 
@@ -657,12 +658,24 @@ typedef struct {
     NTSTATUS Status;
 } calc_job;
 
+// compressor state kept between jobs, so that each extent doesn't have to
+// allocate and initialize it again
+typedef struct {
+    void* zlib_stream;
+    unsigned int zlib_level;
+    void* zstd_cctx;
+    void* lzo_wrkmem;
+    void* lzo_buf;
+    unsigned int lzo_buf_len;
+} comp_context;
+
 typedef struct {
     PDEVICE_OBJECT DeviceObject;
     HANDLE handle;
     KEVENT finished;
     unsigned int number;
     bool quit;
+    comp_context comp_ctx;
 } drv_calc_thread;
 
 typedef struct {
@@ -671,6 +684,9 @@ typedef struct {
     KSPIN_LOCK spinlock;
     drv_calc_thread* threads;
     KEVENT event;
+    btrfs_compression_stats comp_stats; // protected by spinlock
+    comp_context* comp_ctx_pool[COMP_CONTEXT_POOL_SIZE]; // protected by spinlock
+    unsigned int comp_ctx_pool_count;
 } drv_calc_threads;
 
 typedef struct {
@@ -1551,9 +1567,14 @@ NTSTATUS zlib_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32
 NTSTATUS lzo_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t inpageoff);
 NTSTATUS zstd_decompress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen);
 NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void* data, PIRP Irp, LIST_ENTRY* rollback);
-NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left);
-NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left);
-NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left);
+NTSTATUS zlib_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left);
+NTSTATUS lzo_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left);
+NTSTATUS zstd_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left);
+bool compression_worthwhile(const uint8_t* data, unsigned int len);
+void free_comp_context(comp_context* ctx);
+comp_context* get_comp_context(device_extension* Vcb);
+void release_comp_context(device_extension* Vcb, comp_context* ctx);
+void free_comp_context_pool(device_extension* Vcb);
 
 // in galois.c
 void galois_double(uint8_t* data, uint32_t len);
@@ -1578,7 +1599,7 @@ NTSTATUS add_calc_job_decomp(device_extension* Vcb, uint8_t compression, void* i
                              void* out, unsigned int outlen, unsigned int off, calc_job** pcj);
 NTSTATUS add_calc_job_comp(device_extension* Vcb, uint8_t compression, void* in, unsigned int inlen,
                            void* out, unsigned int outlen, calc_job** pcj);
-void calc_thread_main(device_extension* Vcb, calc_job* cj);
+void calc_thread_main(device_extension* Vcb, calc_job* cj, comp_context* ctx);
 
 // in balance.c
 NTSTATUS start_balance(device_extension* Vcb, void* data, ULONG length, KPROCESSOR_MODE processor_mode);
@@ -37,6 +37,7 @@
 #define FSCTL_BTRFS_READ_SEND_BUFFER CTL_CODE(FILE_DEVICE_UNKNOWN, 0x847, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
 #define FSCTL_BTRFS_RESIZE CTL_CODE(FILE_DEVICE_UNKNOWN, 0x848, METHOD_IN_DIRECT, FILE_ANY_ACCESS)
 #define IOCTL_BTRFS_UNLOAD CTL_CODE(FILE_DEVICE_UNKNOWN, 0x849, METHOD_NEITHER, FILE_ANY_ACCESS)
+#define FSCTL_BTRFS_GET_COMPRESSION_STATS CTL_CODE(FILE_DEVICE_UNKNOWN, 0x84a, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
 
 typedef struct {
     uint64_t subvol;
@@ -279,3 +280,12 @@ typedef struct {
     uint64_t device;
     uint64_t size;
 } btrfs_resize;
+
+typedef struct {
+    uint64_t extents;            // extents passed to the compressor since mount
+    uint64_t extents_compressed; // extents that ended up stored compressed
+    uint64_t extents_skipped;    // extents that looked incompressible, so weren't tried
+    uint64_t bytes_in;           // uncompressed size of all extents
+    uint64_t bytes_out;          // size of all extents as stored, before sector padding
+    uint64_t time;               // time spent compressing, in 100ns units, summed over all threads
+} btrfs_compression_stats;
@@ -19,7 +19,67 @@
 #include "xxhash.h"
 #include "crc32c.h"
 
-void calc_thread_main(device_extension* Vcb, calc_job* cj) {
+static void do_comp_job(device_extension* Vcb, calc_job* cj, comp_context* ctx) {
+    LARGE_INTEGER time1, time2, freq;
+    bool skipped = false;
+    KIRQL irql;
+
+    time1 = KeQueryPerformanceCounter(&freq);
+
+    if (!Vcb->options.compress_force && !compression_worthwhile(cj->in, cj->inlen)) {
+        // leave it to write_compressed to write the extent uncompressed
+        cj->space_left = 0;
+        skipped = true;
+    } else {
+        switch (cj->type) {
+            case calc_thread_comp_zlib:
+                cj->Status = zlib_compress(ctx, cj->in, cj->inlen, cj->out, cj->outlen, Vcb->options.zlib_level, &cj->space_left);
+
+                if (!NT_SUCCESS(cj->Status))
+                    ERR("zlib_compress returned %08lx\n", cj->Status);
+            break;
+
+            case calc_thread_comp_lzo:
+                cj->Status = lzo_compress(ctx, cj->in, cj->inlen, cj->out, cj->outlen, &cj->space_left);
+
+                if (!NT_SUCCESS(cj->Status))
+                    ERR("lzo_compress returned %08lx\n", cj->Status);
+            break;
+
+            case calc_thread_comp_zstd:
+                cj->Status = zstd_compress(ctx, cj->in, cj->inlen, cj->out, cj->outlen, Vcb->options.zstd_level, &cj->space_left);
+
+                if (!NT_SUCCESS(cj->Status))
+                    ERR("zstd_compress returned %08lx\n", cj->Status);
+            break;
+
+            default:
+                break;
+        }
+    }
+
+    time2 = KeQueryPerformanceCounter(NULL);
+
+    KeAcquireSpinLock(&Vcb->calcthreads.spinlock, &irql);
+
+    Vcb->calcthreads.comp_stats.extents++;
+    Vcb->calcthreads.comp_stats.bytes_in += cj->inlen;
+    Vcb->calcthreads.comp_stats.time += (time2.QuadPart - time1.QuadPart) * 10000000 / freq.QuadPart;
+
+    if (skipped)
+        Vcb->calcthreads.comp_stats.extents_skipped++;
+
+    // same test as write_compressed uses
+    if (NT_SUCCESS(cj->Status) && cj->space_left >= Vcb->superblock.sector_size) {
+        Vcb->calcthreads.comp_stats.extents_compressed++;
+        Vcb->calcthreads.comp_stats.bytes_out += cj->inlen - cj->space_left;
+    } else
+        Vcb->calcthreads.comp_stats.bytes_out += cj->inlen;
+
+    KeReleaseSpinLock(&Vcb->calcthreads.spinlock, irql);
+}
+
+void calc_thread_main(device_extension* Vcb, calc_job* cj, comp_context* ctx) {
     while (true) {
         KIRQL irql;
         calc_job* cj2;
@@ -109,24 +169,9 @@ void calc_thread_main(device_extension* Vcb, calc_job* cj) {
             break;
 
             case calc_thread_comp_zlib:
-                cj2->Status = zlib_compress(src, cj2->inlen, dest, cj2->outlen, Vcb->options.zlib_level, &cj2->space_left);
-
-                if (!NT_SUCCESS(cj2->Status))
-                    ERR("zlib_compress returned %08lx\n", cj2->Status);
-            break;
-
             case calc_thread_comp_lzo:
-                cj2->Status = lzo_compress(src, cj2->inlen, dest, cj2->outlen, &cj2->space_left);
-
-                if (!NT_SUCCESS(cj2->Status))
-                    ERR("lzo_compress returned %08lx\n", cj2->Status);
-            break;
-
             case calc_thread_comp_zstd:
-                cj2->Status = zstd_compress(src, cj2->inlen, dest, cj2->outlen, Vcb->options.zstd_level, &cj2->space_left);
-
-                if (!NT_SUCCESS(cj2->Status))
-                    ERR("zstd_compress returned %08lx\n", cj2->Status);
+                do_comp_job(Vcb, cj2, ctx);
             break;
         }
 
@@ -175,7 +220,7 @@ void do_calc_job(device_extension* Vcb, uint8_t* data, uint32_t sectors, void* c
 
     KeReleaseSpinLock(&Vcb->calcthreads.spinlock, irql);
 
-    calc_thread_main(Vcb, &cj);
+    calc_thread_main(Vcb, &cj, NULL);
 
     KeWaitForSingleObject(&cj.event, Executive, KernelMode, false, NULL);
 }
@@ -299,12 +344,14 @@ void __stdcall calc_thread(void* context) {
     while (true) {
         KeWaitForSingleObject(&Vcb->calcthreads.event, Executive, KernelMode, false, NULL);
 
-        calc_thread_main(Vcb, NULL);
+        calc_thread_main(Vcb, NULL, &thread->comp_ctx);
 
         if (thread->quit)
             break;
     }
 
+    free_comp_context(&thread->comp_ctx);
+
     ObDereferenceObject(thread->DeviceObject);
 
     KeSetEvent(&thread->finished, 0, false);
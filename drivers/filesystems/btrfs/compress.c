@@ -42,6 +42,7 @@
 #define ZSTD_STATIC_LINKING_ONLY
 
 #include "zstd/zstd.h"
+#include "zstd/zstd_errors.h"
 
 #define LZO_PAGE_SIZE 4096
 
@@ -333,43 +334,68 @@ static void zlib_free(void* opaque, void* ptr) {
     ExFreePool(ptr);
 }
 
-NTSTATUS zlib_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left) {
-    z_stream c_stream;
+NTSTATUS zlib_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int level, unsigned int* space_left) {
+    z_stream* c_stream = ctx->zlib_stream;
     int ret;
 
-    c_stream.zalloc = zlib_alloc;
-    c_stream.zfree = zlib_free;
-    c_stream.opaque = (voidpf)0;
+    if (c_stream && ctx->zlib_level != level) { // level changed since the stream was set up
+        deflateEnd(c_stream);
+        ExFreePool(c_stream);
+        c_stream = ctx->zlib_stream = NULL;
+    }
 
-    ret = deflateInit(&c_stream, level);
+    if (c_stream) {
+        ret = deflateReset(c_stream);
 
-    if (ret != Z_OK) {
-        ERR("deflateInit returned %i\n", ret);
-        return STATUS_INTERNAL_ERROR;
+        if (ret != Z_OK) {
+            ERR("deflateReset returned %i\n", ret);
+            return STATUS_INTERNAL_ERROR;
+        }
+    } else {
+        c_stream = ExAllocatePoolWithTag(PagedPool, sizeof(z_stream), ALLOC_TAG_ZLIB);
+        if (!c_stream) {
+            ERR("out of memory\n");
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        c_stream->zalloc = zlib_alloc;
+        c_stream->zfree = zlib_free;
+        c_stream->opaque = (voidpf)0;
+
+        ret = deflateInit(c_stream, level);
+
+        if (ret != Z_OK) {
+            ERR("deflateInit returned %i\n", ret);
+            ExFreePool(c_stream);
+            return STATUS_INTERNAL_ERROR;
+        }
+
+        ctx->zlib_stream = c_stream;
+        ctx->zlib_level = level;
     }
 
-    c_stream.next_in = inbuf;
-    c_stream.avail_in = inlen;
+    c_stream->next_in = inbuf;
+    c_stream->avail_in = inlen;
 
-    c_stream.next_out = outbuf;
-    c_stream.avail_out = outlen;
+    c_stream->next_out = outbuf;
+    c_stream->avail_out = outlen;
 
     do {
-        ret = deflate(&c_stream, Z_FINISH);
+        ret = deflate(c_stream, Z_FINISH);
 
         if (ret != Z_OK && ret != Z_STREAM_END) {
             ERR("deflate returned %i\n", ret);
-            deflateEnd(&c_stream);
+            deflateEnd(c_stream);
+            ExFreePool(c_stream);
+            ctx->zlib_stream = NULL;
             return STATUS_INTERNAL_ERROR;
         }
 
-        if (c_stream.avail_in == 0 || c_stream.avail_out == 0)
+        if (c_stream->avail_in == 0 || c_stream->avail_out == 0)
             break;
     } while (ret != Z_STREAM_END);
 
-    deflateEnd(&c_stream);
-
-    *space_left = c_stream.avail_in > 0 ? 0 : c_stream.avail_out;
+    *space_left = c_stream->avail_in > 0 ? 0 : c_stream->avail_out;
 
     return STATUS_SUCCESS;
 }
@@ -719,7 +745,7 @@ end:
     return Status;
 }
 
-NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left) {
+NTSTATUS lzo_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, unsigned int* space_left) {
     NTSTATUS Status;
     unsigned int num_pages;
     unsigned int comp_data_len;
@@ -740,19 +766,36 @@ NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
 
     // FIXME - can we write this so comp_data isn't necessary?
 
-    comp_data = ExAllocatePoolWithTag(PagedPool, comp_data_len, ALLOC_TAG);
-    if (!comp_data) {
-        ERR("out of memory\n");
-        return STATUS_INSUFFICIENT_RESOURCES;
+    if (ctx->lzo_buf && ctx->lzo_buf_len < comp_data_len) {
+        ExFreePool(ctx->lzo_buf);
+        ctx->lzo_buf = NULL;
     }
 
-    stream.wrkmem = ExAllocatePoolWithTag(PagedPool, LZO1X_MEM_COMPRESS, ALLOC_TAG);
-    if (!stream.wrkmem) {
-        ERR("out of memory\n");
-        ExFreePool(comp_data);
-        return STATUS_INSUFFICIENT_RESOURCES;
+    if (!ctx->lzo_buf) {
+        // size for a whole extent, so that it only needs to be allocated once
+        unsigned int len = max(comp_data_len, sizeof(uint32_t) + ((lzo_max_outlen(LZO_PAGE_SIZE) + (2 * sizeof(uint32_t))) *
+                                                                  (COMPRESSED_EXTENT_SIZE / LZO_PAGE_SIZE)));
+
+        ctx->lzo_buf = ExAllocatePoolWithTag(PagedPool, len, ALLOC_TAG);
+        if (!ctx->lzo_buf) {
+            ERR("out of memory\n");
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        ctx->lzo_buf_len = len;
+    }
+
+    if (!ctx->lzo_wrkmem) {
+        ctx->lzo_wrkmem = ExAllocatePoolWithTag(PagedPool, LZO1X_MEM_COMPRESS, ALLOC_TAG);
+        if (!ctx->lzo_wrkmem) {
+            ERR("out of memory\n");
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
     }
 
+    comp_data = ctx->lzo_buf;
+    stream.wrkmem = ctx->lzo_wrkmem;
+
     out_size = (uint32_t*)comp_data;
     *out_size = sizeof(uint32_t);
 
@@ -771,7 +814,6 @@ NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
         Status = lzo1x_1_compress(&stream);
         if (!NT_SUCCESS(Status)) {
             ERR("lzo1x_1_compress returned %08lx\n", Status);
-            ExFreePool(comp_data);
             return Status;
         }
 
@@ -789,8 +831,6 @@ NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
         }
     }
 
-    ExFreePool(stream.wrkmem);
-
     if (*out_size >= outlen)
         *space_left = 0;
     else {
@@ -799,23 +839,20 @@ NTSTATUS lzo_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
         RtlCopyMemory(outbuf, comp_data, *out_size);
     }
 
-    ExFreePool(comp_data);
-
     return STATUS_SUCCESS;
 }
 
-NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left) {
-    ZSTD_CStream* stream;
-    size_t init_res, written;
-    ZSTD_inBuffer input;
-    ZSTD_outBuffer output;
+NTSTATUS zstd_compress(comp_context* ctx, uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t outlen, uint32_t level, unsigned int* space_left) {
+    size_t written;
     ZSTD_parameters params;
 
-    stream = ZSTD_createCStream_advanced(zstd_mem);
+    if (!ctx->zstd_cctx) {
+        ctx->zstd_cctx = ZSTD_createCCtx_advanced(zstd_mem);
 
-    if (!stream) {
-        ERR("ZSTD_createCStream failed.\n");
-        return STATUS_INTERNAL_ERROR;
+        if (!ctx->zstd_cctx) {
+            ERR("ZSTD_createCCtx failed.\n");
+            return STATUS_INTERNAL_ERROR;
+        }
     }
 
     params = ZSTD_getParams(level, inlen, 0);
@@ -823,47 +860,195 @@ NTSTATUS zstd_compress(uint8_t* inbuf, uint32_t inlen, uint8_t* outbuf, uint32_t
     if (params.cParams.windowLog > ZSTD_BTRFS_MAX_WINDOWLOG)
         params.cParams.windowLog = ZSTD_BTRFS_MAX_WINDOWLOG;
 
-    init_res = ZSTD_initCStream_advanced(stream, NULL, 0, params, inlen);
+    // The context keeps its tables between calls, and only reallocates them
+    // if these parameters need more space than it already has.
+    written = ZSTD_compress_advanced(ctx->zstd_cctx, outbuf, outlen, inbuf, inlen, NULL, 0, params);
 
-    if (ZSTD_isError(init_res)) {
-        ERR("ZSTD_initCStream_advanced failed: %s\n", ZSTD_getErrorName(init_res));
-        ZSTD_freeCStream(stream);
+    if (ZSTD_isError(written)) {
+        if (ZSTD_getErrorCode(written) == ZSTD_error_dstSize_tooSmall) { // output would be larger than input
+            *space_left = 0;
+            return STATUS_SUCCESS;
+        }
+
+        ERR("ZSTD_compress_advanced failed: %s\n", ZSTD_getErrorName(written));
         return STATUS_INTERNAL_ERROR;
     }
 
-    input.src = inbuf;
-    input.size = inlen;
-    input.pos = 0;
+    *space_left = outlen - (unsigned int)written;
 
-    output.dst = outbuf;
-    output.size = outlen;
-    output.pos = 0;
+    return STATUS_SUCCESS;
+}
 
-    while (input.pos < input.size && output.pos < output.size) {
-        written = ZSTD_compressStream(stream, &output, &input);
+void free_comp_context(comp_context* ctx) {
+    if (ctx->zlib_stream) {
+        deflateEnd(ctx->zlib_stream);
+        ExFreePool(ctx->zlib_stream);
+    }
 
-        if (ZSTD_isError(written)) {
-            ERR("ZSTD_compressStream failed: %s\n", ZSTD_getErrorName(written));
-            ZSTD_freeCStream(stream);
-            return STATUS_INTERNAL_ERROR;
+    if (ctx->zstd_cctx)
+        ZSTD_freeCCtx(ctx->zstd_cctx);
+
+    if (ctx->lzo_wrkmem)
+        ExFreePool(ctx->lzo_wrkmem);
+
+    if (ctx->lzo_buf)
+        ExFreePool(ctx->lzo_buf);
+
+    RtlZeroMemory(ctx, sizeof(comp_context));
+}
+
+// write_compressed runs some of its own jobs, so it needs a context too - take one from
+// the volume's pool rather than building the compressor state up again on every call
+comp_context* get_comp_context(device_extension* Vcb) {
+    comp_context* ctx = NULL;
+    KIRQL irql;
+
+    KeAcquireSpinLock(&Vcb->calcthreads.spinlock, &irql);
+
+    if (Vcb->calcthreads.comp_ctx_pool_count > 0) {
+        Vcb->calcthreads.comp_ctx_pool_count--;
+        ctx = Vcb->calcthreads.comp_ctx_pool[Vcb->calcthreads.comp_ctx_pool_count];
+    }
+
+    KeReleaseSpinLock(&Vcb->calcthreads.spinlock, irql);
+
+    if (ctx)
+        return ctx;
+
+    ctx = ExAllocatePoolWithTag(PagedPool, sizeof(comp_context), ALLOC_TAG);
+    if (!ctx) {
+        ERR("out of memory\n");
+        return NULL;
+    }
+
+    RtlZeroMemory(ctx, sizeof(comp_context));
+
+    return ctx;
+}
+
+void release_comp_context(device_extension* Vcb, comp_context* ctx) {
+    KIRQL irql;
+
+    KeAcquireSpinLock(&Vcb->calcthreads.spinlock, &irql);
+
+    if (Vcb->calcthreads.comp_ctx_pool_count < COMP_CONTEXT_POOL_SIZE) {
+        Vcb->calcthreads.comp_ctx_pool[Vcb->calcthreads.comp_ctx_pool_count] = ctx;
+        Vcb->calcthreads.comp_ctx_pool_count++;
+        ctx = NULL;
+    }
+
+    KeReleaseSpinLock(&Vcb->calcthreads.spinlock, irql);
+
+    if (ctx) {
+        free_comp_context(ctx);
+        ExFreePool(ctx);
+    }
+}
+
+void free_comp_context_pool(device_extension* Vcb) {
+    while (Vcb->calcthreads.comp_ctx_pool_count > 0) {
+        comp_context* ctx;
+
+        Vcb->calcthreads.comp_ctx_pool_count--;
+        ctx = Vcb->calcthreads.comp_ctx_pool[Vcb->calcthreads.comp_ctx_pool_count];
+
+        free_comp_context(ctx);
+        ExFreePool(ctx);
+    }
+}
+
+// Heuristic along the lines of the one in Linux (fs/btrfs/compression.c): look at
+// a sample of the data, and only bother compressing it if it's got few distinct
+// byte values or low entropy. Anything that's already compressed or encrypted
+// fails both tests, and we save ourselves running the compressor over 128 KB only
+// to throw the result away.
+
+#define HEURISTIC_SAMPLE_LEN        16
+#define HEURISTIC_SAMPLE_INTERVAL   256
+#define HEURISTIC_MIN_LEN           (16 * HEURISTIC_SAMPLE_INTERVAL)
+#define HEURISTIC_BYTE_SET_LOW      64
+#define HEURISTIC_BYTE_CORE_SET_HIGH 200
+#define HEURISTIC_ENTROPY_HIGH      80
+
+// floor(log2(n^4)), i.e. log2(n) in fixed point with two fractional bits
+static unsigned int ilog2_w(uint64_t n) {
+    unsigned int l = 0;
+
+    n = n * n * n * n;
+
+    while (n >>= 1) {
+        l++;
+    }
+
+    return l;
+}
+
+bool compression_worthwhile(const uint8_t* data, unsigned int len) {
+    uint32_t counts[256];
+    unsigned int sample_size = 0, byte_set = 0, entropy, i, j;
+    uint64_t entropy_sum = 0;
+    unsigned int sample_base;
+
+    if (len < HEURISTIC_MIN_LEN)
+        return true;
+
+    RtlZeroMemory(counts, sizeof(counts));
+
+    for (i = 0; i + HEURISTIC_SAMPLE_LEN <= len; i += HEURISTIC_SAMPLE_INTERVAL) {
+        for (j = 0; j < HEURISTIC_SAMPLE_LEN; j++) {
+            counts[data[i + j]]++;
         }
+
+        sample_size += HEURISTIC_SAMPLE_LEN;
     }
 
-    written = ZSTD_endStream(stream, &output);
-    if (ZSTD_isError(written)) {
-        ERR("ZSTD_endStream failed: %s\n", ZSTD_getErrorName(written));
-        ZSTD_freeCStream(stream);
-        return STATUS_INTERNAL_ERROR;
+    for (i = 0; i < 256; i++) {
+        if (counts[i] > 0)
+            byte_set++;
     }
 
-    ZSTD_freeCStream(stream);
+    // text and the like
+    if (byte_set < HEURISTIC_BYTE_SET_LOW)
+        return true;
 
-    if (input.pos < input.size) // output would be larger than input
-        *space_left = 0;
-    else
-        *space_left = output.size - output.pos;
+    // Shannon entropy as a percentage of the 8 bits per byte maximum
+    sample_base = ilog2_w(sample_size);
 
-    return STATUS_SUCCESS;
+    for (i = 0; i < 256; i++) {
+        if (counts[i] > 0)
+            entropy_sum += counts[i] * (sample_base - ilog2_w(counts[i]));
+    }
+
+    entropy = (unsigned int)((entropy_sum / sample_size) * 100 / ilog2_w(256));
+
+    if (entropy < HEURISTIC_ENTROPY_HIGH)
+        return true;
+
+    // High entropy can still be compressible if most of it comes from a core of
+    // a few byte values, so count how many of the most frequent ones it takes to
+    // cover 90% of the sample.
+
+    for (i = 1; i < 256; i++) {
+        uint32_t c = counts[i];
+
+        j = i;
+        while (j > 0 && counts[j - 1] < c) {
+            counts[j] = counts[j - 1];
+            j--;
+        }
+
+        counts[j] = c;
+    }
+
+    {
+        unsigned int covered = 0, threshold = sample_size * 90 / 100;
+
+        for (i = 0; i < 256 && covered < threshold; i++) {
+            covered += counts[i];
+        }
+    }
+
+    return i < HEURISTIC_BYTE_CORE_SET_HIGH;
 }
 
 typedef struct {
@@ -886,6 +1071,7 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
     LIST_ENTRY* le;
     uint64_t address, extaddr;
     void* csum = NULL;
+    comp_context* ctx;
 #ifdef __REACTOS__
     int32_t i2;
     uint32_t i3, j;
@@ -945,9 +1131,13 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
 
     Status = STATUS_SUCCESS;
 
+    // without a context, just wait for the calc threads to do all the work
+    ctx = get_comp_context(fcb->Vcb);
+
 #ifndef __REACTOS__
     for (int i = num_parts - 1; i >= 0; i--) {
-        calc_thread_main(fcb->Vcb, parts[i].cj);
+        if (ctx)
+            calc_thread_main(fcb->Vcb, parts[i].cj, ctx);
 
         KeWaitForSingleObject(&parts[i].cj->event, Executive, KernelMode, false, NULL);
 
@@ -956,7 +1146,8 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
     }
 #else
     for (i2 = num_parts - 1; i2 >= 0; i2--) {
-        calc_thread_main(fcb->Vcb, parts[i].cj);
+        if (ctx)
+            calc_thread_main(fcb->Vcb, parts[i2].cj, ctx);
 
         KeWaitForSingleObject(&parts[i2].cj->event, Executive, KernelMode, false, NULL);
 
@@ -965,6 +1156,9 @@ NTSTATUS write_compressed(fcb* fcb, uint64_t start_data, uint64_t end_data, void
     }
 #endif // __REACTOS__
 
+    if (ctx)
+        release_comp_context(fcb->Vcb, ctx);
+
     if (!NT_SUCCESS(Status)) {
         ERR("calc job returned %08lx\n", Status);
 
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct blake2b_state__;
+
+#ifdef _AMD64_
+void __stdcall calc_sha256_blocks_shani(uint32_t* h, const uint8_t* data, size_t blocks);
+void __stdcall blake2b_compress_ssse3(struct blake2b_state__* S, const uint8_t* block);
+#endif
+
+void __stdcall calc_sha256_blocks_sw(uint32_t* h, const uint8_t* data, size_t blocks);
+void __stdcall blake2b_compress_sw(struct blake2b_state__* S, const uint8_t* block);
+
+typedef void (__stdcall *sha256_blocks_func)(uint32_t* h, const uint8_t* data, size_t blocks);
+typedef void (__stdcall *blake2b_compress_func)(struct blake2b_state__* S, const uint8_t* block);
+
+extern sha256_blocks_func calc_sha256_blocks;
+extern blake2b_compress_func blake2b_compress;
@@ -3157,6 +3157,22 @@ static NTSTATUS query_uuid(device_extension* Vcb, void* data, ULONG length) {
     return STATUS_SUCCESS;
 }
 
+static NTSTATUS query_compression_stats(device_extension* Vcb, void* data, ULONG length) {
+    btrfs_compression_stats stats;
+    KIRQL irql;
+
+    if (!data || length < sizeof(btrfs_compression_stats))
+        return STATUS_BUFFER_OVERFLOW;
+
+    KeAcquireSpinLock(&Vcb->calcthreads.spinlock, &irql);
+    stats = Vcb->calcthreads.comp_stats;
+    KeReleaseSpinLock(&Vcb->calcthreads.spinlock, irql);
+
+    RtlCopyMemory(data, &stats, sizeof(btrfs_compression_stats));
+
+    return STATUS_SUCCESS;
+}
+
 static NTSTATUS reset_stats(device_extension* Vcb, void* data, ULONG length, KPROCESSOR_MODE processor_mode) {
     uint64_t devid;
     NTSTATUS Status;
@@ -5492,6 +5508,11 @@ NTSTATUS fsctl_request(PDEVICE_OBJECT DeviceObject, PIRP* Pirp, uint32_t type) {
             Status = query_uuid(DeviceObject->DeviceExtension, map_user_buffer(Irp, NormalPagePriority), IrpSp->Parameters.FileSystemControl.OutputBufferLength);
             break;
 
+        case FSCTL_BTRFS_GET_COMPRESSION_STATS:
+            Status = query_compression_stats(DeviceObject->DeviceExtension, map_user_buffer(Irp, NormalPagePriority),
+                                             IrpSp->Parameters.FileSystemControl.OutputBufferLength);
+            break;
+
         case FSCTL_BTRFS_START_SCRUB:
             Status = start_scrub(DeviceObject->DeviceExtension, Irp->RequestorMode);
             break;
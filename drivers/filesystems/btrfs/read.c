@@ -3311,7 +3311,7 @@ nextitem:
     while (!IsListEmpty(&calc_jobs)) {
         comp_calc_job* ccj = CONTAINING_RECORD(RemoveTailList(&calc_jobs), comp_calc_job, list_entry);
 
-        calc_thread_main(fcb->Vcb, ccj->cj);
+        calc_thread_main(fcb->Vcb, ccj->cj, NULL);
 
         KeWaitForSingleObject(&ccj->cj->event, Executive, KernelMode, false, NULL);
 
@@ -1,9 +1,10 @@
 #include <stdint.h>
 #include <string.h>
+#include "csum.h"
 
 // Public domain code from https://github.com/amosnier/sha-2
 
-// FIXME - x86 SHA extensions
+// The x86 SHA extensions version of the block function is in sha256-amd64.S
 
 #define CHUNK_SIZE 64
 #define TOTAL_LEN_LEN 8
@@ -116,42 +117,16 @@ static int calc_chunk(uint8_t chunk[CHUNK_SIZE], struct buffer_state * state)
 }
 
 /*
- * Limitations:
- * - Since input is a pointer in RAM, the data to hash should be in RAM, which could be a problem
- *   for large data sizes.
- * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support
- *   for bit string lengths that are not multiples of eight, and it really operates on arrays of bytes.
- *   In particular, the len parameter is a number of bytes.
+ * Runs the compression function over whole 64-byte blocks, updating the hash values in h.
  */
-void calc_sha256(uint8_t* hash, const void* input, size_t len)
+void __stdcall calc_sha256_blocks_sw(uint32_t* h, const uint8_t* data, size_t blocks)
 {
-	/*
-	 * Note 1: All integers (expect indexes) are 32-bit unsigned integers and addition is calculated modulo 2^32.
-	 * Note 2: For each round, there is one round constant k[i] and one entry in the message schedule array w[i], 0 = i = 63
-	 * Note 3: The compression function uses 8 working variables, a through h
-	 * Note 4: Big-endian convention is used when expressing the constants in this pseudocode,
-	 *     and when parsing message block data from bytes to words, for example,
-	 *     the first word of the input message "abc" after padding is 0x61626380
-	 */
-
-	/*
-	 * Initialize hash values:
-	 * (first 32 bits of the fractional parts of the square roots of the first 8 primes 2..19):
-	 */
-	uint32_t h[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
 	unsigned i, j;
 
-	/* 512-bit chunks is what we will operate on. */
-	uint8_t chunk[64];
-
-	struct buffer_state state;
-
-	init_buf_state(&state, input, len);
-
-	while (calc_chunk(chunk, &state)) {
+	while (blocks > 0) {
 		uint32_t ah[8];
 
-		const uint8_t *p = chunk;
+		const uint8_t *p = data;
 
 		/* Initialize working variables to current hash value: */
 		for (i = 0; i < 8; i++)
@@ -210,7 +185,54 @@ void calc_sha256(uint8_t* hash, const void* input, size_t len)
 		/* Add the compressed chunk to the current hash value: */
 		for (i = 0; i < 8; i++)
 			h[i] += ah[i];
+
+		data += CHUNK_SIZE;
+		blocks--;
 	}
+}
+
+sha256_blocks_func calc_sha256_blocks = calc_sha256_blocks_sw;
+
+/*
+ * Limitations:
+ * - Since input is a pointer in RAM, the data to hash should be in RAM, which could be a problem
+ *   for large data sizes.
+ * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support
+ *   for bit string lengths that are not multiples of eight, and it really operates on arrays of bytes.
+ *   In particular, the len parameter is a number of bytes.
+ */
+void calc_sha256(uint8_t* hash, const void* input, size_t len)
+{
+	/*
+	 * Note 1: All integers (expect indexes) are 32-bit unsigned integers and addition is calculated modulo 2^32.
+	 * Note 2: For each round, there is one round constant k[i] and one entry in the message schedule array w[i], 0 = i = 63
+	 * Note 3: The compression function uses 8 working variables, a through h
+	 * Note 4: Big-endian convention is used when expressing the constants in this pseudocode,
+	 *     and when parsing message block data from bytes to words, for example,
+	 *     the first word of the input message "abc" after padding is 0x61626380
+	 */
+
+	/*
+	 * Initialize hash values:
+	 * (first 32 bits of the fractional parts of the square roots of the first 8 primes 2..19):
+	 */
+	uint32_t h[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	size_t blocks = len / CHUNK_SIZE;
+	unsigned i, j;
+
+	/* 512-bit chunks is what we will operate on. */
+	uint8_t chunk[64];
+
+	struct buffer_state state;
+
+	/* Whole chunks straight from the input, only the padded tail goes through calc_chunk. */
+	calc_sha256_blocks(h, input, blocks);
+
+	init_buf_state(&state, (const uint8_t*)input + (blocks * CHUNK_SIZE), len - (blocks * CHUNK_SIZE));
+	state.total_len = len;
+
+	while (calc_chunk(chunk, &state))
+		calc_sha256_blocks(h, chunk, 1);
 
 	/* Produce the final hash value (big-endian): */
 	for (i = 0, j = 0; i < 8; i++)
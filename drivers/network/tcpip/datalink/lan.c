@@ -313,6 +313,7 @@ VOID LanReceiveWorker( PVOID Context ) {
     IP_PACKET IPPacket;
     BOOLEAN LegacyReceive;
     PIP_INTERFACE Interface;
+    NDIS_TCP_IP_CHECKSUM_PACKET_INFO ChecksumInfo;
 
     TI_DbgPrint(DEBUG_DATALINK, ("Called.\n"));
 
@@ -358,6 +359,16 @@ VOID LanReceiveWorker( PVOID Context ) {
 
         /* Calculate packet size (excluding media header) */
         NdisQueryPacketLength(IPPacket.NdisPacket, &IPPacket.TotalSize);
+
+        /* Don't verify again what the adapter already verified */
+        ChecksumInfo.Value = PtrToUlong(NDIS_PER_PACKET_INFO_FROM_PACKET(IPPacket.NdisPacket,
+                                                                        TcpIpChecksumPacketInfo));
+        if (ChecksumInfo.Receive.NdisPacketIpChecksumSucceeded)
+            IPPacket.Flags |= IP_PACKET_FLAG_IP_CHECKSUM_OK;
+        if (ChecksumInfo.Receive.NdisPacketTcpChecksumSucceeded)
+            IPPacket.Flags |= IP_PACKET_FLAG_TCP_CHECKSUM_OK;
+        if (ChecksumInfo.Receive.NdisPacketUdpChecksumSucceeded)
+            IPPacket.Flags |= IP_PACKET_FLAG_UDP_CHECKSUM_OK;
     }
 
     TI_DbgPrint
@@ -1006,6 +1017,10 @@ VOID LANTransmit(
 
     RtlCopyMemory(Data + Adapter->HeaderSize, OldData, OldSize);
 
+    /* Keep the checksum offload requested for the packet */
+    NDIS_PER_PACKET_INFO_FROM_PACKET(XmitPacket, TcpIpChecksumPacketInfo) =
+        NDIS_PER_PACKET_INFO_FROM_PACKET(NdisPacket, TcpIpChecksumPacketInfo);
+
     (*PC(NdisPacket)->DLComplete)(PC(NdisPacket)->Context, NdisPacket, NDIS_STATUS_SUCCESS);
 
     switch (Adapter->Media) {
@@ -1309,6 +1324,124 @@ VOID GetName( PUNICODE_STRING RegistryKey,
     AppendUnicodeString( OutName, &PartialRegistryKey, FALSE );
 }
 
+VOID LANEnableChecksumOffload(
+    PLAN_ADAPTER Adapter,
+    PIP_INTERFACE IF)
+/*
+ * FUNCTION: Enables the checksum offload supported by an adapter
+ * ARGUMENTS:
+ *     Adapter = Pointer to LAN_ADAPTER structure
+ *     IF      = Pointer to the IP interface of the adapter
+ * NOTES:
+ *     The transmit checksums the adapter will compute are stored in
+ *     IF->ChecksumOffload. Checksums verified on receive are reported
+ *     per packet, so nothing has to be remembered for those
+ */
+{
+    PNDIS_TASK_OFFLOAD_HEADER OffloadHeader;
+    PNDIS_TASK_OFFLOAD Task;
+    NDIS_TASK_TCP_IP_CHECKSUM Checksum;
+    NDIS_STATUS NdisStatus;
+    ULONG BufferSize = PAGE_SIZE;
+    ULONG Offset;
+    BOOLEAN Found = FALSE;
+
+    IF->ChecksumOffload = 0;
+
+    if (Adapter->Media != NdisMedium802_3)
+        return;
+
+    OffloadHeader = ExAllocatePoolWithTag(NonPagedPool, BufferSize, OFFLOAD_TAG);
+    if (!OffloadHeader)
+        return;
+
+    RtlZeroMemory(OffloadHeader, BufferSize);
+    OffloadHeader->Version = NDIS_TASK_OFFLOAD_VERSION;
+    OffloadHeader->Size = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+    OffloadHeader->EncapsulationFormat.Encapsulation = IEEE_802_3_Encapsulation;
+    OffloadHeader->EncapsulationFormat.Flags.FixedHeaderSize = 1;
+    OffloadHeader->EncapsulationFormat.EncapsulationHeaderSize = Adapter->HeaderSize;
+
+    /* Find out which tasks the miniport supports */
+    NdisStatus = NDISCall(Adapter,
+                          NdisRequestQueryInformation,
+                          OID_TCP_TASK_OFFLOAD,
+                          OffloadHeader,
+                          BufferSize);
+    if (NdisStatus != NDIS_STATUS_SUCCESS || !OffloadHeader->OffsetFirstTask) {
+        TI_DbgPrint(DEBUG_DATALINK, ("No task offload support (0x%X).\n", NdisStatus));
+        ExFreePoolWithTag(OffloadHeader, OFFLOAD_TAG);
+        return;
+    }
+
+    Offset = OffloadHeader->OffsetFirstTask;
+    while (Offset && Offset + FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) < BufferSize) {
+        Task = (PNDIS_TASK_OFFLOAD)((PUCHAR)OffloadHeader + Offset);
+
+        if (Task->Task == TcpIpChecksumNdisTask &&
+            Task->TaskBufferLength >= sizeof(NDIS_TASK_TCP_IP_CHECKSUM) &&
+            Offset + FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) + sizeof(NDIS_TASK_TCP_IP_CHECKSUM) <= BufferSize) {
+            RtlCopyMemory(&Checksum, Task->TaskBuffer, sizeof(Checksum));
+            Found = TRUE;
+            break;
+        }
+
+        /* OffsetNextTask is relative to the current task */
+        if (!Task->OffsetNextTask)
+            break;
+        Offset += Task->OffsetNextTask;
+    }
+
+    if (!Found) {
+        ExFreePoolWithTag(OffloadHeader, OFFLOAD_TAG);
+        return;
+    }
+
+    /* IPv6 is not supported by the stack and options are rare, so only
+       ask for the basic IPv4 checksums */
+    Checksum.V4Transmit.IpOptionsSupported = 0;
+    Checksum.V4Transmit.IpChecksum = 0;
+    Checksum.V4Receive.IpOptionsSupported = 0;
+    Checksum.V4Receive.TcpOptionsSupported = 0;
+    RtlZeroMemory(&Checksum.V6Transmit, sizeof(Checksum.V6Transmit));
+    RtlZeroMemory(&Checksum.V6Receive, sizeof(Checksum.V6Receive));
+
+    /* Enable the checksum task and nothing else */
+    OffloadHeader->OffsetFirstTask = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+    Task = (PNDIS_TASK_OFFLOAD)(OffloadHeader + 1);
+    Task->Version = NDIS_TASK_OFFLOAD_VERSION;
+    Task->Size = sizeof(NDIS_TASK_OFFLOAD);
+    Task->Task = TcpIpChecksumNdisTask;
+    Task->OffsetNextTask = 0;
+    Task->TaskBufferLength = sizeof(NDIS_TASK_TCP_IP_CHECKSUM);
+    RtlCopyMemory(Task->TaskBuffer, &Checksum, sizeof(Checksum));
+
+    NdisStatus = NDISCall(Adapter,
+                          NdisRequestSetInformation,
+                          OID_TCP_TASK_OFFLOAD,
+                          OffloadHeader,
+                          sizeof(NDIS_TASK_OFFLOAD_HEADER) +
+                          FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) +
+                          sizeof(NDIS_TASK_TCP_IP_CHECKSUM));
+
+    ExFreePoolWithTag(OffloadHeader, OFFLOAD_TAG);
+
+    if (NdisStatus != NDIS_STATUS_SUCCESS) {
+        TI_DbgPrint(DEBUG_DATALINK, ("Could not enable checksum offload (0x%X).\n", NdisStatus));
+        return;
+    }
+
+    /* The TCP options bit only matters on transmit, segments with options
+       are checksummed in software if the adapter can't handle them */
+    if (Checksum.V4Transmit.TcpChecksum && Checksum.V4Transmit.TcpOptionsSupported)
+        IF->ChecksumOffload |= IP_CHECKSUM_OFFLOAD_TCP;
+    if (Checksum.V4Transmit.UdpChecksum)
+        IF->ChecksumOffload |= IP_CHECKSUM_OFFLOAD_UDP;
+
+    TI_DbgPrint(DEBUG_DATALINK, ("Checksum offload 0x%x.\n", IF->ChecksumOffload));
+}
+
+
 BOOLEAN BindAdapter(
     PLAN_ADAPTER Adapter,
     PNDIS_STRING RegistryPath)
@@ -1410,6 +1543,9 @@ BOOLEAN BindAdapter(
     if (NdisStatus != NDIS_STATUS_SUCCESS)
         return FALSE;
 
+    /* Let the adapter compute checksums if it can */
+    LANEnableChecksumOffload(Adapter, IF);
+
     /* Register interface with IP layer */
     IPRegisterInterface(IF);
 
@@ -22,14 +22,32 @@ csum_partial(
   unsigned int sum);
 
 ULONG
-UDPv4ChecksumCalculate(
+IPv4PseudoHeaderSum(
   PIPv4_HEADER IPHeader,
-  PUCHAR PacketBuffer,
-  ULONG DataLength);
+  UCHAR Protocol,
+  ULONG Length);
+
+USHORT
+IPv4TransportChecksum(
+  PIPv4_HEADER IPHeader,
+  UCHAR Protocol,
+  PVOID Data,
+  ULONG Length);
+
+USHORT
+ChecksumUpdate(
+  USHORT Checksum,
+  USHORT OldValue,
+  USHORT NewValue);
+
+BOOLEAN
+ChecksumOffloadPacket(
+  PIP_INTERFACE Interface,
+  PIP_PACKET IPPacket,
+  ULONG Offload);
 
 #define IPv4Checksum(Data, Count, Seed)(~ChecksumFold(ChecksumCompute(Data, Count, Seed)))
 #define TCPv4Checksum(Data, Count, Seed)(~ChecksumFold(csum_partial(Data, Count, Seed)))
-//#define TCPv4Checksum(Data, Count, Seed)(~ChecksumFold(ChecksumCompute(Data, Count, Seed)))
 
 /*
  * Macro to check for a correct checksum
@@ -91,6 +91,12 @@ typedef struct _IP_PACKET {
 } IP_PACKET, *PIP_PACKET;
 
 #define IP_PACKET_FLAG_RAW      0x01    /* Raw IP packet */
+#define IP_PACKET_FLAG_IP_CHECKSUM_OK   0x02 /* Adapter verified the IPv4 header checksum */
+#define IP_PACKET_FLAG_TCP_CHECKSUM_OK  0x04 /* Adapter verified the TCP checksum */
+#define IP_PACKET_FLAG_UDP_CHECKSUM_OK  0x08 /* Adapter verified the UDP checksum */
+#define IP_PACKET_FLAG_CHECKSUM_OK      (IP_PACKET_FLAG_IP_CHECKSUM_OK | \
+                                         IP_PACKET_FLAG_TCP_CHECKSUM_OK | \
+                                         IP_PACKET_FLAG_UDP_CHECKSUM_OK)
 
 
 /* Packet context */
@@ -168,8 +174,12 @@ typedef struct _IP_INTERFACE {
     LL_TRANSMIT_ROUTINE Transmit; /* Pointer to transmit function */
     PVOID TCPContext;             /* TCP Content for this interface */
     SEND_RECV_STATS Stats;        /* Send/Receive statistics */
+    ULONG ChecksumOffload;        /* Checksums computed by the adapter on transmit (see IP_CHECKSUM_OFFLOAD_xx below) */
 } IP_INTERFACE, *PIP_INTERFACE;
 
+#define IP_CHECKSUM_OFFLOAD_TCP 0x01    /* TCP checksum over IPv4 */
+#define IP_CHECKSUM_OFFLOAD_UDP 0x02    /* UDP checksum over IPv4 */
+
 typedef struct _IP_SET_ADDRESS {
     ULONG NteIndex;
     IPv4_RAW_ADDRESS Address;
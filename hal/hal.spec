@@ -34,6 +34,7 @@
 ;@ stdcall -arch=x86_64 HalIsHyperThreadingEnabled()
 @ stdcall HalMakeBeep(long)
 @ stdcall HalProcessorIdle()
+@ stdcall -arch=i386,x86_64 HalProcessorIdleUntil(int64)
 @ stdcall HalQueryDisplayParameters(ptr ptr ptr ptr)
 @ stdcall HalQueryRealTimeClock(ptr)
 @ stdcall HalReadDmaCounter(ptr)
@@ -15,12 +15,18 @@
 
 extern LARGE_INTEGER HalpCpuClockFrequency;
 
+#define CPUID_TSC_DEADLINE 0x1000000 /* ECX bit 24 */
+
 /* HAL profiling variables */
 BOOLEAN HalIsProfiling = FALSE;
 ULONGLONG HalCurProfileInterval = 10000000;
 ULONGLONG HalMinProfileInterval = 1000;
 ULONGLONG HalMaxProfileInterval = 10000000;
 
+/* One-shot timer variables */
+BOOLEAN HalpApicTscDeadline;
+ULONG64 HalpApicTimerFrequency;
+
 /* TIMER FUNCTIONS ************************************************************/
 
 VOID
@@ -49,16 +55,112 @@ VOID
 NTAPI
 ApicInitializeTimer(ULONG Cpu)
 {
-
-    /* Initialize the TSC */
-    //HalpInitializeTsc();
+    LVT_REGISTER LvtEntry;
+    ULONG64 StartTime;
+    INT CpuInfo[4];
 
     /* Set clock multiplier to 1 */
     ApicWrite(APIC_TDCR, TIMER_DV_DivideBy1);
 
-    ApicSetTimerInterval(1000);
+    /* Check if the timer can fire at a given TSC value */
+    __cpuid(CpuInfo, 1);
+    if (CpuInfo[2] & CPUID_TSC_DEADLINE)
+    {
+        DPRINT("Using TSC deadline mode for the APIC timer\n");
+        HalpApicTscDeadline = TRUE;
+        return;
+    }
+
+    /* Otherwise we need to know how fast it counts. Let it count down
+       from the top while masked, so that it can't fire. */
+    LvtEntry.Long = 0;
+    LvtEntry.TimerMode = TIMER_MODE_OneShot;
+    LvtEntry.Vector = APIC_CLOCK_VECTOR;
+    LvtEntry.Mask = 1;
+    ApicWrite(APIC_TMRLVTR, LvtEntry.Long);
+    ApicWrite(APIC_TICR, 0xFFFFFFFF);
+
+    /* Let it count for 10 ms */
+    StartTime = __rdtsc();
+    while (__rdtsc() - StartTime < (ULONG64)HalpCpuClockFrequency.QuadPart / 100);
+    HalpApicTimerFrequency = (0xFFFFFFFFULL - ApicRead(APIC_TCCR)) * 100;
+
+    /* Stop it again */
+    ApicWrite(APIC_TICR, 0);
 
-// KeSetTimeIncrement
+    DPRINT("APIC timer frequency: %I64u\n", HalpApicTimerFrequency);
+}
+
+/*!
+    \brief Arms a one-shot timer interrupt on the clock vector.
+
+    \param Deadline - The TSC value at which the interrupt should fire.
+           A deadline that has already passed fires right away.
+
+    \return FALSE if the timer is not available, because it is in use
+            for profiling or could not be calibrated.
+*/
+BOOLEAN
+NTAPI
+ApicSetTimerDeadline(ULONG64 Deadline)
+{
+    LVT_REGISTER LvtEntry;
+    ULONG64 CurrentTime, Count;
+
+    /* The timer is also used for the profile interrupt */
+    if (HalIsProfiling) return FALSE;
+
+    LvtEntry.Long = 0;
+    LvtEntry.Vector = APIC_CLOCK_VECTOR;
+    LvtEntry.Mask = 0;
+
+    if (HalpApicTscDeadline)
+    {
+        /* The mode must be set before the deadline */
+        LvtEntry.TimerMode = TIMER_MODE_TscDeadline;
+        ApicWrite(APIC_TMRLVTR, LvtEntry.Long);
+        __writemsr(MSR_TSC_DEADLINE, max(Deadline, 1));
+        return TRUE;
+    }
+
+    if (HalpApicTimerFrequency == 0) return FALSE;
+
+    /* Convert the TSC interval into timer counts */
+    CurrentTime = __rdtsc();
+    Count = 1;
+    if (Deadline > CurrentTime)
+    {
+        Count = (Deadline - CurrentTime) * HalpApicTimerFrequency /
+                HalpCpuClockFrequency.QuadPart;
+        Count = min(max(Count, 1), 0xFFFFFFFF);
+    }
+
+    LvtEntry.TimerMode = TIMER_MODE_OneShot;
+    ApicWrite(APIC_TMRLVTR, LvtEntry.Long);
+    ApicWrite(APIC_TICR, (ULONG)Count);
+    return TRUE;
+}
+
+VOID
+NTAPI
+ApicCancelTimerDeadline(VOID)
+{
+    LVT_REGISTER LvtEntry;
+
+    /* Don't touch the profile interrupt */
+    if (HalIsProfiling) return;
+
+    /* A zero deadline or count stops the timer */
+    if (HalpApicTscDeadline)
+        __writemsr(MSR_TSC_DEADLINE, 0);
+    else
+        ApicWrite(APIC_TICR, 0);
+
+    /* Mask it */
+    LvtEntry.Long = 0;
+    LvtEntry.Vector = APIC_CLOCK_VECTOR;
+    LvtEntry.Mask = 1;
+    ApicWrite(APIC_TMRLVTR, LvtEntry.Long);
 }
 
 
@@ -8,6 +8,7 @@
 /* INCLUDES ******************************************************************/
 
 #include <hal.h>
+#include <apic.h>
 #define NDEBUG
 #include <debug.h>
 
@@ -62,6 +63,30 @@ HalProcessorIdle(VOID)
     __halt();
 }
 
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+HalProcessorIdleUntil(IN ULONGLONG DueTime)
+{
+    /* Stop the clock interrupt until the next timer is due */
+    if (!HalpStopClockInterrupt(DueTime))
+    {
+        HalProcessorIdle();
+        return;
+    }
+
+    /* Enable interrupts and halt the processor */
+    _enable();
+    __halt();
+
+    /* Get the clock going again, in case something else woke us up */
+    _disable();
+    HalpRestartClockInterrupt();
+    _enable();
+}
+
 /*
  * @implemented
  */
@@ -12,9 +12,18 @@
 /* INCLUDES *******************************************************************/
 
 #include <hal.h>
+#include <apic.h>
 #define NDEBUG
 #include <debug.h>
 
+extern LARGE_INTEGER HalpCpuClockFrequency;
+
+/* Don't bother stopping the clock for less than this */
+#define MIN_SKIPPED_TICKS 2
+
+/* Longest time the clock may be stopped, in 100ns units */
+#define MAX_SKIPPED_TIME 10000000
+
 /* GLOBALS ********************************************************************/
 
 const UCHAR HalpClockVector = 0xD1;
@@ -25,6 +34,11 @@ ULONG HalpCurrentTimeIncrement;
 static UCHAR RtcMinimumClockRate = 8;  /* Minimum rate  8: 256 Hz / 3.9 ms */
 static UCHAR RtcMaximumClockRate = 12; /* Maximum rate 12: 16 Hz / 62.5 ms */
 
+/* Tickless idle state */
+static BOOLEAN HalpClockSkipping;
+static ULONG64 HalpLastClockTsc;
+static ULONG64 HalpClockTscIncrement;
+
 /*!
     \brief Converts the CMOS RTC rate into the time increment in 100ns intervals.
 
@@ -68,6 +82,8 @@ RtcSetClockRate(UCHAR ClockRate)
     /* Update the global values */
     HalpCurrentRate = ClockRate;
     HalpCurrentTimeIncrement = RtcClockRateToIncrement(ClockRate);
+    HalpClockTscIncrement = HalpCpuClockFrequency.QuadPart *
+                            HalpCurrentTimeIncrement / 10000000;
 
     /* Acquire CMOS lock */
     HalpAcquireCmosSpinLock();
@@ -88,6 +104,108 @@ RtcSetClockRate(UCHAR ClockRate)
     HalpReleaseCmosSpinLock();
 }
 
+static
+VOID
+RtcSetPeriodicInterrupt(BOOLEAN Enable)
+{
+    UCHAR RegisterB;
+
+    /* Acquire CMOS lock */
+    HalpAcquireCmosSpinLock();
+
+    /* Change the periodic interrupt bit in register B. This only gates the
+       interrupt, the RTC keeps counting the periods in the background. */
+    RegisterB = HalpReadCmos(RTC_REGISTER_B);
+    if (Enable)
+        RegisterB |= RTC_REG_B_PI;
+    else
+        RegisterB &= ~RTC_REG_B_PI;
+    HalpWriteCmos(RTC_REGISTER_B, RegisterB);
+
+    /* Release CMOS lock */
+    HalpReleaseCmosSpinLock();
+}
+
+static
+ULONG
+HalpResumeClockTicks(VOID)
+{
+    ULONG64 Ticks;
+
+    /* Stop the one-shot timer, if it didn't fire already */
+    ApicCancelTimerDeadline();
+    HalpClockSkipping = FALSE;
+
+    /* Count the RTC periods that passed since the last interrupt. Advance
+       by whole periods, so that we stay in phase with the RTC. */
+    Ticks = (__rdtsc() - HalpLastClockTsc) / HalpClockTscIncrement;
+    HalpLastClockTsc += Ticks * HalpClockTscIncrement;
+
+    /* The next RTC interrupt comes right on time */
+    RtcSetPeriodicInterrupt(TRUE);
+
+    /* Return the time that passed */
+    return (ULONG)Ticks * HalpCurrentTimeIncrement;
+}
+
+/*!
+    \brief Stops the clock interrupt until a timer is due.
+
+    Called from the idle loop with interrupts disabled. Instead of the RTC,
+    the APIC timer fires once, when the tick at which the timer is checked
+    has passed. The clock interrupt then catches up on all skipped ticks.
+
+    \param DueTime - Interrupt time at which the next timer is due.
+
+    \return TRUE if the clock interrupt was stopped.
+*/
+BOOLEAN
+NTAPI
+HalpStopClockInterrupt(IN ULONGLONG DueTime)
+{
+    ULONGLONG InterruptTime, Interval, Ticks;
+
+    /* Not while the clock isn't set up yet or about to change its rate */
+    if ((HalpClockTscIncrement == 0) || HalpClockSetMSRate) return FALSE;
+
+    /* The interrupt time was last updated by the interrupt at HalpLastClockTsc */
+    InterruptTime = KeQueryInterruptTime();
+    if (DueTime <= InterruptTime) return FALSE;
+    Interval = min(DueTime - InterruptTime, MAX_SKIPPED_TIME);
+
+    /* Timers are only checked on ticks, so wake up on the tick after the
+       due time and check if we skip enough to be worth it */
+    Ticks = (Interval + HalpCurrentTimeIncrement - 1) / HalpCurrentTimeIncrement;
+    if (Ticks < MIN_SKIPPED_TICKS) return FALSE;
+
+    /* Fire a bit after the RTC period ends, so that it's counted for sure */
+    if (!ApicSetTimerDeadline(HalpLastClockTsc +
+                              Ticks * HalpClockTscIncrement +
+                              HalpClockTscIncrement / 8))
+    {
+        return FALSE;
+    }
+
+    /* Stop the RTC interrupt */
+    RtcSetPeriodicInterrupt(FALSE);
+    HalpClockSkipping = TRUE;
+    return TRUE;
+}
+
+/*!
+    \brief Restarts the clock interrupt after the idle loop woke up.
+
+    Called with interrupts disabled. If something else than the one-shot
+    timer woke us up, fire it right away, so that the system time catches
+    up before the woken thread looks at it.
+*/
+VOID
+NTAPI
+HalpRestartClockInterrupt(VOID)
+{
+    if (HalpClockSkipping) ApicSetTimerDeadline(0);
+}
+
 CODE_SEG("INIT")
 VOID
 NTAPI
@@ -122,6 +240,9 @@ HalpInitializeClock(VOID)
     KeSetTimeIncrement(RtcClockRateToIncrement(RtcMaximumClockRate),
                        RtcClockRateToIncrement(RtcMinimumClockRate));
 
+    /* Prepare the APIC timer for skipping clock ticks in the idle loop */
+    HalpLastClockTsc = __rdtsc();
+    ApicInitializeTimer(KeGetCurrentProcessorNumber());
 
     DPRINT1("Clock initialized\n");
 }
@@ -150,8 +271,18 @@ HalpClockInterruptHandler(IN PKTRAP_FRAME TrapFrame)
     /* Read register C, so that the next interrupt can happen */
     HalpReadCmos(RTC_REGISTER_C);
 
-    /* Save increment */
-    LastIncrement = HalpCurrentTimeIncrement;
+    /* Check if the idle loop stopped the clock */
+    if (HalpClockSkipping)
+    {
+        /* Catch up on all ticks we skipped */
+        LastIncrement = HalpResumeClockTicks();
+    }
+    else
+    {
+        /* Save increment */
+        LastIncrement = HalpCurrentTimeIncrement;
+        HalpLastClockTsc = __rdtsc();
+    }
 
     /* Check if someone changed the time rate */
     if (HalpClockSetMSRate)
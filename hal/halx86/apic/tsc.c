@@ -22,6 +22,9 @@ UCHAR HalpRtcClockVector = 0xD1;
 #define RTC_MODE 6 /* Mode 6 is 1024 Hz */
 #define SAMPLE_FREQENCY ((32768 << 1) >> RTC_MODE)
 
+#define CPUID_ADVANCED_POWER_MANAGEMENT 0x80000007
+#define CPUID_INVARIANT_TSC 0x100 /* EDX bit 8 */
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 static
@@ -117,6 +120,31 @@ HalpInitializeTsc(VOID)
 
 }
 
+static
+VOID
+HalpPublishUserTsc(VOID)
+{
+    INT CpuInfo[4];
+
+    /* The frequency doesn't change, so user mode can always read it */
+    SharedUserData->QpcFrequency = HalpCpuClockFrequency.QuadPart;
+    SharedUserData->QpcBias = 0;
+    SharedUserData->TscQpcShift = 0;
+
+    /* User mode can only read the TSC itself when it runs at a constant
+       rate in all P- and C-states. This HAL is UP, so it is in sync. */
+    __cpuid(CpuInfo, 0x80000000);
+    if ((ULONG)CpuInfo[0] < CPUID_ADVANCED_POWER_MANAGEMENT)
+        return;
+
+    __cpuid(CpuInfo, CPUID_ADVANCED_POWER_MANAGEMENT);
+    if (CpuInfo[3] & CPUID_INVARIANT_TSC)
+    {
+        DPRINT("Invariant TSC, enabling user mode performance counter\n");
+        SharedUserData->TscQpcEnabled = TRUE;
+    }
+}
+
 VOID
 NTAPI
 HalpCalibrateStallExecution(VOID)
@@ -126,6 +154,9 @@ HalpCalibrateStallExecution(VOID)
     HalpInitializeTsc();
 
     KeGetPcr()->StallScaleFactor = (ULONG)(HalpCpuClockFrequency.QuadPart / 1000000);
+
+    /* Let user mode query the counter without a system call */
+    HalpPublishUserTsc();
 }
 
 /* PUBLIC FUNCTIONS ***********************************************************/
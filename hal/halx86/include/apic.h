@@ -86,6 +86,7 @@
 #define APIC_EXT3LVTR 0x0530 /* Extended Interrupt 3 Local Vector Table */
 
 #define MSR_APIC_BASE 0x0000001B
+#define MSR_TSC_DEADLINE 0x000006E0
 #define IOAPIC_PHYS_BASE 0xFEC00000
 #define APIC_CLOCK_INDEX 8
 #define ApicLogicalId(Cpu) ((UCHAR)(1<< Cpu))
@@ -146,6 +147,14 @@ enum
     TIMER_DV_DivideBy1 = 11,
 };
 
+/* Timer Modes */
+enum
+{
+    TIMER_MODE_OneShot = 0,
+    TIMER_MODE_Periodic = 1,
+    TIMER_MODE_TscDeadline = 2,
+};
+
 #include <pshpack1.h>
 typedef union _APIC_BASE_ADRESS_REGISTER
 {
@@ -235,8 +244,8 @@ typedef union _LVT_REGISTER
         UINT32 RemoteIRR:1;
         UINT32 TriggerMode:1;
         UINT32 Mask:1;
-        UINT32 TimerMode:1;
-        UINT32 Reserved2MBZ:13;
+        UINT32 TimerMode:2;
+        UINT32 Reserved2MBZ:12;
     };
 } LVT_REGISTER;
 
@@ -298,6 +307,22 @@ VOID
 NTAPI
 ApicInitializeTimer(ULONG Cpu);
 
+BOOLEAN
+NTAPI
+ApicSetTimerDeadline(ULONG64 Deadline);
+
+VOID
+NTAPI
+ApicCancelTimerDeadline(VOID);
+
+BOOLEAN
+NTAPI
+HalpStopClockInterrupt(IN ULONGLONG DueTime);
+
+VOID
+NTAPI
+HalpRestartClockInterrupt(VOID);
+
 VOID
 NTAPI
 HalInitializeProfiling(VOID);
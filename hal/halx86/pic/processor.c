@@ -63,6 +63,17 @@ HalProcessorIdle(VOID)
     __halt();
 }
 
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+HalProcessorIdleUntil(IN ULONGLONG DueTime)
+{
+    /* The PIT keeps ticking, just idle */
+    HalProcessorIdle();
+}
+
 /*
  * @implemented
  */
@@ -0,0 +1,217 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and throughput benchmark for CopyFileExW
+ */
+
+#include "precomp.h"
+
+#ifndef COPY_FILE_NO_BUFFERING
+#define COPY_FILE_NO_BUFFERING 0x00001000
+#endif
+
+#define BENCHMARK_SIZE  (64 * 1024 * 1024)
+
+static WCHAR SourceName[MAX_PATH];
+static WCHAR DestName[MAX_PATH];
+static LARGE_INTEGER LastTransferred;
+
+static
+BYTE
+PatternByte(
+    _In_ ULONG Offset)
+{
+    return (BYTE)(Offset * 7 + (Offset >> 12));
+}
+
+static
+BOOL
+CreateSourceFile(
+    _In_ ULONG Size)
+{
+    BYTE Buffer[4096];
+    HANDLE File;
+    ULONG Offset, Length, i;
+    DWORD Written;
+
+    File = CreateFileW(SourceName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    for (Offset = 0; Offset < Size; Offset += Length)
+    {
+        Length = min(Size - Offset, sizeof(Buffer));
+        for (i = 0; i < Length; i++)
+            Buffer[i] = PatternByte(Offset + i);
+
+        if (!WriteFile(File, Buffer, Length, &Written, NULL) || Written != Length)
+        {
+            ok(0, "WriteFile failed with %lu\n", GetLastError());
+            CloseHandle(File);
+            return FALSE;
+        }
+    }
+
+    CloseHandle(File);
+    return TRUE;
+}
+
+static
+VOID
+CheckDestFile(
+    _In_ ULONG Size,
+    _In_ DWORD Flags)
+{
+    BYTE Buffer[4096];
+    HANDLE File;
+    ULONG Offset, i;
+    DWORD Read;
+    LARGE_INTEGER FileSize;
+
+    File = CreateFileW(DestName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    ok(File != INVALID_HANDLE_VALUE, "CreateFileW failed with %lu\n", GetLastError());
+    if (File == INVALID_HANDLE_VALUE)
+        return;
+
+    ok(GetFileSizeEx(File, &FileSize), "GetFileSizeEx failed with %lu\n", GetLastError());
+    ok(FileSize.QuadPart == Size, "Size %I64d, expected %lu (flags 0x%lx)\n", FileSize.QuadPart, Size, Flags);
+
+    for (Offset = 0; Offset < Size; Offset += Read)
+    {
+        if (!ReadFile(File, Buffer, sizeof(Buffer), &Read, NULL) || Read == 0)
+        {
+            ok(0, "ReadFile failed with %lu at %lu\n", GetLastError(), Offset);
+            break;
+        }
+
+        for (i = 0; i < Read; i++)
+        {
+            if (Buffer[i] != PatternByte(Offset + i))
+                break;
+        }
+        if (i < Read)
+        {
+            ok(0, "Data differs at %lu (size %lu, flags 0x%lx)\n", Offset + i, Size, Flags);
+            break;
+        }
+    }
+
+    CloseHandle(File);
+}
+
+static
+DWORD
+CALLBACK
+ProgressRoutine(
+    LARGE_INTEGER TotalFileSize,
+    LARGE_INTEGER TotalBytesTransferred,
+    LARGE_INTEGER StreamSize,
+    LARGE_INTEGER StreamBytesTransferred,
+    DWORD dwStreamNumber,
+    DWORD dwCallbackReason,
+    HANDLE hSourceFile,
+    HANDLE hDestinationFile,
+    LPVOID lpData)
+{
+    ok(TotalBytesTransferred.QuadPart >= LastTransferred.QuadPart,
+       "Progress went back from %I64d to %I64d\n",
+       LastTransferred.QuadPart, TotalBytesTransferred.QuadPart);
+    ok(TotalBytesTransferred.QuadPart <= TotalFileSize.QuadPart,
+       "Progress %I64d is past the size %I64d\n",
+       TotalBytesTransferred.QuadPart, TotalFileSize.QuadPart);
+
+    LastTransferred = TotalBytesTransferred;
+    return PROGRESS_CONTINUE;
+}
+
+static
+VOID
+TestCopy(
+    _In_ ULONG Size,
+    _In_ DWORD Flags)
+{
+    BOOL Ret;
+
+    if (!CreateSourceFile(Size))
+        return;
+
+    DeleteFileW(DestName);
+    LastTransferred.QuadPart = 0;
+    Ret = CopyFileExW(SourceName, DestName, ProgressRoutine, NULL, NULL, Flags);
+    ok(Ret, "CopyFileExW failed with %lu (size %lu, flags 0x%lx)\n", GetLastError(), Size, Flags);
+    ok(LastTransferred.QuadPart == Size, "Reported %I64d bytes, expected %lu\n", LastTransferred.QuadPart, Size);
+
+    CheckDestFile(Size, Flags);
+}
+
+static
+VOID
+TestExisting(VOID)
+{
+    BOOL Ret;
+
+    if (!CreateSourceFile(1000))
+        return;
+
+    /* Only COPY_FILE_FAIL_IF_EXISTS refuses to overwrite */
+    SetLastError(0xdeadbeef);
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_FAIL_IF_EXISTS);
+    ok(!Ret, "CopyFileExW succeeded\n");
+    ok_long(GetLastError(), ERROR_FILE_EXISTS);
+
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_NO_BUFFERING);
+    ok(Ret, "CopyFileExW failed with %lu\n", GetLastError());
+    CheckDestFile(1000, COPY_FILE_NO_BUFFERING);
+}
+
+static
+VOID
+Benchmark(
+    _In_ DWORD Flags)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    ULONGLONG Milliseconds;
+    BOOL Ret;
+
+    DeleteFileW(DestName);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, Flags);
+    QueryPerformanceCounter(&End);
+    ok(Ret, "CopyFileExW failed with %lu\n", GetLastError());
+
+    Milliseconds = (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+    trace("Copied %u MB in %I64u ms with flags 0x%lx, %I64u MB/s\n",
+          BENCHMARK_SIZE / (1024 * 1024), Milliseconds, Flags,
+          Milliseconds ? (ULONGLONG)BENCHMARK_SIZE / 1024 * 1000 / 1024 / Milliseconds : 0);
+}
+
+START_TEST(CopyFileEx)
+{
+    static const ULONG Sizes[] = { 0, 1, 511, 4096, 65535, 65536, 65537, 1000000, 3 * 1024 * 1024 + 123 };
+    WCHAR TempPath[MAX_PATH];
+    ULONG i;
+
+    GetTempPathW(ARRAYSIZE(TempPath), TempPath);
+    GetTempFileNameW(TempPath, L"cfs", 0, SourceName);
+    GetTempFileNameW(TempPath, L"cfd", 0, DestName);
+
+    for (i = 0; i < ARRAYSIZE(Sizes); i++)
+    {
+        TestCopy(Sizes[i], 0);
+        TestCopy(Sizes[i], COPY_FILE_NO_BUFFERING);
+    }
+
+    TestExisting();
+
+    if (CreateSourceFile(BENCHMARK_SIZE))
+    {
+        Benchmark(0);
+        Benchmark(COPY_FILE_NO_BUFFERING);
+    }
+
+    DeleteFileW(DestName);
+    DeleteFileW(SourceName);
+}
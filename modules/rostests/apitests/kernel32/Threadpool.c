@@ -0,0 +1,266 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and throughput benchmark for the Vista thread pool
+ */
+
+#include "precomp.h"
+
+#define TP_ITEMS    200000
+
+/* Vista+ functions, ReactOS keeps them in kernel32_vista */
+static PTP_POOL (WINAPI *pCreateThreadpool)(PVOID);
+static VOID (WINAPI *pCloseThreadpool)(PTP_POOL);
+static VOID (WINAPI *pSetThreadpoolThreadMaximum)(PTP_POOL, DWORD);
+static BOOL (WINAPI *pSetThreadpoolThreadMinimum)(PTP_POOL, DWORD);
+static PTP_WORK (WINAPI *pCreateThreadpoolWork)(PTP_WORK_CALLBACK, PVOID, PTP_CALLBACK_ENVIRON);
+static VOID (WINAPI *pSubmitThreadpoolWork)(PTP_WORK);
+static VOID (WINAPI *pWaitForThreadpoolWorkCallbacks)(PTP_WORK, BOOL);
+static VOID (WINAPI *pCloseThreadpoolWork)(PTP_WORK);
+static BOOL (WINAPI *pTrySubmitThreadpoolCallback)(PTP_SIMPLE_CALLBACK, PVOID, PTP_CALLBACK_ENVIRON);
+
+static volatile LONG CallbackCount;
+
+static
+VOID
+NTAPI
+CountCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context,
+    _Inout_ PTP_WORK Work)
+{
+    InterlockedIncrement(&CallbackCount);
+}
+
+static
+VOID
+NTAPI
+SimpleCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context)
+{
+    InterlockedIncrement(&CallbackCount);
+    SetEvent(Context);
+}
+
+static
+VOID
+NTAPI
+SlowCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context,
+    _Inout_ PTP_WORK Work)
+{
+    Sleep(1);
+    InterlockedIncrement(&CallbackCount);
+}
+
+static volatile LONG FanoutLeft;
+
+static
+VOID
+NTAPI
+FanoutCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_opt_ PVOID Context,
+    _Inout_ PTP_WORK Work)
+{
+    InterlockedIncrement(&CallbackCount);
+
+    /* Work posted from a callback stays with the worker until stolen */
+    if (InterlockedDecrement(&FanoutLeft) >= 0)
+    {
+        pSubmitThreadpoolWork(Work);
+        pSubmitThreadpoolWork(Work);
+    }
+}
+
+static
+BOOL
+InitFunctions(VOID)
+{
+    HMODULE Module;
+
+    Module = GetModuleHandleW(L"kernel32_vista.dll");
+    if (Module == NULL)
+        Module = LoadLibraryW(L"kernel32_vista.dll");
+    if (Module == NULL || GetProcAddress(Module, "CreateThreadpoolWork") == NULL)
+        Module = GetModuleHandleW(L"kernel32.dll");
+
+    pCreateThreadpool = (PVOID)GetProcAddress(Module, "CreateThreadpool");
+    pCloseThreadpool = (PVOID)GetProcAddress(Module, "CloseThreadpool");
+    pSetThreadpoolThreadMaximum = (PVOID)GetProcAddress(Module, "SetThreadpoolThreadMaximum");
+    pSetThreadpoolThreadMinimum = (PVOID)GetProcAddress(Module, "SetThreadpoolThreadMinimum");
+    pCreateThreadpoolWork = (PVOID)GetProcAddress(Module, "CreateThreadpoolWork");
+    pSubmitThreadpoolWork = (PVOID)GetProcAddress(Module, "SubmitThreadpoolWork");
+    pWaitForThreadpoolWorkCallbacks = (PVOID)GetProcAddress(Module, "WaitForThreadpoolWorkCallbacks");
+    pCloseThreadpoolWork = (PVOID)GetProcAddress(Module, "CloseThreadpoolWork");
+    pTrySubmitThreadpoolCallback = (PVOID)GetProcAddress(Module, "TrySubmitThreadpoolCallback");
+
+    return pCreateThreadpool && pCloseThreadpool &&
+           pSetThreadpoolThreadMaximum && pSetThreadpoolThreadMinimum &&
+           pCreateThreadpoolWork && pSubmitThreadpoolWork &&
+           pWaitForThreadpoolWorkCallbacks && pCloseThreadpoolWork &&
+           pTrySubmitThreadpoolCallback;
+}
+
+static
+VOID
+InitEnvironment(
+    _Out_ PTP_CALLBACK_ENVIRON Environment,
+    _In_ PTP_POOL Pool)
+{
+    /* Avoid the inline helpers, they need a Vista target */
+    ZeroMemory(Environment, sizeof(*Environment));
+    Environment->Version = 1;
+    Environment->Pool = Pool;
+}
+
+static
+VOID
+TestBasic(VOID)
+{
+    PTP_WORK Work;
+    HANDLE Event;
+    ULONG i;
+
+    CallbackCount = 0;
+    Work = pCreateThreadpoolWork(CountCallback, NULL, NULL);
+    ok(Work != NULL, "CreateThreadpoolWork failed with %lu\n", GetLastError());
+    if (Work == NULL)
+        return;
+
+    for (i = 0; i < 100; i++)
+        pSubmitThreadpoolWork(Work);
+    pWaitForThreadpoolWorkCallbacks(Work, FALSE);
+    ok_long(CallbackCount, 100);
+    pCloseThreadpoolWork(Work);
+
+    CallbackCount = 0;
+    Event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    ok(pTrySubmitThreadpoolCallback(SimpleCallback, Event, NULL),
+       "TrySubmitThreadpoolCallback failed with %lu\n", GetLastError());
+    ok_long(WaitForSingleObject(Event, 5000), WAIT_OBJECT_0);
+    ok_long(CallbackCount, 1);
+    CloseHandle(Event);
+}
+
+static
+VOID
+TestCancel(VOID)
+{
+    TP_CALLBACK_ENVIRON Environment;
+    PTP_POOL Pool;
+    PTP_WORK Work;
+    ULONG i;
+
+    Pool = pCreateThreadpool(NULL);
+    ok(Pool != NULL, "CreateThreadpool failed with %lu\n", GetLastError());
+    if (Pool == NULL)
+        return;
+
+    /* One slow thread, so most callbacks are still queued */
+    pSetThreadpoolThreadMaximum(Pool, 1);
+    InitEnvironment(&Environment, Pool);
+
+    CallbackCount = 0;
+    Work = pCreateThreadpoolWork(SlowCallback, NULL, &Environment);
+    ok(Work != NULL, "CreateThreadpoolWork failed with %lu\n", GetLastError());
+    if (Work != NULL)
+    {
+        for (i = 0; i < 200; i++)
+            pSubmitThreadpoolWork(Work);
+        Sleep(10);
+
+        pWaitForThreadpoolWorkCallbacks(Work, TRUE);
+        ok(CallbackCount < 200, "Expected cancelled callbacks, got %ld\n", CallbackCount);
+        pCloseThreadpoolWork(Work);
+    }
+
+    pCloseThreadpool(Pool);
+}
+
+static
+VOID
+TestThroughput(
+    _In_ ULONG Threads,
+    _In_ BOOL Fanout)
+{
+    TP_CALLBACK_ENVIRON Environment;
+    LARGE_INTEGER Frequency, Start, End;
+    PTP_POOL Pool;
+    PTP_WORK Work;
+    LONG Expected;
+    ULONG i;
+
+    Pool = pCreateThreadpool(NULL);
+    ok(Pool != NULL, "CreateThreadpool failed with %lu\n", GetLastError());
+    if (Pool == NULL)
+        return;
+
+    pSetThreadpoolThreadMaximum(Pool, Threads);
+    ok(pSetThreadpoolThreadMinimum(Pool, Threads),
+       "SetThreadpoolThreadMinimum failed with %lu\n", GetLastError());
+    InitEnvironment(&Environment, Pool);
+
+    CallbackCount = 0;
+    Work = pCreateThreadpoolWork(Fanout ? FanoutCallback : CountCallback, NULL, &Environment);
+    ok(Work != NULL, "CreateThreadpoolWork failed with %lu\n", GetLastError());
+    if (Work == NULL)
+    {
+        pCloseThreadpool(Pool);
+        return;
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    if (Fanout)
+    {
+        /* Every callback posts two more until the budget runs out */
+        FanoutLeft = TP_ITEMS / 2;
+        Expected = 2 * (TP_ITEMS / 2) + 1;
+        pSubmitThreadpoolWork(Work);
+        while (CallbackCount < Expected)
+            Sleep(1);
+    }
+    else
+    {
+        Expected = TP_ITEMS;
+        for (i = 0; i < TP_ITEMS; i++)
+            pSubmitThreadpoolWork(Work);
+    }
+
+    pWaitForThreadpoolWorkCallbacks(Work, FALSE);
+    QueryPerformanceCounter(&End);
+
+    ok_long(CallbackCount, Expected);
+    trace("%s, %lu threads: %ld items in %I64u ms\n",
+          Fanout ? "Fan-out" : "Posted", Threads, CallbackCount,
+          (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart);
+
+    pCloseThreadpoolWork(Work);
+    pCloseThreadpool(Pool);
+}
+
+START_TEST(Threadpool)
+{
+    SYSTEM_INFO SystemInfo;
+    ULONG Threads;
+
+    if (!InitFunctions())
+    {
+        skip("Thread pool functions are not available\n");
+        return;
+    }
+
+    TestBasic();
+    TestCancel();
+
+    GetSystemInfo(&SystemInfo);
+    for (Threads = 1; Threads <= max(SystemInfo.dwNumberOfProcessors, 4); Threads *= 2)
+    {
+        TestThroughput(Threads, FALSE);
+        TestThroughput(Threads, TRUE);
+    }
+}
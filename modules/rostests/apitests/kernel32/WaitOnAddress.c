@@ -0,0 +1,197 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and ping-pong latency benchmark for WaitOnAddress
+ */
+
+#include "precomp.h"
+
+#define PING_PONG_ROUNDS    100000
+#define WAKE_ALL_THREADS    8
+
+/* Windows 8+ functions, ReactOS keeps them in kernel32_vista */
+static BOOL (WINAPI *pWaitOnAddress)(volatile VOID *, PVOID, SIZE_T, DWORD);
+static VOID (WINAPI *pWakeByAddressAll)(PVOID);
+static VOID (WINAPI *pWakeByAddressSingle)(PVOID);
+
+static volatile LONG Turn;
+static volatile LONG Flag;
+static volatile LONG WokenCount;
+
+static
+BOOL
+InitFunctions(VOID)
+{
+    HMODULE Module;
+
+    Module = LoadLibraryW(L"kernel32_vista.dll");
+    if (Module == NULL || GetProcAddress(Module, "WaitOnAddress") == NULL)
+        Module = LoadLibraryW(L"api-ms-win-core-synch-l1-2-0.dll");
+    if (Module == NULL)
+        return FALSE;
+
+    pWaitOnAddress = (PVOID)GetProcAddress(Module, "WaitOnAddress");
+    pWakeByAddressAll = (PVOID)GetProcAddress(Module, "WakeByAddressAll");
+    pWakeByAddressSingle = (PVOID)GetProcAddress(Module, "WakeByAddressSingle");
+
+    return pWaitOnAddress && pWakeByAddressAll && pWakeByAddressSingle;
+}
+
+static
+VOID
+WaitForTurn(
+    _In_ LONG Expected)
+{
+    LONG Current;
+
+    /* WaitOnAddress may return early, so always check again */
+    for (;;)
+    {
+        Current = Turn;
+        if (Current == Expected)
+            break;
+        pWaitOnAddress(&Turn, &Current, sizeof(Turn), INFINITE);
+    }
+}
+
+static
+DWORD
+WINAPI
+PongThread(
+    _In_ LPVOID Parameter)
+{
+    LONG i;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    for (i = 0; i < PING_PONG_ROUNDS; i++)
+    {
+        WaitForTurn(2 * i + 1);
+        Turn = 2 * i + 2;
+        pWakeByAddressSingle((PVOID)&Turn);
+    }
+    return 0;
+}
+
+static
+DWORD
+WINAPI
+WaiterThread(
+    _In_ LPVOID Parameter)
+{
+    LONG Zero = 0;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    while (Flag == 0)
+        pWaitOnAddress(&Flag, &Zero, sizeof(Flag), INFINITE);
+
+    InterlockedIncrement(&WokenCount);
+    return 0;
+}
+
+static
+VOID
+TestBasic(VOID)
+{
+    LONG Value = 5, Compare = 6;
+    LONGLONG Value64 = 1, Compare64 = 1;
+    DWORD Start;
+    BOOL Ret;
+
+    /* Different values return right away */
+    Ret = pWaitOnAddress(&Value, &Compare, sizeof(Value), INFINITE);
+    ok(Ret, "WaitOnAddress failed with %lu\n", GetLastError());
+
+    Compare = 5;
+    SetLastError(0xdeadbeef);
+    Start = GetTickCount();
+    Ret = pWaitOnAddress(&Value, &Compare, sizeof(Value), 50);
+    ok(!Ret, "WaitOnAddress succeeded\n");
+    ok_long(GetLastError(), ERROR_TIMEOUT);
+    ok(GetTickCount() - Start >= 40, "Returned after %lu ms\n", GetTickCount() - Start);
+
+    SetLastError(0xdeadbeef);
+    Ret = pWaitOnAddress(&Value64, &Compare64, sizeof(Value64), 0);
+    ok(!Ret, "WaitOnAddress succeeded\n");
+    ok_long(GetLastError(), ERROR_TIMEOUT);
+
+    /* Waking without waiters is fine */
+    pWakeByAddressSingle(&Value);
+    pWakeByAddressAll(&Value);
+}
+
+static
+VOID
+TestWakeAll(VOID)
+{
+    HANDLE Threads[WAKE_ALL_THREADS];
+    ULONG i;
+
+    Flag = 0;
+    WokenCount = 0;
+    for (i = 0; i < WAKE_ALL_THREADS; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, WaiterThread, NULL, 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    Sleep(100);
+    ok_long(WokenCount, 0);
+
+    Flag = 1;
+    pWakeByAddressAll((PVOID)&Flag);
+
+    ok_long(WaitForMultipleObjects(WAKE_ALL_THREADS, Threads, TRUE, 5000), WAIT_OBJECT_0);
+    ok_long(WokenCount, WAKE_ALL_THREADS);
+
+    for (i = 0; i < WAKE_ALL_THREADS; i++)
+        CloseHandle(Threads[i]);
+}
+
+static
+VOID
+TestPingPong(VOID)
+{
+    LARGE_INTEGER Frequency, Start, End;
+    HANDLE Thread;
+    LONG i;
+
+    Turn = 0;
+    Thread = CreateThread(NULL, 0, PongThread, NULL, 0, NULL);
+    ok(Thread != NULL, "CreateThread failed with %lu\n", GetLastError());
+    if (Thread == NULL)
+        return;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+
+    for (i = 0; i < PING_PONG_ROUNDS; i++)
+    {
+        Turn = 2 * i + 1;
+        pWakeByAddressSingle((PVOID)&Turn);
+        WaitForTurn(2 * i + 2);
+    }
+
+    QueryPerformanceCounter(&End);
+    ok_long(WaitForSingleObject(Thread, 5000), WAIT_OBJECT_0);
+    CloseHandle(Thread);
+
+    trace("Ping-pong: %d rounds in %I64u ms, %I64u ns per round trip\n",
+          PING_PONG_ROUNDS,
+          (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart,
+          (End.QuadPart - Start.QuadPart) * 1000000000 / Frequency.QuadPart / PING_PONG_ROUNDS);
+}
+
+START_TEST(WaitOnAddress)
+{
+    if (!InitFunctions())
+    {
+        skip("WaitOnAddress is not available\n");
+        return;
+    }
+
+    TestBasic();
+    TestWakeAll();
+    TestPingPong();
+}
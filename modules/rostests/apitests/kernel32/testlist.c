@@ -5,6 +5,7 @@
 
 extern void func_ActCtxWithXmlNamespaces(void);
 extern void func_ConsoleCP(void);
+extern void func_CopyFileEx(void);
 extern void func_CreateProcess(void);
 extern void func_DefaultActCtx(void);
 extern void func_DeviceIoControl(void);
@@ -34,12 +35,15 @@ extern void func_SetCurrentDirectory(void);
 extern void func_SetUnhandledExceptionFilter(void);
 extern void func_SystemFirmware(void);
 extern void func_TerminateProcess(void);
+extern void func_Threadpool(void);
 extern void func_TunnelCache(void);
+extern void func_WaitOnAddress(void);
 extern void func_WideCharToMultiByte(void);
 
 const struct test winetest_testlist[] =
 {
     { "ConsoleCP",                   func_ConsoleCP },
+    { "CopyFileEx",                  func_CopyFileEx },
     { "CreateProcess",               func_CreateProcess },
     { "DefaultActCtx",               func_DefaultActCtx },
     { "DeviceIoControl",             func_DeviceIoControl },
@@ -69,7 +73,9 @@ const struct test winetest_testlist[] =
     { "SetUnhandledExceptionFilter", func_SetUnhandledExceptionFilter },
     { "SystemFirmware",              func_SystemFirmware },
     { "TerminateProcess",            func_TerminateProcess },
+    { "Threadpool",                  func_Threadpool },
     { "TunnelCache",                 func_TunnelCache },
+    { "WaitOnAddress",               func_WaitOnAddress },
     { "WideCharToMultiByte",         func_WideCharToMultiByte },
     { "ActCtxWithXmlNamespaces",     func_ActCtxWithXmlNamespaces },
     { 0, 0 }
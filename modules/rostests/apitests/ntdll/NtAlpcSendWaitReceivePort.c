@@ -0,0 +1,717 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests and round-trip latency benchmark for ALPC ports
+ */
+
+#include "precomp.h"
+
+#include <process.h>
+
+#define TEST_CONNECTION_SIGNATURE   0xaabb0125
+#define TEST_VIEW_REQUEST           0x4455cd01
+#define TEST_VIEW_REPLY             0x4455cd02
+#define TEST_BENCHMARK              0x4455cd03
+#define TEST_QUIT                   0x4455cd04
+
+#define TEST_VIEW_SIZE              0x10000
+#define ROUND_TRIPS                 20000
+
+typedef struct _TEST_MESSAGE
+{
+    PORT_MESSAGE Header;
+    ULONG Value;
+} TEST_MESSAGE, *PTEST_MESSAGE;
+
+/* Laid out the way the attribute flags order them */
+typedef struct _TEST_ATTRIBUTES
+{
+    ALPC_MESSAGE_ATTRIBUTES Header;
+    ALPC_DATA_VIEW_ATTR View;
+    ALPC_CONTEXT_ATTR Context;
+} TEST_ATTRIBUTES, *PTEST_ATTRIBUTES;
+
+typedef struct _TEST_VIEW_ATTRIBUTES
+{
+    ALPC_MESSAGE_ATTRIBUTES Header;
+    ALPC_DATA_VIEW_ATTR View;
+} TEST_VIEW_ATTRIBUTES, *PTEST_VIEW_ATTRIBUTES;
+
+static UNICODE_STRING AlpcPortName = RTL_CONSTANT_STRING(L"\\NtdllApitestNtAlpcSendWaitReceivePortAlpc");
+static UNICODE_STRING LpcPortName = RTL_CONSTANT_STRING(L"\\NtdllApitestNtAlpcSendWaitReceivePortLpc");
+static UCHAR Context;
+
+/* Vista+ functions */
+static NTSTATUS (NTAPI *pNtAlpcAcceptConnectPort)(PHANDLE, HANDLE, ULONG, POBJECT_ATTRIBUTES, PALPC_PORT_ATTRIBUTES, PVOID, PPORT_MESSAGE, PALPC_MESSAGE_ATTRIBUTES, BOOLEAN);
+static NTSTATUS (NTAPI *pNtAlpcConnectPort)(PHANDLE, PUNICODE_STRING, POBJECT_ATTRIBUTES, PALPC_PORT_ATTRIBUTES, ULONG, PSID, PPORT_MESSAGE, PSIZE_T, PALPC_MESSAGE_ATTRIBUTES, PALPC_MESSAGE_ATTRIBUTES, PLARGE_INTEGER);
+static NTSTATUS (NTAPI *pNtAlpcCreatePort)(PHANDLE, POBJECT_ATTRIBUTES, PALPC_PORT_ATTRIBUTES);
+static NTSTATUS (NTAPI *pNtAlpcCreatePortSection)(HANDLE, ULONG, HANDLE, SIZE_T, PALPC_HANDLE, PSIZE_T);
+static NTSTATUS (NTAPI *pNtAlpcCreateSectionView)(HANDLE, ULONG, PALPC_DATA_VIEW_ATTR);
+static NTSTATUS (NTAPI *pNtAlpcDeletePortSection)(HANDLE, ULONG, ALPC_HANDLE);
+static NTSTATUS (NTAPI *pNtAlpcDeleteSectionView)(HANDLE, ULONG, PVOID);
+static NTSTATUS (NTAPI *pNtAlpcSendWaitReceivePort)(HANDLE, ULONG, PPORT_MESSAGE, PALPC_MESSAGE_ATTRIBUTES, PPORT_MESSAGE, PSIZE_T, PALPC_MESSAGE_ATTRIBUTES, PLARGE_INTEGER);
+static ULONG (NTAPI *pAlpcGetHeaderSize)(ULONG);
+static PVOID (NTAPI *pAlpcGetMessageAttribute)(PALPC_MESSAGE_ATTRIBUTES, ULONG);
+static NTSTATUS (NTAPI *pAlpcInitializeMessageAttribute)(ULONG, PALPC_MESSAGE_ATTRIBUTES, ULONG, PULONG);
+static ULONG (NTAPI *pAlpcMaxAllowedMessageLength)(VOID);
+
+static
+BOOLEAN
+InitFunctions(VOID)
+{
+    HMODULE Module = GetModuleHandleW(L"ntdll.dll");
+
+    pNtAlpcAcceptConnectPort = (PVOID)GetProcAddress(Module, "NtAlpcAcceptConnectPort");
+    pNtAlpcConnectPort = (PVOID)GetProcAddress(Module, "NtAlpcConnectPort");
+    pNtAlpcCreatePort = (PVOID)GetProcAddress(Module, "NtAlpcCreatePort");
+    pNtAlpcCreatePortSection = (PVOID)GetProcAddress(Module, "NtAlpcCreatePortSection");
+    pNtAlpcCreateSectionView = (PVOID)GetProcAddress(Module, "NtAlpcCreateSectionView");
+    pNtAlpcDeletePortSection = (PVOID)GetProcAddress(Module, "NtAlpcDeletePortSection");
+    pNtAlpcDeleteSectionView = (PVOID)GetProcAddress(Module, "NtAlpcDeleteSectionView");
+    pNtAlpcSendWaitReceivePort = (PVOID)GetProcAddress(Module, "NtAlpcSendWaitReceivePort");
+    pAlpcGetHeaderSize = (PVOID)GetProcAddress(Module, "AlpcGetHeaderSize");
+    pAlpcGetMessageAttribute = (PVOID)GetProcAddress(Module, "AlpcGetMessageAttribute");
+    pAlpcInitializeMessageAttribute = (PVOID)GetProcAddress(Module, "AlpcInitializeMessageAttribute");
+    pAlpcMaxAllowedMessageLength = (PVOID)GetProcAddress(Module, "AlpcMaxAllowedMessageLength");
+
+    return pNtAlpcAcceptConnectPort && pNtAlpcConnectPort && pNtAlpcCreatePort &&
+           pNtAlpcCreatePortSection && pNtAlpcCreateSectionView &&
+           pNtAlpcDeletePortSection && pNtAlpcDeleteSectionView &&
+           pNtAlpcSendWaitReceivePort && pAlpcGetHeaderSize &&
+           pAlpcGetMessageAttribute && pAlpcInitializeMessageAttribute &&
+           pAlpcMaxAllowedMessageLength;
+}
+
+static
+VOID
+InitMessage(
+    _Out_ PTEST_MESSAGE Message,
+    _In_ ULONG Value)
+{
+    RtlZeroMemory(&Message->Header, sizeof(Message->Header));
+    Message->Header.u1.s1.TotalLength = sizeof(*Message);
+    Message->Header.u1.s1.DataLength = sizeof(Message->Value);
+    Message->Value = Value;
+}
+
+static
+VOID
+InitAttributes(
+    _Out_ PTEST_ATTRIBUTES Attributes)
+{
+    ULONG RequiredSize;
+    NTSTATUS Status;
+
+    RtlFillMemory(Attributes, sizeof(*Attributes), 0x55);
+    Status = pAlpcInitializeMessageAttribute(ALPC_MESSAGE_VIEW_ATTRIBUTE | ALPC_MESSAGE_CONTEXT_ATTRIBUTE,
+                                             &Attributes->Header,
+                                             sizeof(*Attributes),
+                                             &RequiredSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+}
+
+static
+VOID
+FillPattern(
+    _Out_writes_bytes_(Size) PUCHAR Buffer,
+    _In_ SIZE_T Size,
+    _In_ UCHAR Seed)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+        Buffer[i] = (UCHAR)(i * 7 + Seed);
+}
+
+static
+BOOLEAN
+CheckPattern(
+    _In_reads_bytes_(Size) PUCHAR Buffer,
+    _In_ SIZE_T Size,
+    _In_ UCHAR Seed)
+{
+    SIZE_T i;
+
+    for (i = 0; i < Size; i++)
+    {
+        if (Buffer[i] != (UCHAR)(i * 7 + Seed))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+NTSTATUS
+CreateView(
+    _In_ HANDLE PortHandle,
+    _Out_ PALPC_DATA_VIEW_ATTR View)
+{
+    SIZE_T ActualSize;
+    NTSTATUS Status;
+
+    RtlZeroMemory(View, sizeof(*View));
+    Status = pNtAlpcCreatePortSection(PortHandle,
+                                      0,
+                                      NULL,
+                                      TEST_VIEW_SIZE,
+                                      &View->SectionHandle,
+                                      &ActualSize);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return Status;
+    ok(ActualSize >= TEST_VIEW_SIZE, "ActualSize = %Iu\n", ActualSize);
+
+    View->ViewSize = TEST_VIEW_SIZE;
+    Status = pNtAlpcCreateSectionView(PortHandle, 0, View);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        pNtAlpcDeletePortSection(PortHandle, 0, View->SectionHandle);
+        return Status;
+    }
+    ok(View->ViewBase != NULL, "ViewBase = NULL\n");
+    ok(View->ViewSize >= TEST_VIEW_SIZE, "ViewSize = %Iu\n", View->ViewSize);
+
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+DeleteView(
+    _In_ HANDLE PortHandle,
+    _In_ PALPC_DATA_VIEW_ATTR View)
+{
+    NTSTATUS Status;
+
+    Status = pNtAlpcDeleteSectionView(PortHandle, 0, View->ViewBase);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    Status = pNtAlpcDeletePortSection(PortHandle, 0, View->SectionHandle);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+}
+
+static
+VOID
+ReplyWithView(
+    _In_ HANDLE PortHandle,
+    _Inout_ PTEST_MESSAGE Message,
+    _In_ PTEST_ATTRIBUTES Attributes)
+{
+    TEST_VIEW_ATTRIBUTES SendAttributes;
+    NTSTATUS Status;
+
+    /* The request came with the client's pages mapped in */
+    ok(Attributes->Header.ValidAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE,
+       "ValidAttributes = %lx\n", Attributes->Header.ValidAttributes);
+    if (Attributes->Header.ValidAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE)
+    {
+        ok(Attributes->View.ViewSize >= TEST_VIEW_SIZE, "ViewSize = %Iu\n", Attributes->View.ViewSize);
+        ok(CheckPattern(Attributes->View.ViewBase, TEST_VIEW_SIZE, 0x11), "Wrong request data\n");
+        Status = pNtAlpcDeleteSectionView(PortHandle, 0, Attributes->View.ViewBase);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    /* Send a view of our own back */
+    SendAttributes.Header.AllocatedAttributes = ALPC_MESSAGE_VIEW_ATTRIBUTE;
+    SendAttributes.Header.ValidAttributes = ALPC_MESSAGE_VIEW_ATTRIBUTE;
+    Status = CreateView(PortHandle, &SendAttributes.View);
+    if (!NT_SUCCESS(Status))
+        SendAttributes.Header.ValidAttributes = 0;
+    else
+        FillPattern(SendAttributes.View.ViewBase, TEST_VIEW_SIZE, 0x22);
+
+    Message->Value = TEST_VIEW_REPLY;
+    Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                        ALPC_MSGFLG_REPLY_MESSAGE,
+                                        &Message->Header,
+                                        &SendAttributes.Header,
+                                        NULL,
+                                        NULL,
+                                        NULL,
+                                        NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    if (SendAttributes.Header.ValidAttributes)
+        DeleteView(PortHandle, &SendAttributes.View);
+}
+
+static
+UINT
+CALLBACK
+AlpcServerThread(
+    _Inout_ PVOID Parameter)
+{
+    HANDLE ServerPortHandle = Parameter, PortHandle = NULL;
+    TEST_ATTRIBUTES Attributes;
+    TEST_MESSAGE Message;
+    PTEST_MESSAGE Reply = NULL;
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    for (;;)
+    {
+        InitAttributes(&Attributes);
+        Length = sizeof(Message);
+        Status = pNtAlpcSendWaitReceivePort(ServerPortHandle,
+                                            0,
+                                            Reply ? &Reply->Header : NULL,
+                                            NULL,
+                                            &Message.Header,
+                                            &Length,
+                                            &Attributes.Header,
+                                            NULL);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        if (Status != STATUS_SUCCESS)
+            break;
+        Reply = NULL;
+
+        if (Message.Header.u2.s2.Type == LPC_CONNECTION_REQUEST)
+        {
+            ok(Message.Value == TEST_CONNECTION_SIGNATURE, "Value = %lx\n", Message.Value);
+            Status = pNtAlpcAcceptConnectPort(&PortHandle,
+                                              ServerPortHandle,
+                                              0,
+                                              NULL,
+                                              NULL,
+                                              &Context,
+                                              &Message.Header,
+                                              NULL,
+                                              TRUE);
+            ok_ntstatus(Status, STATUS_SUCCESS);
+            continue;
+        }
+
+        if ((Message.Header.u2.s2.Type & 0xFF) != LPC_REQUEST)
+            continue;
+
+        if (Message.Value != TEST_BENCHMARK)
+        {
+            ok(Length == sizeof(Message), "Length = %Iu\n", Length);
+            ok(Attributes.Header.ValidAttributes & ALPC_MESSAGE_CONTEXT_ATTRIBUTE,
+               "ValidAttributes = %lx\n", Attributes.Header.ValidAttributes);
+            ok(Attributes.Context.PortContext == &Context,
+               "PortContext = %p\n", Attributes.Context.PortContext);
+            ok(Attributes.Context.MessageId == Message.Header.MessageId,
+               "MessageId = %lu, expected %lu\n",
+               Attributes.Context.MessageId, Message.Header.MessageId);
+        }
+
+        if (Message.Value == TEST_VIEW_REQUEST)
+        {
+            ReplyWithView(ServerPortHandle, &Message, &Attributes);
+            continue;
+        }
+
+        if (Message.Value == TEST_QUIT)
+        {
+            Status = pNtAlpcSendWaitReceivePort(ServerPortHandle,
+                                                ALPC_MSGFLG_REPLY_MESSAGE,
+                                                &Message.Header,
+                                                NULL,
+                                                NULL,
+                                                NULL,
+                                                NULL,
+                                                NULL);
+            ok_ntstatus(Status, STATUS_SUCCESS);
+            break;
+        }
+
+        /* Reply and wait for the next request in one call */
+        Message.Value++;
+        Reply = &Message;
+    }
+
+    if (PortHandle)
+        NtClose(PortHandle);
+    return 0;
+}
+
+static
+UINT
+CALLBACK
+LpcServerThread(
+    _Inout_ PVOID Parameter)
+{
+    HANDLE ServerPortHandle = Parameter, PortHandle;
+    TEST_MESSAGE Message;
+    PTEST_MESSAGE Reply = NULL;
+    NTSTATUS Status;
+
+    Status = NtListenPort(ServerPortHandle, &Message.Header);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    Status = NtAcceptConnectPort(&PortHandle, &Context, &Message.Header, TRUE, NULL, NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return 0;
+    Status = NtCompleteConnectPort(PortHandle);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    for (;;)
+    {
+        Status = NtReplyWaitReceivePort(PortHandle,
+                                        NULL,
+                                        Reply ? &Reply->Header : NULL,
+                                        &Message.Header);
+        if (Status != STATUS_SUCCESS)
+            break;
+        Reply = NULL;
+
+        if ((Message.Header.u2.s2.Type & 0xFF) != LPC_REQUEST)
+            continue;
+
+        if (Message.Value == TEST_QUIT)
+        {
+            Status = NtReplyPort(PortHandle, &Message.Header);
+            ok_ntstatus(Status, STATUS_SUCCESS);
+            break;
+        }
+
+        Message.Value++;
+        Reply = &Message;
+    }
+
+    NtClose(PortHandle);
+    return 0;
+}
+
+static
+VOID
+TraceRoundTrips(
+    _In_ PCSTR Name,
+    _In_ PLARGE_INTEGER Start,
+    _In_ PLARGE_INTEGER End)
+{
+    LARGE_INTEGER Frequency;
+
+    QueryPerformanceFrequency(&Frequency);
+    trace("%s: %d round trips in %I64d ms, %I64d ns per round trip\n",
+          Name,
+          ROUND_TRIPS,
+          (End->QuadPart - Start->QuadPart) * 1000 / Frequency.QuadPart,
+          (End->QuadPart - Start->QuadPart) * 1000000000 / Frequency.QuadPart / ROUND_TRIPS);
+}
+
+static
+VOID
+TestMessageAttributes(VOID)
+{
+    TEST_ATTRIBUTES Attributes;
+    ULONG RequiredSize;
+    NTSTATUS Status;
+
+    ok(pAlpcGetHeaderSize(0) == sizeof(ALPC_MESSAGE_ATTRIBUTES),
+       "Size = %lu\n", pAlpcGetHeaderSize(0));
+    ok(pAlpcGetHeaderSize(ALPC_MESSAGE_VIEW_ATTRIBUTE | ALPC_MESSAGE_CONTEXT_ATTRIBUTE) == sizeof(TEST_ATTRIBUTES),
+       "Size = %lu\n", pAlpcGetHeaderSize(ALPC_MESSAGE_VIEW_ATTRIBUTE | ALPC_MESSAGE_CONTEXT_ATTRIBUTE));
+    ok(pAlpcMaxAllowedMessageLength() >= sizeof(TEST_MESSAGE),
+       "Length = %lu\n", pAlpcMaxAllowedMessageLength());
+
+    RequiredSize = 0;
+    Status = pAlpcInitializeMessageAttribute(ALPC_MESSAGE_VIEW_ATTRIBUTE | ALPC_MESSAGE_CONTEXT_ATTRIBUTE,
+                                             &Attributes.Header,
+                                             sizeof(Attributes) - 1,
+                                             &RequiredSize);
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+    ok(RequiredSize == sizeof(Attributes), "RequiredSize = %lu\n", RequiredSize);
+
+    InitAttributes(&Attributes);
+    ok(Attributes.Header.ValidAttributes == 0, "ValidAttributes = %lx\n", Attributes.Header.ValidAttributes);
+    ok(pAlpcGetMessageAttribute(&Attributes.Header, ALPC_MESSAGE_VIEW_ATTRIBUTE) == &Attributes.View,
+       "Wrong view attribute\n");
+    ok(pAlpcGetMessageAttribute(&Attributes.Header, ALPC_MESSAGE_CONTEXT_ATTRIBUTE) == &Attributes.Context,
+       "Wrong context attribute\n");
+    ok(pAlpcGetMessageAttribute(&Attributes.Header, ALPC_MESSAGE_HANDLE_ATTRIBUTE) == NULL,
+       "Got a handle attribute\n");
+}
+
+static
+VOID
+TestRequest(
+    _In_ HANDLE PortHandle)
+{
+    TEST_ATTRIBUTES Attributes;
+    TEST_MESSAGE Message;
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    InitMessage(&Message, 41);
+    InitAttributes(&Attributes);
+    Length = sizeof(Message);
+    Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                        ALPC_MSGFLG_SYNC_REQUEST,
+                                        &Message.Header,
+                                        NULL,
+                                        &Message.Header,
+                                        &Length,
+                                        &Attributes.Header,
+                                        NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(Message.Value == 42, "Value = %lu\n", Message.Value);
+    ok(Length == sizeof(Message), "Length = %Iu\n", Length);
+    ok((Message.Header.u2.s2.Type & 0xFF) == LPC_REPLY, "Type = %x\n", Message.Header.u2.s2.Type);
+    ok(Attributes.Header.ValidAttributes == ALPC_MESSAGE_CONTEXT_ATTRIBUTE,
+       "ValidAttributes = %lx\n", Attributes.Header.ValidAttributes);
+
+    /* The receive buffer must fit the largest message of the port */
+    InitMessage(&Message, 41);
+    Length = sizeof(Message) - 1;
+    Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                        ALPC_MSGFLG_SYNC_REQUEST,
+                                        &Message.Header,
+                                        NULL,
+                                        &Message.Header,
+                                        &Length,
+                                        NULL,
+                                        NULL);
+    ok_ntstatus(Status, STATUS_BUFFER_TOO_SMALL);
+}
+
+static
+VOID
+TestViews(
+    _In_ HANDLE PortHandle)
+{
+    TEST_VIEW_ATTRIBUTES SendAttributes;
+    TEST_ATTRIBUTES Attributes;
+    TEST_MESSAGE Message;
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    SendAttributes.Header.AllocatedAttributes = ALPC_MESSAGE_VIEW_ATTRIBUTE;
+    SendAttributes.Header.ValidAttributes = ALPC_MESSAGE_VIEW_ATTRIBUTE;
+    Status = CreateView(PortHandle, &SendAttributes.View);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to create a view\n");
+        return;
+    }
+    FillPattern(SendAttributes.View.ViewBase, TEST_VIEW_SIZE, 0x11);
+
+    /* Views can't go along with datagrams, nobody would clean them up */
+    InitMessage(&Message, TEST_VIEW_REQUEST);
+    Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                        0,
+                                        &Message.Header,
+                                        &SendAttributes.Header,
+                                        NULL,
+                                        NULL,
+                                        NULL,
+                                        NULL);
+    ok_ntstatus(Status, STATUS_INVALID_PARAMETER);
+
+    /* 64 KB go to the server and back without being copied */
+    InitMessage(&Message, TEST_VIEW_REQUEST);
+    InitAttributes(&Attributes);
+    Length = sizeof(Message);
+    Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                        ALPC_MSGFLG_SYNC_REQUEST,
+                                        &Message.Header,
+                                        &SendAttributes.Header,
+                                        &Message.Header,
+                                        &Length,
+                                        &Attributes.Header,
+                                        NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(Message.Value == TEST_VIEW_REPLY, "Value = %lx\n", Message.Value);
+    ok(Attributes.Header.ValidAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE,
+       "ValidAttributes = %lx\n", Attributes.Header.ValidAttributes);
+    if (Attributes.Header.ValidAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE)
+    {
+        ok(Attributes.View.ViewBase != SendAttributes.View.ViewBase, "Got our own view back\n");
+        ok(Attributes.View.ViewSize >= TEST_VIEW_SIZE, "ViewSize = %Iu\n", Attributes.View.ViewSize);
+        ok(CheckPattern(Attributes.View.ViewBase, TEST_VIEW_SIZE, 0x22), "Wrong reply data\n");
+        Status = pNtAlpcDeleteSectionView(PortHandle, 0, Attributes.View.ViewBase);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+    }
+
+    DeleteView(PortHandle, &SendAttributes.View);
+}
+
+static
+VOID
+TestAlpcRoundTrips(
+    _In_ HANDLE PortHandle)
+{
+    LARGE_INTEGER Start, End;
+    TEST_MESSAGE Message;
+    SIZE_T Length;
+    NTSTATUS Status;
+    ULONG i;
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < ROUND_TRIPS; i++)
+    {
+        InitMessage(&Message, TEST_BENCHMARK);
+        Length = sizeof(Message);
+        Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                            ALPC_MSGFLG_SYNC_REQUEST,
+                                            &Message.Header,
+                                            NULL,
+                                            &Message.Header,
+                                            &Length,
+                                            NULL,
+                                            NULL);
+        if (Status != STATUS_SUCCESS || Message.Value != TEST_BENCHMARK + 1)
+            break;
+    }
+    QueryPerformanceCounter(&End);
+
+    ok(i == ROUND_TRIPS, "Round trip %lu failed with 0x%lx\n", i, Status);
+    if (i == ROUND_TRIPS)
+        TraceRoundTrips("ALPC", &Start, &End);
+}
+
+static
+VOID
+TestAlpc(VOID)
+{
+    ALPC_PORT_ATTRIBUTES PortAttributes;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE ServerPortHandle, PortHandle, ThreadHandle;
+    TEST_MESSAGE Message;
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    RtlZeroMemory(&PortAttributes, sizeof(PortAttributes));
+    PortAttributes.SecurityQos.Length = sizeof(PortAttributes.SecurityQos);
+    PortAttributes.SecurityQos.ImpersonationLevel = SecurityIdentification;
+    PortAttributes.SecurityQos.EffectiveOnly = TRUE;
+    PortAttributes.SecurityQos.ContextTrackingMode = SECURITY_STATIC_TRACKING;
+    PortAttributes.MaxMessageLength = sizeof(TEST_MESSAGE);
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &AlpcPortName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = pNtAlpcCreatePort(&ServerPortHandle, &ObjectAttributes, &PortAttributes);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+    {
+        skip("Failed to create port\n");
+        return;
+    }
+
+    ThreadHandle = (HANDLE)_beginthreadex(NULL, 0, AlpcServerThread, ServerPortHandle, 0, NULL);
+    ok(ThreadHandle != NULL, "_beginthreadex failed\n");
+
+    InitMessage(&Message, TEST_CONNECTION_SIGNATURE);
+    Length = sizeof(Message);
+    Status = pNtAlpcConnectPort(&PortHandle,
+                                &AlpcPortName,
+                                NULL,
+                                &PortAttributes,
+                                0,
+                                NULL,
+                                &Message.Header,
+                                &Length,
+                                NULL,
+                                NULL,
+                                NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        TestRequest(PortHandle);
+        TestViews(PortHandle);
+        TestAlpcRoundTrips(PortHandle);
+
+        InitMessage(&Message, TEST_QUIT);
+        Length = sizeof(Message);
+        Status = pNtAlpcSendWaitReceivePort(PortHandle,
+                                            ALPC_MSGFLG_SYNC_REQUEST,
+                                            &Message.Header,
+                                            NULL,
+                                            &Message.Header,
+                                            &Length,
+                                            NULL,
+                                            NULL);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        NtClose(PortHandle);
+    }
+
+    if (ThreadHandle)
+    {
+        ok_long(WaitForSingleObject(ThreadHandle, 10000), WAIT_OBJECT_0);
+        CloseHandle(ThreadHandle);
+    }
+    NtClose(ServerPortHandle);
+}
+
+static
+VOID
+TestLpcRoundTrips(VOID)
+{
+    SECURITY_QUALITY_OF_SERVICE SecurityQos;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    HANDLE ServerPortHandle, PortHandle, ThreadHandle;
+    LARGE_INTEGER Start, End;
+    TEST_MESSAGE Message;
+    NTSTATUS Status;
+    ULONG i;
+
+    /* Plain LPC, to see what the ALPC layer costs on top of it */
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &LpcPortName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtCreatePort(&ServerPortHandle,
+                          &ObjectAttributes,
+                          0,
+                          sizeof(TEST_MESSAGE),
+                          0);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    ThreadHandle = (HANDLE)_beginthreadex(NULL, 0, LpcServerThread, ServerPortHandle, 0, NULL);
+    ok(ThreadHandle != NULL, "_beginthreadex failed\n");
+
+    SecurityQos.Length = sizeof(SecurityQos);
+    SecurityQos.ImpersonationLevel = SecurityIdentification;
+    SecurityQos.EffectiveOnly = TRUE;
+    SecurityQos.ContextTrackingMode = SECURITY_STATIC_TRACKING;
+    Status = NtConnectPort(&PortHandle, &LpcPortName, &SecurityQos, NULL, NULL, NULL, NULL, NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        QueryPerformanceCounter(&Start);
+        for (i = 0; i < ROUND_TRIPS; i++)
+        {
+            InitMessage(&Message, TEST_BENCHMARK);
+            Status = NtRequestWaitReplyPort(PortHandle, &Message.Header, &Message.Header);
+            if (Status != STATUS_SUCCESS || Message.Value != TEST_BENCHMARK + 1)
+                break;
+        }
+        QueryPerformanceCounter(&End);
+
+        ok(i == ROUND_TRIPS, "Round trip %lu failed with 0x%lx\n", i, Status);
+        if (i == ROUND_TRIPS)
+            TraceRoundTrips("LPC", &Start, &End);
+
+        InitMessage(&Message, TEST_QUIT);
+        Status = NtRequestWaitReplyPort(PortHandle, &Message.Header, &Message.Header);
+        ok_ntstatus(Status, STATUS_SUCCESS);
+        NtClose(PortHandle);
+    }
+
+    if (ThreadHandle)
+    {
+        ok_long(WaitForSingleObject(ThreadHandle, 10000), WAIT_OBJECT_0);
+        CloseHandle(ThreadHandle);
+    }
+    NtClose(ServerPortHandle);
+}
+
+START_TEST(NtAlpcSendWaitReceivePort)
+{
+    if (!InitFunctions())
+    {
+        skip("ALPC is not available\n");
+        return;
+    }
+
+    TestMessageAttributes();
+    TestAlpc();
+    TestLpcRoundTrips();
+}
@@ -0,0 +1,119 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for NtDelayExecution and the clock interrupt rate while idle
+ */
+
+#include "precomp.h"
+
+#define IDLE_MILLISECONDS   2000
+
+static ULONG ClockResolution;
+
+static
+ULONGLONG
+GetInterruptCount(VOID)
+{
+    SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION Info[MAXIMUM_PROCESSORS];
+    ULONGLONG InterruptCount = 0;
+    ULONG ReturnLength, i;
+    NTSTATUS Status;
+
+    Status = NtQuerySystemInformation(SystemProcessorPerformanceInformation,
+                                      Info,
+                                      sizeof(Info),
+                                      &ReturnLength);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return 0;
+
+    for (i = 0; i < ReturnLength / sizeof(Info[0]); i++)
+        InterruptCount += Info[i].InterruptCount;
+
+    return InterruptCount;
+}
+
+static
+LONGLONG
+Delay(
+    _In_ ULONG Milliseconds,
+    _Out_ PULONG TickMilliseconds)
+{
+    LARGE_INTEGER Interval, Frequency, Start, End;
+    ULONG StartTick;
+    NTSTATUS Status;
+
+    Interval.QuadPart = -(LONGLONG)Milliseconds * 10000;
+
+    RtlQueryPerformanceFrequency(&Frequency);
+    StartTick = GetTickCount();
+    RtlQueryPerformanceCounter(&Start);
+    Status = NtDelayExecution(FALSE, &Interval);
+    RtlQueryPerformanceCounter(&End);
+    *TickMilliseconds = GetTickCount() - StartTick;
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    return (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart;
+}
+
+static
+VOID
+TestDelay(
+    _In_ ULONG Milliseconds)
+{
+    LONGLONG Elapsed;
+    ULONG TickElapsed;
+
+    Elapsed = Delay(Milliseconds, &TickElapsed);
+
+    /* Waits are rounded to clock ticks, but must not end much too early
+       or late, even when the clock interrupt was skipped in between */
+    ok(Elapsed + ClockResolution >= Milliseconds,
+       "Waited %I64d ms for %lu ms\n", Elapsed, Milliseconds);
+    ok(Elapsed <= Milliseconds + 2 * ClockResolution + 50,
+       "Waited %I64d ms for %lu ms\n", Elapsed, Milliseconds);
+
+    /* The tick count must have kept up with the time that passed */
+    ok(TickElapsed + 2 * ClockResolution >= Elapsed &&
+       TickElapsed <= Elapsed + 2 * ClockResolution,
+       "Tick count advanced %lu ms in %I64d ms\n", TickElapsed, Elapsed);
+}
+
+static
+VOID
+TestIdleInterrupts(VOID)
+{
+    ULONGLONG StartCount, EndCount;
+    LONGLONG Elapsed;
+    ULONG TickElapsed;
+
+    StartCount = GetInterruptCount();
+    Elapsed = Delay(IDLE_MILLISECONDS, &TickElapsed);
+    EndCount = GetInterruptCount();
+
+    if (Elapsed == 0)
+        return;
+
+    trace("%I64u interrupts in %I64d ms, %I64u per second while idle\n",
+          EndCount - StartCount, Elapsed,
+          (EndCount - StartCount) * 1000 / Elapsed);
+}
+
+START_TEST(NtDelayExecution)
+{
+    ULONG MinimumResolution, MaximumResolution, CurrentResolution;
+    NTSTATUS Status;
+
+    Status = NtQueryTimerResolution(&MinimumResolution,
+                                    &MaximumResolution,
+                                    &CurrentResolution);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+
+    /* Use the coarsest resolution in milliseconds, rounded up */
+    ClockResolution = (MinimumResolution + 9999) / 10000;
+
+    TestDelay(10);
+    TestDelay(100);
+    TestDelay(500);
+    TestIdleInterrupts();
+}
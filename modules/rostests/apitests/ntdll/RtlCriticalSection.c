@@ -0,0 +1,140 @@
+/*
+ * PROJECT:         ReactOS API tests
+ * LICENSE:         GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:         Tests and contention benchmark for RTL critical sections
+ */
+
+#include "precomp.h"
+
+#define CS_THREADS      4
+#define CS_ITERATIONS   200000
+
+/* Windows keeps flags in the high bits of SpinCount */
+#define SPIN_COUNT_MASK 0x00FFFFFF
+
+static RTL_CRITICAL_SECTION CriticalSection;
+static HANDLE StartEvent;
+static volatile LONG SharedCounter;
+
+static
+DWORD
+WINAPI
+ContentionThread(
+    _In_ LPVOID Parameter)
+{
+    ULONG i;
+    LONG Value;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    WaitForSingleObject(StartEvent, INFINITE);
+    for (i = 0; i < CS_ITERATIONS; i++)
+    {
+        RtlEnterCriticalSection(&CriticalSection);
+
+        /* Keep it short, like most heap and loader lock users */
+        Value = SharedCounter;
+        YieldProcessor();
+        SharedCounter = Value + 1;
+
+        RtlLeaveCriticalSection(&CriticalSection);
+    }
+    return 0;
+}
+
+static
+VOID
+TestContention(
+    _In_ ULONG SpinCount)
+{
+    HANDLE Threads[CS_THREADS];
+    LARGE_INTEGER Frequency, Start, End;
+    NTSTATUS Status;
+    ULONG i;
+
+    Status = RtlInitializeCriticalSectionAndSpinCount(&CriticalSection, SpinCount);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return;
+
+    SharedCounter = 0;
+    StartEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    ok(StartEvent != NULL, "CreateEventW failed with %lu\n", GetLastError());
+
+    for (i = 0; i < CS_THREADS; i++)
+    {
+        Threads[i] = CreateThread(NULL, 0, ContentionThread, NULL, 0, NULL);
+        ok(Threads[i] != NULL, "CreateThread failed with %lu\n", GetLastError());
+    }
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    SetEvent(StartEvent);
+    WaitForMultipleObjects(CS_THREADS, Threads, TRUE, INFINITE);
+    QueryPerformanceCounter(&End);
+
+    ok_long(SharedCounter, CS_THREADS * CS_ITERATIONS);
+    ok_long(CriticalSection.LockCount, -1);
+    ok_long(CriticalSection.RecursionCount, 0);
+
+    trace("SpinCount %lu: %I64u ms\n",
+          SpinCount,
+          (End.QuadPart - Start.QuadPart) * 1000 / Frequency.QuadPart);
+
+    /* Newer Windows versions don't allocate debug info by default */
+    if (CriticalSection.DebugInfo != NULL &&
+        CriticalSection.DebugInfo != (PRTL_CRITICAL_SECTION_DEBUG)-1)
+    {
+        trace("SpinCount %lu: %lu waits, %lu contentions\n",
+              SpinCount,
+              CriticalSection.DebugInfo->EntryCount,
+              CriticalSection.DebugInfo->ContentionCount);
+    }
+
+    for (i = 0; i < CS_THREADS; i++)
+        CloseHandle(Threads[i]);
+    CloseHandle(StartEvent);
+    RtlDeleteCriticalSection(&CriticalSection);
+}
+
+static
+VOID
+TestSpinCount(VOID)
+{
+    RTL_CRITICAL_SECTION Section;
+    NTSTATUS Status;
+    ULONG ExpectedCount;
+    ULONG OldCount;
+
+    /* The spin count is only kept on multiprocessor systems */
+    ExpectedCount = (NtCurrentPeb()->NumberOfProcessors > 1) ? 4000 : 0;
+
+    Status = RtlInitializeCriticalSectionAndSpinCount(&Section, 4000);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok_long((ULONG)Section.SpinCount & SPIN_COUNT_MASK, ExpectedCount);
+
+    /* Spinning must not get in the way of recursive acquisition */
+    RtlEnterCriticalSection(&Section);
+    RtlEnterCriticalSection(&Section);
+    ok_long(Section.RecursionCount, 2);
+    ok(RtlTryEnterCriticalSection(&Section), "RtlTryEnterCriticalSection failed\n");
+    RtlLeaveCriticalSection(&Section);
+    RtlLeaveCriticalSection(&Section);
+    RtlLeaveCriticalSection(&Section);
+    ok_long(Section.RecursionCount, 0);
+
+    OldCount = RtlSetCriticalSectionSpinCount(&Section, 0);
+    ok_long(OldCount & SPIN_COUNT_MASK, ExpectedCount);
+    ok_long((ULONG)Section.SpinCount & SPIN_COUNT_MASK, 0);
+
+    RtlDeleteCriticalSection(&Section);
+}
+
+START_TEST(RtlCriticalSection)
+{
+    TestSpinCount();
+
+    /* Compare waiting on the event right away with spinning first */
+    TestContention(0);
+    TestContention(4000);
+}
@@ -0,0 +1,77 @@
+/*
+ * PROJECT:         ReactOS API tests
+ * LICENSE:         GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:         Tests and per-call cost of RtlQueryPerformanceCounter
+ */
+
+#include "precomp.h"
+
+#define QPC_ITERATIONS  1000000
+
+static
+VOID
+TestCounter(VOID)
+{
+    LARGE_INTEGER Frequency, NtFrequency;
+    LARGE_INTEGER Counter, NtCounter, Previous;
+    NTSTATUS Status;
+    ULONG i;
+
+    ok(RtlQueryPerformanceFrequency(&Frequency), "RtlQueryPerformanceFrequency failed\n");
+    Status = NtQueryPerformanceCounter(&NtCounter, &NtFrequency);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(Frequency.QuadPart == NtFrequency.QuadPart,
+       "Frequency %I64d, expected %I64d\n", Frequency.QuadPart, NtFrequency.QuadPart);
+
+    /* Both must read the same counter */
+    ok(RtlQueryPerformanceCounter(&Counter), "RtlQueryPerformanceCounter failed\n");
+    ok(Counter.QuadPart >= NtCounter.QuadPart,
+       "Counter %I64d went back from %I64d\n", Counter.QuadPart, NtCounter.QuadPart);
+    Status = NtQueryPerformanceCounter(&NtCounter, NULL);
+    ok_ntstatus(Status, STATUS_SUCCESS);
+    ok(NtCounter.QuadPart >= Counter.QuadPart,
+       "Counter %I64d went back from %I64d\n", NtCounter.QuadPart, Counter.QuadPart);
+
+    Previous = NtCounter;
+    for (i = 0; i < 1000; i++)
+    {
+        RtlQueryPerformanceCounter(&Counter);
+        if (Counter.QuadPart < Previous.QuadPart)
+            break;
+        Previous = Counter;
+    }
+    ok(i == 1000, "Counter %I64d went back from %I64d\n", Counter.QuadPart, Previous.QuadPart);
+}
+
+static
+VOID
+TestCost(VOID)
+{
+    LARGE_INTEGER Frequency, Start, End, Counter;
+    ULONG i;
+
+    RtlQueryPerformanceFrequency(&Frequency);
+
+    /* The system call, which is all there was before */
+    RtlQueryPerformanceCounter(&Start);
+    for (i = 0; i < QPC_ITERATIONS; i++)
+        NtQueryPerformanceCounter(&Counter, NULL);
+    RtlQueryPerformanceCounter(&End);
+    trace("NtQueryPerformanceCounter: %I64u ns per call\n",
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart * 1000 / QPC_ITERATIONS);
+
+    RtlQueryPerformanceCounter(&Start);
+    for (i = 0; i < QPC_ITERATIONS; i++)
+        RtlQueryPerformanceCounter(&Counter);
+    RtlQueryPerformanceCounter(&End);
+    trace("RtlQueryPerformanceCounter: %I64u ns per call\n",
+          (End.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart * 1000 / QPC_ITERATIONS);
+
+    trace("User mode TSC %s\n", SharedUserData->TscQpcEnabled ? "enabled" : "disabled");
+}
+
+START_TEST(RtlQueryPerformanceCounter)
+{
+    TestCounter();
+    TestCost();
+}
@@ -2474,6 +2474,109 @@ end_test:
     FsRtlUninitializeLargeMcb(&Mcb);
 }
 
+/* Heavily fragmented file: one run every 16 sectors, with holes in between */
+static VOID FsRtlLargeMcbTestsFragmented(VOID)
+{
+    LARGE_MCB Mcb;
+    LARGE_INTEGER TimeStart, TimeFinish;
+    LONGLONG Vbn, Lbn, SectorCount, StartingLbn, CountFromStartingLbn;
+    ULONG NbRuns, Index, Errors, i;
+    const ULONG NbFragments = 100000;
+
+    FsRtlInitializeLargeMcb(&Mcb, PagedPool);
+
+    KeQuerySystemTime(&TimeStart);
+    for (i = 0; i < NbFragments; i++)
+    {
+        if (!FsRtlAddLargeMcbEntry(&Mcb, i * 16, i * 32 + 1000, 8))
+            break;
+    }
+    KeQuerySystemTime(&TimeFinish);
+    ok(i == NbFragments, "Expected %lu runs to be added, got %lu\n", NbFragments, i);
+    trace("Adding %lu runs took %I64d ms\n", NbFragments, (TimeFinish.QuadPart - TimeStart.QuadPart) / 10000);
+
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&Mcb);
+    ok(NbRuns == 2 * NbFragments - 1, "Expected %lu runs, got: %lu\n", 2 * NbFragments - 1, NbRuns);
+
+    Errors = 0;
+    KeQuerySystemTime(&TimeStart);
+    for (i = 0; i < NbFragments; i++)
+    {
+        if (!FsRtlLookupLargeMcbEntry(&Mcb, i * 16 + 3, &Lbn, &SectorCount, &StartingLbn, &CountFromStartingLbn, &Index) ||
+            Lbn != i * 32 + 1003 || SectorCount != 5 || StartingLbn != i * 32 + 1000 || CountFromStartingLbn != 8 || Index != 2 * i)
+        {
+            Errors++;
+        }
+        if (!FsRtlLookupLargeMcbEntry(&Mcb, i * 16 + 12, &Lbn, &SectorCount, NULL, NULL, &Index) && i != NbFragments - 1)
+        {
+            Errors++;
+        }
+        else if (i != NbFragments - 1 && (Lbn != -1 || SectorCount != 4 || Index != 2 * i + 1))
+        {
+            Errors++;
+        }
+    }
+    KeQuerySystemTime(&TimeFinish);
+    ok(Errors == 0, "Got %lu lookup errors\n", Errors);
+    trace("Looking up %lu runs took %I64d ms\n", 2 * NbFragments, (TimeFinish.QuadPart - TimeStart.QuadPart) / 10000);
+
+    Errors = 0;
+    KeQuerySystemTime(&TimeStart);
+    for (i = 0; FsRtlGetNextLargeMcbEntry(&Mcb, i, &Vbn, &Lbn, &SectorCount); i++)
+    {
+        if (Vbn != (i / 2) * 16 + (i % 2) * 8 || SectorCount != 8 || Lbn != ((i % 2) ? -1 : (LONGLONG)(i / 2) * 32 + 1000))
+            Errors++;
+    }
+    KeQuerySystemTime(&TimeFinish);
+    ok(i == NbRuns, "Expected %lu runs, got %lu\n", NbRuns, i);
+    ok(Errors == 0, "Got %lu enumeration errors\n", Errors);
+    trace("Enumerating %lu runs took %I64d ms\n", NbRuns, (TimeFinish.QuadPart - TimeStart.QuadPart) / 10000);
+
+    /* Fill some holes, each merges with the run below it */
+    KeQuerySystemTime(&TimeStart);
+    for (i = 0; i < NbFragments; i += 1000)
+    {
+        ok(FsRtlAddLargeMcbEntry(&Mcb, i * 16 + 8, i * 32 + 1008, 8), "Expected FsRtlAddLargeMcbEntry to succeed for %lu\n", i);
+    }
+    KeQuerySystemTime(&TimeFinish);
+    trace("Filling %lu holes took %I64d ms\n", NbFragments / 1000, (TimeFinish.QuadPart - TimeStart.QuadPart) / 10000);
+
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&Mcb);
+    ok(NbRuns == 2 * NbFragments - 1 - NbFragments / 1000, "Expected %lu runs, got: %lu\n", 2 * NbFragments - 1 - NbFragments / 1000, NbRuns);
+    ok(FsRtlLookupLargeMcbEntry(&Mcb, 1000 * 16 + 10, &Lbn, &SectorCount, &StartingLbn, &CountFromStartingLbn, &Index) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Lbn == 1000 * 32 + 1010, "Expected Lbn %d, got: %I64d\n", 1000 * 32 + 1010, Lbn);
+    ok(SectorCount == 6, "Expected SectorCount 6, got: %I64d\n", SectorCount);
+    ok(StartingLbn == 1000 * 32 + 1000, "Expected StartingLbn %d, got: %I64d\n", 1000 * 32 + 1000, StartingLbn);
+    ok(CountFromStartingLbn == 16, "Expected CountFromStartingLbn 16, got: %I64d\n", CountFromStartingLbn);
+    ok(Index == 1999, "Expected Index 1999, got: %lu\n", Index);
+
+    /* Punch holes in the middle of some runs, each splits a run in two */
+    KeQuerySystemTime(&TimeStart);
+    for (i = 500; i < NbFragments; i += 1000)
+    {
+        FsRtlRemoveLargeMcbEntry(&Mcb, i * 16 + 2, 4);
+    }
+    KeQuerySystemTime(&TimeFinish);
+    trace("Splitting %lu runs took %I64d ms\n", NbFragments / 1000, (TimeFinish.QuadPart - TimeStart.QuadPart) / 10000);
+
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&Mcb);
+    ok(NbRuns == 2 * NbFragments - 1 + NbFragments / 1000, "Expected %lu runs, got: %lu\n", 2 * NbFragments - 1 + NbFragments / 1000, NbRuns);
+    ok(FsRtlLookupLargeMcbEntry(&Mcb, 500 * 16 + 6, &Lbn, &SectorCount, &StartingLbn, &CountFromStartingLbn, &Index) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Lbn == 500 * 32 + 1006, "Expected Lbn %d, got: %I64d\n", 500 * 32 + 1006, Lbn);
+    ok(SectorCount == 2, "Expected SectorCount 2, got: %I64d\n", SectorCount);
+    ok(StartingLbn == 500 * 32 + 1006, "Expected StartingLbn %d, got: %I64d\n", 500 * 32 + 1006, StartingLbn);
+    ok(Index == 1001, "Expected Index 1001, got: %lu\n", Index);
+
+    FsRtlTruncateLargeMcb(&Mcb, 16);
+    NbRuns = FsRtlNumberOfRunsInLargeMcb(&Mcb);
+    ok(NbRuns == 1, "Expected 1 run, got: %lu\n", NbRuns);
+    ok(FsRtlLookupLastLargeMcbEntry(&Mcb, &Vbn, &Lbn) == TRUE, "expected TRUE, got FALSE\n");
+    ok(Vbn == 15, "Expected Vbn 15, got: %I64d\n", Vbn);
+    ok(Lbn == 1015, "Expected Lbn 1015, got: %I64d\n", Lbn);
+
+    FsRtlUninitializeLargeMcb(&Mcb);
+}
+
 START_TEST(FsRtlMcb)
 {
     FsRtlMcbTest();
@@ -2482,4 +2585,5 @@ START_TEST(FsRtlMcb)
     FsRtlLargeMcbTestsFastFat();
     FsRtlLargeMcbTestsFastFat_2();
     FsRtlLargeMcbTestsFastFat_3();
+    FsRtlLargeMcbTestsFragmented();
 }
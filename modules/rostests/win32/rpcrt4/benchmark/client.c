@@ -0,0 +1,141 @@
+/*
+ * PROJECT:         ReactOS Tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            modules/rostests/win32/rpcrt4/benchmark/client.c
+ * PURPOSE:         Times local RPC round trips
+ * NOTES:           Usage: rpcbench [protseq [iterations]]
+ *                  protseq is ncalrpc (default) or ncacn_np, so both
+ *                  local transports can be compared on the same machine.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rpcbench_c.h"
+
+RPC_STATUS StartServer(const char *Protseq, const char *Endpoint);
+void StopServer(void);
+
+void __RPC_FAR * __RPC_USER MIDL_user_allocate(SIZE_T Size)
+{
+    return HeapAlloc(GetProcessHeap(), 0, Size);
+}
+
+void __RPC_USER MIDL_user_free(void __RPC_FAR *Ptr)
+{
+    HeapFree(GetProcessHeap(), 0, Ptr);
+}
+
+static double Elapsed(LARGE_INTEGER Start, LARGE_INTEGER Stop, LARGE_INTEGER Freq)
+{
+    return (double)(Stop.QuadPart - Start.QuadPart) * 1000000.0 / (double)Freq.QuadPart;
+}
+
+static BOOL TimeEcho(handle_t Binding, int Size, int Iterations, LARGE_INTEGER Freq)
+{
+    unsigned char *In, *Out;
+    LARGE_INTEGER Start, Stop;
+    int i;
+
+    In = HeapAlloc(GetProcessHeap(), 0, Size);
+    Out = HeapAlloc(GetProcessHeap(), 0, Size);
+    if (!In || !Out)
+    {
+        HeapFree(GetProcessHeap(), 0, In);
+        HeapFree(GetProcessHeap(), 0, Out);
+        return FALSE;
+    }
+
+    for (i = 0; i < Size; i++)
+        In[i] = (unsigned char)i;
+
+    /* Warm up the binding and the server's connection */
+    Echo(Binding, Size, In, Out);
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Iterations; i++)
+        Echo(Binding, Size, In, Out);
+    QueryPerformanceCounter(&Stop);
+
+    if (memcmp(In, Out, Size))
+        printf("Echo %6d bytes: payload mismatch\n", Size);
+    else
+        printf("Echo %6d bytes: %10.2f us/call\n", Size, Elapsed(Start, Stop, Freq) / Iterations);
+
+    HeapFree(GetProcessHeap(), 0, In);
+    HeapFree(GetProcessHeap(), 0, Out);
+    return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int Sizes[] = { 0, 1024, 16384 };
+    const char *Protseq = "ncalrpc";
+    const char *Endpoint;
+    RPC_CSTR StringBinding;
+    handle_t Binding;
+    LARGE_INTEGER Freq, Start, Stop;
+    RPC_STATUS Status;
+    int Iterations = 10000;
+    int i, Value;
+
+    if (argc > 1)
+        Protseq = argv[1];
+    if (argc > 2)
+        Iterations = atoi(argv[2]);
+    if (Iterations <= 0)
+        Iterations = 1;
+
+    if (!strcmp(Protseq, "ncalrpc"))
+        Endpoint = "rpcbench";
+    else if (!strcmp(Protseq, "ncacn_np"))
+        Endpoint = "\\pipe\\rpcbench";
+    else
+    {
+        printf("Unsupported protocol sequence %s\n", Protseq);
+        return 1;
+    }
+
+    Status = StartServer(Protseq, Endpoint);
+    if (Status != RPC_S_OK)
+    {
+        printf("Failed to start the server: %lu\n", Status);
+        return 1;
+    }
+
+    Status = RpcStringBindingComposeA(NULL, (RPC_CSTR)Protseq, NULL, (RPC_CSTR)Endpoint, NULL, &StringBinding);
+    if (Status == RPC_S_OK)
+    {
+        Status = RpcBindingFromStringBindingA(StringBinding, &Binding);
+        RpcStringFreeA(&StringBinding);
+    }
+    if (Status != RPC_S_OK)
+    {
+        printf("Failed to bind to %s:%s: %lu\n", Protseq, Endpoint, Status);
+        StopServer();
+        return 1;
+    }
+
+    QueryPerformanceFrequency(&Freq);
+    printf("%s, %d iterations\n", Protseq, Iterations);
+
+    /* The first call also pays for the connection and the bind */
+    QueryPerformanceCounter(&Start);
+    Value = Ping(Binding, 0);
+    QueryPerformanceCounter(&Stop);
+    printf("First call:       %10.2f us\n", Elapsed(Start, Stop, Freq));
+
+    QueryPerformanceCounter(&Start);
+    for (i = 0; i < Iterations; i++)
+        Value = Ping(Binding, Value);
+    QueryPerformanceCounter(&Stop);
+    printf("Ping:             %10.2f us/call\n", Elapsed(Start, Stop, Freq) / Iterations);
+
+    for (i = 0; i < (int)(sizeof(Sizes) / sizeof(Sizes[0])); i++)
+        TimeEcho(Binding, Sizes[i], Iterations, Freq);
+
+    RpcBindingFree(&Binding);
+    StopServer();
+    return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * PROJECT:         ReactOS Tests
+ * LICENSE:         GPL - See COPYING in the top level directory
+ * FILE:            modules/rostests/win32/rpcrt4/benchmark/server.c
+ * PURPOSE:         Server side of the local RPC benchmark
+ */
+
+#include <windows.h>
+#include <string.h>
+#include "rpcbench_s.h"
+
+int s_Ping(handle_t Binding, int Value)
+{
+    return Value + 1;
+}
+
+void s_Echo(handle_t Binding, int Size, const unsigned char *In, unsigned char *Out)
+{
+    memcpy(Out, In, Size);
+}
+
+RPC_STATUS StartServer(const char *Protseq, const char *Endpoint)
+{
+    RPC_STATUS Status;
+
+    Status = RpcServerUseProtseqEpA((RPC_CSTR)Protseq, 20, (RPC_CSTR)Endpoint, NULL);
+    if (Status != RPC_S_OK)
+        return Status;
+
+    Status = RpcServerRegisterIf(RpcBench_v1_0_s_ifspec, NULL, NULL);
+    if (Status != RPC_S_OK)
+        return Status;
+
+    return RpcServerListen(1, 20, TRUE);
+}
+
+void StopServer(void)
+{
+    RpcMgmtStopServerListening(NULL);
+    RpcMgmtWaitServerListen();
+    RpcServerUnregisterIf(NULL, NULL, FALSE);
+}
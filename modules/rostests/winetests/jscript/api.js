@@ -987,6 +987,99 @@ ok(tmp === undefined, "tmp = " + tmp);
 tmp = [1,2,,,].pop();
 ok(tmp === undefined, "tmp = " + tmp);
 
+function enumProps(obj) {
+    var ret = "";
+    for(var p in obj)
+        ret += (ret ? "," : "") + p;
+    return ret;
+}
+
+arr = [];
+for(i = 0; i < 100; i++)
+    arr[i] = i * 2;
+ok(arr.length === 100, "arr.length = " + arr.length);
+ok(arr[50] === 100, "arr[50] = " + arr[50]);
+ok(arr["50"] === 100, "arr[\"50\"] = " + arr["50"]);
+ok(arr["050"] === undefined, "arr[\"050\"] = " + arr["050"]);
+ok(arr[100] === undefined, "arr[100] = " + arr[100]);
+ok(arr.hasOwnProperty(99), "arr.hasOwnProperty(99) is false");
+ok(!arr.hasOwnProperty(100), "arr.hasOwnProperty(100) is true");
+ok(arr.propertyIsEnumerable(0), "arr[0] is not enumerable");
+arr[5]++;
+ok(arr[5] === 11, "arr[5] = " + arr[5]);
+arr["7"] += 1;
+ok(arr[7] === 15, "arr[7] = " + arr[7]);
+arr["010"] = 1;
+ok(arr.length === 100, "arr.length = " + arr.length);
+ok(arr[10] === 20, "arr[10] = " + arr[10]);
+arr.length = 3;
+tmp = enumProps(arr);
+ok(tmp === "0,1,2,010", "enumProps(arr) = " + tmp);
+ok(arr[50] === undefined, "arr[50] = " + arr[50]);
+arr.length = 5;
+ok(arr[3] === undefined, "arr[3] = " + arr[3]);
+ok(!arr.hasOwnProperty(3), "arr.hasOwnProperty(3) is true");
+ok(delete arr["010"], "delete arr[\"010\"] failed");
+arr[3] = 6;
+tmp = enumProps(arr);
+ok(tmp === "0,1,2,3", "enumProps(arr) = " + tmp);
+
+arr = [1,2,3];
+arr[5] = 6;
+ok(arr.length === 6, "arr.length = " + arr.length);
+ok(!(3 in arr), "arr[3] exists");
+tmp = enumProps(arr);
+ok(tmp === "0,1,2,5", "enumProps(arr) = " + tmp);
+arr[3] = 4;
+arr[4] = 5;
+tmp = arr.join();
+ok(tmp === "1,2,3,4,5,6", "arr.join() = " + tmp);
+
+arr = [1,2,3,4];
+ok(delete arr[3], "delete arr[3] failed");
+ok(arr.length === 4, "arr.length = " + arr.length);
+ok(!(3 in arr), "arr[3] exists");
+ok(delete arr[1], "delete arr[1] failed");
+ok(!(1 in arr), "arr[1] exists");
+tmp = enumProps(arr);
+ok(tmp === "0,2", "enumProps(arr) = " + tmp);
+arr[1] = "x";
+ok(arr[1] === "x", "arr[1] = " + arr[1]);
+tmp = arr.push(5);
+ok(tmp === 5, "arr.push(5) = " + tmp);
+tmp = arr.join();
+ok(tmp === "1,x,3,,5", "arr.join() = " + tmp);
+
+arr = new Array(3);
+ok(!(0 in arr), "arr[0] exists");
+for(i = 0; i < 3; i++)
+    arr[i] = i;
+tmp = enumProps(arr);
+ok(tmp === "0,1,2", "enumProps(arr) = " + tmp);
+
+arr = [4,1,3,2];
+arr.unshift(5, 0);
+tmp = arr.join();
+ok(tmp === "5,0,4,1,3,2", "arr.join() = " + tmp);
+tmp = arr.shift();
+ok(tmp === 5, "arr.shift() = " + tmp);
+tmp = arr.splice(1, 2, "a", "b", "c");
+ok(tmp.join() === "4,1", "arr.splice() returned " + tmp.join());
+tmp = arr.join();
+ok(tmp === "0,a,b,c,3,2", "arr.join() = " + tmp);
+tmp = arr.splice(2, 3);
+ok(tmp.join() === "b,c,3", "arr.splice() returned " + tmp.join());
+tmp = arr.reverse().join();
+ok(tmp === "2,a,0", "arr.reverse() = " + tmp);
+tmp = arr.sort().join();
+ok(tmp === "0,2,a", "arr.sort() = " + tmp);
+ok(arr.length === 3, "arr.length = " + arr.length);
+tmp = enumProps(arr);
+ok(tmp === "0,1,2", "enumProps(arr) = " + tmp);
+
+arr = [function() { return this; }];
+ok(arr[0]() === arr, "arr[0]() !== arr");
+
 function PseudoArray() {
     this[0] = 0;
 }
@@ -0,0 +1,73 @@
+/*
+ * Array micro-benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+var arr, tmp, i, j, sum;
+
+/* push and pop */
+arr = [];
+for(j = 0; j < 10; j++) {
+    for(i = 0; i < 10000; i++)
+        arr.push(i);
+    sum = 0;
+    while(arr.length)
+        sum += arr.pop();
+}
+
+/* indexed stores and loads */
+arr = [];
+for(i = 0; i < 50000; i++)
+    arr[i] = i & 0xff;
+for(j = 0; j < 10; j++) {
+    sum = 0;
+    for(i = 0; i < arr.length; i++)
+        sum += arr[i];
+    for(i = 0; i < arr.length; i++)
+        arr[i]++;
+}
+
+/* sort and join */
+arr = [];
+for(i = 0; i < 10000; i++)
+    arr.push((i * 7919) % 10007);
+arr.sort(function(a, b) { return a - b; });
+tmp = arr.join(",");
+arr.reverse();
+tmp = arr.join();
+
+/* queue operations */
+arr = [];
+for(i = 0; i < 2000; i++)
+    arr.unshift(i);
+for(i = 0; i < 2000; i++)
+    arr.shift();
+for(i = 0; i < 2000; i++)
+    arr.splice(i >> 1, 0, i);
+for(i = 0; i < 1000; i++)
+    arr.splice(i, 1);
+
+/* enumeration */
+arr = [];
+for(i = 0; i < 10000; i++)
+    arr[i] = i;
+sum = 0;
+for(j = 0; j < 5; j++) {
+    for(i in arr)
+        sum += arr[i];
+}
+
+arr = null;
@@ -1879,6 +1879,41 @@ ok(Object === 1, "Object = " + Object);
 Array = 1;
 ok(Array === 1, "Array = " + Array);
 
+function testMemberCache() {
+    function getX(o) { return o.x; }
+    function setX(o, v) { o.x = v; }
+    function Proto() {}
+    Proto.prototype.x = "proto";
+
+    var objs = [{x: 1, y: 2}, {y: 3, x: 4}, {x: 5}, {}, new Proto()], i, o;
+    var expected = [1, 4, 5, undefined, "proto"];
+
+    for(i = 0; i < objs.length; i++)
+        ok(getX(objs[i]) === expected[i], "getX(objs[" + i + "]) = " + getX(objs[i]));
+
+    o = {x: 1, y: 2};
+    ok(getX(o) === 1, "getX(o) = " + getX(o));
+    delete o.x;
+    ok(getX(o) === undefined, "getX(o) = " + getX(o) + " after delete");
+    o.x = 2;
+    ok(getX(o) === 2, "getX(o) = " + getX(o) + " after readding");
+
+    o = new Proto();
+    ok(getX(o) === "proto", "getX(o) = " + getX(o));
+    setX(o, "own");
+    ok(getX(o) === "own", "getX(o) = " + getX(o));
+    ok(Proto.prototype.x === "proto", "Proto.prototype.x = " + Proto.prototype.x);
+    delete o.x;
+    ok(getX(o) === "proto", "getX(o) = " + getX(o) + " after delete");
+
+    for(i = 0; i < objs.length; i++)
+        setX(objs[i], i);
+    for(i = 0; i < objs.length; i++)
+        ok(objs[i].x === i, "objs[" + i + "].x = " + objs[i].x);
+}
+
+testMemberCache();
+
 Date = 1;
 ok(Date === 1, "Date = " + Date);
 
@@ -0,0 +1,73 @@
+/*
+ * Property access micro-benchmarks
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+var obj, objs, tmp, i, j, sum;
+
+function Point(x, y) {
+    this.x = x;
+    this.y = y;
+}
+
+Point.prototype.length2 = function() {
+    return this.x * this.x + this.y * this.y;
+}
+
+/* loads and stores on a single object */
+obj = {a: 1, b: 2, c: 3};
+sum = 0;
+for(i = 0; i < 200000; i++) {
+    sum += obj.a + obj.b + obj.c;
+    obj.a = obj.c;
+}
+
+/* objects sharing the same layout */
+objs = [];
+for(i = 0; i < 1000; i++)
+    objs.push(new Point(i, -i));
+sum = 0;
+for(j = 0; j < 100; j++) {
+    for(i = 0; i < objs.length; i++)
+        sum += objs[i].x - objs[i].y;
+}
+
+/* prototype methods */
+sum = 0;
+for(j = 0; j < 50; j++) {
+    for(i = 0; i < objs.length; i++)
+        sum += objs[i].length2();
+}
+
+/* built-in properties */
+tmp = "property";
+sum = 0;
+for(i = 0; i < 100000; i++)
+    sum += tmp.length + objs.length;
+
+/* the layout changes under the loop */
+sum = 0;
+for(i = 0; i < 20000; i++) {
+    obj = {a: i};
+    if(i & 1)
+        obj.b = 1;
+    else
+        delete obj.a;
+    obj.c = i;
+    sum += obj.c + (obj.a ? obj.a : 0);
+}
+
+objs = null;
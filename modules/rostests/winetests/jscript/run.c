@@ -3297,6 +3297,8 @@ static void run_benchmarks(void)
     run_benchmark("dna.js");
     run_benchmark("base64.js");
     run_benchmark("validateinput.js");
+    run_benchmark("arraybench.js");
+    run_benchmark("propbench.js");
 }
 
 static BOOL check_jscript(void)
@@ -2807,6 +2807,43 @@ static void run_from_res(const char *name)
     test_name = "";
 }
 
+static void run_benchmark(const char *name)
+{
+    const char *data;
+    DWORD size, len;
+    ULONG start, end;
+    BSTR str;
+    HRSRC src;
+    HRESULT hres;
+
+    strict_dispid_check = FALSE;
+
+    src = FindResourceA(NULL, name, (LPCSTR)40);
+    ok(src != NULL, "Could not find resource %s\n", name);
+
+    size = SizeofResource(NULL, src);
+    data = LoadResource(NULL, src);
+
+    len = MultiByteToWideChar(CP_ACP, 0, data, size, NULL, 0);
+    str = SysAllocStringLen(NULL, len);
+    MultiByteToWideChar(CP_ACP, 0, data, size, str, len);
+
+    start = GetTickCount();
+    hres = parse_script(SCRIPTITEM_GLOBALMEMBERS, str, NULL);
+    end = GetTickCount();
+    ok(hres == S_OK, "%s: parse_script failed: %08x\n", name, hres);
+
+    trace("%s ran in %u ms\n", name, end-start);
+    SysFreeString(str);
+}
+
+static void run_benchmarks(void)
+{
+    trace("Running benchmarks...\n");
+
+    run_benchmark("bench.vbs");
+}
+
 static void run_tests(void)
 {
     HRESULT hres;
@@ -3091,6 +3128,9 @@ START_TEST(run)
         run_from_file(argv[2]);
     }else {
         run_tests();
+
+        if(winetest_interactive)
+            run_benchmarks();
     }
 
     CoUninitialize();
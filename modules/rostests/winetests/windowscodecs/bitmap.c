@@ -1314,6 +1314,228 @@ static void test_bitmap_scaler(void)
     IWICBitmap_Release(bitmap);
 }
 
+static void scale_bitmap(const WICPixelFormatGUID *format, UINT bpp, UINT src_width, const BYTE *src,
+    UINT width, WICBitmapInterpolationMode mode, BYTE *dst)
+{
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    HRESULT hr;
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, src_width, 1, format,
+        src_width * bpp / 8, src_width * bpp / 8, (BYTE *)src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+    ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+    hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, width, 1, mode);
+    ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", mode, hr);
+
+    memset(dst, 0xcc, width * bpp / 8);
+    hr = IWICBitmapScaler_CopyPixels(scaler, NULL, width * bpp / 8, width * bpp / 8, dst);
+    ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", mode, hr);
+
+    IWICBitmapScaler_Release(scaler);
+    IWICBitmap_Release(bitmap);
+}
+
+static void test_bitmap_scaler_filters(void)
+{
+    static const BYTE edge[] = { 0x00, 0xff };
+    static const BYTE stripes[] = { 0x00, 0xff, 0x00, 0xff };
+    /* Opaque red next to transparent green */
+    static const BYTE edge_alpha[] = { 0x00, 0x00, 0xff, 0xff, 0x00, 0xff, 0x00, 0x00 };
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    BYTE dst[4 * 4];
+    UINT i, k;
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        /* Enlarging a hard edge gives a ramp, nearest neighbour would repeat the pixels */
+        scale_bitmap(&GUID_WICPixelFormat8bppGray, 8, 2, edge, 4, modes[i], dst);
+        ok(dst[0] < dst[1] && dst[1] < dst[2] && dst[2] < dst[3],
+            "%u: unexpected data %02x %02x %02x %02x.\n", modes[i], dst[0], dst[1], dst[2], dst[3]);
+        ok(dst[1] > 0x10 && dst[1] < 0x80 && dst[2] > 0x80 && dst[2] < 0xf0,
+            "%u: unexpected data %02x %02x.\n", modes[i], dst[1], dst[2]);
+
+        /* Transparent pixels must not change the colour of the visible ones */
+        scale_bitmap(&GUID_WICPixelFormat32bppBGRA, 32, 2, edge_alpha, 4, modes[i], dst);
+        ok(dst[7] > 0x10 && dst[7] < 0xff, "%u: unexpected alpha %02x.\n", modes[i], dst[7]);
+        for (k = 0; k < 4 * 4; k += 4)
+        {
+            if (!dst[k + 3]) continue;
+            ok(dst[k] <= 0x01 && dst[k + 1] <= 0x01 && dst[k + 2] >= 0xfe,
+                "%u: pixel %u: unexpected colour %02x %02x %02x alpha %02x.\n",
+                modes[i], k / 4, dst[k], dst[k + 1], dst[k + 2], dst[k + 3]);
+        }
+    }
+
+    /* Shrinking averages, nearest neighbour would only pick the black pixels */
+    scale_bitmap(&GUID_WICPixelFormat8bppGray, 8, 4, stripes, 2, WICBitmapInterpolationModeFant, dst);
+    ok(dst[0] >= 0x70 && dst[0] <= 0x90 && dst[1] >= 0x70 && dst[1] <= 0x90,
+        "unexpected data %02x %02x.\n", dst[0], dst[1]);
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        scale_bitmap(&GUID_WICPixelFormat8bppGray, 8, 4, stripes, 2, modes[i], dst);
+        ok(dst[0] > 0x20 && dst[0] < 0xe0 && dst[1] > 0x20 && dst[1] < 0xe0,
+            "%u: unexpected data %02x %02x.\n", modes[i], dst[0], dst[1]);
+    }
+}
+
+static void test_bitmap_scaler_formats(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeFant,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    static const struct
+    {
+        const WICPixelFormatGUID *format;
+        UINT width, stride;
+        BYTE src[4];
+        UINT size;
+        BYTE expected[8]; /* nearest neighbour, twice the width */
+    }
+    tests[] =
+    {
+        { &GUID_WICPixelFormatBlackWhite, 4, 1, { 0xb0 }, 1, { 0xcf } },
+        { &GUID_WICPixelFormat4bppGray, 3, 2, { 0x1e, 0x70 }, 3, { 0x11, 0xee, 0x77 } },
+        { &GUID_WICPixelFormat16bppBGR555, 2, 4, { 0x00, 0x00, 0xff, 0x7f },
+          8, { 0x00, 0x00, 0x00, 0x00, 0xff, 0x7f, 0xff, 0x7f } },
+    };
+    WICPixelFormatGUID pixel_format;
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE dst[8];
+    UINT i, j;
+    HRESULT hr;
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        hr = IWICImagingFactory_CreateBitmapFromMemory(factory, tests[i].width, 1, tests[i].format,
+            tests[i].stride, tests[i].stride, (BYTE *)tests[i].src, &bitmap);
+        ok(hr == S_OK, "%u: Failed to create a bitmap, hr %#x.\n", i, hr);
+
+        for (j = 0; j < ARRAY_SIZE(modes); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+            hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, tests[i].width * 2, 1, modes[j]);
+            ok(hr == S_OK, "%u,%u: Failed to initialize bitmap scaler, hr %#x.\n", i, modes[j], hr);
+
+            /* The scaler never changes the pixel format */
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &pixel_format);
+            ok(hr == S_OK, "Failed to get pixel format, hr %#x.\n", hr);
+            ok(IsEqualGUID(&pixel_format, tests[i].format), "%u,%u: Unexpected pixel format %s.\n",
+                i, modes[j], wine_dbgstr_guid(&pixel_format));
+
+            memset(dst, 0xcc, sizeof(dst));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, tests[i].stride * 2, sizeof(dst), dst);
+            ok(hr == S_OK, "%u,%u: Failed to copy pixels, hr %#x.\n", i, modes[j], hr);
+
+            if (modes[j] == WICBitmapInterpolationModeNearestNeighbor)
+                ok(!memcmp(dst, tests[i].expected, tests[i].size), "%u: Unexpected data %02x %02x.\n",
+                    i, dst[0], dst[1]);
+
+            IWICBitmapScaler_Release(scaler);
+        }
+
+        IWICBitmap_Release(bitmap);
+    }
+}
+
+static void test_bitmap_scaler_modes(void)
+{
+    static const WICBitmapInterpolationMode modes[] =
+    {
+        WICBitmapInterpolationModeNearestNeighbor,
+        WICBitmapInterpolationModeLinear,
+        WICBitmapInterpolationModeCubic,
+        WICBitmapInterpolationModeFant,
+        WICBitmapInterpolationModeHighQualityCubic,
+    };
+    static const UINT sizes[][2] = { { 3, 5 }, { 1, 1 }, { 40, 24 } };
+    WICPixelFormatGUID pixel_format;
+    IWICBitmapScaler *scaler;
+    IWICBitmap *bitmap;
+    BYTE src[8 * 6 * 4], dst[40 * 24 * 4 + 1];
+    WICRect rc;
+    UINT i, j, k;
+    HRESULT hr;
+
+    for (i = 0; i < sizeof(src); i += 4)
+    {
+        src[i] = 0x10;
+        src[i + 1] = 0x80;
+        src[i + 2] = 0xf0;
+        src[i + 3] = 0xff;
+    }
+
+    hr = IWICImagingFactory_CreateBitmapFromMemory(factory, 8, 6, &GUID_WICPixelFormat32bppBGRA,
+        8 * 4, sizeof(src), src, &bitmap);
+    ok(hr == S_OK, "Failed to create a bitmap, hr %#x.\n", hr);
+
+    /* A flat image stays flat whatever the filter */
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+    {
+        for (j = 0; j < ARRAY_SIZE(sizes); j++)
+        {
+            hr = IWICImagingFactory_CreateBitmapScaler(factory, &scaler);
+            ok(hr == S_OK, "Failed to create bitmap scaler, hr %#x.\n", hr);
+
+            hr = IWICBitmapScaler_Initialize(scaler, (IWICBitmapSource *)bitmap, sizes[j][0], sizes[j][1], modes[i]);
+            ok(hr == S_OK, "%u: Failed to initialize bitmap scaler, hr %#x.\n", modes[i], hr);
+
+            hr = IWICBitmapScaler_GetPixelFormat(scaler, &pixel_format);
+            ok(hr == S_OK, "Failed to get pixel format, hr %#x.\n", hr);
+            ok(IsEqualGUID(&pixel_format, &GUID_WICPixelFormat32bppBGRA), "%u: Unexpected pixel format %s.\n",
+                modes[i], wine_dbgstr_guid(&pixel_format));
+
+            memset(dst, 0xcc, sizeof(dst));
+            hr = IWICBitmapScaler_CopyPixels(scaler, NULL, sizes[j][0] * 4, sizeof(dst), dst);
+            ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+
+            for (k = 0; k < sizes[j][0] * sizes[j][1] * 4; k++)
+                if (dst[k] != src[k % 4]) break;
+            ok(k == sizes[j][0] * sizes[j][1] * 4, "%u: %ux%u: unexpected data %#x at %u.\n",
+                modes[i], sizes[j][0], sizes[j][1], dst[k], k);
+
+            /* Scanlines one at a time, as recommended by MSDN */
+            if (sizes[j][1] > 1)
+            {
+                memset(dst, 0xcc, sizeof(dst));
+                rc.X = 1;
+                rc.Width = sizes[j][0] - 1;
+                rc.Height = 1;
+                for (rc.Y = 0; rc.Y < sizes[j][1]; rc.Y++)
+                {
+                    hr = IWICBitmapScaler_CopyPixels(scaler, &rc, rc.Width * 4, rc.Width * 4, dst + rc.Y * rc.Width * 4);
+                    ok(hr == S_OK, "%u: Failed to copy pixels, hr %#x.\n", modes[i], hr);
+                }
+
+                for (k = 0; k < rc.Width * sizes[j][1] * 4; k++)
+                    if (dst[k] != src[k % 4]) break;
+                ok(k == rc.Width * sizes[j][1] * 4, "%u: %ux%u: unexpected data %#x at %u.\n",
+                    modes[i], sizes[j][0], sizes[j][1], dst[k], k);
+            }
+
+            IWICBitmapScaler_Release(scaler);
+        }
+    }
+
+    IWICBitmap_Release(bitmap);
+}
+
 static LONG obj_refcount(void *obj)
 {
     IUnknown_AddRef((IUnknown *)obj);
@@ -1484,6 +1706,9 @@ START_TEST(bitmap)
     test_CreateBitmapFromHBITMAP();
     test_clipper();
     test_bitmap_scaler();
+    test_bitmap_scaler_modes();
+    test_bitmap_scaler_filters();
+    test_bitmap_scaler_formats();
 
     IWICImagingFactory_Release(factory);
 
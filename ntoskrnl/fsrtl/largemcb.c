@@ -22,95 +22,190 @@
 PAGED_LOOKASIDE_LIST FsRtlFirstMappingLookasideList;
 NPAGED_LOOKASIDE_LIST FsRtlFastMutexLookasideList;
 
-/* We use only real 'mapping' runs; we do not store 'holes' to our GTree. */
+/*
+ * The mapping is an array of runs sorted by Vbn, the way the original MCB
+ * package keeps it. Runs are contiguous from Vbn 0, holes are stored as runs
+ * mapping to Lbn -1 and the last run is never a hole. A run's index in the
+ * array is therefore the index FsRtlGetNextBaseMcbEntry() reports for it.
+ */
 typedef struct _LARGE_MCB_MAPPING_ENTRY // run
 {
     LARGE_INTEGER RunStartVbn;
     LARGE_INTEGER RunEndVbn;   /* RunStartVbn+SectorCount; that means +1 after the last sector */
-    LARGE_INTEGER StartingLbn; /* Lbn of 'RunStartVbn' */
+    LARGE_INTEGER StartingLbn; /* Lbn of 'RunStartVbn', -1 for a hole */
 } LARGE_MCB_MAPPING_ENTRY, *PLARGE_MCB_MAPPING_ENTRY;
 
-typedef struct _LARGE_MCB_MAPPING // mcb_priv
-{
-    RTL_GENERIC_TABLE Table;
-} LARGE_MCB_MAPPING, *PLARGE_MCB_MAPPING;
-
 typedef struct _BASE_MCB_INTERNAL {
     ULONG MaximumPairCount;
     ULONG PairCount;
     USHORT PoolType;
     USHORT Flags;
-    PLARGE_MCB_MAPPING Mapping;
+    PLARGE_MCB_MAPPING_ENTRY Mapping;
 } BASE_MCB_INTERNAL, *PBASE_MCB_INTERNAL;
 
-/*
-static LARGE_MCB_MAPPING_ENTRY StaticRunBelow0 = {
-    {{-1}}, // ignored
-    {{0}},
-    {{-1}}, // ignored
-};
-*/
-
-static PVOID NTAPI McbMappingAllocate(PRTL_GENERIC_TABLE Table, CLONG Bytes)
+#define McbRunCount(Run) ((Run)->RunEndVbn.QuadPart - (Run)->RunStartVbn.QuadPart)
+#define McbIsHole(Run)   ((Run)->StartingLbn.QuadPart == -1)
+
+static VOID McbFreeMapping(PBASE_MCB_INTERNAL Mcb)
 {
-    PVOID Result;
-    PBASE_MCB Mcb = (PBASE_MCB)Table->TableContext;
-    Result = ExAllocatePoolWithTag(Mcb->PoolType, Bytes, 'BCML');
-    DPRINT("McbMappingAllocate(%lu) => %p\n", Bytes, Result);
-    return Result;
+    /* Only the initial array comes from the lookaside list */
+    if (Mcb->PoolType == PagedPool && Mcb->MaximumPairCount == MAXIMUM_PAIR_COUNT)
+    {
+        ExFreeToPagedLookasideList(&FsRtlFirstMappingLookasideList, Mcb->Mapping);
+    }
+    else
+    {
+        ExFreePoolWithTag(Mcb->Mapping, 'CBSF');
+    }
 }
 
-static VOID NTAPI McbMappingFree(PRTL_GENERIC_TABLE Table, PVOID Buffer)
+static BOOLEAN McbGrowMapping(PBASE_MCB_INTERNAL Mcb, ULONG PairCount)
 {
-    DPRINT("McbMappingFree(%p)\n", Buffer);
-    ExFreePoolWithTag(Buffer, 'BCML');
+    PLARGE_MCB_MAPPING_ENTRY NewMapping;
+    ULONG NewMaximum;
+
+    if (PairCount <= Mcb->MaximumPairCount)
+        return TRUE;
+
+    NewMaximum = MAX(Mcb->MaximumPairCount, MAXIMUM_PAIR_COUNT);
+    while (NewMaximum < PairCount)
+        NewMaximum *= 2;
+
+    NewMapping = ExAllocatePoolWithTag(Mcb->PoolType, NewMaximum * sizeof(LARGE_MCB_MAPPING_ENTRY), 'CBSF');
+    DPRINT("McbGrowMapping(%p, %lu) => %p\n", Mcb, NewMaximum, NewMapping);
+    if (!NewMapping)
+        return FALSE;
+
+    RtlCopyMemory(NewMapping, Mcb->Mapping, Mcb->PairCount * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    McbFreeMapping(Mcb);
+    Mcb->Mapping = NewMapping;
+    Mcb->MaximumPairCount = NewMaximum;
+    return TRUE;
 }
 
-static
-RTL_GENERIC_COMPARE_RESULTS
-NTAPI
-McbMappingCompare(PRTL_GENERIC_TABLE Table,
-                  PVOID PtrA,
-                  PVOID PtrB)
+/* Returns the index of the first run ending after Vbn, or PairCount */
+static ULONG McbFindRun(PBASE_MCB_INTERNAL Mcb, LONGLONG Vbn)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    ASSERT(A);
-    ASSERT(B);
-
-    if (A->RunStartVbn.QuadPart == B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart == B->RunEndVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunEndVbn.QuadPart <= B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunEndVbn.QuadPart >= B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
-    else
+    ULONG Low = 0, High = Mcb->PairCount, Middle;
+
+    while (Low < High)
     {
-        ASSERT(FALSE);
-        Res = GenericEqual;
+        Middle = Low + (High - Low) / 2;
+        if (Mcb->Mapping[Middle].RunEndVbn.QuadPart > Vbn)
+            High = Middle;
+        else
+            Low = Middle + 1;
     }
 
-    return Res;
+    return Low;
 }
 
-static RTL_GENERIC_COMPARE_RESULTS NTAPI McbMappingIntersectCompare(PRTL_GENERIC_TABLE Table, PVOID PtrA, PVOID PtrB)
+static BOOLEAN McbCanMerge(PLARGE_MCB_MAPPING_ENTRY A, PLARGE_MCB_MAPPING_ENTRY B)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    if (A->RunStartVbn.QuadPart <= B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart >= B->RunStartVbn.QuadPart && B->RunEndVbn.QuadPart > A->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart < B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunStartVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
-    else
-        Res = GenericEqual;
+    if (McbIsHole(A) || McbIsHole(B))
+        return McbIsHole(A) && McbIsHole(B);
+
+    // NB: Two consecutive runs can only be merged, if actual LBNs also match!
+    return A->StartingLbn.QuadPart + McbRunCount(A) == B->StartingLbn.QuadPart;
+}
+
+/*
+ * Maps [StartVbn, EndVbn) to Lbn, or makes it a hole if Lbn is -1.
+ * The runs overlapping the range and their neighbours are rebuilt in a
+ * small buffer, merged, and spliced back into the array in one move.
+ */
+static BOOLEAN McbSetRange(PBASE_MCB_INTERNAL Mcb, LONGLONG StartVbn, LONGLONG EndVbn, LONGLONG Lbn)
+{
+    LARGE_MCB_MAPPING_ENTRY Runs[6];
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    ULONG First, Last, Count = 0, i, j;
+    LONGLONG MappedEnd;
+
+    MappedEnd = Mcb->PairCount ? Mcb->Mapping[Mcb->PairCount - 1].RunEndVbn.QuadPart : 0;
+    if (Lbn == -1)
+    {
+        /* Anything after the last run is already a hole */
+        EndVbn = MIN(EndVbn, MappedEnd);
+        if (StartVbn >= EndVbn)
+            return TRUE;
+    }
+
+    /* Runs overlapping the range, plus one neighbour on each side */
+    First = McbFindRun(Mcb, StartVbn);
+    Last = McbFindRun(Mcb, EndVbn - 1);
+    if (Last < Mcb->PairCount)
+        Last++;
+    if (First > 0)
+        First--;
+    if (Last < Mcb->PairCount)
+        Last++;
+
+    /* What is left of them below the range */
+    for (i = First; i < Last; i++)
+    {
+        Run = &Mcb->Mapping[i];
+        if (Run->RunStartVbn.QuadPart >= StartVbn)
+            break;
+
+        Runs[Count] = *Run;
+        Runs[Count].RunEndVbn.QuadPart = MIN(Run->RunEndVbn.QuadPart, StartVbn);
+        Count++;
+    }
+
+    if (StartVbn > MappedEnd)
+    {
+        Runs[Count].RunStartVbn.QuadPart = MappedEnd;
+        Runs[Count].RunEndVbn.QuadPart = StartVbn;
+        Runs[Count].StartingLbn.QuadPart = -1;
+        Count++;
+    }
+
+    Runs[Count].RunStartVbn.QuadPart = StartVbn;
+    Runs[Count].RunEndVbn.QuadPart = EndVbn;
+    Runs[Count].StartingLbn.QuadPart = Lbn;
+    Count++;
+
+    /* What is left of them above the range */
+    for (i = First; i < Last; i++)
+    {
+        Run = &Mcb->Mapping[i];
+        if (Run->RunEndVbn.QuadPart <= EndVbn)
+            continue;
+
+        Runs[Count] = *Run;
+        if (Run->RunStartVbn.QuadPart < EndVbn)
+        {
+            Runs[Count].RunStartVbn.QuadPart = EndVbn;
+            if (!McbIsHole(Run))
+                Runs[Count].StartingLbn.QuadPart += EndVbn - Run->RunStartVbn.QuadPart;
+        }
+        Count++;
+    }
+
+    /* Merge adjacent holes and runs with contiguous LBNs */
+    for (i = 0, j = 1; j < Count; j++)
+    {
+        if (McbCanMerge(&Runs[i], &Runs[j]))
+            Runs[i].RunEndVbn = Runs[j].RunEndVbn;
+        else
+            Runs[++i] = Runs[j];
+    }
+    Count = i + 1;
+
+    /* The mapping never ends with a hole */
+    if (Last == Mcb->PairCount && McbIsHole(&Runs[Count - 1]))
+        Count--;
+
+    if (!McbGrowMapping(Mcb, Mcb->PairCount - (Last - First) + Count))
+        return FALSE;
+
+    RtlMoveMemory(&Mcb->Mapping[First + Count],
+                  &Mcb->Mapping[Last],
+                  (Mcb->PairCount - Last) * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    RtlCopyMemory(&Mcb->Mapping[First], Runs, Count * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    Mcb->PairCount = Mcb->PairCount - (Last - First) + Count;
 
-    return Res;
+    return TRUE;
 }
 
 
@@ -140,9 +235,6 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     BOOLEAN Result = TRUE;
     BOOLEAN IntResult;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY Node, NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY LowerRun, HigherRun;
-    BOOLEAN NewElement;
     LONGLONG IntLbn, IntSectorCount;
 
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d)\n", OpaqueMcb, Vbn, Lbn, SectorCount);
@@ -175,105 +267,9 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         }
     }
 
-    /* clean any possible previous entries in our range */
-    FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, SectorCount);
-
-    // We need to map [Vbn, Vbn+SectorCount) to [Lbn, Lbn+SectorCount),
-    // taking in account the fact that we need to merge these runs if
-    // they are adjacent or overlap, but fail if new run fully fits into another run
-
-    /* initially we think we will be inserted as a separate run */
-    Node.RunStartVbn.QuadPart = Vbn;
-    Node.RunEndVbn.QuadPart = Vbn + SectorCount;
-    Node.StartingLbn.QuadPart = Lbn;
-
-    /* optionally merge with lower run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunStartVbn.QuadPart - 1;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    NeedleRun.StartingLbn.QuadPart = ~0ULL;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((LowerRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (LowerRun->StartingLbn.QuadPart + (LowerRun->RunEndVbn.QuadPart - LowerRun->RunStartVbn.QuadPart) == Node.StartingLbn.QuadPart))
-    {
-        ASSERT(LowerRun->RunEndVbn.QuadPart == Node.RunStartVbn.QuadPart);
-        Node.RunStartVbn.QuadPart = LowerRun->RunStartVbn.QuadPart;
-        Node.StartingLbn.QuadPart = LowerRun->StartingLbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, LowerRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting lower run found (%I64d,%I64d) Lbn: %I64d\n", LowerRun->RunStartVbn.QuadPart, LowerRun->RunEndVbn.QuadPart, LowerRun->StartingLbn.QuadPart);
-    }
-
-    /* optionally merge with higher run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunEndVbn.QuadPart;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((HigherRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (Node.StartingLbn.QuadPart <= HigherRun->StartingLbn.QuadPart))
-    {
-        ASSERT(HigherRun->RunStartVbn.QuadPart == Node.RunEndVbn.QuadPart);
-        Node.RunEndVbn.QuadPart = HigherRun->RunEndVbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HigherRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting higher run found (%I64d,%I64d) Lbn: %I64d\n", HigherRun->RunStartVbn.QuadPart, HigherRun->RunEndVbn.QuadPart, HigherRun->StartingLbn.QuadPart);
-    }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-
-    /* finally insert the resulting run */
-    RtlInsertElementGenericTable(&Mcb->Mapping->Table, &Node, sizeof(Node), &NewElement);
-    ++Mcb->PairCount;
-    ASSERT(NewElement);
-
-    // NB: Two consecutive runs can only be merged, if actual LBNs also match!
-
-    /* 1.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |/////////////|
-                |
-                Node->RunStartVbn
-
-        2.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |//////|
-        |
-        Node->RunStartVbn
-
-        3.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |///|
-                |
-                Node->RunStartVbn
-
-        4.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |///////////////|
-        |
-        Node->RunStartVbn
-
-
-    Situation with holes:
-    1. Holes at both ends
-    2. Hole at the right, new run merged with the previous run
-    3. Hole at the right, new run is not merged with the previous run
-    4. Hole at the left, new run merged with the next run
-    5. Hole at the left, new run is not merged with the next run
-    6. No holes, exact fit to merge with both previous and next runs
-    7. No holes, merges only with the next run
-    8. No holes, merges only with the previous run
-    9. No holes, does not merge with next or prev runs
-
-
-    Overwriting existing mapping is not possible and results in FALSE being returned
-    */
+    /* Replace anything previously in our range, merging with the
+     * adjacent runs if their LBNs are contiguous */
+    Result = McbSetRange(Mcb, Vbn, Vbn + SectorCount, Lbn);
 
 quit:
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d) = %d\n", Mcb, Vbn, Lbn, SectorCount, Result);
@@ -322,7 +318,6 @@ FsRtlAddLargeMcbEntry(IN PLARGE_MCB Mcb,
  * Retrieves the parameters of the specified run with index @RunIndex.
  *
  * Mapping %0 always starts at virtual block %0, either as 'hole' or as 'real' mapping.
- * libcaptive does not store 'hole' information to its #GTree.
  * Last run is always a 'real' run. 'hole' runs appear as mapping to constant @Lbn value %-1.
  *
  * Returns: %TRUE if successful.
@@ -337,49 +332,18 @@ FsRtlGetNextBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
 {
     BOOLEAN Result = FALSE;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run = NULL;
-    ULONG CurrentIndex = 0;
-    ULONGLONG LastVbn = 0;
-    ULONGLONG LastSectorCount = 0;
-
-    // Traverse the tree
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-    Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        // is the current index a hole?
-        if (Run->RunStartVbn.QuadPart > (LastVbn + LastSectorCount))
-        {
-            // Is this the index we're looking for?
-            if (RunIndex == CurrentIndex)
-            {
-                *Vbn = LastVbn + LastSectorCount;
-                *Lbn = -1;
-                *SectorCount = Run->RunStartVbn.QuadPart - *Vbn;
+    PLARGE_MCB_MAPPING_ENTRY Run;
 
-                Result = TRUE;
-                goto quit;
-            }
-
-            CurrentIndex++;
-        }
-
-        if (RunIndex == CurrentIndex)
-        {
-            *Vbn = Run->RunStartVbn.QuadPart;
-            *Lbn = Run->StartingLbn.QuadPart;
-            *SectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
-
-            Result = TRUE;
-            goto quit;
-        }
+    if (RunIndex < Mcb->PairCount)
+    {
+        Run = &Mcb->Mapping[RunIndex];
+        *Vbn = Run->RunStartVbn.QuadPart;
+        *Lbn = Run->StartingLbn.QuadPart;
+        *SectorCount = McbRunCount(Run);
 
-        CurrentIndex++;
-        LastVbn = Run->RunStartVbn.QuadPart;
-        LastSectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+        Result = TRUE;
     }
 
-quit:
     DPRINT("FsRtlGetNextBaseMcbEntry(%p, %d, %p, %p, %p) = %d (%I64d, %I64d, %I64d)\n", Mcb, RunIndex, Vbn, Lbn, SectorCount, Result, *Vbn, *Lbn, *SectorCount);
     return Result;
 }
@@ -429,18 +393,13 @@ FsRtlInitializeBaseMcb(IN PBASE_MCB OpaqueMcb,
     else
     {
         Mcb->Mapping = ExAllocatePoolWithTag(PoolType | POOL_RAISE_IF_ALLOCATION_FAILURE,
-                                             sizeof(LARGE_MCB_MAPPING),
+                                             MAXIMUM_PAIR_COUNT * sizeof(LARGE_MCB_MAPPING_ENTRY),
                                              'CBSF');
     }
 
     Mcb->PoolType = PoolType;
     Mcb->PairCount = 0;
     Mcb->MaximumPairCount = MAXIMUM_PAIR_COUNT;
-    RtlInitializeGenericTable(&Mcb->Mapping->Table,
-                              McbMappingCompare,
-                              McbMappingAllocate,
-                              McbMappingFree,
-                              Mcb);
 }
 
 /*
@@ -483,7 +442,7 @@ FsRtlInitializeLargeMcbs(VOID)
                                    NULL,
                                    NULL,
                                    POOL_RAISE_IF_ALLOCATION_FAILURE,
-                                   sizeof(LARGE_MCB_MAPPING),
+                                   MAXIMUM_PAIR_COUNT * sizeof(LARGE_MCB_MAPPING_ENTRY),
                                    IFS_POOL_TAG,
                                    0); /* FIXME: Should be 4 */
 
@@ -511,39 +470,37 @@ FsRtlLookupBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     OUT PULONG Index OPTIONAL)
 {
     BOOLEAN Result = FALSE;
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+    PLARGE_MCB_MAPPING_ENTRY Run;
     ULONG i;
-    LONGLONG LastVbn = 0, LastLbn = 0, Count = 0;   // the last values we've found during traversal
 
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p)\n", OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index);
 
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &LastVbn, &LastLbn, &Count); i++)
+    i = McbFindRun(Mcb, Vbn);
+    if (i < Mcb->PairCount && Vbn >= 0)
     {
-        // have we reached the target mapping?
-        if (Vbn < LastVbn + Count)
+        Run = &Mcb->Mapping[i];
+
+        if (Lbn)
         {
-            if (Lbn)
-            {
-                if (LastLbn == -1)
-                    *Lbn = -1;
-                else
-                    *Lbn = LastLbn + (Vbn - LastVbn);
-            }
-
-            if (SectorCountFromLbn)
-                *SectorCountFromLbn = LastVbn + Count - Vbn;
-            if (StartingLbn)
-                *StartingLbn = LastLbn;
-            if (SectorCountFromStartingLbn)
-                *SectorCountFromStartingLbn = LastVbn + Count - LastVbn;
-            if (Index)
-                *Index = i;
-
-            Result = TRUE;
-            goto quit;
+            if (McbIsHole(Run))
+                *Lbn = -1;
+            else
+                *Lbn = Run->StartingLbn.QuadPart + (Vbn - Run->RunStartVbn.QuadPart);
         }
+
+        if (SectorCountFromLbn)
+            *SectorCountFromLbn = Run->RunEndVbn.QuadPart - Vbn;
+        if (StartingLbn)
+            *StartingLbn = Run->StartingLbn.QuadPart;
+        if (SectorCountFromStartingLbn)
+            *SectorCountFromStartingLbn = McbRunCount(Run);
+        if (Index)
+            *Index = i;
+
+        Result = TRUE;
     }
 
-quit:
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p) = %d (%I64d, %I64d, %I64d, %I64d, %d)\n",
            OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index, Result,
            (Lbn ? *Lbn : (ULONGLONG)-1), (SectorCountFromLbn ? *SectorCountFromLbn : (ULONGLONG)-1), (StartingLbn ? *StartingLbn : (ULONGLONG)-1),
@@ -594,47 +551,27 @@ FsRtlLookupLastLargeMcbEntryAndIndex_internal(IN PBASE_MCB_INTERNAL Mcb,
                                               OUT PLONGLONG Lbn,
                                               OUT PULONG Index OPTIONAL)
 {
-    ULONG RunIndex = 0;
-    PLARGE_MCB_MAPPING_ENTRY Run, RunFound = NULL;
-    LONGLONG LastVbn = 0;
-
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        /* Take care when we must emulate missing 'hole' runs. */
-        if (Run->RunStartVbn.QuadPart > LastVbn)
-        {
-            RunIndex++;
-        }
-        LastVbn = Run->RunEndVbn.QuadPart;
-        RunIndex++;
-        RunFound = Run;
-    }
+    PLARGE_MCB_MAPPING_ENTRY RunFound;
 
-    if (!RunFound)
+    if (!Mcb->PairCount)
     {
         return FALSE;
     }
 
+    /* The last run is never a hole */
+    RunFound = &Mcb->Mapping[Mcb->PairCount - 1];
+
     if (Vbn)
     {
         *Vbn = RunFound->RunEndVbn.QuadPart - 1;
     }
     if (Lbn)
     {
-        if (1)
-        {
-            *Lbn = RunFound->StartingLbn.QuadPart + (RunFound->RunEndVbn.QuadPart - RunFound->RunStartVbn.QuadPart) - 1;
-        }
-        else
-        {
-            *Lbn = ~0ULL;
-        }
+        *Lbn = RunFound->StartingLbn.QuadPart + McbRunCount(RunFound) - 1;
     }
     if (Index)
     {
-        *Index = RunIndex - 1;
+        *Index = Mcb->PairCount - 1;
     }
 
     return TRUE;
@@ -741,17 +678,12 @@ ULONG
 NTAPI
 FsRtlNumberOfRunsInBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
-    ULONG NumberOfRuns = 0;
-    LONGLONG Vbn, Lbn, Count;
-    int i;
+    ULONG NumberOfRuns;
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p)\n", OpaqueMcb);
 
-    // Count how many Mcb entries there are
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &Vbn, &Lbn, &Count); i++)
-    {
-        NumberOfRuns++;
-    }
+    /* Holes are stored as runs too */
+    NumberOfRuns = OpaqueMcb->PairCount;
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p) = %d\n", OpaqueMcb, NumberOfRuns);
     return NumberOfRuns;
@@ -797,8 +729,6 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
                         IN LONGLONG SectorCount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY HaystackRun;
     BOOLEAN Result = TRUE;
 
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, SectorCount);
@@ -815,82 +745,8 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         goto quit;
     }
 
-    NeedleRun.RunStartVbn.QuadPart = Vbn;
-    NeedleRun.RunEndVbn.QuadPart = Vbn + SectorCount;
-    NeedleRun.StartingLbn.QuadPart = -1;
-
-    /* adjust/destroy all intersecting ranges */
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    while ((HaystackRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)))
-    {
-        if (HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunStartVbn.QuadPart)
-        {
-            LONGLONG HaystackRunEnd = HaystackRun->RunEndVbn.QuadPart;
-            ASSERT(HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunStartVbn.QuadPart);
-
-            HaystackRun->RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart;
-
-            if (HaystackRunEnd > NeedleRun.RunEndVbn.QuadPart)
-            {
-                /* The run we are deleting is included in the run we just truncated.
-                 * Add the tail back. */
-                LARGE_MCB_MAPPING_ENTRY TailRun;
-                BOOLEAN NewElement;
-
-                TailRun.RunStartVbn.QuadPart = NeedleRun.RunEndVbn.QuadPart;
-                TailRun.RunEndVbn.QuadPart = HaystackRunEnd;
-                TailRun.StartingLbn.QuadPart = HaystackRun->StartingLbn.QuadPart + (NeedleRun.RunEndVbn.QuadPart - HaystackRun->RunStartVbn.QuadPart);
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-
-                RtlInsertElementGenericTable(&Mcb->Mapping->Table, &TailRun, sizeof(TailRun), &NewElement);
-                ++Mcb->PairCount;
-                ASSERT(NewElement);
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-            }
-        }
-        else if (HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunEndVbn.QuadPart)
-        {
-            LONGLONG HaystackRunStart = HaystackRun->RunStartVbn.QuadPart;
-            LONGLONG HaystackStartingLbn = HaystackRun->StartingLbn.QuadPart;
-
-            ASSERT(HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunEndVbn.QuadPart);
-            HaystackRun->RunStartVbn.QuadPart = NeedleRun.RunEndVbn.QuadPart;
-            /* Adjust the starting LBN */
-            HaystackRun->StartingLbn.QuadPart += NeedleRun.RunEndVbn.QuadPart - HaystackRunStart;
-
-            if (HaystackRunStart < NeedleRun.RunStartVbn.QuadPart)
-            {
-                /* The run we are deleting is included in the run we just truncated.
-                 * Add the head back. */
-                LARGE_MCB_MAPPING_ENTRY HeadRun;
-                BOOLEAN NewElement;
-
-                HeadRun.RunStartVbn.QuadPart = HaystackRunStart;
-                HeadRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart;
-                HeadRun.StartingLbn.QuadPart = HaystackStartingLbn;
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-
-                RtlInsertElementGenericTable(&Mcb->Mapping->Table, &HeadRun, sizeof(HeadRun), &NewElement);
-                ++Mcb->PairCount;
-                ASSERT(NewElement);
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-            }
-        }
-        else
-        {
-            //ASSERT(NeedleRun.RunStartVbn.QuadPart >= HaystackRun->RunStartVbn.QuadPart);
-            //ASSERT(NeedleRun.RunEndVbn.QuadPart <= HaystackRun->RunEndVbn.QuadPart);
-            Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-            RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HaystackRun);
-            --Mcb->PairCount;
-            Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-        }
-    }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
+    /* Punch a hole; this truncates or splits the intersecting runs */
+    Result = McbSetRange(Mcb, Vbn, Vbn + SectorCount, -1);
 
 quit:
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, SectorCount, Result);
@@ -920,19 +776,10 @@ VOID
 NTAPI
 FsRtlResetBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
-    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Element;
-
     DPRINT("FsRtlResetBaseMcb(%p)\n", OpaqueMcb);
 
-    while (RtlNumberGenericTableElements(&Mcb->Mapping->Table) &&
-           (Element = (PLARGE_MCB_MAPPING_ENTRY)RtlGetElementGenericTable(&Mcb->Mapping->Table, 0)))
-    {
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, Element);
-    }
-
-    Mcb->PairCount = 0;
-    Mcb->MaximumPairCount = 0;
+    /* Keep the array, it will most likely be refilled */
+    OpaqueMcb->PairCount = 0;
 }
 
 /*
@@ -955,7 +802,7 @@ FsRtlResetLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 BOOLEAN
 NTAPI
@@ -964,50 +811,75 @@ FsRtlSplitBaseMcb(IN PBASE_MCB OpaqueMcb,
                   IN LONGLONG Amount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run, InsertLowerRun = NULL, ExistingRun = NULL;
-    BOOLEAN NewElement;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    ULONG i, First;
 
     DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, Amount);
 
-    /* Traverse the tree */
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
+    if (Vbn < 0 || Amount <= 0)
+        return FALSE;
+
+    First = McbFindRun(Mcb, Vbn);
+    if (First == Mcb->PairCount)
     {
-        /* unaffected run? */
-        /* FIXME: performance: effective skip of all 'lower' runs without traversing them */
-        if (Vbn >= Run->RunEndVbn.QuadPart) { DPRINT("Skipping it\n"); continue; }
-
-        /* crossing run to be split?
-        * 'lower_run' is created on the original place; just shortened.
-        * current 'run' is shifted up later
-        */
-        if (Vbn < Run->RunEndVbn.QuadPart)
-        {
-            /* FIXME: shift 'run->Lbn_start' ? */
-            Run->RunStartVbn.QuadPart = Vbn;
+        /* Nothing is mapped at or after Vbn */
+        return TRUE;
+    }
 
-            InsertLowerRun = NULL;
-        }
+    if (Mcb->Mapping[Mcb->PairCount - 1].RunEndVbn.QuadPart + Amount <
+        Mcb->Mapping[Mcb->PairCount - 1].RunEndVbn.QuadPart)
+    {
+        /* overflow */
+        return FALSE;
+    }
 
-        /* Shift the current 'run'.
-        * Ordering is not changed in Generic Tree so I hope I do not need to reinsert it.
-        */
-        Run->RunStartVbn.QuadPart += Amount;
-        ASSERT(Run->RunEndVbn.QuadPart + Amount > Run->RunEndVbn.QuadPart); /* overflow? */
+    /* One run for the split run's upper part, one for the new hole */
+    if (!McbGrowMapping(Mcb, Mcb->PairCount + 2))
+        return FALSE;
+
+    Run = &Mcb->Mapping[First];
+    if (McbIsHole(Run))
+    {
+        /* Vbn is in a hole, just make it larger */
         Run->RunEndVbn.QuadPart += Amount;
-        /* FIXME: shift 'run->Lbn_start' ? */
+        First++;
+    }
+    else if (Run->RunStartVbn.QuadPart < Vbn)
+    {
+        /* Split the crossing run at Vbn */
+        RtlMoveMemory(Run + 1, Run, (Mcb->PairCount - First) * sizeof(*Run));
+        Mcb->PairCount++;
+
+        Run->RunEndVbn.QuadPart = Vbn;
+        Run++;
+        Run->StartingLbn.QuadPart += Vbn - Run->RunStartVbn.QuadPart;
+        Run->RunStartVbn.QuadPart = Vbn;
+        First++;
+    }
 
-        /* continue the traversal */
+    /* Shift everything above Vbn */
+    for (i = First; i < Mcb->PairCount; i++)
+    {
+        Mcb->Mapping[i].RunStartVbn.QuadPart += Amount;
+        Mcb->Mapping[i].RunEndVbn.QuadPart += Amount;
     }
 
-    if (InsertLowerRun)
+    /* Unless done above, turn the gap into a hole */
+    if (First > 0 && McbIsHole(&Mcb->Mapping[First - 1]))
     {
-        ExistingRun = RtlInsertElementGenericTable(&Mcb->Mapping->Table, InsertLowerRun, sizeof(*InsertLowerRun), &NewElement);
-        ++Mcb->PairCount;
+        if (Mcb->Mapping[First - 1].RunEndVbn.QuadPart == Vbn)
+            Mcb->Mapping[First - 1].RunEndVbn.QuadPart += Amount;
     }
+    else
+    {
+        Run = &Mcb->Mapping[First];
+        RtlMoveMemory(Run + 1, Run, (Mcb->PairCount - First) * sizeof(*Run));
+        Mcb->PairCount++;
 
-    ASSERT(ExistingRun == NULL);
+        Run->RunStartVbn.QuadPart = Vbn;
+        Run->RunEndVbn.QuadPart = Vbn + Amount;
+        Run->StartingLbn.QuadPart = -1;
+    }
 
     DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, Amount, TRUE);
 
@@ -1039,7 +911,7 @@ FsRtlSplitLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
@@ -1048,7 +920,8 @@ FsRtlTruncateBaseMcb(IN PBASE_MCB OpaqueMcb,
 {
     DPRINT("FsRtlTruncateBaseMcb(%p, %I64d)\n", OpaqueMcb, Vbn);
 
-    FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, MAXLONG - Vbn + 1);
+    if (Vbn >= 0)
+        McbSetRange((PBASE_MCB_INTERNAL)OpaqueMcb, Vbn, MAXLONGLONG, -1);
 }
 
 /*
@@ -1076,16 +949,7 @@ FsRtlUninitializeBaseMcb(IN PBASE_MCB Mcb)
     DPRINT("FsRtlUninitializeBaseMcb(%p)\n", Mcb);
 
     FsRtlResetBaseMcb(Mcb);
-
-    if ((Mcb->PoolType == PagedPool)/* && (Mcb->MaximumPairCount == MAXIMUM_PAIR_COUNT)*/)
-    {
-        ExFreeToPagedLookasideList(&FsRtlFirstMappingLookasideList,
-                                   Mcb->Mapping);
-    }
-    else
-    {
-        ExFreePoolWithTag(Mcb->Mapping, 'CBSF');
-    }
+    McbFreeMapping((PBASE_MCB_INTERNAL)Mcb);
 }
 
 /*
@@ -68,6 +68,9 @@ typedef struct _KI_SAMPLE_MAP
 
 #define MAX_TIMER_DPCS                      16
 
+/* How many ticks ahead the idle loop looks for due timers */
+#define KI_IDLE_TIMER_TICKS                 16
+
 typedef struct _DPC_QUEUE_ENTRY
 {
     PKDPC Dpc;
@@ -283,6 +286,12 @@ KiInsertTimerTable(
     IN ULONG Hand
 );
 
+ULONGLONG
+FASTCALL
+KiGetNextTimerDueTime(
+    VOID
+);
+
 VOID
 FASTCALL
 KiTimerListExpire(
@@ -21,6 +21,7 @@
 #define LPC_REPLY_DEBUG                                     0x10
 #define LPC_COMPLETE_DEBUG                                  0x20
 #define LPC_SEND_DEBUG                                      0x40
+#define LPC_ALPC_DEBUG                                      0x80
 
 //
 // Debug/Tracing support
@@ -94,6 +95,17 @@ LpcpDeletePort(
     IN PVOID ObjectBody
 );
 
+NTSTATUS
+NTAPI
+LpcpCreatePort(
+    OUT PHANDLE PortHandle,
+    IN POBJECT_ATTRIBUTES ObjectAttributes,
+    IN ULONG MaxConnectionInfoLength,
+    IN ULONG MaxMessageLength,
+    IN ULONG MaxPoolUsage,
+    IN BOOLEAN Waitable
+);
+
 NTSTATUS
 NTAPI
 LpcpInitializePortQueue(
@@ -134,6 +146,30 @@ LpcExitThread(
     IN PETHREAD Thread
 );
 
+//
+// ALPC Section Views
+//
+VOID
+NTAPI
+AlpcpFlushThreadViews(
+    IN PETHREAD Thread
+);
+
+//
+// ALPC Completion Lists
+//
+VOID
+NTAPI
+AlpcpPostCompletionList(
+    IN PLPCP_PORT_OBJECT QueuePort
+);
+
+VOID
+NTAPI
+AlpcpRundownPort(
+    IN PLPCP_PORT_OBJECT Port
+);
+
 //
 // Initialization functions
 //
@@ -157,6 +193,8 @@ LpcpValidateClientPort(
 extern POBJECT_TYPE LpcPortObjectType;
 extern ULONG LpcpNextMessageId, LpcpNextCallbackId;
 extern KGUARDED_MUTEX LpcpLock;
+extern LIST_ENTRY AlpcpViewListHead;
+extern LIST_ENTRY AlpcpCompletionListHead;
 extern PAGED_LOOKASIDE_LIST LpcpMessagesLookaside;
 extern ULONG LpcpMaxMessageSize;
 extern ULONG LpcpTraceLevel;
@@ -294,3 +294,13 @@
     SVC_(QueryPortInformationProcess, 0)
     SVC_(GetCurrentProcessorNumber, 0)
     SVC_(WaitForMultipleObjects32, 5)
+    SVC_(AlpcAcceptConnectPort, 9)
+    SVC_(AlpcConnectPort, 11)
+    SVC_(AlpcCreatePort, 3)
+    SVC_(AlpcCreatePortSection, 6)
+    SVC_(AlpcCreateSectionView, 3)
+    SVC_(AlpcDeletePortSection, 3)
+    SVC_(AlpcDeleteSectionView, 3)
+    SVC_(AlpcSendWaitReceivePort, 8)
+    SVC_(AlpcImpersonateClientOfPort, 3)
+    SVC_(AlpcSetInformation, 4)
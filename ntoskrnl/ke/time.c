@@ -68,6 +68,7 @@ KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
     PKPRCB Prcb = KeGetCurrentPrcb();
     ULARGE_INTEGER CurrentTime, InterruptTime;
     LONG OldTickOffset;
+    ULONG Ticks;
 
     /* Check if this tick is being skipped */
     if (Prcb->SkipTick)
@@ -104,23 +105,37 @@ KeUpdateSystemTime(IN PKTRAP_FRAME TrapFrame,
     /* Check for full tick */
     if (OldTickOffset <= (LONG)Increment)
     {
-        /* Update the system time */
-        CurrentTime.QuadPart = *(ULONGLONG*)&SharedUserData->SystemTime;
-        CurrentTime.QuadPart += KeTimeAdjustment;
-        KiWriteSystemTime(&SharedUserData->SystemTime, CurrentTime);
+        /* When the HAL skipped clock interrupts in the idle loop, this
+           increment can cover several ticks, so do all of them */
+        Ticks = 0;
+        do
+        {
+            /* Update the system time */
+            CurrentTime.QuadPart = *(ULONGLONG*)&SharedUserData->SystemTime;
+            CurrentTime.QuadPart += KeTimeAdjustment;
+            KiWriteSystemTime(&SharedUserData->SystemTime, CurrentTime);
+
+            /* Update the tick count */
+            CurrentTime.QuadPart = (*(ULONGLONG*)&KeTickCount) + 1;
+            KiWriteSystemTime(&KeTickCount, CurrentTime);
 
-        /* Update the tick count */
-        CurrentTime.QuadPart = (*(ULONGLONG*)&KeTickCount) + 1;
-        KiWriteSystemTime(&KeTickCount, CurrentTime);
+            /* Update it in the shared user data */
+            KiWriteSystemTime(&SharedUserData->TickCount, CurrentTime);
 
-        /* Update it in the shared user data */
-        KiWriteSystemTime(&SharedUserData->TickCount, CurrentTime);
+            /* Check for expiration with the new tick count as well */
+            KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
 
-        /* Check for expiration with the new tick count as well */
-        KiCheckForTimerExpiration(Prcb, TrapFrame, InterruptTime);
+            /* Reset the tick offset */
+            KiTickOffset += KeMaximumIncrement;
+            Ticks++;
+        } while (KiTickOffset <= 0);
 
-        /* Reset the tick offset */
-        KiTickOffset += KeMaximumIncrement;
+        /* The skipped ticks were spent in the idle thread */
+        if (Ticks > 1)
+        {
+            Prcb->KernelTime += Ticks - 1;
+            Prcb->CurrentThread->KernelTime += Ticks - 1;
+        }
 
         /* Update processor/thread runtime */
         KeUpdateRunTime(TrapFrame, Irql);
@@ -196,6 +196,34 @@ KiCompleteTimer(IN PKTIMER Timer,
     if (RequestInterrupt) HalRequestSoftwareInterrupt(DISPATCH_LEVEL);
 }
 
+ULONGLONG
+FASTCALL
+KiGetNextTimerDueTime(VOID)
+{
+    ULONGLONG InterruptTime, DueTime;
+    ULONG TickCount, i;
+
+    /* Get the current time */
+    InterruptTime = KeQueryInterruptTime();
+    TickCount = KeTickCount.LowPart;
+
+    /* Walk the timer table from the current hand. Each entry holds the
+       earliest due time of its list, but the list can also hold timers
+       of later rounds through the table, so skip those. */
+    for (i = 0; i < KI_IDLE_TIMER_TICKS; i++)
+    {
+        DueTime = KiTimerTableListHead[(TickCount + i) & (TIMER_TABLE_SIZE - 1)].Time.QuadPart;
+        if (DueTime < InterruptTime + (ULONGLONG)(i + 2) * KeMaximumIncrement)
+        {
+            /* This one is due on this round */
+            return DueTime;
+        }
+    }
+
+    /* Nothing is due for a while */
+    return InterruptTime + (ULONGLONG)KI_IDLE_TIMER_TICKS * KeMaximumIncrement;
+}
+
 /* PUBLIC FUNCTIONS **********************************************************/
 
 /*
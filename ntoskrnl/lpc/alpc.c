@@ -0,0 +1,1935 @@
+/*
+ * PROJECT:     ReactOS Kernel
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Local Procedure Call: ALPC Ports, Message Attributes and Views
+ */
+
+/* INCLUDES ******************************************************************/
+
+#include <ntoskrnl.h>
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS *******************************************************************/
+
+#define ALPCP_VALID_MESSAGE_FLAGS   (ALPC_MSGFLG_REPLY_MESSAGE | \
+                                     ALPC_MSGFLG_LPC_MODE | \
+                                     ALPC_MSGFLG_RELEASE_MESSAGE | \
+                                     ALPC_MSGFLG_SYNC_REQUEST | \
+                                     ALPC_MSGFLG_WAIT_USER_MODE | \
+                                     ALPC_MSGFLG_WAIT_ALERTABLE)
+
+#define ALPCP_SEND_ATTRIBUTES       (ALPC_MESSAGE_VIEW_ATTRIBUTE | \
+                                     ALPC_MESSAGE_CONTEXT_ATTRIBUTE)
+
+//
+// A section sent along with a message, waiting to be mapped by its receiver.
+// The entry never outlives Thread: requests are flushed by their sender once
+// the reply is in, replies are taken by the client they are addressed to, and
+// both are flushed when the thread goes through LpcExitThread.
+//
+typedef struct _ALPCP_VIEW
+{
+    LIST_ENTRY ListEntry;
+    PETHREAD Thread;
+    ULONG MessageId;
+    BOOLEAN Reply;
+    PLPCP_PORT_OBJECT QueuePort;
+    PVOID Section;
+    SIZE_T ViewSize;
+} ALPCP_VIEW, *PALPCP_VIEW;
+
+//
+// The I/O completion port and completion list of a connection port. Posters
+// hold PostLock while they fill the list, the LPC lock nests inside it. The
+// port's own reference is dropped at rundown, when its last handle closes.
+//
+typedef struct _ALPCP_COMPLETION_LIST
+{
+    LIST_ENTRY ListEntry;
+    PLPCP_PORT_OBJECT Port;
+    LONG References;
+    BOOLEAN Rundown;
+    KGUARDED_MUTEX PostLock;
+    PVOID CompletionPort;
+    PVOID CompletionKey;
+    PEPROCESS Process;
+    PMDL Mdl;
+    PALPC_COMPLETION_LIST_HEADER Header;
+    PLONG State;
+    PLONG Queue;
+    PUCHAR Data;
+    ULONG AttributeFlags;
+    ULONG AttributeSize;
+    ULONG MessageSize;
+    ULONG EntrySize;
+    ULONG EntryCount;
+    ULONG NextEntry;
+    ULONG PostIndex;
+} ALPCP_COMPLETION_LIST, *PALPCP_COMPLETION_LIST;
+
+/* The attributes follow the header in this order, highest flag first */
+static const struct
+{
+    ULONG Attribute;
+    ULONG Size;
+} AlpcpAttributes[] =
+{
+    { ALPC_MESSAGE_SECURITY_ATTRIBUTE, sizeof(ALPC_SECURITY_ATTR) },
+    { ALPC_MESSAGE_VIEW_ATTRIBUTE, sizeof(ALPC_DATA_VIEW_ATTR) },
+    { ALPC_MESSAGE_CONTEXT_ATTRIBUTE, sizeof(ALPC_CONTEXT_ATTR) },
+    { ALPC_MESSAGE_HANDLE_ATTRIBUTE, sizeof(ALPC_HANDLE_ATTR) },
+    { ALPC_MESSAGE_TOKEN_ATTRIBUTE, sizeof(ALPC_TOKEN_ATTR) },
+    { ALPC_MESSAGE_DIRECT_ATTRIBUTE, sizeof(ALPC_DIRECT_ATTR) },
+};
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+static
+ULONG
+AlpcpGetAttributesSize(IN ULONG AllocatedAttributes)
+{
+    ULONG Size = sizeof(ALPC_MESSAGE_ATTRIBUTES);
+    ULONG i;
+
+    for (i = 0; i < RTL_NUMBER_OF(AlpcpAttributes); i++)
+    {
+        if (AllocatedAttributes & AlpcpAttributes[i].Attribute)
+            Size += AlpcpAttributes[i].Size;
+    }
+
+    return Size;
+}
+
+static
+PVOID
+AlpcpGetAttribute(IN PALPC_MESSAGE_ATTRIBUTES Attributes,
+                  IN ULONG AllocatedAttributes,
+                  IN ULONG Attribute)
+{
+    ULONG Offset = sizeof(ALPC_MESSAGE_ATTRIBUTES);
+    ULONG i;
+
+    /* Use the captured allocation, the buffer itself belongs to the caller */
+    if (!(AllocatedAttributes & Attribute)) return NULL;
+
+    for (i = 0; i < RTL_NUMBER_OF(AlpcpAttributes); i++)
+    {
+        if (AlpcpAttributes[i].Attribute == Attribute)
+            return (PUCHAR)Attributes + Offset;
+
+        if (AllocatedAttributes & AlpcpAttributes[i].Attribute)
+            Offset += AlpcpAttributes[i].Size;
+    }
+
+    return NULL;
+}
+
+static
+NTSTATUS
+AlpcpCheckPortHandle(IN HANDLE PortHandle,
+                     IN KPROCESSOR_MODE PreviousMode)
+{
+    PLPCP_PORT_OBJECT Port;
+    NTSTATUS Status;
+
+    Status = ObReferenceObjectByHandle(PortHandle,
+                                       0,
+                                       LpcPortObjectType,
+                                       PreviousMode,
+                                       (PVOID*)&Port,
+                                       NULL);
+    if (NT_SUCCESS(Status)) ObDereferenceObject(Port);
+    return Status;
+}
+
+static
+PLPCP_PORT_OBJECT
+AlpcpGetQueuePort(IN PLPCP_PORT_OBJECT Port)
+{
+    /* Same choice as NtRequestWaitReplyPort, the LPC lock must be held */
+    switch (Port->Flags & LPCP_PORT_TYPE_MASK)
+    {
+        case LPCP_CONNECTION_PORT:
+            return Port;
+
+        case LPCP_COMMUNICATION_PORT:
+            return Port->ConnectedPort;
+
+        default:
+            if (!Port->ConnectedPort) return NULL;
+            return Port->ConnectionPort;
+    }
+}
+
+static
+PLPCP_PORT_OBJECT
+AlpcpGetReceivePort(IN PLPCP_PORT_OBJECT Port)
+{
+    /* Same choice as NtReplyWaitReceivePortEx, the LPC lock must be held */
+    if ((Port->Flags & LPCP_PORT_TYPE_MASK) == LPCP_CLIENT_PORT) return Port;
+    return Port->ConnectionPort;
+}
+
+static
+VOID
+AlpcpFreeView(IN PALPCP_VIEW View)
+{
+    if (View->QueuePort) ObDereferenceObject(View->QueuePort);
+    ObDereferenceObject(View->Section);
+    ExFreePoolWithTag(View, 'VcpA');
+}
+
+static
+PALPCP_VIEW
+AlpcpAllocateView(IN PVOID Section,
+                  IN SIZE_T ViewSize)
+{
+    PALPCP_VIEW View;
+
+    View = ExAllocatePoolWithTag(PagedPool, sizeof(*View), 'VcpA');
+    if (!View) return NULL;
+
+    ObReferenceObject(Section);
+    View->Section = Section;
+    View->ViewSize = ViewSize;
+    View->QueuePort = NULL;
+    View->MessageId = 0;
+    return View;
+}
+
+static
+NTSTATUS
+AlpcpQueueRequestView(IN PLPCP_PORT_OBJECT Port,
+                      IN PVOID Section,
+                      IN SIZE_T ViewSize)
+{
+    PALPCP_VIEW View;
+
+    View = AlpcpAllocateView(Section, ViewSize);
+    if (!View) return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* The request has no ID yet, the receiver matches our reply wait */
+    View->Thread = PsGetCurrentThread();
+    View->Reply = FALSE;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    View->QueuePort = AlpcpGetQueuePort(Port);
+    if (!View->QueuePort)
+    {
+        KeReleaseGuardedMutex(&LpcpLock);
+        AlpcpFreeView(View);
+        return STATUS_PORT_DISCONNECTED;
+    }
+
+    ObReferenceObject(View->QueuePort);
+    InsertTailList(&AlpcpViewListHead, &View->ListEntry);
+
+    KeReleaseGuardedMutex(&LpcpLock);
+    return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+AlpcpQueueReplyView(IN PCLIENT_ID ClientId,
+                    IN ULONG MessageId,
+                    IN PVOID Section,
+                    IN SIZE_T ViewSize,
+                    OUT PETHREAD *ReplyThread)
+{
+    PETHREAD WakeupThread;
+    PALPCP_VIEW View;
+    NTSTATUS Status;
+
+    Status = PsLookupProcessThreadByCid(ClientId, NULL, &WakeupThread);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    View = AlpcpAllocateView(Section, ViewSize);
+    if (!View)
+    {
+        ObDereferenceObject(WakeupThread);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    View->Thread = WakeupThread;
+    View->MessageId = MessageId;
+    View->Reply = TRUE;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    /* Only queue it while the client still waits for this reply */
+    if (WakeupThread->LpcReplyMessageId != MessageId)
+    {
+        KeReleaseGuardedMutex(&LpcpLock);
+        AlpcpFreeView(View);
+        ObDereferenceObject(WakeupThread);
+        return STATUS_REPLY_MESSAGE_MISMATCH;
+    }
+
+    InsertTailList(&AlpcpViewListHead, &View->ListEntry);
+
+    KeReleaseGuardedMutex(&LpcpLock);
+    ObDereferenceObject(WakeupThread);
+
+    /* Only good for finding the view again, the thread isn't referenced */
+    *ReplyThread = WakeupThread;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+AlpcpCancelReplyView(IN PETHREAD Thread,
+                     IN ULONG MessageId)
+{
+    PLIST_ENTRY ListEntry;
+    PALPCP_VIEW View;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    /* The client may have exited and flushed it in the meantime */
+    for (ListEntry = AlpcpViewListHead.Flink;
+         ListEntry != &AlpcpViewListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        View = CONTAINING_RECORD(ListEntry, ALPCP_VIEW, ListEntry);
+        if ((View->Thread == Thread) &&
+            (View->MessageId == MessageId) &&
+            (View->Reply))
+        {
+            RemoveEntryList(&View->ListEntry);
+            KeReleaseGuardedMutex(&LpcpLock);
+            AlpcpFreeView(View);
+            return;
+        }
+    }
+
+    KeReleaseGuardedMutex(&LpcpLock);
+}
+
+static
+PALPCP_VIEW
+AlpcpRemoveRequestView(IN PLPCP_PORT_OBJECT ReceivePort,
+                       IN PCLIENT_ID ClientId,
+                       IN ULONG MessageId)
+{
+    PLIST_ENTRY ListEntry;
+    PALPCP_VIEW View;
+
+    /* The LPC lock must be held */
+    for (ListEntry = AlpcpViewListHead.Flink;
+         ListEntry != &AlpcpViewListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        View = CONTAINING_RECORD(ListEntry, ALPCP_VIEW, ListEntry);
+
+        /* The sender waits for the reply to exactly this message */
+        if (!(View->Reply) &&
+            (View->QueuePort == ReceivePort) &&
+            (View->Thread->Cid.UniqueThread == ClientId->UniqueThread) &&
+            (View->Thread->LpcReplyMessageId == MessageId))
+        {
+            RemoveEntryList(&View->ListEntry);
+            return View;
+        }
+    }
+
+    return NULL;
+}
+
+static
+PALPCP_VIEW
+AlpcpTakeRequestView(IN PLPCP_PORT_OBJECT Port,
+                     IN PCLIENT_ID ClientId,
+                     IN ULONG MessageId)
+{
+    PALPCP_VIEW View;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+    View = AlpcpRemoveRequestView(AlpcpGetReceivePort(Port), ClientId, MessageId);
+    KeReleaseGuardedMutex(&LpcpLock);
+
+    return View;
+}
+
+static
+PALPCP_VIEW
+AlpcpTakeReplyView(IN PETHREAD Thread,
+                   IN ULONG MessageId)
+{
+    PLIST_ENTRY ListEntry;
+    PALPCP_VIEW View;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    for (ListEntry = AlpcpViewListHead.Flink;
+         ListEntry != &AlpcpViewListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        View = CONTAINING_RECORD(ListEntry, ALPCP_VIEW, ListEntry);
+        if ((View->Reply) &&
+            (View->Thread == Thread) &&
+            (View->MessageId == MessageId))
+        {
+            RemoveEntryList(&View->ListEntry);
+            KeReleaseGuardedMutex(&LpcpLock);
+            return View;
+        }
+    }
+
+    KeReleaseGuardedMutex(&LpcpLock);
+    return NULL;
+}
+
+VOID
+NTAPI
+AlpcpFlushThreadViews(IN PETHREAD Thread)
+{
+    LIST_ENTRY FreeList;
+    PLIST_ENTRY ListEntry, NextEntry;
+    PALPCP_VIEW View;
+
+    PAGED_CODE();
+
+    /* Nothing is pending most of the time, don't take the lock for it */
+    if (IsListEmpty(&AlpcpViewListHead)) return;
+
+    InitializeListHead(&FreeList);
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    for (ListEntry = AlpcpViewListHead.Flink;
+         ListEntry != &AlpcpViewListHead;
+         ListEntry = NextEntry)
+    {
+        NextEntry = ListEntry->Flink;
+        View = CONTAINING_RECORD(ListEntry, ALPCP_VIEW, ListEntry);
+        if (View->Thread == Thread)
+        {
+            RemoveEntryList(&View->ListEntry);
+            InsertTailList(&FreeList, &View->ListEntry);
+        }
+    }
+
+    KeReleaseGuardedMutex(&LpcpLock);
+
+    /* Dereferencing the port may delete it, which takes the LPC lock */
+    while (!IsListEmpty(&FreeList))
+    {
+        ListEntry = RemoveHeadList(&FreeList);
+        AlpcpFreeView(CONTAINING_RECORD(ListEntry, ALPCP_VIEW, ListEntry));
+    }
+}
+
+static
+BOOLEAN
+AlpcpMapView(IN PALPCP_VIEW View,
+             IN PEPROCESS Process,
+             IN PALPC_DATA_VIEW_ATTR ViewAttributes)
+{
+    PVOID ViewBase = NULL;
+    SIZE_T ViewSize = View->ViewSize;
+    BOOLEAN Mapped = FALSE;
+    NTSTATUS Status;
+
+    /* Map the sender's pages into the receiver, nothing gets copied */
+    Status = MmMapViewOfSection(View->Section,
+                                Process,
+                                &ViewBase,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    AlpcpFreeView(View);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to map the message view: 0x%lx\n", Status);
+        return FALSE;
+    }
+
+    _SEH2_TRY
+    {
+        ViewAttributes->Flags = 0;
+        ViewAttributes->SectionHandle = NULL;
+        ViewAttributes->ViewBase = ViewBase;
+        ViewAttributes->ViewSize = ViewSize;
+        Mapped = TRUE;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        MmUnmapViewOfSection(Process, ViewBase);
+    }
+    _SEH2_END;
+
+    return Mapped;
+}
+
+static
+NTSTATUS
+AlpcpCompleteReceive(IN PLPCP_PORT_OBJECT Port,
+                     IN PPORT_MESSAGE ReceiveMessage,
+                     OUT PSIZE_T BufferLength,
+                     IN OUT PALPC_MESSAGE_ATTRIBUTES Attributes OPTIONAL,
+                     IN ULONG AllocatedAttributes,
+                     IN BOOLEAN Reply)
+{
+    PORT_MESSAGE CapturedMessage;
+    PALPC_DATA_VIEW_ATTR ViewAttributes;
+    PALPC_CONTEXT_ATTR ContextAttributes;
+    PALPCP_VIEW View = NULL;
+    ULONG ValidAttributes = 0;
+
+    /* The message was written by LPC, read back what it received */
+    _SEH2_TRY
+    {
+        CapturedMessage = *(volatile PORT_MESSAGE*)ReceiveMessage;
+        *BufferLength = (USHORT)CapturedMessage.u1.s1.TotalLength;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    if (!Attributes) return STATUS_SUCCESS;
+
+    ViewAttributes = AlpcpGetAttribute(Attributes,
+                                       AllocatedAttributes,
+                                       ALPC_MESSAGE_VIEW_ATTRIBUTE);
+    if (ViewAttributes)
+    {
+        if (Reply)
+        {
+            View = AlpcpTakeReplyView(PsGetCurrentThread(),
+                                      CapturedMessage.MessageId);
+        }
+        else if (LpcpGetMessageType(&CapturedMessage) == LPC_REQUEST)
+        {
+            View = AlpcpTakeRequestView(Port,
+                                        &CapturedMessage.ClientId,
+                                        CapturedMessage.MessageId);
+        }
+
+        /* Deliver the message anyway if the view can't be mapped */
+        if (View && AlpcpMapView(View, PsGetCurrentProcess(), ViewAttributes))
+            ValidAttributes |= ALPC_MESSAGE_VIEW_ATTRIBUTE;
+    }
+
+    ContextAttributes = AlpcpGetAttribute(Attributes,
+                                          AllocatedAttributes,
+                                          ALPC_MESSAGE_CONTEXT_ATTRIBUTE);
+
+    _SEH2_TRY
+    {
+        if (ContextAttributes)
+        {
+            /* A received message got its port context from LPC already */
+            if (Reply) ContextAttributes->PortContext = NULL;
+            ContextAttributes->MessageContext = NULL;
+            ContextAttributes->Sequence = 0;
+            ContextAttributes->MessageId = CapturedMessage.MessageId;
+            ContextAttributes->CallbackId = CapturedMessage.CallbackId;
+            ValidAttributes |= ALPC_MESSAGE_CONTEXT_ATTRIBUTE;
+        }
+
+        Attributes->ValidAttributes = ValidAttributes;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    return STATUS_SUCCESS;
+}
+
+static
+PALPCP_COMPLETION_LIST
+AlpcpReferenceCompletionList(IN PLPCP_PORT_OBJECT Port,
+                             IN PALPCP_COMPLETION_LIST NewList OPTIONAL)
+{
+    PLIST_ENTRY ListEntry;
+    PALPCP_COMPLETION_LIST List;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    for (ListEntry = AlpcpCompletionListHead.Flink;
+         ListEntry != &AlpcpCompletionListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        List = CONTAINING_RECORD(ListEntry, ALPCP_COMPLETION_LIST, ListEntry);
+        if (List->Port == Port)
+        {
+            List->References++;
+            KeReleaseGuardedMutex(&LpcpLock);
+            return List;
+        }
+    }
+
+    /* None yet, the new one gets a reference for the port and one for us */
+    if (NewList)
+    {
+        NewList->Port = Port;
+        NewList->References = 2;
+        InsertTailList(&AlpcpCompletionListHead, &NewList->ListEntry);
+    }
+
+    KeReleaseGuardedMutex(&LpcpLock);
+    return NewList;
+}
+
+static
+VOID
+AlpcpReleaseCompletionBuffer(IN PALPCP_COMPLETION_LIST List)
+{
+    /* The post lock must be held, or the list be gone from the global list */
+    if (!List->Header) return;
+
+    MmUnlockPages(List->Mdl);
+    IoFreeMdl(List->Mdl);
+    ObDereferenceObject(List->Process);
+
+    List->Mdl = NULL;
+    List->Process = NULL;
+    List->Header = NULL;
+}
+
+static
+VOID
+AlpcpDereferenceCompletionList(IN PALPCP_COMPLETION_LIST List)
+{
+    LONG References;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+    References = --List->References;
+    KeReleaseGuardedMutex(&LpcpLock);
+    if (References) return;
+
+    AlpcpReleaseCompletionBuffer(List);
+    if (List->CompletionPort) ObDereferenceObject(List->CompletionPort);
+    ExFreePoolWithTag(List, 'LcpA');
+}
+
+VOID
+NTAPI
+AlpcpRundownPort(IN PLPCP_PORT_OBJECT Port)
+{
+    PLIST_ENTRY ListEntry;
+    PALPCP_COMPLETION_LIST List;
+
+    PAGED_CODE();
+
+    /* Most ports never get a completion list */
+    if (IsListEmpty(&AlpcpCompletionListHead)) return;
+
+    KeAcquireGuardedMutex(&LpcpLock);
+
+    for (ListEntry = AlpcpCompletionListHead.Flink;
+         ListEntry != &AlpcpCompletionListHead;
+         ListEntry = ListEntry->Flink)
+    {
+        List = CONTAINING_RECORD(ListEntry, ALPCP_COMPLETION_LIST, ListEntry);
+        if (List->Port == Port)
+        {
+            /* Posters still holding it stop at their next message */
+            RemoveEntryList(&List->ListEntry);
+            List->Rundown = TRUE;
+            KeReleaseGuardedMutex(&LpcpLock);
+            AlpcpDereferenceCompletionList(List);
+            return;
+        }
+    }
+
+    KeReleaseGuardedMutex(&LpcpLock);
+}
+
+static
+ULONG
+AlpcpClaimCompletionEntry(IN PALPCP_COMPLETION_LIST List)
+{
+    ULONG i, Entry;
+
+    for (i = 0; i < List->EntryCount; i++)
+    {
+        Entry = (List->NextEntry + i) % List->EntryCount;
+        if (InterlockedCompareExchange(&List->State[Entry],
+                                       ALPC_COMPLETION_LIST_ENTRY_USED,
+                                       ALPC_COMPLETION_LIST_ENTRY_FREE) ==
+            ALPC_COMPLETION_LIST_ENTRY_FREE)
+        {
+            List->NextEntry = Entry + 1;
+            return Entry;
+        }
+    }
+
+    return MAXULONG;
+}
+
+static
+PLPCP_MESSAGE
+AlpcpGetCompletionMessage(IN PLPCP_PORT_OBJECT QueuePort,
+                          IN ULONG MessageSize)
+{
+    PLIST_ENTRY ListEntry;
+    PLPCP_MESSAGE Message;
+
+    /* Connections and messages with data info still go to a receiver */
+    for (ListEntry = QueuePort->MsgQueue.ReceiveHead.Flink;
+         ListEntry != &QueuePort->MsgQueue.ReceiveHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Message = CONTAINING_RECORD(ListEntry, LPCP_MESSAGE, Entry);
+        if ((LpcpGetMessageType(&Message->Request) != LPC_CONNECTION_REQUEST) &&
+            !(Message->Request.u2.s2.DataInfoOffset) &&
+            ((ULONG)Message->Request.u1.s1.TotalLength <= MessageSize))
+        {
+            return Message;
+        }
+    }
+
+    return NULL;
+}
+
+VOID
+NTAPI
+AlpcpPostCompletionList(IN PLPCP_PORT_OBJECT QueuePort)
+{
+    PALPCP_COMPLETION_LIST List;
+    PALPC_COMPLETION_LIST_HEADER Header;
+    PALPC_MESSAGE_ATTRIBUTES Attributes;
+    PALPC_CONTEXT_ATTR ContextAttributes;
+    PALPC_DATA_VIEW_ATTR ViewAttributes;
+    PPORT_MESSAGE EntryMessage;
+    PLPCP_MESSAGE Message;
+    PALPCP_VIEW View;
+    LARGE_INTEGER Timeout;
+    ULONG Entry, MessageId, CallbackId, Posted = 0;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    /* Most ports never get a completion list, don't take the lock for them */
+    if (IsListEmpty(&AlpcpCompletionListHead)) return;
+
+    List = AlpcpReferenceCompletionList(QueuePort, NULL);
+    if (!List) return;
+
+    KeAcquireGuardedMutex(&List->PostLock);
+
+    Header = List->Header;
+    if (!Header)
+    {
+        /* Only a completion port, tell it there is something to receive */
+        KeAcquireGuardedMutex(&LpcpLock);
+        if (!(List->Rundown) && !IsListEmpty(&QueuePort->MsgQueue.ReceiveHead))
+            Posted = 1;
+        KeReleaseGuardedMutex(&LpcpLock);
+    }
+
+    while (Header)
+    {
+        KeAcquireGuardedMutex(&LpcpLock);
+
+        /* The port is only alive as long as the list wasn't run down */
+        Message = NULL;
+        if (!List->Rundown)
+            Message = AlpcpGetCompletionMessage(QueuePort, List->MessageSize);
+        if (!Message)
+        {
+            KeReleaseGuardedMutex(&LpcpLock);
+            break;
+        }
+
+        Entry = AlpcpClaimCompletionEntry(List);
+        if (Entry == MAXULONG)
+        {
+            /* Full, have the next freed entry come back for the rest */
+            InterlockedExchange(&Header->Backlog, TRUE);
+            Entry = AlpcpClaimCompletionEntry(List);
+            if (Entry == MAXULONG)
+            {
+                KeReleaseGuardedMutex(&LpcpLock);
+                break;
+            }
+        }
+
+        /* Take the semaphore count of the message, unless a receiver did */
+        Timeout.QuadPart = 0;
+        Status = KeWaitForSingleObject(QueuePort->MsgQueue.Semaphore,
+                                       WrLpcReceive,
+                                       KernelMode,
+                                       FALSE,
+                                       &Timeout);
+        if (Status != STATUS_SUCCESS)
+        {
+            InterlockedExchange(&List->State[Entry], ALPC_COMPLETION_LIST_ENTRY_FREE);
+            KeReleaseGuardedMutex(&LpcpLock);
+            break;
+        }
+
+        RemoveEntryList(&Message->Entry);
+        InitializeListHead(&Message->Entry);
+        if ((QueuePort->Flags & LPCP_WAITABLE_PORT) &&
+            IsListEmpty(&QueuePort->MsgQueue.ReceiveHead))
+        {
+            KeClearEvent(&QueuePort->WaitEvent);
+        }
+
+        /* The entry is the attributes, then the message */
+        Attributes = (PALPC_MESSAGE_ATTRIBUTES)(List->Data + Entry * List->EntrySize);
+        EntryMessage = (PPORT_MESSAGE)((PUCHAR)Attributes + List->AttributeSize);
+
+        LpcpMoveMessage(EntryMessage,
+                        &Message->Request,
+                        (&Message->Request) + 1,
+                        0,
+                        NULL);
+        EntryMessage->u2.s2.DataInfoOffset = 0;
+        EntryMessage->CallbackId = Message->Request.CallbackId;
+        MessageId = Message->Request.MessageId;
+        CallbackId = Message->Request.CallbackId;
+
+        Attributes->AllocatedAttributes = List->AttributeFlags;
+        Attributes->ValidAttributes = 0;
+
+        ContextAttributes = AlpcpGetAttribute(Attributes,
+                                              List->AttributeFlags,
+                                              ALPC_MESSAGE_CONTEXT_ATTRIBUTE);
+        if (ContextAttributes)
+        {
+            ContextAttributes->PortContext = Message->PortContext;
+            ContextAttributes->MessageContext = NULL;
+            ContextAttributes->Sequence = 0;
+            ContextAttributes->MessageId = MessageId;
+            ContextAttributes->CallbackId = CallbackId;
+            Attributes->ValidAttributes |= ALPC_MESSAGE_CONTEXT_ATTRIBUTE;
+        }
+
+        ViewAttributes = AlpcpGetAttribute(Attributes,
+                                           List->AttributeFlags,
+                                           ALPC_MESSAGE_VIEW_ATTRIBUTE);
+        View = NULL;
+        if (ViewAttributes &&
+            (LpcpGetMessageType(&Message->Request) == LPC_REQUEST))
+        {
+            View = AlpcpRemoveRequestView(QueuePort,
+                                          &Message->Request.ClientId,
+                                          MessageId);
+        }
+
+        /* The list owns the message now, the request is replied by its ID */
+        LpcpFreeToPortZone(Message, LPCP_LOCK_HELD | LPCP_LOCK_RELEASE);
+
+        if (View && AlpcpMapView(View, List->Process, ViewAttributes))
+            Attributes->ValidAttributes |= ALPC_MESSAGE_VIEW_ATTRIBUTE;
+
+        /* Publish it, the slot is free as long as an entry was */
+        Header->LastMessageId = MessageId;
+        Header->LastCallbackId = CallbackId;
+        InterlockedIncrement(&Header->OutstandingCount);
+        InterlockedIncrement(&Header->PostCount);
+        InterlockedExchange(&List->Queue[List->PostIndex++ % List->EntryCount],
+                            Entry + 1);
+        Posted++;
+    }
+
+    KeReleaseGuardedMutex(&List->PostLock);
+
+    /* One packet per message, like a completed I/O */
+    if (List->CompletionPort)
+    {
+        while (Posted--)
+        {
+            IoSetIoCompletion(List->CompletionPort,
+                              List->CompletionKey,
+                              NULL,
+                              STATUS_SUCCESS,
+                              0,
+                              FALSE);
+        }
+    }
+
+    AlpcpDereferenceCompletionList(List);
+}
+
+static
+NTSTATUS
+AlpcpRegisterCompletionList(IN PALPCP_COMPLETION_LIST List,
+                            IN PALPC_PORT_COMPLETION_LIST_INFORMATION Information,
+                            IN KPROCESSOR_MODE PreviousMode)
+{
+    PALPC_COMPLETION_LIST_HEADER Header;
+    ULONG AttributeSize, MessageSize, EntrySize, EntryCount;
+    ULONG StateOffset, QueueOffset, DataOffset;
+    PMDL Mdl;
+
+    /* The post lock must be held */
+    if (List->Header) return STATUS_ALREADY_REGISTERED;
+
+    if (!(Information->Buffer) ||
+        ((ULONG_PTR)Information->Buffer & (sizeof(ULONGLONG) - 1)) ||
+        (Information->Size > ALPC_COMPLETION_LIST_MAXIMUM_SIZE))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Attributes are handed out like NtAlpcSendWaitReceivePort would */
+    if (Information->AttributeFlags & ~ALPCP_SEND_ATTRIBUTES)
+        return STATUS_NOT_SUPPORTED;
+
+    AttributeSize = ALIGN_UP_BY(AlpcpGetAttributesSize(Information->AttributeFlags),
+                                sizeof(ULONGLONG));
+    MessageSize = List->Port->MaxMessageLength;
+    EntrySize = AttributeSize + ALIGN_UP_BY(MessageSize, sizeof(ULONGLONG));
+
+    /* Fit as many entries as we can, each with its state and queue slot */
+    StateOffset = ALIGN_UP_BY(sizeof(ALPC_COMPLETION_LIST_HEADER), sizeof(ULONGLONG));
+    if (Information->Size <= StateOffset) return STATUS_BUFFER_TOO_SMALL;
+
+    EntryCount = (Information->Size - StateOffset) / (EntrySize + 2 * sizeof(LONG));
+    for (;;)
+    {
+        if (EntryCount == 0) return STATUS_BUFFER_TOO_SMALL;
+
+        QueueOffset = StateOffset + EntryCount * sizeof(LONG);
+        DataOffset = ALIGN_UP_BY(QueueOffset + EntryCount * sizeof(LONG),
+                                 sizeof(ULONGLONG));
+        if (DataOffset + EntryCount * EntrySize <= Information->Size) break;
+
+        EntryCount--;
+    }
+
+    /* The list is written while its owner may be in another process */
+    Mdl = IoAllocateMdl(Information->Buffer, Information->Size, FALSE, FALSE, NULL);
+    if (!Mdl) return STATUS_INSUFFICIENT_RESOURCES;
+
+    _SEH2_TRY
+    {
+        MmProbeAndLockPages(Mdl, PreviousMode, IoWriteAccess);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        IoFreeMdl(Mdl);
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Header = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+    if (!Header)
+    {
+        MmUnlockPages(Mdl);
+        IoFreeMdl(Mdl);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Header, Information->Size);
+    Header->Size = Information->Size;
+    Header->AttributeFlags = Information->AttributeFlags;
+    Header->AttributeSize = AttributeSize;
+    Header->MessageSize = MessageSize;
+    Header->EntrySize = EntrySize;
+    Header->EntryCount = EntryCount;
+    Header->StateOffset = StateOffset;
+    Header->QueueOffset = QueueOffset;
+    Header->DataOffset = DataOffset;
+    Header->ConcurrencyCount = Information->ConcurrencyCount;
+
+    /* Keep our own copy of the layout, the user may scribble on theirs */
+    List->Process = PsGetCurrentProcess();
+    ObReferenceObject(List->Process);
+    List->Mdl = Mdl;
+    List->State = (PLONG)((PUCHAR)Header + StateOffset);
+    List->Queue = (PLONG)((PUCHAR)Header + QueueOffset);
+    List->Data = (PUCHAR)Header + DataOffset;
+    List->AttributeFlags = Information->AttributeFlags;
+    List->AttributeSize = AttributeSize;
+    List->MessageSize = MessageSize;
+    List->EntrySize = EntrySize;
+    List->EntryCount = EntryCount;
+    List->NextEntry = 0;
+    List->PostIndex = 0;
+    List->Header = Header;
+
+    return STATUS_SUCCESS;
+}
+
+/* PUBLIC FUNCTIONS **********************************************************/
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcCreatePort(OUT PHANDLE PortHandle,
+                 IN POBJECT_ATTRIBUTES ObjectAttributes OPTIONAL,
+                 IN PALPC_PORT_ATTRIBUTES PortAttributes OPTIONAL)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    SIZE_T MaxMessageLength = 0, MaxPoolUsage = 0;
+    ULONG LpcMaxMessageLength;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG, "Attributes: %p\n", PortAttributes);
+
+    /* Server ports are found by their name */
+    if (!ObjectAttributes) return STATUS_INVALID_PARAMETER_2;
+
+    if (PortAttributes)
+    {
+        _SEH2_TRY
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead(PortAttributes, sizeof(*PortAttributes), sizeof(ULONG));
+
+            MaxMessageLength = PortAttributes->MaxMessageLength;
+            MaxPoolUsage = PortAttributes->MaxPoolUsage;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* Messages are LPC messages, anything larger goes through a view */
+    LpcMaxMessageLength = LpcpMaxMessageSize - FIELD_OFFSET(LPCP_MESSAGE, Request);
+    if ((MaxMessageLength == 0) || (MaxMessageLength > LpcMaxMessageLength))
+        MaxMessageLength = LpcMaxMessageLength;
+
+    return LpcpCreatePort(PortHandle,
+                          ObjectAttributes,
+                          0,
+                          (ULONG)MaxMessageLength,
+                          (ULONG)min(MaxPoolUsage, MAXULONG),
+                          FALSE);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcConnectPort(OUT PHANDLE PortHandle,
+                  IN PUNICODE_STRING PortName,
+                  IN POBJECT_ATTRIBUTES ObjectAttributes OPTIONAL,
+                  IN PALPC_PORT_ATTRIBUTES PortAttributes OPTIONAL,
+                  IN ULONG Flags,
+                  IN PSID RequiredServerSid OPTIONAL,
+                  IN OUT PPORT_MESSAGE ConnectionMessage OPTIONAL,
+                  IN OUT PSIZE_T BufferLength OPTIONAL,
+                  IN OUT PALPC_MESSAGE_ATTRIBUTES OutMessageAttributes OPTIONAL,
+                  IN OUT PALPC_MESSAGE_ATTRIBUTES InMessageAttributes OPTIONAL,
+                  IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    SIZE_T CapturedBufferLength;
+    ULONG DataLength;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG, "Name: %wZ\n", PortName);
+
+    UNREFERENCED_PARAMETER(ObjectAttributes);
+    UNREFERENCED_PARAMETER(Flags);
+    UNREFERENCED_PARAMETER(OutMessageAttributes);
+
+    /* FIXME: LPC waits for the server without a timeout */
+    UNREFERENCED_PARAMETER(Timeout);
+
+    /* LPC takes the quality of service from caller memory */
+    if (!PortAttributes) return STATUS_INVALID_PARAMETER_4;
+    if (ConnectionMessage && !BufferLength) return STATUS_INVALID_PARAMETER_8;
+
+    _SEH2_TRY
+    {
+        if (ConnectionMessage)
+        {
+            if (PreviousMode != KernelMode)
+            {
+                ProbeForWriteSize_t(BufferLength);
+                ProbeForWrite(ConnectionMessage, sizeof(*ConnectionMessage), sizeof(ULONG));
+            }
+
+            CapturedBufferLength = *BufferLength;
+            DataLength = (USHORT)ConnectionMessage->u1.s1.DataLength;
+            if ((CapturedBufferLength < sizeof(PORT_MESSAGE)) ||
+                (DataLength > CapturedBufferLength - sizeof(PORT_MESSAGE)))
+            {
+                _SEH2_YIELD(return STATUS_INVALID_PARAMETER);
+            }
+
+            /* LPC passes the data length in a ULONG of caller memory, use the header's */
+            ConnectionMessage->u1.Length = DataLength;
+        }
+
+        if (InMessageAttributes)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForWrite(InMessageAttributes, sizeof(*InMessageAttributes), sizeof(ULONG));
+
+            InMessageAttributes->ValidAttributes = 0;
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Status = NtSecureConnectPort(PortHandle,
+                                 PortName,
+                                 &PortAttributes->SecurityQos,
+                                 NULL,
+                                 RequiredServerSid,
+                                 NULL,
+                                 NULL,
+                                 ConnectionMessage ? ConnectionMessage + 1 : NULL,
+                                 ConnectionMessage ? &ConnectionMessage->u1.Length : NULL);
+
+    if (ConnectionMessage)
+    {
+        _SEH2_TRY
+        {
+            /* Turn the length LPC returned back into a message header */
+            DataLength = ConnectionMessage->u1.Length;
+            ConnectionMessage->u1.s1.DataLength = (CSHORT)DataLength;
+            ConnectionMessage->u1.s1.TotalLength = (CSHORT)(sizeof(PORT_MESSAGE) + DataLength);
+            *BufferLength = sizeof(PORT_MESSAGE) + DataLength;
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = _SEH2_GetExceptionCode();
+        }
+        _SEH2_END;
+    }
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcAcceptConnectPort(OUT PHANDLE PortHandle,
+                        IN HANDLE ConnectionPortHandle,
+                        IN ULONG Flags,
+                        IN POBJECT_ATTRIBUTES ObjectAttributes OPTIONAL,
+                        IN PALPC_PORT_ATTRIBUTES PortAttributes OPTIONAL,
+                        IN PVOID PortContext OPTIONAL,
+                        IN PPORT_MESSAGE ConnectionRequest,
+                        IN OUT PALPC_MESSAGE_ATTRIBUTES ConnectionMessageAttributes OPTIONAL,
+                        IN BOOLEAN AcceptConnection)
+{
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG, "Accept: %lx\n", AcceptConnection);
+
+    /* LPC finds the connection port from the client and message IDs */
+    UNREFERENCED_PARAMETER(ConnectionPortHandle);
+    UNREFERENCED_PARAMETER(Flags);
+    UNREFERENCED_PARAMETER(ObjectAttributes);
+    UNREFERENCED_PARAMETER(PortAttributes);
+    UNREFERENCED_PARAMETER(ConnectionMessageAttributes);
+
+    Status = NtAcceptConnectPort(PortHandle,
+                                 PortContext,
+                                 ConnectionRequest,
+                                 AcceptConnection,
+                                 NULL,
+                                 NULL);
+    if (!NT_SUCCESS(Status) || !AcceptConnection) return Status;
+
+    /* There is no separate completion step in ALPC, wake the client now */
+    _SEH2_TRY
+    {
+        Handle = *PortHandle;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    return NtCompleteConnectPort(Handle);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcSendWaitReceivePort(IN HANDLE PortHandle,
+                          IN ULONG Flags,
+                          IN PPORT_MESSAGE SendMessage OPTIONAL,
+                          IN OUT PALPC_MESSAGE_ATTRIBUTES SendMessageAttributes OPTIONAL,
+                          OUT PPORT_MESSAGE ReceiveMessage OPTIONAL,
+                          IN OUT PSIZE_T BufferLength OPTIONAL,
+                          IN OUT PALPC_MESSAGE_ATTRIBUTES ReceiveMessageAttributes OPTIONAL,
+                          IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PETHREAD Thread = PsGetCurrentThread(), ReplyThread;
+    PORT_MESSAGE CapturedSendMessage;
+    ULONG AllocatedAttributes, SendAttributes = 0, ReceiveAttributes = 0;
+    SIZE_T CapturedBufferLength = 0, ViewSize = 0;
+    ALPC_HANDLE SectionHandle = NULL;
+    PALPC_DATA_VIEW_ATTR ViewAttributes;
+    PALPC_CONTEXT_ATTR ContextAttributes;
+    PVOID *PortContext = NULL;
+    PLPCP_PORT_OBJECT Port;
+    PVOID Section = NULL;
+    BOOLEAN Receive;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG,
+             "Handle: %p. Flags: %lx. Messages: %p/%p\n",
+             PortHandle,
+             Flags,
+             SendMessage,
+             ReceiveMessage);
+
+    /* Check the flags and that there is something to do */
+    if ((Flags & ~ALPCP_VALID_MESSAGE_FLAGS) ||
+        (!SendMessage && !ReceiveMessage) ||
+        ((Flags & ALPC_MSGFLG_SYNC_REQUEST) && (!SendMessage || !ReceiveMessage)) ||
+        (ReceiveMessage && !BufferLength))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    RtlZeroMemory(&CapturedSendMessage, sizeof(CapturedSendMessage));
+
+    _SEH2_TRY
+    {
+        if (SendMessage)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead(SendMessage, sizeof(*SendMessage), sizeof(ULONG));
+
+            CapturedSendMessage = *(volatile PORT_MESSAGE*)SendMessage;
+        }
+
+        if (SendMessage && SendMessageAttributes)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead(SendMessageAttributes, sizeof(*SendMessageAttributes), sizeof(ULONG));
+
+            AllocatedAttributes = SendMessageAttributes->AllocatedAttributes;
+            SendAttributes = SendMessageAttributes->ValidAttributes & AllocatedAttributes;
+
+            if (SendAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE)
+            {
+                ViewAttributes = AlpcpGetAttribute(SendMessageAttributes,
+                                                   AllocatedAttributes,
+                                                   ALPC_MESSAGE_VIEW_ATTRIBUTE);
+
+                if (PreviousMode != KernelMode)
+                    ProbeForRead(ViewAttributes, sizeof(*ViewAttributes), sizeof(ULONG));
+
+                SectionHandle = ViewAttributes->SectionHandle;
+                ViewSize = ViewAttributes->ViewSize;
+            }
+        }
+
+        if (ReceiveMessage)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForWriteSize_t(BufferLength);
+
+            CapturedBufferLength = *BufferLength;
+        }
+
+        if (ReceiveMessageAttributes)
+        {
+            if (PreviousMode != KernelMode)
+                ProbeForRead(ReceiveMessageAttributes, sizeof(*ReceiveMessageAttributes), sizeof(ULONG));
+
+            ReceiveAttributes = ReceiveMessageAttributes->AllocatedAttributes;
+
+            if (PreviousMode != KernelMode)
+            {
+                ProbeForWrite(ReceiveMessageAttributes,
+                              AlpcpGetAttributesSize(ReceiveAttributes),
+                              sizeof(ULONG));
+            }
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    /* Only section views can be sent along for now */
+    if (SendAttributes & ~ALPCP_SEND_ATTRIBUTES) return STATUS_NOT_SUPPORTED;
+
+    if (SendAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE)
+    {
+        /* A view needs someone waiting to unmap it, so no datagrams */
+        if (!(Flags & ALPC_MSGFLG_SYNC_REQUEST) && !CapturedSendMessage.MessageId)
+            return STATUS_INVALID_PARAMETER;
+
+        if (ViewSize == 0) return STATUS_INVALID_VIEW_SIZE;
+    }
+
+    /* LPC returns the port context straight into the context attribute */
+    ContextAttributes = AlpcpGetAttribute(ReceiveMessageAttributes,
+                                          ReceiveAttributes,
+                                          ALPC_MESSAGE_CONTEXT_ATTRIBUTE);
+    if (ContextAttributes) PortContext = &ContextAttributes->PortContext;
+
+    Status = ObReferenceObjectByHandle(PortHandle,
+                                       0,
+                                       LpcPortObjectType,
+                                       PreviousMode,
+                                       (PVOID*)&Port,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    if (ReceiveMessage)
+    {
+        /* The receive buffer must hold the largest message of the port */
+        if (CapturedBufferLength < Port->MaxMessageLength)
+        {
+            ObDereferenceObject(Port);
+            return STATUS_BUFFER_TOO_SMALL;
+        }
+
+        if (PreviousMode != KernelMode)
+        {
+            _SEH2_TRY
+            {
+                ProbeForWrite(ReceiveMessage, Port->MaxMessageLength, sizeof(ULONG));
+            }
+            _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+            {
+                ObDereferenceObject(Port);
+                _SEH2_YIELD(return _SEH2_GetExceptionCode());
+            }
+            _SEH2_END;
+        }
+    }
+
+    if (SendAttributes & ALPC_MESSAGE_VIEW_ATTRIBUTE)
+    {
+        Status = ObReferenceObjectByHandle(SectionHandle,
+                                           SECTION_MAP_READ | SECTION_MAP_WRITE,
+                                           MmSectionObjectType,
+                                           PreviousMode,
+                                           &Section,
+                                           NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            ObDereferenceObject(Port);
+            return Status;
+        }
+    }
+
+    Receive = (ReceiveMessage != NULL);
+
+    if (Flags & ALPC_MSGFLG_SYNC_REQUEST)
+    {
+        /* Let whoever receives the request map the view */
+        if (Section) Status = AlpcpQueueRequestView(Port, Section, ViewSize);
+
+        /* FIXME: LPC waits for the reply without a timeout, Timeout is ignored */
+        if (NT_SUCCESS(Status))
+        {
+            Status = NtRequestWaitReplyPort(PortHandle, SendMessage, ReceiveMessage);
+            if (Status == STATUS_SUCCESS)
+            {
+                Status = AlpcpCompleteReceive(Port,
+                                              ReceiveMessage,
+                                              BufferLength,
+                                              ReceiveMessageAttributes,
+                                              ReceiveAttributes,
+                                              TRUE);
+            }
+        }
+
+        /* Drop our view if nobody took it, and any reply view we didn't */
+        AlpcpFlushThreadViews(Thread);
+        Receive = FALSE;
+    }
+    else if (SendMessage && CapturedSendMessage.MessageId)
+    {
+        if (Section)
+        {
+            /* Queue the view before the client can wake up and look for it */
+            Status = AlpcpQueueReplyView(&CapturedSendMessage.ClientId,
+                                         CapturedSendMessage.MessageId,
+                                         Section,
+                                         ViewSize,
+                                         &ReplyThread);
+            if (NT_SUCCESS(Status))
+            {
+                Status = NtReplyPort(PortHandle, SendMessage);
+                if (!NT_SUCCESS(Status))
+                {
+                    AlpcpCancelReplyView(ReplyThread, CapturedSendMessage.MessageId);
+                }
+            }
+        }
+        else if (Receive)
+        {
+            /* Reply and wait in one go, like LPC servers do */
+            Status = NtReplyWaitReceivePortEx(PortHandle,
+                                              PortContext,
+                                              SendMessage,
+                                              ReceiveMessage,
+                                              Timeout);
+            if (Status == STATUS_SUCCESS)
+            {
+                Status = AlpcpCompleteReceive(Port,
+                                              ReceiveMessage,
+                                              BufferLength,
+                                              ReceiveMessageAttributes,
+                                              ReceiveAttributes,
+                                              FALSE);
+            }
+            Receive = FALSE;
+        }
+        else
+        {
+            Status = NtReplyPort(PortHandle, SendMessage);
+        }
+    }
+    else if (SendMessage)
+    {
+        Status = NtRequestPort(PortHandle, SendMessage);
+    }
+
+    if (Receive && NT_SUCCESS(Status))
+    {
+        Status = NtReplyWaitReceivePortEx(PortHandle,
+                                          PortContext,
+                                          NULL,
+                                          ReceiveMessage,
+                                          Timeout);
+        if (Status == STATUS_SUCCESS)
+        {
+            Status = AlpcpCompleteReceive(Port,
+                                          ReceiveMessage,
+                                          BufferLength,
+                                          ReceiveMessageAttributes,
+                                          ReceiveAttributes,
+                                          FALSE);
+        }
+    }
+
+    if (Section) ObDereferenceObject(Section);
+    ObDereferenceObject(Port);
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcImpersonateClientOfPort(IN HANDLE PortHandle,
+                              IN PPORT_MESSAGE Message,
+                              IN PVOID Flags)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PLPCP_PORT_OBJECT Port, ConnectedPort = NULL;
+    PETHREAD ClientThread = NULL;
+    SECURITY_CLIENT_CONTEXT ClientContext;
+    CLIENT_ID ClientId;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(Flags);
+
+    _SEH2_TRY
+    {
+        if (PreviousMode != KernelMode)
+            ProbeForRead(Message, sizeof(*Message), sizeof(ULONG));
+
+        ClientId = ((volatile PORT_MESSAGE*)Message)->ClientId;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Status = ObReferenceObjectByHandle(PortHandle,
+                                       PORT_ALL_ACCESS,
+                                       LpcPortObjectType,
+                                       PreviousMode,
+                                       (PVOID*)&Port,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    if ((Port->Flags & LPCP_PORT_TYPE_MASK) != LPCP_COMMUNICATION_PORT)
+    {
+        Status = STATUS_INVALID_PORT_HANDLE;
+        goto Cleanup;
+    }
+
+    KeAcquireGuardedMutex(&LpcpLock);
+    ConnectedPort = Port->ConnectedPort;
+    if (ConnectedPort && !ObReferenceObjectSafe(ConnectedPort)) ConnectedPort = NULL;
+    KeReleaseGuardedMutex(&LpcpLock);
+
+    if (!ConnectedPort)
+    {
+        Status = STATUS_PORT_DISCONNECTED;
+        goto Cleanup;
+    }
+
+    /*
+     * Unlike NtImpersonateClientOfPort, the client doesn't have to wait for
+     * a reply, which is what datagram and completion list servers need.
+     */
+    if (!(ConnectedPort->Flags & LPCP_SECURITY_DYNAMIC))
+    {
+        Status = SeImpersonateClientEx(&ConnectedPort->StaticSecurity, NULL);
+        goto Cleanup;
+    }
+
+    /* Dynamic tracking needs the sender, which must be the connected client */
+    if (ClientId.UniqueProcess != ConnectedPort->Creator.UniqueProcess)
+    {
+        Status = STATUS_REPLY_MESSAGE_MISMATCH;
+        goto Cleanup;
+    }
+
+    Status = PsLookupProcessThreadByCid(&ClientId, NULL, &ClientThread);
+    if (!NT_SUCCESS(Status)) goto Cleanup;
+
+    Status = SeCreateClientSecurity(ClientThread,
+                                    &ConnectedPort->SecurityQos,
+                                    FALSE,
+                                    &ClientContext);
+    if (!NT_SUCCESS(Status)) goto Cleanup;
+
+    Status = SeImpersonateClientEx(&ClientContext, NULL);
+    SeDeleteClientSecurity(&ClientContext);
+
+Cleanup:
+    if (ClientThread) ObDereferenceObject(ClientThread);
+    if (ConnectedPort) ObDereferenceObject(ConnectedPort);
+    ObDereferenceObject(Port);
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcSetInformation(IN HANDLE PortHandle,
+                     IN ALPC_PORT_INFORMATION_CLASS PortInformationClass,
+                     IN PVOID PortInformation OPTIONAL,
+                     IN ULONG Length)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    ALPC_PORT_ASSOCIATE_COMPLETION_PORT CompletionPortInformation;
+    ALPC_PORT_COMPLETION_LIST_INFORMATION CompletionListInformation;
+    PALPCP_COMPLETION_LIST List, NewList;
+    PVOID CompletionPort = NULL;
+    ULONG ConcurrencyCount = 0;
+    PLPCP_PORT_OBJECT Port;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG, "Handle: %p. Class: %lx\n", PortHandle, PortInformationClass);
+
+    _SEH2_TRY
+    {
+        switch (PortInformationClass)
+        {
+            case AlpcAssociateCompletionPortInformation:
+                if (Length < sizeof(CompletionPortInformation))
+                    _SEH2_YIELD(return STATUS_INFO_LENGTH_MISMATCH);
+                if (PreviousMode != KernelMode)
+                    ProbeForRead(PortInformation, sizeof(CompletionPortInformation), sizeof(ULONG));
+                CompletionPortInformation = *(volatile ALPC_PORT_ASSOCIATE_COMPLETION_PORT*)PortInformation;
+                break;
+
+            case AlpcRegisterCompletionListInformation:
+                if (Length < sizeof(CompletionListInformation))
+                    _SEH2_YIELD(return STATUS_INFO_LENGTH_MISMATCH);
+                if (PreviousMode != KernelMode)
+                    ProbeForRead(PortInformation, sizeof(CompletionListInformation), sizeof(ULONG));
+                CompletionListInformation = *(volatile ALPC_PORT_COMPLETION_LIST_INFORMATION*)PortInformation;
+                break;
+
+            case AlpcAdjustCompletionListConcurrencyCountInformation:
+                if (Length < sizeof(ULONG))
+                    _SEH2_YIELD(return STATUS_INFO_LENGTH_MISMATCH);
+                if (PreviousMode != KernelMode)
+                    ProbeForRead(PortInformation, sizeof(ULONG), sizeof(ULONG));
+                ConcurrencyCount = *(volatile ULONG*)PortInformation;
+                break;
+
+            case AlpcUnregisterCompletionListInformation:
+            case AlpcCompletionListRundownInformation:
+                break;
+
+            default:
+                _SEH2_YIELD(return STATUS_INVALID_INFO_CLASS);
+        }
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Status = ObReferenceObjectByHandle(PortHandle,
+                                       0,
+                                       LpcPortObjectType,
+                                       PreviousMode,
+                                       (PVOID*)&Port,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Everything but connections is received there */
+    if ((Port->Flags & LPCP_PORT_TYPE_MASK) != LPCP_CONNECTION_PORT)
+    {
+        ObDereferenceObject(Port);
+        return STATUS_INVALID_PORT_HANDLE;
+    }
+
+    if (PortInformationClass == AlpcAssociateCompletionPortInformation)
+    {
+        Status = ObReferenceObjectByHandle(CompletionPortInformation.CompletionPort,
+                                           IO_COMPLETION_MODIFY_STATE,
+                                           IoCompletionType,
+                                           PreviousMode,
+                                           &CompletionPort,
+                                           NULL);
+        if (!NT_SUCCESS(Status))
+        {
+            ObDereferenceObject(Port);
+            return Status;
+        }
+    }
+
+    NewList = NULL;
+    if ((PortInformationClass == AlpcAssociateCompletionPortInformation) ||
+        (PortInformationClass == AlpcRegisterCompletionListInformation))
+    {
+        NewList = ExAllocatePoolWithTag(NonPagedPool, sizeof(*NewList), 'LcpA');
+        if (!NewList)
+        {
+            if (CompletionPort) ObDereferenceObject(CompletionPort);
+            ObDereferenceObject(Port);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        RtlZeroMemory(NewList, sizeof(*NewList));
+        KeInitializeGuardedMutex(&NewList->PostLock);
+    }
+
+    List = AlpcpReferenceCompletionList(Port, NewList);
+    if (NewList && (List != NewList)) ExFreePoolWithTag(NewList, 'LcpA');
+
+    if (!List)
+    {
+        ObDereferenceObject(Port);
+        return (PortInformationClass == AlpcCompletionListRundownInformation) ?
+               STATUS_SUCCESS : STATUS_INVALID_PARAMETER;
+    }
+
+    KeAcquireGuardedMutex(&List->PostLock);
+
+    switch (PortInformationClass)
+    {
+        case AlpcAssociateCompletionPortInformation:
+            if (List->CompletionPort)
+            {
+                Status = STATUS_ALREADY_REGISTERED;
+                break;
+            }
+
+            List->CompletionPort = CompletionPort;
+            List->CompletionKey = CompletionPortInformation.CompletionKey;
+            CompletionPort = NULL;
+            break;
+
+        case AlpcRegisterCompletionListInformation:
+            Status = AlpcpRegisterCompletionList(List,
+                                                 &CompletionListInformation,
+                                                 PreviousMode);
+            break;
+
+        case AlpcUnregisterCompletionListInformation:
+            if (!List->Header)
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            AlpcpReleaseCompletionBuffer(List);
+            break;
+
+        case AlpcAdjustCompletionListConcurrencyCountInformation:
+            if (!List->Header)
+            {
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            List->Header->ConcurrencyCount = ConcurrencyCount;
+            break;
+
+        default:
+            /* Rundown, the list got room again, see below */
+            break;
+    }
+
+    KeReleaseGuardedMutex(&List->PostLock);
+
+    /* Hand over what arrived before the list, or while it was full */
+    if (NT_SUCCESS(Status) &&
+        ((PortInformationClass == AlpcRegisterCompletionListInformation) ||
+         (PortInformationClass == AlpcCompletionListRundownInformation)))
+    {
+        AlpcpPostCompletionList(Port);
+    }
+
+    AlpcpDereferenceCompletionList(List);
+    if (CompletionPort) ObDereferenceObject(CompletionPort);
+    ObDereferenceObject(Port);
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcCreatePortSection(IN HANDLE PortHandle,
+                        IN ULONG Flags,
+                        IN HANDLE SectionHandle OPTIONAL,
+                        IN SIZE_T SectionSize,
+                        OUT PALPC_HANDLE AlpcSectionHandle,
+                        OUT PSIZE_T ActualSectionSize)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    LARGE_INTEGER MaximumSize;
+    PVOID Section;
+    HANDLE Handle;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+    LPCTRACE(LPC_ALPC_DEBUG, "Section: %p. Size: %Ix\n", SectionHandle, SectionSize);
+
+    UNREFERENCED_PARAMETER(Flags);
+
+    Status = AlpcpCheckPortHandle(PortHandle, PreviousMode);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    if (SectionSize == 0) return STATUS_INVALID_PARAMETER_4;
+
+    if (PreviousMode != KernelMode)
+    {
+        _SEH2_TRY
+        {
+            ProbeForWriteHandle(AlpcSectionHandle);
+            ProbeForWriteSize_t(ActualSectionSize);
+        }
+        _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+        {
+            _SEH2_YIELD(return _SEH2_GetExceptionCode());
+        }
+        _SEH2_END;
+    }
+
+    /* The ALPC section handle is a plain section handle for now */
+    if (SectionHandle)
+    {
+        Status = ObReferenceObjectByHandle(SectionHandle,
+                                           SECTION_MAP_READ | SECTION_MAP_WRITE,
+                                           MmSectionObjectType,
+                                           PreviousMode,
+                                           &Section,
+                                           NULL);
+        if (!NT_SUCCESS(Status)) return Status;
+
+        Status = ObOpenObjectByPointer(Section,
+                                       0,
+                                       NULL,
+                                       SECTION_MAP_READ | SECTION_MAP_WRITE,
+                                       MmSectionObjectType,
+                                       PreviousMode,
+                                       &Handle);
+        ObDereferenceObject(Section);
+    }
+    else
+    {
+        MaximumSize.QuadPart = SectionSize;
+        Status = MmCreateSection(&Section,
+                                 SECTION_ALL_ACCESS,
+                                 NULL,
+                                 &MaximumSize,
+                                 PAGE_READWRITE,
+                                 SEC_COMMIT,
+                                 NULL,
+                                 NULL);
+        if (!NT_SUCCESS(Status)) return Status;
+
+        Status = ObInsertObject(Section,
+                                NULL,
+                                SECTION_MAP_READ | SECTION_MAP_WRITE | SECTION_QUERY,
+                                0,
+                                NULL,
+                                &Handle);
+    }
+    if (!NT_SUCCESS(Status)) return Status;
+
+    _SEH2_TRY
+    {
+        *AlpcSectionHandle = Handle;
+        *ActualSectionSize = ROUND_TO_PAGES(SectionSize);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        ObCloseHandle(Handle, PreviousMode);
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcDeletePortSection(IN HANDLE PortHandle,
+                        IN ULONG Flags,
+                        IN ALPC_HANDLE SectionHandle)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    PVOID Section;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(Flags);
+
+    Status = AlpcpCheckPortHandle(PortHandle, PreviousMode);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    /* Only close what NtAlpcCreatePortSection could have handed out */
+    Status = ObReferenceObjectByHandle(SectionHandle,
+                                       0,
+                                       MmSectionObjectType,
+                                       PreviousMode,
+                                       &Section,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+    ObDereferenceObject(Section);
+
+    return ObCloseHandle(SectionHandle, PreviousMode);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcCreateSectionView(IN HANDLE PortHandle,
+                        IN ULONG Flags,
+                        IN OUT PALPC_DATA_VIEW_ATTR ViewAttributes)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    ALPC_HANDLE SectionHandle;
+    PVOID Section, ViewBase = NULL;
+    SIZE_T ViewSize;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(Flags);
+
+    Status = AlpcpCheckPortHandle(PortHandle, PreviousMode);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    _SEH2_TRY
+    {
+        if (PreviousMode != KernelMode)
+            ProbeForWrite(ViewAttributes, sizeof(*ViewAttributes), sizeof(ULONG));
+
+        SectionHandle = ViewAttributes->SectionHandle;
+        ViewSize = ViewAttributes->ViewSize;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+    }
+    _SEH2_END;
+
+    Status = ObReferenceObjectByHandle(SectionHandle,
+                                       SECTION_MAP_READ | SECTION_MAP_WRITE,
+                                       MmSectionObjectType,
+                                       PreviousMode,
+                                       &Section,
+                                       NULL);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    Status = MmMapViewOfSection(Section,
+                                PsGetCurrentProcess(),
+                                &ViewBase,
+                                0,
+                                0,
+                                NULL,
+                                &ViewSize,
+                                ViewUnmap,
+                                0,
+                                PAGE_READWRITE);
+    ObDereferenceObject(Section);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    _SEH2_TRY
+    {
+        ViewAttributes->ViewBase = ViewBase;
+        ViewAttributes->ViewSize = ViewSize;
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        MmUnmapViewOfSection(PsGetCurrentProcess(), ViewBase);
+        Status = _SEH2_GetExceptionCode();
+    }
+    _SEH2_END;
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+NtAlpcDeleteSectionView(IN HANDLE PortHandle,
+                        IN ULONG Flags,
+                        IN PVOID ViewBase)
+{
+    KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    UNREFERENCED_PARAMETER(Flags);
+
+    Status = AlpcpCheckPortHandle(PortHandle, PreviousMode);
+    if (!NT_SUCCESS(Status)) return Status;
+
+    return MmUnmapViewOfSection(PsGetCurrentProcess(), ViewBase);
+}
+
+/* EOF */
@@ -45,6 +45,9 @@ LpcExitThread(IN PETHREAD Thread)
 
     /* Release the lock */
     KeReleaseGuardedMutex(&LpcpLock);
+
+    /* Drop any ALPC views nobody will pick up now */
+    AlpcpFlushThreadViews(Thread);
 }
 
 VOID
@@ -254,6 +257,9 @@ LpcpClosePort(IN PEPROCESS Process OPTIONAL,
     /* Only Server-side Connection Ports need clean up*/
     if ((Port->Flags & LPCP_PORT_TYPE_MASK) == LPCP_CONNECTION_PORT)
     {
+        /* The ALPC completion list goes with the server's last handle */
+        if (SystemHandleCount <= 1) AlpcpRundownPort(Port);
+
         /* Check the handle count */
         switch (SystemHandleCount)
         {
@@ -313,6 +319,9 @@ LpcpDeletePort(IN PVOID ObjectBody)
     PAGED_CODE();
     LPCTRACE(LPC_CLOSE_DEBUG, "Port: %p. Flags: %lx\n", Port, Port->Flags);
 
+    /* In case it got a completion list after its last handle was closed */
+    AlpcpRundownPort(Port);
+
     Timeout.QuadPart = -1000000;
 
     /* Check if this is a communication port */
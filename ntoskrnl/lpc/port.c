@@ -18,6 +18,8 @@ POBJECT_TYPE LpcPortObjectType, LpcWaitablePortObjectType;
 ULONG LpcpMaxMessageSize;
 PAGED_LOOKASIDE_LIST LpcpMessagesLookaside;
 KGUARDED_MUTEX LpcpLock;
+LIST_ENTRY AlpcpViewListHead;
+LIST_ENTRY AlpcpCompletionListHead;
 ULONG LpcpTraceLevel = 0;
 ULONG LpcpNextMessageId = 1, LpcpNextCallbackId = 1;
 
@@ -42,6 +44,12 @@ LpcInitSystem(VOID)
     /* Setup the LPC Lock */
     KeInitializeGuardedMutex(&LpcpLock);
 
+    /* Setup the list of ALPC views waiting for their receiver */
+    InitializeListHead(&AlpcpViewListHead);
+
+    /* And the list of ports with an ALPC completion list or I/O port */
+    InitializeListHead(&AlpcpCompletionListHead);
+
     /* Create the Port Object Type */
     RtlZeroMemory(&ObjectTypeInitializer, sizeof(ObjectTypeInitializer));
     RtlInitUnicodeString(&Name, L"Port");
@@ -158,6 +158,9 @@ LpcRequestPort(IN PVOID PortObject,
 
         KeLeaveCriticalRegion();
 
+        /* Hand it to the ALPC completion list if the port has one */
+        AlpcpPostCompletionList(QueuePort);
+
         /* We're done */
         if (ConnectionPort) ObDereferenceObject(ConnectionPort);
         LPCTRACE(LPC_SEND_DEBUG, "Port: %p. Message: %p\n", QueuePort, Message);
@@ -183,7 +186,7 @@ LpcRequestWaitReplyPort(IN PVOID PortObject,
     KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
     PETHREAD Thread = PsGetCurrentThread();
     PLPCP_PORT_OBJECT Port = (PLPCP_PORT_OBJECT)PortObject;
-    PLPCP_PORT_OBJECT QueuePort, ReplyPort, ConnectionPort = NULL;
+    PLPCP_PORT_OBJECT QueuePort = NULL, ReplyPort, ConnectionPort = NULL;
     USHORT MessageType;
     PLPCP_MESSAGE Message;
     BOOLEAN Callback = FALSE;
@@ -355,6 +358,9 @@ LpcRequestWaitReplyPort(IN PVOID PortObject,
     LpcpCompleteWait(Semaphore);
     KeLeaveCriticalRegion();
 
+    /* Hand it to the ALPC completion list if the port has one */
+    if (QueuePort) AlpcpPostCompletionList(QueuePort);
+
     /* And let's wait for the reply */
     LpcpReplyWait(&Thread->LpcReplySemaphore, PreviousMode);
 
@@ -622,6 +628,9 @@ NtRequestPort(IN HANDLE PortHandle,
 
         KeLeaveCriticalRegion();
 
+        /* Hand it to the ALPC completion list if the port has one */
+        AlpcpPostCompletionList(QueuePort);
+
         /* Dereference objects */
         if (ConnectionPort) ObDereferenceObject(ConnectionPort);
         ObDereferenceObject(QueuePort);
@@ -699,7 +708,7 @@ NtRequestWaitReplyPort(IN HANDLE PortHandle,
     NTSTATUS Status;
     PORT_MESSAGE CapturedLpcRequest;
     ULONG NumberOfDataEntries;
-    PLPCP_PORT_OBJECT Port, QueuePort, ReplyPort, ConnectionPort = NULL;
+    PLPCP_PORT_OBJECT Port, QueuePort = NULL, ReplyPort, ConnectionPort = NULL;
     PLPCP_MESSAGE Message;
     KPROCESSOR_MODE PreviousMode = KeGetPreviousMode();
     PETHREAD Thread = PsGetCurrentThread();
@@ -960,6 +969,9 @@ NtRequestWaitReplyPort(IN HANDLE PortHandle,
     LpcpCompleteWait(Semaphore);
     KeLeaveCriticalRegion();
 
+    /* Hand it to the ALPC completion list if the port has one */
+    if (QueuePort) AlpcpPostCompletionList(QueuePort);
+
     /* And let's wait for the reply */
     LpcpReplyWait(&Thread->LpcReplySemaphore, PreviousMode);
 
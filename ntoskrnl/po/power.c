@@ -480,8 +480,13 @@ VOID
 FASTCALL
 PopIdle0(IN PPROCESSOR_POWER_STATE PowerState)
 {
+#if defined(_M_IX86) || defined(_M_AMD64)
+    /* Let the HAL skip clock interrupts until the next timer is due */
+    HalProcessorIdleUntil(KiGetNextTimerDueTime());
+#else
     /* FIXME: Extremly naive implementation */
     HalProcessorIdle();
+#endif
 }
 
 CODE_SEG("INIT")
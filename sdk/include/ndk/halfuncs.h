@@ -117,6 +117,13 @@ HalProcessorIdle(
     VOID
 );
 
+NTHALAPI
+VOID
+NTAPI
+HalProcessorIdleUntil(
+    _In_ ULONGLONG DueTime
+);
+
 //
 // Interrupt Functions
 //
@@ -580,12 +580,32 @@ typedef struct _KUSER_SHARED_DATA
     ULONG LastSystemRITEventTickCount;
     ULONG NumberOfPhysicalPages;
     BOOLEAN SafeBootMode;
+    union
+    {
+        UCHAR TscQpcData;
+        struct
+        {
+            UCHAR TscQpcEnabled:1;
+            UCHAR TscQpcSpareFlag:1;
+            UCHAR TscQpcShift:6;
+        };
+    };
+    UCHAR TscQpcPad[2];
     ULONG TraceLogging;
     ULONG Fill0;
     ULONGLONG TestRetInstruction;
     ULONG SystemCall;
     ULONG SystemCallReturn;
-    ULONGLONG SystemCallPad[3];
+    union
+    {
+        ULONGLONG SystemCallPad[3];
+        struct
+        {
+            /* ReactOS specific, the user mode performance counter data */
+            volatile LONGLONG QpcFrequency;
+            volatile ULONGLONG QpcBias;
+        };
+    };
     union {
         volatile KSYSTEM_TIME TickCount;
         volatile ULONG64 TickCountQuad;
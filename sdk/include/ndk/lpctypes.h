@@ -293,4 +293,167 @@ typedef struct _CLIENT_DIED_MSG
     sizeof(PORT_MESSAGE) - \
     sizeof(LPCP_CONNECTION_MESSAGE))
 
+//
+// ALPC Message Flags
+//
+#define ALPC_MSGFLG_REPLY_MESSAGE               0x00000001
+#define ALPC_MSGFLG_LPC_MODE                    0x00000002
+#define ALPC_MSGFLG_RELEASE_MESSAGE             0x00010000
+#define ALPC_MSGFLG_SYNC_REQUEST                0x00020000
+#define ALPC_MSGFLG_WAIT_USER_MODE              0x00100000
+#define ALPC_MSGFLG_WAIT_ALERTABLE              0x00200000
+
+//
+// ALPC Message Attributes, laid out in this order after the header
+//
+#define ALPC_MESSAGE_SECURITY_ATTRIBUTE         0x80000000
+#define ALPC_MESSAGE_VIEW_ATTRIBUTE             0x40000000
+#define ALPC_MESSAGE_CONTEXT_ATTRIBUTE          0x20000000
+#define ALPC_MESSAGE_HANDLE_ATTRIBUTE           0x10000000
+#define ALPC_MESSAGE_TOKEN_ATTRIBUTE            0x08000000
+#define ALPC_MESSAGE_DIRECT_ATTRIBUTE           0x04000000
+
+//
+// ALPC Handle
+//
+typedef HANDLE ALPC_HANDLE, *PALPC_HANDLE;
+
+//
+// ALPC Port Attributes
+//
+typedef struct _ALPC_PORT_ATTRIBUTES
+{
+    ULONG Flags;
+    SECURITY_QUALITY_OF_SERVICE SecurityQos;
+    SIZE_T MaxMessageLength;
+    SIZE_T MemoryBandwidth;
+    SIZE_T MaxPoolUsage;
+    SIZE_T MaxSectionSize;
+    SIZE_T MaxViewSize;
+    SIZE_T MaxTotalSectionSize;
+    ULONG DupObjectTypes;
+#ifdef _WIN64
+    ULONG Reserved;
+#endif
+} ALPC_PORT_ATTRIBUTES, *PALPC_PORT_ATTRIBUTES;
+
+//
+// ALPC Message Attributes
+//
+typedef struct _ALPC_MESSAGE_ATTRIBUTES
+{
+    ULONG AllocatedAttributes;
+    ULONG ValidAttributes;
+} ALPC_MESSAGE_ATTRIBUTES, *PALPC_MESSAGE_ATTRIBUTES;
+
+typedef struct _ALPC_SECURITY_ATTR
+{
+    ULONG Flags;
+    PSECURITY_QUALITY_OF_SERVICE QoS;
+    ALPC_HANDLE ContextHandle;
+} ALPC_SECURITY_ATTR, *PALPC_SECURITY_ATTR;
+
+typedef struct _ALPC_DATA_VIEW_ATTR
+{
+    ULONG Flags;
+    ALPC_HANDLE SectionHandle;
+    PVOID ViewBase;
+    SIZE_T ViewSize;
+} ALPC_DATA_VIEW_ATTR, *PALPC_DATA_VIEW_ATTR;
+
+typedef struct _ALPC_CONTEXT_ATTR
+{
+    PVOID PortContext;
+    PVOID MessageContext;
+    ULONG Sequence;
+    ULONG MessageId;
+    ULONG CallbackId;
+} ALPC_CONTEXT_ATTR, *PALPC_CONTEXT_ATTR;
+
+typedef struct _ALPC_HANDLE_ATTR
+{
+    ULONG Flags;
+    HANDLE Handle;
+    ULONG ObjectType;
+    ACCESS_MASK DesiredAccess;
+} ALPC_HANDLE_ATTR, *PALPC_HANDLE_ATTR;
+
+typedef struct _ALPC_TOKEN_ATTR
+{
+    ULONGLONG TokenId;
+    ULONGLONG AuthenticationId;
+    ULONGLONG ModifiedId;
+} ALPC_TOKEN_ATTR, *PALPC_TOKEN_ATTR;
+
+typedef struct _ALPC_DIRECT_ATTR
+{
+    HANDLE Event;
+} ALPC_DIRECT_ATTR, *PALPC_DIRECT_ATTR;
+
+//
+// ALPC Port Information Classes for NtAlpcSetInformation
+//
+typedef enum _ALPC_PORT_INFORMATION_CLASS
+{
+    AlpcBasicInformation,
+    AlpcPortInformation,
+    AlpcAssociateCompletionPortInformation,
+    AlpcConnectedSIDInformation,
+    AlpcServerInformation,
+    AlpcMessageZoneInformation,
+    AlpcRegisterCompletionListInformation,
+    AlpcUnregisterCompletionListInformation,
+    AlpcAdjustCompletionListConcurrencyCountInformation,
+    AlpcRegisterCallbackInformation,
+    AlpcCompletionListRundownInformation,
+    MaxAlpcPortInfoClass
+} ALPC_PORT_INFORMATION_CLASS;
+
+typedef struct _ALPC_PORT_ASSOCIATE_COMPLETION_PORT
+{
+    PVOID CompletionKey;
+    HANDLE CompletionPort;
+} ALPC_PORT_ASSOCIATE_COMPLETION_PORT, *PALPC_PORT_ASSOCIATE_COMPLETION_PORT;
+
+typedef struct _ALPC_PORT_COMPLETION_LIST_INFORMATION
+{
+    PVOID Buffer;
+    ULONG Size;
+    ULONG ConcurrencyCount;
+    ULONG AttributeFlags;
+} ALPC_PORT_COMPLETION_LIST_INFORMATION, *PALPC_PORT_COMPLETION_LIST_INFORMATION;
+
+//
+// ALPC Completion List, filled in by the kernel when it is registered.
+// The header is followed by EntryCount states, EntryCount queue slots
+// holding an entry index plus one, and the entries themselves: the
+// message attributes for AttributeFlags, then the message.
+//
+#define ALPC_COMPLETION_LIST_ENTRY_FREE         0
+#define ALPC_COMPLETION_LIST_ENTRY_USED         1
+
+#define ALPC_COMPLETION_LIST_MAXIMUM_SIZE       0x1000000
+
+typedef struct _ALPC_COMPLETION_LIST_HEADER
+{
+    ULONG Size;
+    ULONG AttributeFlags;
+    ULONG AttributeSize;
+    ULONG MessageSize;
+    ULONG EntrySize;
+    ULONG EntryCount;
+    ULONG StateOffset;
+    ULONG QueueOffset;
+    ULONG DataOffset;
+    ULONG ConcurrencyCount;
+    volatile LONG PostCount;
+    volatile LONG ReturnCount;
+    volatile LONG OutstandingCount;
+    volatile LONG WorkerCount;
+    volatile LONG Backlog;
+    ULONG LastMessageId;
+    ULONG LastCallbackId;
+    HANDLE PortHandle;
+} ALPC_COMPLETION_LIST_HEADER, *PALPC_COMPLETION_LIST_HEADER;
+
 #endif // _LPCTYPES_H
@@ -205,6 +205,9 @@ extern "C" {
 #define COPY_FILE_FAIL_IF_EXISTS 0x00000001
 #define COPY_FILE_RESTARTABLE 0x00000002
 #define COPY_FILE_OPEN_SOURCE_FOR_WRITE 0x00000004
+#if (_WIN32_WINNT >= 0x0600)
+#define COPY_FILE_NO_BUFFERING 0x00001000
+#endif
 #define FILE_FLAG_WRITE_THROUGH	0x80000000
 #define FILE_FLAG_OVERLAPPED	1073741824
 #define FILE_FLAG_NO_BUFFERING	536870912
@@ -1780,6 +1783,123 @@ ChangeTimerQueueTimer(
 
 #endif /* (_WIN32_WINNT >= 0x0500) */
 
+#if (_WIN32_WINNT >= 0x0600)
+
+typedef VOID
+(WINAPI *PTP_WIN32_IO_CALLBACK)(
+  _Inout_ PTP_CALLBACK_INSTANCE Instance,
+  _Inout_opt_ PVOID Context,
+  _Inout_opt_ PVOID Overlapped,
+  _In_ ULONG IoResult,
+  _In_ ULONG_PTR NumberOfBytesTransferred,
+  _Inout_ PTP_IO Io);
+
+_Must_inspect_result_ PTP_POOL WINAPI CreateThreadpool(_Reserved_ PVOID);
+VOID WINAPI CloseThreadpool(_Inout_ PTP_POOL);
+VOID WINAPI SetThreadpoolThreadMaximum(_Inout_ PTP_POOL, _In_ DWORD);
+BOOL WINAPI SetThreadpoolThreadMinimum(_Inout_ PTP_POOL, _In_ DWORD);
+
+_Must_inspect_result_ PTP_CLEANUP_GROUP WINAPI CreateThreadpoolCleanupGroup(VOID);
+VOID WINAPI CloseThreadpoolCleanupGroup(_Inout_ PTP_CLEANUP_GROUP);
+VOID WINAPI CloseThreadpoolCleanupGroupMembers(_Inout_ PTP_CLEANUP_GROUP, _In_ BOOL, _Inout_opt_ PVOID);
+
+_Must_inspect_result_ BOOL WINAPI TrySubmitThreadpoolCallback(_In_ PTP_SIMPLE_CALLBACK, _Inout_opt_ PVOID, _In_opt_ PTP_CALLBACK_ENVIRON);
+
+_Must_inspect_result_ PTP_WORK WINAPI CreateThreadpoolWork(_In_ PTP_WORK_CALLBACK, _Inout_opt_ PVOID, _In_opt_ PTP_CALLBACK_ENVIRON);
+VOID WINAPI SubmitThreadpoolWork(_Inout_ PTP_WORK);
+VOID WINAPI WaitForThreadpoolWorkCallbacks(_Inout_ PTP_WORK, _In_ BOOL);
+VOID WINAPI CloseThreadpoolWork(_Inout_ PTP_WORK);
+
+_Must_inspect_result_ PTP_TIMER WINAPI CreateThreadpoolTimer(_In_ PTP_TIMER_CALLBACK, _Inout_opt_ PVOID, _In_opt_ PTP_CALLBACK_ENVIRON);
+VOID WINAPI SetThreadpoolTimer(_Inout_ PTP_TIMER, _In_opt_ PFILETIME, _In_ DWORD, _In_opt_ DWORD);
+BOOL WINAPI IsThreadpoolTimerSet(_Inout_ PTP_TIMER);
+VOID WINAPI WaitForThreadpoolTimerCallbacks(_Inout_ PTP_TIMER, _In_ BOOL);
+VOID WINAPI CloseThreadpoolTimer(_Inout_ PTP_TIMER);
+
+_Must_inspect_result_ PTP_WAIT WINAPI CreateThreadpoolWait(_In_ PTP_WAIT_CALLBACK, _Inout_opt_ PVOID, _In_opt_ PTP_CALLBACK_ENVIRON);
+VOID WINAPI SetThreadpoolWait(_Inout_ PTP_WAIT, _In_opt_ HANDLE, _In_opt_ PFILETIME);
+VOID WINAPI WaitForThreadpoolWaitCallbacks(_Inout_ PTP_WAIT, _In_ BOOL);
+VOID WINAPI CloseThreadpoolWait(_Inout_ PTP_WAIT);
+
+_Must_inspect_result_ PTP_IO WINAPI CreateThreadpoolIo(_In_ HANDLE, _In_ PTP_WIN32_IO_CALLBACK, _Inout_opt_ PVOID, _In_opt_ PTP_CALLBACK_ENVIRON);
+VOID WINAPI StartThreadpoolIo(_Inout_ PTP_IO);
+VOID WINAPI CancelThreadpoolIo(_Inout_ PTP_IO);
+VOID WINAPI WaitForThreadpoolIoCallbacks(_Inout_ PTP_IO, _In_ BOOL);
+VOID WINAPI CloseThreadpoolIo(_Inout_ PTP_IO);
+
+BOOL WINAPI CallbackMayRunLong(_Inout_ PTP_CALLBACK_INSTANCE);
+VOID WINAPI DisassociateCurrentThreadFromCallback(_Inout_ PTP_CALLBACK_INSTANCE);
+VOID WINAPI FreeLibraryWhenCallbackReturns(_Inout_ PTP_CALLBACK_INSTANCE, _In_ HMODULE);
+VOID WINAPI LeaveCriticalSectionWhenCallbackReturns(_Inout_ PTP_CALLBACK_INSTANCE, _Inout_ PCRITICAL_SECTION);
+VOID WINAPI ReleaseMutexWhenCallbackReturns(_Inout_ PTP_CALLBACK_INSTANCE, _In_ HANDLE);
+VOID WINAPI ReleaseSemaphoreWhenCallbackReturns(_Inout_ PTP_CALLBACK_INSTANCE, _In_ HANDLE, _In_ DWORD);
+VOID WINAPI SetEventWhenCallbackReturns(_Inout_ PTP_CALLBACK_INSTANCE, _In_ HANDLE);
+
+FORCEINLINE
+VOID
+InitializeThreadpoolEnvironment(
+  _Out_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+  TpInitializeCallbackEnviron(CallbackEnviron);
+}
+
+FORCEINLINE
+VOID
+SetThreadpoolCallbackPool(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron,
+  _In_ PTP_POOL Pool)
+{
+  TpSetCallbackThreadpool(CallbackEnviron, Pool);
+}
+
+FORCEINLINE
+VOID
+SetThreadpoolCallbackCleanupGroup(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron,
+  _In_ PTP_CLEANUP_GROUP CleanupGroup,
+  _In_opt_ PTP_CLEANUP_GROUP_CANCEL_CALLBACK CleanupGroupCancelCallback)
+{
+  TpSetCallbackCleanupGroup(CallbackEnviron, CleanupGroup, CleanupGroupCancelCallback);
+}
+
+FORCEINLINE
+VOID
+SetThreadpoolCallbackRunsLong(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+  TpSetCallbackLongFunction(CallbackEnviron);
+}
+
+FORCEINLINE
+VOID
+SetThreadpoolCallbackLibrary(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron,
+  _In_ PVOID Module)
+{
+  TpSetCallbackRaceWithDll(CallbackEnviron, Module);
+}
+
+#if (_WIN32_WINNT >= 0x0601)
+FORCEINLINE
+VOID
+SetThreadpoolCallbackPriority(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron,
+  _In_ TP_CALLBACK_PRIORITY Priority)
+{
+  TpSetCallbackPriority(CallbackEnviron, Priority);
+}
+#endif
+
+FORCEINLINE
+VOID
+DestroyThreadpoolEnvironment(
+  _Inout_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+  TpDestroyCallbackEnviron(CallbackEnviron);
+}
+
+#endif /* (_WIN32_WINNT >= 0x0600) */
+
 HANDLE WINAPI CreateThread(LPSECURITY_ATTRIBUTES,DWORD,LPTHREAD_START_ROUTINE,PVOID,DWORD,PDWORD);
 _Ret_maybenull_ HANDLE WINAPI CreateWaitableTimerA(_In_opt_ LPSECURITY_ATTRIBUTES, _In_ BOOL, _In_opt_ LPCSTR);
 _Ret_maybenull_ HANDLE WINAPI CreateWaitableTimerW(_In_opt_ LPSECURITY_ATTRIBUTES, _In_ BOOL, _In_opt_ LPCWSTR);
@@ -3281,6 +3401,11 @@ DWORD WINAPI WaitForSingleObject(_In_ HANDLE hHandle, _In_ DWORD dwMilliseconds)
 DWORD WINAPI WaitForSingleObjectEx(HANDLE,DWORD,BOOL);
 BOOL WINAPI WaitNamedPipeA(_In_ LPCSTR, _In_ DWORD);
 BOOL WINAPI WaitNamedPipeW(_In_ LPCWSTR, _In_ DWORD);
+#if (_WIN32_WINNT >= 0x0602)
+BOOL WINAPI WaitOnAddress(_In_reads_bytes_(AddressSize) volatile VOID *Address, _In_reads_bytes_(AddressSize) PVOID CompareAddress, _In_ SIZE_T AddressSize, _In_opt_ DWORD dwMilliseconds);
+VOID WINAPI WakeByAddressAll(_In_ PVOID Address);
+VOID WINAPI WakeByAddressSingle(_In_ PVOID Address);
+#endif
 #if (_WIN32_WINNT >= 0x0600)
 VOID WINAPI WakeConditionVariable(PCONDITION_VARIABLE);
 VOID WINAPI WakeAllConditionVariable(PCONDITION_VARIABLE);
@@ -539,6 +539,8 @@ struct _FAST486_STATE
     BOOLEAN DoNotInterrupt;
     PULONG Tlb;
     BOOLEAN TlbEmpty;
+    PUCHAR *DirectMap;
+    ULONG DirectMapPages;
 #ifndef FAST486_NO_PREFETCH
     BOOLEAN PrefetchValid;
     ULONG PrefetchAddress;
@@ -619,6 +621,29 @@ VOID
 NTAPI
 Fast486Rewind(PFAST486_STATE State);
 
+VOID
+NTAPI
+Fast486SetDirectMap(PFAST486_STATE State, PUCHAR *DirectMap, ULONG NumPages);
+
+BOOLEAN
+NTAPI
+Fast486MapDirectMemory
+(
+    PFAST486_STATE State,
+    ULONG PhysicalAddress,
+    ULONG Size,
+    PVOID HostAddress
+);
+
+VOID
+NTAPI
+Fast486UnmapDirectMemory
+(
+    PFAST486_STATE State,
+    ULONG PhysicalAddress,
+    ULONG Size
+);
+
 #endif // _FAST486_H_
 
 /* EOF */
@@ -1183,7 +1183,7 @@ typedef struct _KUSER_SHARED_DATA {
   ULONG LastSystemRITEventTickCount;
   ULONG NumberOfPhysicalPages;
   BOOLEAN SafeBootMode;
-#if (NTDDI_VERSION >= NTDDI_WIN7)
+#if (NTDDI_VERSION >= NTDDI_WIN7) || defined(__REACTOS__)
   _ANONYMOUS_UNION union {
     UCHAR TscQpcData;
     _ANONYMOUS_STRUCT struct {
@@ -1215,7 +1215,18 @@ typedef struct _KUSER_SHARED_DATA {
   ULONGLONG TestRetInstruction;
   ULONG SystemCall;
   ULONG SystemCallReturn;
+#ifdef __REACTOS__
+  /* ReactOS keeps the user mode performance counter data here */
+  _ANONYMOUS_UNION union {
+    ULONGLONG SystemCallPad[3];
+    _ANONYMOUS_STRUCT struct {
+      volatile LONGLONG QpcFrequency;
+      volatile ULONGLONG QpcBias;
+    } DUMMYSTRUCTNAME;
+  } DUMMYUNIONNAME4;
+#else
   ULONGLONG SystemCallPad[3];
+#endif
   _ANONYMOUS_UNION union {
     volatile KSYSTEM_TIME TickCount;
     volatile ULONG64 TickCountQuad;
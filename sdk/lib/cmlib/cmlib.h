@@ -111,6 +111,12 @@
         IN ULONG NumberToFind,
         IN ULONG HintIndex);
 
+    ULONG NTAPI
+    RtlFindNextForwardRunSet(
+        IN PRTL_BITMAP BitMapHeader,
+        IN ULONG FromIndex,
+        OUT PULONG StartingRunIndex);
+
     VOID NTAPI
     RtlSetBits(
         IN PRTL_BITMAP BitMapHeader,
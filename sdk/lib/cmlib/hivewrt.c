@@ -9,6 +9,70 @@
 #define NDEBUG
 #include <debug.h>
 
+/*
+ * Writes BlockCount stable blocks starting at BlockIndex to the file at
+ * FileOffset. Blocks of the same bin are contiguous in memory, so this
+ * issues one write per bin instead of one per block.
+ */
+static BOOLEAN CMAPI
+HvpWriteBlocks(
+    PHHIVE RegistryHive,
+    ULONG FileType,
+    ULONG FileOffset,
+    ULONG BlockIndex,
+    ULONG BlockCount)
+{
+    PHMAP_ENTRY BlockList = RegistryHive->Storage[Stable].BlockList;
+    ULONG_PTR BlockPtr;
+    ULONG Length;
+    BOOLEAN Success;
+
+    while (BlockCount > 0)
+    {
+        BlockPtr = BlockList[BlockIndex].BlockAddress;
+        for (Length = 1; Length < BlockCount; Length++)
+        {
+            if (BlockList[BlockIndex + Length].BlockAddress != BlockPtr + Length * HBLOCK_SIZE)
+                break;
+        }
+
+        Success = RegistryHive->FileWrite(RegistryHive, FileType, &FileOffset,
+                                          (PVOID)BlockPtr, Length * HBLOCK_SIZE);
+        if (!Success)
+        {
+            return FALSE;
+        }
+
+        FileOffset += Length * HBLOCK_SIZE;
+        BlockIndex += Length;
+        BlockCount -= Length;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Returns the length of the next run of dirty blocks at or after
+ * BlockIndex, or 0 if there is none.
+ */
+static ULONG CMAPI
+HvpFindDirtyRun(
+    PHHIVE RegistryHive,
+    ULONG BlockIndex,
+    PULONG RunIndex)
+{
+    ULONG Length;
+
+    Length = RtlFindNextForwardRunSet(&RegistryHive->DirtyVector, BlockIndex, RunIndex);
+    if (Length == 0 || *RunIndex >= RegistryHive->Storage[Stable].Length)
+    {
+        return 0;
+    }
+
+    /* The bitmap may be larger than the hive */
+    return min(Length, RegistryHive->Storage[Stable].Length - *RunIndex);
+}
+
 static BOOLEAN CMAPI
 HvpWriteLog(
     PHHIVE RegistryHive)
@@ -19,8 +83,8 @@ HvpWriteLog(
     PUCHAR Buffer;
     PUCHAR Ptr;
     ULONG BlockIndex;
-    ULONG LastIndex;
-    PVOID BlockPtr;
+    ULONG RunIndex;
+    ULONG RunLength;
     BOOLEAN Success;
     static ULONG PrintCount = 0;
 
@@ -78,30 +142,20 @@ HvpWriteLog(
         return FALSE;
     }
 
-    /* Write dirty blocks */
+    /* Write dirty blocks, packed one after the other */
     FileOffset = BufferSize;
     BlockIndex = 0;
-    while (BlockIndex < RegistryHive->Storage[Stable].Length)
+    while ((RunLength = HvpFindDirtyRun(RegistryHive, BlockIndex, &RunIndex)) != 0)
     {
-        LastIndex = BlockIndex;
-        BlockIndex = RtlFindSetBits(&RegistryHive->DirtyVector, 1, BlockIndex);
-        if (BlockIndex == ~0U || BlockIndex < LastIndex)
-        {
-            break;
-        }
-
-        BlockPtr = (PVOID)RegistryHive->Storage[Stable].BlockList[BlockIndex].BlockAddress;
-
-        /* Write hive block */
-        Success = RegistryHive->FileWrite(RegistryHive, HFILE_TYPE_LOG,
-                                         &FileOffset, BlockPtr, HBLOCK_SIZE);
+        Success = HvpWriteBlocks(RegistryHive, HFILE_TYPE_LOG,
+                                 FileOffset, RunIndex, RunLength);
         if (!Success)
         {
             return FALSE;
         }
 
-        BlockIndex++;
-        FileOffset += HBLOCK_SIZE;
+        BlockIndex = RunIndex + RunLength;
+        FileOffset += RunLength * HBLOCK_SIZE;
     }
 
     Success = RegistryHive->FileSetSize(RegistryHive, HFILE_TYPE_LOG, FileOffset, FileOffset);
@@ -150,8 +204,8 @@ HvpWriteHive(
 {
     ULONG FileOffset;
     ULONG BlockIndex;
-    ULONG LastIndex;
-    PVOID BlockPtr;
+    ULONG RunIndex;
+    ULONG RunLength;
     BOOLEAN Success;
 
     ASSERT(RegistryHive->ReadOnly == FALSE);
@@ -182,31 +236,31 @@ HvpWriteHive(
         return FALSE;
     }
 
-    BlockIndex = 0;
-    while (BlockIndex < RegistryHive->Storage[Stable].Length)
+    if (OnlyDirty)
     {
-        if (OnlyDirty)
+        /* Write each run of dirty blocks in place */
+        BlockIndex = 0;
+        while ((RunLength = HvpFindDirtyRun(RegistryHive, BlockIndex, &RunIndex)) != 0)
         {
-            LastIndex = BlockIndex;
-            BlockIndex = RtlFindSetBits(&RegistryHive->DirtyVector, 1, BlockIndex);
-            if (BlockIndex == ~0U || BlockIndex < LastIndex)
+            Success = HvpWriteBlocks(RegistryHive, HFILE_TYPE_PRIMARY,
+                                     (RunIndex + 1) * HBLOCK_SIZE, RunIndex, RunLength);
+            if (!Success)
             {
-                break;
+                return FALSE;
             }
-        }
 
-        BlockPtr = (PVOID)RegistryHive->Storage[Stable].BlockList[BlockIndex].BlockAddress;
-        FileOffset = (BlockIndex + 1) * HBLOCK_SIZE;
-
-        /* Write hive block */
-        Success = RegistryHive->FileWrite(RegistryHive, HFILE_TYPE_PRIMARY,
-                                          &FileOffset, BlockPtr, HBLOCK_SIZE);
+            BlockIndex = RunIndex + RunLength;
+        }
+    }
+    else
+    {
+        /* Write all hive blocks */
+        Success = HvpWriteBlocks(RegistryHive, HFILE_TYPE_PRIMARY, HBLOCK_SIZE,
+                                 0, RegistryHive->Storage[Stable].Length);
         if (!Success)
         {
             return FALSE;
         }
-
-        BlockIndex++;
     }
 
     Success = RegistryHive->FileFlush(RegistryHive, HFILE_TYPE_PRIMARY, NULL, 0);
@@ -24,6 +24,92 @@ ULONG ChecksumFold(
   return Sum;
 }
 
+#if !defined(_M_IX86) && !defined(_M_AMD64)
+/* Portable version of the routine in i386/checksum.S and amd64/checksum.S */
+unsigned int
+csum_partial(
+  const unsigned char * buff,
+  int len,
+  unsigned int sum)
+/*
+ * FUNCTION: Calculate a 32-bit partial checksum of a buffer
+ * ARGUMENTS:
+ *     buff = Pointer to buffer with data
+ *     len  = Number of bytes in buffer
+ *     sum  = Previously calculated partial checksum (if any)
+ * RETURNS:
+ *     Partial checksum, to be folded with ChecksumFold
+ */
+{
+  ULONGLONG Sum = 0;
+  BOOLEAN Odd;
+  ULONG Result;
+
+  if (len <= 0)
+    return sum;
+
+  /* Sum the buffer as if it was aligned, and swap the bytes of the
+     result at the end if it wasn't */
+  Odd = ((ULONG_PTR)buff & 1) != 0;
+  if (Odd)
+    {
+      Sum = (ULONG)*buff << 8;
+      buff++;
+      len--;
+    }
+
+  if (len >= 2 && ((ULONG_PTR)buff & 2))
+    {
+      Sum += *(PUSHORT)buff;
+      buff += 2;
+      len -= 2;
+    }
+
+  /* Add 32-bit words to a 64-bit accumulator, so no carries are lost */
+  while (len >= 16)
+    {
+      Sum += ((PULONG)buff)[0];
+      Sum += ((PULONG)buff)[1];
+      Sum += ((PULONG)buff)[2];
+      Sum += ((PULONG)buff)[3];
+      buff += 16;
+      len -= 16;
+    }
+
+  while (len >= 4)
+    {
+      Sum += *(PULONG)buff;
+      buff += 4;
+      len -= 4;
+    }
+
+  if (len >= 2)
+    {
+      Sum += *(PUSHORT)buff;
+      buff += 2;
+      len -= 2;
+    }
+
+  /* Add left-over byte, if any */
+  if (len > 0)
+    Sum += *buff;
+
+  /* Fold to 32 bits */
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Sum = (Sum & 0xFFFFFFFF) + (Sum >> 32);
+  Result = (ULONG)Sum;
+
+  if (Odd)
+    Result = (Result << 8) | (Result >> 24);
+
+  Result += sum;
+  if (Result < sum)
+    Result++;
+
+  return Result;
+}
+#endif
+
 ULONG ChecksumCompute(
   PVOID Data,
   UINT Count,
@@ -38,68 +124,114 @@ ULONG ChecksumCompute(
  *     Checksum of buffer
  */
 {
-  register ULONG Sum = Seed;
+  return csum_partial(Data, Count, Seed);
+}
 
-  while (Count > 1)
-    {
-      Sum += *(PUSHORT)Data;
-      Count -= 2;
-      Data = (PVOID)((ULONG_PTR) Data + 2);
-    }
+ULONG
+IPv4PseudoHeaderSum(
+  PIPv4_HEADER IPHeader,
+  UCHAR Protocol,
+  ULONG Length)
+/*
+ * FUNCTION: Calculate the partial checksum of the pseudo header used by TCP and UDP
+ * ARGUMENTS:
+ *     IPHeader = Pointer to IPv4 header with the addresses
+ *     Protocol = Transport protocol number
+ *     Length   = Length of transport header and data
+ * RETURNS:
+ *     Partial checksum, in the byte order of the data
+ */
+{
+  ULONG Sum;
 
-  /* Add left-over byte, if any */
-  if (Count > 0)
-    {
-      Sum += *(PUCHAR)Data;
-    }
+  Sum  = ((PUSHORT)&IPHeader->SrcAddr)[0] + ((PUSHORT)&IPHeader->SrcAddr)[1];
+  Sum += ((PUSHORT)&IPHeader->DstAddr)[0] + ((PUSHORT)&IPHeader->DstAddr)[1];
+  Sum += WH2N((USHORT)Protocol);
+  Sum += WH2N((USHORT)Length);
 
   return Sum;
 }
 
-ULONG
-UDPv4ChecksumCalculate(
+USHORT
+IPv4TransportChecksum(
   PIPv4_HEADER IPHeader,
-  PUCHAR PacketBuffer,
-  ULONG DataLength)
+  UCHAR Protocol,
+  PVOID Data,
+  ULONG Length)
+/*
+ * FUNCTION: Calculate the checksum of a TCP or UDP segment
+ * ARGUMENTS:
+ *     IPHeader = Pointer to IPv4 header with the addresses
+ *     Protocol = Transport protocol number
+ *     Data     = Pointer to transport header and data
+ *     Length   = Length of transport header and data
+ * RETURNS:
+ *     Checksum to store in the transport header, or zero if the
+ *     segment already contains a correct checksum
+ */
 {
-  ULONG Sum = 0;
-  USHORT TmpSum;
-  ULONG i;
-  BOOLEAN Pad;
-
-  /* Pad the data if needed */
-  Pad = (DataLength & 1);
-  if (Pad)
-      DataLength++;
-
-  /* Add from the UDP header and data */
-  for (i = 0; i < DataLength; i += 2)
-  {
-       TmpSum = ((PacketBuffer[i] << 8) & 0xFF00) +
-                ((Pad && i == DataLength - 2) ? 0 : (PacketBuffer[i+1] & 0x00FF));
-       Sum += TmpSum;
-  }
-
-  /* Add the source address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->SrcAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->SrcAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the destination address */
-  for (i = 0; i < sizeof(IPv4_RAW_ADDRESS); i += 2)
-  {
-       TmpSum = ((((PUCHAR)&IPHeader->DstAddr)[i] << 8) & 0xFF00) +
-                (((PUCHAR)&IPHeader->DstAddr)[i+1] & 0x00FF);
-       Sum += TmpSum;
-  }
-
-  /* Add the proto number and length */
-  Sum += IPPROTO_UDP + (DataLength - (Pad ? 1 : 0));
-
-  /* Fold the checksum and return the one's complement */
-  return ~ChecksumFold(Sum);
+  return (USHORT)~ChecksumFold(csum_partial(Data,
+                                            Length,
+                                            IPv4PseudoHeaderSum(IPHeader, Protocol, Length)));
 }
 
+USHORT
+ChecksumUpdate(
+  USHORT Checksum,
+  USHORT OldValue,
+  USHORT NewValue)
+/*
+ * FUNCTION: Update a checksum after a 16-bit field it covers was changed (RFC 1624)
+ * ARGUMENTS:
+ *     Checksum = Current checksum
+ *     OldValue = Old value of the field
+ *     NewValue = New value of the field
+ * RETURNS:
+ *     New checksum
+ * NOTES:
+ *     All values are in the byte order they are stored in the packet
+ */
+{
+  ULONG Sum;
+
+  Sum = (USHORT)~Checksum + (USHORT)~OldValue + NewValue;
+
+  return (USHORT)~ChecksumFold(Sum);
+}
+
+BOOLEAN
+ChecksumOffloadPacket(
+  PIP_INTERFACE Interface,
+  PIP_PACKET IPPacket,
+  ULONG Offload)
+/*
+ * FUNCTION: Leave the transport checksum of a packet to the adapter if it can compute it
+ * ARGUMENTS:
+ *     Interface = Interface the packet will be sent on
+ *     IPPacket  = Pointer to IP packet
+ *     Offload   = IP_CHECKSUM_OFFLOAD_TCP or IP_CHECKSUM_OFFLOAD_UDP
+ * RETURNS:
+ *     TRUE if the adapter will compute the checksum, in which case the
+ *     checksum field must be set to the pseudo header checksum. FALSE
+ *     if the checksum has to be computed in software
+ * NOTES:
+ *     Packets that will be fragmented are never offloaded
+ */
+{
+  NDIS_TCP_IP_CHECKSUM_PACKET_INFO ChecksumInfo;
+
+  if (!(Interface->ChecksumOffload & Offload) || IPPacket->TotalSize > Interface->MTU)
+    return FALSE;
+
+  ChecksumInfo.Value = 0;
+  ChecksumInfo.Transmit.NdisPacketChecksumV4 = 1;
+  if (Offload == IP_CHECKSUM_OFFLOAD_TCP)
+    ChecksumInfo.Transmit.NdisPacketTcpChecksum = 1;
+  else
+    ChecksumInfo.Transmit.NdisPacketUdpChecksum = 1;
+
+  NDIS_PER_PACKET_INFO_FROM_PACKET(IPPacket->NdisPacket,
+                                   TcpIpChecksumPacketInfo) = UlongToPtr(ChecksumInfo.Value);
+
+  return TRUE;
+}
@@ -463,6 +463,11 @@ VOID ProcessFragment(
 
     Success = ReassembleDatagram(&Datagram, IPDR);
 
+    /* Checksums verified by the adapter are only valid for datagrams
+       that were received in one piece */
+    if (FragFirst == 0 && !MoreFragments)
+      Datagram.Flags |= IPPacket->Flags & IP_PACKET_FLAG_CHECKSUM_OK;
+
     FreeIPDR(IPDR);
 
     if (!Success)
@@ -611,8 +616,9 @@ VOID IPv4Receive(PIP_INTERFACE IF, PIP_PACKET IPPacket)
         return;
     }
 
-    /* Checksum IPv4 header */
-    if (!IPv4CorrectChecksum(IPPacket->Header, IPPacket->HeaderSize)) {
+    /* Checksum IPv4 header, unless the adapter already did */
+    if (!(IPPacket->Flags & IP_PACKET_FLAG_IP_CHECKSUM_OK) &&
+        !IPv4CorrectChecksum(IPPacket->Header, IPPacket->HeaderSize)) {
         TI_DbgPrint(MIN_TRACE, ("Datagram received with bad checksum. Checksum field (0x%X)\n",
 	      WN2H(((PIPv4_HEADER)IPPacket->Header)->Checksum)));
         /* Discard packet */
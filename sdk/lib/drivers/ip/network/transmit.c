@@ -74,7 +74,7 @@ BOOLEAN PrepareNextFragment(
     UINT DataSize;
     PIPv4_HEADER Header;
     BOOLEAN MoreFragments;
-    USHORT FragOfs;
+    USHORT FragOfs, TotalLength;
 
     TI_DbgPrint(MAX_TRACE, ("Called. IFC (0x%X)\n", IFC));
 
@@ -106,15 +106,18 @@ BOOLEAN PrepareNextFragment(
         else
             FragOfs &= ~IPv4_MF_MASK;
 
-        Header = IFC->Header;
-        Header->FlagsFragOfs = WH2N(FragOfs);
-        Header->TotalLength = WH2N((USHORT)(DataSize + IFC->HeaderSize));
+        FragOfs = WH2N(FragOfs);
+        TotalLength = WH2N((USHORT)(DataSize + IFC->HeaderSize));
 
         /* FIXME: Handle options */
 
-        /* Calculate checksum of IP header */
-        Header->Checksum = 0;
-        Header->Checksum = (USHORT)IPv4Checksum(Header, IFC->HeaderSize, 0);
+        /* Only two fields change from one fragment to the next, so update
+           the checksum computed by SendFragments instead of recomputing it */
+        Header = IFC->Header;
+        Header->Checksum = ChecksumUpdate(Header->Checksum, Header->FlagsFragOfs, FragOfs);
+        Header->FlagsFragOfs = FragOfs;
+        Header->Checksum = ChecksumUpdate(Header->Checksum, Header->TotalLength, TotalLength);
+        Header->TotalLength = TotalLength;
 	TI_DbgPrint(MID_TRACE,("IP Check: %x\n", Header->Checksum));
 
         /* Update pointers */
@@ -196,6 +199,18 @@ NTSTATUS SendFragments(
 
     RtlCopyMemory( IFC->Header, IPPacket->Header, IPPacket->HeaderSize );
 
+    /* Calculate checksum of IP header */
+    ((PIPv4_HEADER)IFC->Header)->Checksum = 0;
+    ((PIPv4_HEADER)IFC->Header)->Checksum = (USHORT)IPv4Checksum(IFC->Header, IFC->HeaderSize, 0);
+
+    /* If the datagram is sent in one piece, the adapter may compute the
+       transport checksum as requested by the transport protocol */
+    if (IPPacket->TotalSize <= PathMTU)
+    {
+        NDIS_PER_PACKET_INFO_FROM_PACKET(IFC->NdisPacket, TcpIpChecksumPacketInfo) =
+            NDIS_PER_PACKET_INFO_FROM_PACKET(IPPacket->NdisPacket, TcpIpChecksumPacketInfo);
+    }
+
     while (PrepareNextFragment(IFC))
     {
         NdisStatus = IPSendFragment(IFC->NdisPacket, NCE, IFC);
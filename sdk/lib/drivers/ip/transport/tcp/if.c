@@ -15,6 +15,7 @@ TCPSendDataCallback(struct netif *netif, struct pbuf *p, struct ip_addr *dest)
     IP_PACKET Packet;
     IP_ADDRESS RemoteAddress, LocalAddress;
     PIPv4_HEADER Header;
+    PTCPv4_HEADER TCPHeader;
     ULONG Length;
     ULONG TotalLength;
 
@@ -70,6 +71,25 @@ TCPSendDataCallback(struct netif *netif, struct pbuf *p, struct ip_addr *dest)
     Packet.SrcAddr = LocalAddress;
     Packet.DstAddr = RemoteAddress;
 
+    /* lwIP leaves the TCP checksum to us */
+    if (((PIPv4_HEADER)Packet.Header)->Protocol == IPPROTO_TCP)
+    {
+        Header = Packet.Header;
+        TCPHeader = (PTCPv4_HEADER)((PCHAR)Header + Packet.HeaderSize);
+        Length = TotalLength - Packet.HeaderSize;
+
+        if (ChecksumOffloadPacket(NCE->Interface, &Packet, IP_CHECKSUM_OFFLOAD_TCP))
+        {
+            /* The adapter completes the checksum */
+            TCPHeader->Checksum = (USHORT)ChecksumFold(IPv4PseudoHeaderSum(Header, IPPROTO_TCP, Length));
+        }
+        else
+        {
+            TCPHeader->Checksum = 0;
+            TCPHeader->Checksum = IPv4TransportChecksum(Header, IPPROTO_TCP, TCPHeader, Length);
+        }
+    }
+
     NdisStatus = IPSendDatagram(&Packet, NCE);
     if (!NT_SUCCESS(NdisStatus))
         return ERR_RTE;
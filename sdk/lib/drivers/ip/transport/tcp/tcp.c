@@ -176,7 +176,18 @@ VOID TCPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
     TI_DbgPrint(DEBUG_TCP,("Sending packet %d (%d) to lwIP\n",
                            IPPacket->TotalSize,
                            IPPacket->HeaderSize));
-    
+
+    /* lwIP doesn't check the TCP checksum, the adapter may have done it already */
+    if (!(IPPacket->Flags & IP_PACKET_FLAG_TCP_CHECKSUM_OK) &&
+        IPv4TransportChecksum(IPPacket->Header,
+                              IPPROTO_TCP,
+                              (PCHAR)IPPacket->Header + IPPacket->HeaderSize,
+                              IPPacket->TotalSize - IPPacket->HeaderSize) != 0)
+    {
+        TI_DbgPrint(MIN_TRACE, ("Bad checksum on TCP segment received.\n"));
+        return;
+    }
+
     LibIPInsertPacket(Interface->TCPContext, IPPacket->Header, IPPacket->TotalSize);
 }
 
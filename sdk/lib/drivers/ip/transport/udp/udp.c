@@ -21,7 +21,8 @@ NTSTATUS AddUDPHeaderIPv4(
     USHORT LocalPort,
     PIP_PACKET IPPacket,
     PVOID Data,
-    UINT DataLength)
+    UINT DataLength,
+    PIP_INTERFACE Interface)
 /*
  * FUNCTION: Adds an IPv4 and UDP header to an IP packet
  * ARGUMENTS:
@@ -29,6 +30,7 @@ NTSTATUS AddUDPHeaderIPv4(
  *     LocalAddress = Pointer to our local address
  *     LocalPort    = The port we send this datagram from
  *     IPPacket     = Pointer to IP packet
+ *     Interface    = Interface the packet will be sent on
  * RETURNS:
  *     Status of operation
  */
@@ -61,10 +63,24 @@ NTSTATUS AddUDPHeaderIPv4(
 
     RtlCopyMemory(IPPacket->Data, Data, DataLength);
 
-    UDPHeader->Checksum = UDPv4ChecksumCalculate((PIPv4_HEADER)IPPacket->Header,
-                                                 (PUCHAR)UDPHeader,
-                                                 DataLength + sizeof(UDP_HEADER));
-    UDPHeader->Checksum = WH2N(UDPHeader->Checksum);
+    if (ChecksumOffloadPacket(Interface, IPPacket, IP_CHECKSUM_OFFLOAD_UDP))
+    {
+        /* The adapter completes the checksum */
+        UDPHeader->Checksum = (USHORT)ChecksumFold(IPv4PseudoHeaderSum((PIPv4_HEADER)IPPacket->Header,
+                                                                       IPPROTO_UDP,
+                                                                       DataLength + sizeof(UDP_HEADER)));
+    }
+    else
+    {
+        UDPHeader->Checksum = IPv4TransportChecksum((PIPv4_HEADER)IPPacket->Header,
+                                                    IPPROTO_UDP,
+                                                    UDPHeader,
+                                                    DataLength + sizeof(UDP_HEADER));
+
+        /* A zero checksum means that there is no checksum */
+        if (UDPHeader->Checksum == 0)
+            UDPHeader->Checksum = 0xFFFF;
+    }
 
     TI_DbgPrint(MID_TRACE, ("Packet: %d ip %d udp %d payload\n",
 			    (PCHAR)UDPHeader - (PCHAR)IPPacket->Header,
@@ -83,7 +99,8 @@ NTSTATUS BuildUDPPacket(
     PIP_ADDRESS LocalAddress,
     USHORT LocalPort,
     PCHAR DataBuffer,
-    UINT DataLen )
+    UINT DataLen,
+    PIP_INTERFACE Interface )
 /*
  * FUNCTION: Builds an UDP packet
  * ARGUMENTS:
@@ -91,6 +108,7 @@ NTSTATUS BuildUDPPacket(
  *     LocalAddress = Pointer to our local address
  *     LocalPort    = The port we send this datagram from
  *     IPPacket     = Address of pointer to IP packet
+ *     Interface    = Interface the packet will be sent on
  * RETURNS:
  *     Status of operation
  */
@@ -122,7 +140,8 @@ NTSTATUS BuildUDPPacket(
     switch (RemoteAddress->Type) {
         case IP_ADDRESS_V4:
             Status = AddUDPHeaderIPv4(AddrFile, RemoteAddress, RemotePort,
-                                      LocalAddress, LocalPort, Packet, DataBuffer, DataLen);
+                                      LocalAddress, LocalPort, Packet, DataBuffer, DataLen,
+                                      Interface);
             break;
         case IP_ADDRESS_V6:
             /* FIXME: Support IPv6 */
@@ -221,7 +240,8 @@ NTSTATUS UDPSendDatagram(
 							 &LocalAddress,
 							 AddrFile->Port,
 							 BufferData,
-							 DataSize );
+							 DataSize,
+							 NCE->Interface );
 
     UnlockObject(AddrFile, OldIrql);
 
@@ -279,11 +299,13 @@ VOID UDPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
 
   UDPHeader = (PUDP_HEADER)IPPacket->Data;
 
-  /* Calculate and validate UDP checksum */
-  i = UDPv4ChecksumCalculate(IPv4Header,
-                             (PUCHAR)UDPHeader,
-                             WH2N(UDPHeader->Length));
-  if (i != DH2N(0x0000FFFF) && UDPHeader->Checksum != 0)
+  /* Calculate and validate UDP checksum, unless the adapter already did */
+  if (!(IPPacket->Flags & IP_PACKET_FLAG_UDP_CHECKSUM_OK) &&
+      UDPHeader->Checksum != 0 &&
+      IPv4TransportChecksum(IPv4Header,
+                            IPPROTO_UDP,
+                            UDPHeader,
+                            WH2N(UDPHeader->Length)) != 0)
   {
       TI_DbgPrint(MIN_TRACE, ("Bad checksum on packet received.\n"));
       return;
@@ -43,8 +43,9 @@ typedef ULONG_PTR mem_ptr_t;
 /* Endianness */
 #define BYTE_ORDER LITTLE_ENDIAN
 
-/* Checksum calculation algorithm choice */
-#define LWIP_CHKSUM_ALGORITHM 3
+/* Checksum calculation, done by the routine shared with the IP library */
+u16_t LibIPChecksum(void *dataptr, u16_t len);
+#define LWIP_CHKSUM LibIPChecksum
 
 /* Diagnostics */
 #define LWIP_PLATFORM_DIAG(x) (DbgPrint x)
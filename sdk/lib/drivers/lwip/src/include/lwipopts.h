@@ -50,6 +50,18 @@
 
 #define LWIP_TCP                        1
 
+/* The IP library computes the IP header checksum of every fragment it
+ * sends and verifies it on receive. TCP checksums are computed and
+ * verified by TCPSendDataCallback and TCPReceive, which can leave them
+ * to the adapter when it supports checksum offload */
+#define CHECKSUM_GEN_IP                 0
+
+#define CHECKSUM_GEN_TCP                0
+
+#define CHECKSUM_CHECK_IP               0
+
+#define CHECKSUM_CHECK_TCP              0
+
 #define TCP_QUEUE_OOSEQ                 1
 
 #define SO_REUSE                        1
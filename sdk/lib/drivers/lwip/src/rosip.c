@@ -8,6 +8,9 @@
 
 typedef struct netif* PNETIF;
 
+/* in sdk/lib/drivers/ip/network/checksum.c or the assembly versions */
+unsigned int csum_partial(const unsigned char *buff, int len, unsigned int sum);
+
 void
 LibIPInsertPacket(void *ifarg,
                   const void *const data,
@@ -43,4 +46,16 @@ LibIPShutdown(void)
 {
     /* This is synchronous */
     sys_shutdown();
-}
\ No newline at end of file
+}
+
+u16_t
+LibIPChecksum(void *dataptr, u16_t len)
+{
+    u32_t sum = csum_partial(dataptr, len, 0);
+
+    /* Fold to 16 bits, lwIP complements the result itself */
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    return (u16_t)sum;
+}
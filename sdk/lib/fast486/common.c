@@ -273,11 +273,11 @@ Fast486GetIntVector(PFAST486_STATE State,
         ULONG FarPointer;
 
         /* Paging is always disabled in real mode */
-        State->MemReadCallback(State,
-                               State->Idtr.Address
-                               + Number * sizeof(FarPointer),
-                               &FarPointer,
-                               sizeof(FarPointer));
+        Fast486ReadPhysicalMemory(State,
+                                  State->Idtr.Address
+                                  + Number * sizeof(FarPointer),
+                                  &FarPointer,
+                                  sizeof(FarPointer));
 
         /* Fill a fake IDT entry */
         IdtEntry->Offset = LOWORD(FarPointer);
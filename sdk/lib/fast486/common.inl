@@ -60,6 +60,104 @@ Fast486GetCurrentPrivLevel(PFAST486_STATE State)
     return (!State->Flags.Vm) ? State->Cpl : 3;
 }
 
+FORCEINLINE
+VOID
+FASTCALL
+Fast486CopyHostMemory(PVOID Destination, const VOID *Source, ULONG Size)
+{
+    /* Most guest accesses are small, don't go through RtlCopyMemory for those */
+    switch (Size)
+    {
+        case sizeof(UCHAR):
+            *(PUCHAR)Destination = *(const UCHAR *)Source;
+            break;
+
+        case sizeof(USHORT):
+            *(USHORT UNALIGNED *)Destination = *(const USHORT UNALIGNED *)Source;
+            break;
+
+        case sizeof(ULONG):
+            *(ULONG UNALIGNED *)Destination = *(const ULONG UNALIGNED *)Source;
+            break;
+
+        default:
+            RtlCopyMemory(Destination, Source, Size);
+            break;
+    }
+}
+
+FORCEINLINE
+PUCHAR
+FASTCALL
+Fast486GetDirectPage(PFAST486_STATE State, ULONG PhysicalAddress)
+{
+    ULONG Page = PhysicalAddress >> 12;
+
+    /* Return the host mapping of this page, or NULL if it must use the callbacks */
+    if (Page >= State->DirectMapPages) return NULL;
+    return State->DirectMap[Page];
+}
+
+FORCEINLINE
+VOID
+FASTCALL
+Fast486ReadPhysicalMemory(PFAST486_STATE State,
+                          ULONG PhysicalAddress,
+                          PVOID Buffer,
+                          ULONG Size)
+{
+    while (Size)
+    {
+        ULONG Length = min(Size, FAST486_PAGE_SIZE - PAGE_OFFSET(PhysicalAddress));
+        PUCHAR HostPage = Fast486GetDirectPage(State, PhysicalAddress);
+
+        if (HostPage != NULL)
+        {
+            /* Plain RAM, read it directly */
+            Fast486CopyHostMemory(Buffer, HostPage + PAGE_OFFSET(PhysicalAddress), Length);
+        }
+        else
+        {
+            /* Hooked or unmapped memory, let the embedder handle it */
+            State->MemReadCallback(State, PhysicalAddress, Buffer, Length);
+        }
+
+        PhysicalAddress += Length;
+        Buffer = (PVOID)((ULONG_PTR)Buffer + Length);
+        Size -= Length;
+    }
+}
+
+FORCEINLINE
+VOID
+FASTCALL
+Fast486WritePhysicalMemory(PFAST486_STATE State,
+                           ULONG PhysicalAddress,
+                           PVOID Buffer,
+                           ULONG Size)
+{
+    while (Size)
+    {
+        ULONG Length = min(Size, FAST486_PAGE_SIZE - PAGE_OFFSET(PhysicalAddress));
+        PUCHAR HostPage = Fast486GetDirectPage(State, PhysicalAddress);
+
+        if (HostPage != NULL)
+        {
+            /* Plain RAM, write it directly */
+            Fast486CopyHostMemory(HostPage + PAGE_OFFSET(PhysicalAddress), Buffer, Length);
+        }
+        else
+        {
+            /* Hooked or unmapped memory, let the embedder handle it */
+            State->MemWriteCallback(State, PhysicalAddress, Buffer, Length);
+        }
+
+        PhysicalAddress += Length;
+        Buffer = (PVOID)((ULONG_PTR)Buffer + Length);
+        Size -= Length;
+    }
+}
+
 FORCEINLINE
 ULONG
 FASTCALL
@@ -81,10 +179,10 @@ Fast486GetPageTableEntry(PFAST486_STATE State,
     }
 
     /* Read the directory entry */
-    State->MemReadCallback(State,
-                           PageDirectory + PdeIndex * sizeof(ULONG),
-                           &DirectoryEntry.Value,
-                           sizeof(DirectoryEntry));
+    Fast486ReadPhysicalMemory(State,
+                              PageDirectory + PdeIndex * sizeof(ULONG),
+                              &DirectoryEntry.Value,
+                              sizeof(DirectoryEntry));
 
     /* Make sure it is present */
     if (!DirectoryEntry.Present) return 0;
@@ -96,18 +194,18 @@ Fast486GetPageTableEntry(PFAST486_STATE State,
         DirectoryEntry.Accessed = TRUE;
 
         /* Write back the directory entry */
-        State->MemWriteCallback(State,
-                                PageDirectory + PdeIndex * sizeof(ULONG),
-                                &DirectoryEntry.Value,
-                                sizeof(DirectoryEntry));
+        Fast486WritePhysicalMemory(State,
+                                   PageDirectory + PdeIndex * sizeof(ULONG),
+                                   &DirectoryEntry.Value,
+                                   sizeof(DirectoryEntry));
     }
 
     /* Read the table entry */
-    State->MemReadCallback(State,
-                           (DirectoryEntry.TableAddress << 12)
-                           + PteIndex * sizeof(ULONG),
-                           &TableEntry.Value,
-                           sizeof(TableEntry));
+    Fast486ReadPhysicalMemory(State,
+                              (DirectoryEntry.TableAddress << 12)
+                              + PteIndex * sizeof(ULONG),
+                              &TableEntry.Value,
+                              sizeof(TableEntry));
 
     /* Make sure it is present */
     if (!TableEntry.Present) return 0;
@@ -120,11 +218,11 @@ Fast486GetPageTableEntry(PFAST486_STATE State,
         if (MarkAsDirty) TableEntry.Dirty = TRUE;
 
         /* Write back the table entry */
-        State->MemWriteCallback(State,
-                                (DirectoryEntry.TableAddress << 12)
-                                + PteIndex * sizeof(ULONG),
-                                &TableEntry.Value,
-                                sizeof(TableEntry));
+        Fast486WritePhysicalMemory(State,
+                                   (DirectoryEntry.TableAddress << 12)
+                                   + PteIndex * sizeof(ULONG),
+                                   &TableEntry.Value,
+                                   sizeof(TableEntry));
     }
 
     /*
@@ -208,10 +306,10 @@ Fast486ReadLinearMemory(PFAST486_STATE State,
             }
 
             /* Read the memory */
-            State->MemReadCallback(State,
-                                   (TableEntry.Address << 12) | PageOffset,
-                                   (PVOID)((ULONG_PTR)Buffer + BufferOffset),
-                                   PageLength);
+            Fast486ReadPhysicalMemory(State,
+                                      (TableEntry.Address << 12) | PageOffset,
+                                      (PVOID)((ULONG_PTR)Buffer + BufferOffset),
+                                      PageLength);
 
             BufferOffset += PageLength;
         }
@@ -219,7 +317,7 @@ Fast486ReadLinearMemory(PFAST486_STATE State,
     else
     {
         /* Read the memory */
-        State->MemReadCallback(State, LinearAddress, Buffer, Size);
+        Fast486ReadPhysicalMemory(State, LinearAddress, Buffer, Size);
     }
 
     return TRUE;
@@ -281,10 +379,10 @@ Fast486WriteLinearMemory(PFAST486_STATE State,
             }
 
             /* Write the memory */
-            State->MemWriteCallback(State,
-                                    (TableEntry.Address << 12) | PageOffset,
-                                    (PVOID)((ULONG_PTR)Buffer + BufferOffset),
-                                    PageLength);
+            Fast486WritePhysicalMemory(State,
+                                       (TableEntry.Address << 12) | PageOffset,
+                                       (PVOID)((ULONG_PTR)Buffer + BufferOffset),
+                                       PageLength);
 
             BufferOffset += PageLength;
         }
@@ -292,7 +390,7 @@ Fast486WriteLinearMemory(PFAST486_STATE State,
     else
     {
         /* Write the memory */
-        State->MemWriteCallback(State, LinearAddress, Buffer, Size);
+        Fast486WritePhysicalMemory(State, LinearAddress, Buffer, Size);
     }
 
     return TRUE;
@@ -122,6 +122,10 @@ Fast486Initialize(PFAST486_STATE         State,
     /* Set the TLB (if given) */
     State->Tlb = Tlb;
 
+    /* No direct memory map until Fast486SetDirectMap is called */
+    State->DirectMap = NULL;
+    State->DirectMapPages = 0;
+
     /* Reset the CPU */
     Fast486Reset(State);
 }
@@ -132,7 +136,7 @@ Fast486Reset(PFAST486_STATE State)
 {
     FAST486_SEG_REGS i;
 
-    /* Save the callbacks and TLB */
+    /* Save the callbacks, the TLB and the direct memory map */
     FAST486_MEM_READ_PROC  MemReadCallback  = State->MemReadCallback;
     FAST486_MEM_WRITE_PROC MemWriteCallback = State->MemWriteCallback;
     FAST486_IO_READ_PROC   IoReadCallback   = State->IoReadCallback;
@@ -141,6 +145,8 @@ Fast486Reset(PFAST486_STATE State)
     FAST486_INT_ACK_PROC   IntAckCallback   = State->IntAckCallback;
     FAST486_FPU_PROC       FpuCallback      = State->FpuCallback;
     PULONG                 Tlb              = State->Tlb;
+    PUCHAR                *DirectMap        = State->DirectMap;
+    ULONG                  DirectMapPages   = State->DirectMapPages;
 
     /* Clear the entire structure */
     RtlZeroMemory(State, sizeof(*State));
@@ -186,7 +192,7 @@ Fast486Reset(PFAST486_STATE State)
     State->FpuTag = 0xFFFF;
 #endif
 
-    /* Restore the callbacks and TLB */
+    /* Restore the callbacks, the TLB and the direct memory map */
     State->MemReadCallback  = MemReadCallback;
     State->MemWriteCallback = MemWriteCallback;
     State->IoReadCallback   = IoReadCallback;
@@ -195,6 +201,8 @@ Fast486Reset(PFAST486_STATE State)
     State->IntAckCallback   = IntAckCallback;
     State->FpuCallback      = FpuCallback;
     State->Tlb              = Tlb;
+    State->DirectMap        = DirectMap;
+    State->DirectMapPages   = DirectMapPages;
 
     /* Flush the TLB */
     Fast486FlushTlb(State);
@@ -260,4 +268,77 @@ Fast486Rewind(PFAST486_STATE State)
 #endif
 }
 
+VOID
+NTAPI
+Fast486SetDirectMap(PFAST486_STATE State, PUCHAR *DirectMap, ULONG NumPages)
+{
+    /*
+     * The map has one entry per physical page, holding the host address of
+     * the page, or NULL if accesses to it must go through the callbacks.
+     * The embedder owns the storage and must keep it alive.
+     */
+    State->DirectMap = DirectMap;
+    State->DirectMapPages = DirectMap ? NumPages : 0;
+
+    if (DirectMap) RtlZeroMemory(DirectMap, NumPages * sizeof(PUCHAR));
+
+#ifndef FAST486_NO_PREFETCH
+    State->PrefetchValid = FALSE;
+#endif
+}
+
+BOOLEAN
+NTAPI
+Fast486MapDirectMemory(PFAST486_STATE State,
+                       ULONG PhysicalAddress,
+                       ULONG Size,
+                       PVOID HostAddress)
+{
+    ULONG i;
+    ULONG FirstPage = PhysicalAddress >> 12;
+    ULONG NumPages = (Size + FAST486_PAGE_SIZE - 1) >> 12;
+
+    /* Only whole pages inside the map can be directly mapped */
+    if ((PAGE_OFFSET(PhysicalAddress) != 0)
+        || (PAGE_OFFSET((ULONG_PTR)HostAddress) != 0)
+        || (FirstPage > State->DirectMapPages)
+        || (NumPages > State->DirectMapPages - FirstPage))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < NumPages; i++)
+    {
+        State->DirectMap[FirstPage + i] = (PUCHAR)HostAddress + (i << 12);
+    }
+
+#ifndef FAST486_NO_PREFETCH
+    State->PrefetchValid = FALSE;
+#endif
+
+    return TRUE;
+}
+
+VOID
+NTAPI
+Fast486UnmapDirectMemory(PFAST486_STATE State,
+                         ULONG PhysicalAddress,
+                         ULONG Size)
+{
+    ULONG Page = PhysicalAddress >> 12;
+    ULONG LastPage = (PhysicalAddress + Size - 1) >> 12;
+
+    if (Size == 0) return;
+
+    /* Send these pages back through the callbacks */
+    for (; (Page <= LastPage) && (Page < State->DirectMapPages); Page++)
+    {
+        State->DirectMap[Page] = NULL;
+    }
+
+#ifndef FAST486_NO_PREFETCH
+    State->PrefetchValid = FALSE;
+#endif
+}
+
 /* EOF */
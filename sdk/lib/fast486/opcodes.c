@@ -5290,6 +5290,123 @@ FAST486_OPCODE_HANDLER(Fast486OpcodeMovs)
     if (Opcode == 0xA4) DataSize = sizeof(UCHAR);
     else DataSize = OperandSize ? sizeof(ULONG) : sizeof(USHORT);
 
+    if (State->PrefixFlags & (FAST486_PREFIX_REP | FAST486_PREFIX_REPNZ))
+    {
+        UCHAR Block[STRING_BLOCK_SIZE];
+        ULONG Count = AddressSize ? State->GeneralRegs[FAST486_REG_ECX].Long
+                                  : State->GeneralRegs[FAST486_REG_ECX].LowWord;
+
+        /* Transfer until finished */
+        while (Count)
+        {
+            ULONG Processed = min(Count, STRING_BLOCK_SIZE / DataSize);
+            ULONG SourceOffset = AddressSize ? State->GeneralRegs[FAST486_REG_ESI].Long
+                                             : State->GeneralRegs[FAST486_REG_ESI].LowWord;
+            ULONG DestOffset = AddressSize ? State->GeneralRegs[FAST486_REG_EDI].Long
+                                           : State->GeneralRegs[FAST486_REG_EDI].LowWord;
+            ULONG SourceLinear = State->SegmentRegs[Segment].Base + SourceOffset;
+            ULONG DestLinear = State->SegmentRegs[FAST486_REG_ES].Base + DestOffset;
+
+            /* Simulate the 16-bit wrap-around of SI and DI in 16-bit address mode */
+            if (!AddressSize)
+            {
+                ULONG MaxBytes = State->Flags.Df
+                                 ? min(SourceOffset, DestOffset)
+                                 : (0x10000 - max(SourceOffset, DestOffset));
+
+                Processed = min(Processed, MaxBytes / DataSize);
+                if (Processed == 0) Processed = 1;
+            }
+
+            /*
+             * If the destination trails the source by less than a block, a
+             * single element copy would read back data written by this very
+             * instruction, so limit the block to the distance between them.
+             */
+            if (!State->Flags.Df && (DestLinear > SourceLinear))
+            {
+                Processed = min(Processed, (DestLinear - SourceLinear) / DataSize);
+                if (Processed == 0) Processed = 1;
+            }
+            else if (State->Flags.Df && (DestLinear < SourceLinear))
+            {
+                Processed = min(Processed, (SourceLinear - DestLinear) / DataSize);
+                if (Processed == 0) Processed = 1;
+            }
+
+            if (State->Flags.Df)
+            {
+                /* Start from the lowest element of the run */
+                SourceOffset -= (Processed - 1) * DataSize;
+                DestOffset -= (Processed - 1) * DataSize;
+
+                if (!AddressSize)
+                {
+                    SourceOffset &= 0xFFFF;
+                    DestOffset &= 0xFFFF;
+                }
+            }
+
+            /* Copy the whole run at once */
+            if (!Fast486ReadMemory(State,
+                                   Segment,
+                                   SourceOffset,
+                                   FALSE,
+                                   Block,
+                                   Processed * DataSize)
+                || !Fast486WriteMemory(State,
+                                       FAST486_REG_ES,
+                                       DestOffset,
+                                       Block,
+                                       Processed * DataSize))
+            {
+                /* Set ECX */
+                if (AddressSize) State->GeneralRegs[FAST486_REG_ECX].Long = Count;
+                else State->GeneralRegs[FAST486_REG_ECX].LowWord = LOWORD(Count);
+
+                /* Exception occurred */
+                return;
+            }
+
+            /* Move ESI and EDI past the run */
+            if (AddressSize)
+            {
+                if (!State->Flags.Df)
+                {
+                    State->GeneralRegs[FAST486_REG_ESI].Long += Processed * DataSize;
+                    State->GeneralRegs[FAST486_REG_EDI].Long += Processed * DataSize;
+                }
+                else
+                {
+                    State->GeneralRegs[FAST486_REG_ESI].Long -= Processed * DataSize;
+                    State->GeneralRegs[FAST486_REG_EDI].Long -= Processed * DataSize;
+                }
+            }
+            else
+            {
+                if (!State->Flags.Df)
+                {
+                    State->GeneralRegs[FAST486_REG_ESI].LowWord += Processed * DataSize;
+                    State->GeneralRegs[FAST486_REG_EDI].LowWord += Processed * DataSize;
+                }
+                else
+                {
+                    State->GeneralRegs[FAST486_REG_ESI].LowWord -= Processed * DataSize;
+                    State->GeneralRegs[FAST486_REG_EDI].LowWord -= Processed * DataSize;
+                }
+            }
+
+            /* Reduce the total count by the number processed in this run */
+            Count -= Processed;
+        }
+
+        /* Clear ECX */
+        if (AddressSize) State->GeneralRegs[FAST486_REG_ECX].Long = 0;
+        else State->GeneralRegs[FAST486_REG_ECX].LowWord = 0;
+
+        return;
+    }
+
     /* Read from the source operand */
     if (!Fast486ReadMemory(State,
                            Segment,
@@ -5342,27 +5459,6 @@ FAST486_OPCODE_HANDLER(Fast486OpcodeMovs)
             State->GeneralRegs[FAST486_REG_EDI].LowWord -= DataSize;
         }
     }
-
-    // FIXME: This method is slow!
-    if (State->PrefixFlags & (FAST486_PREFIX_REP | FAST486_PREFIX_REPNZ))
-    {
-        if (AddressSize)
-        {
-            if (--State->GeneralRegs[FAST486_REG_ECX].Long)
-            {
-                /* Repeat the instruction */
-                State->InstPtr = State->SavedInstPtr;
-            }
-        }
-        else
-        {
-            if (--State->GeneralRegs[FAST486_REG_ECX].LowWord)
-            {
-                /* Repeat the instruction */
-                State->InstPtr = State->SavedInstPtr;
-            }
-        }
-    }
 }
 
 FAST486_OPCODE_HANDLER(Fast486OpcodeCmps)
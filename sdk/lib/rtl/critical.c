@@ -15,6 +15,7 @@
 #include <debug.h>
 
 #define MAX_STATIC_CS_DEBUG_OBJECTS 64
+#define MIN_CS_SPIN_COUNT 16
 
 static RTL_CRITICAL_SECTION RtlCriticalSectionLock;
 static LIST_ENTRY RtlCriticalSectionList = {&RtlCriticalSectionList, &RtlCriticalSectionList};
@@ -191,6 +192,84 @@ RtlpWaitForCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
     }
 }
 
+/*++
+ * RtlpSpinOnCriticalSection
+ *
+ *     Spins for a short while waiting for the critical section to be
+ *     released, before RtlEnterCriticalSection has to wait on its Event.
+ *
+ * Params:
+ *     CriticalSection - Critical section to acquire.
+ *
+ * Returns:
+ *     TRUE if the critical section was acquired, FALSE otherwise.
+ *
+ * Remarks:
+ *     Spins at most SpinCount times. Critical sections using our own
+ *     Debug Object keep a running average of the spins that were needed
+ *     there, and only spin up to twice that average.
+ *
+ *--*/
+static
+BOOLEAN
+RtlpSpinOnCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
+{
+    PRTL_CRITICAL_SECTION_DEBUG DebugInfo = CriticalSection->DebugInfo;
+    volatile LONG *LockCount = &CriticalSection->LockCount;
+    ULONG_PTR MaxSpins = CriticalSection->SpinCount;
+    ULONG_PTR Spins;
+    BOOLEAN Adaptive;
+
+    /*
+     * Wine's static Debug Objects keep a name in Flags, and extend it
+     * over the spare fields on 64 bit, so leave those alone.
+     */
+    Adaptive = (DebugInfo != NULL &&
+                DebugInfo != (PRTL_CRITICAL_SECTION_DEBUG)-1 &&
+                DebugInfo->Flags == 0);
+    if (Adaptive)
+    {
+        MaxSpins = min(MaxSpins, DebugInfo->SpareWORD * 2 + MIN_CS_SPIN_COUNT);
+        MaxSpins = min(MaxSpins, MAXUSHORT);
+    }
+
+    for (Spins = 0; ; Spins++)
+    {
+        if (*LockCount == -1 &&
+            InterlockedCompareExchange(&CriticalSection->LockCount, 0, -1) == -1)
+        {
+            break;
+        }
+
+        /*
+         * Waiters get the critical section before us once it is released,
+         * so only spin while the owner is alone.
+         */
+        if (*LockCount > 0)
+            return FALSE;
+
+        if (Spins == MaxSpins)
+        {
+            /* No luck this time, next time spin a bit longer */
+            if (Adaptive)
+                DebugInfo->SpareWORD += (WORD)((LONG)(MaxSpins - DebugInfo->SpareWORD) / 8);
+            return FALSE;
+        }
+
+        YieldProcessor();
+    }
+
+    if (Spins && DebugInfo && DebugInfo != (PRTL_CRITICAL_SECTION_DEBUG)-1)
+    {
+        /* We had contention, but got it without waiting */
+        DebugInfo->ContentionCount++;
+        if (Adaptive)
+            DebugInfo->SpareWORD += (WORD)((LONG)(Spins - DebugInfo->SpareWORD) / 8);
+    }
+
+    return TRUE;
+}
+
 /*++
  * RtlpUnWaitCriticalSection
  *
@@ -473,7 +552,8 @@ RtlSetCriticalSectionSpinCount(PRTL_CRITICAL_SECTION CriticalSection,
  *     STATUS_SUCCESS.
  *
  * Remarks:
- *     Uses a fast-path unless contention happens.
+ *     Uses a fast-path unless contention happens. With a spin count, spins
+ *     for a while before waiting for the critical section to be released.
  *
  *--*/
 NTSTATUS
@@ -482,8 +562,17 @@ RtlEnterCriticalSection(PRTL_CRITICAL_SECTION CriticalSection)
 {
     HANDLE Thread = (HANDLE)NtCurrentTeb()->ClientId.UniqueThread;
 
-    /* Try to lock it */
-    if (InterlockedIncrement(&CriticalSection->LockCount) != 0)
+    /*
+     * Spin to get it first if we were asked to, unless we already own it.
+     * Otherwise try to lock it.
+     */
+    if (CriticalSection->SpinCount &&
+        Thread != CriticalSection->OwningThread &&
+        RtlpSpinOnCriticalSection(CriticalSection))
+    {
+        /* We got it while spinning, no need to wait */
+    }
+    else if (InterlockedIncrement(&CriticalSection->LockCount) != 0)
     {
         /* We've failed to lock it! Does this thread actually own it? */
         if (Thread == CriticalSection->OwningThread)
@@ -594,6 +683,7 @@ RtlInitializeCriticalSectionAndSpinCount(PRTL_CRITICAL_SECTION CriticalSection,
     CritcalSectionDebugData->EntryCount = 0;
     CritcalSectionDebugData->CriticalSection = CriticalSection;
     CritcalSectionDebugData->Flags = 0;
+    CritcalSectionDebugData->SpareWORD = 0;
     CriticalSection->DebugInfo = CritcalSectionDebugData;
 
     /*
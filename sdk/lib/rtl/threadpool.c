@@ -0,0 +1,2270 @@
+/*
+ * COPYRIGHT:         See COPYING in the top level directory
+ * PROJECT:           ReactOS system libraries
+ * PURPOSE:           Vista thread pool (Tp* functions)
+ * FILE:              lib/rtl/threadpool.c
+ * PROGRAMMER:
+ */
+
+/* NOTE: Every pool owns an I/O completion port. Idle workers block on it,
+   so I/O completions and "work available" wakeups share the same wait.
+   Work posted from outside the pool goes to one of three global priority
+   queues. Normal priority work posted by a callback goes to the deque of
+   the worker running it instead, which the owner uses as a LIFO and other
+   workers steal from in FIFO order once the global queues run dry. This
+   keeps fan-out work on the thread that produced it and off the shared
+   queue lock. */
+
+/* INCLUDES *****************************************************************/
+
+#include <rtl_vista.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* Condition variables are implemented in condvar.c */
+VOID
+NTAPI
+RtlWakeAllConditionVariable(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable);
+
+NTSTATUS
+NTAPI
+RtlSleepConditionVariableSRW(IN OUT PRTL_CONDITION_VARIABLE ConditionVariable,
+                             IN OUT PRTL_SRWLOCK SRWLock,
+                             IN PLARGE_INTEGER TimeOut OPTIONAL,
+                             IN ULONG Flags);
+
+/* INTERNAL TYPES ***********************************************************/
+
+#define TP_QUEUE_INITIAL_SIZE       64
+#define TP_WORKERS_INITIAL_SIZE     8
+#define TP_DEFAULT_MAX_THREADS      500
+#define TP_WAIT_BUCKET_SIZE         (MAXIMUM_WAIT_OBJECTS - 1)
+
+/* Idle workers and wait threads go away after 20 seconds */
+#define TP_IDLE_TIMEOUT             (20 * 1000 * 10000LL)
+
+/* A pool whose queued work didn't move for this long gets another worker */
+#define TP_STALL_TIMEOUT            (500 * 10000LL)
+
+/* Expired timers queued at a time, outside the timer lock */
+#define TP_TIMER_BATCH_SIZE         64
+
+/* Busy workers look for I/O completions every so many callbacks */
+#define TP_IO_POLL_INTERVAL         32
+
+/* Completion key of the packets that wake up idle workers */
+#define TP_WAKEUP_KEY               NULL
+
+/* The worker currently running on this thread */
+#if (NTDDI_VERSION >= NTDDI_LONGHORN)
+#define TpCurrentWorker (*(PTP_WORKER *)&NtCurrentTeb()->ThreadPoolData)
+#else
+#define TpCurrentWorker (*(PTP_WORKER *)&NtCurrentTeb()->SoftPatchPtr2)
+#endif
+
+typedef enum _TP_OBJECT_TYPE
+{
+    TpObjectWork,
+    TpObjectSimple,
+    TpObjectTimer,
+    TpObjectWait,
+    TpObjectIo
+} TP_OBJECT_TYPE;
+
+/* The Windows 7 callback environment, which adds the callback priority */
+typedef struct _TPP_CALLBACK_ENVIRON_V3
+{
+    TP_VERSION Version;
+    PTP_POOL Pool;
+    PTP_CLEANUP_GROUP CleanupGroup;
+    PTP_CLEANUP_GROUP_CANCEL_CALLBACK CleanupGroupCancelCallback;
+    PVOID RaceDll;
+    struct _ACTIVATION_CONTEXT *ActivationContext;
+    PTP_SIMPLE_CALLBACK FinalizationCallback;
+    DWORD Flags;
+    TP_CALLBACK_PRIORITY CallbackPriority;
+    DWORD Size;
+} TPP_CALLBACK_ENVIRON_V3, *PTPP_CALLBACK_ENVIRON_V3;
+
+typedef struct _TP_QUEUE
+{
+    struct _TP_OBJECT **Entries;
+    ULONG Size;
+    ULONG Head;
+    ULONG Count;
+} TP_QUEUE, *PTP_QUEUE;
+
+typedef struct _TP_WORKER
+{
+    struct _TP_POOL *Pool;
+    RTL_SRWLOCK DequeLock;
+    TP_QUEUE Deque;
+    ULONG StealIndex;
+    ULONG Completed;
+    struct _TP_CALLBACK_INSTANCE *Instance;
+} TP_WORKER, *PTP_WORKER;
+
+typedef struct _TP_POOL
+{
+    LONG RefCount;
+    BOOLEAN Shutdown;
+    BOOLEAN Watched;
+    HANDLE CompletionPort;
+
+    /* Protects the worker array and the thread limits */
+    RTL_SRWLOCK Lock;
+    PTP_WORKER *Workers;
+    ULONG WorkerCount;
+    ULONG WorkerArraySize;
+    ULONG MinThreads;
+    ULONG MaxThreads;
+
+    /* Protects the global queues */
+    RTL_SRWLOCK QueueLock;
+    TP_QUEUE Queues[TP_CALLBACK_PRIORITY_COUNT];
+
+    LONG IdleWorkers;
+    LONG PendingWakeups;
+    LONG LongRunning;
+    LONG IoObjects;
+
+    /* Stall detection, protected by TpTimerLock */
+    LIST_ENTRY WatchEntry;
+    ULONG WatchCompleted;
+    LONGLONG WatchTime;
+} TP_POOL;
+
+typedef struct _TP_CLEANUP_GROUP
+{
+    RTL_SRWLOCK Lock;
+    LIST_ENTRY Members;
+} TP_CLEANUP_GROUP;
+
+typedef struct _TP_WAIT_BUCKET
+{
+    LIST_ENTRY BucketEntry;
+    LIST_ENTRY Waits;
+    ULONG WaitCount;
+    HANDLE UpdateEvent;
+} TP_WAIT_BUCKET, *PTP_WAIT_BUCKET;
+
+typedef struct _TP_OBJECT
+{
+    TP_OBJECT_TYPE Type;
+    LONG RefCount;
+    PTP_POOL Pool;
+    PVOID Callback;
+    PVOID Context;
+
+    /* Frees the context along with the object, kernel32 wraps its I/O callbacks */
+    PTP_CONTEXT_DESTROY_CALLBACK DestroyCallback;
+
+    /* Callback environment */
+    PTP_CLEANUP_GROUP Group;
+    LIST_ENTRY GroupEntry;
+    PTP_CLEANUP_GROUP_CANCEL_CALLBACK GroupCancelCallback;
+    PTP_SIMPLE_CALLBACK FinalizationCallback;
+    PVOID RaceDll;
+    struct _ACTIVATION_CONTEXT *ActivationContext;
+    BOOLEAN LongFunction;
+    TP_CALLBACK_PRIORITY Priority;
+
+    /* Callbacks queued but not started, and callbacks running */
+    LONG Pending;
+    LONG Running;
+
+    /* Threads waiting for the callbacks to finish */
+    LONG Waiters;
+    RTL_SRWLOCK Lock;
+    RTL_CONDITION_VARIABLE Finished;
+
+    union
+    {
+        struct
+        {
+            LIST_ENTRY TimerEntry;
+            LONGLONG DueTime;
+            LONG Period;
+            LONG Window;
+            BOOLEAN Set;
+        } Timer;
+        struct
+        {
+            LIST_ENTRY WaitEntry;
+            PTP_WAIT_BUCKET Bucket;
+            HANDLE Handle;
+            LONGLONG Timeout;
+            ULONG Sequence;
+            TP_WAIT_RESULT Result;
+        } Wait;
+        struct
+        {
+            LONG PendingIo;
+        } Io;
+    } u;
+} TP_OBJECT, *PTP_OBJECT;
+
+typedef struct _TP_CALLBACK_INSTANCE
+{
+    PTP_OBJECT Object;
+    PTP_WORKER Worker;
+    BOOLEAN Associated;
+    BOOLEAN MayRunLong;
+
+    /* Completion actions */
+    PRTL_CRITICAL_SECTION CriticalSection;
+    HANDLE Mutex;
+    HANDLE Semaphore;
+    LONG SemaphoreCount;
+    HANDLE Event;
+    PVOID Dll;
+} TP_CALLBACK_INSTANCE;
+
+/* GLOBALS ******************************************************************/
+
+static PTP_POOL TpDefaultPool;
+
+static RTL_SRWLOCK TpTimerLock;
+static LIST_ENTRY TpTimerList = { &TpTimerList, &TpTimerList };
+static LIST_ENTRY TpWatchList = { &TpWatchList, &TpWatchList };
+static HANDLE TpTimerEvent;
+
+static RTL_SRWLOCK TpWaitLock;
+static LIST_ENTRY TpWaitBuckets = { &TpWaitBuckets, &TpWaitBuckets };
+
+/* QUEUES *******************************************************************/
+
+static
+BOOLEAN
+RtlpTpQueuePush(
+    _Inout_ PTP_QUEUE Queue,
+    _In_ PTP_OBJECT Object)
+{
+    PTP_OBJECT *Entries;
+    ULONG Size, i;
+
+    if (Queue->Count == Queue->Size)
+    {
+        /* Grow the ring, keeping it a power of two */
+        Size = Queue->Size ? Queue->Size * 2 : TP_QUEUE_INITIAL_SIZE;
+        Entries = RtlAllocateHeap(RtlGetProcessHeap(), 0, Size * sizeof(PTP_OBJECT));
+        if (Entries == NULL)
+            return FALSE;
+
+        for (i = 0; i < Queue->Count; i++)
+            Entries[i] = Queue->Entries[(Queue->Head + i) & (Queue->Size - 1)];
+
+        if (Queue->Entries)
+            RtlFreeHeap(RtlGetProcessHeap(), 0, Queue->Entries);
+
+        Queue->Entries = Entries;
+        Queue->Size = Size;
+        Queue->Head = 0;
+    }
+
+    Queue->Entries[(Queue->Head + Queue->Count) & (Queue->Size - 1)] = Object;
+    Queue->Count++;
+    return TRUE;
+}
+
+static
+PTP_OBJECT
+RtlpTpQueuePopHead(
+    _Inout_ PTP_QUEUE Queue)
+{
+    PTP_OBJECT Object;
+
+    if (Queue->Count == 0)
+        return NULL;
+
+    Object = Queue->Entries[Queue->Head];
+    Queue->Head = (Queue->Head + 1) & (Queue->Size - 1);
+    Queue->Count--;
+    return Object;
+}
+
+static
+PTP_OBJECT
+RtlpTpQueuePopTail(
+    _Inout_ PTP_QUEUE Queue)
+{
+    if (Queue->Count == 0)
+        return NULL;
+
+    Queue->Count--;
+    return Queue->Entries[(Queue->Head + Queue->Count) & (Queue->Size - 1)];
+}
+
+static
+VOID
+RtlpTpQueueFree(
+    _Inout_ PTP_QUEUE Queue)
+{
+    if (Queue->Entries)
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Queue->Entries);
+}
+
+/* POOLS ********************************************************************/
+
+static
+NTSTATUS
+RtlpTpCreatePool(
+    _Out_ PTP_POOL *PoolReturn)
+{
+    PTP_POOL Pool;
+    NTSTATUS Status;
+
+    Pool = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(TP_POOL));
+    if (Pool == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = NtCreateIoCompletion(&Pool->CompletionPort,
+                                  IO_COMPLETION_ALL_ACCESS,
+                                  NULL,
+                                  0);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Pool);
+        return Status;
+    }
+
+    Pool->RefCount = 1;
+    Pool->MaxThreads = TP_DEFAULT_MAX_THREADS;
+    *PoolReturn = Pool;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpTpFreePool(
+    _In_ PTP_POOL Pool)
+{
+    ULONG i;
+
+    for (i = 0; i < TP_CALLBACK_PRIORITY_COUNT; i++)
+        RtlpTpQueueFree(&Pool->Queues[i]);
+
+    if (Pool->Workers)
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Pool->Workers);
+
+    NtClose(Pool->CompletionPort);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Pool);
+}
+
+static
+VOID
+RtlpTpDereferencePool(
+    _In_ PTP_POOL Pool)
+{
+    BOOLEAN Free;
+    ULONG i;
+
+    if (InterlockedDecrement(&Pool->RefCount) != 0)
+        return;
+
+    /* Nothing uses the pool anymore. The last worker to leave frees it */
+    RtlAcquireSRWLockExclusive(&Pool->Lock);
+    Pool->Shutdown = TRUE;
+    Free = (Pool->WorkerCount == 0);
+    for (i = 0; i < Pool->WorkerCount; i++)
+    {
+        InterlockedIncrement(&Pool->PendingWakeups);
+        NtSetIoCompletion(Pool->CompletionPort, TP_WAKEUP_KEY, NULL, STATUS_SUCCESS, 0);
+    }
+    RtlReleaseSRWLockExclusive(&Pool->Lock);
+
+    if (Free)
+        RtlpTpFreePool(Pool);
+}
+
+static
+PTP_POOL
+RtlpTpGetDefaultPool(VOID)
+{
+    PTP_POOL Pool;
+
+    if (TpDefaultPool != NULL)
+        return TpDefaultPool;
+
+    if (!NT_SUCCESS(RtlpTpCreatePool(&Pool)))
+        return NULL;
+
+    /* Someone else may have beaten us to it */
+    if (InterlockedCompareExchangePointer((PVOID *)&TpDefaultPool, Pool, NULL) != NULL)
+        RtlpTpFreePool(Pool);
+
+    return TpDefaultPool;
+}
+
+static NTSTATUS NTAPI RtlpTpWorkerThread(PVOID Parameter);
+static VOID RtlpTpWatchPool(PTP_POOL Pool);
+
+/* Called with the pool lock held exclusively */
+static
+NTSTATUS
+RtlpTpCreateWorker(
+    _In_ PTP_POOL Pool)
+{
+    PTP_WORKER Worker, *Workers;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+    ULONG Size;
+
+    if (Pool->Shutdown)
+        return STATUS_UNSUCCESSFUL;
+
+    if (Pool->WorkerCount == Pool->WorkerArraySize)
+    {
+        Size = Pool->WorkerArraySize ? Pool->WorkerArraySize * 2 : TP_WORKERS_INITIAL_SIZE;
+        Workers = RtlAllocateHeap(RtlGetProcessHeap(), 0, Size * sizeof(PTP_WORKER));
+        if (Workers == NULL)
+            return STATUS_NO_MEMORY;
+
+        if (Pool->Workers)
+        {
+            RtlCopyMemory(Workers, Pool->Workers, Pool->WorkerCount * sizeof(PTP_WORKER));
+            RtlFreeHeap(RtlGetProcessHeap(), 0, Pool->Workers);
+        }
+
+        Pool->Workers = Workers;
+        Pool->WorkerArraySize = Size;
+    }
+
+    Worker = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(TP_WORKER));
+    if (Worker == NULL)
+        return STATUS_NO_MEMORY;
+
+    Worker->Pool = Pool;
+
+    /* The thread can't get at the worker array before we release the lock */
+    Status = RtlCreateUserThread(NtCurrentProcess(),
+                                 NULL,
+                                 FALSE,
+                                 0,
+                                 0,
+                                 0,
+                                 (PTHREAD_START_ROUTINE)RtlpTpWorkerThread,
+                                 Worker,
+                                 &ThreadHandle,
+                                 NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to create a thread pool worker: 0x%lx\n", Status);
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Worker);
+        return Status;
+    }
+
+    NtClose(ThreadHandle);
+    Pool->Workers[Pool->WorkerCount++] = Worker;
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpTpWakeWorker(
+    _In_ PTP_POOL Pool)
+{
+    ULONG Processors = NtCurrentPeb()->NumberOfProcessors;
+
+    /* Pairs with the idle count increment in the worker */
+    MemoryBarrier();
+
+    /* Prefer an idle worker that isn't already being woken up */
+    if (Pool->IdleWorkers > Pool->PendingWakeups)
+    {
+        InterlockedIncrement(&Pool->PendingWakeups);
+        NtSetIoCompletion(Pool->CompletionPort, TP_WAKEUP_KEY, NULL, STATUS_SUCCESS, 0);
+        return;
+    }
+
+    /* Keep one runnable worker per processor. Long callbacks don't count */
+    if (Pool->WorkerCount - Pool->LongRunning < Processors &&
+        Pool->WorkerCount < Pool->MaxThreads)
+    {
+        RtlAcquireSRWLockExclusive(&Pool->Lock);
+        if (Pool->WorkerCount - Pool->LongRunning < Processors &&
+            Pool->WorkerCount < Pool->MaxThreads)
+        {
+            RtlpTpCreateWorker(Pool);
+        }
+        RtlReleaseSRWLockExclusive(&Pool->Lock);
+        return;
+    }
+
+    /* Every worker is busy. Add more if they stop making progress */
+    if (!Pool->Watched && Pool->WorkerCount < Pool->MaxThreads)
+        RtlpTpWatchPool(Pool);
+}
+
+/* OBJECTS ******************************************************************/
+
+static
+NTSTATUS
+RtlpTpInitializeObject(
+    _Out_ PTP_OBJECT Object,
+    _In_ TP_OBJECT_TYPE Type,
+    _In_ PVOID Callback,
+    _In_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTPP_CALLBACK_ENVIRON_V3 EnvironV3;
+    PTP_POOL Pool = NULL;
+    NTSTATUS Status;
+
+    RtlZeroMemory(Object, sizeof(TP_OBJECT));
+    Object->Type = Type;
+    Object->RefCount = 1;
+    Object->Callback = Callback;
+    Object->Context = Context;
+    Object->Priority = TP_CALLBACK_PRIORITY_NORMAL;
+
+    if (CallbackEnviron)
+    {
+        if (CallbackEnviron->Version != 1 && CallbackEnviron->Version != 3)
+            return STATUS_INVALID_PARAMETER;
+
+        Pool = CallbackEnviron->Pool;
+        Object->Group = CallbackEnviron->CleanupGroup;
+        Object->GroupCancelCallback = CallbackEnviron->CleanupGroupCancelCallback;
+        Object->FinalizationCallback = CallbackEnviron->FinalizationCallback;
+        Object->RaceDll = CallbackEnviron->RaceDll;
+        Object->LongFunction = CallbackEnviron->u.s.LongFunction;
+
+        if (CallbackEnviron->Version == 3)
+        {
+            EnvironV3 = (PTPP_CALLBACK_ENVIRON_V3)CallbackEnviron;
+            if (EnvironV3->CallbackPriority >= TP_CALLBACK_PRIORITY_COUNT)
+                return STATUS_INVALID_PARAMETER;
+
+            Object->Priority = EnvironV3->CallbackPriority;
+        }
+    }
+
+    if (Pool == NULL)
+    {
+        Pool = RtlpTpGetDefaultPool();
+        if (Pool == NULL)
+            return STATUS_NO_MEMORY;
+    }
+
+    /* Keep the DLL that owns the callback loaded while we can call it */
+    if (Object->RaceDll)
+    {
+        Status = LdrAddRefDll(0, Object->RaceDll);
+        if (!NT_SUCCESS(Status))
+            return Status;
+    }
+
+    /* Callbacks run in the activation context of the environment */
+    if (CallbackEnviron && CallbackEnviron->ActivationContext)
+    {
+        Object->ActivationContext = CallbackEnviron->ActivationContext;
+        RtlAddRefActivationContext(Object->ActivationContext);
+    }
+
+    InterlockedIncrement(&Pool->RefCount);
+    Object->Pool = Pool;
+
+    if (Object->Group)
+    {
+        RtlAcquireSRWLockExclusive(&Object->Group->Lock);
+        InsertTailList(&Object->Group->Members, &Object->GroupEntry);
+        RtlReleaseSRWLockExclusive(&Object->Group->Lock);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpTpDereferenceObject(
+    _In_ PTP_OBJECT Object)
+{
+    PTP_POOL Pool;
+
+    if (InterlockedDecrement(&Object->RefCount) != 0)
+        return;
+
+    Pool = Object->Pool;
+    if (Object->Type == TpObjectIo)
+        InterlockedDecrement(&Pool->IoObjects);
+
+    if (Object->DestroyCallback)
+        Object->DestroyCallback(Object->Context);
+
+    if (Object->ActivationContext)
+        RtlReleaseActivationContext(Object->ActivationContext);
+
+    if (Object->RaceDll)
+        LdrUnloadDll(Object->RaceDll);
+
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+    RtlpTpDereferencePool(Pool);
+}
+
+static
+BOOLEAN
+RtlpTpRemoveFromGroup(
+    _In_ PTP_OBJECT Object)
+{
+    PTP_CLEANUP_GROUP Group = Object->Group;
+    BOOLEAN Removed = FALSE;
+
+    if (Group == NULL)
+        return FALSE;
+
+    RtlAcquireSRWLockExclusive(&Group->Lock);
+    if (Object->Group)
+    {
+        RemoveEntryList(&Object->GroupEntry);
+        Object->Group = NULL;
+        Removed = TRUE;
+    }
+    RtlReleaseSRWLockExclusive(&Group->Lock);
+
+    return Removed;
+}
+
+static
+NTSTATUS
+RtlpTpPostObject(
+    _In_ PTP_OBJECT Object)
+{
+    PTP_POOL Pool = Object->Pool;
+    PTP_WORKER Worker = TpCurrentWorker;
+    BOOLEAN Queued;
+
+    /* The queue entry holds a reference */
+    InterlockedIncrement(&Object->RefCount);
+    InterlockedIncrement(&Object->Pending);
+
+    if (Worker && Worker->Pool == Pool && Object->Priority == TP_CALLBACK_PRIORITY_NORMAL)
+    {
+        /* Posted from one of our own callbacks, keep it local */
+        RtlAcquireSRWLockExclusive(&Worker->DequeLock);
+        Queued = RtlpTpQueuePush(&Worker->Deque, Object);
+        RtlReleaseSRWLockExclusive(&Worker->DequeLock);
+    }
+    else
+    {
+        RtlAcquireSRWLockExclusive(&Pool->QueueLock);
+        Queued = RtlpTpQueuePush(&Pool->Queues[Object->Priority], Object);
+        RtlReleaseSRWLockExclusive(&Pool->QueueLock);
+    }
+
+    if (!Queued)
+    {
+        DPRINT1("Failed to queue thread pool callback\n");
+        InterlockedDecrement(&Object->Pending);
+        RtlpTpDereferenceObject(Object);
+        return STATUS_NO_MEMORY;
+    }
+
+    RtlpTpWakeWorker(Pool);
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpTpCallbackDone(
+    _In_ PTP_OBJECT Object)
+{
+    if (InterlockedDecrement(&Object->Running) == 0 && Object->Waiters)
+    {
+        RtlAcquireSRWLockExclusive(&Object->Lock);
+        RtlWakeAllConditionVariable(&Object->Finished);
+        RtlReleaseSRWLockExclusive(&Object->Lock);
+    }
+}
+
+/* Turns one pending callback into a running one */
+static
+BOOLEAN
+RtlpTpClaimCallback(
+    _In_ PTP_OBJECT Object)
+{
+    LONG Pending;
+
+    /* Count it as running first so waiters never see both at zero */
+    InterlockedIncrement(&Object->Running);
+
+    do
+    {
+        Pending = Object->Pending;
+        if (Pending <= 0)
+        {
+            /* Cancelled, or an earlier queue entry already took it */
+            RtlpTpCallbackDone(Object);
+            return FALSE;
+        }
+    } while (InterlockedCompareExchange(&Object->Pending, Pending - 1, Pending) != Pending);
+
+    return TRUE;
+}
+
+static
+VOID
+RtlpTpWaitForCallbacks(
+    _In_ PTP_OBJECT Object,
+    _In_ BOOLEAN CancelPending)
+{
+    PTP_WORKER Worker = TpCurrentWorker;
+    LONG Self = 0;
+
+    if (CancelPending)
+        InterlockedExchange(&Object->Pending, 0);
+
+    /* Don't wait for ourselves when called from one of the object's callbacks */
+    if (Worker && Worker->Instance &&
+        Worker->Instance->Object == Object && Worker->Instance->Associated)
+    {
+        Self = 1;
+    }
+
+    RtlAcquireSRWLockExclusive(&Object->Lock);
+    InterlockedIncrement(&Object->Waiters);
+    while (Object->Pending > 0 || Object->Running > Self)
+    {
+        RtlSleepConditionVariableSRW(&Object->Finished, &Object->Lock, NULL, 0);
+    }
+    InterlockedDecrement(&Object->Waiters);
+    RtlReleaseSRWLockExclusive(&Object->Lock);
+}
+
+/* CALLBACKS ****************************************************************/
+
+static
+VOID
+RtlpTpExecuteCallback(
+    _In_ PTP_WORKER Worker,
+    _In_ PTP_OBJECT Object,
+    _In_opt_ PVOID ApcContext,
+    _In_opt_ PIO_STATUS_BLOCK IoStatusBlock)
+{
+    RTL_CALLER_ALLOCATED_ACTIVATION_CONTEXT_STACK_FRAME_EXTENDED ActCtx;
+    TP_CALLBACK_INSTANCE Instance;
+    PTP_POOL Pool = Worker->Pool;
+
+    if (Object->ActivationContext)
+    {
+        ActCtx.Size = sizeof(ActCtx);
+        ActCtx.Format = RTL_CALLER_ALLOCATED_ACTIVATION_CONTEXT_STACK_FRAME_FORMAT_WHISTLER;
+        RtlZeroMemory(&ActCtx.Frame, sizeof(RTL_ACTIVATION_CONTEXT_STACK_FRAME));
+        RtlActivateActivationContextUnsafeFast(&ActCtx, Object->ActivationContext);
+    }
+
+    RtlZeroMemory(&Instance, sizeof(Instance));
+    Instance.Object = Object;
+    Instance.Worker = Worker;
+    Instance.Associated = TRUE;
+
+    if (Object->LongFunction)
+    {
+        Instance.MayRunLong = TRUE;
+        InterlockedIncrement(&Pool->LongRunning);
+    }
+
+    Worker->Instance = &Instance;
+
+    switch (Object->Type)
+    {
+        case TpObjectWork:
+            ((PTP_WORK_CALLBACK)Object->Callback)(&Instance,
+                                                  Object->Context,
+                                                  (PTP_WORK)Object);
+            break;
+
+        case TpObjectSimple:
+            ((PTP_SIMPLE_CALLBACK)Object->Callback)(&Instance,
+                                                    Object->Context);
+            break;
+
+        case TpObjectTimer:
+            ((PTP_TIMER_CALLBACK)Object->Callback)(&Instance,
+                                                   Object->Context,
+                                                   (PTP_TIMER)Object);
+            break;
+
+        case TpObjectWait:
+            ((PTP_WAIT_CALLBACK)Object->Callback)(&Instance,
+                                                  Object->Context,
+                                                  (PTP_WAIT)Object,
+                                                  Object->u.Wait.Result);
+            break;
+
+        case TpObjectIo:
+            ((PTP_IO_CALLBACK)Object->Callback)(&Instance,
+                                                Object->Context,
+                                                ApcContext,
+                                                IoStatusBlock,
+                                                (PTP_IO)Object);
+            break;
+    }
+
+    /* Like Windows, run the finalization callback after every callback */
+    if (Object->FinalizationCallback)
+        Object->FinalizationCallback(&Instance, Object->Context);
+
+    if (Object->ActivationContext)
+        RtlDeactivateActivationContextUnsafeFast(&ActCtx);
+
+    /* Perform the completion actions requested by the callback */
+    if (Instance.CriticalSection)
+        RtlLeaveCriticalSection(Instance.CriticalSection);
+    if (Instance.Mutex)
+        NtReleaseMutant(Instance.Mutex, NULL);
+    if (Instance.Semaphore)
+        NtReleaseSemaphore(Instance.Semaphore, Instance.SemaphoreCount, NULL);
+    if (Instance.Event)
+        NtSetEvent(Instance.Event, NULL);
+    if (Instance.Dll)
+        LdrUnloadDll(Instance.Dll);
+
+    Worker->Instance = NULL;
+
+    if (Instance.Associated)
+        RtlpTpCallbackDone(Object);
+
+    if (Instance.MayRunLong)
+        InterlockedDecrement(&Pool->LongRunning);
+
+    Worker->Completed++;
+}
+
+static
+PTP_OBJECT
+RtlpTpPopGlobal(
+    _In_ PTP_POOL Pool,
+    _In_ TP_CALLBACK_PRIORITY Priority)
+{
+    PTP_OBJECT Object;
+
+    if (Pool->Queues[Priority].Count == 0)
+        return NULL;
+
+    RtlAcquireSRWLockExclusive(&Pool->QueueLock);
+    Object = RtlpTpQueuePopHead(&Pool->Queues[Priority]);
+    RtlReleaseSRWLockExclusive(&Pool->QueueLock);
+
+    return Object;
+}
+
+static
+PTP_OBJECT
+RtlpTpSteal(
+    _In_ PTP_WORKER Worker)
+{
+    PTP_POOL Pool = Worker->Pool;
+    PTP_OBJECT Object = NULL;
+    PTP_WORKER Victim;
+    ULONG i, Start;
+
+    RtlAcquireSRWLockShared(&Pool->Lock);
+
+    /* Start somewhere else every time so we don't all pick on the same worker */
+    Start = Worker->StealIndex++;
+    for (i = 0; i < Pool->WorkerCount && Object == NULL; i++)
+    {
+        Victim = Pool->Workers[(Start + i) % Pool->WorkerCount];
+        if (Victim == Worker || Victim->Deque.Count == 0)
+            continue;
+
+        /* Take the oldest entry, the owner works on the newest */
+        RtlAcquireSRWLockExclusive(&Victim->DequeLock);
+        Object = RtlpTpQueuePopHead(&Victim->Deque);
+        RtlReleaseSRWLockExclusive(&Victim->DequeLock);
+    }
+
+    RtlReleaseSRWLockShared(&Pool->Lock);
+    return Object;
+}
+
+static
+PTP_OBJECT
+RtlpTpDequeue(
+    _In_ PTP_WORKER Worker)
+{
+    PTP_POOL Pool = Worker->Pool;
+    PTP_OBJECT Object;
+
+    /* High priority work first */
+    Object = RtlpTpPopGlobal(Pool, TP_CALLBACK_PRIORITY_HIGH);
+    if (Object)
+        return Object;
+
+    /* Then the newest work we produced ourselves, it's still in our cache */
+    if (Worker->Deque.Count)
+    {
+        RtlAcquireSRWLockExclusive(&Worker->DequeLock);
+        Object = RtlpTpQueuePopTail(&Worker->Deque);
+        RtlReleaseSRWLockExclusive(&Worker->DequeLock);
+        if (Object)
+            return Object;
+    }
+
+    Object = RtlpTpPopGlobal(Pool, TP_CALLBACK_PRIORITY_NORMAL);
+    if (Object)
+        return Object;
+
+    Object = RtlpTpSteal(Worker);
+    if (Object)
+        return Object;
+
+    return RtlpTpPopGlobal(Pool, TP_CALLBACK_PRIORITY_LOW);
+}
+
+static
+PTP_OBJECT
+RtlpTpGetWork(
+    _In_ PTP_WORKER Worker)
+{
+    PTP_OBJECT Object;
+
+    while ((Object = RtlpTpDequeue(Worker)) != NULL)
+    {
+        if (RtlpTpClaimCallback(Object))
+            return Object;
+
+        /* Stale entry, drop its reference and keep looking */
+        RtlpTpDereferenceObject(Object);
+    }
+
+    return NULL;
+}
+
+static
+VOID
+RtlpTpExecuteIo(
+    _In_ PTP_WORKER Worker,
+    _In_ PTP_OBJECT Object,
+    _In_opt_ PVOID ApcContext,
+    _In_ PIO_STATUS_BLOCK IoStatusBlock)
+{
+    InterlockedIncrement(&Object->Running);
+    InterlockedDecrement(&Object->u.Io.PendingIo);
+
+    RtlpTpExecuteCallback(Worker, Object, ApcContext, IoStatusBlock);
+
+    /* Release the reference taken by TpStartAsyncIoOperation */
+    RtlpTpDereferenceObject(Object);
+}
+
+static
+NTSTATUS
+NTAPI
+RtlpTpWorkerThread(
+    _In_ PVOID Parameter)
+{
+    PTP_WORKER Worker = Parameter;
+    PTP_POOL Pool = Worker->Pool;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER Timeout;
+    PTP_OBJECT Object;
+    PVOID Key, ApcContext;
+    NTSTATUS Status;
+    BOOLEAN Retire = FALSE;
+    BOOLEAN Woken = FALSE;
+    BOOLEAN Free;
+    ULONG i;
+
+    TpCurrentWorker = Worker;
+
+    for (;;)
+    {
+        Object = RtlpTpGetWork(Worker);
+        if (Object)
+        {
+            RtlpTpExecuteCallback(Worker, Object, NULL, NULL);
+            RtlpTpDereferenceObject(Object);
+
+            /* Don't let queued work starve I/O completions */
+            if (Pool->IoObjects && (Worker->Completed % TP_IO_POLL_INTERVAL) == 0)
+            {
+                Timeout.QuadPart = 0;
+                Status = NtRemoveIoCompletion(Pool->CompletionPort,
+                                              &Key,
+                                              &ApcContext,
+                                              &IoStatusBlock,
+                                              &Timeout);
+                if (Status == STATUS_SUCCESS)
+                {
+                    if (Key == TP_WAKEUP_KEY)
+                        InterlockedDecrement(&Pool->PendingWakeups);
+                    else
+                        RtlpTpExecuteIo(Worker, Key, ApcContext, &IoStatusBlock);
+                }
+            }
+            continue;
+        }
+
+        if (Pool->Shutdown)
+        {
+            /* RtlpTpDereferencePool sent a wakeup for each worker. Take ours
+               unless the wait already did, so the others still find theirs */
+            if (Woken)
+                break;
+
+            Timeout.QuadPart = 0;
+            Status = NtRemoveIoCompletion(Pool->CompletionPort,
+                                          &Key,
+                                          &ApcContext,
+                                          &IoStatusBlock,
+                                          &Timeout);
+            if (Status == STATUS_SUCCESS)
+            {
+                if (Key == TP_WAKEUP_KEY)
+                    InterlockedDecrement(&Pool->PendingWakeups);
+                else
+                    RtlpTpExecuteIo(Worker, Key, ApcContext, &IoStatusBlock);
+            }
+            break;
+        }
+
+        /* Announce that we are going idle, then check again for work
+           that was queued before the poster could see us */
+        InterlockedIncrement(&Pool->IdleWorkers);
+        Object = RtlpTpGetWork(Worker);
+        if (Object)
+        {
+            InterlockedDecrement(&Pool->IdleWorkers);
+            RtlpTpExecuteCallback(Worker, Object, NULL, NULL);
+            RtlpTpDereferenceObject(Object);
+            continue;
+        }
+
+        Timeout.QuadPart = -TP_IDLE_TIMEOUT;
+        Status = NtRemoveIoCompletion(Pool->CompletionPort,
+                                      &Key,
+                                      &ApcContext,
+                                      &IoStatusBlock,
+                                      &Timeout);
+        InterlockedDecrement(&Pool->IdleWorkers);
+        Woken = FALSE;
+
+        if (Status == STATUS_SUCCESS)
+        {
+            if (Key == TP_WAKEUP_KEY)
+            {
+                InterlockedDecrement(&Pool->PendingWakeups);
+                Woken = TRUE;
+            }
+            else
+                RtlpTpExecuteIo(Worker, Key, ApcContext, &IoStatusBlock);
+            continue;
+        }
+
+        if (Status == STATUS_TIMEOUT)
+        {
+            /* Retire if the pool has more workers than it needs. Always keep
+               one, a wakeup may have been sent to us right before we left */
+            RtlAcquireSRWLockExclusive(&Pool->Lock);
+            if (Pool->WorkerCount > max(Pool->MinThreads, 1))
+            {
+                /* A poster may have counted us as idle after the wait timed
+                   out. Don't leave its wakeup behind, handle it and stay */
+                Timeout.QuadPart = 0;
+                Status = NtRemoveIoCompletion(Pool->CompletionPort,
+                                              &Key,
+                                              &ApcContext,
+                                              &IoStatusBlock,
+                                              &Timeout);
+                if (Status == STATUS_SUCCESS)
+                {
+                    RtlReleaseSRWLockExclusive(&Pool->Lock);
+                    if (Key == TP_WAKEUP_KEY)
+                    {
+                        InterlockedDecrement(&Pool->PendingWakeups);
+                        Woken = TRUE;
+                    }
+                    else
+                        RtlpTpExecuteIo(Worker, Key, ApcContext, &IoStatusBlock);
+                    continue;
+                }
+
+                Retire = TRUE;
+                break;
+            }
+            RtlReleaseSRWLockExclusive(&Pool->Lock);
+        }
+    }
+
+    if (!Retire)
+        RtlAcquireSRWLockExclusive(&Pool->Lock);
+
+    /* Leave the pool. Our deque is empty, only we ever fill it */
+    for (i = 0; i < Pool->WorkerCount; i++)
+    {
+        if (Pool->Workers[i] == Worker)
+        {
+            Pool->Workers[i] = Pool->Workers[--Pool->WorkerCount];
+            break;
+        }
+    }
+    Free = (Pool->Shutdown && Pool->WorkerCount == 0);
+    RtlReleaseSRWLockExclusive(&Pool->Lock);
+
+    if (Free)
+        RtlpTpFreePool(Pool);
+
+    TpCurrentWorker = NULL;
+    RtlpTpQueueFree(&Worker->Deque);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Worker);
+
+    RtlExitUserThread(STATUS_SUCCESS);
+    return STATUS_SUCCESS;
+}
+
+/* TIMERS *******************************************************************/
+
+static
+BOOLEAN
+RtlpTpHasQueuedWork(
+    _In_ PTP_POOL Pool)
+{
+    BOOLEAN Queued = FALSE;
+    ULONG i;
+
+    for (i = 0; i < TP_CALLBACK_PRIORITY_COUNT; i++)
+    {
+        if (Pool->Queues[i].Count)
+            return TRUE;
+    }
+
+    RtlAcquireSRWLockShared(&Pool->Lock);
+    for (i = 0; i < Pool->WorkerCount && !Queued; i++)
+        Queued = (Pool->Workers[i]->Deque.Count != 0);
+    RtlReleaseSRWLockShared(&Pool->Lock);
+
+    return Queued;
+}
+
+static
+ULONG
+RtlpTpGetCompleted(
+    _In_ PTP_POOL Pool)
+{
+    ULONG Completed = 0;
+    ULONG i;
+
+    RtlAcquireSRWLockShared(&Pool->Lock);
+    for (i = 0; i < Pool->WorkerCount; i++)
+        Completed += Pool->Workers[i]->Completed;
+    RtlReleaseSRWLockShared(&Pool->Lock);
+
+    return Completed;
+}
+
+static
+VOID
+RtlpTpInsertTimer(
+    _In_ PTP_OBJECT Timer)
+{
+    PLIST_ENTRY Entry;
+    PTP_OBJECT Other;
+
+    /* Keep the list sorted by due time */
+    for (Entry = TpTimerList.Flink; Entry != &TpTimerList; Entry = Entry->Flink)
+    {
+        Other = CONTAINING_RECORD(Entry, TP_OBJECT, u.Timer.TimerEntry);
+        if (Other->u.Timer.DueTime > Timer->u.Timer.DueTime)
+            break;
+    }
+
+    InsertTailList(Entry, &Timer->u.Timer.TimerEntry);
+}
+
+static
+NTSTATUS
+NTAPI
+RtlpTpTimerThread(
+    _In_ PVOID Parameter)
+{
+    PTP_OBJECT Expired[TP_TIMER_BATCH_SIZE];
+    LARGE_INTEGER Now, Timeout;
+    LONGLONG NextTime;
+    PLIST_ENTRY Entry, NextEntry;
+    PTP_OBJECT Timer;
+    PTP_POOL Pool;
+    ULONG Completed, Count, i;
+
+    UNREFERENCED_PARAMETER(Parameter);
+
+    for (;;)
+    {
+        NtQuerySystemTime(&Now);
+        NextTime = MAXLONGLONG;
+        Count = 0;
+
+        RtlAcquireSRWLockExclusive(&TpTimerLock);
+
+        /* Collect the timers that expired */
+        while (!IsListEmpty(&TpTimerList))
+        {
+            Timer = CONTAINING_RECORD(TpTimerList.Flink, TP_OBJECT, u.Timer.TimerEntry);
+            if (Timer->u.Timer.DueTime > Now.QuadPart)
+            {
+                NextTime = Timer->u.Timer.DueTime;
+                break;
+            }
+
+            if (Count == TP_TIMER_BATCH_SIZE)
+            {
+                NextTime = Now.QuadPart;
+                break;
+            }
+
+            RemoveEntryList(&Timer->u.Timer.TimerEntry);
+            if (Timer->u.Timer.Period)
+            {
+                Timer->u.Timer.DueTime += Timer->u.Timer.Period * 10000LL;
+                if (Timer->u.Timer.DueTime <= Now.QuadPart)
+                    Timer->u.Timer.DueTime = Now.QuadPart + Timer->u.Timer.Period * 10000LL;
+                RtlpTpInsertTimer(Timer);
+            }
+            else
+            {
+                Timer->u.Timer.Set = FALSE;
+            }
+
+            /* Keep it alive until the callback is queued */
+            InterlockedIncrement(&Timer->RefCount);
+            Expired[Count++] = Timer;
+        }
+
+        /* Add workers to the pools that stopped making progress */
+        for (Entry = TpWatchList.Flink; Entry != &TpWatchList; Entry = NextEntry)
+        {
+            NextEntry = Entry->Flink;
+            Pool = CONTAINING_RECORD(Entry, TP_POOL, WatchEntry);
+
+            if (Pool->WatchTime > Now.QuadPart)
+            {
+                NextTime = min(NextTime, Pool->WatchTime);
+                continue;
+            }
+
+            if (!RtlpTpHasQueuedWork(Pool))
+            {
+                RemoveEntryList(&Pool->WatchEntry);
+                Pool->Watched = FALSE;
+                RtlpTpDereferencePool(Pool);
+                continue;
+            }
+
+            Completed = RtlpTpGetCompleted(Pool);
+            if (Completed == Pool->WatchCompleted)
+            {
+                DPRINT("Pool %p is stalled, adding a worker\n", Pool);
+                RtlAcquireSRWLockExclusive(&Pool->Lock);
+                if (Pool->WorkerCount < Pool->MaxThreads)
+                    RtlpTpCreateWorker(Pool);
+                RtlReleaseSRWLockExclusive(&Pool->Lock);
+            }
+
+            Pool->WatchCompleted = Completed;
+            Pool->WatchTime = Now.QuadPart + TP_STALL_TIMEOUT;
+            NextTime = min(NextTime, Pool->WatchTime);
+        }
+
+        RtlReleaseSRWLockExclusive(&TpTimerLock);
+
+        /* Queueing may want to watch the pool, which takes the timer lock */
+        for (i = 0; i < Count; i++)
+        {
+            RtlpTpPostObject(Expired[i]);
+            RtlpTpDereferenceObject(Expired[i]);
+        }
+
+        if (NextTime <= Now.QuadPart)
+            continue;
+
+        Timeout.QuadPart = NextTime;
+        NtWaitForSingleObject(TpTimerEvent,
+                              FALSE,
+                              (NextTime != MAXLONGLONG) ? &Timeout : NULL);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* Called with the timer lock held exclusively */
+static
+NTSTATUS
+RtlpTpStartTimerThread(VOID)
+{
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+
+    if (TpTimerEvent != NULL)
+        return STATUS_SUCCESS;
+
+    Status = NtCreateEvent(&TpTimerEvent,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           SynchronizationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        TpTimerEvent = NULL;
+        return Status;
+    }
+
+    Status = RtlCreateUserThread(NtCurrentProcess(),
+                                 NULL,
+                                 FALSE,
+                                 0,
+                                 0,
+                                 0,
+                                 (PTHREAD_START_ROUTINE)RtlpTpTimerThread,
+                                 NULL,
+                                 &ThreadHandle,
+                                 NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to create the thread pool timer thread: 0x%lx\n", Status);
+        NtClose(TpTimerEvent);
+        TpTimerEvent = NULL;
+        return Status;
+    }
+
+    NtClose(ThreadHandle);
+    return STATUS_SUCCESS;
+}
+
+static
+VOID
+RtlpTpWatchPool(
+    _In_ PTP_POOL Pool)
+{
+    LARGE_INTEGER Now;
+
+    RtlAcquireSRWLockExclusive(&TpTimerLock);
+    if (!Pool->Watched && NT_SUCCESS(RtlpTpStartTimerThread()))
+    {
+        NtQuerySystemTime(&Now);
+        InterlockedIncrement(&Pool->RefCount);
+        Pool->Watched = TRUE;
+        Pool->WatchCompleted = RtlpTpGetCompleted(Pool);
+        Pool->WatchTime = Now.QuadPart + TP_STALL_TIMEOUT;
+        InsertTailList(&TpWatchList, &Pool->WatchEntry);
+        NtSetEvent(TpTimerEvent, NULL);
+    }
+    RtlReleaseSRWLockExclusive(&TpTimerLock);
+}
+
+/* WAITS ********************************************************************/
+
+/* Called with the wait lock held exclusively */
+static
+VOID
+RtlpTpRemoveWait(
+    _In_ PTP_OBJECT Wait)
+{
+    PTP_WAIT_BUCKET Bucket = Wait->u.Wait.Bucket;
+
+    RemoveEntryList(&Wait->u.Wait.WaitEntry);
+    Bucket->WaitCount--;
+    Wait->u.Wait.Bucket = NULL;
+}
+
+/* Called with the wait lock held exclusively */
+static
+VOID
+RtlpTpSignalWait(
+    _In_ PTP_WAIT_BUCKET Bucket,
+    _In_ PTP_OBJECT Wait,
+    _In_ ULONG Sequence,
+    _In_ TP_WAIT_RESULT Result)
+{
+    PLIST_ENTRY Entry;
+
+    /* The wait may have been changed or freed while we weren't looking */
+    for (Entry = Bucket->Waits.Flink; Entry != &Bucket->Waits; Entry = Entry->Flink)
+    {
+        if (Entry == &Wait->u.Wait.WaitEntry)
+            break;
+    }
+
+    if (Entry == &Bucket->Waits || Wait->u.Wait.Sequence != Sequence)
+        return;
+
+    RtlpTpRemoveWait(Wait);
+    Wait->u.Wait.Result = Result;
+    RtlpTpPostObject(Wait);
+}
+
+static
+NTSTATUS
+NTAPI
+RtlpTpWaitThread(
+    _In_ PVOID Parameter)
+{
+    PTP_WAIT_BUCKET Bucket = Parameter;
+    HANDLE Handles[MAXIMUM_WAIT_OBJECTS];
+    PTP_OBJECT Objects[MAXIMUM_WAIT_OBJECTS];
+    ULONG Sequences[MAXIMUM_WAIT_OBJECTS];
+    LARGE_INTEGER Now, Timeout;
+    PLIST_ENTRY Entry, NextEntry;
+    PTP_OBJECT Wait;
+    BOOLEAN Failed = FALSE;
+    NTSTATUS Status = STATUS_SUCCESS;
+    ULONG Count, i;
+
+    RtlAcquireSRWLockExclusive(&TpWaitLock);
+
+    for (;;)
+    {
+        /* Go away when nobody needed us for a while */
+        if (Bucket->WaitCount == 0 && Status == STATUS_TIMEOUT)
+            break;
+
+        Handles[0] = Bucket->UpdateEvent;
+        Count = 1;
+        Timeout.QuadPart = MAXLONGLONG;
+
+        for (Entry = Bucket->Waits.Flink; Entry != &Bucket->Waits; Entry = Entry->Flink)
+        {
+            Wait = CONTAINING_RECORD(Entry, TP_OBJECT, u.Wait.WaitEntry);
+            Handles[Count] = Wait->u.Wait.Handle;
+            Objects[Count] = Wait;
+            Sequences[Count] = Wait->u.Wait.Sequence;
+            Count++;
+
+            Timeout.QuadPart = min(Timeout.QuadPart, Wait->u.Wait.Timeout);
+        }
+
+        if (Count == 1)
+            Timeout.QuadPart = -TP_IDLE_TIMEOUT;
+
+        RtlReleaseSRWLockExclusive(&TpWaitLock);
+
+        /* After a bad handle only look after updates and timeouts */
+        Status = NtWaitForMultipleObjects(Failed ? 1 : Count,
+                                          Handles,
+                                          WaitAny,
+                                          FALSE,
+                                          (Timeout.QuadPart != MAXLONGLONG) ? &Timeout : NULL);
+        NtQuerySystemTime(&Now);
+
+        RtlAcquireSRWLockExclusive(&TpWaitLock);
+
+        if (Status == STATUS_WAIT_0)
+        {
+            Failed = FALSE;
+        }
+        else if (Status > STATUS_WAIT_0 && Status < STATUS_WAIT_0 + Count)
+        {
+            i = Status - STATUS_WAIT_0;
+            RtlpTpSignalWait(Bucket, Objects[i], Sequences[i], WAIT_OBJECT_0);
+        }
+        else if (Status > STATUS_ABANDONED_WAIT_0 && Status < STATUS_ABANDONED_WAIT_0 + Count)
+        {
+            i = Status - STATUS_ABANDONED_WAIT_0;
+            RtlpTpSignalWait(Bucket, Objects[i], Sequences[i], WAIT_ABANDONED_0);
+        }
+        else if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Thread pool wait failed: 0x%lx\n", Status);
+            Failed = TRUE;
+        }
+
+        /* Complete the waits that timed out */
+        for (Entry = Bucket->Waits.Flink; Entry != &Bucket->Waits; Entry = NextEntry)
+        {
+            NextEntry = Entry->Flink;
+            Wait = CONTAINING_RECORD(Entry, TP_OBJECT, u.Wait.WaitEntry);
+            if (Wait->u.Wait.Timeout <= Now.QuadPart)
+            {
+                RtlpTpRemoveWait(Wait);
+                Wait->u.Wait.Result = WAIT_TIMEOUT;
+                RtlpTpPostObject(Wait);
+            }
+        }
+    }
+
+    RemoveEntryList(&Bucket->BucketEntry);
+    RtlReleaseSRWLockExclusive(&TpWaitLock);
+
+    NtClose(Bucket->UpdateEvent);
+    RtlFreeHeap(RtlGetProcessHeap(), 0, Bucket);
+
+    RtlExitUserThread(STATUS_SUCCESS);
+    return STATUS_SUCCESS;
+}
+
+/* Called with the wait lock held exclusively */
+static
+PTP_WAIT_BUCKET
+RtlpTpGetWaitBucket(VOID)
+{
+    PTP_WAIT_BUCKET Bucket;
+    PLIST_ENTRY Entry;
+    HANDLE ThreadHandle;
+    NTSTATUS Status;
+
+    for (Entry = TpWaitBuckets.Flink; Entry != &TpWaitBuckets; Entry = Entry->Flink)
+    {
+        Bucket = CONTAINING_RECORD(Entry, TP_WAIT_BUCKET, BucketEntry);
+        if (Bucket->WaitCount < TP_WAIT_BUCKET_SIZE)
+            return Bucket;
+    }
+
+    /* All full, start another wait thread */
+    Bucket = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(TP_WAIT_BUCKET));
+    if (Bucket == NULL)
+        return NULL;
+
+    InitializeListHead(&Bucket->Waits);
+    Status = NtCreateEvent(&Bucket->UpdateEvent,
+                           EVENT_ALL_ACCESS,
+                           NULL,
+                           SynchronizationEvent,
+                           FALSE);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Bucket);
+        return NULL;
+    }
+
+    Status = RtlCreateUserThread(NtCurrentProcess(),
+                                 NULL,
+                                 FALSE,
+                                 0,
+                                 0,
+                                 0,
+                                 (PTHREAD_START_ROUTINE)RtlpTpWaitThread,
+                                 Bucket,
+                                 &ThreadHandle,
+                                 NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Failed to create a thread pool wait thread: 0x%lx\n", Status);
+        NtClose(Bucket->UpdateEvent);
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Bucket);
+        return NULL;
+    }
+
+    NtClose(ThreadHandle);
+    InsertTailList(&TpWaitBuckets, &Bucket->BucketEntry);
+    return Bucket;
+}
+
+/* FUNCTIONS ****************************************************************/
+
+static
+VOID
+RtlpTpReleaseObject(
+    _In_ PTP_OBJECT Object)
+{
+    RtlpTpRemoveFromGroup(Object);
+    RtlpTpDereferenceObject(Object);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocPool(
+    _Out_ PTP_POOL *PoolReturn,
+    _Reserved_ PVOID Reserved)
+{
+    UNREFERENCED_PARAMETER(Reserved);
+
+    return RtlpTpCreatePool(PoolReturn);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleasePool(
+    _Inout_ PTP_POOL Pool)
+{
+    /* The pool goes away once its objects are gone */
+    RtlpTpDereferencePool(Pool);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpSetPoolMaxThreads(
+    _Inout_ PTP_POOL Pool,
+    _In_ LONG MaxThreads)
+{
+    RtlAcquireSRWLockExclusive(&Pool->Lock);
+    Pool->MaxThreads = max(MaxThreads, 1);
+    Pool->MinThreads = min(Pool->MinThreads, Pool->MaxThreads);
+    RtlReleaseSRWLockExclusive(&Pool->Lock);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpSetPoolMinThreads(
+    _Inout_ PTP_POOL Pool,
+    _In_ LONG MinThreads)
+{
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    RtlAcquireSRWLockExclusive(&Pool->Lock);
+    Pool->MinThreads = max(MinThreads, 0);
+    Pool->MaxThreads = max(Pool->MaxThreads, Pool->MinThreads);
+    while (Pool->WorkerCount < Pool->MinThreads && NT_SUCCESS(Status))
+    {
+        Status = RtlpTpCreateWorker(Pool);
+    }
+    RtlReleaseSRWLockExclusive(&Pool->Lock);
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocCleanupGroup(
+    _Out_ PTP_CLEANUP_GROUP *CleanupGroupReturn)
+{
+    PTP_CLEANUP_GROUP Group;
+
+    Group = RtlAllocateHeap(RtlGetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(TP_CLEANUP_GROUP));
+    if (Group == NULL)
+        return STATUS_NO_MEMORY;
+
+    InitializeListHead(&Group->Members);
+    *CleanupGroupReturn = Group;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseCleanupGroup(
+    _Inout_ PTP_CLEANUP_GROUP CleanupGroup)
+{
+    RtlFreeHeap(RtlGetProcessHeap(), 0, CleanupGroup);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseCleanupGroupMembers(
+    _Inout_ PTP_CLEANUP_GROUP CleanupGroup,
+    _In_ BOOL CancelPendingCallbacks,
+    _Inout_opt_ PVOID CleanupParameter)
+{
+    LIST_ENTRY Members;
+    PLIST_ENTRY Entry;
+    PTP_OBJECT Object;
+    LONG Cancelled;
+
+    /* Take the members over, new objects may join the group meanwhile */
+    InitializeListHead(&Members);
+    RtlAcquireSRWLockExclusive(&CleanupGroup->Lock);
+    while (!IsListEmpty(&CleanupGroup->Members))
+    {
+        Entry = RemoveHeadList(&CleanupGroup->Members);
+        Object = CONTAINING_RECORD(Entry, TP_OBJECT, GroupEntry);
+        Object->Group = NULL;
+        InsertTailList(&Members, Entry);
+    }
+    RtlReleaseSRWLockExclusive(&CleanupGroup->Lock);
+
+    /* Stop the timers and waits from queueing more callbacks */
+    for (Entry = Members.Flink; Entry != &Members; Entry = Entry->Flink)
+    {
+        Object = CONTAINING_RECORD(Entry, TP_OBJECT, GroupEntry);
+        if (Object->Type == TpObjectTimer)
+            TpSetTimer((PTP_TIMER)Object, NULL, 0, 0);
+        else if (Object->Type == TpObjectWait)
+            TpSetWait((PTP_WAIT)Object, NULL, NULL);
+    }
+
+    while (!IsListEmpty(&Members))
+    {
+        Entry = RemoveHeadList(&Members);
+        Object = CONTAINING_RECORD(Entry, TP_OBJECT, GroupEntry);
+
+        if (CancelPendingCallbacks)
+        {
+            Cancelled = InterlockedExchange(&Object->Pending, 0);
+            if (Cancelled && Object->GroupCancelCallback)
+                Object->GroupCancelCallback(Object->Context, CleanupParameter);
+        }
+
+        RtlpTpWaitForCallbacks(Object, FALSE);
+        RtlpTpDereferenceObject(Object);
+    }
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpSimpleTryPost(
+    _In_ PTP_SIMPLE_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_CLEANUP_GROUP Group;
+    PTP_OBJECT Object;
+    NTSTATUS Status;
+
+    Object = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(TP_OBJECT));
+    if (Object == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = RtlpTpInitializeObject(Object, TpObjectSimple, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+        return Status;
+    }
+
+    /* Once posted, the group may release the object at any time */
+    Group = Object->Group;
+    Status = RtlpTpPostObject(Object);
+
+    /* The queue entry keeps the object alive, unless a group owns it */
+    if (!NT_SUCCESS(Status))
+        RtlpTpReleaseObject(Object);
+    else if (Group == NULL)
+        RtlpTpDereferenceObject(Object);
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocWork(
+    _Out_ PTP_WORK *WorkReturn,
+    _In_ PTP_WORK_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_OBJECT Object;
+    NTSTATUS Status;
+
+    Object = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(TP_OBJECT));
+    if (Object == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = RtlpTpInitializeObject(Object, TpObjectWork, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+        return Status;
+    }
+
+    *WorkReturn = (PTP_WORK)Object;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpPostWork(
+    _Inout_ PTP_WORK Work)
+{
+    RtlpTpPostObject((PTP_OBJECT)Work);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpWaitForWork(
+    _Inout_ PTP_WORK Work,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    RtlpTpWaitForCallbacks((PTP_OBJECT)Work, CancelPendingCallbacks != FALSE);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseWork(
+    _Inout_ PTP_WORK Work)
+{
+    RtlpTpReleaseObject((PTP_OBJECT)Work);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocTimer(
+    _Out_ PTP_TIMER *Timer,
+    _In_ PTP_TIMER_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_OBJECT Object;
+    NTSTATUS Status;
+
+    Object = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(TP_OBJECT));
+    if (Object == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = RtlpTpInitializeObject(Object, TpObjectTimer, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+        return Status;
+    }
+
+    *Timer = (PTP_TIMER)Object;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpSetTimer(
+    _Inout_ PTP_TIMER Timer,
+    _In_opt_ PLARGE_INTEGER DueTime,
+    _In_ LONG Period,
+    _In_opt_ LONG WindowLength)
+{
+    PTP_OBJECT Object = (PTP_OBJECT)Timer;
+    LARGE_INTEGER Now;
+
+    RtlAcquireSRWLockExclusive(&TpTimerLock);
+
+    if (Object->u.Timer.Set)
+    {
+        RemoveEntryList(&Object->u.Timer.TimerEntry);
+        Object->u.Timer.Set = FALSE;
+    }
+
+    /* Without a due time the timer is only cancelled */
+    if (DueTime && NT_SUCCESS(RtlpTpStartTimerThread()))
+    {
+        NtQuerySystemTime(&Now);
+        if (DueTime->QuadPart < 0)
+            Object->u.Timer.DueTime = Now.QuadPart - DueTime->QuadPart;
+        else if (DueTime->QuadPart == 0)
+            Object->u.Timer.DueTime = Now.QuadPart;
+        else
+            Object->u.Timer.DueTime = DueTime->QuadPart;
+
+        /* The window only allows coalescing, we always fire on time */
+        Object->u.Timer.Period = Period;
+        Object->u.Timer.Window = WindowLength;
+        Object->u.Timer.Set = TRUE;
+        RtlpTpInsertTimer(Object);
+
+        if (TpTimerList.Flink == &Object->u.Timer.TimerEntry)
+            NtSetEvent(TpTimerEvent, NULL);
+    }
+
+    RtlReleaseSRWLockExclusive(&TpTimerLock);
+}
+
+/*
+ * @implemented
+ */
+BOOL
+NTAPI
+TpIsTimerSet(
+    _In_ PTP_TIMER Timer)
+{
+    return ((PTP_OBJECT)Timer)->u.Timer.Set;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpWaitForTimer(
+    _Inout_ PTP_TIMER Timer,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    RtlpTpWaitForCallbacks((PTP_OBJECT)Timer, CancelPendingCallbacks != FALSE);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseTimer(
+    _Inout_ PTP_TIMER Timer)
+{
+    TpSetTimer(Timer, NULL, 0, 0);
+    RtlpTpReleaseObject((PTP_OBJECT)Timer);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocWait(
+    _Out_ PTP_WAIT *WaitReturn,
+    _In_ PTP_WAIT_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    PTP_OBJECT Object;
+    NTSTATUS Status;
+
+    Object = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(TP_OBJECT));
+    if (Object == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = RtlpTpInitializeObject(Object, TpObjectWait, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+        return Status;
+    }
+
+    *WaitReturn = (PTP_WAIT)Object;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpSetWait(
+    _Inout_ PTP_WAIT Wait,
+    _In_opt_ HANDLE Handle,
+    _In_opt_ PLARGE_INTEGER Timeout)
+{
+    PTP_OBJECT Object = (PTP_OBJECT)Wait;
+    PTP_WAIT_BUCKET Bucket;
+    LARGE_INTEGER Now;
+
+    RtlAcquireSRWLockExclusive(&TpWaitLock);
+
+    if (Object->u.Wait.Bucket)
+    {
+        Bucket = Object->u.Wait.Bucket;
+        RtlpTpRemoveWait(Object);
+        NtSetEvent(Bucket->UpdateEvent, NULL);
+    }
+
+    /* Without a handle the wait is only cancelled */
+    if (Handle)
+    {
+        Bucket = RtlpTpGetWaitBucket();
+        if (Bucket == NULL)
+        {
+            DPRINT1("Failed to set up thread pool wait\n");
+            RtlReleaseSRWLockExclusive(&TpWaitLock);
+            return;
+        }
+
+        if (Timeout == NULL)
+        {
+            Object->u.Wait.Timeout = MAXLONGLONG;
+        }
+        else if (Timeout->QuadPart <= 0)
+        {
+            NtQuerySystemTime(&Now);
+            Object->u.Wait.Timeout = Now.QuadPart - Timeout->QuadPart;
+        }
+        else
+        {
+            Object->u.Wait.Timeout = Timeout->QuadPart;
+        }
+
+        Object->u.Wait.Handle = Handle;
+        Object->u.Wait.Sequence++;
+        Object->u.Wait.Bucket = Bucket;
+        InsertTailList(&Bucket->Waits, &Object->u.Wait.WaitEntry);
+        Bucket->WaitCount++;
+        NtSetEvent(Bucket->UpdateEvent, NULL);
+    }
+
+    RtlReleaseSRWLockExclusive(&TpWaitLock);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpWaitForWait(
+    _Inout_ PTP_WAIT Wait,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    RtlpTpWaitForCallbacks((PTP_OBJECT)Wait, CancelPendingCallbacks != FALSE);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseWait(
+    _Inout_ PTP_WAIT Wait)
+{
+    TpSetWait(Wait, NULL, NULL);
+    RtlpTpReleaseObject((PTP_OBJECT)Wait);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+RtlpTpAllocIoCompletion(
+    _Out_ PTP_IO *IoReturn,
+    _In_ HANDLE File,
+    _In_ PTP_IO_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron,
+    _In_opt_ PTP_CONTEXT_DESTROY_CALLBACK DestroyCallback)
+{
+    FILE_COMPLETION_INFORMATION CompletionInfo;
+    IO_STATUS_BLOCK IoStatusBlock;
+    PTP_OBJECT Object;
+    NTSTATUS Status;
+
+    Object = RtlAllocateHeap(RtlGetProcessHeap(), 0, sizeof(TP_OBJECT));
+    if (Object == NULL)
+        return STATUS_NO_MEMORY;
+
+    Status = RtlpTpInitializeObject(Object, TpObjectIo, Callback, Context, CallbackEnviron);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlFreeHeap(RtlGetProcessHeap(), 0, Object);
+        return Status;
+    }
+
+    InterlockedIncrement(&Object->Pool->IoObjects);
+
+    /* Completions of the file's I/O now go to the pool's port */
+    CompletionInfo.Port = Object->Pool->CompletionPort;
+    CompletionInfo.Key = Object;
+    Status = NtSetInformationFile(File,
+                                  &IoStatusBlock,
+                                  &CompletionInfo,
+                                  sizeof(CompletionInfo),
+                                  FileCompletionInformation);
+    if (!NT_SUCCESS(Status))
+    {
+        RtlpTpReleaseObject(Object);
+        return Status;
+    }
+
+    /* The caller keeps the context when we fail, so only take it over now */
+    Object->DestroyCallback = DestroyCallback;
+
+    *IoReturn = (PTP_IO)Object;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpAllocIoCompletion(
+    _Out_ PTP_IO *IoReturn,
+    _In_ HANDLE File,
+    _In_ PTP_IO_CALLBACK Callback,
+    _Inout_opt_ PVOID Context,
+    _In_opt_ PTP_CALLBACK_ENVIRON CallbackEnviron)
+{
+    return RtlpTpAllocIoCompletion(IoReturn,
+                                   File,
+                                   Callback,
+                                   Context,
+                                   CallbackEnviron,
+                                   NULL);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpStartAsyncIoOperation(
+    _Inout_ PTP_IO Io)
+{
+    PTP_OBJECT Object = (PTP_OBJECT)Io;
+
+    /* The completion holds a reference until its callback ran */
+    InterlockedIncrement(&Object->RefCount);
+    InterlockedIncrement(&Object->u.Io.PendingIo);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCancelAsyncIoOperation(
+    _Inout_ PTP_IO Io)
+{
+    PTP_OBJECT Object = (PTP_OBJECT)Io;
+
+    /* The operation failed or completed synchronously, no completion is coming */
+    InterlockedDecrement(&Object->u.Io.PendingIo);
+    RtlpTpDereferenceObject(Object);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpWaitForIoCompletion(
+    _Inout_ PTP_IO Io,
+    _In_ BOOL CancelPendingCallbacks)
+{
+    /* Completions still sitting in the port can't be cancelled */
+    RtlpTpWaitForCallbacks((PTP_OBJECT)Io, CancelPendingCallbacks != FALSE);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpReleaseIoCompletion(
+    _Inout_ PTP_IO Io)
+{
+    RtlpTpReleaseObject((PTP_OBJECT)Io);
+}
+
+/*
+ * @implemented
+ */
+NTSTATUS
+NTAPI
+TpCallbackMayRunLong(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance)
+{
+    PTP_POOL Pool = Instance->Worker->Pool;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (Instance->MayRunLong)
+        return STATUS_SUCCESS;
+
+    Instance->MayRunLong = TRUE;
+    InterlockedIncrement(&Pool->LongRunning);
+
+    /* Make sure someone else is around to run the queued work */
+    if (Pool->IdleWorkers > 0)
+        return STATUS_SUCCESS;
+
+    RtlAcquireSRWLockExclusive(&Pool->Lock);
+    if (Pool->WorkerCount < Pool->MaxThreads)
+        Status = RtlpTpCreateWorker(Pool);
+    else
+        Status = STATUS_TOO_MANY_THREADS;
+    RtlReleaseSRWLockExclusive(&Pool->Lock);
+
+    return Status;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpDisassociateCallback(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance)
+{
+    if (!Instance->Associated)
+        return;
+
+    /* Waiters on the object no longer wait for us */
+    Instance->Associated = FALSE;
+    RtlpTpCallbackDone(Instance->Object);
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCallbackLeaveCriticalSectionOnCompletion(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _Inout_ PRTL_CRITICAL_SECTION CriticalSection)
+{
+    Instance->CriticalSection = CriticalSection;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCallbackReleaseMutexOnCompletion(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Mutex)
+{
+    Instance->Mutex = Mutex;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCallbackReleaseSemaphoreOnCompletion(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Semaphore,
+    _In_ LONG ReleaseCount)
+{
+    Instance->Semaphore = Semaphore;
+    Instance->SemaphoreCount = ReleaseCount;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCallbackSetEventOnCompletion(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ HANDLE Event)
+{
+    Instance->Event = Event;
+}
+
+/*
+ * @implemented
+ */
+VOID
+NTAPI
+TpCallbackUnloadDllOnCompletion(
+    _Inout_ PTP_CALLBACK_INSTANCE Instance,
+    _In_ PVOID DllHandle)
+{
+    Instance->Dll = DllHandle;
+}
+
+/* EOF */
@@ -0,0 +1,262 @@
+/*
+ * PROJECT:     ReactOS system libraries
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Wait on address routines
+ */
+
+/* NOTE: Waiters are kept in a small hash table keyed by the address they
+   wait on. Every waiter blocks on the global keyed event with its own wait
+   block as the key, so a wake releases exactly the threads it took off the
+   list and nobody else. Waiters are woken in FIFO order. */
+
+/* INCLUDES ******************************************************************/
+
+#include <rtl_vista.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* INTERNAL TYPES ************************************************************/
+
+#define ADDRESS_WAIT_BUCKETS        128
+#define ADDRESS_WAIT_SPIN_COUNT     1024
+#define ADDRESS_WAIT_LOCK_SPINS     64
+
+/* Wait block states */
+#define ADDRESS_WAIT_WAITING        0
+#define ADDRESS_WAIT_SLEEPING       1
+#define ADDRESS_WAIT_WOKEN          2
+
+typedef struct _ADDRESS_WAIT_BLOCK
+{
+    LIST_ENTRY ListEntry;
+    volatile VOID *Address;
+    struct _ADDRESS_WAIT_BLOCK *NextWake;
+    volatile LONG State;
+    BOOLEAN Linked;
+} ADDRESS_WAIT_BLOCK, *PADDRESS_WAIT_BLOCK;
+
+typedef struct _ADDRESS_WAIT_BUCKET
+{
+    volatile LONG Lock;
+    LIST_ENTRY WaitList;
+} ADDRESS_WAIT_BUCKET, *PADDRESS_WAIT_BUCKET;
+
+/* GLOBALS *******************************************************************/
+
+static ADDRESS_WAIT_BUCKET AddressWaitBuckets[ADDRESS_WAIT_BUCKETS];
+
+/* INTERNAL FUNCTIONS ********************************************************/
+
+static
+PADDRESS_WAIT_BUCKET
+RtlpGetAddressWaitBucket(IN volatile VOID *Address)
+{
+    ULONG_PTR Hash = (ULONG_PTR)Address;
+
+    /* Spread neighbouring variables over different buckets */
+    Hash = (Hash >> 3) ^ (Hash >> 10);
+    return &AddressWaitBuckets[Hash % ADDRESS_WAIT_BUCKETS];
+}
+
+static
+VOID
+RtlpAcquireAddressWaitBucket(IN PADDRESS_WAIT_BUCKET Bucket)
+{
+    ULONG Spins = 0;
+
+    /* The lock only covers a few list operations, so just spin for it.
+       Give up the processor now and then in case the owner got preempted. */
+    while (InterlockedBitTestAndSet(&Bucket->Lock, 0))
+    {
+        do
+        {
+            if (++Spins % ADDRESS_WAIT_LOCK_SPINS == 0)
+                NtYieldExecution();
+            else
+                YieldProcessor();
+        } while (Bucket->Lock != 0);
+    }
+
+    /* The table is zero-initialized, set up the list on first use */
+    if (Bucket->WaitList.Flink == NULL)
+        InitializeListHead(&Bucket->WaitList);
+}
+
+FORCEINLINE
+VOID
+RtlpReleaseAddressWaitBucket(IN PADDRESS_WAIT_BUCKET Bucket)
+{
+    InterlockedExchange(&Bucket->Lock, 0);
+}
+
+static
+BOOLEAN
+RtlpAddressValueMatches(IN volatile VOID *Address,
+                        IN PVOID CompareAddress,
+                        IN SIZE_T AddressSize)
+{
+    switch (AddressSize)
+    {
+        case 1:
+            return *(volatile UCHAR *)Address == *(PUCHAR)CompareAddress;
+        case 2:
+            return *(volatile USHORT *)Address == *(PUSHORT)CompareAddress;
+        case 4:
+            return *(volatile ULONG *)Address == *(PULONG)CompareAddress;
+        default:
+            /* A torn read on 32 bit only makes us return early */
+            return *(volatile ULONGLONG *)Address == *(PULONGLONG)CompareAddress;
+    }
+}
+
+static
+VOID
+RtlpWakeAddress(IN PVOID Address,
+                IN BOOLEAN WakeAll)
+{
+    PADDRESS_WAIT_BUCKET Bucket = RtlpGetAddressWaitBucket(Address);
+    PADDRESS_WAIT_BLOCK WaitBlock, WakeList, *WakeTail;
+    PLIST_ENTRY Entry;
+
+    /* Pairs with the barrier in RtlWaitOnAddress. Either the waiter sees
+       the new value, or we see the waiter on the list. */
+    MemoryBarrier();
+    if (Bucket->WaitList.Flink == NULL || IsListEmpty(&Bucket->WaitList))
+        return;
+
+    WakeList = NULL;
+    WakeTail = &WakeList;
+
+    RtlpAcquireAddressWaitBucket(Bucket);
+    for (Entry = Bucket->WaitList.Flink;
+         Entry != &Bucket->WaitList;
+         Entry = Entry->Flink)
+    {
+        WaitBlock = CONTAINING_RECORD(Entry, ADDRESS_WAIT_BLOCK, ListEntry);
+        if (WaitBlock->Address != Address)
+            continue;
+
+        /* Take it off the list, the waiter checks Linked after a timeout */
+        Entry = Entry->Blink;
+        RemoveEntryList(&WaitBlock->ListEntry);
+        WaitBlock->Linked = FALSE;
+
+        *WakeTail = WaitBlock;
+        WakeTail = &WaitBlock->NextWake;
+
+        if (!WakeAll)
+            break;
+    }
+    RtlpReleaseAddressWaitBucket(Bucket);
+
+    /* Release the waiters outside of the lock, since timed out waiters need
+       it before they can take the release. A waiter that hasn't gone to
+       sleep yet sees the state change and never calls into the kernel. */
+    while (WakeList != NULL)
+    {
+        WaitBlock = WakeList;
+
+        /* The wait block is gone as soon as its owner is woken */
+        WakeList = WaitBlock->NextWake;
+
+        if (InterlockedExchange(&WaitBlock->State, ADDRESS_WAIT_WOKEN) == ADDRESS_WAIT_SLEEPING)
+            NtReleaseKeyedEvent(NULL, WaitBlock, FALSE, NULL);
+    }
+}
+
+/* EXPORTED FUNCTIONS ********************************************************/
+
+NTSTATUS
+NTAPI
+RtlWaitOnAddress(IN volatile VOID *Address,
+                 IN PVOID CompareAddress,
+                 IN SIZE_T AddressSize,
+                 IN PLARGE_INTEGER Timeout OPTIONAL)
+{
+    PADDRESS_WAIT_BUCKET Bucket;
+    ADDRESS_WAIT_BLOCK WaitBlock;
+    NTSTATUS Status;
+    ULONG Spins;
+
+    if (AddressSize != 1 && AddressSize != 2 &&
+        AddressSize != 4 && AddressSize != 8)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    /* Values that change quickly don't need a wait at all */
+    if (NtCurrentPeb()->NumberOfProcessors > 1)
+    {
+        for (Spins = 0; Spins < ADDRESS_WAIT_SPIN_COUNT; Spins++)
+        {
+            if (!RtlpAddressValueMatches(Address, CompareAddress, AddressSize))
+                return STATUS_SUCCESS;
+            YieldProcessor();
+        }
+    }
+
+    WaitBlock.Address = Address;
+    WaitBlock.NextWake = NULL;
+    WaitBlock.State = ADDRESS_WAIT_WAITING;
+    WaitBlock.Linked = TRUE;
+
+    /* Queue up first and only then check the value again, so that a wake
+       coming right after the change can't be missed */
+    Bucket = RtlpGetAddressWaitBucket(Address);
+    RtlpAcquireAddressWaitBucket(Bucket);
+    InsertTailList(&Bucket->WaitList, &WaitBlock.ListEntry);
+    MemoryBarrier();
+
+    if (!RtlpAddressValueMatches(Address, CompareAddress, AddressSize))
+    {
+        RemoveEntryList(&WaitBlock.ListEntry);
+        RtlpReleaseAddressWaitBucket(Bucket);
+        return STATUS_SUCCESS;
+    }
+    RtlpReleaseAddressWaitBucket(Bucket);
+
+    /* If a wake got to us in the meantime, there is no need to sleep */
+    if (InterlockedCompareExchange(&WaitBlock.State,
+                                   ADDRESS_WAIT_SLEEPING,
+                                   ADDRESS_WAIT_WAITING) != ADDRESS_WAIT_WAITING)
+    {
+        return STATUS_SUCCESS;
+    }
+
+    Status = NtWaitForKeyedEvent(NULL, &WaitBlock, FALSE, Timeout);
+    if (Status != STATUS_SUCCESS)
+    {
+        RtlpAcquireAddressWaitBucket(Bucket);
+        if (WaitBlock.Linked)
+        {
+            /* Nobody woke us, leave the list */
+            RemoveEntryList(&WaitBlock.ListEntry);
+            RtlpReleaseAddressWaitBucket(Bucket);
+            return Status;
+        }
+        RtlpReleaseAddressWaitBucket(Bucket);
+
+        /* A wake already took us off the list and is about to release
+           the keyed event for us. Take that release, or it would block. */
+        NtWaitForKeyedEvent(NULL, &WaitBlock, FALSE, NULL);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+NTAPI
+RtlWakeAddressAll(IN PVOID Address)
+{
+    RtlpWakeAddress(Address, TRUE);
+}
+
+VOID
+NTAPI
+RtlWakeAddressSingle(IN PVOID Address)
+{
+    RtlpWakeAddress(Address, FALSE);
+}
+
+/* EOF */
@@ -27,6 +27,8 @@
 #include "CCFDATAStorage.h"
 #include "raw.h"
 #include "mszip.h"
+#include "lzx.h"
+#include "pipeline.h"
 
 #ifndef CAB_READ_ONLY
 
@@ -86,12 +88,15 @@ CCabinet::CCabinet()
     Codec          = NULL;
     CodecId        = -1;
     CodecSelected  = false;
+    LZXWindowBits  = LZX_DEFAULT_WINDOW_BITS;
 
     OutputBuffer = NULL;
     InputBuffer  = NULL;
     MaxDiskSize  = 0;
     BlockIsSplit = false;
     ScratchFile  = NULL;
+    Pipeline     = NULL;
+    ThreadCount  = std::thread::hardware_concurrency();
 
     FolderUncompSize = 0;
     BytesLeftInBlock = 0;
@@ -289,13 +294,33 @@ bool CCabinet::SetCompressionCodec(const char* CodecName)
 /*
  * FUNCTION: Selects the codec to use for compression
  * ARGUMENTS:
- *    CodecName = Pointer to a string with the name of the codec
+ *    CodecName = Pointer to a string with the name of the codec,
+ *                "lzx" may be followed by ":<window bits>" (15-21)
  */
 {
     if( !strcasecmp(CodecName, "raw") )
         SelectCodec(CAB_CODEC_RAW);
     else if( !strcasecmp(CodecName, "mszip") )
         SelectCodec(CAB_CODEC_MSZIP);
+    else if( !strncasecmp(CodecName, "lzx", 3) && (CodecName[3] == '\0' || CodecName[3] == ':') )
+    {
+        if (CodecName[3] == ':')
+        {
+            char* End;
+            ULONG WindowBits = strtoul(&CodecName[4], &End, 10);
+
+            if (*End != '\0' || WindowBits < LZX_MIN_WINDOW_BITS || WindowBits > LZX_MAX_WINDOW_BITS)
+            {
+                printf("ERROR: LZX window size must be between %u and %u!\n",
+                       LZX_MIN_WINDOW_BITS, LZX_MAX_WINDOW_BITS);
+                return false;
+            }
+
+            LZXWindowBits = WindowBits;
+        }
+
+        SelectCodec(CAB_CODEC_LZX);
+    }
     else
     {
         printf("ERROR: Invalid codec specified!\n");
@@ -1031,22 +1056,40 @@ void CCabinet::SelectCodec(LONG Id)
         delete Codec;
     }
 
+    Codec = CreateCodec(Id);
+    if (!Codec)
+        return;
+
+    CodecId       = Id;
+    CodecSelected = true;
+}
+
+
+CCABCodec* CCabinet::CreateCodec(LONG Id)
+/*
+ * FUNCTION: Creates a codec engine
+ * ARGUMENTS:
+ *     Id = Codec identifier
+ * RETURNS:
+ *     Pointer to new codec, NULL if the identifier is unknown
+ */
+{
     switch (Id)
     {
         case CAB_CODEC_RAW:
-            Codec = new CRawCodec();
-            break;
+            return new CRawCodec();
 
         case CAB_CODEC_MSZIP:
-            Codec = new CMSZipCodec();
-            break;
+            return new CMSZipCodec();
+
+#ifndef CAB_READ_ONLY
+        case CAB_CODEC_LZX:
+            return new CLZXCodec(LZXWindowBits);
+#endif /* CAB_READ_ONLY */
 
         default:
-            return;
+            return NULL;
     }
-
-    CodecId       = Id;
-    CodecSelected = true;
 }
 
 
@@ -1064,9 +1107,11 @@ ULONG CCabinet::NewCabinet()
     ULONG Status;
 
     CurrentDiskNumber = 0;
+    DiskStartTime = std::chrono::steady_clock::now();
 
-    OutputBuffer = malloc(CAB_BLOCKSIZE + 12); // This should be enough
-    InputBuffer  = malloc(CAB_BLOCKSIZE + 12); // This should be enough
+    /* InputBuffer is also used to read compressed blocks from the scratch file */
+    OutputBuffer = malloc(CAB_MAX_COMPBLOCKSIZE);
+    InputBuffer  = malloc(CAB_MAX_COMPBLOCKSIZE);
     if ((!OutputBuffer) || (!InputBuffer))
     {
         DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
@@ -1115,6 +1160,16 @@ ULONG CCabinet::NewCabinet()
 
     Status = ScratchFile->Create();
 
+    if (ThreadCount > 0)
+    {
+        LONG Id = CodecId;
+
+        /* Blocks of a stateful codec must be compressed one after the other,
+           a single worker still overlaps compression with reading the files */
+        Pipeline = new CCompressionPipeline([this, Id]() { return CreateCodec(Id); },
+                                            Codec->IsStateful() ? 1 : ThreadCount);
+    }
+
     CreateNewFolder = false;
 
     CreateNewDisk = false;
@@ -1137,6 +1192,8 @@ ULONG CCabinet::NewDisk()
 
     CreateNewDisk = false;
 
+    DiskStartTime = std::chrono::steady_clock::now();
+
     DiskSize = sizeof(CFHEADER) + TotalFolderSize + TotalFileSize;
 
     InitCabinetHeader();
@@ -1156,8 +1213,22 @@ ULONG CCabinet::NewFolder()
  *     Status of operation
  */
 {
+    ULONG Status;
+
     DPRINT(MAX_TRACE, ("Creating new folder.\n"));
 
+    if (Pipeline)
+    {
+        /* Blocks still in the pipeline belong to the current folder */
+        Status = RetireDataBlocks(true);
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+
+        Pipeline->ResetState();
+    }
+
+    Codec->ResetState();
+
     CurrentFolderNode = NewFolderNode();
     if (!CurrentFolderNode)
     {
@@ -1174,6 +1245,11 @@ ULONG CCabinet::NewFolder()
             CurrentFolderNode->Folder.CompressionType = CAB_COMP_MSZIP;
             break;
 
+        case CAB_CODEC_LZX:
+            /* The window size is stored in the high byte */
+            CurrentFolderNode->Folder.CompressionType = (USHORT)(CAB_COMP_LZX | (LZXWindowBits << 8));
+            break;
+
         default:
             return CAB_STATUS_UNSUPPCOMP;
     }
@@ -1333,7 +1409,9 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             while (CreateNewDisk)
             {
                 DPRINT(MAX_TRACE, ("Creating new disk.\n"));
-                CommitDisk(true);
+                Status = CommitDisk(true);
+                if (Status != CAB_STATUS_SUCCESS)
+                    return Status;
                 CloseDisk();
                 NewDisk();
 
@@ -1370,7 +1448,9 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             if (CreateNewDisk)
             {
                 DPRINT(MID_TRACE, ("Creating new disk 2.\n"));
-                CommitDisk(true);
+                Status = CommitDisk(true);
+                if (Status != CAB_STATUS_SUCCESS)
+                    return Status;
                 CloseDisk();
                 NewDisk();
                 CreateNewDisk = false;
@@ -1384,9 +1464,7 @@ ULONG CCabinet::WriteDisk(ULONG MoreDisks)
             }
         } while (CreateNewDisk);
     }
-    CommitDisk(MoreDisks);
-
-    return CAB_STATUS_SUCCESS;
+    return CommitDisk(MoreDisks);
 }
 
 
@@ -1400,6 +1478,14 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
  */
 {
     ULONG Status;
+    char Message[512];
+
+    if (Pipeline)
+    {
+        Status = RetireDataBlocks(true);
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
 
     OnCabinetName(CurrentDiskNumber, CabinetName);
 
@@ -1452,6 +1538,11 @@ ULONG CCabinet::CommitDisk(ULONG MoreDisks)
 
     ScratchFile->Truncate();
 
+    snprintf(Message, sizeof(Message), "Cabinet %s (%u bytes) written in %.2f seconds.\n",
+             CabinetName, (UINT)DiskSize,
+             std::chrono::duration<double>(std::chrono::steady_clock::now() - DiskStartTime).count());
+    OnVerboseMessage(Message);
+
     return CAB_STATUS_SUCCESS;
 }
 
@@ -1483,6 +1574,12 @@ ULONG CCabinet::CloseCabinet()
 {
     ULONG Status;
 
+    if (Pipeline)
+    {
+        delete Pipeline;
+        Pipeline = NULL;
+    }
+
     DestroyFileNodes();
 
     DestroyFolderNodes();
@@ -1717,6 +1814,17 @@ cleanup2:
     return bRet;
 }
 
+void CCabinet::SetThreadCount(ULONG Count)
+/*
+ * FUNCTION: Sets the number of threads compressing data blocks
+ * ARGUMENTS:
+ *     Count = Number of threads, 0 to compress on the calling thread
+ */
+{
+    ThreadCount = Count;
+}
+
+
 void CCabinet::SetMaxDiskSize(ULONG Size)
 /*
  * FUNCTION: Sets the maximum size of the current disk
@@ -2759,6 +2867,25 @@ ULONG CCabinet::WriteDataBlock()
     ULONG BytesWritten;
     PCFDATA_NODE DataNode;
 
+    if (Pipeline)
+    {
+        if (MaxDiskSize == 0)
+        {
+            Pipeline->Submit(InputBuffer, CurrentIBufferSize);
+
+            CurrentIBufferSize = 0;
+            CurrentIBuffer     = InputBuffer;
+
+            /* Don't let the pipeline grow without bounds */
+            return RetireDataBlocks(false);
+        }
+
+        /* Splitting a block across disks needs the disk size, so compress serially */
+        Status = RetireDataBlocks(true);
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
     if (!BlockIsSplit)
     {
         Status = Codec->Compress(OutputBuffer,
@@ -2835,6 +2962,82 @@ ULONG CCabinet::WriteDataBlock()
     return CAB_STATUS_SUCCESS;
 }
 
+
+ULONG CCabinet::StoreDataBlock(void* Buffer, ULONG CompSize, ULONG UncompSize)
+/*
+ * FUNCTION: Writes a compressed data block to the scratch file
+ * ARGUMENTS:
+ *     Buffer     = Pointer to buffer with compressed data
+ *     CompSize   = Size of compressed data
+ *     UncompSize = Size of uncompressed data
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    ULONG Status;
+    ULONG BytesWritten;
+    PCFDATA_NODE DataNode;
+
+    DataNode = NewDataNode(CurrentFolderNode);
+    if (!DataNode)
+    {
+        DPRINT(MIN_TRACE, ("Insufficient memory.\n"));
+        return CAB_STATUS_NOMEMORY;
+    }
+
+    DataNode->Data.CompSize   = (USHORT)CompSize;
+    DataNode->Data.UncompSize = (USHORT)UncompSize;
+    DataNode->Data.Checksum   = 0;
+    DataNode->ScratchFilePosition = ScratchFile->Position();
+
+    Status = ScratchFile->WriteBlock(&DataNode->Data, Buffer, &BytesWritten);
+    if (Status != CAB_STATUS_SUCCESS)
+        return Status;
+
+    DiskSize += sizeof(CFDATA) + BytesWritten;
+
+    CurrentFolderNode->TotalFolderSize += (BytesWritten + sizeof(CFDATA));
+    CurrentFolderNode->Folder.DataBlockCount++;
+
+    LastBlockStart += UncompSize;
+
+    return CAB_STATUS_SUCCESS;
+}
+
+
+ULONG CCabinet::RetireDataBlocks(bool Wait)
+/*
+ * FUNCTION: Writes blocks compressed by the pipeline to the scratch file in order
+ * ARGUMENTS:
+ *     Wait = true to write all blocks, false to write the ones that are ready
+ *            (and wait only if too many blocks are pending)
+ * RETURNS:
+ *     Status of operation
+ */
+{
+    std::unique_ptr<CAB_PIPELINE_BLOCK> Block;
+    ULONG MaxPending = 4 * std::max(ThreadCount, (ULONG)1);
+    ULONG Status;
+
+    while (Pipeline->Retire(Wait || Pipeline->Pending() > MaxPending, Block))
+    {
+        if (Block->Status != CS_SUCCESS)
+        {
+            DPRINT(MIN_TRACE, ("Cannot compress block (%u).\n", (UINT)Block->Status));
+            return (Block->Status == CS_NOMEMORY) ? CAB_STATUS_NOMEMORY : CAB_STATUS_FAILURE;
+        }
+
+        DPRINT(MAX_TRACE, ("Block compressed. UncompSize (%u)  CompSize(%u).\n",
+            (UINT)Block->Input.size(), (UINT)Block->CompSize));
+
+        Status = StoreDataBlock(Block->Output.data(), Block->CompSize, (ULONG)Block->Input.size());
+        if (Status != CAB_STATUS_SUCCESS)
+            return Status;
+    }
+
+    return CAB_STATUS_SUCCESS;
+}
+
 #if !defined(_WIN32)
 
 void CCabinet::ConvertDateAndTime(time_t* Time,
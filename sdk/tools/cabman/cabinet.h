@@ -27,6 +27,8 @@
 #include <limits.h>
 #include <string>
 #include <list>
+#include <algorithm>
+#include <chrono>
 
 #ifndef PATH_MAX
 #define PATH_MAX MAX_PATH
@@ -41,6 +43,7 @@
 #define DIR_SEPARATOR_STRING "\\"
 
 #define strcasecmp _stricmp
+#define strncasecmp _strnicmp
 #define strdup _strdup
 #else
 #define DIR_SEPARATOR_CHAR '/'
@@ -108,6 +111,8 @@ extern ULONG DebugTraceLevel;
 #define CAB_SIGNATURE        0x4643534D // "MSCF"
 #define CAB_VERSION          0x0103
 #define CAB_BLOCKSIZE        32768
+/* Largest compressed block a codec may produce (LZX worst case is below this) */
+#define CAB_MAX_COMPBLOCKSIZE (CAB_BLOCKSIZE + 6144)
 
 #define CAB_COMP_MASK        0x00FF
 #define CAB_COMP_NONE        0x0000
@@ -284,6 +289,10 @@ public:
                              void* InputBuffer,
                              ULONG InputLength,
                              PULONG OutputLength) = 0;
+    /* Forgets previous blocks, called when a new folder starts */
+    virtual void ResetState() {};
+    /* Returns whether blocks depend on the blocks before them in the folder */
+    virtual bool IsStateful() { return false; };
 };
 
 
@@ -377,6 +386,8 @@ public:
     ULONG AddFile(const std::string& FileName, const std::string& TargetFolder);
     /* Sets the maximum size of the current disk */
     void SetMaxDiskSize(ULONG Size);
+    /* Sets the number of threads compressing data blocks */
+    void SetThreadCount(ULONG Count);
 #endif /* CAB_READ_ONLY */
 
     /* Default event handlers */
@@ -415,6 +426,7 @@ private:
     ULONG ComputeChecksum(void* Buffer, ULONG Size, ULONG Seed);
     ULONG ReadBlock(void* Buffer, ULONG Size, PULONG BytesRead);
     bool MatchFileNamePattern(const char* FileName, const char* Pattern);
+    CCABCodec* CreateCodec(LONG Id);
 #ifndef CAB_READ_ONLY
     ULONG InitCabinetHeader();
     ULONG WriteCabinetHeader(bool MoreDisks);
@@ -422,6 +434,8 @@ private:
     ULONG WriteFileEntries();
     ULONG CommitDataBlocks(PCFFOLDER_NODE FolderNode);
     ULONG WriteDataBlock();
+    ULONG StoreDataBlock(void* Buffer, ULONG CompSize, ULONG UncompSize);
+    ULONG RetireDataBlocks(bool Wait);
     ULONG GetAttributesOnFile(PCFFILE_NODE File);
     ULONG SetAttributesOnFile(char* FileName, USHORT FileAttributes);
     ULONG GetFileTimes(FILE* FileHandle, PCFFILE_NODE File);
@@ -460,6 +474,7 @@ private:
     CCABCodec *Codec;
     LONG CodecId;
     bool CodecSelected;
+    ULONG LZXWindowBits;
     void* InputBuffer;
     void* CurrentIBuffer;               // Current offset in input buffer
     ULONG CurrentIBufferSize;   // Bytes left in input buffer
@@ -484,6 +499,10 @@ private:
     ULONG TotalBytesLeft;
     bool BlockIsSplit;                  // true if current data block is split
     ULONG NextFolderNumber;     // Zero based folder number
+
+    class CCompressionPipeline *Pipeline; // NULL when compressing serially
+    ULONG ThreadCount;
+    std::chrono::steady_clock::time_point DiskStartTime;
 #endif /* CAB_READ_ONLY */
 };
 
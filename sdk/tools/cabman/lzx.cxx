@@ -0,0 +1,723 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS cabinet manager
+ * FILE:        tools/cabman/lzx.cxx
+ * PURPOSE:     CAB codec for LZX compressed data
+ * NOTES:       Only compression is supported. Every CFDATA block is coded
+ *              as a single verbatim (or uncompressed) LZX block, so that the
+ *              bitstream is realigned on block boundaries as CAB requires.
+ *              Intel E8 call translation is never used.
+ */
+#include <stdio.h>
+#include <queue>
+#include "lzx.h"
+
+#define LZX_NIL             0xFFFFFFFF
+#define LZX_MAX_CHAIN       256     /* Hash chain entries searched per position */
+#define LZX_NICE_LENGTH     128     /* Stop searching once a match is this long */
+#define LZX_LAZY_LENGTH     32      /* Don't try lazy matching above this length */
+#define LZX_MAX_TREE_BITS   16
+#define LZX_MAX_PRETREE_BITS 15
+
+static const UCHAR ExtraBits[LZX_MAX_POSITION_SLOTS + 1] =
+{
+     0,  0,  0,  0,  1,  1,  2,  2,  3,  3,  4,  4,  5,  5,  6,  6,
+     7,  7,  8,  8,  9,  9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14,
+    15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17,
+    17, 17, 17
+};
+
+static const ULONG PositionBase[LZX_MAX_POSITION_SLOTS + 1] =
+{
+          0,       1,       2,       3,       4,       6,       8,      12,
+         16,      24,      32,      48,      64,      96,     128,     192,
+        256,     384,     512,     768,    1024,    1536,    2048,    3072,
+       4096,    6144,    8192,   12288,   16384,   24576,   32768,   49152,
+      65536,   98304,  131072,  196608,  262144,  393216,  524288,  655360,
+     786432,  917504, 1048576, 1179648, 1310720, 1441792, 1572864, 1703936,
+    1835008, 1966080, 2097152
+};
+
+static ULONG GetPositionSlot(ULONG FormattedOffset)
+{
+    ULONG Low = 0, High = LZX_MAX_POSITION_SLOTS;
+
+    /* Find the last slot whose base is not above the offset */
+    while (Low < High)
+    {
+        ULONG Middle = (Low + High + 1) / 2;
+
+        if (PositionBase[Middle] <= FormattedOffset)
+            Low = Middle;
+        else
+            High = Middle - 1;
+    }
+
+    return Low;
+}
+
+static inline ULONG HashBytes(const unsigned char* Data)
+{
+    ULONG Value = Data[0] | (Data[1] << 8) | (Data[2] << 16);
+    return (Value * 2654435761U) >> (32 - LZX_HASH_BITS);
+}
+
+
+/* CLZXCodec */
+
+CLZXCodec::CLZXCodec(ULONG WindowBits)
+/*
+ * FUNCTION: Constructor
+ * ARGUMENTS:
+ *     WindowBits = Base 2 logarithm of the window size (15-21)
+ */
+{
+    ULONG PositionSlots;
+
+    if (WindowBits < LZX_MIN_WINDOW_BITS)
+        WindowBits = LZX_MIN_WINDOW_BITS;
+    else if (WindowBits > LZX_MAX_WINDOW_BITS)
+        WindowBits = LZX_MAX_WINDOW_BITS;
+
+    if (WindowBits == 20)
+        PositionSlots = 42;
+    else if (WindowBits == 21)
+        PositionSlots = 50;
+    else
+        PositionSlots = WindowBits * 2;
+
+    this->WindowBits = WindowBits;
+    WindowSize   = 1 << WindowBits;
+    MainElements = LZX_NUM_CHARS + PositionSlots * 8;
+
+    Window.resize(2 * WindowSize + CAB_BLOCKSIZE);
+    Head.resize(1 << LZX_HASH_BITS);
+    Prev.resize(WindowSize);
+
+    ResetState();
+}
+
+
+CLZXCodec::~CLZXCodec()
+/*
+ * FUNCTION: Default destructor
+ */
+{
+}
+
+
+void CLZXCodec::ResetState()
+/*
+ * FUNCTION: Forgets all history, the next block starts a new LZX stream
+ */
+{
+    std::fill(Head.begin(), Head.end(), LZX_NIL);
+    WindowFill = 0;
+    HashedUpTo = 0;
+    R0 = R1 = R2 = 1;
+    HeaderWritten = false;
+
+    /* Deltas of the first trees are relative to zero lengths */
+    memset(PrevMainLengths, 0, sizeof(PrevMainLengths));
+    memset(PrevLengthLengths, 0, sizeof(PrevLengthLengths));
+}
+
+
+void CLZXCodec::SlideWindow()
+/*
+ * FUNCTION: Discards the oldest half of the window buffer
+ */
+{
+    ULONG i;
+
+    memmove(&Window[0], &Window[WindowSize], WindowFill - WindowSize);
+    WindowFill -= WindowSize;
+    HashedUpTo -= WindowSize;
+
+    for (i = 0; i < Head.size(); i++)
+        Head[i] = (Head[i] != LZX_NIL && Head[i] >= WindowSize) ? Head[i] - WindowSize : LZX_NIL;
+
+    for (i = 0; i < Prev.size(); i++)
+        Prev[i] = (Prev[i] != LZX_NIL && Prev[i] >= WindowSize) ? Prev[i] - WindowSize : LZX_NIL;
+}
+
+
+void CLZXCodec::InsertHashes(ULONG End)
+/*
+ * FUNCTION: Adds the positions before End to the hash chains
+ * ARGUMENTS:
+ *     End = First position not to add
+ */
+{
+    /* A position can only be hashed once its three bytes are known */
+    while ((HashedUpTo < End) && (HashedUpTo + 2 < WindowFill))
+    {
+        ULONG Hash = HashBytes(&Window[HashedUpTo]);
+
+        Prev[HashedUpTo & (WindowSize - 1)] = Head[Hash];
+        Head[Hash] = HashedUpTo;
+        HashedUpTo++;
+    }
+}
+
+
+ULONG CLZXCodec::MatchLength(ULONG Position, ULONG Distance, ULONG MaxLength)
+/*
+ * FUNCTION: Returns how many bytes at Position repeat the ones Distance bytes before
+ */
+{
+    const unsigned char* Current = &Window[Position];
+    const unsigned char* Match = Current - Distance;
+    ULONG Length = 0;
+
+    while ((Length < MaxLength) && (Current[Length] == Match[Length]))
+        Length++;
+
+    return Length;
+}
+
+
+ULONG CLZXCodec::FindMatch(ULONG Position, ULONG MaxLength, PULONG Distance, PULONG RepeatIndex)
+/*
+ * FUNCTION: Finds the best match at a position
+ * ARGUMENTS:
+ *     Position    = Position in the window buffer
+ *     MaxLength   = Maximum length of the match
+ *     Distance    = Address of buffer to place the match distance
+ *     RepeatIndex = Address of buffer to place the repeated offset used (0-2), or 3
+ * RETURNS:
+ *     Length of the match, 0 if none was found
+ */
+{
+    ULONG Repeats[3] = { R0, R1, R2 };
+    ULONG MaxDistance = std::min(Position, WindowSize - 3);
+    ULONG BestLength = 0, RepeatLength = 0, RepeatBest = 0;
+    ULONG Candidate, Chain, Length, i;
+
+    /* Repeated offsets are the cheapest to code, try them first */
+    for (i = 0; i < 3; i++)
+    {
+        if (Repeats[i] > MaxDistance)
+            continue;
+
+        Length = MatchLength(Position, Repeats[i], MaxLength);
+        if (Length > RepeatLength)
+        {
+            RepeatLength = Length;
+            RepeatBest   = i;
+        }
+    }
+
+    if (MaxLength >= 3)
+    {
+        InsertHashes(Position);
+
+        Candidate = Head[HashBytes(&Window[Position])];
+        for (Chain = 0; (Chain < LZX_MAX_CHAIN) && (Candidate != LZX_NIL); Chain++)
+        {
+            if ((Candidate >= Position) || (Position - Candidate > MaxDistance))
+                break;
+
+            if (Window[Candidate + BestLength] == Window[Position + BestLength])
+            {
+                Length = MatchLength(Position, Position - Candidate, MaxLength);
+                if (Length > BestLength)
+                {
+                    BestLength = Length;
+                    *Distance  = Position - Candidate;
+                    if ((Length >= LZX_NICE_LENGTH) || (Length == MaxLength))
+                        break;
+                }
+            }
+
+            Candidate = Prev[Candidate & (WindowSize - 1)];
+        }
+
+        /* Short matches far away cost more than the literals */
+        if ((BestLength == 3) && (*Distance > 16384))
+            BestLength = 0;
+    }
+
+    if ((RepeatLength >= LZX_MIN_MATCH) && (RepeatLength + 1 >= BestLength))
+    {
+        *Distance    = Repeats[RepeatBest];
+        *RepeatIndex = RepeatBest;
+        return RepeatLength;
+    }
+
+    if (BestLength < 3)
+        return 0;
+
+    *RepeatIndex = 3;
+    return BestLength;
+}
+
+
+void CLZXCodec::AddMatch(ULONG Length, ULONG Distance, ULONG RepeatIndex)
+/*
+ * FUNCTION: Adds a match to the current block and updates the repeated offsets
+ */
+{
+    LZX_TOKEN Token;
+    ULONG Slot, LengthHeader;
+
+    LengthHeader = std::min(Length - LZX_MIN_MATCH, (ULONG)LZX_NUM_PRIMARY_LENGTHS);
+
+    switch (RepeatIndex)
+    {
+        case 0:
+            Slot = 0;
+            Token.VerbatimBits = 0;
+            break;
+
+        case 1:
+            Slot = 1;
+            Token.VerbatimBits = 0;
+            R1 = R0;
+            R0 = Distance;
+            break;
+
+        case 2:
+            Slot = 2;
+            Token.VerbatimBits = 0;
+            R2 = R0;
+            R0 = Distance;
+            break;
+
+        default:
+            Slot = GetPositionSlot(Distance + 2);
+            Token.VerbatimBits = Distance + 2 - PositionBase[Slot];
+            R2 = R1;
+            R1 = R0;
+            R0 = Distance;
+            break;
+    }
+
+    Token.MainSymbol   = (USHORT)(LZX_NUM_CHARS + ((Slot << 3) | LengthHeader));
+    Token.LengthFooter = (USHORT)(Length - LZX_MIN_MATCH - LengthHeader);
+    Tokens.push_back(Token);
+
+    MainFrequencies[Token.MainSymbol]++;
+    if (LengthHeader == LZX_NUM_PRIMARY_LENGTHS)
+        LengthFrequencies[Token.LengthFooter]++;
+}
+
+
+void CLZXCodec::PutBits(ULONG Value, ULONG Count)
+/*
+ * FUNCTION: Writes bits to the output, LZX packs them MSB first in 16-bit little endian words
+ */
+{
+    BitBuffer = (BitBuffer << Count) | (Value & ((1ULL << Count) - 1));
+    BitCount += Count;
+
+    while (BitCount >= 16)
+    {
+        USHORT Word = (USHORT)(BitBuffer >> (BitCount - 16));
+
+        Output.push_back((unsigned char)(Word & 0xFF));
+        Output.push_back((unsigned char)(Word >> 8));
+        BitCount -= 16;
+    }
+}
+
+
+void CLZXCodec::FlushBits()
+/*
+ * FUNCTION: Pads the output to a 16-bit boundary
+ */
+{
+    if (BitCount > 0)
+        PutBits(0, 16 - BitCount);
+    BitBuffer = 0;
+}
+
+
+void CLZXCodec::BuildTree(const ULONG* Frequencies,
+                          ULONG Count,
+                          ULONG MaxBits,
+                          UCHAR* Lengths,
+                          USHORT* Codes)
+/*
+ * FUNCTION: Builds a length-limited canonical Huffman code
+ * ARGUMENTS:
+ *     Frequencies = Symbol frequencies
+ *     Count       = Number of symbols
+ *     MaxBits     = Maximum code length
+ *     Lengths     = Address of buffer to place the code lengths
+ *     Codes       = Address of buffer to place the codes
+ */
+{
+    typedef std::pair<ULONGLONG, ULONG> NODE; /* Weight, node index */
+    std::vector<ULONG> Weights(Frequencies, Frequencies + Count);
+    std::vector<ULONG> Parent;
+    USHORT NextCode[LZX_MAX_TREE_BITS + 2];
+    ULONG LengthCount[LZX_MAX_TREE_BITS + 2];
+    ULONG Used = 0, i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (Weights[i] != 0)
+            Used++;
+    }
+
+    /* The decoders only accept complete codes, so we need at least two symbols */
+    for (i = 0; (i < Count) && (Used < 2); i++)
+    {
+        if (Weights[i] == 0)
+        {
+            Weights[i] = 1;
+            Used++;
+        }
+    }
+
+    for (;;)
+    {
+        std::priority_queue<NODE, std::vector<NODE>, std::greater<NODE> > Queue;
+        ULONG MaxLength = 0;
+
+        Parent.assign(Count, LZX_NIL);
+        for (i = 0; i < Count; i++)
+        {
+            if (Weights[i] != 0)
+                Queue.push(NODE(Weights[i], i));
+        }
+
+        while (Queue.size() > 1)
+        {
+            NODE First = Queue.top();
+            Queue.pop();
+            NODE Second = Queue.top();
+            Queue.pop();
+
+            Parent[First.second]  = (ULONG)Parent.size();
+            Parent[Second.second] = (ULONG)Parent.size();
+            Queue.push(NODE(First.first + Second.first, (ULONG)Parent.size()));
+            Parent.push_back(LZX_NIL);
+        }
+
+        for (i = 0; i < Count; i++)
+        {
+            ULONG Length = 0, Node = i;
+
+            if (Weights[i] != 0)
+            {
+                while (Parent[Node] != LZX_NIL)
+                {
+                    Node = Parent[Node];
+                    Length++;
+                }
+            }
+
+            Lengths[i] = (UCHAR)std::min(Length, (ULONG)0xFF);
+            MaxLength  = std::max(MaxLength, Length);
+        }
+
+        if (MaxLength <= MaxBits)
+            break;
+
+        /* Flatten the distribution and try again */
+        for (i = 0; i < Count; i++)
+        {
+            if (Weights[i] != 0)
+                Weights[i] = (Weights[i] >> 1) | 1;
+        }
+    }
+
+    /* Assign the canonical codes, shorter codes and lower symbols first */
+    memset(LengthCount, 0, sizeof(LengthCount));
+    for (i = 0; i < Count; i++)
+        LengthCount[Lengths[i]]++;
+
+    LengthCount[0] = 0;
+    NextCode[0] = 0;
+    for (i = 1; i <= MaxBits; i++)
+        NextCode[i] = (USHORT)((NextCode[i - 1] + LengthCount[i - 1]) << 1);
+
+    for (i = 0; i < Count; i++)
+        Codes[i] = Lengths[i] ? NextCode[Lengths[i]]++ : 0;
+}
+
+
+void CLZXCodec::WriteTree(const UCHAR* Lengths, UCHAR* PreviousLengths, ULONG First, ULONG Last)
+/*
+ * FUNCTION: Writes part of a tree as deltas to the previous lengths, coded with a pretree
+ * ARGUMENTS:
+ *     Lengths         = Code lengths of the tree
+ *     PreviousLengths = Code lengths of the tree in the previous block, updated on return
+ *     First           = First symbol to write
+ *     Last            = Symbol after the last one to write
+ */
+{
+    typedef struct _PRETREE_ITEM
+    {
+        UCHAR Symbol;
+        UCHAR ExtraCount;
+        UCHAR Extra;
+        UCHAR Delta;       // Second pretree symbol of a 19 code
+    } PRETREE_ITEM;
+    std::vector<PRETREE_ITEM> Items;
+    ULONG Frequencies[LZX_PRETREE_NUM_ELEMENTS];
+    UCHAR PreLengths[LZX_PRETREE_NUM_ELEMENTS];
+    USHORT PreCodes[LZX_PRETREE_NUM_ELEMENTS];
+    ULONG x, Run, i;
+
+    memset(Frequencies, 0, sizeof(Frequencies));
+
+    for (x = First; x < Last; )
+    {
+        PRETREE_ITEM Item = { 0, 0, 0, 0 };
+
+        for (Run = 1; (x + Run < Last) && (Lengths[x + Run] == Lengths[x]); Run++);
+
+        if ((Lengths[x] == 0) && (Run >= 20))
+        {
+            Run = std::min(Run, (ULONG)51);
+            Item.Symbol = 18;
+            Item.ExtraCount = 5;
+            Item.Extra = (UCHAR)(Run - 20);
+        }
+        else if ((Lengths[x] == 0) && (Run >= 4))
+        {
+            Item.Symbol = 17;
+            Item.ExtraCount = 4;
+            Item.Extra = (UCHAR)(Run - 4);
+        }
+        else if (Run >= 4)
+        {
+            Run = std::min(Run, (ULONG)5);
+            Item.Symbol = 19;
+            Item.ExtraCount = 1;
+            Item.Extra = (UCHAR)(Run - 4);
+            Item.Delta = (UCHAR)((PreviousLengths[x] - Lengths[x] + 17) % 17);
+            Frequencies[Item.Delta]++;
+        }
+        else
+        {
+            Run = 1;
+            Item.Symbol = (UCHAR)((PreviousLengths[x] - Lengths[x] + 17) % 17);
+        }
+
+        Frequencies[Item.Symbol]++;
+        Items.push_back(Item);
+        x += Run;
+    }
+
+    BuildTree(Frequencies, LZX_PRETREE_NUM_ELEMENTS, LZX_MAX_PRETREE_BITS, PreLengths, PreCodes);
+
+    for (i = 0; i < LZX_PRETREE_NUM_ELEMENTS; i++)
+        PutBits(PreLengths[i], 4);
+
+    for (const PRETREE_ITEM& Item : Items)
+    {
+        PutBits(PreCodes[Item.Symbol], PreLengths[Item.Symbol]);
+        PutBits(Item.Extra, Item.ExtraCount);
+        if (Item.Symbol == 19)
+            PutBits(PreCodes[Item.Delta], PreLengths[Item.Delta]);
+    }
+
+    memcpy(&PreviousLengths[First], &Lengths[First], Last - First);
+}
+
+
+void CLZXCodec::WriteVerbatimBlock(ULONG Length)
+/*
+ * FUNCTION: Writes the tokens of the current block as a verbatim block
+ * ARGUMENTS:
+ *     Length = Uncompressed length of the block
+ */
+{
+    BuildTree(MainFrequencies, MainElements, LZX_MAX_TREE_BITS, MainLengths, MainCodes);
+    BuildTree(LengthFrequencies, LZX_NUM_SECONDARY_LENGTHS, LZX_MAX_TREE_BITS, LengthLengths, LengthCodes);
+
+    PutBits(LZX_BLOCKTYPE_VERBATIM, 3);
+    PutBits(Length >> 8, 16);
+    PutBits(Length & 0xFF, 8);
+
+    WriteTree(MainLengths, PrevMainLengths, 0, LZX_NUM_CHARS);
+    WriteTree(MainLengths, PrevMainLengths, LZX_NUM_CHARS, MainElements);
+    WriteTree(LengthLengths, PrevLengthLengths, 0, LZX_NUM_SECONDARY_LENGTHS);
+
+    for (const LZX_TOKEN& Token : Tokens)
+    {
+        ULONG Slot;
+
+        PutBits(MainCodes[Token.MainSymbol], MainLengths[Token.MainSymbol]);
+        if (Token.MainSymbol < LZX_NUM_CHARS)
+            continue;
+
+        if (((Token.MainSymbol - LZX_NUM_CHARS) & 7) == LZX_NUM_PRIMARY_LENGTHS)
+            PutBits(LengthCodes[Token.LengthFooter], LengthLengths[Token.LengthFooter]);
+
+        Slot = (Token.MainSymbol - LZX_NUM_CHARS) >> 3;
+        if (Slot > 3)
+            PutBits(Token.VerbatimBits, ExtraBits[Slot]);
+    }
+}
+
+
+void CLZXCodec::WriteUncompressedBlock(const unsigned char* Data, ULONG Length)
+/*
+ * FUNCTION: Writes data as an uncompressed block
+ */
+{
+    ULONG Repeats[3] = { R0, R1, R2 };
+    ULONG i;
+
+    PutBits(LZX_BLOCKTYPE_UNCOMPRESSED, 3);
+    PutBits(Length >> 8, 16);
+    PutBits(Length & 0xFF, 8);
+    FlushBits();
+
+    for (i = 0; i < 3; i++)
+    {
+        Output.push_back((unsigned char)(Repeats[i]));
+        Output.push_back((unsigned char)(Repeats[i] >> 8));
+        Output.push_back((unsigned char)(Repeats[i] >> 16));
+        Output.push_back((unsigned char)(Repeats[i] >> 24));
+    }
+
+    Output.insert(Output.end(), Data, Data + Length);
+
+    /* Keep the stream word aligned */
+    if (Length & 1)
+        Output.push_back(0);
+}
+
+
+ULONG CLZXCodec::Compress(void* OutputBuffer,
+                          void* InputBuffer,
+                          ULONG InputLength,
+                          PULONG OutputLength)
+/*
+ * FUNCTION: Compresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer   = Pointer to buffer to place compressed data
+ *     InputBuffer    = Pointer to buffer with data to be compressed
+ *     InputLength    = Length of input buffer
+ *     OutputLength   = Address of buffer to place size of compressed data
+ * NOTES:
+ *     OutputBuffer must be able to hold CAB_MAX_COMPBLOCKSIZE bytes
+ */
+{
+    UCHAR SavedMainLengths[LZX_MAINTREE_MAXSYMBOLS];
+    UCHAR SavedLengthLengths[LZX_NUM_SECONDARY_LENGTHS];
+    ULONG SavedR0 = R0, SavedR1 = R1, SavedR2 = R2;
+    ULONG Start, End, Position;
+    ULONG Length, Distance, RepeatIndex;
+    ULONG NextLength, NextDistance, NextRepeatIndex;
+
+    DPRINT(MAX_TRACE, ("InputLength (%u).\n", (UINT)InputLength));
+
+    if ((InputLength == 0) || (InputLength > CAB_BLOCKSIZE))
+        return CS_BADSTREAM;
+
+    /* Append the block to the window */
+    if (WindowFill + InputLength > 2 * WindowSize)
+        SlideWindow();
+
+    Start = WindowFill;
+    memcpy(&Window[Start], InputBuffer, InputLength);
+    WindowFill += InputLength;
+    End = WindowFill;
+
+    Tokens.clear();
+    memset(MainFrequencies, 0, sizeof(MainFrequencies));
+    memset(LengthFrequencies, 0, sizeof(LengthFrequencies));
+
+    /* Parse the block, matches must not cross the end of the block */
+    for (Position = Start; Position < End; )
+    {
+        Length = FindMatch(Position,
+                           std::min((ULONG)LZX_MAX_MATCH, End - Position),
+                           &Distance,
+                           &RepeatIndex);
+
+        if ((Length != 0) && (Length < LZX_LAZY_LENGTH) && (Position + 1 < End))
+        {
+            /* Lazy matching, prefer a literal if a longer match follows */
+            NextLength = FindMatch(Position + 1,
+                                   std::min((ULONG)LZX_MAX_MATCH, End - Position - 1),
+                                   &NextDistance,
+                                   &NextRepeatIndex);
+            if (NextLength > Length + 1)
+                Length = 0;
+        }
+
+        if (Length == 0)
+        {
+            LZX_TOKEN Token = { Window[Position], 0, 0 };
+
+            Tokens.push_back(Token);
+            MainFrequencies[Window[Position]]++;
+            Position++;
+        }
+        else
+        {
+            AddMatch(Length, Distance, RepeatIndex);
+            Position += Length;
+        }
+    }
+
+    memcpy(SavedMainLengths, PrevMainLengths, sizeof(SavedMainLengths));
+    memcpy(SavedLengthLengths, PrevLengthLengths, sizeof(SavedLengthLengths));
+
+    Output.clear();
+    BitBuffer = 0;
+    BitCount  = 0;
+
+    /* The stream starts with the E8 translation flag, which we don't use */
+    if (!HeaderWritten)
+        PutBits(0, 1);
+
+    WriteVerbatimBlock(InputLength);
+    FlushBits();
+
+    if (Output.size() > 16 + InputLength + (InputLength & 1))
+    {
+        /* Incompressible data, store it instead */
+        memcpy(PrevMainLengths, SavedMainLengths, sizeof(SavedMainLengths));
+        memcpy(PrevLengthLengths, SavedLengthLengths, sizeof(SavedLengthLengths));
+        R0 = SavedR0;
+        R1 = SavedR1;
+        R2 = SavedR2;
+
+        Output.clear();
+        BitBuffer = 0;
+        BitCount  = 0;
+
+        if (!HeaderWritten)
+            PutBits(0, 1);
+
+        WriteUncompressedBlock(&Window[Start], InputLength);
+    }
+
+    HeaderWritten = true;
+
+    ASSERT(Output.size() <= CAB_MAX_COMPBLOCKSIZE);
+
+    memcpy(OutputBuffer, Output.data(), Output.size());
+    *OutputLength = (ULONG)Output.size();
+
+    return CS_SUCCESS;
+}
+
+
+ULONG CLZXCodec::Uncompress(void* OutputBuffer,
+                            void* InputBuffer,
+                            ULONG InputLength,
+                            PULONG OutputLength)
+/*
+ * FUNCTION: Uncompresses data in a buffer
+ * ARGUMENTS:
+ *     OutputBuffer = Pointer to buffer to place uncompressed data
+ *     InputBuffer  = Pointer to buffer with data to be uncompressed
+ *     InputLength  = Length of input buffer
+ *     OutputLength = Address of buffer to place size of uncompressed data
+ */
+{
+    DPRINT(MIN_TRACE, ("LZX decompression is not supported.\n"));
+    return CS_BADSTREAM;
+}
+
+/* EOF */
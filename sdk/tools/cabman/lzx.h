@@ -0,0 +1,108 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS cabinet manager
+ * FILE:        tools/cabman/lzx.h
+ * PURPOSE:     CAB codec for LZX compressed data
+ */
+
+#pragma once
+
+#include "cabinet.h"
+#include <vector>
+
+#define LZX_MIN_WINDOW_BITS     15
+#define LZX_MAX_WINDOW_BITS     21
+#define LZX_DEFAULT_WINDOW_BITS 21
+
+#define LZX_MIN_MATCH           2
+#define LZX_MAX_MATCH           257
+#define LZX_NUM_CHARS           256
+#define LZX_NUM_PRIMARY_LENGTHS 7
+#define LZX_NUM_SECONDARY_LENGTHS 249
+#define LZX_PRETREE_NUM_ELEMENTS 20
+#define LZX_MAX_POSITION_SLOTS  50
+#define LZX_MAINTREE_MAXSYMBOLS (LZX_NUM_CHARS + LZX_MAX_POSITION_SLOTS * 8)
+
+#define LZX_BLOCKTYPE_VERBATIM     1
+#define LZX_BLOCKTYPE_UNCOMPRESSED 3
+
+/* Number of bits in the match finder hash */
+#define LZX_HASH_BITS           16
+
+
+/* Classes */
+
+class CLZXCodec : public CCABCodec
+{
+public:
+    /* Constructor, the window size is 2^WindowBits */
+    CLZXCodec(ULONG WindowBits);
+    /* Default destructor */
+    virtual ~CLZXCodec();
+    /* Compresses a data block */
+    virtual ULONG Compress(void* OutputBuffer,
+                           void* InputBuffer,
+                           ULONG InputLength,
+                           PULONG OutputLength) override;
+    /* Uncompresses a data block */
+    virtual ULONG Uncompress(void* OutputBuffer,
+                             void* InputBuffer,
+                             ULONG InputLength,
+                             PULONG OutputLength) override;
+    /* Forgets the history, called when a new folder starts */
+    virtual void ResetState() override;
+    /* Blocks reference the data of the blocks before them */
+    virtual bool IsStateful() override { return true; };
+private:
+    typedef struct _LZX_TOKEN
+    {
+        USHORT MainSymbol;      // Literal, or 256 + (position slot << 3 | length header)
+        USHORT LengthFooter;    // Used if the length header is 7
+        ULONG VerbatimBits;     // Position footer
+    } LZX_TOKEN;
+
+    void InsertHashes(ULONG End);
+    ULONG MatchLength(ULONG Position, ULONG Distance, ULONG MaxLength);
+    ULONG FindMatch(ULONG Position, ULONG MaxLength, PULONG Distance, PULONG RepeatIndex);
+    void SlideWindow();
+    void AddMatch(ULONG Length, ULONG Distance, ULONG RepeatIndex);
+    void PutBits(ULONG Value, ULONG Count);
+    void FlushBits();
+    void BuildTree(const ULONG* Frequencies, ULONG Count, ULONG MaxBits, UCHAR* Lengths, USHORT* Codes);
+    void WriteTree(const UCHAR* Lengths, UCHAR* PreviousLengths, ULONG First, ULONG Last);
+    void WriteVerbatimBlock(ULONG Length);
+    void WriteUncompressedBlock(const unsigned char* Data, ULONG Length);
+
+    ULONG WindowBits;
+    ULONG WindowSize;
+    ULONG MainElements;
+    bool HeaderWritten;
+
+    /* Match finder, the window buffer holds twice the LZX window */
+    std::vector<unsigned char> Window;
+    std::vector<ULONG> Head;
+    std::vector<ULONG> Prev;
+    ULONG WindowFill;       // Bytes of valid data in the window buffer
+    ULONG HashedUpTo;       // First position not yet in the hash chains
+    ULONG R0, R1, R2;       // Repeated offsets
+
+    /* Current block */
+    std::vector<LZX_TOKEN> Tokens;
+    ULONG MainFrequencies[LZX_MAINTREE_MAXSYMBOLS];
+    ULONG LengthFrequencies[LZX_NUM_SECONDARY_LENGTHS];
+    UCHAR MainLengths[LZX_MAINTREE_MAXSYMBOLS];
+    UCHAR LengthLengths[LZX_NUM_SECONDARY_LENGTHS];
+    USHORT MainCodes[LZX_MAINTREE_MAXSYMBOLS];
+    USHORT LengthCodes[LZX_NUM_SECONDARY_LENGTHS];
+
+    /* Tree lengths of the previous block, new ones are sent as deltas */
+    UCHAR PrevMainLengths[LZX_MAINTREE_MAXSYMBOLS];
+    UCHAR PrevLengthLengths[LZX_NUM_SECONDARY_LENGTHS];
+
+    /* Bit output */
+    std::vector<unsigned char> Output;
+    ULONGLONG BitBuffer;
+    ULONG BitCount;
+};
+
+/* EOF */
@@ -0,0 +1,165 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS cabinet manager
+ * FILE:        tools/cabman/pipeline.cxx
+ * PURPOSE:     Parallel compression of CFDATA blocks
+ * NOTES:       Blocks are compressed by a pool of workers, each with its own
+ *              codec, and handed back in the order they were submitted so
+ *              the cabinet is identical to one compressed serially.
+ */
+#include "pipeline.h"
+
+
+/* CCompressionPipeline */
+
+CCompressionPipeline::CCompressionPipeline(std::function<CCABCodec*()> CreateCodec, ULONG ThreadCount)
+/*
+ * FUNCTION: Constructor
+ * ARGUMENTS:
+ *     CreateCodec = Function creating a codec for a worker
+ *     ThreadCount = Number of workers
+ */
+{
+    ULONG i;
+
+    Stop = false;
+
+    for (i = 0; i < ThreadCount; i++)
+        Codecs.push_back(std::unique_ptr<CCABCodec>(CreateCodec()));
+
+    for (i = 0; i < ThreadCount; i++)
+        Threads.push_back(std::thread(&CCompressionPipeline::Worker, this, Codecs[i].get()));
+}
+
+
+CCompressionPipeline::~CCompressionPipeline()
+/*
+ * FUNCTION: Default destructor
+ */
+{
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Stop = true;
+    }
+    WorkAvailable.notify_all();
+
+    for (std::thread& Thread : Threads)
+        Thread.join();
+}
+
+
+void CCompressionPipeline::Worker(CCABCodec* Codec)
+/*
+ * FUNCTION: Compresses blocks until the pipeline is destroyed
+ * ARGUMENTS:
+ *     Codec = Codec owned by this worker
+ */
+{
+    std::unique_lock<std::mutex> Guard(Lock);
+
+    for (;;)
+    {
+        PCAB_PIPELINE_BLOCK Block;
+
+        while (!Stop && Work.empty())
+            WorkAvailable.wait(Guard);
+
+        if (Stop)
+            return;
+
+        Block = Work.front();
+        Work.pop_front();
+
+        Guard.unlock();
+        Block->Status = Codec->Compress(Block->Output.data(),
+                                        Block->Input.data(),
+                                        (ULONG)Block->Input.size(),
+                                        &Block->CompSize);
+        Guard.lock();
+
+        Block->Done = true;
+        WorkDone.notify_all();
+    }
+}
+
+
+void CCompressionPipeline::Submit(const void* Buffer, ULONG Size)
+/*
+ * FUNCTION: Queues a copy of a block for compression
+ * ARGUMENTS:
+ *     Buffer = Pointer to buffer with uncompressed data
+ *     Size   = Size of uncompressed data
+ */
+{
+    std::unique_ptr<CAB_PIPELINE_BLOCK> Block(new CAB_PIPELINE_BLOCK);
+
+    Block->Input.assign((const unsigned char*)Buffer, (const unsigned char*)Buffer + Size);
+    Block->Output.resize(CAB_MAX_COMPBLOCKSIZE);
+    Block->CompSize = 0;
+    Block->Status   = CS_SUCCESS;
+    Block->Done     = false;
+
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        Work.push_back(Block.get());
+        Blocks.push_back(std::move(Block));
+    }
+    WorkAvailable.notify_one();
+}
+
+
+bool CCompressionPipeline::Retire(bool Wait, std::unique_ptr<CAB_PIPELINE_BLOCK>& Block)
+/*
+ * FUNCTION: Removes the oldest block from the pipeline once it is compressed
+ * ARGUMENTS:
+ *     Wait  = true to wait for the block to be compressed
+ *     Block = Receives the block
+ * RETURNS:
+ *     true if a block was returned, false if there is none or it is not ready
+ */
+{
+    std::unique_lock<std::mutex> Guard(Lock);
+
+    if (Blocks.empty())
+        return false;
+
+    while (!Blocks.front()->Done)
+    {
+        if (!Wait)
+            return false;
+        WorkDone.wait(Guard);
+    }
+
+    Block = std::move(Blocks.front());
+    Blocks.pop_front();
+
+    return true;
+}
+
+
+ULONG CCompressionPipeline::Pending()
+/*
+ * FUNCTION: Returns the number of blocks not yet retired
+ */
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+
+    return (ULONG)Blocks.size();
+}
+
+
+void CCompressionPipeline::ResetState()
+/*
+ * FUNCTION: Makes the codecs forget previous blocks, called when a new folder starts
+ */
+{
+    std::lock_guard<std::mutex> Guard(Lock);
+
+    ASSERT(Blocks.empty());
+
+    /* The workers are idle, so the codecs are not in use */
+    for (std::unique_ptr<CCABCodec>& Codec : Codecs)
+        Codec->ResetState();
+}
+
+/* EOF */
@@ -0,0 +1,60 @@
+/*
+ * COPYRIGHT:   See COPYING in the top level directory
+ * PROJECT:     ReactOS cabinet manager
+ * FILE:        tools/cabman/pipeline.h
+ * PURPOSE:     Parallel compression of CFDATA blocks
+ */
+
+#pragma once
+
+#include "cabinet.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A block waiting to be compressed, or waiting to be stored once compressed */
+typedef struct _CAB_PIPELINE_BLOCK
+{
+    std::vector<unsigned char> Input;
+    std::vector<unsigned char> Output;
+    ULONG CompSize;
+    ULONG Status;       // Codec status code
+    bool Done;
+} CAB_PIPELINE_BLOCK, *PCAB_PIPELINE_BLOCK;
+
+
+/* Classes */
+
+class CCompressionPipeline
+{
+public:
+    /* Constructor, starts ThreadCount workers with a codec each */
+    CCompressionPipeline(std::function<CCABCodec*()> CreateCodec, ULONG ThreadCount);
+    /* Default destructor */
+    virtual ~CCompressionPipeline();
+    /* Queues a copy of a block for compression */
+    void Submit(const void* Buffer, ULONG Size);
+    /* Returns the oldest block if it is compressed */
+    bool Retire(bool Wait, std::unique_ptr<CAB_PIPELINE_BLOCK>& Block);
+    /* Returns the number of submitted blocks that are not yet retired */
+    ULONG Pending();
+    /* Resets the codecs, all blocks must be retired */
+    void ResetState();
+private:
+    void Worker(CCABCodec* Codec);
+
+    std::vector<std::thread> Threads;
+    std::vector<std::unique_ptr<CCABCodec>> Codecs;
+    std::mutex Lock;
+    std::condition_variable WorkAvailable;
+    std::condition_variable WorkDone;
+    std::deque<std::unique_ptr<CAB_PIPELINE_BLOCK>> Blocks; // In submission order
+    std::deque<PCAB_PIPELINE_BLOCK> Work;                   // Not yet compressed
+    bool Stop;
+};
+
+/* EOF */
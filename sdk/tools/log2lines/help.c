@@ -31,8 +31,9 @@ char *verboseUsage =
 "  image lookup, greatly increasing performance. Only image path and its\n"
 "  base address are cached.\n\n"
 "Options:\n"
-"  -b   Use this combined with '-l'. Enable buffering on logFile.\n"
-"       This may solve loosing output on real hardware (ymmv).\n\n"
+"  -b   Enable buffering on logFile (see '-l') and the output.\n"
+"       This may solve loosing output on real hardware (ymmv).\n"
+"       Without it every line is flushed when done, to follow live logs.\n\n"
 "  -c   Console mode. Outputs text per character instead of per line.\n"
 "       This is slightly slower but enables to see what you type.\n\n"
 "  -d <directory>|<ISO image>\n"
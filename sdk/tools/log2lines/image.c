@@ -7,6 +7,7 @@
 
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
 #include <rsym.h>
 
 #include "compat.h"
@@ -40,19 +41,22 @@ find_offset(void *data, size_t offset)
     PSYMBOLFILE_HEADER RosSymHeader = (PSYMBOLFILE_HEADER)data;
     PROSSYM_ENTRY Entries = (PROSSYM_ENTRY)((char *)data + RosSymHeader->SymbolsOffset);
     size_t symbols = RosSymHeader->SymbolsLength / sizeof(ROSSYM_ENTRY);
-    size_t i;
+    size_t low = 0, high = symbols, mid;
 
-    for (i = 0; i < symbols; i++)
+    /* rsym sorts the entries by address, find the first one above offset */
+    while (low < high)
     {
-        if (Entries[i].Address > offset)
-        {
-            if (!i--)
-                return NULL;
-            else
-                return &Entries[i];
-        }
+        mid = low + (high - low) / 2;
+        if (Entries[mid].Address > offset)
+            high = mid;
+        else
+            low = mid + 1;
     }
-    return NULL;
+
+    /* Offsets before the first or after the last entry are not translated */
+    if (low == 0 || low == symbols)
+        return NULL;
+    return &Entries[low - 1];
 }
 
 PIMAGE_SECTION_HEADER
@@ -165,4 +169,34 @@ get_ImageBase(char *fname, size_t *ImageBase)
     return 0;
 }
 
+/* Loads an image once, so following translations for it can use the
+ * .rossym data in memory. RosSymData is NULL if the image has none. */
+PLIST_MEMBER
+image_entry_create(char *name, const char *fname)
+{
+    PLIST_MEMBER pentry;
+    PIMAGE_SECTION_HEADER PERosSymSectionHeader;
+    size_t l = strlen(name);
+
+    pentry = malloc(sizeof(LIST_MEMBER) + l + 1);
+    if (!pentry)
+        return NULL;
+
+    pentry->name = (char *)(pentry + 1);
+    memcpy(pentry->name, name, l + 1);
+    pentry->path = NULL;
+    pentry->ImageBase = INVALID_BASE;
+    pentry->RelBase = INVALID_BASE;
+    pentry->RosSymData = NULL;
+    pentry->buf = load_file(fname, &pentry->Size);
+    if (!pentry->buf)
+        return entry_delete(pentry);
+
+    PERosSymSectionHeader = get_sectionheader(pentry->buf);
+    if (PERosSymSectionHeader)
+        pentry->RosSymData = pentry->buf + PERosSymSectionHeader->PointerToRawData;
+
+    return pentry;
+}
+
 /* EOF */
@@ -9,6 +9,8 @@
 
 #include <rsym.h>
 
+#include "list.h"
+
 size_t fixup_offset(size_t ImageBase, size_t offset);
 
 PROSSYM_ENTRY find_offset(void *data, size_t offset);
@@ -17,4 +19,6 @@ PIMAGE_SECTION_HEADER get_sectionheader(const void *FileData);
 
 int get_ImageBase(char *fname, size_t *ImageBase);
 
+PLIST_MEMBER image_entry_create(char *name, const char *fname);
+
 /* EOF */
@@ -33,6 +33,7 @@ LIST sources;
 LINEINFO lastLine;
 FILE *logFile        = NULL;
 LIST cache;
+LIST images;
 SUMM summ;
 
 
@@ -216,15 +217,11 @@ print_offset(void *data, size_t offset, char *toString)
 }
 
 static int
-process_data(const void *FileData, size_t offset, char *toString)
+process_data(void *RosSymData, size_t offset, char *toString)
 {
     int res;
 
-    PIMAGE_SECTION_HEADER PERosSymSectionHeader = get_sectionheader((char *)FileData);
-    if (!PERosSymSectionHeader)
-        return 2;
-
-    res = print_offset((char *)FileData + PERosSymSectionHeader->PointerToRawData, offset, toString);
+    res = print_offset(RosSymData, offset, toString);
     if (res)
     {
         if (toString)
@@ -239,23 +236,21 @@ process_data(const void *FileData, size_t offset, char *toString)
 }
 
 static int
-process_file(const char *file_name, size_t offset, char *toString)
+process_file(char *name, const char *file_name, size_t offset, char *toString)
 {
-    void *FileData;
-    size_t FileSize;
-    int res = 1;
+    PLIST_MEMBER pentry;
 
-    FileData = load_file(file_name, &FileSize);
-    if (!FileData)
+    pentry = image_entry_create(name, file_name);
+    if (!pentry)
     {
         l2l_dbg(0, "An error occured loading '%s'\n", file_name);
+        return 1;
     }
-    else
-    {
-        res = process_data(FileData, offset, toString);
-        free(FileData);
-    }
-    return res;
+    entry_insert(&images, pentry);
+
+    if (!pentry->RosSymData)
+        return 2;
+    return process_data(pentry->RosSymData, offset, toString);
 }
 
 static int
@@ -270,6 +265,23 @@ translate_file(const char *cpath, size_t offset, char *toString)
     if (!path)
         return 1;
 
+    // Images that were translated before are kept loaded:
+    pentry = entry_lookup(&images, path);
+    if (pentry)
+    {
+        if (pentry->RosSymData)
+        {
+            res = process_data(pentry->RosSymData, offset, toString);
+        }
+        else
+        {
+            summ.offset_errors++;
+            res = 2;
+        }
+        free(dpath);
+        return res;
+    }
+
     // The path could be absolute:
     if (get_ImageBase(path, &base))
     {
@@ -293,7 +305,7 @@ translate_file(const char *cpath, size_t offset, char *toString)
 
     if (!res)
     {
-        res = process_file(path, offset, toString);
+        res = process_file(dpath, path, offset, toString);
     }
 
     free(dpath);
@@ -454,6 +466,8 @@ translate_files(FILE *inFile, FILE *outFile)
                                     translate_char(c, outFile);
                                     report(outFile);
                                 }
+                                if (!opt_buffered)
+                                    fflush(outFile);
                             }
                         }
                     }
@@ -530,6 +544,10 @@ translate_files(FILE *inFile, FILE *outFile)
             }
             else
                 log(outFile, "%s", Line);
+
+            // Keep up with live logs, unless buffering was asked for
+            if (!opt_buffered)
+                fflush(outFile);
         }
     }
 
@@ -557,6 +575,7 @@ main(int argc, const char **argv)
 
     memset(&cache, 0, sizeof(LIST));
     memset(&sources, 0, sizeof(LIST));
+    memset(&images, 0, sizeof(LIST));
     stat_clear(&summ);
     clearLastLine();
 
@@ -666,6 +685,7 @@ cleanup:
 
     list_clear(&sources);
     list_clear(&cache);
+    list_clear(&images);
 
     return res;
 }
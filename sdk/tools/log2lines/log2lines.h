@@ -27,5 +27,6 @@ extern LIST cache;
 extern FILE *logFile;
 extern LINEINFO lastLine;
 extern LIST sources;
+extern LIST images;
 
 /* EOF */
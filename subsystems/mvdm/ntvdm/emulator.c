@@ -534,6 +534,9 @@ BOOLEAN EmulatorInitialize(HANDLE ConsoleInput, HANDLE ConsoleOutput)
     /* Initialize the CPU */
     CpuInitialize();
 
+    /* Now that the CPU is set up, give it direct access to the RAM */
+    MemInitializeDirectMap();
+
     /* Initialize DMA */
     DmaInitialize();
 
@@ -633,6 +636,9 @@ BOOLEAN EmulatorInitialize(HANDLE ConsoleInput, HANDLE ConsoleOutput)
     /* Initialize VDD support */
     VDDSupInitialize();
 
+    /* Nothing above may have dropped the direct memory map */
+    ASSERT(EmulatorContext.DirectMap != NULL && EmulatorContext.DirectMapPages != 0);
+
     return TRUE;
 }
 
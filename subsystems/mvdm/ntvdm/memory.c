@@ -38,6 +38,7 @@ typedef struct _MEM_HOOK
 
 static LIST_ENTRY HookList;
 static PMEM_HOOK PageTable[TOTAL_PAGES] = { NULL };
+static PUCHAR DirectMap[TOTAL_PAGES] = { NULL };
 static BOOLEAN A20Line = FALSE;
 
 /* PRIVATE FUNCTIONS **********************************************************/
@@ -134,6 +135,36 @@ WritePage(PMEM_HOOK Hook, ULONG Address, PVOID Buffer, ULONG Size)
     }
 }
 
+static VOID
+MemUpdateDirectMap(VOID)
+{
+    ULONG i, Page;
+
+    /*
+     * Let the CPU access plain RAM pages directly, and send the hooked ones
+     * through EmulatorReadMemory/EmulatorWriteMemory. When the A20 line is
+     * disabled the pages with bit 20 set are aliases of the lower ones.
+     * Note that when BaseAddress is NULL the first page maps to a NULL host
+     * pointer, so it always goes through the callbacks.
+     */
+    for (i = 0; i < TOTAL_PAGES; i++)
+    {
+        Page = A20Line ? i : (i & ~((1 << 20) >> 12));
+
+        if (PageTable[Page] == NULL)
+        {
+            Fast486MapDirectMemory(&EmulatorContext,
+                                   i << 12,
+                                   PAGE_SIZE,
+                                   REAL_TO_PHYS(Page << 12));
+        }
+        else
+        {
+            Fast486UnmapDirectMemory(&EmulatorContext, i << 12, PAGE_SIZE);
+        }
+    }
+}
+
 /* PUBLIC FUNCTIONS ***********************************************************/
 
 VOID FASTCALL EmulatorReadMemory(PFAST486_STATE State, ULONG Address, PVOID Buffer, ULONG Size)
@@ -271,7 +302,10 @@ VOID FASTCALL EmulatorCopyMemory(PFAST486_STATE State, ULONG DestAddress, ULONG
 
 VOID EmulatorSetA20(BOOLEAN Enabled)
 {
+    if (A20Line == Enabled) return;
+
     A20Line = Enabled;
+    MemUpdateDirectMap();
 }
 
 BOOLEAN EmulatorGetA20(VOID)
@@ -343,6 +377,7 @@ MemInstallFastMemoryHook(PVOID Address,
     /* Add the hook entry to the page table */
     for (i = FirstPage; i <= LastPage; i++) PageTable[i] = Hook;
 
+    MemUpdateDirectMap();
     return TRUE;
 }
 
@@ -371,6 +406,7 @@ MemRemoveFastMemoryHook(PVOID Address, ULONG Size)
         PageTable[i] = NULL;
     }
 
+    MemUpdateDirectMap();
     return TRUE;
 }
 
@@ -539,6 +575,7 @@ VDDInstallMemoryHook(IN HANDLE hVdd,
     /* Add the hook entry to the page table */
     for (i = FirstPage; i <= LastPage; i++) PageTable[i] = Hook;
 
+    MemUpdateDirectMap();
     return TRUE;
 }
 
@@ -595,6 +632,7 @@ VDDDeInstallMemoryHook(IN HANDLE hVdd,
         PageTable[i] = NULL;
     }
 
+    MemUpdateDirectMap();
     return TRUE;
 }
 
@@ -773,9 +811,21 @@ MemInitialize(VOID)
      * retrieve the exact CS:IP where the problem happens.
      */
     RtlFillMemory(BaseAddress, MAX_ADDRESS, 0xCC);
+
     return TRUE;
 }
 
+VOID
+MemInitializeDirectMap(VOID)
+{
+    /*
+     * Let the CPU access the RAM directly. This must be done once the CPU
+     * is initialized, since Fast486Initialize starts without a direct map.
+     */
+    Fast486SetDirectMap(&EmulatorContext, DirectMap, TOTAL_PAGES);
+    MemUpdateDirectMap();
+}
+
 VOID
 MemCleanup(VOID)
 {
@@ -783,6 +833,9 @@ MemCleanup(VOID)
     SIZE_T MemorySize = MAX_ADDRESS;
     PLIST_ENTRY Pointer;
 
+    /* The memory is going away, stop accessing it directly */
+    Fast486SetDirectMap(&EmulatorContext, NULL, 0);
+
     while (!IsListEmpty(&HookList))
     {
         Pointer = RemoveHeadList(&HookList);
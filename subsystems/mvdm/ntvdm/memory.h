@@ -32,6 +32,7 @@ typedef BOOLEAN
 /* FUNCTIONS ******************************************************************/
 
 BOOLEAN MemInitialize(VOID);
+VOID MemInitializeDirectMap(VOID);
 VOID MemCleanup(VOID);
 VOID MemExceptionHandler(ULONG FaultAddress, BOOLEAN Writing);
 
@@ -14,7 +14,16 @@ DBG_DEFAULT_CHANNEL(UserTimer);
 /* GLOBALS *******************************************************************/
 
 static LIST_ENTRY TimersListHead;
-static LONG TimeLast = 0;
+
+/* Timers hashed by window and id, for FindTimer */
+#define TIMER_HASH_BUCKETS       64
+static LIST_ENTRY TimersHashTable[TIMER_HASH_BUCKETS];
+
+/* Binary min-heap of the running timers, the earliest due one on top */
+#define TIMER_NOT_QUEUED         ((ULONG)-1)
+static PTIMER *TimerHeap;
+static ULONG TimerHeapCount;
+static ULONG TimerHeapSize;
 
 /* Windows 2000 has room for 32768 window-less timers */
 #define NUM_WINDOW_LESS_TIMERS   32768
@@ -46,6 +55,171 @@ ERESOURCE TimerLock;
 
 
 /* FUNCTIONS *****************************************************************/
+
+static
+DWORD
+FASTCALL
+TimerGetTime(VOID)
+{
+  /* The master timer expires by the interrupt time, so count in that */
+  return (DWORD)(KeQueryInterruptTime() / 10000);
+}
+
+FORCEINLINE
+ULONG
+TimerHash(PWND Window, UINT_PTR nID)
+{
+  return (ULONG)(((ULONG_PTR)Window >> 4) ^ nID) % TIMER_HASH_BUCKETS;
+}
+
+FORCEINLINE
+BOOL
+TimerIsEarlier(PTIMER pTmr1, PTIMER pTmr2)
+{
+  /* Compare the difference, so that the time can wrap around */
+  return (LONG)(pTmr1->dwDueTime - pTmr2->dwDueTime) < 0;
+}
+
+FORCEINLINE
+VOID
+TimerHeapSet(ULONG Index, PTIMER pTmr)
+{
+  TimerHeap[Index] = pTmr;
+  pTmr->iHeap = Index;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftUp(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Parent;
+
+  while (Index > 0)
+  {
+     Parent = (Index - 1) / 2;
+     if (!TimerIsEarlier(pTmr, TimerHeap[Parent]))
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Parent]);
+     Index = Parent;
+  }
+  TimerHeapSet(Index, pTmr);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSiftDown(ULONG Index)
+{
+  PTIMER pTmr = TimerHeap[Index];
+  ULONG Child;
+
+  while ((Child = 2 * Index + 1) < TimerHeapCount)
+  {
+     /* Take the earlier child */
+     if ((Child + 1 < TimerHeapCount) &&
+         TimerIsEarlier(TimerHeap[Child + 1], TimerHeap[Child]))
+     {
+        Child++;
+     }
+
+     if (!TimerIsEarlier(TimerHeap[Child], pTmr))
+        break;
+
+     TimerHeapSet(Index, TimerHeap[Child]);
+     Index = Child;
+  }
+  TimerHeapSet(Index, pTmr);
+}
+
+static
+BOOL
+FASTCALL
+TimerHeapReserve(VOID)
+{
+  PTIMER *NewHeap;
+  ULONG NewSize;
+
+  if (TimerHeapCount < TimerHeapSize)
+     return TRUE;
+
+  NewSize = max(TimerHeapSize * 2, 64);
+  NewHeap = ExAllocatePoolWithTag(PagedPool, NewSize * sizeof(PTIMER), USERTAG_TIMER);
+  if (!NewHeap)
+     return FALSE;
+
+  if (TimerHeap)
+  {
+     RtlCopyMemory(NewHeap, TimerHeap, TimerHeapCount * sizeof(PTIMER));
+     ExFreePoolWithTag(TimerHeap, USERTAG_TIMER);
+  }
+
+  TimerHeap = NewHeap;
+  TimerHeapSize = NewSize;
+  return TRUE;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapInsert(PTIMER pTmr)
+{
+  ASSERT(TimerHeapCount < TimerHeapSize);
+  TimerHeapSet(TimerHeapCount++, pTmr);
+  TimerHeapSiftUp(pTmr->iHeap);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapRemove(PTIMER pTmr)
+{
+  ULONG Index = pTmr->iHeap;
+  PTIMER pLast;
+
+  if (Index == TIMER_NOT_QUEUED)
+     return;
+
+  pTmr->iHeap = TIMER_NOT_QUEUED;
+
+  /* Fill the hole with the last timer and put that into place */
+  pLast = TimerHeap[--TimerHeapCount];
+  if (pLast != pTmr)
+  {
+     TimerHeapSet(Index, pLast);
+     TimerHeapSiftUp(Index);
+     TimerHeapSiftDown(pLast->iHeap);
+  }
+}
+
+static
+VOID
+FASTCALL
+SetMasterTimer(DWORD Time)
+{
+  LARGE_INTEGER DueTime;
+  LONG Delta;
+
+  if (TimerHeapCount > 0)
+  {
+     /* Wake up when the earliest timer is due */
+     Delta = (LONG)(TimerHeap[0]->dwDueTime - Time);
+     Delta = max(Delta, 1);
+  }
+  else
+  {
+     /* Nothing to do, but the raw input thread must not see it signaled */
+     Delta = USER_TIMER_MAXIMUM;
+  }
+
+  DueTime.QuadPart = -(LONGLONG)Delta * 10000;
+
+  ASSERT(MasterTimer != NULL);
+  KeSetTimer(MasterTimer, DueTime, NULL);
+}
+
 static
 PTIMER
 FASTCALL
@@ -54,10 +228,15 @@ CreateTimer(VOID)
   HANDLE Handle;
   PTIMER Ret = NULL;
 
+  /* Make sure the heap has room, so that the timer can always run */
+  if (!TimerHeapReserve())
+     return NULL;
+
   Ret = UserCreateObject(gHandleTable, NULL, NULL, &Handle, TYPE_TIMER, sizeof(TIMER));
   if (Ret)
   {
      Ret->head.h = Handle;
+     Ret->iHeap = TIMER_NOT_QUEUED;
      InsertTailList(&TimersListHead, &Ret->ptmrList);
   }
 
@@ -74,6 +253,8 @@ RemoveTimer(PTIMER pTmr)
   {
      /* Set the flag, it will be removed when ready */
      RemoveEntryList(&pTmr->ptmrList);
+     RemoveEntryList(&pTmr->ptmrHash);
+     TimerHeapRemove(pTmr);
      if ((pTmr->pWnd == NULL) && (!(pTmr->flags & TMRF_SYSTEM))) // System timers are reusable.
      {
         UINT_PTR IDEvent;
@@ -97,14 +278,15 @@ FindTimer(PWND Window,
           UINT_PTR nID,
           UINT flags)
 {
-  PLIST_ENTRY pLE;
+  PLIST_ENTRY pLE, ListHead;
   PTIMER pTmr, RetTmr = NULL;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while (pLE != &TimersListHead)
+  ListHead = &TimersHashTable[TimerHash(Window, nID)];
+  pLE = ListHead->Flink;
+  while (pLE != ListHead)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrHash);
 
     if ( pTmr->nID == nID &&
          pTmr->pWnd == Window &&
@@ -182,8 +364,7 @@ IntSetTimer( PWND Window,
 {
   PTIMER pTmr;
   UINT Ret = IDEvent;
-  LARGE_INTEGER DueTime;
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
+  DWORD Time;
 
 #if 0
   /* Windows NT/2k/XP behaviour */
@@ -236,10 +417,17 @@ IntSetTimer( PWND Window,
       IntUnlockWindowlessTimerBitmap();
   }
 
+  TimerEnterExclusive();
+  Time = TimerGetTime();
+
   if (!pTmr)
   {
      pTmr = CreateTimer();
-     if (!pTmr) return 0;
+     if (!pTmr)
+     {
+        TimerLeave();
+        return 0;
+     }
 
      if (Window && (Type & TMRF_TIFROMWND))
         pTmr->pti = Window->head.pti->pEThread->Tcb.Win32Thread;
@@ -252,22 +440,44 @@ IntSetTimer( PWND Window,
      }
 
      pTmr->pWnd    = Window;
-     pTmr->cmsCountdown = Elapse;
+     pTmr->dwDueTime = Time + Elapse;
      pTmr->cmsRate = Elapse;
      pTmr->pfn     = TimerFunc;
      pTmr->nID     = IDEvent;
-     pTmr->flags   = Type|TMRF_INIT;
+     pTmr->flags   = Type;
+
+     InsertTailList(&TimersHashTable[TimerHash(Window, IDEvent)], &pTmr->ptmrHash);
+     TimerHeapInsert(pTmr);
   }
   else
   {
-     pTmr->cmsCountdown = Elapse;
+     pTmr->dwDueTime = Time + Elapse;
      pTmr->cmsRate = Elapse;
+
+     if (pTmr->iHeap != TIMER_NOT_QUEUED)
+     {
+        /* Move it to its new place */
+        TimerHeapSiftUp(pTmr->iHeap);
+        TimerHeapSiftDown(pTmr->iHeap);
+     }
+     else
+     {
+        /* A one shot timer that already ran, start it again */
+        if (!TimerHeapReserve())
+        {
+           TimerLeave();
+           return 0;
+        }
+        pTmr->flags &= ~TMRF_WAITING;
+        TimerHeapInsert(pTmr);
+     }
   }
 
-  ASSERT(MasterTimer != NULL);
-  // Start the timer thread!
-  if (TimersListHead.Flink == TimersListHead.Blink) // There is only one timer
-     KeSetTimer(MasterTimer, DueTime, NULL);
+  // Start the timer thread, if this timer is the next one due!
+  if (pTmr->iHeap == 0)
+     SetMasterTimer(Time);
+
+  TimerLeave();
 
   return Ret;
 }
@@ -445,74 +655,60 @@ VOID
 FASTCALL
 ProcessTimers(VOID)
 {
-  LARGE_INTEGER DueTime;
-  LONG Time;
-  PLIST_ENTRY pLE;
+  DWORD Time;
   PTIMER pTmr;
+  BOOL Fire;
   LONG TimerCount = 0;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  Time = EngGetTickCount32();
+  Time = TimerGetTime();
 
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
-
-  while(pLE != &TimersListHead)
+  // Only look at the timers that are due, the earliest one is on top.
+  while (TimerHeapCount > 0)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = TimerHeap[0];
+    if ((LONG)(pTmr->dwDueTime - Time) > 0)
+       break;
+
     TimerCount++;
-    if (pTmr->flags & TMRF_WAITING)
+    ASSERT(pTmr->pti);
+    Fire = (!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP));
+
+    // Schedule the next run before calling out.
+    if (Fire && (pTmr->flags & TMRF_ONESHOT))
     {
-       pLE = pTmr->ptmrList.Flink;
-       pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
-       continue;
+       pTmr->flags |= TMRF_WAITING;
+       TimerHeapRemove(pTmr);
     }
+    else
+    {
+       pTmr->dwDueTime = Time + pTmr->cmsRate;
+       TimerHeapSiftDown(0);
+    }
+
+    if (!Fire)
+       continue;
 
-    if (pTmr->flags & TMRF_INIT)
+    if (pTmr->flags & TMRF_RIT)
     {
-       pTmr->flags &= ~TMRF_INIT; // Skip this run.
+       // Hard coded call here, inside raw input thread.
+       pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
     }
     else
     {
-       if (pTmr->cmsCountdown < 0)
-       {
-          ASSERT(pTmr->pti);
-          if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
-          {
-             if (pTmr->flags & TMRF_ONESHOT)
-                pTmr->flags |= TMRF_WAITING;
-
-             if (pTmr->flags & TMRF_RIT)
-             {
-                // Hard coded call here, inside raw input thread.
-                pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
-             }
-             else
-             {
-                pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
-                // Set thread message queue for this timer.
-                if (pTmr->pti)
-                {  // Wakeup thread
-                   pTmr->pti->cTimersReady++;
-                   ASSERT(pTmr->pti->pEventQueueServer != NULL);
-                   MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
-                }
-             }
-          }
-          pTmr->cmsCountdown = pTmr->cmsRate;
+       pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
+       // Set thread message queue for this timer.
+       if (pTmr->pti)
+       {  // Wakeup thread
+          pTmr->pti->cTimersReady++;
+          ASSERT(pTmr->pti->pEventQueueServer != NULL);
+          MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
        }
-       else
-          pTmr->cmsCountdown -= Time - TimeLast;
     }
-
-    pLE = pLE->Flink;
   }
 
-  // Restart the timer thread!
-  ASSERT(MasterTimer != NULL);
-  KeSetTimer(MasterTimer, DueTime, NULL);
-
-  TimeLast = Time;
+  // Restart the timer thread for the next timer due!
+  SetMasterTimer(Time);
 
   TimerLeave();
   TRACE("TimerCount = %d\n", TimerCount);
@@ -593,7 +789,7 @@ NTSTATUS
 NTAPI
 InitTimerImpl(VOID)
 {
-   ULONG BitmapBytes;
+   ULONG BitmapBytes, i;
 
    /* Allocate FAST_MUTEX from non paged pool */
    Mutex = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
@@ -620,6 +816,8 @@ InitTimerImpl(VOID)
 
    ExInitializeResourceLite(&TimerLock);
    InitializeListHead(&TimersListHead);
+   for (i = 0; i < TIMER_HASH_BUCKETS; i++)
+      InitializeListHead(&TimersHashTable[i]);
 
    return STATUS_SUCCESS;
 }
@@ -4,10 +4,12 @@ typedef struct _TIMER
 {
   HEAD           head;
   LIST_ENTRY     ptmrList;
+  LIST_ENTRY     ptmrHash;     // Entry in the window and id hash table
   PTHREADINFO    pti;
   PWND           pWnd;         // hWnd
   UINT_PTR       nID;          // Specifies a nonzero timer identifier.
-  INT            cmsCountdown; // uElapse
+  DWORD          dwDueTime;    // Next expiration, in ms of interrupt time
+  ULONG          iHeap;        // Position in the due time heap
   INT            cmsRate;      // uElapse
   FLONG          flags;
   TIMERPROC      pfn;          // lpTimerFunc